@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+# Convert a binary OpenOCD event log, written by "event_log start <file>",
+# to the Chrome trace event format (JSON). The result can be opened with
+# chrome://tracing or https://ui.perfetto.dev
+#
+# Usage: event_log2trace.py events.bin > trace.json
+
+import json
+import struct
+import sys
+
+MAGIC = b"OCDEVT1\0"
+RECORD = struct.Struct("<QIHBB")
+
+# event type: (name, thread), events of a thread nest on one track
+TYPES = {
+	1: ("jtag flush", "adapter"),
+	2: ("dap run", "adapter"),
+	3: ("gdb packet", "gdb"),
+	4: ("target event", "target"),
+	5: ("algorithm", "target"),
+	6: ("command", "command"),
+}
+THREADS = {"command": 0, "gdb": 1, "target": 2, "adapter": 3}
+
+# enum target_event, see src/target/target.h
+TARGET_EVENTS = dict(enumerate([
+	"gdb-halt", "halted", "resumed", "resume-start", "resume-end",
+	"step-start", "step-end", "gdb-start", "gdb-end",
+	"reset-start", "reset-assert-pre", "reset-assert", "reset-assert-post",
+	"reset-deassert-pre", "reset-deassert-post", "reset-init", "reset-end",
+	"debug-halted", "debug-resumed",
+	"examine-start", "examine-fail", "examine-end",
+	"gdb-attach", "gdb-detach",
+	"gdb-flash-erase-start", "gdb-flash-erase-end",
+	"gdb-flash-write-start", "gdb-flash-write-end",
+	"trace-config",
+]))
+TARGET_EVENTS.update({0x100 + i: "semihosting-user-cmd-0x%x" % (0x100 + i) for i in range(8)})
+
+
+def packet_name(arg):
+	chars = bytes(c for c in (arg & 0xff, arg >> 8 & 0xff) if c)
+	return chars.decode("ascii", "replace")
+
+
+def convert(data):
+	if data[:len(MAGIC)] != MAGIC:
+		sys.exit("not an OpenOCD event log")
+
+	events = []
+	open_names = {}
+	# command names by id, from the name records preceding their first use
+	commands = {}
+	pending_name = b""
+	t0 = None
+	last = 0
+	for offset in range(len(MAGIC), len(data) - RECORD.size + 1, RECORD.size):
+		time_us, arg, kind, phase, _ = RECORD.unpack_from(data, offset)
+		if kind == 7:
+			pending_name += struct.pack("<I", arg)
+			continue
+		if t0 is None:
+			t0 = time_us
+		last = time_us - t0
+		name, thread = TYPES.get(kind, ("event %d" % kind, "target"))
+		ph = chr(phase)
+		event = {"ph": ph, "ts": last, "pid": 1, "tid": THREADS[thread]}
+
+		if ph == "B":
+			if kind == 3:
+				name = "gdb " + packet_name(arg)
+			elif kind == 6:
+				if pending_name:
+					commands[arg] = pending_name.split(b"\0")[0].decode("ascii", "replace")
+					pending_name = b""
+				name = commands.get(arg, "command %d" % arg)
+			event["args"] = {"arg": "0x%x" % arg}
+			open_names.setdefault(kind, []).append(name)
+		elif ph == "E":
+			stack = open_names.get(kind)
+			if not stack:
+				continue
+			name = stack.pop()
+			event["args"] = {"result": struct.unpack("<i", struct.pack("<I", arg))[0]}
+		else:
+			name = TARGET_EVENTS.get(arg, "event %d" % arg) if kind == 4 else name
+			event["s"] = "p"
+
+		event["name"] = name
+		events.append(event)
+
+	# close whatever was still running when the log stopped
+	for kind, stack in open_names.items():
+		for name in reversed(stack):
+			events.append({"name": name, "ph": "E", "ts": last, "pid": 1,
+				"tid": THREADS[TYPES.get(kind, ("", "target"))[1]]})
+
+	for thread, tid in THREADS.items():
+		events.append({"name": "thread_name", "ph": "M", "pid": 1, "tid": tid,
+			"args": {"name": thread}})
+
+	return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def main():
+	if len(sys.argv) != 2:
+		sys.exit("usage: %s event_log_file > trace.json" % sys.argv[0])
+	with open(sys.argv[1], "rb") as f:
+		data = f.read()
+	json.dump(convert(data), sys.stdout)
+	sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+	main()
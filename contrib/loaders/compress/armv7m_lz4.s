@@ -0,0 +1,79 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+	LZ4 block decompressor, see helper/lz4.c for the format.
+
+	parameters:
+	r0 - compressed data start
+	r1 - compressed data end
+	r2 - destination in - end of decompressed data out
+*/
+
+	.text
+	.syntax unified
+	.cpu cortex-m0
+	.thumb
+	.thumb_func
+
+	.align	2
+
+_start:
+sequence:
+	cmp		r0, r1
+	bhs		done
+	ldrb	r3, [r0]
+	adds	r0, r0, #1
+	lsrs	r4, r3, #4
+	cmp		r4, #15
+	bne		literals
+literal_len:
+	ldrb	r5, [r0]
+	adds	r0, r0, #1
+	adds	r4, r4, r5
+	cmp		r5, #255
+	beq		literal_len
+literals:
+	cmp		r4, #0
+	beq		match
+literal_copy:
+	ldrb	r5, [r0]
+	adds	r0, r0, #1
+	strb	r5, [r2]
+	adds	r2, r2, #1
+	subs	r4, r4, #1
+	bne		literal_copy
+match:
+	/* the last sequence has no match */
+	cmp		r0, r1
+	bhs		done
+	ldrb	r4, [r0]
+	ldrb	r5, [r0, #1]
+	adds	r0, r0, #2
+	lsls	r5, r5, #8
+	orrs	r4, r4, r5
+	mov		r5, r2
+	subs	r5, r5, r4
+	movs	r4, #15
+	ands	r4, r4, r3
+	cmp		r4, #15
+	bne		match_copy_start
+match_len:
+	ldrb	r6, [r0]
+	adds	r0, r0, #1
+	adds	r4, r4, r6
+	cmp		r6, #255
+	beq		match_len
+match_copy_start:
+	adds	r4, r4, #4
+match_copy:
+	ldrb	r6, [r5]
+	adds	r5, r5, #1
+	strb	r6, [r2]
+	adds	r2, r2, #1
+	subs	r4, r4, #1
+	bne		match_copy
+	b		sequence
+done:
+	bkpt	#0
+
+	.end
@@ -0,0 +1,31 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+	Copy memory a word at a time, from the lowest address up.
+
+	parameters:
+	r0 - destination address, word aligned
+	r1 - source address, word aligned
+	r2 - number of words, at least 1
+*/
+
+	.text
+	.syntax unified
+	.cpu cortex-m0
+	.thumb
+	.thumb_func
+
+	.align	2
+
+start:
+	ldmia	r1!, {r3}
+	stmia	r0!, {r3}
+	subs	r2, #1
+	bne	start
+
+/* Avoid padding at .text segment end. Otherwise exit point check fails. */
+	.skip	( . - start + 2) & 2, 0
+
+	bkpt	#0
+
+	.end
@@ -0,0 +1,30 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+	Fill memory with a word pattern.
+
+	parameters:
+	r0 - address, word aligned
+	r1 - number of words, at least 1
+	r2 - pattern
+*/
+
+	.text
+	.syntax unified
+	.cpu cortex-m0
+	.thumb
+	.thumb_func
+
+	.align	2
+
+start:
+	stmia	r0!, {r2}
+	subs	r1, #1
+	bne	start
+
+/* Avoid padding at .text segment end. Otherwise exit point check fails. */
+	.skip	( . - start + 2) & 2, 0
+
+	bkpt	#0
+
+	.end
@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+	Find the first occurrence of a byte pattern in memory.
+
+	parameters:
+	r0 - address of the memory to search
+	r1 - size of the memory in bytes
+	r2 - address of the pattern
+	r3 - length of the pattern, at least 1
+
+	result:
+	r0 - address of the match
+	r1 - 0 if the pattern was not found
+*/
+
+	.text
+	.syntax unified
+	.cpu cortex-m0
+	.thumb
+	.thumb_func
+
+	.align	2
+
+start:
+	ldrb	r4, [r2]	/* first byte of the pattern */
+
+search_loop:
+	cmp	r1, r3
+	blo	not_found	/* rest is shorter than the pattern */
+
+	ldrb	r5, [r0]
+	cmp	r5, r4
+	bne	next
+
+	movs	r6, #1
+compare_loop:
+	cmp	r6, r3
+	beq	done		/* whole pattern matched */
+	ldrb	r5, [r0, r6]
+	ldrb	r7, [r2, r6]
+	cmp	r5, r7
+	bne	next
+	adds	r6, #1
+	b	compare_loop
+
+next:
+	adds	r0, #1
+	subs	r1, #1
+	b	search_loop
+
+not_found:
+	movs	r1, #0
+
+/* Avoid padding at .text segment end. Otherwise exit point check fails. */
+	.skip	( . - start + 2) & 2, 0
+
+done:
+	bkpt	#0
+
+	.end
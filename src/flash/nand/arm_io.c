@@ -72,6 +72,9 @@ static int arm_code_to_working_area(struct target *target,
  * Different code fragments could handle:
  *   - 16-bit wide data (needs different setup)
  *
+ * Data larger than the copy area (e.g. page and OOB in one go) is moved
+ * in copy area sized chunks, reusing the loaded code for each of them.
+ *
  * @param nand Pointer to the arm_nand_data struct that defines the I/O
  * @param data Pointer to the data to be copied to flash
  * @param size Size of the data being copied
@@ -85,7 +88,7 @@ int arm_nandwrite(struct arm_nand_data *nand, uint8_t *data, int size)
 	void *arm_algo;
 	struct arm *arm = target->arch_info;
 	struct reg_param reg_params[3];
-	uint32_t target_buf;
+	uint32_t target_buf, chunk_max;
 	uint32_t exit_var = 0;
 	int retval;
 
@@ -146,30 +149,42 @@ int arm_nandwrite(struct arm_nand_data *nand, uint8_t *data, int size)
 
 	nand->op = ARM_NAND_WRITE;
 
-	/* copy data to work area */
 	target_buf = nand->copy_area->address + target_code_size;
-	retval = target_write_buffer(target, target_buf, size, data);
-	if (retval != ERROR_OK)
-		return retval;
+	chunk_max = nand->copy_area->size - target_code_size;
 
 	/* set up parameters */
 	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN);
 	init_reg_param(&reg_params[1], "r1", 32, PARAM_IN);
 	init_reg_param(&reg_params[2], "r2", 32, PARAM_IN);
 
-	buf_set_u32(reg_params[0].value, 0, 32, nand->data);
-	buf_set_u32(reg_params[1].value, 0, 32, target_buf);
-	buf_set_u32(reg_params[2].value, 0, 32, size);
-
 	/* armv4 must exit using a hardware breakpoint */
 	if (arm->arch == ARM_ARCH_V4)
 		exit_var = nand->copy_area->address + target_code_size - 4;
 
-	/* use alg to write data from work area to NAND chip */
-	retval = target_run_algorithm(target, 0, NULL, 3, reg_params,
-			nand->copy_area->address, exit_var, 1000, arm_algo);
-	if (retval != ERROR_OK)
-		LOG_ERROR("error executing hosted NAND write");
+	retval = ERROR_OK;
+	while (size > 0) {
+		uint32_t chunk = MIN((uint32_t)size, chunk_max);
+
+		/* copy data to work area */
+		retval = target_write_buffer(target, target_buf, chunk, data);
+		if (retval != ERROR_OK)
+			break;
+
+		buf_set_u32(reg_params[0].value, 0, 32, nand->data);
+		buf_set_u32(reg_params[1].value, 0, 32, target_buf);
+		buf_set_u32(reg_params[2].value, 0, 32, chunk);
+
+		/* use alg to write data from work area to NAND chip */
+		retval = target_run_algorithm(target, 0, NULL, 3, reg_params,
+				nand->copy_area->address, exit_var, 1000, arm_algo);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("error executing hosted NAND write");
+			break;
+		}
+
+		data += chunk;
+		size -= chunk;
+	}
 
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
@@ -182,6 +197,8 @@ int arm_nandwrite(struct arm_nand_data *nand, uint8_t *data, int size)
  * Uses an on-chip algorithm for an ARM device to read from a NAND device and
  * store the data into the host machine's memory.
  *
+ * Like arm_nandwrite(), data larger than the copy area is moved in chunks.
+ *
  * @param nand Pointer to the arm_nand_data struct that defines the I/O
  * @param data Pointer to the data buffer to store the read data
  * @param size Amount of data to be stored to the buffer.
@@ -195,7 +212,7 @@ int arm_nandread(struct arm_nand_data *nand, uint8_t *data, uint32_t size)
 	void *arm_algo;
 	struct arm *arm = target->arch_info;
 	struct reg_param reg_params[3];
-	uint32_t target_buf;
+	uint32_t target_buf, chunk_max;
 	uint32_t exit_var = 0;
 	int retval;
 
@@ -257,32 +274,45 @@ int arm_nandread(struct arm_nand_data *nand, uint8_t *data, uint32_t size)
 
 	nand->op = ARM_NAND_READ;
 	target_buf = nand->copy_area->address + target_code_size;
+	chunk_max = nand->copy_area->size - target_code_size;
 
 	/* set up parameters */
 	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN);
 	init_reg_param(&reg_params[1], "r1", 32, PARAM_IN);
 	init_reg_param(&reg_params[2], "r2", 32, PARAM_IN);
 
-	buf_set_u32(reg_params[0].value, 0, 32, target_buf);
-	buf_set_u32(reg_params[1].value, 0, 32, nand->data);
-	buf_set_u32(reg_params[2].value, 0, 32, size);
-
 	/* armv4 must exit using a hardware breakpoint */
 	if (arm->arch == ARM_ARCH_V4)
 		exit_var = nand->copy_area->address + target_code_size - 4;
 
-	/* use alg to write data from NAND chip to work area */
-	retval = target_run_algorithm(target, 0, NULL, 3, reg_params,
-			nand->copy_area->address, exit_var, 1000, arm_algo);
-	if (retval != ERROR_OK)
-		LOG_ERROR("error executing hosted NAND read");
+	retval = ERROR_OK;
+	while (size > 0) {
+		uint32_t chunk = MIN(size, chunk_max);
+
+		buf_set_u32(reg_params[0].value, 0, 32, target_buf);
+		buf_set_u32(reg_params[1].value, 0, 32, nand->data);
+		buf_set_u32(reg_params[2].value, 0, 32, chunk);
+
+		/* use alg to write data from NAND chip to work area */
+		retval = target_run_algorithm(target, 0, NULL, 3, reg_params,
+				nand->copy_area->address, exit_var, 1000, arm_algo);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("error executing hosted NAND read");
+			break;
+		}
+
+		/* read from work area to the host's memory */
+		retval = target_read_buffer(target, target_buf, chunk, data);
+		if (retval != ERROR_OK)
+			break;
+
+		data += chunk;
+		size -= chunk;
+	}
 
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
 	destroy_reg_param(&reg_params[2]);
 
-	/* read from work area to the host's memory */
-	retval = target_read_buffer(target, target_buf, size, data);
-
 	return retval;
 }
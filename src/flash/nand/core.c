@@ -13,6 +13,7 @@
 #endif
 
 #include "imp.h"
+#include <helper/fileio.h>
 
 /* configured NAND devices and NAND Flash command handler */
 struct nand_device *nand_devices;
@@ -212,12 +213,64 @@ COMMAND_HELPER(nand_command_get_device, unsigned name_index,
 	return ERROR_OK;
 }
 
-int nand_build_bbt(struct nand_device *nand, int first, int last)
+/* read the manufacturer bad block marker of one block */
+static int nand_read_bad_marker(struct nand_device *nand, int block, bool *is_bad)
 {
-	uint32_t page;
-	int i;
 	int pages_per_block = (nand->erase_size / nand->page_size);
 	uint8_t oob[6];
+
+	int ret = nand_read_page(nand, block * pages_per_block, NULL, 0, oob, 6);
+	if (ret != ERROR_OK)
+		return ret;
+
+	*is_bad = ((nand->device->options & NAND_BUSWIDTH_16) && ((oob[0] & oob[1]) != 0xff))
+			|| (((nand->page_size == 512) && (oob[5] != 0xff)) ||
+			((nand->page_size == 2048) && (oob[0] != 0xff)));
+
+	return ERROR_OK;
+}
+
+/* Number of bad blocks and of evenly spread blocks whose markers are read
+ * back to check that a cached bad block table still matches the chip */
+#define NAND_BBT_SAMPLES 16
+
+/* write the bad block table to the cache file, once all of it is known */
+static void nand_bbt_save(struct nand_device *nand)
+{
+	struct fileio *fileio;
+	char line[64];
+	size_t written;
+
+	for (int i = 0; i < nand->num_blocks; i++)
+		if (nand->blocks[i].is_bad == -1)
+			return;
+
+	if (fileio_open(&fileio, nand->bbt_file, FILEIO_WRITE, FILEIO_TEXT) != ERROR_OK) {
+		LOG_WARNING("couldn't write NAND bad block table to '%s'", nand->bbt_file);
+		return;
+	}
+
+	snprintf(line, sizeof(line), "nand-bbt 0x%02x 0x%02x %d %d %d\n",
+			nand->manufacturer->id, nand->device->id,
+			nand->page_size, nand->erase_size, nand->num_blocks);
+	int retval = fileio_write(fileio, strlen(line), line, &written);
+
+	for (int i = 0; retval == ERROR_OK && i < nand->num_blocks; i++) {
+		if (nand->blocks[i].is_bad != 1)
+			continue;
+		snprintf(line, sizeof(line), "bad %d\n", i);
+		retval = fileio_write(fileio, strlen(line), line, &written);
+	}
+
+	fileio_close(fileio);
+	if (retval != ERROR_OK)
+		LOG_WARNING("couldn't write NAND bad block table to '%s'", nand->bbt_file);
+}
+
+int nand_build_bbt(struct nand_device *nand, int first, int last)
+{
+	int i;
+	bool is_bad;
 	int ret;
 
 	if ((first < 0) || (first >= nand->num_blocks))
@@ -226,26 +279,107 @@ int nand_build_bbt(struct nand_device *nand, int first, int last)
 	if ((last >= nand->num_blocks) || (last == -1))
 		last = nand->num_blocks - 1;
 
-	page = first * pages_per_block;
 	for (i = first; i <= last; i++) {
-		ret = nand_read_page(nand, page, NULL, 0, oob, 6);
+		ret = nand_read_bad_marker(nand, i, &is_bad);
 		if (ret != ERROR_OK)
 			return ret;
 
-		if (((nand->device->options & NAND_BUSWIDTH_16) && ((oob[0] & oob[1]) != 0xff))
-				|| (((nand->page_size == 512) && (oob[5] != 0xff)) ||
-				((nand->page_size == 2048) && (oob[0] != 0xff)))) {
+		if (is_bad) {
 			LOG_WARNING("bad block: %i", i);
 			nand->blocks[i].is_bad = 1;
 		} else
 			nand->blocks[i].is_bad = 0;
-
-		page += pages_per_block;
 	}
 
+	if (nand->bbt_file)
+		nand_bbt_save(nand);
+
 	return ERROR_OK;
 }
 
+/**
+ * Load the bad block table from the cache file set with "nand bbt_file".
+ * The cache is only used if it was written for the same NAND ID and
+ * geometry, and if the markers of a sample of its bad and good blocks
+ * still read back as recorded.
+ *
+ * @returns ERROR_OK if the table was loaded, an error if it has to be
+ * rebuilt with nand_build_bbt().
+ */
+int nand_bbt_load(struct nand_device *nand)
+{
+	struct fileio *fileio;
+	char line[64];
+	unsigned int mfr_id, dev_id;
+	int page_size, erase_size, num_blocks;
+
+	if (!nand->device || !nand->bbt_file)
+		return ERROR_NAND_DEVICE_NOT_PROBED;
+
+	int retval = fileio_open(&fileio, nand->bbt_file, FILEIO_READ, FILEIO_TEXT);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = fileio_fgets(fileio, sizeof(line), line);
+	if (retval != ERROR_OK
+			|| sscanf(line, "nand-bbt %x %x %d %d %d", &mfr_id, &dev_id,
+				&page_size, &erase_size, &num_blocks) != 5
+			|| (int)mfr_id != nand->manufacturer->id || (int)dev_id != nand->device->id
+			|| page_size != nand->page_size || erase_size != nand->erase_size
+			|| num_blocks != nand->num_blocks) {
+		LOG_INFO("NAND bad block table in '%s' doesn't match %s", nand->bbt_file, nand->name);
+		fileio_close(fileio);
+		return ERROR_NAND_OPERATION_FAILED;
+	}
+
+	uint8_t *bad = calloc(num_blocks, 1);
+	if (!bad) {
+		fileio_close(fileio);
+		return ERROR_FAIL;
+	}
+
+	int block;
+	while (fileio_fgets(fileio, sizeof(line), line) == ERROR_OK) {
+		if (sscanf(line, "bad %d", &block) != 1 || block < 0 || block >= num_blocks) {
+			retval = ERROR_NAND_OPERATION_FAILED;
+			break;
+		}
+		bad[block] = 1;
+	}
+	fileio_close(fileio);
+
+	/* check the recorded bad blocks, then an even spread of all blocks */
+	int checked_bad = 0;
+	for (block = 0; retval == ERROR_OK && block < num_blocks
+			&& checked_bad < NAND_BBT_SAMPLES; block++) {
+		if (!bad[block])
+			continue;
+		bool is_bad;
+		retval = nand_read_bad_marker(nand, block, &is_bad);
+		if (retval == ERROR_OK && !is_bad)
+			retval = ERROR_NAND_OPERATION_FAILED;
+		checked_bad++;
+	}
+	for (int i = 0; retval == ERROR_OK && i < NAND_BBT_SAMPLES; i++) {
+		bool is_bad;
+		block = (int)((int64_t)i * num_blocks / NAND_BBT_SAMPLES);
+		retval = nand_read_bad_marker(nand, block, &is_bad);
+		if (retval == ERROR_OK && is_bad != bad[block])
+			retval = ERROR_NAND_OPERATION_FAILED;
+	}
+
+	if (retval == ERROR_OK) {
+		for (block = 0; block < num_blocks; block++)
+			nand->blocks[block].is_bad = bad[block];
+		LOG_DEBUG("loaded NAND bad block table from '%s'", nand->bbt_file);
+	} else {
+		LOG_INFO("NAND bad block table in '%s' doesn't match %s", nand->bbt_file, nand->name);
+	}
+
+	free(bad);
+	return retval;
+}
+
 int nand_read_status(struct nand_device *nand, uint8_t *status)
 {
 	if (!nand->device)
@@ -496,6 +630,10 @@ int nand_probe(struct nand_device *nand)
 		nand->blocks[i].is_bad = -1;
 	}
 
+	/* with a cache file the table is known after probe, rescan on mismatch */
+	if (nand->bbt_file && nand_bbt_load(nand) != ERROR_OK)
+		return nand_build_bbt(nand, 0, -1);
+
 	return ERROR_OK;
 }
 
@@ -785,6 +923,18 @@ int nand_read_page_raw(struct nand_device *nand, uint32_t page,
 	if (retval != ERROR_OK)
 		return retval;
 
+	/* OOB follows the page data, let a bulk reader fetch both in one go */
+	if (data && oob && nand->controller->read_block_data) {
+		uint8_t *buf = malloc(data_size + oob_size);
+		if (buf) {
+			retval = nand_read_data_page(nand, buf, data_size + oob_size);
+			memcpy(data, buf, data_size);
+			memcpy(oob, buf + data_size, oob_size);
+			free(buf);
+			return retval;
+		}
+	}
+
 	if (data)
 		nand_read_data_page(nand, data, data_size);
 
@@ -862,6 +1012,22 @@ int nand_write_page_raw(struct nand_device *nand, uint32_t page,
 	if (retval != ERROR_OK)
 		return retval;
 
+	/* OOB follows the page data, let a bulk writer send both in one go */
+	if (data && oob && nand->controller->write_block_data) {
+		uint8_t *buf = malloc(data_size + oob_size);
+		if (buf) {
+			memcpy(buf, data, data_size);
+			memcpy(buf + data_size, oob, oob_size);
+			retval = nand_write_data_page(nand, buf, data_size + oob_size);
+			free(buf);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("Unable to write data to NAND device");
+				return retval;
+			}
+			return nand_write_finish(nand);
+		}
+	}
+
 	if (data) {
 		retval = nand_write_data_page(nand, data, data_size);
 		if (retval != ERROR_OK) {
@@ -58,6 +58,7 @@ struct nand_device {
 	bool use_raw;
 	int num_blocks;
 	struct nand_block *blocks;
+	char *bbt_file;		/* bad block table cache, see nand_bbt_load() */
 	struct nand_device *next;
 };
 
@@ -391,6 +391,36 @@ COMMAND_HANDLER(handle_nand_raw_access_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_nand_bbt_file_command)
+{
+	if ((CMD_ARGC < 1) || (CMD_ARGC > 2))
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct nand_device *p;
+	int retval = CALL_COMMAND_HANDLER(nand_command_get_device, 0, &p);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (CMD_ARGC == 2) {
+		free(p->bbt_file);
+		p->bbt_file = NULL;
+		if (strcmp(CMD_ARGV[1], "none") != 0) {
+			p->bbt_file = strdup(CMD_ARGV[1]);
+			if (!p->bbt_file) {
+				LOG_ERROR("Out of memory");
+				return ERROR_FAIL;
+			}
+		}
+	}
+
+	if (p->bbt_file)
+		command_print(CMD, "bad block table cache: %s", p->bbt_file);
+	else
+		command_print(CMD, "bad block table cache: none");
+
+	return ERROR_OK;
+}
+
 static const struct command_registration nand_exec_command_handlers[] = {
 	{
 		.name = "list",
@@ -458,6 +488,13 @@ static const struct command_registration nand_exec_command_handlers[] = {
 		.usage = "bank_id ['enable'|'disable']",
 		.help = "raw access to NAND flash device",
 	},
+	{
+		.name = "bbt_file",
+		.handler = handle_nand_bbt_file_command,
+		.mode = COMMAND_ANY,
+		.usage = "bank_id [filename|'none']",
+		.help = "set or show the file caching the bad block table",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -534,6 +571,7 @@ static COMMAND_HELPER(create_nand_device, const char *bank_name,
 	c->address_cycles = 0;
 	c->page_size = 0;
 	c->use_raw = false;
+	c->bbt_file = NULL;
 	c->next = NULL;
 
 	retval = CALL_COMMAND_HANDLER(controller->nand_device_command, c);
@@ -15,6 +15,8 @@
 #include <helper/time_support.h>
 #include <jtag/jtag.h>
 #include <target/cortex_m.h>
+#include <target/algorithm.h>
+#include <target/armv7m.h>
 
 #define SAMD_NUM_PROT_BLOCKS	16
 #define SAMD_PAGE_SIZE_MAX	1024
@@ -56,6 +58,10 @@
 /* NVMCTRL bits */
 #define SAMD_NVM_CTRLB_MANW 0x80
 
+/* Writes of at least this many whole pages use the on-target loader */
+#define SAMD_LOADER_MIN_PAGES	4
+#define SAMD_LOADER_FIFO_PAGES	16
+
 /* NVMCTRL_INTFLAG bits */
 #define SAMD_NVM_INTFLAG_READY 0x01
 
@@ -825,6 +831,100 @@ static int samd_erase(struct flash_bank *bank, unsigned int first,
 }
 
 
+/* Program whole pages with a loader streaming them through a fifo, the
+ * page buffer fill and the write page command stay on the target */
+static int samd_write_block(struct flash_bank *bank, const uint8_t *buffer,
+		uint32_t offset, uint32_t count, uint32_t nvm_ctrlb)
+{
+	struct target *target = bank->target;
+	struct samd_info *chip = (struct samd_info *)bank->driver_priv;
+	uint32_t buffer_size = SAMD_LOADER_FIFO_PAGES * chip->page_size;
+	struct working_area *write_algorithm;
+	struct working_area *source;
+	struct reg_param reg_params[7];
+	struct armv7m_algorithm armv7m_info;
+	int retval, retval2;
+
+	static const uint8_t samd_flash_write_code[] = {
+#include "../../../contrib/loaders/flash/at91samd/at91samd_write.inc"
+	};
+
+	assert(offset % chip->page_size == 0);
+	assert(count % chip->page_size == 0);
+
+	if (target_alloc_working_area_code(target, samd_flash_write_code,
+			sizeof(samd_flash_write_code), &write_algorithm) != ERROR_OK) {
+		LOG_WARNING("no working area available, can't do block memory writes");
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	/* fifo pointers and data */
+	while (target_alloc_working_area_try(target, buffer_size + 8, &source) != ERROR_OK) {
+		buffer_size /= 2;
+		if (buffer_size < chip->page_size) {
+			target_free_working_area(target, write_algorithm);
+			LOG_WARNING("no large enough working area available, can't do block memory writes");
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		}
+	}
+
+	/* the loader always issues the write page command */
+	if (!(nvm_ctrlb & SAMD_NVM_CTRLB_MANW)) {
+		retval = target_write_u32(target, SAMD_NVMCTRL + SAMD_NVMCTRL_CTRLB,
+				nvm_ctrlb | SAMD_NVM_CTRLB_MANW);
+		if (retval != ERROR_OK)
+			goto free_wa;
+	}
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);	/* page count */
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);	/* fifo start */
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);	/* fifo end */
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);	/* flash address */
+	init_reg_param(&reg_params[4], "r8", 32, PARAM_OUT);	/* page size */
+	init_reg_param(&reg_params[5], "r9", 32, PARAM_OUT);	/* NVMCTRL base */
+	init_reg_param(&reg_params[6], "r10", 32, PARAM_OUT);	/* write page command */
+
+	buf_set_u32(reg_params[0].value, 0, 32, count / chip->page_size);
+	buf_set_u32(reg_params[1].value, 0, 32, source->address);
+	buf_set_u32(reg_params[2].value, 0, 32, source->address + source->size);
+	buf_set_u32(reg_params[3].value, 0, 32, bank->base + offset);
+	buf_set_u32(reg_params[4].value, 0, 32, chip->page_size);
+	buf_set_u32(reg_params[5].value, 0, 32, SAMD_NVMCTRL);
+	buf_set_u32(reg_params[6].value, 0, 32, SAMD_NVM_CMD(SAMD_NVM_CMD_WP));
+
+	retval = target_run_flash_async_algorithm(target, buffer, count / 4, 4,
+			0, NULL,
+			ARRAY_SIZE(reg_params), reg_params,
+			source->address, source->size,
+			write_algorithm->address, write_algorithm->address + sizeof(samd_flash_write_code) - 2,
+			&armv7m_info);
+
+	if (retval == ERROR_FLASH_OPERATION_FAILED) {
+		/* the loader stopped on an NVM error, report and clear it */
+		retval2 = samd_check_error(target);
+		if (retval2 != ERROR_OK)
+			retval = retval2;
+	}
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(reg_params); i++)
+		destroy_reg_param(&reg_params[i]);
+
+	if (!(nvm_ctrlb & SAMD_NVM_CTRLB_MANW)) {
+		retval2 = target_write_u32(target, SAMD_NVMCTRL + SAMD_NVMCTRL_CTRLB, nvm_ctrlb);
+		if (retval == ERROR_OK)
+			retval = retval2;
+	}
+
+free_wa:
+	target_free_working_area(target, source);
+	target_free_working_area(target, write_algorithm);
+
+	return retval;
+}
+
 static int samd_write(struct flash_bank *bank, const uint8_t *buffer,
 		uint32_t offset, uint32_t count)
 {
@@ -837,6 +937,7 @@ static int samd_write(struct flash_bank *bank, const uint8_t *buffer,
 	struct samd_info *chip = (struct samd_info *)bank->driver_priv;
 	uint8_t *pb = NULL;
 	bool manual_wp;
+	bool use_loader = true;
 
 	if (bank->target->state != TARGET_HALTED) {
 		LOG_ERROR("Target not halted");
@@ -866,6 +967,24 @@ static int samd_write(struct flash_bank *bank, const uint8_t *buffer,
 	}
 
 	while (count) {
+		/* Whole pages go through the loader, the partial ones below */
+		if (use_loader && offset % chip->page_size == 0 &&
+				count >= SAMD_LOADER_MIN_PAGES * chip->page_size) {
+			nb = count - count % chip->page_size;
+			res = samd_write_block(bank, buffer, offset, nb, nvm_ctrlb);
+			if (res == ERROR_OK) {
+				count -= nb;
+				offset += nb;
+				buffer += nb;
+				continue;
+			}
+			if (res != ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
+				LOG_ERROR("%s: write failed at offset 0x%08" PRIx32, __func__, offset);
+				goto free_pb;
+			}
+			use_loader = false;
+		}
+
 		nb = chip->page_size - offset % chip->page_size;
 		if (count < nb)
 			nb = count;
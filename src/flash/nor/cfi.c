@@ -1574,6 +1574,121 @@ static int cfi_spansion_write_block_mips(struct flash_bank *bank, const uint8_t
 	return retval;
 }
 
+/* Program through a FIFO drained by an ARMv7-M loader, so the host streams
+ * data while the target polls the flash for write completion. */
+static int cfi_spansion_write_block_async(struct flash_bank *bank, const uint8_t *buffer,
+	uint32_t address, uint32_t count)
+{
+	struct cfi_flash_bank *cfi_info = bank->driver_priv;
+	struct cfi_spansion_pri_ext *pri_ext = cfi_info->pri_ext;
+	struct target *target = bank->target;
+	struct reg_param reg_params[12];
+	struct armv7m_algorithm armv7m_algo;
+	struct working_area *write_algorithm;
+	struct working_area *fifo;
+	uint32_t fifo_size = 16384;
+	const uint8_t *target_code_src;
+	uint32_t target_code_size;
+	int retval;
+
+	/* see contrib/loaders/flash/cfi/armv7m_cfi_span_async.S for src */
+	static const uint8_t armv7m_cfi_span_8_async_code[] = {
+#include "../../../contrib/loaders/flash/cfi/armv7m_cfi_span_8_async.inc"
+	};
+	static const uint8_t armv7m_cfi_span_16_async_code[] = {
+#include "../../../contrib/loaders/flash/cfi/armv7m_cfi_span_16_async.inc"
+	};
+	static const uint8_t armv7m_cfi_span_32_async_code[] = {
+#include "../../../contrib/loaders/flash/cfi/armv7m_cfi_span_32_async.inc"
+	};
+
+	switch (bank->bus_width) {
+		case 1:
+			target_code_src = armv7m_cfi_span_8_async_code;
+			target_code_size = sizeof(armv7m_cfi_span_8_async_code);
+			break;
+		case 2:
+			target_code_src = armv7m_cfi_span_16_async_code;
+			target_code_size = sizeof(armv7m_cfi_span_16_async_code);
+			break;
+		case 4:
+			target_code_src = armv7m_cfi_span_32_async_code;
+			target_code_size = sizeof(armv7m_cfi_span_32_async_code);
+			break;
+		default:
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	if (count < bank->bus_width)
+		return ERROR_OK;
+
+	retval = target_alloc_working_area_code(target, target_code_src, target_code_size,
+			&write_algorithm);
+	if (retval != ERROR_OK)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	/* FIFO of bus width words, plus read and write pointers */
+	while (target_alloc_working_area_try(target, fifo_size + 8, &fifo) != ERROR_OK) {
+		fifo_size /= 2;
+		if (fifo_size < 256) {
+			target_free_working_area(target, write_algorithm);
+			LOG_WARNING("not enough working area available, can't do async block writes");
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		}
+	}
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_IN_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);
+	init_reg_param(&reg_params[4], "r4", 32, PARAM_OUT);
+	init_reg_param(&reg_params[5], "r8", 32, PARAM_OUT);
+	init_reg_param(&reg_params[6], "r9", 32, PARAM_OUT);
+	init_reg_param(&reg_params[7], "r10", 32, PARAM_OUT);
+	init_reg_param(&reg_params[8], "r11", 32, PARAM_OUT);
+	init_reg_param(&reg_params[9], "r12", 32, PARAM_OUT);
+	init_reg_param(&reg_params[10], "lr", 32, PARAM_OUT);
+	init_reg_param(&reg_params[11], "sp", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, fifo->address);
+	buf_set_u32(reg_params[1].value, 0, 32, address);
+	buf_set_u32(reg_params[2].value, 0, 32, count / bank->bus_width);
+	buf_set_u32(reg_params[3].value, 0, 32, cfi_command_val(bank, 0xA0));
+	buf_set_u32(reg_params[4].value, 0, 32, cfi_command_val(bank, 0x80));
+	buf_set_u32(reg_params[5].value, 0, 32, cfi_flash_address(bank, 0, pri_ext->_unlock1));
+	buf_set_u32(reg_params[6].value, 0, 32, 0xaaaaaaaa);
+	buf_set_u32(reg_params[7].value, 0, 32, cfi_flash_address(bank, 0, pri_ext->_unlock2));
+	buf_set_u32(reg_params[8].value, 0, 32, 0x55555555);
+	buf_set_u32(reg_params[9].value, 0, 32, fifo->address + fifo->size);
+	/* DQ5 exceeded timing limit polling, if the chip supports it */
+	buf_set_u32(reg_params[10].value, 0, 32,
+			(cfi_info->status_poll_mask & (1 << 5)) ? cfi_command_val(bank, 0x20) : 0);
+	/* the loader does not use the stack, keep it pointing at valid RAM */
+	buf_set_u32(reg_params[11].value, 0, 32, fifo->address + fifo->size);
+
+	armv7m_algo.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_algo.core_mode = ARM_MODE_THREAD;
+
+	retval = target_run_flash_async_algorithm(target, buffer, count / bank->bus_width,
+			bank->bus_width,
+			0, NULL,
+			ARRAY_SIZE(reg_params), reg_params,
+			fifo->address, fifo->size,
+			write_algorithm->address, 0,
+			&armv7m_algo);
+	if (retval == ERROR_FLASH_OPERATION_FAILED)
+		LOG_ERROR("flash write failed at address 0x%" PRIx32,
+				buf_get_u32(reg_params[1].value, 0, 32));
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(reg_params); i++)
+		destroy_reg_param(&reg_params[i]);
+
+	target_free_working_area(target, fifo);
+	target_free_working_area(target, write_algorithm);
+
+	return retval;
+}
+
 static int cfi_spansion_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	uint32_t address, uint32_t count)
 {
@@ -1781,6 +1896,12 @@ static int cfi_spansion_write_block(struct flash_bank *bank, const uint8_t *buff
 	if (strncmp(target_type_name(target), "mips_m4k", 8) == 0)
 		return cfi_spansion_write_block_mips(bank, buffer, address, count);
 
+	if (is_armv7m(target_to_armv7m(target))) {
+		retval = cfi_spansion_write_block_async(bank, buffer, address, count);
+		if (retval != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+			return retval;
+	}
+
 	if (is_armv7m(target_to_armv7m(target))) {	/* armv7m target */
 		armv7m_algo.common_magic = ARMV7M_COMMON_MAGIC;
 		armv7m_algo.core_mode = ARM_MODE_THREAD;
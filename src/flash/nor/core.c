@@ -16,6 +16,7 @@
 #include <flash/nor/core.h>
 #include <flash/nor/imp.h>
 #include <target/image.h>
+#include <helper/time_support.h>
 
 /**
  * @file
@@ -26,11 +27,166 @@
 
 static struct flash_bank *flash_banks;
 
+/* The shadow of a bank is kept in chunks, each with a bit per block telling
+ * whether the block's content is known. Writes which cover a block only
+ * partially forget it instead of tracking bytes. */
+#define FLASH_SHADOW_CHUNK_SIZE		4096
+#define FLASH_SHADOW_BLOCK_SIZE		(FLASH_SHADOW_CHUNK_SIZE / 64)
+
+struct flash_shadow_chunk {
+	uint64_t valid;
+	uint8_t data[FLASH_SHADOW_CHUNK_SIZE];
+};
+
+static void flash_shadow_free(struct flash_bank *bank)
+{
+	if (!bank->shadow)
+		return;
+
+	for (uint32_t i = 0; i < DIV_ROUND_UP(bank->shadow_size, FLASH_SHADOW_CHUNK_SIZE); i++)
+		free(bank->shadow[i]);
+	free(bank->shadow);
+	bank->shadow = NULL;
+	bank->shadow_size = 0;
+}
+
+/* a shadow allocated before the bank was (re)probed is useless */
+static bool flash_shadow_usable(struct flash_bank *bank)
+{
+	if (bank->shadow && bank->shadow_size != bank->size)
+		flash_shadow_free(bank);
+	return bank->shadow;
+}
+
+static void flash_shadow_invalidate(struct flash_bank *bank, uint32_t offset, uint32_t count)
+{
+	if (!flash_shadow_usable(bank) || !count || offset >= bank->shadow_size)
+		return;
+
+	uint32_t end = offset + MIN(count, bank->shadow_size - offset);
+	for (uint32_t block = offset / FLASH_SHADOW_BLOCK_SIZE;
+			block <= (end - 1) / FLASH_SHADOW_BLOCK_SIZE; block++) {
+		struct flash_shadow_chunk *chunk = bank->shadow[block / 64];
+		if (chunk)
+			chunk->valid &= ~(1ULL << (block % 64));
+	}
+}
+
+/* remember data known to be in flash now, whole blocks only */
+static void flash_shadow_update(struct flash_bank *bank, const uint8_t *buffer,
+	uint32_t offset, uint32_t count)
+{
+	if (!bank->shadow_enabled || !count || offset >= bank->size)
+		return;
+
+	if (!flash_shadow_usable(bank)) {
+		bank->shadow = calloc(DIV_ROUND_UP(bank->size, FLASH_SHADOW_CHUNK_SIZE),
+			sizeof(*bank->shadow));
+		if (!bank->shadow)
+			return;
+		bank->shadow_size = bank->size;
+	}
+
+	uint32_t end = offset + MIN(count, bank->shadow_size - offset);
+	uint32_t pos = offset;
+	while (pos < end) {
+		uint32_t block = pos / FLASH_SHADOW_BLOCK_SIZE;
+		uint32_t block_start = block * FLASH_SHADOW_BLOCK_SIZE;
+		uint32_t block_end = MIN(block_start + FLASH_SHADOW_BLOCK_SIZE, bank->shadow_size);
+		struct flash_shadow_chunk **chunk = &bank->shadow[block / 64];
+		uint64_t bit = 1ULL << (block % 64);
+
+		if (pos == block_start && end >= block_end) {
+			if (!*chunk)
+				*chunk = calloc(1, sizeof(**chunk));
+			if (*chunk) {
+				memcpy((*chunk)->data + block_start % FLASH_SHADOW_CHUNK_SIZE,
+					buffer + (block_start - offset), block_end - block_start);
+				(*chunk)->valid |= bit;
+			}
+		} else if (*chunk) {
+			(*chunk)->valid &= ~bit;
+		}
+		pos = block_end;
+	}
+}
+
+bool flash_shadow_read(struct target *target, target_addr_t address,
+	uint32_t size, uint8_t *buffer)
+{
+	if (!size)
+		return false;
+
+	for (struct flash_bank *bank = flash_banks; bank; bank = bank->next) {
+		if (bank->target != target || address < bank->base ||
+				address - bank->base >= bank->size)
+			continue;
+
+		uint32_t offset = address - bank->base;
+		if (!flash_shadow_usable(bank) || size > bank->shadow_size - offset)
+			return false;
+
+		for (uint32_t block = offset / FLASH_SHADOW_BLOCK_SIZE;
+				block <= (offset + size - 1) / FLASH_SHADOW_BLOCK_SIZE; block++) {
+			struct flash_shadow_chunk *chunk = bank->shadow[block / 64];
+			if (!chunk || !(chunk->valid & (1ULL << (block % 64))))
+				return false;
+		}
+
+		while (size) {
+			struct flash_shadow_chunk *chunk = bank->shadow[offset / FLASH_SHADOW_CHUNK_SIZE];
+			uint32_t in_chunk = offset % FLASH_SHADOW_CHUNK_SIZE;
+			uint32_t n = MIN(size, FLASH_SHADOW_CHUNK_SIZE - in_chunk);
+			memcpy(buffer, chunk->data + in_chunk, n);
+			buffer += n;
+			offset += n;
+			size -= n;
+		}
+		return true;
+	}
+
+	return false;
+}
+
+void flash_shadow_invalidate_range(struct target *target, target_addr_t address,
+	uint32_t size)
+{
+	for (struct flash_bank *bank = flash_banks; bank; bank = bank->next) {
+		if (bank->target != target || !bank->shadow)
+			continue;
+
+		if (!size) {
+			flash_shadow_free(bank);
+			continue;
+		}
+
+		target_addr_t start = MAX(address, bank->base);
+		target_addr_t end = MIN(address + size - 1, bank->base + bank->size - 1);
+		if (start <= end)
+			flash_shadow_invalidate(bank, start - bank->base, end - start + 1);
+	}
+}
+
+/* forget the shadow of a range of sectors */
+static void flash_shadow_invalidate_sectors(struct flash_bank *bank, unsigned int first,
+	unsigned int last)
+{
+	if (!bank->sectors || last >= bank->num_sectors || first > last) {
+		flash_shadow_free(bank);
+		return;
+	}
+
+	uint32_t start = bank->sectors[first].offset;
+	uint32_t end = bank->sectors[last].offset + bank->sectors[last].size;
+	flash_shadow_invalidate(bank, start, end - start);
+}
+
 int flash_driver_erase(struct flash_bank *bank, unsigned int first,
 		unsigned int last)
 {
 	int retval;
 
+	flash_shadow_invalidate_sectors(bank, first, last);
 	retval = bank->driver->erase(bank, first, last);
 	if (retval != ERROR_OK)
 		LOG_ERROR("failed erasing sectors %u to %u", first, last);
@@ -75,6 +231,7 @@ int flash_driver_protect(struct flash_bank *bank, int set, unsigned int first,
 	 *
 	 * Drivers only receive valid protection block range.
 	 */
+	flash_shadow_free(bank);
 	retval = bank->driver->protect(bank, set, first, last);
 	if (retval != ERROR_OK)
 		LOG_ERROR("failed setting protection for blocks %u to %u", first, last);
@@ -87,6 +244,7 @@ int flash_driver_write(struct flash_bank *bank,
 {
 	int retval;
 
+	flash_shadow_invalidate(bank, offset, count);
 	retval = bank->driver->write(bank, buffer, offset, count);
 	if (retval != ERROR_OK) {
 		LOG_ERROR(
@@ -94,6 +252,8 @@ int flash_driver_write(struct flash_bank *bank,
 			" at offset 0x%8.8" PRIx32,
 			bank->base,
 			offset);
+	} else {
+		flash_shadow_update(bank, buffer, offset, count);
 	}
 
 	return retval;
@@ -134,6 +294,8 @@ int flash_driver_verify(struct flash_bank *bank,
 	if (retval != ERROR_OK) {
 		LOG_ERROR("verify failed in bank at " TARGET_ADDR_FMT " starting at 0x%8.8" PRIx32,
 			bank->base, offset);
+	} else {
+		flash_shadow_update(bank, buffer, offset, count);
 	}
 
 	return retval;
@@ -161,6 +323,24 @@ int default_flash_verify(struct flash_bank *bank,
 		return ERROR_FAIL;
 }
 
+int default_flash_checksum(struct flash_bank *bank,
+	uint32_t offset, uint32_t count, uint32_t *crc)
+{
+	return target_checksum_memory(bank->target, offset + bank->base, count, crc);
+}
+
+int flash_driver_checksum(struct flash_bank *bank,
+	uint32_t offset, uint32_t count, uint32_t *crc)
+{
+	if (!bank->driver->checksum)
+		return ERROR_FLASH_OPER_UNSUPPORTED;
+
+	if (offset > bank->size || count > bank->size - offset)
+		return ERROR_FLASH_DST_OUT_OF_BANK;
+
+	return bank->driver->checksum(bank, offset, count, crc);
+}
+
 void flash_bank_add(struct flash_bank *bank)
 {
 	/* put flash bank in linked list */
@@ -232,6 +412,7 @@ void flash_free_all_banks(void)
 			free(bank->sectors);
 			free(bank->prot_blocks);
 		}
+		flash_shadow_free(bank);
 
 		free(bank->name);
 		free(bank);
@@ -333,8 +514,7 @@ int get_flash_bank_by_addr(struct target *target,
 static int default_flash_mem_blank_check(struct flash_bank *bank)
 {
 	struct target *target = bank->target;
-	const int buffer_size = 1024;
-	uint32_t n_bytes;
+	const int buffer_size = 16384;
 	int retval = ERROR_OK;
 
 	if (bank->target->state != TARGET_HALTED) {
@@ -343,12 +523,21 @@ static int default_flash_mem_blank_check(struct flash_bank *bank)
 	}
 
 	uint8_t *buffer = malloc(buffer_size);
+	/* reference content; memcmp() is much faster than a byte loop */
+	uint8_t *erased = malloc(buffer_size);
+	if (!buffer || !erased) {
+		LOG_ERROR("Out of memory");
+		retval = ERROR_FAIL;
+		goto done;
+	}
+	memset(erased, bank->erased_value, buffer_size);
 
 	for (unsigned int i = 0; i < bank->num_sectors; i++) {
 		uint32_t j;
 		bank->sectors[i].is_erased = 1;
 
-		for (j = 0; j < bank->sectors[i].size; j += buffer_size) {
+		/* stop reading the sector at the first programmed chunk */
+		for (j = 0; j < bank->sectors[i].size && bank->sectors[i].is_erased; j += buffer_size) {
 			uint32_t chunk;
 			chunk = buffer_size;
 			if (chunk > (bank->sectors[i].size - j))
@@ -362,16 +551,14 @@ static int default_flash_mem_blank_check(struct flash_bank *bank)
 			if (retval != ERROR_OK)
 				goto done;
 
-			for (n_bytes = 0; n_bytes < chunk; n_bytes++) {
-				if (buffer[n_bytes] != bank->erased_value) {
-					bank->sectors[i].is_erased = 0;
-					break;
-				}
-			}
+			if (memcmp(buffer, erased, chunk & ~3u))
+				bank->sectors[i].is_erased = 0;
 		}
+		keep_alive();
 	}
 
 done:
+	free(erased);
 	free(buffer);
 
 	return retval;
@@ -727,8 +914,386 @@ static bool flash_write_check_gap(struct flash_bank *bank,
 }
 
 
+/* unlock, erase, write and verify one contiguous run of a bank */
+static int flash_write_run(struct target *target, struct flash_bank *c,
+	const uint8_t *buffer, target_addr_t run_address, uint32_t run_size,
+	bool erase, bool unlock, bool write, bool verify)
+{
+	int retval = ERROR_OK;
+
+	if (unlock)
+		retval = flash_unlock_address_range(target, run_address, run_size);
+	if (retval == ERROR_OK) {
+		if (erase) {
+			/* calculate and erase sectors */
+			retval = flash_erase_address_range(target,
+					true, run_address, run_size);
+		}
+	}
+
+	if (retval == ERROR_OK) {
+		if (write) {
+			/* write flash sectors */
+			retval = flash_driver_write(c, buffer, run_address - c->base, run_size);
+		}
+	}
+
+	if (retval == ERROR_OK) {
+		if (verify) {
+			/* verify flash sectors */
+			retval = flash_driver_verify(c, buffer, run_address - c->base, run_size);
+		}
+	}
+
+	return retval;
+}
+
+static bool flash_run_matches(struct flash_bank *c, const uint8_t *buffer,
+	target_addr_t address, uint32_t size)
+{
+	uint32_t target_crc, image_crc;
+
+	if (image_calculate_checksum(buffer, size, &image_crc) != ERROR_OK)
+		return false;
+	int retval = flash_driver_checksum(c, address - c->base, size, &target_crc);
+	if (retval == ERROR_FLASH_OPER_UNSUPPORTED)
+		retval = target_checksum_memory(c->target, address, size, &target_crc);
+	/* banks which can't be checksummed are just written */
+	if (retval != ERROR_OK)
+		return false;
+
+	return target_crc == image_crc;
+}
+
+/* Like flash_write_run(), but first compare the CRC of each sector of the
+ * run on the target with the image and only erase and write the sectors
+ * which differ, merged to contiguous runs. The whole run is checked first
+ * so an unchanged run costs a single checksum. */
+static int flash_write_run_diff(struct target *target, struct flash_bank *c,
+	const uint8_t *buffer, target_addr_t run_address, uint32_t run_size,
+	bool erase, bool unlock, bool verify, uint32_t *written)
+{
+	*written = 0;
+
+	if (flash_run_matches(c, buffer, run_address, run_size)) {
+		LOG_INFO("flash at " TARGET_ADDR_FMT " (%" PRIu32 " bytes) unchanged, skipped",
+			run_address, run_size);
+		return ERROR_OK;
+	}
+
+	uint32_t run_offset = run_address - c->base;
+	uint32_t run_end = run_offset + run_size;
+	uint32_t dirty_start = 0, dirty_end = 0;
+	unsigned int skipped = 0, total = 0;
+	int retval = ERROR_OK;
+
+	for (unsigned int sector = 0; sector <= c->num_sectors && retval == ERROR_OK; sector++) {
+		uint32_t start = run_end, end = run_end;
+		if (sector < c->num_sectors) {
+			start = MAX(c->sectors[sector].offset, run_offset);
+			end = MIN(c->sectors[sector].offset + c->sectors[sector].size, run_end);
+			if (start >= end)
+				continue;
+			total++;
+			if (!flash_run_matches(c, buffer + start - run_offset, c->base + start,
+					end - start)) {
+				/* extend the pending run of differing sectors */
+				if (dirty_start == dirty_end)
+					dirty_start = start;
+				dirty_end = end;
+				continue;
+			}
+			skipped++;
+		}
+
+		if (dirty_start != dirty_end) {
+			retval = flash_write_run(target, c, buffer + dirty_start - run_offset,
+				c->base + dirty_start, dirty_end - dirty_start,
+				erase, unlock, true, verify);
+			*written += dirty_end - dirty_start;
+			dirty_start = dirty_end = 0;
+		}
+	}
+
+	/* a bank without sector list is compared as a whole */
+	if (retval == ERROR_OK && total == 0) {
+		retval = flash_write_run(target, c, buffer, run_address, run_size,
+			erase, unlock, true, verify);
+		*written = run_size;
+	}
+
+	if (skipped)
+		LOG_INFO("%u of %u sectors at " TARGET_ADDR_FMT " unchanged, skipped",
+			skipped, total, run_address);
+
+	return retval;
+}
+
+/* a contiguous part of the image in one bank, collected before writing */
+struct flash_write_region {
+	struct flash_bank *bank;
+	uint8_t *buffer;
+	target_addr_t address;
+	uint32_t size;
+	/* background erase of the sectors next_sector..last_sector, see
+	 * erase_start() */
+	bool erase_ahead;
+	bool erase_pending;
+	bool erase_active;
+	unsigned int next_sector;
+	unsigned int last_sector;
+	int64_t erase_start_ms;
+	/* gap of a sparse image, only erased */
+	bool erase_only;
+	/* region has been written */
+	bool done;
+};
+
+/* upper bound for a single background sector erase */
+#define FLASH_ERASE_SECTOR_TIMEOUT_MS	10000
+
+/* A bank can only start erasing a region's sectors when no other erase
+ * is running in it and all earlier regions of the bank have been written,
+ * as a bank can't be erased while it is being programmed. */
+static bool flash_bank_in_use(struct flash_write_region *regions,
+	unsigned int count, unsigned int region)
+{
+	for (unsigned int i = 0; i < count; i++) {
+		if (regions[i].bank != regions[region].bank)
+			continue;
+		if (regions[i].erase_active || (i < region && !regions[i].done))
+			return true;
+	}
+	return false;
+}
+
+/* Advance the background erases of all regions: collect completed sector
+ * erases and start the next sector of each bank which became idle. Banks
+ * erase one sector at a time, regions of the same bank take turns. */
+static int flash_erase_regions_poll(struct flash_write_region *regions,
+	unsigned int count, bool start_new)
+{
+	int retval = ERROR_OK;
+
+	for (unsigned int i = 0; i < count; i++) {
+		struct flash_write_region *r = &regions[i];
+		if (!r->erase_active)
+			continue;
+
+		bool busy;
+		int result = r->bank->driver->busy(r->bank, &busy);
+		if (result == ERROR_OK && busy) {
+			if (timeval_ms() - r->erase_start_ms < FLASH_ERASE_SECTOR_TIMEOUT_MS)
+				continue;
+			LOG_ERROR("timeout erasing sector %u of bank %s",
+				r->next_sector - 1, r->bank->name);
+			result = ERROR_FLASH_OPERATION_FAILED;
+		}
+
+		r->erase_active = false;
+		if (result != ERROR_OK) {
+			LOG_ERROR("failed erasing sector %u of bank %s",
+				r->next_sector - 1, r->bank->name);
+			r->erase_pending = false;
+			if (retval == ERROR_OK)
+				retval = result;
+			continue;
+		}
+		if (r->next_sector > r->last_sector)
+			r->erase_pending = false;
+	}
+
+	if (!start_new || retval != ERROR_OK)
+		return retval;
+
+	for (unsigned int i = 0; i < count; i++) {
+		struct flash_write_region *r = &regions[i];
+		if (!r->erase_pending || r->erase_active ||
+				flash_bank_in_use(regions, count, i))
+			continue;
+
+		LOG_DEBUG("start erasing sector %u of bank %s", r->next_sector, r->bank->name);
+		flash_shadow_invalidate_sectors(r->bank, r->next_sector, r->next_sector);
+		retval = r->bank->driver->erase_start(r->bank, r->next_sector);
+		if (retval != ERROR_OK) {
+			r->erase_pending = false;
+			return retval;
+		}
+		r->next_sector++;
+		r->erase_active = true;
+		r->erase_start_ms = timeval_ms();
+	}
+
+	return ERROR_OK;
+}
+
+/* keep the background erases going until the region has been erased */
+static int flash_erase_region_wait(struct flash_write_region *regions,
+	unsigned int count, struct flash_write_region *region)
+{
+	while (region->erase_pending) {
+		int retval = flash_erase_regions_poll(regions, count, true);
+		if (retval != ERROR_OK)
+			return retval;
+		if (region->erase_pending)
+			alive_sleep(1);
+	}
+
+	return ERROR_OK;
+}
+
+/* let started sector erases complete before bailing out */
+static void flash_erase_regions_abort(struct flash_write_region *regions,
+	unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++) {
+		while (regions[i].erase_active) {
+			flash_erase_regions_poll(regions, count, false);
+			if (regions[i].erase_active)
+				alive_sleep(1);
+		}
+	}
+}
+
+/* set up the background erase of the sectors covering the region */
+static bool flash_erase_region_prepare(struct flash_write_region *r)
+{
+	struct flash_bank *c = r->bank;
+	uint32_t offset = r->address - c->base;
+	uint32_t last_offset = offset + r->size - 1;
+	bool found = false;
+
+	if (!c->driver->erase_start || !c->driver->busy)
+		return false;
+
+	for (unsigned int sector = 0; sector < c->num_sectors; sector++) {
+		uint32_t start = c->sectors[sector].offset;
+		uint32_t end = start + c->sectors[sector].size - 1;
+		if (end < offset || start > last_offset)
+			continue;
+		if (!found) {
+			if (start < offset)
+				LOG_WARNING("Adding extra erase range, " TARGET_ADDR_FMT " .. " TARGET_ADDR_FMT,
+					c->base + start, r->address - 1);
+			r->next_sector = sector;
+			found = true;
+		}
+		r->last_sector = sector;
+	}
+	r->erase_ahead = found;
+	r->erase_pending = found;
+
+	return found;
+}
+
+/* Unlock, erase, write and verify the collected regions. With erase, the
+ * sectors of banks supporting background erase are erased ahead while
+ * earlier regions are still being programmed, so erases of independent
+ * banks overlap with each other and with programming. */
+static int flash_write_regions(struct target *target,
+	struct flash_write_region *regions, unsigned int count, uint32_t *written,
+	bool erase, bool unlock, bool write, bool verify, bool skip_unchanged)
+{
+	int retval = ERROR_OK;
+	bool overlap = false;
+
+	if (erase && write && !skip_unchanged) {
+		for (unsigned int i = 0; i < count && retval == ERROR_OK; i++) {
+			struct flash_write_region *r = &regions[i];
+			if (!flash_erase_region_prepare(r))
+				continue;
+			overlap = true;
+			if (unlock)
+				retval = flash_unlock_address_range(target, r->address, r->size);
+		}
+		if (retval == ERROR_OK && overlap)
+			retval = flash_erase_regions_poll(regions, count, true);
+	}
+
+	for (unsigned int i = 0; i < count && retval == ERROR_OK; i++) {
+		struct flash_write_region *r = &regions[i];
+		uint32_t region_written = r->size;
+		bool erased_ahead = r->erase_ahead;
+
+		if (erased_ahead)
+			retval = flash_erase_region_wait(regions, count, r);
+		if (retval != ERROR_OK)
+			break;
+
+		if (r->erase_only) {
+			if (!erased_ahead)
+				retval = flash_write_run(target, r->bank, NULL, r->address, r->size,
+					erase, unlock, false, false);
+			region_written = 0;
+		} else if (skip_unchanged && write)
+			retval = flash_write_run_diff(target, r->bank, r->buffer, r->address, r->size,
+				erase, unlock, verify, &region_written);
+		else if (erased_ahead)
+			retval = flash_write_run(target, r->bank, r->buffer, r->address, r->size,
+				false, false, write, verify);
+		else
+			retval = flash_write_run(target, r->bank, r->buffer, r->address, r->size,
+				erase, unlock, write, verify);
+
+		r->done = true;
+		if (retval == ERROR_OK && written)
+			*written += region_written;	/* add run size to total written counter */
+
+		/* start erasing the next sectors of banks which became idle */
+		if (retval == ERROR_OK && overlap)
+			retval = flash_erase_regions_poll(regions, count, true);
+	}
+
+	if (overlap)
+		flash_erase_regions_abort(regions, count);
+
+	return retval;
+}
+
+/* Add an erase only region for the sectors entirely within the gap
+ * [start, end) between two sections of a sparse image. Sectors shared
+ * with the data around it are erased by the data regions. */
+static int flash_write_add_hole(struct flash_bank *c, struct flash_write_region **regions,
+	unsigned int *num_regions, target_addr_t start, target_addr_t end)
+{
+	uint32_t offset = start - c->base;
+	uint32_t end_offset = end - c->base;
+	uint32_t first = 0, last = 0;
+
+	for (unsigned int sector = 0; sector < c->num_sectors; sector++) {
+		uint32_t s_start = c->sectors[sector].offset;
+		uint32_t s_end = s_start + c->sectors[sector].size;
+		if (s_start < offset || s_end > end_offset)
+			continue;
+		if (first == last)
+			first = s_start;
+		last = s_end;
+	}
+	if (first == last)
+		return ERROR_OK;
+
+	struct flash_write_region *r = realloc(*regions, (*num_regions + 1) * sizeof(*r));
+	if (!r) {
+		LOG_ERROR("Out of memory for flash bank buffer");
+		return ERROR_FAIL;
+	}
+	*regions = r;
+	r = &r[(*num_regions)++];
+	memset(r, 0, sizeof(*r));
+	r->bank = c;
+	r->address = c->base + first;
+	r->size = last - first;
+	r->erase_only = true;
+
+	LOG_DEBUG("erasing gap of sparse image at " TARGET_ADDR_FMT " (%" PRIu32 " bytes)",
+		r->address, r->size);
+
+	return ERROR_OK;
+}
+
 int flash_write_unlock_verify(struct target *target, struct image *image,
-	uint32_t *written, bool erase, bool unlock, bool write, bool verify)
+	uint32_t *written, bool erase, bool unlock, bool write, bool verify,
+	bool skip_unchanged)
 {
 	int retval = ERROR_OK;
 
@@ -753,6 +1318,9 @@ int flash_write_unlock_verify(struct target *target, struct image *image,
 	/* allocate padding array */
 	padding = calloc(image->num_sections, sizeof(*padding));
 
+	struct flash_write_region *regions = NULL;
+	unsigned int num_regions = 0;
+
 	/* This fn requires all sections to be in ascending order of addresses,
 	 * whereas an image can have sections out of order. */
 	struct imagesection **sections = malloc(sizeof(struct imagesection *) *
@@ -772,6 +1340,7 @@ int flash_write_unlock_verify(struct target *target, struct image *image,
 		target_addr_t run_address = sections[section]->base_address + section_offset;
 		uint32_t run_size = sections[section]->size - section_offset;
 		int pad_bytes = 0;
+		target_addr_t hole_start = 0, hole_end = 0;
 
 		if (sections[section]->size ==  0) {
 			LOG_WARNING("empty section %d", section);
@@ -823,6 +1392,12 @@ int flash_write_unlock_verify(struct target *target, struct image *image,
 					LOG_INFO("Flash write discontinued at " TARGET_ADDR_FMT
 						", next section at " TARGET_ADDR_FMT,
 						run_next_addr, next_section_base);
+					/* a gap of a sparse image is erased content of the image */
+					if (erase && (sections[section_last]->flags & IMAGE_SECTION_SPARSE)
+							&& (sections[section_last + 1]->flags & IMAGE_SECTION_SPARSE)) {
+						hole_start = run_next_addr;
+						hole_end = next_section_base;
+					}
 					break;
 				}
 			}
@@ -949,44 +1524,35 @@ int flash_write_unlock_verify(struct target *target, struct image *image,
 			}
 		}
 
-		retval = ERROR_OK;
-
-		if (unlock)
-			retval = flash_unlock_address_range(target, run_address, run_size);
-		if (retval == ERROR_OK) {
-			if (erase) {
-				/* calculate and erase sectors */
-				retval = flash_erase_address_range(target,
-						true, run_address, run_size);
-			}
-		}
-
-		if (retval == ERROR_OK) {
-			if (write) {
-				/* write flash sectors */
-				retval = flash_driver_write(c, buffer, run_address - c->base, run_size);
-			}
-		}
-
-		if (retval == ERROR_OK) {
-			if (verify) {
-				/* verify flash sectors */
-				retval = flash_driver_verify(c, buffer, run_address - c->base, run_size);
-			}
-		}
-
-		free(buffer);
-
-		if (retval != ERROR_OK) {
-			/* abort operation */
+		struct flash_write_region *r = realloc(regions, (num_regions + 1) * sizeof(*regions));
+		if (!r) {
+			LOG_ERROR("Out of memory for flash bank buffer");
+			free(buffer);
+			retval = ERROR_FAIL;
 			goto done;
 		}
-
-		if (written)
-			*written += run_size;	/* add run size to total written counter */
+		regions = r;
+		memset(&regions[num_regions], 0, sizeof(*regions));
+		regions[num_regions].bank = c;
+		regions[num_regions].buffer = buffer;
+		regions[num_regions].address = run_address;
+		regions[num_regions].size = run_size;
+		num_regions++;
+
+		if (hole_start != hole_end) {
+			retval = flash_write_add_hole(c, &regions, &num_regions, hole_start, hole_end);
+			if (retval != ERROR_OK)
+				goto done;
+		}
 	}
 
+	retval = flash_write_regions(target, regions, num_regions, written,
+		erase, unlock, write, verify, skip_unchanged);
+
 done:
+	for (unsigned int i = 0; i < num_regions; i++)
+		free(regions[i].buffer);
+	free(regions);
 	free(sections);
 	free(padding);
 
@@ -996,7 +1562,8 @@ done:
 int flash_write(struct target *target, struct image *image,
 	uint32_t *written, bool erase)
 {
-	return flash_write_unlock_verify(target, image, written, erase, false, true, false);
+	return flash_write_unlock_verify(target, image, written, erase, false, true, false,
+		false);
 }
 
 struct flash_sector *alloc_block_array(uint32_t offset, uint32_t size,
@@ -125,6 +125,14 @@ struct flash_bank {
 	/** Array of protection blocks, allocated and initialized by the flash driver */
 	struct flash_sector *prot_blocks;
 
+	/** Keep a host copy of contents written or verified through the flash
+	 * layer, see flash_shadow_read(). Off by default. */
+	bool shadow_enabled;
+	/** Bank size the shadow was allocated for, 0 without shadow */
+	uint32_t shadow_size;
+	/** Shadow chunks, allocated on demand */
+	struct flash_shadow_chunk **shadow;
+
 	struct flash_bank *next; /**< The next flash bank on this chip */
 };
 
@@ -188,6 +196,26 @@ void default_flash_free_driver_priv(struct flash_bank *bank);
 /** Deallocates all flash banks */
 void flash_free_all_banks(void);
 
+/**
+ * Serve a read of flash from the host copy kept for banks with
+ * shadow_enabled, without target access.
+ * @param target The target the range belongs to.
+ * @param address The start address of the range.
+ * @param size The number of bytes to read.
+ * @param buffer Receives the data.
+ * @returns true if the whole range was known and copied to @a buffer.
+ */
+bool flash_shadow_read(struct target *target, target_addr_t address,
+		uint32_t size, uint8_t *buffer);
+
+/**
+ * Forget the host copy of any flash overlapping a range, of all flash of
+ * the target if @a size is 0.  Called when target memory is written
+ * behind the flash layer.
+ */
+void flash_shadow_invalidate_range(struct target *target, target_addr_t address,
+		uint32_t size);
+
 /**
  * Provides default read implementation for flash memory.
  * @param bank The bank to read.
@@ -210,6 +238,18 @@ int default_flash_read(struct flash_bank *bank,
 int default_flash_verify(struct flash_bank *bank,
 		const uint8_t *buffer, uint32_t offset, uint32_t count);
 
+/**
+ * Provides default checksum implementation for memory mapped flash,
+ * running the target's checksum algorithm on the mapped range.
+ * @param bank The bank to checksum.
+ * @param offset The offset into the chip to start at.
+ * @param count The number of bytes to checksum.
+ * @param crc Receives the CRC32 of the range.
+ * @returns ERROR_OK if successful; otherwise, an error code.
+ */
+int default_flash_checksum(struct flash_bank *bank,
+		uint32_t offset, uint32_t count, uint32_t *crc);
+
 /**
  * Provides default erased-bank check handling. Checks to see if
  * the flash driver knows they are erased; if things look uncertain,
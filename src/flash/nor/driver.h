@@ -96,6 +96,30 @@ struct flash_driver {
 	int (*erase)(struct flash_bank *bank, unsigned int first,
 		unsigned int last);
 
+	/**
+	 * Start erasing a single sector and return without waiting for
+	 * completion, so flash_write_unlock_verify() can overlap erases of
+	 * this bank with operations on other banks.  Only implement this
+	 * for banks which can be erased and programmed independently of
+	 * each other.  Optional, requires busy().
+	 *
+	 * @param bank The bank of flash to be erased.
+	 * @param sector The sector to erase.
+	 * @returns ERROR_OK if the erase was started; otherwise, an error code.
+	 */
+	int (*erase_start)(struct flash_bank *bank, unsigned int sector);
+
+	/**
+	 * Check whether the erase started by erase_start() is still in
+	 * progress.  Once it has completed, the driver cleans up and
+	 * reports whether the erase failed.
+	 *
+	 * @param bank The bank of flash being erased.
+	 * @param busy Set to true while the erase is in progress.
+	 * @returns ERROR_OK if successful; otherwise, an error code.
+	 */
+	int (*busy)(struct flash_bank *bank, bool *busy);
+
 	/**
 	 * Bank/sector protection routine (target-specific).
 	 *
@@ -158,6 +182,21 @@ struct flash_driver {
 	int (*verify)(struct flash_bank *bank,
 			const uint8_t *buffer, uint32_t offset, uint32_t count);
 
+	/**
+	 * Compute the CRC32 of a range of flash on the target, the same
+	 * CRC as image_calculate_checksum(), so "flash verify_bank" needs
+	 * to transfer no flash contents.  Optional; memory mapped banks
+	 * can use default_flash_checksum().
+	 *
+	 * @param bank The bank to checksum.
+	 * @param offset The offset into the chip to start at.
+	 * @param count The number of bytes to checksum.
+	 * @param crc Receives the CRC32 of the range.
+	 * @returns ERROR_OK if successful; otherwise, an error code.
+	 */
+	int (*checksum)(struct flash_bank *bank,
+			uint32_t offset, uint32_t count, uint32_t *crc);
+
 	/**
 	 * Probe to determine what kind of flash is present.
 	 * This is invoked by the "probe" script command.
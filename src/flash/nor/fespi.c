@@ -854,6 +854,7 @@ const struct flash_driver fespi_flash = {
 	.protect = fespi_protect,
 	.write = fespi_write,
 	.read = default_flash_read,
+	.checksum = default_flash_checksum,
 	.probe = fespi_probe,
 	.auto_probe = fespi_auto_probe,
 	.erase_check = default_flash_blank_check,
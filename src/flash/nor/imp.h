@@ -36,9 +36,15 @@ int flash_driver_read(struct flash_bank *bank,
 		uint8_t *buffer, uint32_t offset, uint32_t count);
 int flash_driver_verify(struct flash_bank *bank,
 		const uint8_t *buffer, uint32_t offset, uint32_t count);
+/* CRC32 of a range of flash computed on the target, ERROR_FLASH_OPER_UNSUPPORTED
+ * if the driver can't do that */
+int flash_driver_checksum(struct flash_bank *bank,
+		uint32_t offset, uint32_t count, uint32_t *crc);
 
-/* write (optional verify) an image to flash memory of the given target */
+/* write (optional verify) an image to flash memory of the given target,
+ * with skip_unchanged only the sectors whose content differs are erased and written */
 int flash_write_unlock_verify(struct target *target, struct image *image,
-		uint32_t *written, bool erase, bool unlock, bool write, bool verify);
+		uint32_t *written, bool erase, bool unlock, bool write, bool verify,
+		bool skip_unchanged);
 
 #endif /* OPENOCD_FLASH_NOR_IMP_H */
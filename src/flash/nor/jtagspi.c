@@ -15,6 +15,8 @@
 #include <pld/pld.h>
 
 #define JTAGSPI_MAX_TIMEOUT 3000
+/* status reads queued per JTAG queue flush while polling for WIP */
+#define JTAGSPI_STATUS_BATCH 16
 
 
 struct jtagspi_flash_bank {
@@ -99,7 +101,9 @@ static void flip_u8(const uint8_t *in, uint8_t *out, unsigned int len)
 		out[i] = flip_u32(in[i], 8);
 }
 
-static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
+/* Queue one SPI transaction as a DR scan, without flushing the JTAG queue.
+ * Read data lands in data_buffer bit reversed, see jtagspi_cmd() */
+static int jtagspi_queue_cmd(struct flash_bank *bank, uint8_t cmd,
 		uint8_t *write_buffer, unsigned int write_len, uint8_t *data_buffer, int data_len)
 {
 	assert(write_buffer || write_len == 0);
@@ -184,28 +188,53 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 		n++;
 	}
 
-	if (info->pld_device) {
-		int retval = pld_connect_spi_to_jtag(info->pld_device);
-		if (retval != ERROR_OK)
-			return retval;
-	} else {
-		jtagspi_set_user_ir(info);
-	}
-
 	/* passing from an IR scan to SHIFT-DR clears BYPASS registers */
 	jtag_add_dr_scan(info->tap, n, fields, TAP_IDLE);
-	int retval = jtag_execute_queue();
-	if (retval != ERROR_OK)
-		return retval;
+	return ERROR_OK;
+}
 
-	if (is_read)
-		flip_u8(data_buffer, data_buffer, data_len);
+/* route JTAG DR scans to the SPI flash, either by the PLD's own instruction
+ * or by the USER instruction of the proxy bitstream */
+static int jtagspi_connect(struct jtagspi_flash_bank *info)
+{
+	if (info->pld_device)
+		return pld_connect_spi_to_jtag(info->pld_device);
+
+	jtagspi_set_user_ir(info);
+	return ERROR_OK;
+}
 
+static int jtagspi_disconnect(struct jtagspi_flash_bank *info)
+{
 	if (info->pld_device)
 		return pld_disconnect_spi_from_jtag(info->pld_device);
 	return ERROR_OK;
 }
 
+static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
+		uint8_t *write_buffer, unsigned int write_len, uint8_t *data_buffer, int data_len)
+{
+	struct jtagspi_flash_bank *info = bank->driver_priv;
+
+	int retval = jtagspi_connect(info);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = jtagspi_queue_cmd(bank, cmd, write_buffer, write_len, data_buffer, data_len);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* negative data_len == read operation */
+	if (data_len < 0)
+		flip_u8(data_buffer, data_buffer, -data_len);
+
+	return jtagspi_disconnect(info);
+}
+
 COMMAND_HANDLER(jtagspi_handle_set)
 {
 	struct flash_bank *bank = NULL;
@@ -514,15 +543,37 @@ static int jtagspi_auto_probe(struct flash_bank *bank)
 	return jtagspi_probe(bank);
 }
 
-static int jtagspi_read_status(struct flash_bank *bank, uint32_t *status)
+/* queue JTAGSPI_STATUS_BATCH status reads, flush them at once and find
+ * out whether any of them saw the device idle */
+static int jtagspi_poll_status(struct flash_bank *bank, bool *idle)
 {
-	uint8_t buf;
-	int err = jtagspi_cmd(bank, SPIFLASH_READ_STATUS, NULL, 0, &buf, -1);
-	if (err == ERROR_OK) {
-		*status = buf;
-		LOG_DEBUG("status=0x%02" PRIx32, *status);
+	struct jtagspi_flash_bank *info = bank->driver_priv;
+	uint8_t status[JTAGSPI_STATUS_BATCH];
+
+	int retval = jtagspi_connect(info);
+	if (retval != ERROR_OK)
+		return retval;
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(status); i++) {
+		retval = jtagspi_queue_cmd(bank, SPIFLASH_READ_STATUS, NULL, 0, &status[i], -1);
+		if (retval != ERROR_OK)
+			return retval;
 	}
-	return err;
+
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		return retval;
+
+	flip_u8(status, status, sizeof(status));
+	*idle = false;
+	for (unsigned int i = 0; i < ARRAY_SIZE(status); i++) {
+		if ((status[i] & SPIFLASH_BSY_BIT) == 0) {
+			*idle = true;
+			break;
+		}
+	}
+
+	return jtagspi_disconnect(info);
 }
 
 static int jtagspi_wait(struct flash_bank *bank, int timeout_ms)
@@ -533,12 +584,12 @@ static int jtagspi_wait(struct flash_bank *bank, int timeout_ms)
 	do {
 		dt = timeval_ms() - t0;
 
-		uint32_t status = (uint32_t)-1;
-		int retval = jtagspi_read_status(bank, &status);
+		bool idle;
+		int retval = jtagspi_poll_status(bank, &idle);
 		if (retval != ERROR_OK)
 			return retval;
 
-		if ((status & SPIFLASH_BSY_BIT) == 0) {
+		if (idle) {
 			LOG_DEBUG("waited %" PRId64 " ms", dt);
 			return ERROR_OK;
 		}
@@ -549,20 +600,52 @@ static int jtagspi_wait(struct flash_bank *bank, int timeout_ms)
 	return ERROR_FAIL;
 }
 
-static int jtagspi_write_enable(struct flash_bank *bank)
+/* Write enable, its status check, the command itself and a first batch of
+ * status polls all go out in a single JTAG queue flush; only a command taking
+ * longer than that batch needs further round trips in jtagspi_wait() */
+static int jtagspi_write_cmd(struct flash_bank *bank, uint8_t cmd,
+		uint8_t *write_buffer, unsigned int write_len, uint8_t *data_buffer, int data_len,
+		int timeout_ms)
 {
-	jtagspi_cmd(bank, SPIFLASH_WRITE_ENABLE, NULL, 0, NULL, 0);
+	struct jtagspi_flash_bank *info = bank->driver_priv;
+	uint8_t we_status;
+	uint8_t status[JTAGSPI_STATUS_BATCH];
 
-	uint32_t status = (uint32_t)-1;
-	int retval = jtagspi_read_status(bank, &status);
+	int retval = jtagspi_connect(info);
 	if (retval != ERROR_OK)
 		return retval;
 
-	if ((status & SPIFLASH_WE_BIT) == 0) {
-		LOG_ERROR("Cannot enable write to flash. Status=0x%02" PRIx32, status);
+	retval = jtagspi_queue_cmd(bank, SPIFLASH_WRITE_ENABLE, NULL, 0, NULL, 0);
+	if (retval == ERROR_OK)
+		retval = jtagspi_queue_cmd(bank, SPIFLASH_READ_STATUS, NULL, 0, &we_status, -1);
+	if (retval == ERROR_OK)
+		retval = jtagspi_queue_cmd(bank, cmd, write_buffer, write_len, data_buffer, data_len);
+	for (unsigned int i = 0; retval == ERROR_OK && i < ARRAY_SIZE(status); i++)
+		retval = jtagspi_queue_cmd(bank, SPIFLASH_READ_STATUS, NULL, 0, &status[i], -1);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = jtagspi_disconnect(info);
+	if (retval != ERROR_OK)
+		return retval;
+
+	flip_u8(&we_status, &we_status, sizeof(we_status));
+	if ((we_status & SPIFLASH_WE_BIT) == 0) {
+		LOG_ERROR("Cannot enable write to flash. Status=0x%02" PRIx8, we_status);
 		return ERROR_FAIL;
 	}
-	return ERROR_OK;
+
+	flip_u8(status, status, sizeof(status));
+	for (unsigned int i = 0; i < ARRAY_SIZE(status); i++) {
+		if ((status[i] & SPIFLASH_BSY_BIT) == 0)
+			return ERROR_OK;
+	}
+
+	return jtagspi_wait(bank, timeout_ms);
 }
 
 static int jtagspi_bulk_erase(struct flash_bank *bank)
@@ -574,15 +657,8 @@ static int jtagspi_bulk_erase(struct flash_bank *bank)
 	if (info->dev.chip_erase_cmd == 0x00)
 		return ERROR_FLASH_OPER_UNSUPPORTED;
 
-	retval = jtagspi_write_enable(bank);
-	if (retval != ERROR_OK)
-		return retval;
-
-	retval = jtagspi_cmd(bank, info->dev.chip_erase_cmd, NULL, 0, NULL, 0);
-	if (retval != ERROR_OK)
-		return retval;
-
-	retval = jtagspi_wait(bank, bank->num_sectors * JTAGSPI_MAX_TIMEOUT);
+	retval = jtagspi_write_cmd(bank, info->dev.chip_erase_cmd, NULL, 0, NULL, 0,
+			bank->num_sectors * JTAGSPI_MAX_TIMEOUT);
 	LOG_INFO("took %" PRId64 " ms", timeval_ms() - t0);
 	return retval;
 }
@@ -604,19 +680,12 @@ static int jtagspi_sector_erase(struct flash_bank *bank, unsigned int sector)
 	uint8_t addr[sizeof(uint32_t)];
 	int64_t t0 = timeval_ms();
 
-	retval = jtagspi_write_enable(bank);
-	if (retval != ERROR_OK)
-		return retval;
-
 	/* ATXP032/064/128 use always 4-byte addresses except for 0x03 read */
 	unsigned int addr_len = info->always_4byte ? 4 : info->addr_len;
 
-	retval = jtagspi_cmd(bank, info->dev.erase_cmd, fill_addr(bank->sectors[sector].offset, addr_len, addr),
-			addr_len, NULL, 0);
-	if (retval != ERROR_OK)
-		return retval;
-
-	retval = jtagspi_wait(bank, JTAGSPI_MAX_TIMEOUT);
+	retval = jtagspi_write_cmd(bank, info->dev.erase_cmd,
+			fill_addr(bank->sectors[sector].offset, addr_len, addr), addr_len, NULL, 0,
+			JTAGSPI_MAX_TIMEOUT);
 	LOG_INFO("sector %u took %" PRId64 " ms", sector, timeval_ms() - t0);
 	return retval;
 }
@@ -724,20 +793,12 @@ static int jtagspi_page_write(struct flash_bank *bank, const uint8_t *buffer, ui
 {
 	struct jtagspi_flash_bank *info = bank->driver_priv;
 	uint8_t addr[sizeof(uint32_t)];
-	int retval;
-
-	retval = jtagspi_write_enable(bank);
-	if (retval != ERROR_OK)
-		return retval;
 
 	/* ATXP032/064/128 use always 4-byte addresses except for 0x03 read */
 	unsigned int addr_len = ((info->dev.read_cmd != 0x03) && info->always_4byte) ? 4 : info->addr_len;
 
-	retval = jtagspi_cmd(bank, info->dev.pprog_cmd, fill_addr(offset, addr_len, addr),
-		addr_len, (uint8_t *) buffer, count);
-	if (retval != ERROR_OK)
-		return retval;
-	return jtagspi_wait(bank, JTAGSPI_MAX_TIMEOUT);
+	return jtagspi_write_cmd(bank, info->dev.pprog_cmd, fill_addr(offset, addr_len, addr),
+		addr_len, (uint8_t *) buffer, count, JTAGSPI_MAX_TIMEOUT);
 }
 
 static int jtagspi_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t offset, uint32_t count)
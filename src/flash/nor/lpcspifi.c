@@ -938,6 +938,7 @@ const struct flash_driver lpcspifi_flash = {
 	.protect = lpcspifi_protect,
 	.write = lpcspifi_write,
 	.read = default_flash_read,
+	.checksum = default_flash_checksum,
 	.probe = lpcspifi_probe,
 	.auto_probe = lpcspifi_auto_probe,
 	.erase_check = default_flash_blank_check,
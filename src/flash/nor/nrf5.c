@@ -1132,7 +1132,7 @@ static int nrf5_ll_flash_write(struct nrf5_info *chip, uint32_t address, const u
 	uint32_t buffer_size = 8192;
 	struct working_area *write_algorithm;
 	struct working_area *source;
-	struct reg_param reg_params[6];
+	struct reg_param reg_params[7];
 	struct armv7m_algorithm armv7m_info;
 	int retval = ERROR_OK;
 
@@ -1143,9 +1143,10 @@ static int nrf5_ll_flash_write(struct nrf5_info *chip, uint32_t address, const u
 	LOG_DEBUG("Writing buffer to flash address=0x%"PRIx32" bytes=0x%"PRIx32, address, bytes);
 	assert(bytes % 4 == 0);
 
-	/* allocate working area with flash programming code */
-	if (target_alloc_working_area(target, sizeof(nrf5_flash_write_code),
-			&write_algorithm) != ERROR_OK) {
+	/* allocate working area with flash programming code, the code stays
+	 * resident so that subsequent writes of one session skip the download */
+	if (target_alloc_working_area_code(target, nrf5_flash_write_code,
+			sizeof(nrf5_flash_write_code), &write_algorithm) != ERROR_OK) {
 		LOG_WARNING("no working area available, falling back to slow memory writes");
 
 		for (; bytes > 0; bytes -= 4) {
@@ -1164,12 +1165,6 @@ static int nrf5_ll_flash_write(struct nrf5_info *chip, uint32_t address, const u
 		return ERROR_OK;
 	}
 
-	retval = target_write_buffer(target, write_algorithm->address,
-				sizeof(nrf5_flash_write_code),
-				nrf5_flash_write_code);
-	if (retval != ERROR_OK)
-		return retval;
-
 	/* memory buffer */
 	while (target_alloc_working_area(target, buffer_size, &source) != ERROR_OK) {
 		buffer_size /= 2;
@@ -1192,6 +1187,7 @@ static int nrf5_ll_flash_write(struct nrf5_info *chip, uint32_t address, const u
 	init_reg_param(&reg_params[3], "r3", 32, PARAM_IN_OUT);	/* target address */
 	init_reg_param(&reg_params[4], "r6", 32, PARAM_OUT);	/* watchdog refresh value */
 	init_reg_param(&reg_params[5], "r7", 32, PARAM_OUT);	/* watchdog refresh register address */
+	init_reg_param(&reg_params[6], "r8", 32, PARAM_OUT);	/* NVMC READY register address */
 
 	buf_set_u32(reg_params[0].value, 0, 32, bytes);
 	buf_set_u32(reg_params[1].value, 0, 32, source->address);
@@ -1199,6 +1195,7 @@ static int nrf5_ll_flash_write(struct nrf5_info *chip, uint32_t address, const u
 	buf_set_u32(reg_params[3].value, 0, 32, address);
 	buf_set_u32(reg_params[4].value, 0, 32, WATCHDOG_REFRESH_VALUE);
 	buf_set_u32(reg_params[5].value, 0, 32, chip->map->watchdog_refresh_addr);
+	buf_set_u32(reg_params[6].value, 0, 32, chip->map->nvmc_base + NRF5_NVMC_READY);
 
 	retval = target_run_flash_async_algorithm(target, buffer, bytes/4, 4,
 			0, NULL,
@@ -1216,6 +1213,7 @@ static int nrf5_ll_flash_write(struct nrf5_info *chip, uint32_t address, const u
 	destroy_reg_param(&reg_params[3]);
 	destroy_reg_param(&reg_params[4]);
 	destroy_reg_param(&reg_params[5]);
+	destroy_reg_param(&reg_params[6]);
 
 	return retval;
 }
@@ -217,15 +217,24 @@ exit_free_wa:
  * @param target current target
  * @param ipc_id IPC index to poll. IPC #2 is dedicated for DAP access
  * @param lock_expected expected lock status
+ * @param status_addr address of a word read together with each Lock Status, 0 if none
+ * @param status pointer to variable, populated with the word read at status_addr
  * @return ERROR_OK in case of success, ERROR_XXX code otherwise
  *************************************************************************************************/
-static int ipc_poll_lock_stat(struct target *target, uint32_t ipc_id, bool lock_expected)
+static int ipc_poll_lock_stat(struct target *target, uint32_t ipc_id, bool lock_expected,
+	uint32_t status_addr, uint32_t *status)
 {
 	int hr;
-	uint32_t reg_val;
+	uint8_t buf[8];
 	struct armv7m_common *armv7m = target_to_armv7m(target);
 	bool is_cm0 = (armv7m->arm.arch == ARM_ARCH_V6M);
 
+	/* Lock Status and SROM API status in a single adapter round trip */
+	struct target_memory_sg ranges[2];
+	unsigned int num_ranges = status_addr ? 2 : 1;
+	target_memory_sg_range(&ranges[0], MEM_IPC_LOCK_STATUS(ipc_id), 4, buf);
+	target_memory_sg_range(&ranges[1], status_addr, 4, buf + 4);
+
 	struct timeout to;
 	timeout_init(&to, IPC_TIMEOUT_MS);
 
@@ -234,16 +243,20 @@ static int ipc_poll_lock_stat(struct target *target, uint32_t ipc_id, bool lock_
 		keep_alive();
 
 		/* Read IPC Lock status */
-		hr = target_read_u32(target, MEM_IPC_LOCK_STATUS(ipc_id), &reg_val);
+		hr = target_read_memory_sg(target, ranges, num_ranges);
 		if (hr != ERROR_OK) {
 			LOG_ERROR("Unable to read IPC Lock Status register");
 			return hr;
 		}
 
+		uint32_t reg_val = target_buffer_get_u32(target, buf);
 		bool is_locked = (reg_val & IPC_LOCK_ACQUIRED_MSK) != 0;
 
-		if (lock_expected == is_locked)
+		if (lock_expected == is_locked) {
+			if (status_addr)
+				*status = target_buffer_get_u32(target, buf + 4);
 			return ERROR_OK;
+		}
 	}
 
 	if (!is_cm0) {
@@ -293,7 +306,7 @@ static int ipc_acquire(struct target *target, char ipc_id)
 		is_acquired = (reg_val & IPC_ACQUIRE_SUCCESS_MSK) != 0;
 		if (is_acquired) {
 			/* If IPC structure is acquired, the lock status should be set */
-			hr = ipc_poll_lock_stat(target, ipc_id, true);
+			hr = ipc_poll_lock_stat(target, ipc_id, true, 0, NULL);
 			break;
 		}
 	}
@@ -305,18 +318,17 @@ static int ipc_acquire(struct target *target, char ipc_id)
 }
 
 /** ***********************************************************************************************
- * @brief Invokes SROM API functions which are responsible for Flash operations
+ * @brief Starts a SROM API function and returns without waiting for its completion. The IPC
+ * structure stays locked until the function completes, see sromapi_wait()
  *
  * @param target current target
  * @param req_and_params request id of the function to invoke
  * @param working_area address of memory buffer in target's memory space for SROM API parameters
- * @param data_out pointer to variable which will be populated with execution status
  * @return ERROR_OK in case of success, ERROR_XXX code otherwise
  *************************************************************************************************/
-static int call_sromapi(struct target *target,
+static int sromapi_start(struct target *target,
 	uint32_t req_and_params,
-	uint32_t working_area,
-	uint32_t *data_out)
+	uint32_t working_area)
 {
 	int hr;
 
@@ -339,25 +351,30 @@ static int call_sromapi(struct target *target,
 	if (hr != ERROR_OK)
 		return hr;
 
-	hr = target_write_u32(target, MEM_IPC_NOTIFY(IPC_ID), 1);
-	if (hr != ERROR_OK)
-		return hr;
-
-	/* Poll lock status */
-	hr = ipc_poll_lock_stat(target, IPC_ID, false);
-	if (hr != ERROR_OK)
-		return hr;
+	return target_write_u32(target, MEM_IPC_NOTIFY(IPC_ID), 1);
+}
 
-	/* Poll Data byte */
-	if (is_data_in_ram)
-		hr = target_read_u32(target, working_area, data_out);
-	else
-		hr = target_read_u32(target, MEM_IPC_DATA(IPC_ID), data_out);
+/** ***********************************************************************************************
+ * @brief Waits for completion of the SROM API function started by sromapi_start()
+ *
+ * @param target current target
+ * @param req_and_params request id of the function invoked
+ * @param working_area address of memory buffer in target's memory space for SROM API parameters
+ * @param data_out pointer to variable which will be populated with execution status
+ * @return ERROR_OK in case of success, ERROR_XXX code otherwise
+ *************************************************************************************************/
+static int sromapi_wait(struct target *target,
+	uint32_t req_and_params,
+	uint32_t working_area,
+	uint32_t *data_out)
+{
+	bool is_data_in_ram = (req_and_params & SROMAPI_DATA_LOCATION_MSK) == 0;
 
-	if (hr != ERROR_OK) {
-		LOG_ERROR("Error reading SROM API Status location");
+	/* Poll lock status, the status word is read along */
+	int hr = ipc_poll_lock_stat(target, IPC_ID, false,
+			is_data_in_ram ? working_area : MEM_IPC_DATA(IPC_ID), data_out);
+	if (hr != ERROR_OK)
 		return hr;
-	}
 
 	bool is_success = (*data_out & SROMAPI_STATUS_MSK) == SROMAPI_STAT_SUCCESS;
 	if (!is_success) {
@@ -368,6 +385,27 @@ static int call_sromapi(struct target *target,
 	return ERROR_OK;
 }
 
+/** ***********************************************************************************************
+ * @brief Invokes SROM API functions which are responsible for Flash operations
+ *
+ * @param target current target
+ * @param req_and_params request id of the function to invoke
+ * @param working_area address of memory buffer in target's memory space for SROM API parameters
+ * @param data_out pointer to variable which will be populated with execution status
+ * @return ERROR_OK in case of success, ERROR_XXX code otherwise
+ *************************************************************************************************/
+static int call_sromapi(struct target *target,
+	uint32_t req_and_params,
+	uint32_t working_area,
+	uint32_t *data_out)
+{
+	int hr = sromapi_start(target, req_and_params, working_area);
+	if (hr != ERROR_OK)
+		return hr;
+
+	return sromapi_wait(target, req_and_params, working_area, data_out);
+}
+
 /** ***********************************************************************************************
  * @brief Retrieves SiliconID and Protection status of the target device
  * @param target current target
@@ -750,64 +788,40 @@ exit:
 }
 
 /** ***********************************************************************************************
- * @brief Programs single Flash Row
+ * @brief Downloads the SROM API parameters and the data of a single Flash Row to the working area
  * @param bank current flash bank
+ * @param wa working area for SROM API parameters and row data
  * @param addr address of the flash row
  * @param buffer pointer to the buffer with data
  * @param is_sflash true if current flash bank belongs to Supervisory Flash
  * @return ERROR_OK in case of success, ERROR_XXX code otherwise
  *************************************************************************************************/
-static int psoc6_program_row(struct flash_bank *bank,
+static int psoc6_download_row(struct flash_bank *bank,
+	struct working_area *wa,
 	uint32_t addr,
 	const uint8_t *buffer,
 	bool is_sflash)
 {
 	struct target *target = bank->target;
 	struct psoc6_target_info *psoc6_info = bank->driver_priv;
-	struct working_area *wa;
 	const uint32_t sromapi_req = is_sflash ? SROMAPI_WRITEROW_REQ : SROMAPI_PROGRAMROW_REQ;
-	uint32_t data_out;
-	int hr = ERROR_OK;
-
-	LOG_DEBUG("Programming ROW @%08" PRIX32, addr);
-
-	hr = target_alloc_working_area(target, psoc6_info->row_sz + 32, &wa);
-	if (hr != ERROR_OK)
-		goto exit;
-
-	hr = target_write_u32(target, wa->address, sromapi_req);
-	if (hr != ERROR_OK)
-		goto exit_free_wa;
-
-	hr = target_write_u32(target,
-			wa->address + 0x04,
-			0x106);
-	if (hr != ERROR_OK)
-		goto exit_free_wa;
-
-	hr = target_write_u32(target, wa->address + 0x08, addr);
-	if (hr != ERROR_OK)
-		goto exit_free_wa;
-
-	hr = target_write_u32(target, wa->address + 0x0C, wa->address + 0x10);
-	if (hr != ERROR_OK)
-		goto exit_free_wa;
-
-	hr = target_write_buffer(target, wa->address + 0x10, psoc6_info->row_sz, buffer);
-	if (hr != ERROR_OK)
-		goto exit_free_wa;
+	uint8_t row_buf[0x10 + psoc6_info->row_sz];
 
-	hr = call_sromapi(target, sromapi_req, wa->address, &data_out);
-
-exit_free_wa:
-	target_free_working_area(target, wa);
+	/* Parameters and data in a single transfer */
+	target_buffer_set_u32(target, row_buf, sromapi_req);
+	target_buffer_set_u32(target, row_buf + 0x04, 0x106);
+	target_buffer_set_u32(target, row_buf + 0x08, addr);
+	target_buffer_set_u32(target, row_buf + 0x0C, wa->address + 0x10);
+	memcpy(row_buf + 0x10, buffer, psoc6_info->row_sz);
 
-exit:
-	return hr;
+	return target_write_buffer(target, wa->address, sizeof(row_buf), row_buf);
 }
 
 /** ***********************************************************************************************
- * @brief Performs Program operation
+ * @brief Performs Program operation. The SROM algorithm session is kept open for all the rows.
+ * With room for two rows in the working area, the next row is downloaded while the SROM API
+ * programs the current one.
+ *
  * @param bank current flash bank
  * @param buffer pointer to the buffer with data
  * @param offset starting offset in flash bank
@@ -822,6 +836,15 @@ static int psoc6_program(struct flash_bank *bank,
 	struct target *target = bank->target;
 	struct psoc6_target_info *psoc6_info = bank->driver_priv;
 	const bool is_sflash = is_sflash_bank(bank);
+	const uint32_t sromapi_req = is_sflash ? SROMAPI_WRITEROW_REQ : SROMAPI_PROGRAMROW_REQ;
+	struct working_area *wa[2] = { NULL, NULL };
+	unsigned int num_wa = 0;
+	unsigned int cur = 0;
+	/* row being programmed by the SROM API, if busy */
+	bool busy = false;
+	unsigned int busy_wa = 0;
+	uint32_t busy_addr = 0;
+	uint32_t data_out;
 	int hr;
 
 	uint8_t page_buf[psoc6_info->row_sz];
@@ -830,6 +853,16 @@ static int psoc6_program(struct flash_bank *bank,
 	if (hr != ERROR_OK)
 		goto exit;
 
+	while (num_wa < ARRAY_SIZE(wa) &&
+			target_alloc_working_area_try(target, psoc6_info->row_sz + 32, &wa[num_wa]) == ERROR_OK)
+		num_wa++;
+
+	if (!num_wa) {
+		LOG_ERROR("No working area available for a Flash row");
+		hr = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		goto exit;
+	}
+
 	while (count) {
 		uint32_t row_offset = offset % psoc6_info->row_sz;
 		uint32_t aligned_addr = bank->base + offset - row_offset;
@@ -838,18 +871,58 @@ static int psoc6_program(struct flash_bank *bank,
 		memset(page_buf, 0, sizeof(page_buf));
 		memcpy(&page_buf[row_offset], buffer, row_bytes);
 
-		hr = psoc6_program_row(bank, aligned_addr, page_buf, is_sflash);
+		/* A single working area is in use until the current row is programmed */
+		if (busy && num_wa == 1) {
+			busy = false;
+			hr = sromapi_wait(target, sromapi_req, wa[busy_wa]->address, &data_out);
+			if (hr != ERROR_OK)
+				goto exit_failed;
+		}
+
+		LOG_DEBUG("Programming ROW @%08" PRIX32, aligned_addr);
+
+		hr = psoc6_download_row(bank, wa[cur], aligned_addr, page_buf, is_sflash);
 		if (hr != ERROR_OK) {
-			LOG_ERROR("Failed to program Flash at address 0x%08" PRIX32, aligned_addr);
-			goto exit;
+			busy_addr = aligned_addr;
+			goto exit_failed;
+		}
+
+		if (busy) {
+			busy = false;
+			hr = sromapi_wait(target, sromapi_req, wa[busy_wa]->address, &data_out);
+			if (hr != ERROR_OK)
+				goto exit_failed;
 		}
 
+		busy_addr = aligned_addr;
+		hr = sromapi_start(target, sromapi_req, wa[cur]->address);
+		if (hr != ERROR_OK)
+			goto exit_failed;
+		busy = true;
+		busy_wa = cur;
+		cur = (cur + 1) % num_wa;
+
 		buffer += row_bytes;
 		offset += row_bytes;
 		count -= row_bytes;
 	}
 
+	if (busy) {
+		busy = false;
+		hr = sromapi_wait(target, sromapi_req, wa[busy_wa]->address, &data_out);
+	}
+
+exit_failed:
+	if (hr != ERROR_OK) {
+		LOG_ERROR("Failed to program Flash at address 0x%08" PRIX32, busy_addr);
+		/* let the SROM API complete before stopping the algorithm */
+		if (busy)
+			sromapi_wait(target, sromapi_req, wa[busy_wa]->address, &data_out);
+	}
+
 exit:
+	for (unsigned int i = 0; i < num_wa; i++)
+		target_free_working_area(target, wa[i]);
 	sromalgo_release(target);
 	return hr;
 }
@@ -211,6 +211,83 @@ static int rp2040_stack_grab_and_prep(struct flash_bank *bank)
 	return ERROR_OK;
 }
 
+/* Program whole pages with a loader which calls flash_range_program() on
+ * the target for each page while the host streams the next ones into a
+ * FIFO, instead of one ROM call per bounce buffer. Needs the stack and the
+ * flash prepared by rp2040_stack_grab_and_prep(). */
+static int rp2040_flash_write_async(struct flash_bank *bank, const uint8_t *buffer,
+		uint32_t offset, uint32_t count)
+{
+	struct rp2040_flash_bank *priv = bank->driver_priv;
+	struct target *target = bank->target;
+	uint32_t pagesize = priv->dev->pagesize;
+	struct working_area *write_algorithm;
+	struct working_area *fifo;
+
+	static const uint8_t rp2040_write_code[] = {
+#include "../../../contrib/loaders/flash/rp2040/rp2040_write.inc"
+	};
+
+	if (!pagesize || count % pagesize)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	int err = target_alloc_working_area_code(target, rp2040_write_code,
+			sizeof(rp2040_write_code), &write_algorithm);
+	if (err != ERROR_OK) {
+		LOG_WARNING("no working area available for the flash write loader");
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	/* FIFO holding whole pages, at most the data to write */
+	uint32_t avail = target_get_working_area_avail(target);
+	uint32_t pages = avail > 8 ? (avail - 8) / pagesize : 0;
+	pages = MIN(pages, count / pagesize);
+	if (!pages || target_alloc_working_area(target, 8 + pages * pagesize, &fifo) != ERROR_OK) {
+		target_free_working_area(target, write_algorithm);
+		LOG_WARNING("no large enough working area available for the flash write FIFO");
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	struct reg_param reg_params[7];
+	init_reg_param(&reg_params[0], "r4", 32, PARAM_OUT);	/* FIFO start */
+	init_reg_param(&reg_params[1], "r5", 32, PARAM_OUT);	/* FIFO end */
+	init_reg_param(&reg_params[2], "r6", 32, PARAM_IN_OUT);	/* flash offset */
+	init_reg_param(&reg_params[3], "r7", 32, PARAM_OUT);	/* page count */
+	init_reg_param(&reg_params[4], "r8", 32, PARAM_OUT);	/* flash_range_program() */
+	init_reg_param(&reg_params[5], "r9", 32, PARAM_OUT);	/* page size */
+	init_reg_param(&reg_params[6], "sp", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, fifo->address);
+	buf_set_u32(reg_params[1].value, 0, 32, fifo->address + fifo->size);
+	buf_set_u32(reg_params[2].value, 0, 32, offset);
+	buf_set_u32(reg_params[3].value, 0, 32, count / pagesize);
+	buf_set_u32(reg_params[4].value, 0, 32, priv->jump_flash_range_program);
+	buf_set_u32(reg_params[5].value, 0, 32, pagesize);
+	buf_set_u32(reg_params[6].value, 0, 32, priv->stack->address + priv->stack->size);
+
+	struct armv7m_algorithm alg_info;
+	alg_info.common_magic = ARMV7M_COMMON_MAGIC;
+	alg_info.core_mode = ARM_MODE_THREAD;
+
+	err = target_run_flash_async_algorithm(target, buffer, count / pagesize, pagesize,
+			0, NULL,
+			ARRAY_SIZE(reg_params), reg_params,
+			fifo->address, fifo->size,
+			write_algorithm->address, 0,
+			&alg_info);
+	if (err != ERROR_OK)
+		LOG_ERROR("flash write failed before offset 0x%" PRIx32,
+			buf_get_u32(reg_params[2].value, 0, 32));
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(reg_params); i++)
+		destroy_reg_param(&reg_params[i]);
+
+	target_free_working_area(target, fifo);
+	target_free_working_area(target, write_algorithm);
+
+	return err;
+}
+
 static int rp2040_flash_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t offset, uint32_t count)
 {
 	LOG_DEBUG("Writing %d bytes starting at 0x%" PRIx32, count, offset);
@@ -229,6 +306,12 @@ static int rp2040_flash_write(struct flash_bank *bank, const uint8_t *buffer, ui
 	if (err != ERROR_OK)
 		goto cleanup;
 
+	err = rp2040_flash_write_async(bank, buffer, offset, count);
+	if (err != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+		goto cleanup;
+
+	/* fall back to one ROM call per bounce buffer */
+
 	unsigned int avail_pages = target_get_working_area_avail(target) / priv->dev->pagesize;
 	/* We try to allocate working area rounded down to device page size,
 	 * al least 1 page, at most the write data size
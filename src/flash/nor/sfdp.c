@@ -218,6 +218,10 @@ int spi_sfdp(struct flash_bank *bank, struct flash_device *dev,
 					dev->qread_cmd = 0xEC;
 				if (table->flags & (1UL << 6))
 					dev->pprog_cmd = 0x12;
+				if (table->flags & (1UL << 8))
+					dev->qpprog_cmd = 0x3E;
+				if (table->flags & (1UL << 7))
+					dev->qpprog_cmd = 0x34;
 
 				/* erase instructions */
 				if ((erase_type == 1) && (table->flags & (1UL << 9)))
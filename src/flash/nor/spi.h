@@ -22,6 +22,7 @@ struct flash_device {
 	uint8_t read_cmd;
 	uint8_t qread_cmd;
 	uint8_t pprog_cmd;
+	uint8_t qpprog_cmd;	/* quad data page program, 0 if unknown */
 	uint8_t erase_cmd;
 	uint8_t chip_erase_cmd;
 	uint32_t device_id;
@@ -457,17 +457,13 @@ static int stm32x_write_block_async(struct flash_bank *bank, const uint8_t *buff
 #include "../../../contrib/loaders/flash/stm32/stm32f1x.inc"
 	};
 
-	/* flash write code */
-	if (target_alloc_working_area(target, sizeof(stm32x_flash_write_code),
-			&write_algorithm) != ERROR_OK) {
+	/* flash write code, possibly still loaded from a previous call */
+	retval = target_alloc_working_area_code(target, stm32x_flash_write_code,
+			sizeof(stm32x_flash_write_code), &write_algorithm);
+	if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
 		LOG_WARNING("no working area available, can't do block memory writes");
 		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
-	}
-
-	retval = target_write_buffer(target, write_algorithm->address,
-			sizeof(stm32x_flash_write_code), stm32x_flash_write_code);
-	if (retval != ERROR_OK) {
-		target_free_working_area(target, write_algorithm);
+	} else if (retval != ERROR_OK) {
 		return retval;
 	}
 
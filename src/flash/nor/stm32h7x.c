@@ -17,6 +17,9 @@
 #define FLASH_ERASE_TIMEOUT 10000
 #define FLASH_WRITE_TIMEOUT 5
 
+/* Status polling starts at 1ms and doubles up to this, timeouts count sleep time */
+#define FLASH_POLL_MAX_DELAY 16
+
 /* RM 433 */
 /* Same Flash registers for both banks, */
 /* access depends on Flash Base address */
@@ -260,9 +263,40 @@ static inline int stm32x_get_flash_status(struct flash_bank *bank, uint32_t *sta
 	return stm32x_read_flash_reg(bank, FLASH_SR, status);
 }
 
+/* report and clear the error flags of a completed flash operation */
+static int stm32x_check_flash_status(struct flash_bank *bank, uint32_t status)
+{
+	int retval = ERROR_OK;
+
+	if (status & FLASH_WRPERR) {
+		LOG_ERROR("wait_flash_op_queue, WRPERR detected");
+		retval = ERROR_FAIL;
+	}
+
+	/* Clear error + EOP flags but report errors */
+	if (status & FLASH_ERROR) {
+		if (retval == ERROR_OK)
+			retval = ERROR_FAIL;
+		/* If this operation fails, we ignore it and report the original retval */
+		stm32x_write_flash_reg(bank, FLASH_CCR, status);
+	}
+	return retval;
+}
+
+/* sleep before the next status poll, backing off exponentially */
+static void stm32x_poll_sleep(int *timeout, unsigned int *delay)
+{
+	unsigned int ms = MIN(*delay, (unsigned int)*timeout);
+
+	alive_sleep(ms);
+	*timeout -= ms;
+	*delay = MIN(*delay * 2, FLASH_POLL_MAX_DELAY);
+}
+
 static int stm32x_wait_flash_op_queue(struct flash_bank *bank, int timeout)
 {
 	uint32_t status;
+	unsigned int delay = 1;
 	int retval;
 
 	/* wait for flash operations completion */
@@ -274,26 +308,14 @@ static int stm32x_wait_flash_op_queue(struct flash_bank *bank, int timeout)
 		if ((status & FLASH_QW) == 0)
 			break;
 
-		if (timeout-- <= 0) {
+		if (timeout <= 0) {
 			LOG_ERROR("wait_flash_op_queue, time out expired, status: 0x%" PRIx32, status);
 			return ERROR_FAIL;
 		}
-		alive_sleep(1);
+		stm32x_poll_sleep(&timeout, &delay);
 	}
 
-	if (status & FLASH_WRPERR) {
-		LOG_ERROR("wait_flash_op_queue, WRPERR detected");
-		retval = ERROR_FAIL;
-	}
-
-	/* Clear error + EOP flags but report errors */
-	if (status & FLASH_ERROR) {
-		if (retval == ERROR_OK)
-			retval = ERROR_FAIL;
-		/* If this operation fails, we ignore it and report the original retval */
-		stm32x_write_flash_reg(bank, FLASH_CCR, status);
-	}
-	return retval;
+	return stm32x_check_flash_status(bank, status);
 }
 
 static int stm32x_unlock_reg(struct flash_bank *bank)
@@ -398,6 +420,7 @@ static int stm32x_write_option(struct flash_bank *bank, uint32_t reg_offset, uin
 
 	/* wait for completion */
 	int timeout = FLASH_ERASE_TIMEOUT;
+	unsigned int delay = 1;
 	uint32_t status;
 	for (;;) {
 		retval = stm32x_read_flash_reg(bank, FLASH_OPTSR_CUR, &status);
@@ -408,12 +431,12 @@ static int stm32x_write_option(struct flash_bank *bank, uint32_t reg_offset, uin
 		if ((status & OPT_BSY) == 0)
 			break;
 
-		if (timeout-- <= 0) {
+		if (timeout <= 0) {
 			LOG_ERROR("waiting for OBL launch, time out expired, OPTSR: 0x%" PRIx32, status);
 			retval = ERROR_FAIL;
 			goto flash_options_lock;
 		}
-		alive_sleep(1);
+		stm32x_poll_sleep(&timeout, &delay);
 	}
 
 	/* check for failure */
@@ -516,6 +539,54 @@ flash_lock:
 	return (retval == ERROR_OK) ? retval2 : retval;
 }
 
+/* Start a sector erase without waiting, the two banks of dual bank devices
+ * have their own controller and erase independently. The bank stays
+ * unlocked until stm32x_busy() sees the erase complete. */
+static int stm32x_erase_start(struct flash_bank *bank, unsigned int sector)
+{
+	struct stm32h7x_flash_bank *stm32x_info = bank->driver_priv;
+
+	assert(sector < bank->num_sectors);
+
+	if (bank->target->state != TARGET_HALTED)
+		return ERROR_TARGET_NOT_HALTED;
+
+	int retval = stm32x_unlock_reg(bank);
+	if (retval == ERROR_OK)
+		retval = stm32x_write_flash_reg(bank, FLASH_CR,
+				stm32x_info->part_info->compute_flash_cr(FLASH_SER | FLASH_PSIZE_64, sector));
+	if (retval == ERROR_OK)
+		retval = stm32x_write_flash_reg(bank, FLASH_CR,
+				stm32x_info->part_info->compute_flash_cr(FLASH_SER | FLASH_PSIZE_64 | FLASH_START, sector));
+
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error erase sector %u", sector);
+		stm32x_lock_reg(bank);
+	}
+
+	return retval;
+}
+
+static int stm32x_busy(struct flash_bank *bank, bool *busy)
+{
+	uint32_t status;
+
+	int retval = stm32x_get_flash_status(bank, &status);
+	if (retval != ERROR_OK)
+		return retval;
+
+	*busy = status & FLASH_QW;
+	if (*busy)
+		return ERROR_OK;
+
+	retval = stm32x_check_flash_status(bank, status);
+	int retval2 = stm32x_lock_reg(bank);
+	if (retval2 != ERROR_OK)
+		LOG_ERROR("error during the lock of flash");
+
+	return (retval == ERROR_OK) ? retval2 : retval;
+}
+
 static int stm32x_protect(struct flash_bank *bank, int set, unsigned int first,
 		unsigned int last)
 {
@@ -1040,55 +1111,126 @@ COMMAND_HANDLER(stm32x_handle_unlock_command)
 	return retval;
 }
 
-static int stm32x_mass_erase(struct flash_bank *bank)
+/* unlock the bank and start its mass erase, without waiting for completion */
+static int stm32x_mass_erase_start(struct flash_bank *bank)
 {
-	int retval, retval2;
-	struct target *target = bank->target;
 	struct stm32h7x_flash_bank *stm32x_info = bank->driver_priv;
 
-	if (target->state != TARGET_HALTED) {
-		LOG_ERROR("Target not halted");
-		return ERROR_TARGET_NOT_HALTED;
-	}
-
-	retval = stm32x_unlock_reg(bank);
+	int retval = stm32x_unlock_reg(bank);
 	if (retval != ERROR_OK)
-		goto flash_lock;
+		return retval;
 
 	/* mass erase flash memory bank */
 	retval = stm32x_write_flash_reg(bank, FLASH_CR,
 			stm32x_info->part_info->compute_flash_cr(FLASH_BER | FLASH_PSIZE_64, 0));
 	if (retval != ERROR_OK)
-		goto flash_lock;
+		return retval;
 
-	retval = stm32x_write_flash_reg(bank, FLASH_CR,
+	return stm32x_write_flash_reg(bank, FLASH_CR,
 			stm32x_info->part_info->compute_flash_cr(FLASH_BER | FLASH_PSIZE_64 | FLASH_START, 0));
-	if (retval != ERROR_OK)
-		goto flash_lock;
+}
 
-	retval = stm32x_wait_flash_op_queue(bank, 30000);
-	if (retval != ERROR_OK)
-		goto flash_lock;
+/* wait for a started mass erase and lock the bank again */
+static int stm32x_mass_erase_finish(struct flash_bank *bank, int retval)
+{
+	if (retval == ERROR_OK)
+		retval = stm32x_wait_flash_op_queue(bank, 30000);
 
-flash_lock:
-	retval2 = stm32x_lock_reg(bank);
+	int retval2 = stm32x_lock_reg(bank);
 	if (retval2 != ERROR_OK)
 		LOG_ERROR("error during the lock of flash");
 
 	return (retval == ERROR_OK) ? retval2 : retval;
 }
 
+static int stm32x_mass_erase(struct flash_bank *bank)
+{
+	struct target *target = bank->target;
+
+	if (target->state != TARGET_HALTED) {
+		LOG_ERROR("Target not halted");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	return stm32x_mass_erase_finish(bank, stm32x_mass_erase_start(bank));
+}
+
+/* Mass erase every stm32h7x bank of the target at once: both erases are
+ * started before either is polled, so they run concurrently */
+static int stm32x_mass_erase_all(struct target *target)
+{
+	struct flash_bank *banks[2];
+	int results[ARRAY_SIZE(banks)];
+	unsigned int num_banks = 0;
+
+	if (target->state != TARGET_HALTED) {
+		LOG_ERROR("Target not halted");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	for (unsigned int i = 0; i < flash_get_bank_count(); i++) {
+		struct flash_bank *bank;
+		int retval = get_flash_bank_by_num(i, &bank);
+		if (retval != ERROR_OK)
+			return retval;
+		if (bank->driver != &stm32h7x_flash || bank->target != target)
+			continue;
+
+		/* skip a second definition of the same bank */
+		struct stm32h7x_flash_bank *stm32x_info = bank->driver_priv;
+		unsigned int j;
+		for (j = 0; j < num_banks; j++) {
+			struct stm32h7x_flash_bank *other = banks[j]->driver_priv;
+			if (other->flash_regs_base == stm32x_info->flash_regs_base)
+				break;
+		}
+		if (j < num_banks)
+			continue;
+
+		if (num_banks == ARRAY_SIZE(banks)) {
+			LOG_ERROR("too many stm32h7x flash banks on target %s", target_name(target));
+			return ERROR_FAIL;
+		}
+		banks[num_banks++] = bank;
+	}
+
+	if (num_banks == 0) {
+		LOG_ERROR("no stm32h7x flash bank on target %s", target_name(target));
+		return ERROR_FLASH_BANK_INVALID;
+	}
+
+	for (unsigned int i = 0; i < num_banks; i++)
+		results[i] = stm32x_mass_erase_start(banks[i]);
+
+	int retval = ERROR_OK;
+	for (unsigned int i = 0; i < num_banks; i++) {
+		results[i] = stm32x_mass_erase_finish(banks[i], results[i]);
+		if (results[i] != ERROR_OK) {
+			LOG_ERROR("mass erase of flash bank %u failed", banks[i]->bank_number);
+			if (retval == ERROR_OK)
+				retval = results[i];
+		}
+	}
+
+	return retval;
+}
+
 COMMAND_HANDLER(stm32x_handle_mass_erase_command)
 {
 	if (CMD_ARGC != 1)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
-	struct flash_bank *bank;
-	int retval = CALL_COMMAND_HANDLER(flash_command_get_bank, 0, &bank);
-	if (retval != ERROR_OK)
-		return retval;
+	int retval;
+	if (strcmp(CMD_ARGV[0], "all") == 0) {
+		retval = stm32x_mass_erase_all(get_current_target(CMD_CTX));
+	} else {
+		struct flash_bank *bank;
+		retval = CALL_COMMAND_HANDLER(flash_command_get_bank, 0, &bank);
+		if (retval != ERROR_OK)
+			return retval;
 
-	retval = stm32x_mass_erase(bank);
+		retval = stm32x_mass_erase(bank);
+	}
 	if (retval == ERROR_OK)
 		command_print(CMD, "stm32h7x mass erase complete");
 	else
@@ -1159,8 +1301,9 @@ static const struct command_registration stm32h7x_exec_command_handlers[] = {
 		.name = "mass_erase",
 		.handler = stm32x_handle_mass_erase_command,
 		.mode = COMMAND_EXEC,
-		.usage = "bank_id",
-		.help = "Erase entire flash device.",
+		.usage = "bank_id|'all'",
+		.help = "Erase entire flash device, "
+			"or all flash banks of the current target concurrently.",
 	},
 	{
 		.name = "option_read",
@@ -1195,6 +1338,8 @@ const struct flash_driver stm32h7x_flash = {
 	.commands = stm32h7x_command_handlers,
 	.flash_bank_command = stm32x_flash_bank_command,
 	.erase = stm32x_erase,
+	.erase_start = stm32x_erase_start,
+	.busy = stm32x_busy,
 	.protect = stm32x_protect,
 	.write = stm32x_write,
 	.read = default_flash_read,
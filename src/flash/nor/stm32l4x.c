@@ -131,6 +131,9 @@
 #define FLASH_ERASE_TIMEOUT 250
 #define FLASH_WRITE_TIMEOUT 50
 
+/* Status polling starts at 1ms and doubles up to this, timeouts count sleep time */
+#define FLASH_POLL_MAX_DELAY 16
+
 
 /* relevant STM32L4 flags ****************************************************/
 #define F_NONE              0
@@ -868,9 +871,10 @@ static int stm32l4_wait_status_busy(struct flash_bank *bank, int timeout)
 {
 	struct stm32l4_flash_bank *stm32l4_info = bank->driver_priv;
 	uint32_t status;
+	unsigned int delay = 1;
 	int retval = ERROR_OK;
 
-	/* wait for busy to clear */
+	/* wait for busy to clear, backing off exponentially between polls */
 	for (;;) {
 		retval = stm32l4_read_flash_reg_by_index(bank, STM32_FLASH_SR_INDEX, &status);
 		if (retval != ERROR_OK)
@@ -878,11 +882,14 @@ static int stm32l4_wait_status_busy(struct flash_bank *bank, int timeout)
 		LOG_DEBUG("status: 0x%" PRIx32 "", status);
 		if ((status & stm32l4_info->sr_bsy_mask) == 0)
 			break;
-		if (timeout-- <= 0) {
+		if (timeout <= 0) {
 			LOG_ERROR("timed out waiting for flash");
 			return ERROR_FAIL;
 		}
-		alive_sleep(1);
+		unsigned int ms = MIN(delay, (unsigned int)timeout);
+		alive_sleep(ms);
+		timeout -= ms;
+		delay = MIN(delay * 2, FLASH_POLL_MAX_DELAY);
 	}
 
 	if (status & FLASH_WRPERR) {
@@ -1449,17 +1456,13 @@ static int stm32l4_write_block(struct flash_bank *bank, const uint8_t *buffer,
 #include "../../../contrib/loaders/flash/stm32/stm32l4x.inc"
 	};
 
-	if (target_alloc_working_area(target, sizeof(stm32l4_flash_write_code),
-			&write_algorithm) != ERROR_OK) {
+	/* possibly still loaded from a previous call */
+	retval = target_alloc_working_area_code(target, stm32l4_flash_write_code,
+			sizeof(stm32l4_flash_write_code), &write_algorithm);
+	if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
 		LOG_WARNING("no working area available, can't do block memory writes");
 		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
-	}
-
-	retval = target_write_buffer(target, write_algorithm->address,
-			sizeof(stm32l4_flash_write_code),
-			stm32l4_flash_write_code);
-	if (retval != ERROR_OK) {
-		target_free_working_area(target, write_algorithm);
+	} else if (retval != ERROR_OK) {
 		return retval;
 	}
 
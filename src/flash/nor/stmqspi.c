@@ -85,6 +85,10 @@
 	((QSPI_MODE & ~QSPI_DCYC_MASK & QSPI_NO_ALTB) | \
 	(QSPI_WRITE_MODE | stmqspi_info->dev.pprog_cmd))
 
+/* QSPI page program instruction with quad data and single line instruction */
+#define QSPI_QUAD_PPROG(cmd) (((cmd) == 0x32) || ((cmd) == 0x34) || \
+	((cmd) == 0x38) || ((cmd) == 0x3E))
+
 /* saved mode settings */
 #define OCTOSPI_MODE (stmqspi_info->saved_cr & 0xCFFFFFFF)
 
@@ -391,6 +395,37 @@ err:
 	return retval;
 }
 
+/* QSPI_CCR for page program: QSPI_CCR_PAGE_PROG takes the line setup from the
+ * memory mapped read mode, which is wrong if that mode uses four data lines
+ * with a single line instruction (1-1-4, 1-4-4). Then pick the quad page program
+ * instruction, if the device (or the user) provided one, or fall back to single
+ * line address and data */
+static uint32_t stmqspi_pprog_ccr(struct stmqspi_flash_bank *stmqspi_info)
+{
+	uint32_t ccr = QSPI_CCR_PAGE_PROG;
+	uint32_t imode = (ccr >> QSPI_IMODE_POS) & QSPI_LINE_MASK;
+	uint32_t dmode = (ccr >> SPI_DMODE_POS) & QSPI_LINE_MASK;
+	uint8_t cmd = stmqspi_info->dev.pprog_cmd;
+
+	/* single line or QPI mode, page program uses just the same lines */
+	if (imode != 1 || dmode == 1)
+		return ccr;
+
+	if (dmode == 3 && !QSPI_QUAD_PPROG(cmd))
+		cmd = stmqspi_info->dev.qpprog_cmd;
+
+	if (dmode != 3 || !QSPI_QUAD_PPROG(cmd)) {
+		/* no dual page program, and no known quad one */
+		ccr &= ~((QSPI_LINE_MASK << SPI_DMODE_POS) | (QSPI_LINE_MASK << QSPI_ADMODE_POS));
+		return ccr | (1U << SPI_DMODE_POS) | (1U << QSPI_ADMODE_POS);
+	}
+
+	/* 0x38 and 0x3E take the address on four lines, 0x32 and 0x34 on one */
+	ccr &= ~((QSPI_LINE_MASK << QSPI_ADMODE_POS) | 0xFFU);
+	ccr |= ((cmd == 0x38 || cmd == 0x3E) ? 3U : 1U) << QSPI_ADMODE_POS;
+	return ccr | cmd;
+}
+
 /* check for WIP (write in progress) bit(s) in status register(s) */
 /* timeout in ms */
 static int wait_till_ready(struct flash_bank *bank, int timeout)
@@ -1240,8 +1275,9 @@ err:
 }
 
 /* Verify checksum */
-static int qspi_verify(struct flash_bank *bank, uint8_t *buffer,
-	uint32_t offset, uint32_t count)
+/* CRC32 of flash contents, computed by a loader on the target */
+static int qspi_checksum(struct flash_bank *bank, uint32_t offset, uint32_t count,
+	uint32_t *crc)
 {
 	struct target *target = bank->target;
 	struct stmqspi_flash_bank *stmqspi_info = bank->driver_priv;
@@ -1249,7 +1285,7 @@ static int qspi_verify(struct flash_bank *bank, uint8_t *buffer,
 	struct armv7m_algorithm armv7m_info;
 	struct working_area *algorithm;
 	const uint8_t *code;
-	uint32_t pagesize, codesize, crc32, result, exit_point;
+	uint32_t pagesize, codesize, exit_point;
 	int retval;
 
 	/* see contrib/loaders/flash/stmqspi/stmqspi_crc32.S for src */
@@ -1339,15 +1375,9 @@ static int qspi_verify(struct flash_bank *bank, uint8_t *buffer,
 		&armv7m_info);
 	keep_alive();
 
-	image_calculate_checksum(buffer, count, &crc32);
-
-	if (retval == ERROR_OK) {
-		result = buf_get_u32(reg_params[0].value, 0, 32);
-		LOG_DEBUG("addr " TARGET_ADDR_FMT ", len 0x%08" PRIx32 ", crc 0x%08" PRIx32 " 0x%08" PRIx32,
-			offset + bank->base, count, ~crc32, result);
-		if (~crc32 != result)
-			retval = ERROR_FAIL;
-	}
+	/* the loader returns the inverted CRC */
+	if (retval == ERROR_OK)
+		*crc = ~buf_get_u32(reg_params[0].value, 0, 32);
 
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
@@ -1425,7 +1455,7 @@ static int qspi_read_write_block(struct flash_bank *bank, uint8_t *buffer,
 		},
 		{
 			h_to_le_32(OCTOSPI_MODE | (write ? OCTOSPI_WRITE_MODE : OCTOSPI_READ_MODE)),
-			h_to_le_32(write ? (IS_OCTOSPI ? OCTOSPI_CCR_PAGE_PROG : QSPI_CCR_PAGE_PROG) :
+			h_to_le_32(write ? (IS_OCTOSPI ? OCTOSPI_CCR_PAGE_PROG : stmqspi_pprog_ccr(stmqspi_info)) :
 				(IS_OCTOSPI ? OCTOSPI_CCR_READ : QSPI_CCR_READ)),
 			h_to_le_32(write ? (stmqspi_info->saved_tcr & ~OCTOSPI_DCYC_MASK) :
 				stmqspi_info->saved_tcr),
@@ -1665,8 +1695,8 @@ static int stmqspi_write(struct flash_bank *bank, const uint8_t *buffer,
 	return qspi_read_write_block(bank, (uint8_t *)buffer, offset, count, true);
 }
 
-static int stmqspi_verify(struct flash_bank *bank, const uint8_t *buffer,
-	uint32_t offset, uint32_t count)
+static int stmqspi_checksum(struct flash_bank *bank, uint32_t offset,
+	uint32_t count, uint32_t *crc)
 {
 	struct target *target = bank->target;
 	struct stmqspi_flash_bank *stmqspi_info = bank->driver_priv;
@@ -1690,10 +1720,8 @@ static int stmqspi_verify(struct flash_bank *bank, const uint8_t *buffer,
 		return ERROR_FLASH_BANK_NOT_PROBED;
 	}
 
-	if (offset + count > bank->size) {
-		LOG_WARNING("Verify beyond end of flash. Extra data ignored.");
-		count = bank->size - offset;
-	}
+	if (offset + count > bank->size)
+		return ERROR_FLASH_DST_OUT_OF_BANK;
 
 	if ((dual || octal_dtr) && ((offset & 1) != 0 || (count & 1) != 0)) {
 		LOG_ERROR("In dual-QSPI and octal-DTR modes reads must be two byte aligned: "
@@ -1711,7 +1739,32 @@ static int stmqspi_verify(struct flash_bank *bank, const uint8_t *buffer,
 	if (retval != ERROR_OK)
 		return retval;
 
-	return qspi_verify(bank, (uint8_t *)buffer, offset, count);
+	return qspi_checksum(bank, offset, count, crc);
+}
+
+static int stmqspi_verify(struct flash_bank *bank, const uint8_t *buffer,
+	uint32_t offset, uint32_t count)
+{
+	uint32_t image_crc, flash_crc;
+	int retval;
+
+	if (offset + count > bank->size) {
+		LOG_WARNING("Verify beyond end of flash. Extra data ignored.");
+		count = bank->size - offset;
+	}
+
+	retval = stmqspi_checksum(bank, offset, count, &flash_crc);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = image_calculate_checksum(buffer, count, &image_crc);
+	if (retval != ERROR_OK)
+		return retval;
+
+	LOG_DEBUG("addr " TARGET_ADDR_FMT ", len 0x%08" PRIx32 ", crc 0x%08" PRIx32 " 0x%08" PRIx32,
+		offset + bank->base, count, image_crc, flash_crc);
+
+	return (image_crc == flash_crc) ? ERROR_OK : ERROR_FAIL;
 }
 
 /* Find appropriate dummy setting, in particular octo mode */
@@ -2298,6 +2351,7 @@ static int stmqspi_probe(struct flash_bank *bank)
 			if ((stmqspi_info->dev.read_cmd != temp.read_cmd) ||
 				(stmqspi_info->dev.qread_cmd != temp.qread_cmd) ||
 				(stmqspi_info->dev.pprog_cmd != temp.pprog_cmd) ||
+				(stmqspi_info->dev.qpprog_cmd != temp.qpprog_cmd) ||
 				(stmqspi_info->dev.erase_cmd != temp.erase_cmd) ||
 				(stmqspi_info->dev.chip_erase_cmd != temp.chip_erase_cmd) ||
 				(stmqspi_info->dev.sectorsize != temp.sectorsize) ||
@@ -2456,6 +2510,7 @@ const struct flash_driver stmqspi_flash = {
 	.write = stmqspi_write,
 	.read = stmqspi_read,
 	.verify = stmqspi_verify,
+	.checksum = stmqspi_checksum,
 	.probe = stmqspi_probe,
 	.auto_probe = stmqspi_auto_probe,
 	.erase_check = stmqspi_blank_check,
@@ -42,6 +42,9 @@
 #define QSPI_DCYC_LEN		5					/* width of DCYC field */
 #define QSPI_DCYC_MASK		((BIT(QSPI_DCYC_LEN) - 1) << QSPI_DCYC_POS)
 #define SPI_ADSIZE_POS		12					/* bit position of ADSIZE */
+#define QSPI_ADMODE_POS		10					/* bit position of ADMODE */
+#define QSPI_IMODE_POS		8					/* bit position of IMODE */
+#define QSPI_LINE_MASK		0x3U				/* width of xMODE fields */
 
 #define QSPI_WRITE_MODE		0x00000000U			/* indirect write mode */
 #define QSPI_READ_MODE		0x04000000U			/* indirect read mode */
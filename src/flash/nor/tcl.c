@@ -389,6 +389,39 @@ COMMAND_HANDLER(handle_flash_protect_command)
 	return retval;
 }
 
+/* Split a plain binary image at the runs of erased bytes spanning at least
+ * the smallest sector of the bank it starts in, these are then skipped by
+ * writes and verifies. */
+static int flash_image_split_sparse(struct target *target, struct image *image)
+{
+	struct flash_bank *bank;
+
+	if (image->type != IMAGE_BINARY || image->num_sections != 1)
+		return ERROR_OK;
+
+	int retval = get_flash_bank_by_addr(target, image->sections[0].base_address, false, &bank);
+	if (retval != ERROR_OK)
+		return retval;
+	if (!bank || !bank->num_sectors) {
+		LOG_WARNING("no flash sectors at " TARGET_ADDR_FMT ", image not split",
+			image->sections[0].base_address);
+		return ERROR_OK;
+	}
+
+	/* gaps left within a write are filled with the padded value */
+	if (bank->erased_value != bank->default_padded_value) {
+		LOG_WARNING("flash bank %s pads with 0x%02x but erases to 0x%02x, image not split",
+			bank->name, bank->default_padded_value, bank->erased_value);
+		return ERROR_OK;
+	}
+
+	uint32_t min_gap = UINT32_MAX;
+	for (unsigned int i = 0; i < bank->num_sectors; i++)
+		min_gap = MIN(min_gap, bank->sectors[i].size);
+
+	return image_binary_split(image, bank->erased_value, min_gap);
+}
+
 COMMAND_HANDLER(handle_flash_write_image_command)
 {
 	struct target *target = get_current_target(CMD_CTX);
@@ -401,9 +434,19 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 	/* flash auto-erase is disabled by default*/
 	int auto_erase = 0;
 	bool auto_unlock = false;
+	bool diff = false;
+	bool sparse = false;
 
 	while (CMD_ARGC) {
-		if (strcmp(CMD_ARGV[0], "erase") == 0) {
+		if (strcmp(CMD_ARGV[0], "-diff") == 0) {
+			diff = true;
+			CMD_ARGV++;
+			CMD_ARGC--;
+		} else if (strcmp(CMD_ARGV[0], "-sparse") == 0) {
+			sparse = true;
+			CMD_ARGV++;
+			CMD_ARGC--;
+		} else if (strcmp(CMD_ARGV[0], "erase") == 0) {
 			auto_erase = 1;
 			CMD_ARGV++;
 			CMD_ARGC--;
@@ -442,8 +485,21 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 	if (retval != ERROR_OK)
 		return retval;
 
+	if (sparse) {
+		retval = flash_image_split_sparse(target, &image);
+		if (retval != ERROR_OK) {
+			image_close(&image);
+			return retval;
+		}
+	}
+
+	/* restore the working area once, not after each algorithm run */
+	target_working_area_hold(target);
 	retval = flash_write_unlock_verify(target, &image, &written, auto_erase,
-		auto_unlock, true, false);
+		auto_unlock, true, false, diff);
+	int retval_release = target_working_area_release(target);
+	if (retval == ERROR_OK)
+		retval = retval_release;
 	if (retval != ERROR_OK) {
 		image_close(&image);
 		return retval;
@@ -466,9 +522,16 @@ COMMAND_HANDLER(handle_flash_verify_image_command)
 
 	struct image image;
 	uint32_t verified;
+	bool sparse = false;
 
 	int retval;
 
+	if (CMD_ARGC && strcmp(CMD_ARGV[0], "-sparse") == 0) {
+		sparse = true;
+		CMD_ARGV++;
+		CMD_ARGC--;
+	}
+
 	if (CMD_ARGC < 1)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
@@ -494,8 +557,20 @@ COMMAND_HANDLER(handle_flash_verify_image_command)
 	if (retval != ERROR_OK)
 		return retval;
 
+	if (sparse) {
+		retval = flash_image_split_sparse(target, &image);
+		if (retval != ERROR_OK) {
+			image_close(&image);
+			return retval;
+		}
+	}
+
+	target_working_area_hold(target);
 	retval = flash_write_unlock_verify(target, &image, &verified, false,
-		false, false, true);
+		false, false, true, false);
+	int retval_release = target_working_area_release(target);
+	if (retval == ERROR_OK)
+		retval = retval_release;
 	if (retval != ERROR_OK) {
 		image_close(&image);
 		return retval;
@@ -1000,6 +1075,23 @@ COMMAND_HANDLER(handle_flash_verify_bank_command)
 		return ERROR_FAIL;
 	}
 
+	/* compare checksums first, read back only to show the differences */
+	uint32_t flash_crc, file_crc;
+	if (flash_driver_checksum(p, offset, length, &flash_crc) == ERROR_OK &&
+			image_calculate_checksum(buffer_file, length, &file_crc) == ERROR_OK) {
+		if (flash_crc == file_crc) {
+			if (duration_measure(&bench) == ERROR_OK)
+				command_print(CMD, "checksummed %zd bytes from file %s and flash bank %u"
+					" at offset 0x%8.8" PRIx32 " in %fs (%0.3f KiB/s)",
+					length, CMD_ARGV[1], p->bank_number, offset,
+					duration_elapsed(&bench), duration_kbps(&bench, length));
+			command_print(CMD, "contents match");
+			free(buffer_file);
+			return ERROR_OK;
+		}
+		LOG_INFO("checksum mismatch, reading flash bank back");
+	}
+
 	buffer_flash = malloc(length);
 	if (!buffer_flash) {
 		LOG_ERROR("Out of memory");
@@ -1073,6 +1165,36 @@ COMMAND_HANDLER(handle_flash_padded_value_command)
 	return retval;
 }
 
+COMMAND_HANDLER(handle_flash_shadow_command)
+{
+	if (CMD_ARGC < 1 || CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct flash_bank *p;
+	int retval = CALL_COMMAND_HANDLER(flash_command_get_bank, 0, &p);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (CMD_ARGC == 2) {
+		bool enable;
+		COMMAND_PARSE_ON_OFF(CMD_ARGV[1], enable);
+		/* a virtual bank aliases another bank, whose erases it would miss */
+		if (enable && strcmp(p->driver->name, "virtual") == 0) {
+			command_print(CMD, "flash bank %u is virtual, enable the shadow of its master bank",
+				p->bank_number);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		p->shadow_enabled = enable;
+		if (!enable)
+			flash_shadow_invalidate_range(p->target, p->base, p->size);
+	}
+
+	command_print(CMD, "flash bank %u shadow %s", p->bank_number,
+		p->shadow_enabled ? "on" : "off");
+
+	return ERROR_OK;
+}
+
 static const struct command_registration flash_exec_command_handlers[] = {
 	{
 		.name = "probe",
@@ -1182,18 +1304,21 @@ static const struct command_registration flash_exec_command_handlers[] = {
 		.name = "write_image",
 		.handler = handle_flash_write_image_command,
 		.mode = COMMAND_EXEC,
-		.usage = "[erase] [unlock] filename [offset [file_type]]",
+		.usage = "[erase] [unlock] ['-diff'] ['-sparse'] filename [offset [file_type]]",
 		.help = "Write an image to flash.  Optionally first unprotect "
 			"and/or erase the region to be used. Allow optional "
-			"offset from beginning of bank (defaults to zero)",
+			"offset from beginning of bank (defaults to zero). "
+			"With -diff, only sectors whose content differs are written. "
+			"With -sparse, erased gaps of binary images are not written.",
 	},
 	{
 		.name = "verify_image",
 		.handler = handle_flash_verify_image_command,
 		.mode = COMMAND_EXEC,
-		.usage = "filename [offset [file_type]]",
+		.usage = "['-sparse'] filename [offset [file_type]]",
 		.help = "Verify an image against flash. Allow optional "
-			"offset from beginning of bank (defaults to zero)",
+			"offset from beginning of bank (defaults to zero). "
+			"With -sparse, erased gaps of binary images are not verified",
 	},
 	{
 		.name = "read_bank",
@@ -1229,6 +1354,14 @@ static const struct command_registration flash_exec_command_handlers[] = {
 		.usage = "bank_id value",
 		.help = "Set default flash padded value",
 	},
+	{
+		.name = "shadow",
+		.handler = handle_flash_shadow_command,
+		.mode = COMMAND_EXEC,
+		.usage = "bank_id ['on'|'off']",
+		.help = "Serve GDB reads of the bank from the data last "
+			"written or verified",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
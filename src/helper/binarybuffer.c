@@ -40,6 +40,14 @@ static const char hex_digits[] = {
 	'a', 'b', 'c', 'd', 'e', 'f'
 };
 
+/* Value of a hexadecimal digit plus one, zero for any other character */
+static const uint8_t hex_values[256] = {
+	['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+	['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+	['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+	['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+};
+
 void *buf_cpy(const void *from, void *_to, unsigned size)
 {
 	if (!from || !_to)
@@ -74,7 +82,7 @@ bool buf_cmp(const void *_buf1, const void *_buf2, unsigned size)
 
 	unsigned last = size / 8;
 	if (memcmp(_buf1, _buf2, last) != 0)
-		return false;
+		return true;
 
 	unsigned trailing = size % 8;
 	if (!trailing)
@@ -92,7 +100,18 @@ bool buf_cmp_mask(const void *_buf1, const void *_buf2,
 
 	const uint8_t *buf1 = _buf1, *buf2 = _buf2, *mask = _mask;
 	unsigned last = size / 8;
-	for (unsigned i = 0; i < last; i++) {
+	unsigned i = 0;
+
+	/* compare a word at a time; memcpy() keeps unaligned buffers safe */
+	for (; i + sizeof(uint64_t) <= last; i += sizeof(uint64_t)) {
+		uint64_t a, b, m;
+		memcpy(&a, buf1 + i, sizeof(a));
+		memcpy(&b, buf2 + i, sizeof(b));
+		memcpy(&m, mask + i, sizeof(m));
+		if ((a ^ b) & m)
+			return true;
+	}
+	for (; i < last; i++) {
 		if (buf_cmp_masked(buf1[i], buf2[i], mask[i]))
 			return true;
 	}
@@ -117,48 +136,57 @@ void *buf_set_ones(void *_buf, unsigned size)
 	return buf;
 }
 
+/*
+ * Copy len bits, from bit sq of src to bit dq of dst, one destination byte
+ * at a time. Only the bytes holding the bits are accessed.
+ */
+static void buf_copy_bits(const uint8_t *src, unsigned int sq,
+	uint8_t *dst, unsigned int dq, unsigned int len)
+{
+	for (unsigned int i = 0; i < len; ) {
+		unsigned int s = sq + i;
+		unsigned int d = dq + i;
+		unsigned int n = MIN(8 - d % 8, len - i);
+
+		/* up to 8 source bits, spanning at most two bytes */
+		unsigned int bits = src[s / 8] >> (s % 8);
+		if (s % 8 + n > 8)
+			bits |= src[s / 8 + 1] << (8 - s % 8);
+
+		uint8_t mask = ((1U << n) - 1) << (d % 8);
+		dst[d / 8] = (dst[d / 8] & ~mask) | ((bits << (d % 8)) & mask);
+		i += n;
+	}
+}
+
 void *buf_set_buf(const void *_src, unsigned src_start,
 	void *_dst, unsigned dst_start, unsigned len)
 {
 	const uint8_t *src = _src;
 	uint8_t *dst = _dst;
-	unsigned i, sb, db, sq, dq, lb, lq;
+	unsigned sq, dq;
 
-	sb = src_start / 8;
-	db = dst_start / 8;
+	src += src_start / 8;
+	dst += dst_start / 8;
 	sq = src_start % 8;
 	dq = dst_start % 8;
-	lb = len / 8;
-	lq = len % 8;
-
-	src += sb;
-	dst += db;
-
-	/* check if both buffers are on byte boundary and
-	 * len is a multiple of 8bit so we can simple copy
-	 * the buffer */
-	if ((sq == 0) && (dq == 0) &&  (lq == 0)) {
-		for (i = 0; i < lb; i++)
-			*dst++ = *src++;
+
+	if (sq != dq) {
+		buf_copy_bits(src, sq, dst, dq, len);
 		return _dst;
 	}
 
-	/* fallback to slow bit copy */
-	for (i = 0; i < len; i++) {
-		if (((*src >> (sq&7)) & 1) == 1)
-			*dst |= 1 << (dq&7);
-		else
-			*dst &= ~(1 << (dq&7));
-		if (sq++ == 7) {
-			sq = 0;
-			src++;
-		}
-		if (dq++ == 7) {
-			dq = 0;
-			dst++;
-		}
+	/* Same bit position in both buffers: bits up to the byte boundary,
+	 * then whole bytes copied at once, then the last bits */
+	if (sq) {
+		unsigned head = MIN(8 - sq, len);
+		buf_copy_bits(src++, sq, dst++, dq, head);
+		len -= head;
 	}
 
+	memcpy(dst, src, len / 8);
+	buf_copy_bits(src + len / 8, 0, dst + len / 8, 0, len % 8);
+
 	return _dst;
 }
 
@@ -355,27 +383,28 @@ void bit_copy_discard(struct bit_copy_queue *q)
 size_t unhexify(uint8_t *bin, const char *hex, size_t count)
 {
 	size_t i;
-	char tmp;
 
 	if (!bin || !hex)
 		return 0;
 
-	memset(bin, 0, count);
-
-	for (i = 0; i < 2 * count; i++) {
-		if (hex[i] >= 'a' && hex[i] <= 'f')
-			tmp = hex[i] - 'a' + 10;
-		else if (hex[i] >= 'A' && hex[i] <= 'F')
-			tmp = hex[i] - 'A' + 10;
-		else if (hex[i] >= '0' && hex[i] <= '9')
-			tmp = hex[i] - '0';
-		else
-			return i / 2;
-
-		bin[i / 2] |= tmp << (4 * ((i + 1) % 2));
+	/* One table lookup per digit, a whole byte per iteration */
+	for (i = 0; i < count; i++) {
+		unsigned int high = hex_values[(uint8_t)hex[2 * i]];
+		if (!high)
+			break;
+		unsigned int low = hex_values[(uint8_t)hex[2 * i + 1]];
+		if (!low) {
+			/* Keep the high nibble of an incomplete pair */
+			bin[i++] = (high - 1) << 4;
+			memset(bin + i, 0, count - i);
+			return i - 1;
+		}
+		bin[i] = ((high - 1) << 4) | (low - 1);
 	}
 
-	return i / 2;
+	memset(bin + i, 0, count - i);
+
+	return i;
 }
 
 /**
@@ -393,14 +422,21 @@ size_t unhexify(uint8_t *bin, const char *hex, size_t count)
 size_t hexify(char *hex, const uint8_t *bin, size_t count, size_t length)
 {
 	size_t i;
-	uint8_t tmp;
 
 	if (!length)
 		return 0;
 
-	for (i = 0; i < length - 1 && i < 2 * count; i++) {
-		tmp = (bin[i / 2] >> (4 * ((i + 1) % 2))) & 0x0f;
-		hex[i] = hex_digits[tmp];
+	/* Whole bytes first, then a lone high nibble if length cuts a pair */
+	size_t bytes = MIN(count, (length - 1) / 2);
+	for (i = 0; i < bytes; i++) {
+		hex[2 * i] = hex_digits[bin[i] >> 4];
+		hex[2 * i + 1] = hex_digits[bin[i] & 0x0f];
+	}
+
+	i *= 2;
+	if (i < length - 1 && i < 2 * count) {
+		hex[i] = hex_digits[bin[i / 2] >> 4];
+		i++;
 	}
 
 	hex[i] = 0;
@@ -42,11 +42,14 @@ static inline void buf_set_u32(uint8_t *_buffer,
 		buffer[1] = (value >> 8) & 0xff;
 		buffer[0] = (value >> 0) & 0xff;
 	} else {
-		for (unsigned i = first; i < first + num; i++) {
-			if (((value >> (i - first)) & 1) == 1)
-				buffer[i / 8] |= 1 << (i % 8);
-			else
-				buffer[i / 8] &= ~(1 << (i % 8));
+		/* A byte, or the part of it in the field, at a time */
+		unsigned int last = first + num;
+		for (unsigned int i = first; i < last; ) {
+			unsigned int bit = i % 8;
+			unsigned int n = last - i < 8 - bit ? last - i : 8 - bit;
+			uint8_t mask = ((1U << n) - 1) << bit;
+			buffer[i / 8] = (buffer[i / 8] & ~mask) | (((value >> (i - first)) << bit) & mask);
+			i += n;
 		}
 	}
 }
@@ -81,11 +84,14 @@ static inline void buf_set_u64(uint8_t *_buffer,
 		buffer[1] = (value >> 8) & 0xff;
 		buffer[0] = (value >> 0) & 0xff;
 	} else {
-		for (unsigned i = first; i < first + num; i++) {
-			if (((value >> (i - first)) & 1) == 1)
-				buffer[i / 8] |= 1 << (i % 8);
-			else
-				buffer[i / 8] &= ~(1 << (i % 8));
+		/* A byte, or the part of it in the field, at a time */
+		unsigned int last = first + num;
+		for (unsigned int i = first; i < last; ) {
+			unsigned int bit = i % 8;
+			unsigned int n = last - i < 8 - bit ? last - i : 8 - bit;
+			uint8_t mask = ((1U << n) - 1) << bit;
+			buffer[i / 8] = (buffer[i / 8] & ~mask) | (((value >> (i - first)) << bit) & mask);
+			i += n;
 		}
 	}
 }
@@ -111,9 +117,12 @@ static inline uint32_t buf_get_u32(const uint8_t *_buffer,
 				(((uint32_t)buffer[0]) << 0);
 	} else {
 		uint32_t result = 0;
-		for (unsigned i = first; i < first + num; i++) {
-			if (((buffer[i / 8] >> (i % 8)) & 1) == 1)
-				result |= 1U << (i - first);
+		unsigned int last = first + num;
+		for (unsigned int i = first; i < last; ) {
+			unsigned int bit = i % 8;
+			unsigned int n = last - i < 8 - bit ? last - i : 8 - bit;
+			result |= (uint32_t)((buffer[i / 8] >> bit) & ((1U << n) - 1)) << (i - first);
+			i += n;
 		}
 		return result;
 	}
@@ -149,9 +158,12 @@ static inline uint64_t buf_get_u64(const uint8_t *_buffer,
 				(((uint64_t)buffer[0]) << 0));
 	} else {
 		uint64_t result = 0;
-		for (unsigned i = first; i < first + num; i++) {
-			if (((buffer[i / 8] >> (i % 8)) & 1) == 1)
-				result = result | ((uint64_t)1 << (uint64_t)(i - first));
+		unsigned int last = first + num;
+		for (unsigned int i = first; i < last; ) {
+			unsigned int bit = i % 8;
+			unsigned int n = last - i < 8 - bit ? last - i : 8 - bit;
+			result |= (uint64_t)((buffer[i / 8] >> bit) & ((1U << n) - 1)) << (i - first);
+			i += n;
 		}
 		return result;
 	}
@@ -24,6 +24,7 @@
 #include "command.h"
 #include "configuration.h"
 #include "log.h"
+#include "perf.h"
 #include "time_support.h"
 #include "jim-eventloop.h"
 
@@ -465,6 +466,12 @@ void command_print(struct command_invocation *cmd, const char *format, ...)
 	va_end(ap);
 }
 
+void command_print_binary(struct command_invocation *cmd, const void *data, size_t len)
+{
+	cmd->output_binary = true;
+	Jim_AppendString(cmd->ctx->interp, cmd->output, data, len);
+}
+
 static bool command_can_run(struct command_context *cmd_ctx, struct command *c, const char *full_name)
 {
 	if (c->mode == COMMAND_ANY || c->mode == cmd_ctx->mode)
@@ -532,10 +539,13 @@ static int exec_command(Jim_Interp *interp, struct command_context *context,
 		 * Drop last '\n' to allow command output concatenation
 		 * while keep using command_print() everywhere.
 		 */
-		const char *output_txt = Jim_String(cmd.output);
-		int len = strlen(output_txt);
-		if (len && output_txt[len - 1] == '\n')
-			--len;
+		int len;
+		const char *output_txt = Jim_GetString(cmd.output, &len);
+		if (!cmd.output_binary) {
+			len = strlen(output_txt);
+			if (len && output_txt[len - 1] == '\n')
+				--len;
+		}
 		Jim_SetResultString(context->interp, output_txt, len);
 	}
 	Jim_DecrRefCount(context->interp, cmd.output);
@@ -659,6 +669,7 @@ COMMAND_HANDLER(handle_find)
 	if (!full_path)
 		return ERROR_COMMAND_ARGUMENT_INVALID;
 
+	startup_profile_mark(full_path);
 	command_print(CMD, "%s", full_path);
 	free(full_path);
 
@@ -928,8 +939,15 @@ static int jim_command_dispatch(Jim_Interp *interp, int argc, Jim_Obj * const *a
 	if (c->jim_override_target)
 		cmd_ctx->current_target_override = c->jim_override_target;
 
+	int name_len;
+	const char *name = Jim_GetString(argv[0], &name_len);
+	struct perf_sample sample;
+	perf_begin(&sample, PERF_COMMAND, name, name_len);
+
 	int retval = exec_command(interp, cmd_ctx, c, argc, argv);
 
+	perf_end(&sample, retval);
+
 	if (c->jim_override_target)
 		cmd_ctx->current_target_override = saved_target_override;
 
@@ -81,6 +81,7 @@ struct command_invocation {
 	const char **argv;
 	Jim_Obj * const *jimtcl_argv;
 	Jim_Obj *output;
+	bool output_binary;
 };
 
 /**
@@ -390,6 +391,11 @@ void command_print(struct command_invocation *cmd, const char *format, ...)
 __attribute__ ((format (PRINTF_ATTRIBUTE_FORMAT, 2, 3)));
 void command_print_sameline(struct command_invocation *cmd, const char *format, ...)
 __attribute__ ((format (PRINTF_ATTRIBUTE_FORMAT, 2, 3)));
+/*
+ * Append @a len raw bytes to the command output. The output of a command
+ * that uses it is returned as is, NUL bytes and last '\n' included.
+ */
+void command_print_binary(struct command_invocation *cmd, const void *data, size_t len);
 
 int command_run_line(struct command_context *context, char *line);
 int command_run_linef(struct command_context *context, const char *format, ...)
@@ -15,13 +15,84 @@
 #include "configuration.h"
 #include "log.h"
 #include "replacements.h"
+#include "time_support.h"
 
 static size_t num_config_files;
 static char **config_file_names;
 
+bool startup_profile_enabled;
+
+struct startup_profile_mark {
+	int64_t time_us;
+	char *what;
+};
+
+static struct startup_profile_mark *startup_profile_marks;
+static size_t startup_profile_count, startup_profile_size;
+static bool startup_profile_done;
+
 static size_t num_script_dirs;
 static char **script_search_dirs;
 
+static void startup_profile_free(void)
+{
+	for (size_t i = 0; i < startup_profile_count; i++)
+		free(startup_profile_marks[i].what);
+	free(startup_profile_marks);
+	startup_profile_marks = NULL;
+	startup_profile_count = 0;
+	startup_profile_size = 0;
+}
+
+/* Record that the startup step @a what begins now. Steps are timed until the
+ * next mark, so the time of a script does not include the scripts it sources.
+ * Marks are kept from the start, as the option is only known after the
+ * command line has been parsed. */
+void startup_profile_mark(const char *what)
+{
+	if (startup_profile_done)
+		return;
+
+	if (startup_profile_count == startup_profile_size) {
+		size_t size = startup_profile_size ? 2 * startup_profile_size : 64;
+		struct startup_profile_mark *marks = realloc(startup_profile_marks, size * sizeof(*marks));
+		if (!marks)
+			return;
+		startup_profile_marks = marks;
+		startup_profile_size = size;
+	}
+
+	char *text = strdup(what);
+	if (!text)
+		return;
+	startup_profile_marks[startup_profile_count].time_us = timeval_us();
+	startup_profile_marks[startup_profile_count].what = text;
+	startup_profile_count++;
+}
+
+/* Print the recorded steps if --startup-profile was given, and stop recording */
+void startup_profile_report(void)
+{
+	if (startup_profile_done)
+		return;
+	startup_profile_done = true;
+
+	if (startup_profile_enabled && startup_profile_count) {
+		int64_t end = timeval_us();
+		LOG_OUTPUT("startup profile (ms, each step until the next one):\n");
+		for (size_t i = 0; i < startup_profile_count; i++) {
+			int64_t next = i + 1 < startup_profile_count ? startup_profile_marks[i + 1].time_us : end;
+			int64_t us = next - startup_profile_marks[i].time_us;
+			LOG_OUTPUT("%6" PRId64 ".%03" PRId64 "  %s\n", us / 1000, us % 1000,
+					startup_profile_marks[i].what);
+		}
+		int64_t us = end - startup_profile_marks[0].time_us;
+		LOG_OUTPUT("%6" PRId64 ".%03" PRId64 "  total\n", us / 1000, us % 1000);
+	}
+
+	startup_profile_free();
+}
+
 void add_script_search_dir(const char *dir)
 {
 	num_script_dirs++;
@@ -55,6 +126,8 @@ void free_config(void)
 
 	free(script_search_dirs);
 	script_search_dirs = NULL;
+
+	startup_profile_free();
 }
 
 /* return full path or NULL according to search rules */
@@ -115,6 +188,7 @@ int parse_config_file(struct command_context *cmd_ctx)
 	char **cfg;
 
 	if (!config_file_names) {
+		startup_profile_mark("script openocd.cfg");
 		command_run_line(cmd_ctx, "script openocd.cfg");
 		return ERROR_OK;
 	}
@@ -122,6 +196,7 @@ int parse_config_file(struct command_context *cmd_ctx)
 	cfg = config_file_names;
 
 	while (*cfg) {
+		startup_profile_mark(*cfg);
 		retval = command_run_line(cmd_ctx, *cfg);
 		if (retval != ERROR_OK)
 			return retval;
@@ -23,6 +23,10 @@ void add_script_search_dir(const char *dir);
 
 void free_config(void);
 
+extern bool startup_profile_enabled;
+void startup_profile_mark(const char *what);
+void startup_profile_report(void);
+
 int configuration_output_handler(struct command_context *cmd_ctx,
 		const char *line);
 
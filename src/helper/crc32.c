@@ -13,6 +13,7 @@
 #endif
 
 #include "crc32.h"
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -30,9 +31,53 @@ static uint32_t crc_le_step(uint32_t poly, uint32_t crc, uint32_t data_in,
 	return crc;
 }
 
+/* Slice-by-8 tables for CRC32_POLY_LE, built on first use */
+static uint32_t crc32_le_table[8][256];
+static bool crc32_le_table_ready;
+
+static void crc32_le_init_table(void)
+{
+	for (unsigned int i = 0; i < 256; i++)
+		crc32_le_table[0][i] = crc_le_step(CRC32_POLY_LE, 0, i, 8);
+
+	for (unsigned int i = 0; i < 256; i++) {
+		uint32_t crc = crc32_le_table[0][i];
+		for (unsigned int k = 1; k < 8; k++) {
+			crc = (crc >> 8) ^ crc32_le_table[0][crc & 0xff];
+			crc32_le_table[k][i] = crc;
+		}
+	}
+
+	crc32_le_table_ready = true;
+}
+
+static uint32_t crc32_le_slice8(uint32_t crc, const uint8_t *data, size_t data_len)
+{
+	const uint32_t (*t)[256] = crc32_le_table;
+
+	for (; data_len >= 8; data_len -= 8, data += 8) {
+		crc ^= data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+		crc = t[7][crc & 0xff] ^ t[6][(crc >> 8) & 0xff] ^
+			t[5][(crc >> 16) & 0xff] ^ t[4][crc >> 24] ^
+			t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+	}
+
+	while (data_len--)
+		crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xff];
+
+	return crc;
+}
+
 uint32_t crc32_le(uint32_t poly, uint32_t seed, const void *_data,
 		size_t data_len)
 {
+	if (poly == CRC32_POLY_LE) {
+		/* the common polynomial is table driven, 8 bytes at a time */
+		if (!crc32_le_table_ready)
+			crc32_le_init_table();
+		return crc32_le_slice8(seed, _data, data_len);
+	}
+
 	if (((uintptr_t)_data & 0x3) || (data_len & 0x3)) {
 		/* data is unaligned, processing data one byte at a time */
 		const uint8_t *data = _data;
@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "event_log.h"
+#include "command.h"
+#include "log.h"
+#include "time_support.h"
+
+#define EVENT_LOG_MAGIC			"OCDEVT1"
+#define EVENT_LOG_RECORD_SIZE	16
+/* records are written to the file in blocks of this many */
+#define EVENT_LOG_BUFFER_RECORDS	4096
+
+bool event_log_enabled;
+unsigned int event_log_session;
+
+static FILE *event_log_file;
+static uint8_t event_log_buffer[EVENT_LOG_BUFFER_RECORDS * EVENT_LOG_RECORD_SIZE];
+static unsigned int event_log_count;
+
+void event_log_flush(void)
+{
+	if (!event_log_file || !event_log_count)
+		return;
+
+	size_t size = event_log_count * EVENT_LOG_RECORD_SIZE;
+	if (fwrite(event_log_buffer, 1, size, event_log_file) != size) {
+		LOG_ERROR("event_log: write failed, log stopped");
+		event_log_enabled = false;
+	}
+	fflush(event_log_file);
+	event_log_count = 0;
+}
+
+void event_log_write(enum event_log_type type, enum event_log_phase phase, uint32_t arg)
+{
+	uint8_t *record = event_log_buffer + event_log_count * EVENT_LOG_RECORD_SIZE;
+
+	h_u64_to_le(record, timeval_us());
+	h_u32_to_le(record + 8, arg);
+	h_u16_to_le(record + 12, type);
+	record[14] = phase;
+	record[15] = 0;
+
+	if (++event_log_count == EVENT_LOG_BUFFER_RECORDS)
+		event_log_flush();
+}
+
+static void event_log_close(void)
+{
+	if (!event_log_file)
+		return;
+
+	event_log_flush();
+	event_log_enabled = false;
+	fclose(event_log_file);
+	event_log_file = NULL;
+}
+
+COMMAND_HANDLER(handle_event_log_start_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	event_log_close();
+
+	event_log_file = fopen(CMD_ARGV[0], "wb");
+	if (!event_log_file) {
+		command_print(CMD, "failed to open event log \"%s\"", CMD_ARGV[0]);
+		return ERROR_FAIL;
+	}
+
+	if (fwrite(EVENT_LOG_MAGIC, 1, sizeof(EVENT_LOG_MAGIC), event_log_file) != sizeof(EVENT_LOG_MAGIC)) {
+		command_print(CMD, "failed to write event log \"%s\"", CMD_ARGV[0]);
+		fclose(event_log_file);
+		event_log_file = NULL;
+		return ERROR_FAIL;
+	}
+
+	event_log_count = 0;
+	event_log_session++;
+	event_log_enabled = true;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_event_log_stop_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	event_log_close();
+
+	return ERROR_OK;
+}
+
+static const struct command_registration event_log_subcommand_handlers[] = {
+	{
+		.name = "start",
+		.handler = handle_event_log_start_command,
+		.mode = COMMAND_ANY,
+		.help = "start writing the binary event log to a file",
+		.usage = "file_name",
+	},
+	{
+		.name = "stop",
+		.handler = handle_event_log_stop_command,
+		.mode = COMMAND_ANY,
+		.help = "stop and close the binary event log",
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration event_log_command_handlers[] = {
+	{
+		.name = "event_log",
+		.mode = COMMAND_ANY,
+		.help = "binary log of JTAG, DAP, GDB and target events",
+		.usage = "",
+		.chain = event_log_subcommand_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int event_log_register_commands(struct command_context *cmd_ctx)
+{
+	return register_commands(cmd_ctx, NULL, event_log_command_handlers);
+}
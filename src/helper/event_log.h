@@ -0,0 +1,71 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_HELPER_EVENT_LOG_H
+#define OPENOCD_HELPER_EVENT_LOG_H
+
+#include <helper/types.h>
+
+struct command_context;
+
+/*
+ * Binary log of timed events, for post-mortem analysis of where a debug
+ * session spends its time. See "event_log start" and
+ * contrib/event_log2trace.py, which converts it to the Chrome trace format.
+ *
+ * The file starts with the 8 byte magic "OCDEVT1\0", followed by fixed
+ * size little-endian records, see struct event_log_record. The arg of an
+ * end record holds the result of the operation.
+ */
+
+enum event_log_type {
+	EVENT_LOG_JTAG_FLUSH = 1,	/* arg: flush count */
+	EVENT_LOG_DAP_RUN = 2,		/* arg: DP SELECT when the queue runs */
+	EVENT_LOG_GDB_PACKET = 3,	/* arg: first two characters of the packet */
+	EVENT_LOG_TARGET_EVENT = 4,	/* arg: enum target_event */
+	EVENT_LOG_ALGORITHM = 5,	/* arg: entry point */
+	EVENT_LOG_COMMAND = 6,		/* arg: command id, see EVENT_LOG_NAME */
+	EVENT_LOG_NAME = 7,		/* arg: 4 chars of the name of the next command id */
+};
+
+enum event_log_phase {
+	EVENT_LOG_BEGIN = 'B',
+	EVENT_LOG_END = 'E',
+	EVENT_LOG_INSTANT = 'i',
+};
+
+struct event_log_record {
+	uint64_t time_us;
+	uint32_t arg;
+	uint16_t type;
+	uint8_t phase;
+	uint8_t reserved;
+};
+
+extern bool event_log_enabled;
+/* incremented by each "event_log start", starting from 1 */
+extern unsigned int event_log_session;
+
+void event_log_write(enum event_log_type type, enum event_log_phase phase, uint32_t arg);
+void event_log_flush(void);
+int event_log_register_commands(struct command_context *cmd_ctx);
+
+/* only a test when the log is off */
+static inline void event_log_begin(enum event_log_type type, uint32_t arg)
+{
+	if (event_log_enabled)
+		event_log_write(type, EVENT_LOG_BEGIN, arg);
+}
+
+static inline void event_log_end(enum event_log_type type, uint32_t arg)
+{
+	if (event_log_enabled)
+		event_log_write(type, EVENT_LOG_END, arg);
+}
+
+static inline void event_log_instant(enum event_log_type type, uint32_t arg)
+{
+	if (event_log_enabled)
+		event_log_write(type, EVENT_LOG_INSTANT, arg);
+}
+
+#endif /* OPENOCD_HELPER_EVENT_LOG_H */
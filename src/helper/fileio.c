@@ -19,6 +19,15 @@
 #include "configuration.h"
 #include "fileio.h"
 #include "replacements.h"
+#include "lz4.h"
+
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 struct fileio {
 	char *url;
@@ -26,6 +35,9 @@ struct fileio {
 	enum fileio_type type;
 	enum fileio_access access;
 	FILE *file;
+	void *map;	/* read only mapping of the file, see fileio_map() */
+	uint8_t *data;	/* decompressed content, see fileio_open_uncompressed() */
+	size_t pos;		/* read position in data */
 };
 
 static inline int fileio_close_local(struct fileio *fileio)
@@ -116,6 +128,9 @@ int fileio_open(struct fileio **fileio, const char *url,
 
 	tmp->type = type;
 	tmp->access = access_type;
+	tmp->map = NULL;
+	tmp->data = NULL;
+	tmp->pos = 0;
 	tmp->url = strdup(url);
 
 	retval = fileio_open_local(tmp);
@@ -135,8 +150,14 @@ int fileio_close(struct fileio *fileio)
 {
 	int retval;
 
+#ifndef _WIN32
+	if (fileio->map)
+		munmap(fileio->map, fileio->size);
+#endif
+
 	retval = fileio_close_local(fileio);
 
+	free(fileio->data);
 	free(fileio->url);
 	free(fileio);
 
@@ -145,6 +166,9 @@ int fileio_close(struct fileio *fileio)
 
 int fileio_feof(struct fileio *fileio)
 {
+	if (fileio->data)
+		return fileio->pos >= fileio->size;
+
 	return feof(fileio->file);
 }
 
@@ -152,6 +176,11 @@ int fileio_seek(struct fileio *fileio, size_t position)
 {
 	int retval;
 
+	if (fileio->data) {
+		fileio->pos = MIN(position, fileio->size);
+		return ERROR_OK;
+	}
+
 	retval = fseek(fileio->file, position, SEEK_SET);
 
 	if (retval != 0) {
@@ -167,6 +196,13 @@ static int fileio_local_read(struct fileio *fileio, size_t size, void *buffer,
 {
 	ssize_t retval;
 
+	if (fileio->data) {
+		*size_read = MIN(size, fileio->size - fileio->pos);
+		memcpy(buffer, fileio->data + fileio->pos, *size_read);
+		fileio->pos += *size_read;
+		return ERROR_OK;
+	}
+
 	retval = fread(buffer, 1, size, fileio->file);
 	*size_read = (retval >= 0) ? retval : 0;
 
@@ -197,6 +233,22 @@ int fileio_read_u32(struct fileio *fileio, uint32_t *data)
 
 static int fileio_local_fgets(struct fileio *fileio, size_t size, void *buffer)
 {
+	if (fileio->data) {
+		/* same as fgets(), up to and including a newline */
+		char *str = buffer;
+		size_t len = 0;
+
+		if (size == 0 || fileio->pos >= fileio->size)
+			return ERROR_FILEIO_OPERATION_FAILED;
+		while (len < size - 1 && fileio->pos < fileio->size) {
+			str[len] = fileio->data[fileio->pos++];
+			if (str[len++] == '\n')
+				break;
+		}
+		str[len] = '\0';
+		return ERROR_OK;
+	}
+
 	if (!fgets(buffer, size, fileio->file))
 		return ERROR_FILEIO_OPERATION_FAILED;
 
@@ -247,6 +299,203 @@ int fileio_write_u32(struct fileio *fileio, uint32_t data)
 	return retval;
 }
 
+/**
+ * Map a file opened for reading into memory, so that its content can be
+ * used in place instead of being copied by fileio_read(). The mapping is
+ * created on the first call and lives until fileio_close().
+ *
+ * @returns ERROR_FILEIO_OPERATION_NOT_SUPPORTED if the file can't be
+ * mapped (host without mmap, empty file, pipe...), callers then fall
+ * back to fileio_read().
+ */
+int fileio_map(struct fileio *fileio, const uint8_t **data)
+{
+	if (fileio->data) {
+		*data = fileio->data;
+		return ERROR_OK;
+	}
+
+#ifndef _WIN32
+	if (!fileio->map) {
+		if (fileio->access != FILEIO_READ || fileio->size == 0)
+			return ERROR_FILEIO_OPERATION_NOT_SUPPORTED;
+
+		void *map = mmap(NULL, fileio->size, PROT_READ, MAP_PRIVATE, fileno(fileio->file), 0);
+		if (map == MAP_FAILED) {
+			LOG_DEBUG("couldn't map %s: %s", fileio->url, strerror(errno));
+			return ERROR_FILEIO_OPERATION_NOT_SUPPORTED;
+		}
+		fileio->map = map;
+	}
+
+	*data = fileio->map;
+	return ERROR_OK;
+#else
+	return ERROR_FILEIO_OPERATION_NOT_SUPPORTED;
+#endif
+}
+
+#define FILEIO_GZIP_MAGIC	"\x1f\x8b"
+
+#if HAVE_ZLIB
+static int fileio_gunzip(const uint8_t *src, size_t src_len,
+		uint8_t **dst, size_t *dst_len)
+{
+	z_stream strm = { 0 };
+	uint8_t *out = NULL;
+	size_t out_size = 0;
+	int ret;
+
+	/* gzip header, auto detection is not wanted here */
+	if (inflateInit2(&strm, 16 + MAX_WBITS) != Z_OK)
+		return -1;
+
+	strm.next_in = (Bytef *)src;
+	strm.avail_in = src_len;
+
+	do {
+		if (strm.total_out == out_size) {
+			size_t new_size = MAX(out_size * 2, src_len * 4);
+			uint8_t *p = realloc(out, new_size);
+			if (!p) {
+				ret = Z_MEM_ERROR;
+				break;
+			}
+			out = p;
+			out_size = new_size;
+		}
+		strm.next_out = out + strm.total_out;
+		strm.avail_out = out_size - strm.total_out;
+
+		ret = inflate(&strm, Z_NO_FLUSH);
+
+		/* concatenated gzip members, as written by e.g. "cat a.gz b.gz" */
+		if (ret == Z_STREAM_END && strm.avail_in > 0) {
+			uLong total_out = strm.total_out;
+			ret = inflateReset(&strm);
+			strm.total_out = total_out;
+		}
+	} while (ret == Z_OK || (ret == Z_BUF_ERROR && strm.avail_out == 0));
+
+	inflateEnd(&strm);
+
+	if (ret != Z_STREAM_END) {
+		free(out);
+		return -1;
+	}
+
+	*dst = out;
+	*dst_len = strm.total_out;
+	return 0;
+}
+#endif
+
+/**
+ * Open a file for reading, decompressing it in memory when it is gzip
+ * (if built with zlib) or LZ4 frame compressed, as detected from its
+ * magic number. The fileio functions then operate on the decompressed
+ * content, other files are read as with fileio_open().
+ */
+int fileio_open_uncompressed(struct fileio **fileio, const char *url,
+		enum fileio_type type)
+{
+	struct fileio *tmp;
+	uint8_t magic[4];
+	size_t size_read;
+
+	int retval = fileio_open(&tmp, url, FILEIO_READ, type);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = fileio_read(tmp, sizeof(magic), magic, &size_read);
+	if (retval == ERROR_OK)
+		retval = fileio_seek(tmp, 0);
+	if (retval != ERROR_OK) {
+		fileio_close(tmp);
+		return retval;
+	}
+
+	bool gzip = size_read >= 2 && !memcmp(magic, FILEIO_GZIP_MAGIC, 2);
+	bool lz4 = lz4_is_frame(magic, size_read);
+	if (!gzip && !lz4) {
+		*fileio = tmp;
+		return ERROR_OK;
+	}
+
+#if !HAVE_ZLIB
+	if (gzip) {
+		LOG_ERROR("%s is gzip compressed, OpenOCD was built without zlib", url);
+		fileio_close(tmp);
+		return ERROR_FILEIO_OPERATION_NOT_SUPPORTED;
+	}
+#endif
+
+	const uint8_t *src;
+	uint8_t *buffer = NULL;
+	if (fileio_map(tmp, &src) != ERROR_OK) {
+		buffer = malloc(tmp->size);
+		if (!buffer) {
+			fileio_close(tmp);
+			return ERROR_FAIL;
+		}
+		retval = fileio_read(tmp, tmp->size, buffer, &size_read);
+		if (retval != ERROR_OK || size_read != tmp->size) {
+			free(buffer);
+			fileio_close(tmp);
+			return ERROR_FILEIO_OPERATION_FAILED;
+		}
+		src = buffer;
+	}
+
+	uint8_t *data = NULL;
+	size_t data_len = 0;
+	int ret = -1;
+#if HAVE_ZLIB
+	if (gzip)
+		ret = fileio_gunzip(src, tmp->size, &data, &data_len);
+#endif
+	if (lz4)
+		ret = lz4_decompress_frames(src, tmp->size, &data, &data_len);
+
+	free(buffer);
+#ifndef _WIN32
+	if (tmp->map) {
+		munmap(tmp->map, tmp->size);
+		tmp->map = NULL;
+	}
+#endif
+
+	if (ret != 0) {
+		LOG_ERROR("couldn't decompress %s, corrupted or unsupported %s data",
+			url, gzip ? "gzip" : "LZ4");
+		free(data);
+		fileio_close(tmp);
+		return ERROR_FILEIO_OPERATION_FAILED;
+	}
+
+	LOG_DEBUG("%s: %zu bytes decompressed from %zu", url, data_len, tmp->size);
+
+	/* an empty result still needs a buffer to mark the file decompressed */
+	tmp->data = data ? data : malloc(1);
+	tmp->size = data_len;
+	tmp->pos = 0;
+
+	*fileio = tmp;
+	return ERROR_OK;
+}
+
+/** Get the last modification time of the file, e.g. to validate a cache */
+int fileio_mtime(struct fileio *fileio, time_t *mtime)
+{
+	struct stat st;
+
+	if (fstat(fileno(fileio->file), &st) != 0)
+		return ERROR_FILEIO_OPERATION_FAILED;
+
+	*mtime = st.st_mtime;
+	return ERROR_OK;
+}
+
 /**
  * FIX!!!!
  *
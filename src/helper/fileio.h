@@ -36,6 +36,8 @@ struct fileio;
 
 int fileio_open(struct fileio **fileio, const char *url,
 		enum fileio_access access_type, enum fileio_type type);
+int fileio_open_uncompressed(struct fileio **fileio, const char *url,
+		enum fileio_type type);
 int fileio_close(struct fileio *fileio);
 int fileio_feof(struct fileio *fileio);
 
@@ -50,6 +52,8 @@ int fileio_write(struct fileio *fileio,
 int fileio_read_u32(struct fileio *fileio, uint32_t *data);
 int fileio_write_u32(struct fileio *fileio, uint32_t data);
 int fileio_size(struct fileio *fileio, size_t *size);
+int fileio_map(struct fileio *fileio, const uint8_t **data);
+int fileio_mtime(struct fileio *fileio, time_t *mtime);
 
 #define ERROR_FILEIO_LOCATION_UNKNOWN			(-1200)
 #define ERROR_FILEIO_NOT_FOUND					(-1201)
@@ -0,0 +1,257 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+ * Host side micro-benchmark of the buffer helpers in the hot paths of
+ * image loading, verification and JTAG scans: crc32_le(), hexify(),
+ * unhexify(), buf_set_buf() and the queued bit_copy(). Each kernel is
+ * first checked against a plain bitwise reference, then timed on
+ * pseudo random data from 64 bytes up to the maximum size.
+ *
+ * Usage: helper_bench [max_size_in_bytes]
+ *
+ * Quote its output before and after a change to one of these helpers.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "helper/replacements.h"
+#include "binarybuffer.h"
+#include "crc32.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define BENCH_MIN_SIZE		64
+#define BENCH_MAX_SIZE		(64 * 1024 * 1024)
+/* bytes processed per measurement, the small sizes are repeated */
+#define BENCH_MIN_TOTAL		(64 * 1024 * 1024)
+/* bit_copy() chunk, the size of a typical scan field */
+#define BENCH_COPY_BITS		32
+/* each queued bit_copy() is an allocation, keep the queue reasonable */
+#define BENCH_COPY_MAX_SIZE	(1024 * 1024)
+
+static uint32_t bench_seed = 0x12345678;
+
+static uint32_t bench_random(void)
+{
+	/* xorshift32 */
+	bench_seed ^= bench_seed << 13;
+	bench_seed ^= bench_seed >> 17;
+	bench_seed ^= bench_seed << 5;
+	return bench_seed;
+}
+
+static void bench_fill(uint8_t *buf, size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+		buf[i] = bench_random();
+}
+
+static int64_t bench_now_ns(void)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return (int64_t)now.tv_sec * 1000000000 + (int64_t)now.tv_usec * 1000;
+}
+
+static uint32_t ref_crc32_le(uint32_t crc, const uint8_t *data, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		crc ^= data[i];
+		for (unsigned int bit = 0; bit < 8; bit++)
+			crc = (crc >> 1) ^ ((crc & 1) ? CRC32_POLY_LE : 0);
+	}
+	return crc;
+}
+
+static void ref_bit_copy(const uint8_t *src, unsigned int src_start,
+		uint8_t *dst, unsigned int dst_start, unsigned int len)
+{
+	for (unsigned int i = 0; i < len; i++) {
+		unsigned int s = src_start + i;
+		unsigned int d = dst_start + i;
+		if (src[s / 8] & (1 << (s % 8)))
+			dst[d / 8] |= 1 << (d % 8);
+		else
+			dst[d / 8] &= ~(1 << (d % 8));
+	}
+}
+
+static int check_crc32(const uint8_t *data, size_t len)
+{
+	for (size_t n = 0; n <= len; n += 1 + n / 2) {
+		uint32_t expected = ref_crc32_le(0xffffffff, data, n);
+		uint32_t crc = crc32_le(CRC32_POLY_LE, 0xffffffff, data, n);
+		if (crc != expected) {
+			fprintf(stderr, "crc32_le: 0x%08x instead of 0x%08x for %zu bytes\n",
+				crc, expected, n);
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}
+
+static int check_hexify(const uint8_t *data, size_t len)
+{
+	char *hex = malloc(2 * len + 1);
+	uint8_t *bin = malloc(len);
+	int retval = EXIT_FAILURE;
+
+	if (!hex || !bin)
+		goto out;
+
+	for (size_t n = 0; n <= len; n += 1 + n / 2) {
+		/* all the output lengths, including those cutting a byte in half */
+		for (size_t maxlen = 1; maxlen <= 2 * n + 1; maxlen += 1 + maxlen / 4) {
+			size_t expected = MIN(2 * n, maxlen - 1);
+			size_t out = hexify(hex, data, n, maxlen);
+			bool ok = out == expected && !hex[out];
+			for (size_t i = 0; ok && i < out; i++) {
+				unsigned int nibble = (data[i / 2] >> ((i % 2) ? 0 : 4)) & 0xf;
+				ok = hex[i] == "0123456789abcdef"[nibble];
+			}
+			if (!ok) {
+				fprintf(stderr, "hexify: wrong output for %zu bytes into %zu chars\n",
+					n, maxlen);
+				goto out;
+			}
+		}
+
+		hexify(hex, data, n, 2 * n + 1);
+		if (unhexify(bin, hex, n) != n || memcmp(bin, data, n)) {
+			fprintf(stderr, "unhexify: wrong output for %zu bytes\n", n);
+			goto out;
+		}
+	}
+	retval = EXIT_SUCCESS;
+
+out:
+	free(hex);
+	free(bin);
+	return retval;
+}
+
+static int check_buf_set_buf(const uint8_t *data, size_t len)
+{
+	uint8_t *dst = malloc(len);
+	uint8_t *expected = malloc(len);
+	int retval = EXIT_FAILURE;
+
+	if (!dst || !expected)
+		goto out;
+
+	unsigned int bits = 8 * (len / 2);
+	for (unsigned int src_start = 0; src_start < 16; src_start++) {
+		for (unsigned int dst_start = 0; dst_start < 16; dst_start++) {
+			for (unsigned int n = 0; n <= bits; n += 1 + n / 3) {
+				memset(dst, 0x5a, len);
+				memset(expected, 0x5a, len);
+				buf_set_buf(data, src_start, dst, dst_start, n);
+				ref_bit_copy(data, src_start, expected, dst_start, n);
+				if (memcmp(dst, expected, len)) {
+					fprintf(stderr, "buf_set_buf: wrong output for %u bits from %u to %u\n",
+						n, src_start, dst_start);
+					goto out;
+				}
+			}
+		}
+	}
+	retval = EXIT_SUCCESS;
+
+out:
+	free(dst);
+	free(expected);
+	return retval;
+}
+
+/* run the kernel @a name enough times to process BENCH_MIN_TOTAL bytes */
+#define BENCH_RUN(name, size, body) \
+	do { \
+		size_t reps = MAX(BENCH_MIN_TOTAL / (size), 1); \
+		int64_t start = bench_now_ns(); \
+		for (size_t rep = 0; rep < reps; rep++) { \
+			body; \
+		} \
+		int64_t elapsed = bench_now_ns() - start; \
+		printf("%-12s %10zu %10.3f\n", name, (size_t)(size), \
+			(double)elapsed / ((double)reps * (size))); \
+	} while (0)
+
+static int bench(size_t max_size)
+{
+	uint8_t *data = malloc(max_size);
+	uint8_t *out = malloc(max_size);
+	char *hex = malloc(2 * max_size + 1);
+	struct bit_copy_queue queue;
+	volatile uint32_t sink = 0;
+
+	if (!data || !out || !hex) {
+		fprintf(stderr, "out of memory\n");
+		free(data);
+		free(out);
+		free(hex);
+		return EXIT_FAILURE;
+	}
+
+	bench_fill(data, max_size);
+	hexify(hex, data, max_size, 2 * max_size + 1);
+
+	printf("%-12s %10s %10s\n", "kernel", "bytes", "ns/byte");
+	for (size_t size = BENCH_MIN_SIZE; size <= max_size; size *= 4) {
+		BENCH_RUN("crc32_le", size,
+			sink += crc32_le(CRC32_POLY_LE, 0xffffffff, data, size));
+		BENCH_RUN("hexify", size,
+			sink += hexify(hex, data, size, 2 * size + 1));
+		BENCH_RUN("unhexify", size,
+			sink += unhexify(out, hex, size));
+		BENCH_RUN("buf_set_buf", size,
+			buf_set_buf(data, 3, out, 5, 8 * size - 8));
+		/* scan fields captured one by one, then copied at once */
+		if (size > BENCH_COPY_MAX_SIZE)
+			continue;
+		BENCH_RUN("bit_copy", size,
+			bit_copy_queue_init(&queue);
+			for (size_t bit = 0; bit + BENCH_COPY_BITS <= 8 * size - 8;
+					bit += BENCH_COPY_BITS)
+				bit_copy_queued(&queue, out, bit + 5, data, bit + 3, BENCH_COPY_BITS);
+			bit_copy_execute(&queue));
+	}
+
+	free(data);
+	free(out);
+	free(hex);
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t max_size = BENCH_MAX_SIZE;
+
+	if (argc > 2) {
+		fprintf(stderr, "usage: %s [max_size]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (argc == 2) {
+		char *end;
+		max_size = strtoul(argv[1], &end, 0);
+		if (*end || max_size < BENCH_MIN_SIZE) {
+			fprintf(stderr, "max_size must be at least %d bytes\n", BENCH_MIN_SIZE);
+			return EXIT_FAILURE;
+		}
+	}
+
+	/* the kernels must match the references before their time matters */
+	uint8_t check[1024];
+	bench_fill(check, sizeof(check));
+	if (check_crc32(check, sizeof(check)) != EXIT_SUCCESS ||
+			check_hexify(check, sizeof(check)) != EXIT_SUCCESS ||
+			check_buf_set_buf(check, 64) != EXIT_SUCCESS)
+		return EXIT_FAILURE;
+
+	return bench(max_size);
+}
@@ -19,6 +19,7 @@
 #include "command.h"
 #include "replacements.h"
 #include "time_support.h"
+#include <jtag/adapter.h>
 #include <server/gdb_server.h>
 #include <server/server.h>
 
@@ -41,6 +42,15 @@ static int64_t last_time;
 
 static int64_t start;
 
+/* With "log_output file -buffered", info and debug messages stay in the
+ * stdio buffer of the file and are flushed at this interval, when the
+ * server loop goes idle, or with the next more important message. */
+#define LOG_FLUSH_INTERVAL_MS	100
+#define LOG_BUFFER_SIZE			(64 * 1024)
+
+static bool log_buffered;
+static int64_t log_last_flush;
+
 static const char * const log_strings[6] = {
 	"User : ",
 	"Error: ",
@@ -52,6 +62,26 @@ static const char * const log_strings[6] = {
 
 static int count;
 
+static void log_flush_output(enum log_levels level)
+{
+	if (log_buffered && level > LOG_LVL_WARNING) {
+		int64_t now = timeval_ms();
+		if (now - log_last_flush < LOG_FLUSH_INTERVAL_MS)
+			return;
+		log_last_flush = now;
+	}
+
+	fflush(log_output);
+}
+
+void log_flush(void)
+{
+	if (log_output && log_buffered) {
+		fflush(log_output);
+		log_last_flush = timeval_ms();
+	}
+}
+
 /* forward the log to the listeners */
 static void log_forward(const char *file, unsigned line, const char *function, const char *string)
 {
@@ -93,7 +123,7 @@ static void log_puts(enum log_levels level,
 	if (level == LOG_LVL_OUTPUT) {
 		/* do not prepend any headers, just print out what we were given and return */
 		fputs(string, log_output);
-		fflush(log_output);
+		log_flush_output(level);
 		return;
 	}
 
@@ -124,7 +154,7 @@ static void log_puts(enum log_levels level,
 			(level > LOG_LVL_USER) ? log_strings[level + 1] : "", string);
 	}
 
-	fflush(log_output);
+	log_flush_output(level);
 
 	/* Never forward LOG_LVL_DEBUG, too verbose and they can be found in the log if need be */
 	if (level <= LOG_LVL_INFO)
@@ -214,18 +244,27 @@ COMMAND_HANDLER(handle_debug_level_command)
 
 COMMAND_HANDLER(handle_log_output_command)
 {
-	if (CMD_ARGC > 1)
+	bool buffered = false;
+
+	if (CMD_ARGC == 2 && !strcmp(CMD_ARGV[1], "-buffered"))
+		buffered = true;
+	else if (CMD_ARGC > 1)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
 	FILE *file;
-	if (CMD_ARGC == 1 && strcmp(CMD_ARGV[0], "default") != 0) {
+	if (CMD_ARGC >= 1 && strcmp(CMD_ARGV[0], "default") != 0) {
 		file = fopen(CMD_ARGV[0], "w");
 		if (!file) {
 			command_print(CMD, "failed to open output log \"%s\"", CMD_ARGV[0]);
 			return ERROR_FAIL;
 		}
-		command_print(CMD, "set log_output to \"%s\"", CMD_ARGV[0]);
+		if (buffered)
+			setvbuf(file, NULL, _IOFBF, LOG_BUFFER_SIZE);
+		command_print(CMD, "set log_output to \"%s\"%s", CMD_ARGV[0],
+			buffered ? ", buffered" : "");
 	} else {
+		/* stderr is never buffered */
+		buffered = false;
 		file = stderr;
 		command_print(CMD, "set log_output to default");
 	}
@@ -235,6 +274,8 @@ COMMAND_HANDLER(handle_log_output_command)
 		fclose(log_output);
 	}
 	log_output = file;
+	log_buffered = buffered;
+	log_last_flush = timeval_ms();
 	return ERROR_OK;
 }
 
@@ -243,8 +284,9 @@ static const struct command_registration log_command_handlers[] = {
 		.name = "log_output",
 		.handler = handle_log_output_command,
 		.mode = COMMAND_ANY,
-		.help = "redirect logging to a file (default: stderr)",
-		.usage = "[file_name | 'default']",
+		.help = "redirect logging to a file (default: stderr), "
+			"optionally flushing info and debug messages periodically",
+		.usage = "[file_name ['-buffered'] | 'default']",
 	},
 	{
 		.name = "debug_level",
@@ -291,6 +333,7 @@ void log_exit(void)
 		fclose(log_output);
 	}
 	log_output = NULL;
+	log_buffered = false;
 }
 
 /* add/remove log callback handler */
@@ -417,6 +460,9 @@ void keep_alive(void)
 	int64_t current_time = timeval_ms();
 	int64_t delta_time = current_time - last_time;
 
+	/* keep capturing trace during long running commands */
+	adapter_trace_pump();
+
 	if (delta_time > KEEP_ALIVE_TIMEOUT_MS) {
 		last_time = current_time;
 
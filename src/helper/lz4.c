@@ -0,0 +1,326 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+ * Greedy single pass LZ4 block compressor, and decoder for LZ4 blocks
+ * and frames.
+ *
+ * A block is a sequence of:
+ *   token: high nibble literal count, low nibble match length - 4,
+ *          15 in either nibble meaning more bytes follow, each added
+ *          until one is not 255
+ *   literals
+ *   match offset: 16 bit little endian distance back in the output
+ *   extra match length bytes
+ * The last sequence only has literals. As required by the format, the
+ * last 5 bytes are always literals and no match starts in the last 12 bytes.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "lz4.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include "replacements.h"
+#include "types.h"
+
+#define LZ4_MIN_MATCH		4
+#define LZ4_LAST_LITERALS	5
+#define LZ4_MF_LIMIT		12
+#define LZ4_MAX_OFFSET		65535
+#define LZ4_HASH_BITS		12
+
+static unsigned int lz4_hash(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+/* Append the extra bytes of a length, NULL if out of space */
+static uint8_t *lz4_put_length(uint8_t *op, const uint8_t *oend, size_t len)
+{
+	for (; len >= 255; len -= 255) {
+		if (op >= oend)
+			return NULL;
+		*op++ = 255;
+	}
+	if (op >= oend)
+		return NULL;
+	*op++ = len;
+
+	return op;
+}
+
+/* Append a sequence, without match if match_len is 0, NULL if out of space */
+static uint8_t *lz4_put_sequence(uint8_t *op, const uint8_t *oend,
+		const uint8_t *literals, size_t literal_len, size_t offset, size_t match_len)
+{
+	if (op >= oend)
+		return NULL;
+
+	uint8_t *token = op++;
+	*token = (literal_len < 15 ? literal_len : 15) << 4;
+	if (literal_len >= 15) {
+		op = lz4_put_length(op, oend, literal_len - 15);
+		if (!op)
+			return NULL;
+	}
+
+	if ((size_t)(oend - op) < literal_len)
+		return NULL;
+	memcpy(op, literals, literal_len);
+	op += literal_len;
+
+	if (!match_len)
+		return op;
+
+	if (oend - op < 2)
+		return NULL;
+	*op++ = offset;
+	*op++ = offset >> 8;
+
+	match_len -= LZ4_MIN_MATCH;
+	*token |= match_len < 15 ? match_len : 15;
+	if (match_len >= 15)
+		op = lz4_put_length(op, oend, match_len - 15);
+
+	return op;
+}
+
+size_t lz4_compress_block(const uint8_t *src, size_t src_len,
+		uint8_t *dst, size_t dst_len)
+{
+	/* offset in src of the last position seen for each hash */
+	uint32_t table[1 << LZ4_HASH_BITS] = { 0 };
+
+	const uint8_t *iend = src + src_len;
+	const uint8_t *ip = src;
+	const uint8_t *anchor = src;
+	uint8_t *op = dst;
+	const uint8_t *oend = dst + dst_len;
+
+	if (src_len > LZ4_MF_LIMIT) {
+		const uint8_t *match_limit = iend - LZ4_LAST_LITERALS;
+
+		while (ip + LZ4_MF_LIMIT <= iend) {
+			uint32_t sequence = le_to_h_u32(ip);
+			unsigned int h = lz4_hash(sequence);
+			const uint8_t *ref = src + table[h];
+			table[h] = ip - src;
+
+			if (ref >= ip || ip - ref > LZ4_MAX_OFFSET || le_to_h_u32(ref) != sequence) {
+				ip++;
+				continue;
+			}
+
+			const uint8_t *p = ip + LZ4_MIN_MATCH;
+			ref += LZ4_MIN_MATCH;
+			while (p < match_limit && *p == *ref) {
+				p++;
+				ref++;
+			}
+
+			op = lz4_put_sequence(op, oend, anchor, ip - anchor,
+					p - ref, p - ip);
+			if (!op)
+				return 0;
+
+			ip = p;
+			anchor = ip;
+		}
+	}
+
+	op = lz4_put_sequence(op, oend, anchor, iend - anchor, 0, 0);
+	if (!op)
+		return 0;
+
+	return op - dst;
+}
+
+/* read a literal or match length continuation, NULL on a truncated block */
+static const uint8_t *lz4_get_length(const uint8_t *ip, const uint8_t *iend, size_t *len)
+{
+	uint8_t b;
+
+	do {
+		if (ip >= iend)
+			return NULL;
+		b = *ip++;
+		*len += b;
+	} while (b == 255);
+
+	return ip;
+}
+
+ssize_t lz4_decompress_block(const uint8_t *src, size_t src_len,
+		uint8_t *dst, size_t dst_start, size_t dst_len)
+{
+	const uint8_t *ip = src;
+	const uint8_t *iend = src + src_len;
+	uint8_t *op = dst + dst_start;
+	uint8_t *oend = dst + dst_len;
+
+	while (ip < iend) {
+		uint8_t token = *ip++;
+
+		size_t len = token >> 4;
+		if (len == 15) {
+			ip = lz4_get_length(ip, iend, &len);
+			if (!ip)
+				return -1;
+		}
+		if (len > (size_t)(iend - ip) || len > (size_t)(oend - op))
+			return -1;
+		memcpy(op, ip, len);
+		ip += len;
+		op += len;
+
+		/* the last sequence has no match */
+		if (ip == iend)
+			break;
+
+		if (iend - ip < 2)
+			return -1;
+		size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > (size_t)(op - dst))
+			return -1;
+
+		len = token & 15;
+		if (len == 15) {
+			ip = lz4_get_length(ip, iend, &len);
+			if (!ip)
+				return -1;
+		}
+		len += LZ4_MIN_MATCH;
+		if (len > (size_t)(oend - op))
+			return -1;
+
+		/* byte by byte, the match may overlap what it produces */
+		const uint8_t *ref = op - offset;
+		while (len--)
+			*op++ = *ref++;
+	}
+
+	return op - (dst + dst_start);
+}
+
+#define LZ4_FRAME_MAGIC			0x184d2204
+#define LZ4_SKIPPABLE_MAGIC		0x184d2a50
+#define LZ4_SKIPPABLE_MASK		0xfffffff0
+#define LZ4_FLG_VERSION_MASK	0xc0
+#define LZ4_FLG_VERSION			0x40
+#define LZ4_FLG_BLOCK_CHECKSUM	0x10
+#define LZ4_FLG_CONTENT_SIZE	0x08
+#define LZ4_FLG_CONTENT_CHECKSUM 0x04
+#define LZ4_FLG_DICT_ID			0x01
+#define LZ4_BLOCK_UNCOMPRESSED	0x80000000
+
+bool lz4_is_frame(const uint8_t *src, size_t src_len)
+{
+	return src_len >= 4 && le_to_h_u32(src) == LZ4_FRAME_MAGIC;
+}
+
+int lz4_decompress_frames(const uint8_t *src, size_t src_len,
+		uint8_t **dst, size_t *dst_len)
+{
+	const uint8_t *ip = src;
+	const uint8_t *iend = src + src_len;
+	uint8_t *out = NULL;
+	size_t out_len = 0, out_size = 0;
+
+	while (iend - ip >= 4) {
+		uint32_t magic = le_to_h_u32(ip);
+		ip += 4;
+
+		if ((magic & LZ4_SKIPPABLE_MASK) == LZ4_SKIPPABLE_MAGIC) {
+			if (iend - ip < 4 || le_to_h_u32(ip) > (size_t)(iend - ip - 4))
+				goto error;
+			ip += 4 + le_to_h_u32(ip);
+			continue;
+		}
+		if (magic != LZ4_FRAME_MAGIC || iend - ip < 3)
+			goto error;
+
+		/* frame descriptor, its header checksum is not verified */
+		uint8_t flg = ip[0];
+		uint8_t bd = ip[1];
+		ip += 2;
+		if ((flg & LZ4_FLG_VERSION_MASK) != LZ4_FLG_VERSION)
+			goto error;
+		size_t block_max = (size_t)1 << (8 + 2 * ((bd >> 4) & 7));
+		if (block_max < 64 * 1024)
+			goto error;
+		size_t skip = 1;
+		if (flg & LZ4_FLG_CONTENT_SIZE)
+			skip += 8;
+		if (flg & LZ4_FLG_DICT_ID)
+			goto error;
+		if ((size_t)(iend - ip) < skip)
+			goto error;
+		ip += skip;
+
+		/* blocks are decoded back to back, linked blocks reference the
+		 * previous ones, which stay in the output buffer */
+		for (;;) {
+			if (iend - ip < 4)
+				goto error;
+			uint32_t block_size = le_to_h_u32(ip);
+			ip += 4;
+			if (block_size == 0)
+				break;
+
+			bool uncompressed = block_size & LZ4_BLOCK_UNCOMPRESSED;
+			block_size &= ~LZ4_BLOCK_UNCOMPRESSED;
+			if (block_size > (size_t)(iend - ip))
+				goto error;
+
+			if (out_size - out_len < block_max) {
+				size_t new_size = MAX(out_size * 2, out_len + block_max);
+				uint8_t *p = realloc(out, new_size);
+				if (!p)
+					goto error;
+				out = p;
+				out_size = new_size;
+			}
+
+			if (uncompressed) {
+				if (block_size > block_max)
+					goto error;
+				memcpy(out + out_len, ip, block_size);
+				out_len += block_size;
+			} else {
+				ssize_t n = lz4_decompress_block(ip, block_size, out, out_len,
+						out_len + block_max);
+				if (n < 0)
+					goto error;
+				out_len += n;
+			}
+			ip += block_size;
+
+			if (flg & LZ4_FLG_BLOCK_CHECKSUM) {
+				if (iend - ip < 4)
+					goto error;
+				ip += 4;
+			}
+		}
+
+		if (flg & LZ4_FLG_CONTENT_CHECKSUM) {
+			if (iend - ip < 4)
+				goto error;
+			ip += 4;
+		}
+	}
+
+	if (ip != iend)
+		goto error;
+
+	*dst = out;
+	*dst_len = out_len;
+	return 0;
+
+error:
+	free(out);
+	return -1;
+}
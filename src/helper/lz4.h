@@ -0,0 +1,66 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_HELPER_LZ4_H
+#define OPENOCD_HELPER_LZ4_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/** @file
+ * A minimal compressor producing LZ4 blocks, meant to be expanded by
+ * small on-target decompressors, see contrib/loaders/compress, and a
+ * decoder for LZ4 blocks and frames, e.g. for compressed image files.
+ */
+
+/**
+ * Worst case size of the compressed block for @p len bytes of input
+ */
+#define LZ4_COMPRESS_BOUND(len)	((len) + (len) / 255 + 16)
+
+/**
+ * Compress a block of data in the LZ4 block format
+ * @param	src			The data to compress
+ * @param	src_len		The length of the data in @p src in bytes
+ * @param	dst			The buffer receiving the compressed block
+ * @param	dst_len		The size of @p dst in bytes
+ * @return	The size of the compressed block, or 0 if it does not fit in
+ *			@p dst_len bytes
+ */
+size_t lz4_compress_block(const uint8_t *src, size_t src_len,
+		uint8_t *dst, size_t dst_len);
+
+/**
+ * Decompress a block in the LZ4 block format
+ * @param	src			The compressed block
+ * @param	src_len		The length of the block in bytes
+ * @param	dst			The output buffer, matches may refer to the bytes
+ *						before @p dst_start, e.g. previous linked blocks
+ * @param	dst_start	Where in @p dst the block is decoded to
+ * @param	dst_len		The size of @p dst in bytes
+ * @return	The number of bytes decoded, or -1 for a corrupted block or
+ *			one that does not fit in @p dst
+ */
+ssize_t lz4_decompress_block(const uint8_t *src, size_t src_len,
+		uint8_t *dst, size_t dst_start, size_t dst_len);
+
+/**
+ * Check for the magic number of the LZ4 frame format
+ */
+bool lz4_is_frame(const uint8_t *src, size_t src_len);
+
+/**
+ * Decompress a sequence of LZ4 frames, skippable frames are ignored. The
+ * header, block and content checksums are not verified.
+ * @param	src			The frames
+ * @param	src_len		The length of @p src in bytes
+ * @param	dst			Returns the decompressed data, to be freed
+ * @param	dst_len		Returns the length of the decompressed data
+ * @return	0, or -1 for corrupted frames or frame options not supported
+ *			(dictionaries)
+ */
+int lz4_decompress_frames(const uint8_t *src, size_t src_len,
+		uint8_t **dst, size_t *dst_len);
+
+#endif /* OPENOCD_HELPER_LZ4_H */
@@ -44,6 +44,7 @@ static const struct option long_options[] = {
 	{"search",		required_argument,		NULL,			's'},
 	{"log_output",	required_argument,		NULL,			'l'},
 	{"command",		required_argument,		NULL,			'c'},
+	{"startup-profile",	no_argument,		NULL,			'p'},
 	{NULL, 0, NULL, 0}
 };
 
@@ -310,6 +311,9 @@ int parse_cmdline_args(struct command_context *cmd_ctx, int argc, char *argv[])
 				if (optarg)
 				    add_config_command(optarg);
 				break;
+			case 'p':		/* --startup-profile */
+				startup_profile_enabled = true;
+				break;
 			default:  /* '?' */
 				/* getopt will emit an error message, all we have to do is bail. */
 				return ERROR_FAIL;
@@ -332,6 +336,7 @@ int parse_cmdline_args(struct command_context *cmd_ctx, int argc, char *argv[])
 		LOG_OUTPUT("             | -d<n>\tset debug level to <level>\n");
 		LOG_OUTPUT("--log_output | -l\tredirect log output to file <name>\n");
 		LOG_OUTPUT("--command    | -c\trun <command>\n");
+		LOG_OUTPUT("--startup-profile\treport the time spent in each startup step\n");
 		exit(-1);
 	}
 
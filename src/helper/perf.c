@@ -0,0 +1,296 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "perf.h"
+#include "command.h"
+#include "event_log.h"
+#include "log.h"
+#include "replacements.h"
+#include "time_support.h"
+
+/* names beyond this count are accounted in a single "(other)" entry */
+#define PERF_MAX_ENTRIES	512
+/* hash table slots, a power of two above PERF_MAX_ENTRIES */
+#define PERF_HASH_SIZE		1024
+#define PERF_BUCKETS		20
+#define PERF_NAME_MAX		32
+
+struct perf_entry {
+	const char *name;
+	enum perf_kind kind;
+	unsigned int id;
+	/* event_log_session when the name was written to the event log */
+	unsigned int logged_session;
+	uint64_t calls;
+	uint64_t errors;
+	uint64_t total_us;
+	uint64_t max_us;
+	uint64_t flushes;
+	uint64_t hist[PERF_BUCKETS];
+};
+
+uint64_t perf_flushes;
+
+static struct perf_entry perf_entries[PERF_MAX_ENTRIES];
+static unsigned int perf_entry_count;
+/* index + 1 of the entry in perf_entries, 0 for an empty slot */
+static unsigned short perf_hash[PERF_HASH_SIZE];
+static struct perf_entry perf_other[2] = {
+	{ .name = "(other)", .kind = PERF_COMMAND, .id = PERF_MAX_ENTRIES },
+	{ .name = "(other)", .kind = PERF_GDB_PACKET, .id = PERF_MAX_ENTRIES + 1 },
+};
+
+static const char * const perf_kind_names[] = {
+	[PERF_COMMAND] = "command",
+	[PERF_GDB_PACKET] = "gdb",
+};
+
+static uint32_t perf_name_hash(enum perf_kind kind, const char *name, size_t len)
+{
+	/* FNV-1a */
+	uint32_t hash = 2166136261u ^ kind;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= (uint8_t)name[i];
+		hash *= 16777619;
+	}
+	return hash;
+}
+
+static struct perf_entry *perf_lookup(enum perf_kind kind, const char *name, size_t len)
+{
+	unsigned int slot = perf_name_hash(kind, name, len) & (PERF_HASH_SIZE - 1);
+
+	while (perf_hash[slot]) {
+		struct perf_entry *e = &perf_entries[perf_hash[slot] - 1];
+		if (e->kind == kind && !strncmp(e->name, name, len) && !e->name[len])
+			return e;
+		slot = (slot + 1) & (PERF_HASH_SIZE - 1);
+	}
+
+	if (perf_entry_count == PERF_MAX_ENTRIES)
+		return &perf_other[kind];
+
+	char *copy = strndup(name, len);
+	if (!copy)
+		return &perf_other[kind];
+
+	struct perf_entry *e = &perf_entries[perf_entry_count];
+	e->name = copy;
+	e->kind = kind;
+	e->id = perf_entry_count;
+	perf_hash[slot] = ++perf_entry_count;
+	return e;
+}
+
+/* The name of a command is written to the event log just before its
+ * first begin record of the log, in EVENT_LOG_NAME records of 4 chars */
+static void perf_log_name(struct perf_entry *e)
+{
+	if (e->logged_session == event_log_session)
+		return;
+	e->logged_session = event_log_session;
+
+	size_t len = strlen(e->name);
+	for (size_t i = 0; i <= len; i += 4) {
+		uint8_t chars[4] = { 0 };
+		memcpy(chars, e->name + i, MIN(len - i, 4u));
+		event_log_instant(EVENT_LOG_NAME, le_to_h_u32(chars));
+	}
+}
+
+/**
+ * Start measuring the command or the GDB packet @a name, of @a len chars.
+ */
+void perf_begin(struct perf_sample *sample, enum perf_kind kind, const char *name, size_t len)
+{
+	sample->entry = perf_lookup(kind, name, len);
+	sample->start_flushes = perf_flushes;
+
+	if (kind == PERF_COMMAND && event_log_enabled) {
+		perf_log_name(sample->entry);
+		event_log_write(EVENT_LOG_COMMAND, EVENT_LOG_BEGIN, sample->entry->id);
+	}
+
+	sample->start_us = timeval_us();
+}
+
+static unsigned int perf_bucket(uint64_t value)
+{
+	unsigned int bucket = 0;
+
+	while (value && bucket < PERF_BUCKETS - 1) {
+		value >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+/**
+ * Account the measurement started by perf_begin(), @a result is the
+ * result of the command or of the packet handler.
+ */
+void perf_end(struct perf_sample *sample, int result)
+{
+	struct perf_entry *e = sample->entry;
+	if (!e)
+		return;
+
+	int64_t elapsed = timeval_us() - sample->start_us;
+	if (elapsed < 0)
+		elapsed = 0;
+
+	e->calls++;
+	if (result != ERROR_OK)
+		e->errors++;
+	e->total_us += elapsed;
+	e->max_us = MAX(e->max_us, (uint64_t)elapsed);
+	e->flushes += perf_flushes - sample->start_flushes;
+	e->hist[perf_bucket(elapsed)]++;
+
+	if (e->kind == PERF_COMMAND)
+		event_log_end(EVENT_LOG_COMMAND, result);
+
+	sample->entry = NULL;
+}
+
+static struct perf_entry *perf_entry_get(unsigned int i)
+{
+	return i < perf_entry_count ? &perf_entries[i] : &perf_other[i - perf_entry_count];
+}
+
+static int perf_compare_total(const void *a, const void *b)
+{
+	const struct perf_entry *ea = *(const struct perf_entry * const *)a;
+	const struct perf_entry *eb = *(const struct perf_entry * const *)b;
+
+	if (ea->total_us != eb->total_us)
+		return ea->total_us < eb->total_us ? 1 : -1;
+	return strcmp(ea->name, eb->name);
+}
+
+static void perf_print_hist(struct command_invocation *cmd, const struct perf_entry *e)
+{
+	command_print(cmd, "latency histogram (us):");
+	for (unsigned int i = 0; i < PERF_BUCKETS; i++) {
+		if (!e->hist[i])
+			continue;
+		if (i == 0)
+			command_print(cmd, "  %10s 0: %" PRIu64, "", e->hist[i]);
+		else if (i == PERF_BUCKETS - 1)
+			command_print(cmd, "  %10s >= %" PRIu64 ": %" PRIu64, "", (uint64_t)1 << (i - 1), e->hist[i]);
+		else
+			command_print(cmd, "  %10" PRIu64 " .. %" PRIu64 ": %" PRIu64,
+				(uint64_t)1 << (i - 1), ((uint64_t)1 << i) - 1, e->hist[i]);
+	}
+}
+
+COMMAND_HANDLER(handle_perf_report_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	unsigned int count = perf_entry_count + ARRAY_SIZE(perf_other);
+
+	if (CMD_ARGC == 1) {
+		/* details of a single command or packet */
+		bool found = false;
+		for (unsigned int i = 0; i < count; i++) {
+			struct perf_entry *e = perf_entry_get(i);
+			if (strcmp(e->name, CMD_ARGV[0]) || !e->calls)
+				continue;
+			found = true;
+			command_print(CMD, "%s %s: %" PRIu64 " calls, %" PRIu64 " errors, total %" PRIu64
+				" us, max %" PRIu64 " us, %" PRIu64 " flushes",
+				perf_kind_names[e->kind], e->name, e->calls, e->errors,
+				e->total_us, e->max_us, e->flushes);
+			perf_print_hist(CMD, e);
+		}
+		if (!found)
+			command_print(CMD, "no calls of \"%s\" recorded", CMD_ARGV[0]);
+		return ERROR_OK;
+	}
+
+	struct perf_entry **sorted = malloc(count * sizeof(*sorted));
+	if (!sorted) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	unsigned int n = 0;
+	for (unsigned int i = 0; i < count; i++) {
+		struct perf_entry *e = perf_entry_get(i);
+		if (e->calls)
+			sorted[n++] = e;
+	}
+	qsort(sorted, n, sizeof(*sorted), perf_compare_total);
+
+	command_print(CMD, "%-7s %-*s %8s %12s %10s %10s %8s %8s", "kind", PERF_NAME_MAX, "name",
+		"calls", "total us", "avg us", "max us", "flushes", "errors");
+	for (unsigned int i = 0; i < n; i++) {
+		struct perf_entry *e = sorted[i];
+		command_print(CMD, "%-7s %-*s %8" PRIu64 " %12" PRIu64 " %10" PRIu64 " %10" PRIu64
+			" %8" PRIu64 " %8" PRIu64, perf_kind_names[e->kind], PERF_NAME_MAX, e->name,
+			e->calls, e->total_us, e->total_us / e->calls, e->max_us, e->flushes, e->errors);
+	}
+
+	free(sorted);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_perf_reset_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	/* keep the names, their ids are in use in the event log */
+	unsigned int count = perf_entry_count + ARRAY_SIZE(perf_other);
+	for (unsigned int i = 0; i < count; i++) {
+		struct perf_entry *e = perf_entry_get(i);
+		e->calls = 0;
+		e->errors = 0;
+		e->total_us = 0;
+		e->max_us = 0;
+		e->flushes = 0;
+		memset(e->hist, 0, sizeof(e->hist));
+	}
+
+	return ERROR_OK;
+}
+
+static const struct command_registration perf_subcommand_handlers[] = {
+	{
+		.name = "report",
+		.handler = handle_perf_report_command,
+		.mode = COMMAND_ANY,
+		.help = "display the latency of the commands and of the GDB packets, "
+			"or the latency histogram of one of them",
+		.usage = "[name]",
+	},
+	{
+		.name = "reset",
+		.handler = handle_perf_reset_command,
+		.mode = COMMAND_ANY,
+		.help = "clear the latency statistics",
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration perf_command_handlers[] = {
+	{
+		.name = "perf",
+		.mode = COMMAND_ANY,
+		.help = "latency profile of the commands and of the GDB packets",
+		.usage = "",
+		.chain = perf_subcommand_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int perf_register_commands(struct command_context *cmd_ctx)
+{
+	return register_commands(cmd_ctx, NULL, perf_command_handlers);
+}
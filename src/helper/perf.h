@@ -0,0 +1,42 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_HELPER_PERF_H
+#define OPENOCD_HELPER_PERF_H
+
+#include <helper/types.h>
+
+struct command_context;
+struct perf_entry;
+
+/*
+ * Latency profile of the commands and of the GDB packets, see "perf report".
+ * Each command or packet name gets call counts, a latency histogram and the
+ * number of JTAG/SWD queue flushes done while it runs. Nested commands are
+ * also accounted in their caller.
+ */
+
+enum perf_kind {
+	PERF_COMMAND,
+	PERF_GDB_PACKET,
+};
+
+/* one measurement in progress, between perf_begin() and perf_end() */
+struct perf_sample {
+	struct perf_entry *entry;	/* NULL when not measuring */
+	int64_t start_us;
+	uint64_t start_flushes;
+};
+
+/* JTAG and SWD queue flushes sent to the adapter since startup */
+extern uint64_t perf_flushes;
+
+static inline void perf_count_flush(void)
+{
+	perf_flushes++;
+}
+
+void perf_begin(struct perf_sample *sample, enum perf_kind kind, const char *name, size_t len);
+void perf_end(struct perf_sample *sample, int result);
+int perf_register_commands(struct command_context *cmd_ctx);
+
+#endif /* OPENOCD_HELPER_PERF_H */
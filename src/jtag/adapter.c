@@ -17,6 +17,7 @@
 #include "interface.h"
 #include "interfaces.h"
 #include <transport/transport.h>
+#include <helper/time_support.h>
 
 /**
  * @file
@@ -71,6 +72,197 @@ bool is_adapter_initialized(void)
 	return adapter_config.adapter_initialized;
 }
 
+/* Histogram buckets, bucket N counting values in [2^(N - 1), 2^N) */
+#define ADAPTER_STATS_BUCKETS 20
+
+/**
+ * Statistics of the queue flushes, to find where the time goes.
+ */
+static struct {
+	bool enabled;
+	uint64_t flushes;
+	uint64_t commands;
+	uint64_t bits;
+	uint64_t usb_bytes_out;
+	uint64_t usb_bytes_in;
+	uint64_t time_us;
+	uint64_t max_time_us;
+	/* wall time per flush, in us */
+	uint64_t time_hist[ADAPTER_STATS_BUCKETS];
+	/* commands per flush */
+	uint64_t commands_hist[ADAPTER_STATS_BUCKETS];
+} adapter_stats;
+
+/* Limits of the recommended number of transfers per queue flush */
+#define ADAPTER_BATCH_MIN 16
+#define ADAPTER_BATCH_MAX 16384
+/* Flushes measured before estimating the batch size */
+#define ADAPTER_BATCH_SAMPLES 32
+/* Flushes measured before giving up, if their sizes do not vary enough */
+#define ADAPTER_BATCH_MAX_SAMPLES 1024
+
+/**
+ * Estimation of the number of commands per queue flush worth batching,
+ * from a least squares fit of the wall time of the first flushes after
+ * adapter init over their number of commands:
+ *   time = latency + count * per_command
+ * The recommended size keeps the latency below 10% of the flush time.
+ */
+static struct {
+	/* batch size set by the user, 0 for automatic */
+	unsigned int forced;
+	/* estimated batch size, 0 if not known */
+	unsigned int estimate;
+	bool settled;
+	unsigned int samples;
+	double sum_n, sum_t, sum_nn, sum_nt;
+	double latency_us;
+	double per_command_us;
+} adapter_batch;
+
+bool adapter_flush_timed(void)
+{
+	return adapter_stats.enabled || (!adapter_batch.forced && !adapter_batch.settled);
+}
+
+static void adapter_batch_restart(void)
+{
+	unsigned int forced = adapter_batch.forced;
+
+	memset(&adapter_batch, 0, sizeof(adapter_batch));
+	adapter_batch.forced = forced;
+}
+
+static void adapter_batch_sample(unsigned int commands, int64_t elapsed_us)
+{
+	if (adapter_batch.forced || adapter_batch.settled || !commands)
+		return;
+
+	double n = commands;
+	double t = elapsed_us;
+
+	adapter_batch.samples++;
+	adapter_batch.sum_n += n;
+	adapter_batch.sum_t += t;
+	adapter_batch.sum_nn += n * n;
+	adapter_batch.sum_nt += n * t;
+
+	if (adapter_batch.samples < ADAPTER_BATCH_SAMPLES)
+		return;
+
+	double samples = adapter_batch.samples;
+	double den = samples * adapter_batch.sum_nn - adapter_batch.sum_n * adapter_batch.sum_n;
+	if (den > 0) {
+		double slope = (samples * adapter_batch.sum_nt - adapter_batch.sum_n * adapter_batch.sum_t) / den;
+		double intercept = (adapter_batch.sum_t - slope * adapter_batch.sum_n) / samples;
+
+		if (slope > 0) {
+			double size = 9 * intercept / slope;
+
+			if (size < ADAPTER_BATCH_MIN)
+				size = ADAPTER_BATCH_MIN;
+			else if (size > ADAPTER_BATCH_MAX)
+				size = ADAPTER_BATCH_MAX;
+
+			adapter_batch.latency_us = intercept;
+			adapter_batch.per_command_us = slope;
+			adapter_batch.estimate = size;
+			adapter_batch.settled = true;
+			LOG_DEBUG("flush latency %.1f us, %.3f us per command, batch size %u",
+				intercept, slope, adapter_batch.estimate);
+			return;
+		}
+	}
+
+	if (adapter_batch.samples >= ADAPTER_BATCH_MAX_SAMPLES) {
+		LOG_DEBUG("no batch size estimate after %u flushes", adapter_batch.samples);
+		adapter_batch.settled = true;
+	}
+}
+
+unsigned int adapter_get_batch_size(void)
+{
+	if (adapter_batch.forced)
+		return adapter_batch.forced;
+
+	return adapter_batch.estimate;
+}
+
+static unsigned int adapter_stats_bucket(uint64_t value)
+{
+	unsigned int bucket = 0;
+
+	while (value && bucket < ADAPTER_STATS_BUCKETS - 1) {
+		value >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+void adapter_stats_flush(unsigned int commands, uint64_t bits, int64_t elapsed_us)
+{
+	if (elapsed_us < 0)
+		elapsed_us = 0;
+
+	adapter_batch_sample(commands, elapsed_us);
+
+	if (!adapter_stats.enabled)
+		return;
+
+	adapter_stats.flushes++;
+	adapter_stats.commands += commands;
+	adapter_stats.bits += bits;
+	adapter_stats.time_us += elapsed_us;
+	if ((uint64_t)elapsed_us > adapter_stats.max_time_us)
+		adapter_stats.max_time_us = elapsed_us;
+	adapter_stats.time_hist[adapter_stats_bucket(elapsed_us)]++;
+	adapter_stats.commands_hist[adapter_stats_bucket(commands)]++;
+}
+
+void adapter_stats_usb(size_t bytes_out, size_t bytes_in)
+{
+	if (!adapter_stats.enabled)
+		return;
+
+	adapter_stats.usb_bytes_out += bytes_out;
+	adapter_stats.usb_bytes_in += bytes_in;
+}
+
+/* USB transfers log, see "adapter usb record" */
+static struct {
+	FILE *file;
+	int64_t start_us;
+} adapter_usb_rec;
+
+void adapter_usb_record(bool in, unsigned int endpoint, const uint8_t *data, size_t len)
+{
+	FILE *f = adapter_usb_rec.file;
+	if (!f)
+		return;
+
+	fprintf(f, "%" PRId64 " %s %02x ", timeval_us() - adapter_usb_rec.start_us,
+		in ? "in" : "out", endpoint);
+	for (size_t i = 0; i < len; i++)
+		fprintf(f, "%02x", data[i]);
+	fputc('\n', f);
+}
+
+static void adapter_usb_record_close(void)
+{
+	if (adapter_usb_rec.file) {
+		fclose(adapter_usb_rec.file);
+		adapter_usb_rec.file = NULL;
+	}
+}
+
+static void adapter_stats_reset(void)
+{
+	bool enabled = adapter_stats.enabled;
+
+	memset(&adapter_stats, 0, sizeof(adapter_stats));
+	adapter_stats.enabled = enabled;
+}
+
 /* For convenience of the bit-banging drivers keep the gpio_config drive
  * settings for srst and trst in sync with values set by the "adapter
  * reset_config" command.
@@ -150,6 +342,7 @@ int adapter_init(struct command_context *cmd_ctx)
 	if (retval != ERROR_OK)
 		return retval;
 	adapter_config.adapter_initialized = true;
+	adapter_batch_restart();
 
 	if (!adapter_driver->speed) {
 		LOG_INFO("Note: The adapter \"%s\" doesn't support configurable speed", adapter_driver->name);
@@ -191,6 +384,8 @@ int adapter_quit(void)
 			LOG_ERROR("failed: %d", result);
 	}
 
+	adapter_usb_record_close();
+
 	free(adapter_config.serial);
 	free(adapter_config.usb_location);
 
@@ -389,6 +584,117 @@ COMMAND_HANDLER(handle_adapter_name)
 	return ERROR_OK;
 }
 
+static void adapter_stats_print_hist(struct command_invocation *cmd,
+		const char *name, const uint64_t *hist)
+{
+	command_print(cmd, "%s:", name);
+	for (unsigned int i = 0; i < ADAPTER_STATS_BUCKETS; i++) {
+		if (!hist[i])
+			continue;
+		if (i == 0)
+			command_print(cmd, "  %10s 0: %" PRIu64, "", hist[i]);
+		else if (i == ADAPTER_STATS_BUCKETS - 1)
+			command_print(cmd, "  %10s >= %" PRIu64 ": %" PRIu64, "", (uint64_t)1 << (i - 1), hist[i]);
+		else
+			command_print(cmd, "  %10" PRIu64 " .. %" PRIu64 ": %" PRIu64,
+				(uint64_t)1 << (i - 1), ((uint64_t)1 << i) - 1, hist[i]);
+	}
+}
+
+static void adapter_stats_dump_hist(struct command_invocation *cmd,
+		const char *name, const uint64_t *hist)
+{
+	command_print_sameline(cmd, " %s {", name);
+	for (unsigned int i = 0; i < ADAPTER_STATS_BUCKETS; i++)
+		command_print_sameline(cmd, "%s%" PRIu64, i ? " " : "", hist[i]);
+	command_print_sameline(cmd, "}");
+}
+
+COMMAND_HANDLER(handle_adapter_stats_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		if (!strcmp(CMD_ARGV[0], "reset")) {
+			adapter_stats_reset();
+			return ERROR_OK;
+		}
+
+		if (!strcmp(CMD_ARGV[0], "dump")) {
+			/* A Tcl dict, for scripts */
+			command_print_sameline(CMD, "enabled %d flushes %" PRIu64 " commands %" PRIu64
+				" bits %" PRIu64 " usb_bytes_out %" PRIu64 " usb_bytes_in %" PRIu64
+				" time_us %" PRIu64 " max_time_us %" PRIu64,
+				adapter_stats.enabled, adapter_stats.flushes, adapter_stats.commands,
+				adapter_stats.bits, adapter_stats.usb_bytes_out, adapter_stats.usb_bytes_in,
+				adapter_stats.time_us, adapter_stats.max_time_us);
+			adapter_stats_dump_hist(CMD, "time_hist", adapter_stats.time_hist);
+			adapter_stats_dump_hist(CMD, "commands_hist", adapter_stats.commands_hist);
+			return ERROR_OK;
+		}
+
+		bool enable;
+		COMMAND_PARSE_ENABLE(CMD_ARGV[0], enable);
+		adapter_stats.enabled = enable;
+		return ERROR_OK;
+	}
+
+	if (!adapter_stats.enabled) {
+		command_print(CMD, "adapter statistics are disabled");
+		return ERROR_OK;
+	}
+
+	uint64_t flushes = adapter_stats.flushes;
+	command_print(CMD, "flushes:            %" PRIu64, flushes);
+	command_print(CMD, "commands:           %" PRIu64 " (%" PRIu64 " per flush)",
+		adapter_stats.commands, flushes ? adapter_stats.commands / flushes : 0);
+	command_print(CMD, "bits shifted:       %" PRIu64, adapter_stats.bits);
+	command_print(CMD, "USB bytes out / in: %" PRIu64 " / %" PRIu64,
+		adapter_stats.usb_bytes_out, adapter_stats.usb_bytes_in);
+	command_print(CMD, "flush time:         %" PRIu64 " us (%" PRIu64 " us per flush, max %" PRIu64 " us)",
+		adapter_stats.time_us, flushes ? adapter_stats.time_us / flushes : 0,
+		adapter_stats.max_time_us);
+	adapter_stats_print_hist(CMD, "flush time histogram (us)", adapter_stats.time_hist);
+	adapter_stats_print_hist(CMD, "commands per flush histogram", adapter_stats.commands_hist);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_adapter_batch_size_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		if (!strcmp(CMD_ARGV[0], "auto")) {
+			adapter_batch.forced = 0;
+			adapter_batch_restart();
+		} else {
+			unsigned int size;
+			COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], size);
+			if (!size)
+				return ERROR_COMMAND_ARGUMENT_INVALID;
+			adapter_batch.forced = size;
+		}
+	}
+
+	if (adapter_batch.forced) {
+		command_print(CMD, "batch size %u (forced)", adapter_batch.forced);
+	} else if (adapter_batch.estimate) {
+		command_print(CMD, "batch size %u (flush latency %.1f us, %.3f us per command)",
+			adapter_batch.estimate, adapter_batch.latency_us,
+			adapter_batch.per_command_us);
+	} else if (adapter_batch.settled) {
+		command_print(CMD, "batch size not known, flush times did not fit");
+	} else {
+		command_print(CMD, "batch size not known yet, %u flushes measured",
+			adapter_batch.samples);
+	}
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(adapter_transports_command)
 {
 	char **transports;
@@ -426,9 +732,15 @@ COMMAND_HANDLER(handle_adapter_driver_command)
 {
 	int retval;
 
-	/* check whether the interface is already configured */
+	/* check whether the interface is already configured, a config file given
+	 * first on the command line can override the one sourced by a board file */
 	if (adapter_driver) {
-		LOG_WARNING("Interface already configured, ignoring");
+		if (CMD_ARGC == 1 && strcmp(CMD_ARGV[0], adapter_driver->name))
+			LOG_WARNING("Interface already configured as '%s', ignoring '%s'; "
+				"only one adapter per OpenOCD instance is supported",
+				adapter_driver->name, CMD_ARGV[0]);
+		else
+			LOG_WARNING("Interface already configured, ignoring");
 		return ERROR_OK;
 	}
 
@@ -1056,7 +1368,33 @@ COMMAND_HANDLER(handle_usb_location_command)
 }
 #endif /* HAVE_LIBUSB_GET_PORT_NUMBERS */
 
+COMMAND_HANDLER(handle_usb_record_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	adapter_usb_record_close();
+	if (!strcmp(CMD_ARGV[0], "off"))
+		return ERROR_OK;
+
+	adapter_usb_rec.file = fopen(CMD_ARGV[0], "w");
+	if (!adapter_usb_rec.file) {
+		command_print(CMD, "cannot open %s: %s", CMD_ARGV[0], strerror(errno));
+		return ERROR_FAIL;
+	}
+	adapter_usb_rec.start_us = timeval_us();
+
+	return ERROR_OK;
+}
+
 static const struct command_registration adapter_usb_command_handlers[] = {
+	{
+		.name = "record",
+		.handler = &handle_usb_record_command,
+		.mode = COMMAND_ANY,
+		.help = "log the USB transfers with the adapter to a file, or stop logging",
+		.usage = "filename|'off'",
+	},
 #ifdef HAVE_LIBUSB_GET_PORT_NUMBERS
 	{
 		.name = "location",
@@ -1127,6 +1465,22 @@ static const struct command_registration adapter_command_handlers[] = {
 			"selected adapter (driver)",
 		.usage = "",
 	},
+	{
+		.name = "batch_size",
+		.mode = COMMAND_ANY,
+		.handler = handle_adapter_batch_size_command,
+		.help = "Show the recommended number of transfers per queue "
+			"flush, force it or let it be measured again",
+		.usage = "['auto'|size]",
+	},
+	{
+		.name = "stats",
+		.mode = COMMAND_ANY,
+		.handler = handle_adapter_stats_command,
+		.help = "Show, reset, enable or disable the statistics of the "
+			"JTAG/SWD queue flushes",
+		.usage = "['enable'|'disable'|'reset'|'dump']",
+	},
 	{
 		.name = "srst",
 		.mode = COMMAND_ANY,
@@ -124,4 +124,44 @@ const struct adapter_gpio_config *adapter_gpio_get_config(void);
 
 #define ADAPTER_GPIO_NOT_SET UINT_MAX
 
+/**
+ * @returns true if the queue flushes have to be timed and reported by
+ * adapter_stats_flush(), for the statistics or the batch size estimation.
+ */
+bool adapter_flush_timed(void);
+
+/**
+ * Account one flush of the JTAG or SWD queue in the adapter statistics
+ * and in the estimation of the batch size.
+ * @param commands The number of commands (JTAG) or transfers (SWD) flushed.
+ * @param bits The number of bits shifted by JTAG scans, if known.
+ * @param elapsed_us The wall time spent executing the queue.
+ */
+void adapter_stats_flush(unsigned int commands, uint64_t bits, int64_t elapsed_us);
+
+/** Account bytes exchanged with an USB adapter in the adapter statistics. */
+void adapter_stats_usb(size_t bytes_out, size_t bytes_in);
+
+/**
+ * Log an USB transfer to the file set with "adapter usb record", if any.
+ * @param in True for a transfer from the adapter.
+ * @param endpoint The endpoint address, 0 when not relevant.
+ */
+void adapter_usb_record(bool in, unsigned int endpoint, const uint8_t *data, size_t len);
+
+/**
+ * @returns the number of commands worth queuing before a flush with the
+ * current adapter, JTAG commands or SWD transfers, measured after adapter
+ * init or forced by the user, or 0 if not known. Callers use their own
+ * default for 0.
+ */
+unsigned int adapter_get_batch_size(void);
+
+/**
+ * Drain the trace data of the debug adapter into a host buffer, so that
+ * long running commands do not let the buffer of the adapter overflow.
+ * Called from keep_alive(), adapter_poll_trace() returns the data later.
+ */
+void adapter_trace_pump(void);
+
 #endif /* OPENOCD_JTAG_ADAPTER_H */
@@ -33,6 +33,15 @@ struct cmd_queue_page {
 static struct cmd_queue_page *cmd_queue_pages;
 static struct cmd_queue_page *cmd_queue_pages_tail;
 
+/* Upper limit of pages kept on the free list between queue flushes */
+#define CMD_QUEUE_MAX_FREE_PAGES 16
+
+/* Pages released by jtag_command_queue_reset(), ready to be reused */
+static struct cmd_queue_page *cmd_queue_free_pages;
+static unsigned int cmd_queue_free_pages_count;
+
+static struct cmd_queue_stats cmd_queue_stats;
+
 static struct jtag_command *jtag_command_queue;
 static struct jtag_command **next_command_pointer = &jtag_command_queue;
 
@@ -108,35 +117,79 @@ void *cmd_queue_alloc(size_t size)
 	}
 
 	if (!*p_page) {
-		*p_page = malloc(sizeof(struct cmd_queue_page));
+		if (cmd_queue_free_pages && size <= CMD_QUEUE_PAGE_SIZE) {
+			*p_page = cmd_queue_free_pages;
+			cmd_queue_free_pages = cmd_queue_free_pages->next;
+			cmd_queue_free_pages_count--;
+			cmd_queue_stats.reuse_hits++;
+		} else {
+			*p_page = malloc(sizeof(struct cmd_queue_page));
+			size_t alloc_size = (size < CMD_QUEUE_PAGE_SIZE) ?
+						CMD_QUEUE_PAGE_SIZE : size;
+			(*p_page)->address = malloc(alloc_size);
+			cmd_queue_stats.page_allocs++;
+		}
 		(*p_page)->used = 0;
-		size_t alloc_size = (size < CMD_QUEUE_PAGE_SIZE) ?
-					CMD_QUEUE_PAGE_SIZE : size;
-		(*p_page)->address = malloc(alloc_size);
 		(*p_page)->next = NULL;
 		cmd_queue_pages_tail = *p_page;
+
+		cmd_queue_stats.pages_in_use++;
+		if (cmd_queue_stats.pages_in_use > cmd_queue_stats.peak_pages)
+			cmd_queue_stats.peak_pages = cmd_queue_stats.pages_in_use;
 	}
 
 	offset = (*p_page)->used;
 	(*p_page)->used += size;
 
+	cmd_queue_stats.bytes_in_use += size;
+	if (cmd_queue_stats.bytes_in_use > cmd_queue_stats.peak_bytes)
+		cmd_queue_stats.peak_bytes = cmd_queue_stats.bytes_in_use;
+
 	t = (*p_page)->address;
 	return t + offset;
 }
 
-static void cmd_queue_free(void)
+/**
+ * Release the pages of the command queue.
+ *
+ * Standard size pages are kept on a free list, bounded by the peak number
+ * of pages ever used by a single queue, so following flushes don't have
+ * to go through malloc() and free() again.
+ */
+static void cmd_queue_release_pages(struct cmd_queue_page *page)
 {
-	struct cmd_queue_page *page = cmd_queue_pages;
+	unsigned int max_free = MIN(cmd_queue_stats.peak_pages, CMD_QUEUE_MAX_FREE_PAGES);
 
 	while (page) {
 		struct cmd_queue_page *last = page;
-		free(page->address);
 		page = page->next;
-		free(last);
+
+		/* oversized pages are only used by a single huge allocation */
+		if (last->used <= CMD_QUEUE_PAGE_SIZE && cmd_queue_free_pages_count < max_free) {
+			last->next = cmd_queue_free_pages;
+			cmd_queue_free_pages = last;
+			cmd_queue_free_pages_count++;
+		} else {
+			free(last->address);
+			free(last);
+		}
 	}
+}
+
+static void cmd_queue_free(void)
+{
+	cmd_queue_release_pages(cmd_queue_pages);
 
 	cmd_queue_pages = NULL;
 	cmd_queue_pages_tail = NULL;
+	cmd_queue_stats.pages_in_use = 0;
+	cmd_queue_stats.bytes_in_use = 0;
+}
+
+void cmd_queue_get_stats(struct cmd_queue_stats *stats)
+{
+	*stats = cmd_queue_stats;
+	stats->free_pages = cmd_queue_free_pages_count;
 }
 
 void jtag_command_queue_reset(void)
@@ -152,6 +205,143 @@ struct jtag_command *jtag_command_queue_get(void)
 	return jtag_command_queue;
 }
 
+/**
+ * A command queue detached from the core, together with the memory
+ * backing it, while an adapter executes it asynchronously.
+ */
+struct cmd_queue_batch {
+	struct cmd_queue_page *pages;
+	struct jtag_command *commands;
+};
+
+struct cmd_queue_batch *jtag_command_queue_detach(void)
+{
+	struct cmd_queue_batch *batch = malloc(sizeof(*batch));
+	if (!batch)
+		return NULL;
+
+	batch->pages = cmd_queue_pages;
+	batch->commands = jtag_command_queue;
+
+	cmd_queue_pages = NULL;
+	cmd_queue_pages_tail = NULL;
+	cmd_queue_stats.pages_in_use = 0;
+	cmd_queue_stats.bytes_in_use = 0;
+
+	jtag_command_queue = NULL;
+	next_command_pointer = &jtag_command_queue;
+
+	return batch;
+}
+
+struct jtag_command *jtag_command_queue_batch_get(const struct cmd_queue_batch *batch)
+{
+	return batch->commands;
+}
+
+void jtag_command_queue_batch_free(struct cmd_queue_batch *batch)
+{
+	if (!batch)
+		return;
+
+	cmd_queue_release_pages(batch->pages);
+	free(batch);
+}
+
+/**
+ * Check if two consecutive commands can be replaced by a single one
+ * without changing what is clocked on the wire.
+ */
+static bool jtag_command_can_merge(const struct jtag_command *cmd,
+		const struct jtag_command *next)
+{
+	if (cmd->type != next->type)
+		return false;
+
+	switch (cmd->type) {
+	case JTAG_SCAN:
+		/* a scan left in the shift state is simply continued by the next one */
+		if (cmd->cmd.scan->ir_scan != next->cmd.scan->ir_scan)
+			return false;
+		return cmd->cmd.scan->end_state ==
+			(cmd->cmd.scan->ir_scan ? TAP_IRSHIFT : TAP_DRSHIFT);
+	case JTAG_RUNTEST:
+		/* the second runtest starts by moving to IDLE, where we already are */
+		if (cmd->cmd.runtest->end_state != TAP_IDLE)
+			return false;
+		return cmd->cmd.runtest->num_cycles <= UINT_MAX - next->cmd.runtest->num_cycles;
+	case JTAG_STABLECLOCKS:
+		return cmd->cmd.stableclocks->num_cycles <= UINT_MAX - next->cmd.stableclocks->num_cycles;
+	case JTAG_SLEEP:
+		return cmd->cmd.sleep->us <= UINT32_MAX - next->cmd.sleep->us;
+	default:
+		return false;
+	}
+}
+
+static void jtag_command_merge(struct jtag_command *cmd, const struct jtag_command *next)
+{
+	switch (cmd->type) {
+	case JTAG_SCAN:
+		{
+			struct scan_command *scan = cmd->cmd.scan;
+			const struct scan_command *next_scan = next->cmd.scan;
+			unsigned int num_fields = scan->num_fields + next_scan->num_fields;
+			struct scan_field *fields = cmd_queue_alloc(num_fields * sizeof(struct scan_field));
+
+			memcpy(fields, scan->fields, scan->num_fields * sizeof(struct scan_field));
+			memcpy(fields + scan->num_fields, next_scan->fields,
+					next_scan->num_fields * sizeof(struct scan_field));
+			scan->fields = fields;
+			scan->num_fields = num_fields;
+			scan->end_state = next_scan->end_state;
+		}
+		break;
+	case JTAG_RUNTEST:
+		cmd->cmd.runtest->num_cycles += next->cmd.runtest->num_cycles;
+		cmd->cmd.runtest->end_state = next->cmd.runtest->end_state;
+		break;
+	case JTAG_STABLECLOCKS:
+		cmd->cmd.stableclocks->num_cycles += next->cmd.stableclocks->num_cycles;
+		break;
+	case JTAG_SLEEP:
+		cmd->cmd.sleep->us += next->cmd.sleep->us;
+		break;
+	default:
+		assert(false);
+	}
+}
+
+/**
+ * Coalesce adjacent commands in the pending queue before it is passed to the
+ * adapter driver, so drivers with a high per-command cost see fewer and
+ * larger operations.
+ *
+ * The merge is only done when the result is indistinguishable on the wire:
+ * scans continuing a scan that ended in the same shift state, runtest
+ * following a runtest that ended in IDLE, and consecutive stableclocks or
+ * sleep commands.
+ *
+ * @returns the number of commands removed from the queue.
+ */
+unsigned int jtag_command_queue_coalesce(void)
+{
+	unsigned int removed = 0;
+
+	for (struct jtag_command *cmd = jtag_command_queue; cmd; cmd = cmd->next) {
+		while (cmd->next && jtag_command_can_merge(cmd, cmd->next)) {
+			jtag_command_merge(cmd, cmd->next);
+			cmd->next = cmd->next->next;
+			removed++;
+		}
+
+		if (!cmd->next)
+			next_command_pointer = &cmd->next;
+	}
+
+	return removed;
+}
+
 /**
  * Copy a struct scan_field for insertion into the queue.
  *
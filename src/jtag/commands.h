@@ -149,11 +149,42 @@ struct jtag_command {
 	struct jtag_command *next;
 };
 
+/** Usage statistics of the memory backing the JTAG command queue. */
+struct cmd_queue_stats {
+	/** number of pages currently holding queued commands */
+	unsigned int pages_in_use;
+	/** highest number of pages used by a single queue */
+	unsigned int peak_pages;
+	/** number of released pages kept for reuse */
+	unsigned int free_pages;
+	/** bytes currently allocated from the queue */
+	size_t bytes_in_use;
+	/** highest number of bytes allocated by a single queue */
+	size_t peak_bytes;
+	/** pages obtained from malloc() */
+	unsigned long long page_allocs;
+	/** pages recycled from the free list */
+	unsigned long long reuse_hits;
+};
+
 void *cmd_queue_alloc(size_t size);
+void cmd_queue_get_stats(struct cmd_queue_stats *stats);
 
 void jtag_queue_command(struct jtag_command *cmd);
 void jtag_command_queue_reset(void);
 struct jtag_command *jtag_command_queue_get(void);
+unsigned int jtag_command_queue_coalesce(void);
+
+struct cmd_queue_batch;
+
+/**
+ * Take the pending command queue, and the memory backing it, away from the
+ * core so a new queue can be built while the detached one is executed.
+ * @returns the detached batch, or NULL on allocation failure.
+ */
+struct cmd_queue_batch *jtag_command_queue_detach(void);
+struct jtag_command *jtag_command_queue_batch_get(const struct cmd_queue_batch *batch);
+void jtag_command_queue_batch_free(struct cmd_queue_batch *batch);
 
 void jtag_scan_field_clone(struct scan_field *dst, const struct scan_field *src);
 enum scan_type jtag_scan_type(const struct scan_command *cmd);
@@ -24,8 +24,11 @@
 #include "swd.h"
 #include "interface.h"
 #include <transport/transport.h>
+#include <helper/event_log.h>
 #include <helper/jep106.h>
+#include <helper/perf.h>
 #include "helper/system.h"
+#include <helper/time_support.h>
 
 #ifdef HAVE_STRINGS_H
 #include <strings.h>
@@ -353,13 +356,62 @@ static void jtag_prelude(tap_state_t state)
 	cmd_queue_cur_state = state;
 }
 
+static bool jtag_ir_cache_enabled;
+/* the TAP selected by the last IR scan, all the others being in BYPASS */
+static struct jtag_tap *jtag_ir_cache_tap;
+/* number of TAPs enabled at the time of that IR scan */
+static unsigned int jtag_ir_cache_num_taps;
+
+void jtag_set_ir_cache(bool enable)
+{
+	jtag_ir_cache_enabled = enable;
+	jtag_ir_cache_tap = NULL;
+}
+
+bool jtag_will_use_ir_cache(void)
+{
+	return jtag_ir_cache_enabled;
+}
+
+/**
+ * @returns True if the IR scan would only reload the instructions the
+ * chain already holds. Scans whose captured value is wanted are never
+ * skipped, nor those which would move the TAP to another state.
+ */
+static bool jtag_ir_cache_hit(struct jtag_tap *active, const struct scan_field *in_fields,
+	tap_state_t state)
+{
+	if (!jtag_ir_cache_tap || active != jtag_ir_cache_tap)
+		return false;
+
+	if (in_fields->in_value || !in_fields->out_value ||
+			in_fields->num_bits != active->ir_length ||
+			state != cmd_queue_cur_state)
+		return false;
+
+	if (buf_cmp(in_fields->out_value, active->cur_instr, active->ir_length))
+		return false;
+
+	return jtag_tap_count_enabled() == jtag_ir_cache_num_taps;
+}
+
 void jtag_add_ir_scan_noverify(struct jtag_tap *active, const struct scan_field *in_fields,
 	tap_state_t state)
 {
+	if (jtag_ir_cache_hit(active, in_fields, state))
+		return;
+
 	jtag_prelude(state);
 
 	int retval = interface_jtag_add_ir_scan(active, in_fields, state);
 	jtag_set_error(retval);
+
+	if (retval == ERROR_OK && jtag_ir_cache_enabled) {
+		jtag_ir_cache_tap = active;
+		jtag_ir_cache_num_taps = jtag_tap_count_enabled();
+	} else {
+		jtag_ir_cache_tap = NULL;
+	}
 }
 
 static void jtag_add_ir_scan_noverify_callback(struct jtag_tap *active,
@@ -375,6 +427,9 @@ void jtag_add_ir_scan(struct jtag_tap *active, struct scan_field *in_fields, tap
 {
 	assert(state != TAP_RESET);
 
+	if (jtag_ir_cache_hit(active, in_fields, state))
+		return;
+
 	if (jtag_verify && jtag_verify_capture_ir) {
 		/* 8 x 32 bit id's is enough for all invocations */
 
@@ -396,6 +451,7 @@ void jtag_add_plain_ir_scan(int num_bits, const uint8_t *out_bits, uint8_t *in_b
 	assert(state != TAP_RESET);
 
 	jtag_prelude(state);
+	jtag_ir_cache_tap = NULL;
 
 	int retval = interface_jtag_add_plain_ir_scan(
 			num_bits, out_bits, in_bits, state);
@@ -405,15 +461,87 @@ void jtag_add_plain_ir_scan(int num_bits, const uint8_t *out_bits, uint8_t *in_b
 static int jtag_check_value_inner(uint8_t *captured, uint8_t *in_check_value,
 				  uint8_t *in_check_mask, int num_bits);
 
-static int jtag_check_value_mask_callback(jtag_callback_data_t data0,
+/* Number of captured fields checked per chunk of the deferred check list */
+#define JTAG_CHECK_CHUNK_SIZE 64
+
+struct jtag_check {
+	uint8_t *captured;
+	uint8_t *value;
+	uint8_t *mask;
+	unsigned int num_bits;
+};
+
+/**
+ * Checks of captured fields, deferred until the queue they belong to has
+ * been executed. Chunks are allocated from the command queue, so they are
+ * released together with it.
+ */
+struct jtag_check_chunk {
+	struct jtag_check_chunk *next;
+	unsigned int count;
+	struct jtag_check checks[JTAG_CHECK_CHUNK_SIZE];
+};
+
+static struct jtag_check_chunk *jtag_check_chunk_tail;
+/* value of jtag_flush_queue_count for the queue owning the check list */
+static unsigned int jtag_check_flush_count;
+
+static int jtag_check_deferred_callback(jtag_callback_data_t data0,
 	jtag_callback_data_t data1,
 	jtag_callback_data_t data2,
 	jtag_callback_data_t data3)
 {
-	return jtag_check_value_inner((uint8_t *)data0,
-		(uint8_t *)data1,
-		(uint8_t *)data2,
-		(int)data3);
+	unsigned int index = 0;
+
+	for (struct jtag_check_chunk *chunk = (struct jtag_check_chunk *)data0; chunk; chunk = chunk->next) {
+		for (unsigned int i = 0; i < chunk->count; i++, index++) {
+			const struct jtag_check *check = &chunk->checks[i];
+			bool compare_failed;
+
+			if (check->mask)
+				compare_failed = buf_cmp_mask(check->captured, check->value, check->mask, check->num_bits);
+			else
+				compare_failed = buf_cmp(check->captured, check->value, check->num_bits);
+
+			if (compare_failed) {
+				/* report the first mismatch only */
+				LOG_WARNING("Check of field %u captured by this JTAG queue failed:", index);
+				return jtag_check_value_inner(check->captured, check->value, check->mask,
+					check->num_bits);
+			}
+		}
+	}
+
+	return ERROR_OK;
+}
+
+static void jtag_add_check(uint8_t *captured, uint8_t *value, uint8_t *mask, unsigned int num_bits)
+{
+	struct jtag_check_chunk *chunk = jtag_check_chunk_tail;
+
+	/* start a new list, with its own callback, for each new queue */
+	if (!chunk || jtag_check_flush_count != jtag_flush_queue_count) {
+		chunk = cmd_queue_alloc(sizeof(*chunk));
+		chunk->next = NULL;
+		chunk->count = 0;
+		jtag_check_chunk_tail = chunk;
+		jtag_check_flush_count = jtag_flush_queue_count;
+		jtag_add_callback4(jtag_check_deferred_callback,
+			(jtag_callback_data_t)chunk, 0, 0, 0);
+	} else if (chunk->count == JTAG_CHECK_CHUNK_SIZE) {
+		chunk->next = cmd_queue_alloc(sizeof(*chunk));
+		chunk = chunk->next;
+		chunk->next = NULL;
+		chunk->count = 0;
+		jtag_check_chunk_tail = chunk;
+	}
+
+	chunk->checks[chunk->count++] = (struct jtag_check) {
+		.captured = captured,
+		.value = value,
+		.mask = mask,
+		.num_bits = num_bits,
+	};
 }
 
 static void jtag_add_scan_check(struct jtag_tap *active, void (*jtag_add_scan)(
@@ -427,11 +555,8 @@ static void jtag_add_scan_check(struct jtag_tap *active, void (*jtag_add_scan)(
 
 	for (int i = 0; i < in_num_fields; i++) {
 		if ((in_fields[i].check_value) && (in_fields[i].in_value)) {
-			jtag_add_callback4(jtag_check_value_mask_callback,
-				(jtag_callback_data_t)in_fields[i].in_value,
-				(jtag_callback_data_t)in_fields[i].check_value,
-				(jtag_callback_data_t)in_fields[i].check_mask,
-				(jtag_callback_data_t)in_fields[i].num_bits);
+			jtag_add_check(in_fields[i].in_value, in_fields[i].check_value,
+				in_fields[i].check_mask, in_fields[i].num_bits);
 		}
 	}
 }
@@ -475,6 +600,33 @@ void jtag_add_plain_dr_scan(int num_bits, const uint8_t *out_bits, uint8_t *in_b
 	jtag_set_error(retval);
 }
 
+void jtag_add_dr_scan_nocopy(struct jtag_tap *active,
+	int in_num_fields,
+	const struct scan_field *in_fields,
+	tap_state_t state)
+{
+	assert(state != TAP_RESET);
+
+	jtag_prelude(state);
+
+	int retval;
+	retval = interface_jtag_add_dr_scan_nocopy(active, in_num_fields, in_fields, state);
+	jtag_set_error(retval);
+}
+
+void jtag_add_plain_dr_scan_nocopy(int num_bits, const uint8_t *out_bits, uint8_t *in_bits,
+	tap_state_t state)
+{
+	assert(out_bits);
+	assert(state != TAP_RESET);
+
+	jtag_prelude(state);
+
+	int retval;
+	retval = interface_jtag_add_plain_dr_scan_nocopy(num_bits, out_bits, in_bits, state);
+	jtag_set_error(retval);
+}
+
 void jtag_add_tlr(void)
 {
 	jtag_prelude(TAP_RESET);
@@ -508,6 +660,7 @@ int jtag_add_tms_seq(unsigned int nbits, const uint8_t *seq, enum tap_state stat
 
 	jtag_checks();
 	cmd_queue_cur_state = state;
+	jtag_ir_cache_tap = NULL;
 
 	retval = interface_add_tms_seq(nbits, seq, state);
 	jtag_set_error(retval);
@@ -540,6 +693,10 @@ void jtag_add_pathmove(unsigned int num_states, const tap_state_t *path)
 			return;
 		}
 		cur_state = path[i];
+
+		/* the IR gets loaded with its captured value */
+		if (cur_state == TAP_IRCAPTURE)
+			jtag_ir_cache_tap = NULL;
 	}
 
 	jtag_checks();
@@ -579,6 +736,19 @@ int jtag_add_statemove(tap_state_t goal_state)
 			moves[i] = cur_state;
 		}
 
+		jtag_add_pathmove(tms_count, moves);
+	} else if (tap_is_state_stable(goal_state)) {
+		/* leaving a transient state, e.g. after a pathmove */
+		unsigned int tms_bits  = tap_get_tms_path_any(cur_state, goal_state);
+		unsigned int tms_count = tap_get_tms_path_any_len(cur_state, goal_state);
+		tap_state_t moves[8];
+		assert(tms_count <= ARRAY_SIZE(moves));
+
+		for (unsigned int i = 0; i < tms_count; i++, tms_bits >>= 1) {
+			cur_state = tap_state_transition(cur_state, tms_bits & 1);
+			moves[i] = cur_state;
+		}
+
 		jtag_add_pathmove(tms_count, moves);
 	} else if (tap_state_transition(cur_state, true)  == goal_state
 			|| tap_state_transition(cur_state, false) == goal_state)
@@ -951,9 +1121,31 @@ int default_interface_jtag_execute_queue(void)
 			return ERROR_OK;
 	}
 
+	unsigned int coalesced = jtag_command_queue_coalesce();
+	if (coalesced)
+		LOG_DEBUG_IO("JTAG queue: coalesced %u commands", coalesced);
+
 	struct jtag_command *cmd = jtag_command_queue_get();
+
+	bool stats = adapter_flush_timed();
+	unsigned int stats_commands = 0;
+	uint64_t stats_bits = 0;
+	int64_t stats_start = 0;
+	if (stats) {
+		for (struct jtag_command *c = cmd; c; c = c->next) {
+			stats_commands++;
+			if (c->type == JTAG_SCAN)
+				stats_bits += jtag_scan_size(c->cmd.scan);
+		}
+		stats_start = timeval_us();
+	}
+
+	perf_count_flush();
 	int result = adapter_driver->jtag_ops->execute_queue(cmd);
 
+	if (stats)
+		adapter_stats_flush(stats_commands, stats_bits, timeval_us() - stats_start);
+
 	while (debug_level >= LOG_LVL_DEBUG_IO && cmd) {
 		switch (cmd->type) {
 			case JTAG_SCAN:
@@ -1018,7 +1210,14 @@ int default_interface_jtag_execute_queue(void)
 void jtag_execute_queue_noclear(void)
 {
 	jtag_flush_queue_count++;
-	jtag_set_error(interface_jtag_execute_queue());
+	event_log_begin(EVENT_LOG_JTAG_FLUSH, jtag_flush_queue_count);
+	int retval = interface_jtag_execute_queue();
+	event_log_end(EVENT_LOG_JTAG_FLUSH, retval);
+	jtag_set_error(retval);
+
+	/* the instructions held by the chain are unknown after a failure */
+	if (retval != ERROR_OK)
+		jtag_ir_cache_tap = NULL;
 
 	if (jtag_flush_queue_sleep > 0) {
 		/* For debug purposes it can be useful to test performance
@@ -1029,6 +1228,29 @@ void jtag_execute_queue_noclear(void)
 	}
 }
 
+int jtag_execute_queue_async(jtag_queue_done_callback_t done, void *priv)
+{
+	if (!is_adapter_initialized() || !transport_is_jtag() ||
+			!adapter_driver->jtag_ops->execute_queue_async) {
+		int retval = jtag_execute_queue();
+		if (done)
+			done(retval, priv);
+		return retval;
+	}
+
+	jtag_flush_queue_count++;
+	perf_count_flush();
+	event_log_begin(EVENT_LOG_JTAG_FLUSH, jtag_flush_queue_count);
+	int retval = interface_jtag_execute_queue_async(done, priv);
+	event_log_end(EVENT_LOG_JTAG_FLUSH, retval);
+	return retval;
+}
+
+int jtag_execute_queue_wait(void)
+{
+	return interface_jtag_execute_queue_wait();
+}
+
 unsigned int jtag_get_flush_queue_count(void)
 {
 	return jtag_flush_queue_count;
@@ -1050,6 +1272,7 @@ static int jtag_reset_callback(enum jtag_event event, void *priv)
 		/* current instruction is either BYPASS or IDCODE */
 		buf_set_ones(tap->cur_instr, tap->ir_length);
 		tap->bypass = true;
+		jtag_ir_cache_tap = NULL;
 	}
 
 	return ERROR_OK;
@@ -1210,6 +1433,146 @@ static bool jtag_examine_chain_match_tap(const struct jtag_tap *tap)
 	return false;
 }
 
+/**
+ * Fingerprint of the scan chain found by the last complete examination,
+ * used to skip most of it when reconnecting to the same chain.
+ */
+static struct {
+	bool valid;
+	/* serial number of the adapter, if any was required */
+	char *serial;
+	unsigned int num_taps;
+	unsigned int total_ir_length;
+	/* length of the IDCODE/BYPASS data of all the TAPs */
+	unsigned int idcode_bits;
+	/* IDCODE (or BYPASS bit) of the first and last TAP */
+	unsigned int first_bits;
+	uint32_t first_idcode;
+	unsigned int last_offset;
+	unsigned int last_bits;
+	uint32_t last_idcode;
+} jtag_chain_cache;
+
+static bool jtag_chain_cache_enabled;
+
+static void jtag_chain_cache_clear(void)
+{
+	free(jtag_chain_cache.serial);
+	memset(&jtag_chain_cache, 0, sizeof(jtag_chain_cache));
+}
+
+void jtag_set_chain_cache(bool enable)
+{
+	jtag_chain_cache_enabled = enable;
+	if (!enable)
+		jtag_chain_cache_clear();
+}
+
+bool jtag_will_use_chain_cache(void)
+{
+	return jtag_chain_cache_enabled;
+}
+
+static void jtag_chain_cache_save(void)
+{
+	jtag_chain_cache_clear();
+
+	if (!jtag_chain_cache_enabled)
+		return;
+
+	unsigned int bit_count = 0;
+	for (struct jtag_tap *tap = jtag_tap_next_enabled(NULL); tap; tap = jtag_tap_next_enabled(tap)) {
+		unsigned int bits = tap->has_idcode ? 32 : 1;
+
+		if (!jtag_chain_cache.num_taps) {
+			jtag_chain_cache.first_bits = bits;
+			jtag_chain_cache.first_idcode = tap->idcode;
+		}
+		jtag_chain_cache.last_offset = bit_count;
+		jtag_chain_cache.last_bits = bits;
+		jtag_chain_cache.last_idcode = tap->idcode;
+
+		jtag_chain_cache.num_taps++;
+		jtag_chain_cache.total_ir_length += tap->ir_length;
+		bit_count += bits;
+	}
+	jtag_chain_cache.idcode_bits = bit_count;
+
+	if (!jtag_chain_cache.num_taps)
+		return;
+
+	const char *serial = adapter_get_required_serial();
+	jtag_chain_cache.serial = serial ? strdup(serial) : NULL;
+	jtag_chain_cache.valid = true;
+}
+
+/**
+ * Check the chain against the fingerprint of the last complete examination,
+ * with a single queue: the IDCODE of the first and last TAP, the end of the
+ * IDCODE data and the total IR length.
+ * On mismatch the TAPs are put back in TAP_RESET for the full examination.
+ * @returns true if the chain matches the fingerprint.
+ */
+static bool jtag_chain_cache_match(void)
+{
+	if (!jtag_chain_cache_enabled || !jtag_chain_cache.valid)
+		return false;
+
+	const char *serial = adapter_get_required_serial();
+	if (!serial != !jtag_chain_cache.serial ||
+			(serial && strcmp(serial, jtag_chain_cache.serial) != 0))
+		return false;
+
+	/* the configuration of the chain must not have changed either */
+	unsigned int num_taps = 0;
+	unsigned int total_ir_length = 0;
+	for (struct jtag_tap *tap = jtag_tap_next_enabled(NULL); tap; tap = jtag_tap_next_enabled(tap)) {
+		if (tap->ir_length == 0)
+			return false;
+		num_taps++;
+		total_ir_length += tap->ir_length;
+	}
+	if (num_taps != jtag_chain_cache.num_taps ||
+			total_ir_length != jtag_chain_cache.total_ir_length)
+		return false;
+
+	unsigned int dr_bits = jtag_chain_cache.idcode_bits + 32;
+	unsigned int ir_bits = total_ir_length + 2;
+	uint8_t *dr_buffer = malloc(DIV_ROUND_UP(dr_bits, 8));
+	uint8_t *ir_buffer = malloc(DIV_ROUND_UP(ir_bits, 8));
+	bool match = false;
+
+	if (!dr_buffer || !ir_buffer)
+		goto out;
+
+	/* the ones shifted in are END_OF_CHAIN_FLAG, and BYPASS for the IR */
+	buf_set_ones(dr_buffer, dr_bits);
+	buf_set_ones(ir_buffer, ir_bits);
+
+	jtag_add_plain_dr_scan(dr_bits, dr_buffer, dr_buffer, TAP_DRPAUSE);
+	jtag_add_tlr();
+	jtag_add_plain_ir_scan(ir_bits, ir_buffer, ir_buffer, TAP_IDLE);
+	if (jtag_execute_queue() != ERROR_OK)
+		goto out;
+
+	match = buf_get_u32(dr_buffer, 0, jtag_chain_cache.first_bits) == jtag_chain_cache.first_idcode &&
+		buf_get_u32(dr_buffer, jtag_chain_cache.last_offset, jtag_chain_cache.last_bits)
+			== jtag_chain_cache.last_idcode &&
+		jtag_idcode_is_final(buf_get_u32(dr_buffer, jtag_chain_cache.idcode_bits, 32)) &&
+		buf_get_u32(ir_buffer, total_ir_length, 2) == 0x3;
+
+out:
+	free(dr_buffer);
+	free(ir_buffer);
+
+	if (!match) {
+		LOG_DEBUG("JTAG scan chain does not match the cached topology");
+		jtag_add_tlr();
+		jtag_execute_queue();
+	}
+	return match;
+}
+
 /* Try to examine chain layout according to IEEE 1149.1 §12
  * This is called a "blind interrogation" of the scan chain.
  */
@@ -1321,6 +1684,14 @@ out:
 	return retval;
 }
 
+static void jtag_tap_set_bypass_instr(struct jtag_tap *tap)
+{
+	if (tap->ir_bypass_value)
+		buf_set_u64(tap->bypass_instr, 0, tap->ir_length, tap->ir_bypass_value);
+	else
+		buf_set_ones(tap->bypass_instr, tap->ir_length);
+}
+
 /*
  * Validate the date loaded by entry to the Capture-IR state, to help
  * find errors related to scan chain configuration (wrong IR lengths)
@@ -1397,6 +1768,7 @@ static int jtag_validate_ircapture(void)
 					&& tap->ir_length < JTAG_IRLEN_MAX) {
 				tap->ir_length++;
 			}
+			jtag_tap_set_bypass_instr(tap);
 			LOG_WARNING("AUTO %s - use \"jtag newtap %s %s -irlen %u "
 					"-expected-id 0x%08" PRIx32 "\"",
 					tap->dotted_name, tap->chip, tap->tapname, tap->ir_length, tap->idcode);
@@ -1456,6 +1828,8 @@ void jtag_tap_init(struct jtag_tap *tap)
 	tap->expected = calloc(1, ir_len_bytes);
 	tap->expected_mask = calloc(1, ir_len_bytes);
 	tap->cur_instr = malloc(ir_len_bytes);
+	tap->bypass_instr = malloc(ir_len_bytes);
+	jtag_tap_set_bypass_instr(tap);
 
 	/** @todo cope better with ir_length bigger than 32 bits */
 	if (ir_len_bits > 32)
@@ -1495,6 +1869,7 @@ void jtag_tap_free(struct jtag_tap *tap)
 	free(tap->expected_mask);
 	free(tap->expected_ids);
 	free(tap->cur_instr);
+	free(tap->bypass_instr);
 	free(tap->chip);
 	free(tap->tapname);
 	free(tap->dotted_name);
@@ -1533,6 +1908,14 @@ int jtag_init_inner(struct command_context *cmd_ctx)
 	if (retval != ERROR_OK)
 		return retval;
 
+	/* Reconnecting to the chain examined last time? */
+	if (jtag_chain_cache_match()) {
+		LOG_INFO("JTAG scan chain matches the %u TAPs found previously, "
+			"skipping full examination", jtag_chain_cache.num_taps);
+		jtag_notify_event(JTAG_TAP_EVENT_SETUP);
+		return ERROR_OK;
+	}
+
 	/* Examine DR values first.  This discovers problems which will
 	 * prevent communication ... hardware issues like TDO stuck, or
 	 * configuring the wrong number of (enabled) TAPs.
@@ -1572,10 +1955,13 @@ int jtag_init_inner(struct command_context *cmd_ctx)
 		issue_setup = false;
 	}
 
-	if (issue_setup)
+	if (issue_setup) {
+		jtag_chain_cache_save();
 		jtag_notify_event(JTAG_TAP_EVENT_SETUP);
-	else
+	} else {
+		jtag_chain_cache_clear();
 		LOG_WARNING("Bypassing JTAG setup events due to errors");
+	}
 
 
 	return ERROR_OK;
@@ -1914,13 +2300,38 @@ int adapter_deassert_reset(void)
 	return ERROR_FAIL;
 }
 
+/* Host buffer of the trace data drained from the adapter by keep_alive() */
+#define TRACE_RING_SIZE				(64 * 1024)
+/* Minimal interval between draining the adapter from keep_alive() */
+#define TRACE_PUMP_INTERVAL_MS		10
+
+static struct {
+	uint8_t *buf;
+	/* position of the oldest byte */
+	size_t tail;
+	size_t length;
+	/* error of the adapter while draining, reported by adapter_poll_trace() */
+	int error;
+	bool pumping;
+	int64_t last_pump;
+} trace_ring;
+
 int adapter_config_trace(bool enabled, enum tpiu_pin_protocol pin_protocol,
 		uint32_t port_size, unsigned int *trace_freq,
 		unsigned int traceclkin_freq, uint16_t *prescaler)
 {
+	free(trace_ring.buf);
+	memset(&trace_ring, 0, sizeof(trace_ring));
+
 	if (adapter_driver->config_trace) {
-		return adapter_driver->config_trace(enabled, pin_protocol, port_size, trace_freq,
+		int retval = adapter_driver->config_trace(enabled, pin_protocol, port_size, trace_freq,
 			traceclkin_freq, prescaler);
+
+		/* without the buffer, trace is only read from the timer callback */
+		if (retval == ERROR_OK && enabled && adapter_driver->poll_trace)
+			trace_ring.buf = malloc(TRACE_RING_SIZE);
+
+		return retval;
 	} else if (enabled) {
 		LOG_ERROR("The selected interface does not support tracing");
 		return ERROR_FAIL;
@@ -1929,10 +2340,67 @@ int adapter_config_trace(bool enabled, enum tpiu_pin_protocol pin_protocol,
 	return ERROR_OK;
 }
 
+static void adapter_trace_drain(void)
+{
+	/* the free space may wrap around the end of the buffer */
+	for (int i = 0; i < 2 && trace_ring.length < TRACE_RING_SIZE && !trace_ring.error; i++) {
+		size_t head = (trace_ring.tail + trace_ring.length) % TRACE_RING_SIZE;
+		size_t size = MIN(TRACE_RING_SIZE - trace_ring.length, TRACE_RING_SIZE - head);
+
+		trace_ring.error = adapter_driver->poll_trace(trace_ring.buf + head, &size);
+		if (trace_ring.error != ERROR_OK || !size)
+			break;
+
+		trace_ring.length += size;
+	}
+}
+
+void adapter_trace_pump(void)
+{
+	/* data stays in the adapter when the buffer is full */
+	if (!trace_ring.buf || trace_ring.pumping)
+		return;
+
+	int64_t now = timeval_ms();
+	if (now - trace_ring.last_pump < TRACE_PUMP_INTERVAL_MS)
+		return;
+
+	trace_ring.last_pump = now;
+	trace_ring.pumping = true;
+	adapter_trace_drain();
+	trace_ring.pumping = false;
+}
+
 int adapter_poll_trace(uint8_t *buf, size_t *size)
 {
-	if (adapter_driver->poll_trace)
+	if (!adapter_driver->poll_trace)
+		return ERROR_FAIL;
+
+	if (!trace_ring.buf || trace_ring.pumping)
 		return adapter_driver->poll_trace(buf, size);
 
-	return ERROR_FAIL;
+	trace_ring.pumping = true;
+	adapter_trace_drain();
+	trace_ring.pumping = false;
+
+	size_t copied = 0;
+	while (copied < *size && trace_ring.length) {
+		size_t chunk = MIN(*size - copied,
+			MIN(trace_ring.length, TRACE_RING_SIZE - trace_ring.tail));
+
+		memcpy(buf + copied, trace_ring.buf + trace_ring.tail, chunk);
+		trace_ring.tail = (trace_ring.tail + chunk) % TRACE_RING_SIZE;
+		trace_ring.length -= chunk;
+		copied += chunk;
+	}
+	*size = copied;
+
+	/* report an error once the data received before it is consumed */
+	if (!trace_ring.length && trace_ring.error != ERROR_OK) {
+		int retval = trace_ring.error;
+		trace_ring.error = ERROR_OK;
+		return retval;
+	}
+
+	return ERROR_OK;
 }
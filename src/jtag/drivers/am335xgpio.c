@@ -223,6 +223,62 @@ static int am335xgpio_write(int tck, int tms, int tdi)
 	return ERROR_OK;
 }
 
+/* Requires push-pull drive mode and the same GPIO chip for tck, tms and tdi */
+static int am335xgpio_shift(uint8_t tms, uint8_t tdi, unsigned int bits, uint8_t *tdo)
+{
+	const struct adapter_gpio_config *tck_config = &adapter_gpio_config[ADAPTER_GPIO_IDX_TCK];
+	const struct adapter_gpio_config *tms_config = &adapter_gpio_config[ADAPTER_GPIO_IDX_TMS];
+	const struct adapter_gpio_config *tdi_config = &adapter_gpio_config[ADAPTER_GPIO_IDX_TDI];
+	const unsigned int chip = tck_config->chip_num;
+	const uint32_t tck_mask = BIT(tck_config->gpio_num);
+	const uint32_t tms_mask = BIT(tms_config->gpio_num);
+	const uint32_t tdi_mask = BIT(tdi_config->gpio_num);
+	const unsigned int tck_low = tck_config->active_low ?
+			AM335XGPIO_GPIO_SETDATAOUT_OFFSET : AM335XGPIO_GPIO_CLEARDATAOUT_OFFSET;
+	const unsigned int tck_high = tck_config->active_low ?
+			AM335XGPIO_GPIO_CLEARDATAOUT_OFFSET : AM335XGPIO_GPIO_SETDATAOUT_OFFSET;
+
+	if (tms_config->active_low)
+		tms = ~tms;
+	if (tdi_config->active_low)
+		tdi = ~tdi;
+
+	uint32_t set[8], clear[8], level[8];
+
+	/* Build the waveform first so that nothing but register accesses and
+	 * delays happens between the clock edges. */
+	for (unsigned int i = 0; i < bits; i++) {
+		set[i] = ((tms >> i) & 1 ? tms_mask : 0) | ((tdi >> i) & 1 ? tdi_mask : 0);
+		clear[i] = (tms_mask | tdi_mask) & ~set[i];
+	}
+
+	const struct adapter_gpio_config *tdo_config = &adapter_gpio_config[ADAPTER_GPIO_IDX_TDO];
+	for (unsigned int i = 0; i < bits; i++) {
+		AM335XGPIO_WRITE_REG(chip, AM335XGPIO_GPIO_SETDATAOUT_OFFSET, set[i]);
+		AM335XGPIO_WRITE_REG(chip, AM335XGPIO_GPIO_CLEARDATAOUT_OFFSET, clear[i]);
+		AM335XGPIO_WRITE_REG(chip, tck_low, tck_mask); /* Write clock last */
+
+		for (unsigned int j = 0; j < jtag_delay; ++j)
+			asm volatile ("");
+
+		level[i] = AM335XGPIO_READ_REG(tdo_config->chip_num, AM335XGPIO_GPIO_DATAIN_OFFSET);
+
+		AM335XGPIO_WRITE_REG(chip, tck_high, tck_mask);
+
+		for (unsigned int j = 0; j < jtag_delay; ++j)
+			asm volatile ("");
+	}
+
+	if (tdo) {
+		uint8_t value = 0;
+		for (unsigned int i = 0; i < bits; i++)
+			value |= ((level[i] >> tdo_config->gpio_num) & 1) << i;
+		*tdo = tdo_config->active_low ? ~value : value;
+	}
+
+	return ERROR_OK;
+}
+
 static int am335xgpio_swd_write(int swclk, int swdio)
 {
 	set_gpio_value(&adapter_gpio_config[ADAPTER_GPIO_IDX_SWDIO], swdio);
@@ -435,6 +491,21 @@ static int am335xgpio_init(void)
 		initialize_gpio(ADAPTER_GPIO_IDX_TMS);
 		initialize_gpio(ADAPTER_GPIO_IDX_TCK);
 		initialize_gpio(ADAPTER_GPIO_IDX_TRST);
+
+		const struct adapter_gpio_config *tck_config = &adapter_gpio_config[ADAPTER_GPIO_IDX_TCK];
+		const struct adapter_gpio_config *tms_config = &adapter_gpio_config[ADAPTER_GPIO_IDX_TMS];
+		const struct adapter_gpio_config *tdi_config = &adapter_gpio_config[ADAPTER_GPIO_IDX_TDI];
+		if (tck_config->drive == ADAPTER_GPIO_DRIVE_MODE_PUSH_PULL &&
+				tms_config->drive == ADAPTER_GPIO_DRIVE_MODE_PUSH_PULL &&
+				tdi_config->drive == ADAPTER_GPIO_DRIVE_MODE_PUSH_PULL &&
+				tms_config->chip_num == tck_config->chip_num &&
+				tdi_config->chip_num == tck_config->chip_num) {
+			LOG_DEBUG("AM335x GPIO using fast mode for JTAG scans");
+			am335xgpio_bitbang.shift = am335xgpio_shift;
+		} else {
+			LOG_DEBUG("AM335x GPIO using generic mode for JTAG scans");
+			am335xgpio_bitbang.shift = NULL;
+		}
 	}
 
 	if (transport_is_swd()) {
@@ -196,6 +196,47 @@ static int bcm2835gpio_write(int tck, int tms, int tdi)
 	return ERROR_OK;
 }
 
+static int bcm2835gpio_shift(uint8_t tms, uint8_t tdi, unsigned int bits, uint8_t *tdo)
+{
+	const uint32_t tck_mask = 1 << adapter_gpio_config[ADAPTER_GPIO_IDX_TCK].gpio_num;
+	const uint32_t tms_mask = 1 << adapter_gpio_config[ADAPTER_GPIO_IDX_TMS].gpio_num;
+	const uint32_t tdi_mask = 1 << adapter_gpio_config[ADAPTER_GPIO_IDX_TDI].gpio_num;
+	const unsigned int tdo_shift = adapter_gpio_config[ADAPTER_GPIO_IDX_TDO].gpio_num;
+	const uint8_t tdo_invert = adapter_gpio_config[ADAPTER_GPIO_IDX_TDO].active_low ? 0xff : 0;
+	uint32_t set[8], clear[8], level[8];
+
+	/* Build the waveform first so that nothing but register accesses and
+	 * delays happens between the clock edges. */
+	for (unsigned int i = 0; i < bits; i++) {
+		set[i] = ((tms >> i) & 1 ? tms_mask : 0) | ((tdi >> i) & 1 ? tdi_mask : 0);
+		clear[i] = (tck_mask | tms_mask | tdi_mask) & ~set[i];
+	}
+
+	for (unsigned int i = 0; i < bits; i++) {
+		GPIO_SET = set[i];
+		GPIO_CLR = clear[i];
+		bcm2835_gpio_synchronize();
+
+		bcm2835_delay();
+
+		level[i] = GPIO_LEV;
+
+		GPIO_SET = tck_mask;
+		bcm2835_gpio_synchronize();
+
+		bcm2835_delay();
+	}
+
+	if (tdo) {
+		uint8_t value = 0;
+		for (unsigned int i = 0; i < bits; i++)
+			value |= ((level[i] >> tdo_shift) & 1) << i;
+		*tdo = value ^ tdo_invert;
+	}
+
+	return ERROR_OK;
+}
+
 /* Requires push-pull drive mode for swclk and swdio */
 static int bcm2835gpio_swd_write_fast(int swclk, int swdio)
 {
@@ -419,6 +460,7 @@ static int bcm2835gpio_blink(int on)
 static struct bitbang_interface bcm2835gpio_bitbang = {
 	.read = bcm2835gpio_read,
 	.write = bcm2835gpio_write,
+	.shift = bcm2835gpio_shift,
 	.swdio_read = bcm2835_swdio_read,
 	.swdio_drive = bcm2835_swdio_drive,
 	.swd_write = bcm2835gpio_swd_write_generic,
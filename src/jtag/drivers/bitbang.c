@@ -192,27 +192,10 @@ static int bitbang_stableclocks(unsigned int num_cycles)
 	return ERROR_OK;
 }
 
-static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
-		unsigned scan_size)
+static int bitbang_scan_bits(enum scan_type type, uint8_t *buffer, unsigned int scan_size)
 {
-	tap_state_t saved_end_state = tap_get_end_state();
-	unsigned bit_cnt;
-
-	if (!((!ir_scan &&
-			(tap_get_state() == TAP_DRSHIFT)) ||
-			(ir_scan && (tap_get_state() == TAP_IRSHIFT)))) {
-		if (ir_scan)
-			bitbang_end_state(TAP_IRSHIFT);
-		else
-			bitbang_end_state(TAP_DRSHIFT);
-
-		if (bitbang_state_move(0) != ERROR_OK)
-			return ERROR_FAIL;
-		bitbang_end_state(saved_end_state);
-	}
-
 	size_t buffered = 0;
-	for (bit_cnt = 0; bit_cnt < scan_size; bit_cnt++) {
+	for (unsigned int bit_cnt = 0; bit_cnt < scan_size; bit_cnt++) {
 		int tms = (bit_cnt == scan_size-1) ? 1 : 0;
 		int tdi;
 		int bytec = bit_cnt/8;
@@ -270,6 +253,56 @@ static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
 		}
 	}
 
+	return ERROR_OK;
+}
+
+/* Same as bitbang_scan_bits(), eight bits per call to the interface */
+static int bitbang_scan_bytes(enum scan_type type, uint8_t *buffer, unsigned int scan_size)
+{
+	for (unsigned int bit_cnt = 0; bit_cnt < scan_size; bit_cnt += 8) {
+		unsigned int bits = MIN(scan_size - bit_cnt, 8);
+		uint8_t *byte = &buffer[bit_cnt / 8];
+		uint8_t tms = (bit_cnt + bits == scan_size) ? 1 << (bits - 1) : 0;
+		uint8_t tdi = (type != SCAN_IN) ? *byte : 0;
+
+		if (bitbang_interface->shift(tms, tdi, bits,
+				(type != SCAN_OUT) ? byte : NULL) != ERROR_OK)
+			return ERROR_FAIL;
+	}
+
+	/* collect the samples the interface may still hold */
+	if (type != SCAN_OUT && bitbang_interface->flush)
+		return bitbang_interface->flush();
+
+	return ERROR_OK;
+}
+
+static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
+		unsigned scan_size)
+{
+	tap_state_t saved_end_state = tap_get_end_state();
+
+	if (!((!ir_scan &&
+			(tap_get_state() == TAP_DRSHIFT)) ||
+			(ir_scan && (tap_get_state() == TAP_IRSHIFT)))) {
+		if (ir_scan)
+			bitbang_end_state(TAP_IRSHIFT);
+		else
+			bitbang_end_state(TAP_DRSHIFT);
+
+		if (bitbang_state_move(0) != ERROR_OK)
+			return ERROR_FAIL;
+		bitbang_end_state(saved_end_state);
+	}
+
+	int retval;
+	if (bitbang_interface->shift)
+		retval = bitbang_scan_bytes(type, buffer, scan_size);
+	else
+		retval = bitbang_scan_bits(type, buffer, scan_size);
+	if (retval != ERROR_OK)
+		return retval;
+
 	if (tap_get_state() != tap_get_end_state()) {
 		/* we *KNOW* the above loop transitioned out of
 		 * the shift state, so we skip the first state
@@ -399,21 +432,26 @@ static void bitbang_swd_exchange(bool rnw, uint8_t buf[], unsigned int offset, u
 		bitbang_interface->blink(1);
 	}
 
-	for (unsigned int i = offset; i < bit_cnt + offset; i++) {
-		int bytec = i/8;
-		int bcval = 1 << (i % 8);
-		int swdio = !rnw && (buf[bytec] & bcval);
-
-		bitbang_interface->swd_write(0, swdio);
+	if (bitbang_interface->swd_exchange) {
+		/* FIXME: we should manage errors */
+		bitbang_interface->swd_exchange(rnw, buf, offset, bit_cnt);
+	} else {
+		for (unsigned int i = offset; i < bit_cnt + offset; i++) {
+			int bytec = i/8;
+			int bcval = 1 << (i % 8);
+			int swdio = !rnw && (buf[bytec] & bcval);
+
+			bitbang_interface->swd_write(0, swdio);
+
+			if (rnw && buf) {
+				if (bitbang_interface->swdio_read())
+					buf[bytec] |= bcval;
+				else
+					buf[bytec] &= ~bcval;
+			}
 
-		if (rnw && buf) {
-			if (bitbang_interface->swdio_read())
-				buf[bytec] |= bcval;
-			else
-				buf[bytec] &= ~bcval;
+			bitbang_interface->swd_write(1, swdio);
 		}
-
-		bitbang_interface->swd_write(1, swdio);
 	}
 
 	if (bitbang_interface->blink) {
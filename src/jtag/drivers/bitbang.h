@@ -44,6 +44,17 @@ struct bitbang_interface {
 	/** Set TCK, TMS, and TDI to the given values. */
 	int (*write)(int tck, int tms, int tdi);
 
+	/** Clock up to 8 bits through the JTAG chain (optional).
+	 *
+	 * For each of the @a bits bits, LSB first, set TCK low with TMS and TDI
+	 * taken from @a tms and @a tdi, sample TDO, then set TCK high. The same
+	 * as calling write(), read() and write() once per bit, without the
+	 * per-bit indirect calls. Unless @a tdo is NULL, the sampled bits are
+	 * stored in *tdo; bits above @a bits are don't care. An interface that
+	 * buffers samples may store them later, but no later than the next
+	 * flush(). */
+	int (*shift)(uint8_t tms, uint8_t tdi, unsigned int bits, uint8_t *tdo);
+
 	/** Blink led (optional). */
 	int (*blink)(int on);
 
@@ -56,6 +67,12 @@ struct bitbang_interface {
 	/** Set SWCLK and SWDIO to the given value. */
 	int (*swd_write)(int swclk, int swdio);
 
+	/** Clock @a bit_cnt SWD bits, starting at bit @a offset of @a buf
+	 * (optional). The same as calling swd_write(), swdio_read() and
+	 * swd_write() once per bit. SWDIO is driven from @a buf unless @a rnw;
+	 * otherwise the sampled bits are stored in @a buf, if not NULL. */
+	int (*swd_exchange)(bool rnw, uint8_t *buf, unsigned int offset, unsigned int bit_cnt);
+
 	/** Sleep for some number of microseconds. **/
 	int (*sleep)(unsigned int microseconds);
 
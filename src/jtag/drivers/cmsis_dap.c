@@ -47,6 +47,9 @@ static const struct cmsis_dap_backend *const cmsis_dap_backends[] = {
 #if BUILD_CMSIS_DAP_HID == 1
 	&cmsis_dap_hid_backend,
 #endif
+
+	/* needs a file, never selected when there is none */
+	&cmsis_dap_replay_backend,
 };
 
 /* USB Config */
@@ -68,6 +71,9 @@ static uint16_t cmsis_dap_vid[MAX_USB_IDS + 1] = { 0 };
 static uint16_t cmsis_dap_pid[MAX_USB_IDS + 1] = { 0 };
 static int cmsis_dap_backend = -1;
 static bool swd_mode;
+static bool dapdirect_mode;
+/* packet count set by the user instead of the one reported by the adapter */
+static unsigned int cmsis_dap_packet_count_override;
 
 /* CMSIS-DAP General Commands */
 #define CMD_DAP_INFO              0x00
@@ -165,6 +171,11 @@ static bool swd_mode;
  * Prevent using it until we have at least r/w operations. */
 #define CMD_DAP_TFER_BLOCK_MIN_OPS 4
 
+/* A run of identical operations filling that part of a packet is sent
+ * in a packet of its own, with DAP_TransferBlock, instead of as a part
+ * of a mixed DAP_Transfer. Only done if packets are pipelined. */
+#define CMD_DAP_TFER_BLOCK_SPLIT_DIV 2
+
 /* DAP Status Code */
 #define DAP_OK                    0
 #define DAP_ERROR                 0xFF
@@ -802,11 +813,12 @@ static void cmsis_dap_swd_write_from_queue(struct cmsis_dap *dap)
 	}
 
 	bool block_cmd = !cmsis_dap_handle->swd_cmds_differ
+					 && !dap->tfer_block_unsupported
 					 && block->transfer_count >= CMD_DAP_TFER_BLOCK_MIN_OPS;
 	block->command = block_cmd ? CMD_DAP_TFER_BLOCK : CMD_DAP_TFER;
 
 	command[0] = block->command;
-	command[1] = 0x00;	/* DAP Index */
+	command[1] = dap->dap_index;
 
 	unsigned int idx;
 	if (block_cmd) {
@@ -918,6 +930,15 @@ static void cmsis_dap_swd_read_process(struct cmsis_dap *dap, enum cmsis_dap_blo
 	}
 
 	uint8_t *resp = dap->response;
+	if (resp[0] == DAP_ERROR && block->command == CMD_DAP_TFER_BLOCK) {
+		/* Fall back to DAP_Transfer from the next queue on */
+		LOG_WARNING("CMSIS-DAP: adapter does not implement DAP_TransferBlock, not using it");
+		dap->tfer_block_unsupported = true;
+		cmsis_dap_swd_cancel_transfers(dap);
+		queued_retval = ERROR_FAIL;
+		return;
+	}
+
 	if (resp[0] != block->command) {
 		LOG_ERROR("CMSIS-DAP command mismatch. Expected 0x%x received 0x%" PRIx8,
 			block->command, resp[0]);
@@ -971,9 +992,10 @@ static void cmsis_dap_swd_read_process(struct cmsis_dap *dap, enum cmsis_dap_blo
 
 			LOG_DEBUG_IO("Read result: %" PRIx32, data);
 
-			/* Imitate posted AP reads */
-			if ((transfer->cmd & SWD_CMD_APNDP) ||
-			    ((transfer->cmd & SWD_CMD_A32) >> 1 == DP_RDBUFF)) {
+			/* Imitate posted AP reads, the dap_ops expect the results
+			 * DAP_Transfer returns */
+			if (!dapdirect_mode && ((transfer->cmd & SWD_CMD_APNDP) ||
+			    ((transfer->cmd & SWD_CMD_A32) >> 1 == DP_RDBUFF))) {
 				tmp = last_read;
 				last_read = data;
 			}
@@ -1039,6 +1061,73 @@ static unsigned int cmsis_dap_tfer_resp_size(unsigned int write_count,
 	return size;
 }
 
+/* Send the packet being built, waiting for a response if the pipe is full */
+static void cmsis_dap_swd_send_block(struct cmsis_dap *dap)
+{
+	if (dap->pending_fifo_block_count)
+		cmsis_dap_swd_read_process(dap, CMSIS_DAP_NON_BLOCKING);
+
+	cmsis_dap_swd_write_from_queue(dap);
+
+	unsigned int packet_count = dap->quirk_mode ? 1 : dap->packet_count;
+	if (dap->pending_fifo_block_count >= packet_count)
+		cmsis_dap_swd_read_process(dap, CMSIS_DAP_BLOCKING);
+}
+
+/**
+ * Keep long runs of identical operations, like the DRW accesses of MEM-AP
+ * block transfers, in packets of their own so they can be sent with
+ * DAP_TransferBlock. Called before queuing @a cmd to the packet being built.
+ */
+static void cmsis_dap_swd_split_runs(struct cmsis_dap *dap, uint8_t cmd)
+{
+	struct pending_request_block *block = &dap->pending_fifo[dap->pending_fifo_put_idx];
+	unsigned int count = block->transfer_count;
+
+	if (!count || dap->tfer_block_unsupported || dap->quirk_mode || dap->packet_count < 2)
+		return;
+
+	unsigned int run_cmd = block->transfers[count - 1].cmd;
+	unsigned int run_len = count - dap->swd_run_start;
+	unsigned int split_len = MAX(CMD_DAP_TFER_BLOCK_MIN_OPS,
+								 pending_queue_len / CMD_DAP_TFER_BLOCK_SPLIT_DIV);
+
+	if (cmd != run_cmd) {
+		/* A packet made of a long run only: send it as it is */
+		if (dap->swd_run_start == 0 && run_len >= split_len)
+			cmsis_dap_swd_send_block(dap);
+		return;
+	}
+
+	if (dap->swd_run_start == 0 || run_len + 1 < split_len)
+		return;
+
+	/* Send the operations preceding the run, then move the run
+	 * to the next packet */
+	unsigned int run_start = dap->swd_run_start;
+	unsigned int run_reads = (run_cmd & SWD_CMD_RNW) ? run_len : 0;
+	unsigned int run_writes = run_len - run_reads;
+
+	block->transfer_count = run_start;
+	dap->read_count -= run_reads;
+	dap->write_count -= run_writes;
+	dap->swd_cmds_differ = true;
+	cmsis_dap_swd_send_block(dap);
+	if (queued_retval != ERROR_OK)
+		return;
+
+	struct pending_request_block *next = &dap->pending_fifo[dap->pending_fifo_put_idx];
+	assert(next != block && next->transfer_count == 0);
+	memcpy(next->transfers, &block->transfers[run_start],
+		   run_len * sizeof(struct pending_transfer_result));
+	next->transfer_count = run_len;
+	dap->read_count = run_reads;
+	dap->write_count = run_writes;
+	dap->swd_cmds_differ = false;
+	dap->common_swd_cmd = run_cmd;
+	dap->swd_run_start = 0;
+}
+
 static void cmsis_dap_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data)
 {
 	/* TARGETSEL register write cannot be queued */
@@ -1054,7 +1143,8 @@ static void cmsis_dap_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data)
 	unsigned int write_count = cmsis_dap_handle->write_count;
 	unsigned int read_count = cmsis_dap_handle->read_count;
 	bool block_cmd;
-	if (write_count + read_count < CMD_DAP_TFER_BLOCK_MIN_OPS)
+	if (write_count + read_count < CMD_DAP_TFER_BLOCK_MIN_OPS
+			|| cmsis_dap_handle->tfer_block_unsupported)
 		block_cmd = false;
 	else
 		block_cmd = !cmsis_dap_handle->swd_cmds_differ
@@ -1075,15 +1165,10 @@ static void cmsis_dap_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data)
 	if (cmd_size > tfer_max_command_size
 			|| resp_size > tfer_max_response_size
 			|| write_count + read_count > max_transfer_count) {
-		if (cmsis_dap_handle->pending_fifo_block_count)
-			cmsis_dap_swd_read_process(cmsis_dap_handle, CMSIS_DAP_NON_BLOCKING);
-
 		/* Not enough room in the queue. Run the queue. */
-		cmsis_dap_swd_write_from_queue(cmsis_dap_handle);
-
-		unsigned int packet_count = cmsis_dap_handle->quirk_mode ? 1 : cmsis_dap_handle->packet_count;
-		if (cmsis_dap_handle->pending_fifo_block_count >= packet_count)
-			cmsis_dap_swd_read_process(cmsis_dap_handle, CMSIS_DAP_BLOCKING);
+		cmsis_dap_swd_send_block(cmsis_dap_handle);
+	} else if (queued_retval == ERROR_OK) {
+		cmsis_dap_swd_split_runs(cmsis_dap_handle, cmd);
 	}
 
 	assert(cmsis_dap_handle->pending_fifo[cmsis_dap_handle->pending_fifo_put_idx].transfer_count < pending_queue_len);
@@ -1098,8 +1183,12 @@ static void cmsis_dap_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data)
 	if (block->transfer_count == 0) {
 		cmsis_dap_handle->swd_cmds_differ = false;
 		cmsis_dap_handle->common_swd_cmd = cmd;
-	} else if (cmd != cmsis_dap_handle->common_swd_cmd) {
-		cmsis_dap_handle->swd_cmds_differ = true;
+		cmsis_dap_handle->swd_run_start = 0;
+	} else {
+		if (cmd != cmsis_dap_handle->common_swd_cmd)
+			cmsis_dap_handle->swd_cmds_differ = true;
+		if (cmd != block->transfers[block->transfer_count - 1].cmd)
+			cmsis_dap_handle->swd_run_start = block->transfer_count;
 	}
 
 	if (cmd & SWD_CMD_RNW) {
@@ -1124,6 +1213,265 @@ static void cmsis_dap_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_del
 	cmsis_dap_swd_queue_cmd(cmd, value, 0);
 }
 
+static int cmsis_dap_cmd_dap_jtag_configure(void)
+{
+	uint8_t *command = cmsis_dap_handle->command;
+	unsigned int count = 0;
+
+	command[0] = CMD_DAP_JTAG_CONFIGURE;
+	for (struct jtag_tap *tap = jtag_tap_next_enabled(NULL); tap;
+			tap = jtag_tap_next_enabled(tap)) {
+		if (2 + count >= cmsis_dap_handle->packet_usable_size || count >= 255) {
+			LOG_ERROR("CMSIS-DAP: too many TAPs in the JTAG chain");
+			return ERROR_JTAG_DEVICE_ERROR;
+		}
+		command[2 + count++] = tap->ir_length;
+	}
+	command[1] = count;
+
+	int retval = cmsis_dap_xfer(cmsis_dap_handle, 2 + count);
+	if (retval != ERROR_OK || cmsis_dap_handle->response[1] != DAP_OK) {
+		LOG_ERROR("CMSIS-DAP command CMD_DAP_JTAG_CONFIGURE failed.");
+		return ERROR_JTAG_DEVICE_ERROR;
+	}
+
+	return ERROR_OK;
+}
+
+static int cmsis_dap_cmd_dap_write_abort(uint8_t index, uint32_t data)
+{
+	uint8_t *command = cmsis_dap_handle->command;
+
+	command[0] = CMD_DAP_WRITE_ABORT;
+	command[1] = index;
+	h_u32_to_le(&command[2], data);
+
+	int retval = cmsis_dap_xfer(cmsis_dap_handle, 6);
+	if (retval != ERROR_OK || cmsis_dap_handle->response[1] != DAP_OK) {
+		LOG_ERROR("CMSIS-DAP command CMD_DAP_WRITE_ABORT failed.");
+		return ERROR_JTAG_DEVICE_ERROR;
+	}
+
+	return ERROR_OK;
+}
+
+/*
+ * dap_ops for the dapdirect_jtag transport: DP and AP accesses are queued
+ * as DAP_Transfer requests addressed to the JTAG-DP by its device index,
+ * instead of being built from DPACC/APACC scans of the JTAG queue. The
+ * adapter sequences IR and DR scans and the posted reads itself.
+ */
+
+/* TAP of the JTAG-DP addressed by the packet being built */
+static struct jtag_tap *cmsis_dap_jtag_dap_tap;
+
+/* Address DAP_Transfer to the JTAG-DP of @a dap */
+static int cmsis_dap_jtag_dap_select(struct adiv5_dap *dap)
+{
+	if (dap->tap == cmsis_dap_jtag_dap_tap)
+		return queued_retval;
+
+	unsigned int index = 0;
+	struct jtag_tap *tap;
+	for (tap = jtag_tap_next_enabled(NULL); tap; tap = jtag_tap_next_enabled(tap)) {
+		if (tap == dap->tap)
+			break;
+		index++;
+	}
+	if (!tap) {
+		LOG_ERROR("CMSIS-DAP: %s is not an enabled TAP", adiv5_dap_name(dap));
+		return ERROR_FAIL;
+	}
+
+	/* A packet holds transfers for one device only */
+	if (cmsis_dap_handle->write_count + cmsis_dap_handle->read_count)
+		cmsis_dap_swd_send_block(cmsis_dap_handle);
+
+	cmsis_dap_handle->dap_index = index;
+	cmsis_dap_jtag_dap_tap = dap->tap;
+
+	return queued_retval;
+}
+
+static int cmsis_dap_jtag_dap_connect(struct adiv5_dap *dap)
+{
+	if (is_adiv6(dap)) {
+		LOG_ERROR("ADIv6 dap not supported by CMSIS-DAP dap-direct mode");
+		return ERROR_FAIL;
+	}
+
+	int retval = cmsis_dap_swd_run_queue();
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* The device indexes follow the TAPs enabled now */
+	retval = cmsis_dap_cmd_dap_jtag_configure();
+	if (retval != ERROR_OK)
+		return retval;
+	cmsis_dap_jtag_dap_tap = NULL;
+
+	return dap_dp_init(dap);
+}
+
+static int cmsis_dap_jtag_dap_send_sequence(struct adiv5_dap *dap, enum swd_special_seq seq)
+{
+	/* Ignore the request */
+	return ERROR_OK;
+}
+
+static int cmsis_dap_jtag_dap_queue_dp_write(struct adiv5_dap *dap, unsigned int reg,
+		uint32_t data);
+
+/** Select the DP register bank */
+static int cmsis_dap_jtag_dap_dp_bankselect(struct adiv5_dap *dap, unsigned int reg)
+{
+	/* Only register address 4 is banked */
+	if ((reg & 0xf) != 4)
+		return ERROR_OK;
+
+	uint32_t sel = (reg >> 4) & DP_SELECT_DPBANK;
+	if (dap->select_valid && sel == (dap->select & DP_SELECT_DPBANK))
+		return ERROR_OK;
+
+	sel |= (uint32_t)(dap->select & SELECT_AP_MASK);
+	return cmsis_dap_jtag_dap_queue_dp_write(dap, DP_SELECT, sel);
+}
+
+/** Select the AP register bank */
+static int cmsis_dap_jtag_dap_ap_bankselect(struct adiv5_ap *ap, unsigned int reg)
+{
+	struct adiv5_dap *dap = ap->dap;
+	uint32_t sel = (ap->ap_num << 24) | (reg & ADIV5_DP_SELECT_APBANK);
+
+	if (dap->select_valid && sel == (dap->select & SELECT_AP_MASK))
+		return ERROR_OK;
+
+	sel |= dap->select & DP_SELECT_DPBANK;
+	return cmsis_dap_jtag_dap_queue_dp_write(dap, DP_SELECT, sel);
+}
+
+static int cmsis_dap_jtag_dap_queue_dp_read(struct adiv5_dap *dap, unsigned int reg,
+		uint32_t *data)
+{
+	int retval = cmsis_dap_jtag_dap_select(dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = cmsis_dap_jtag_dap_dp_bankselect(dap, reg);
+	if (retval != ERROR_OK)
+		return retval;
+
+	cmsis_dap_swd_queue_cmd(swd_cmd(true, false, reg), data, 0);
+	return queued_retval;
+}
+
+static int cmsis_dap_jtag_dap_queue_dp_write(struct adiv5_dap *dap, unsigned int reg,
+		uint32_t data)
+{
+	int retval = cmsis_dap_jtag_dap_select(dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (reg == DP_SELECT) {
+		dap->select = data;
+		dap->select_valid = true;
+	} else {
+		retval = cmsis_dap_jtag_dap_dp_bankselect(dap, reg);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	cmsis_dap_swd_queue_cmd(swd_cmd(false, false, reg), NULL, data);
+	return queued_retval;
+}
+
+static int cmsis_dap_jtag_dap_queue_ap_read(struct adiv5_ap *ap, unsigned int reg,
+		uint32_t *data)
+{
+	int retval = cmsis_dap_jtag_dap_select(ap->dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = cmsis_dap_jtag_dap_ap_bankselect(ap, reg);
+	if (retval != ERROR_OK)
+		return retval;
+
+	cmsis_dap_swd_queue_cmd(swd_cmd(true, true, reg), data, 0);
+	return queued_retval;
+}
+
+static int cmsis_dap_jtag_dap_queue_ap_write(struct adiv5_ap *ap, unsigned int reg,
+		uint32_t data)
+{
+	int retval = cmsis_dap_jtag_dap_select(ap->dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = cmsis_dap_jtag_dap_ap_bankselect(ap, reg);
+	if (retval != ERROR_OK)
+		return retval;
+
+	cmsis_dap_swd_queue_cmd(swd_cmd(false, true, reg), NULL, data);
+	return queued_retval;
+}
+
+static int cmsis_dap_jtag_dap_queue_ap_abort(struct adiv5_dap *dap, uint8_t *ack)
+{
+	/* The JTAG ABORT register is out of DAP_Transfer reach, flush the
+	 * queue and write it with its own command */
+	(void)cmsis_dap_swd_run_queue();
+
+	int retval = cmsis_dap_jtag_dap_select(dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return cmsis_dap_cmd_dap_write_abort(cmsis_dap_handle->dap_index, DAPABORT);
+}
+
+/** Executes all queued DAP operations, then checks the sticky errors */
+static int cmsis_dap_jtag_dap_run(struct adiv5_dap *dap)
+{
+	if (!(cmsis_dap_handle->write_count + cmsis_dap_handle->read_count)
+			&& !cmsis_dap_handle->pending_fifo_block_count)
+		return cmsis_dap_swd_run_queue();
+
+	/* Piggyback the CTRL/STAT read on the last packet of the queue */
+	uint32_t ctrlstat = 0;
+	int retval = cmsis_dap_jtag_dap_queue_dp_read(dap, DP_CTRL_STAT, &ctrlstat);
+	int run_retval = cmsis_dap_swd_run_queue();
+	if (retval == ERROR_OK)
+		retval = run_retval;
+	if (retval != ERROR_OK) {
+		dap->select_valid = false;
+		return retval;
+	}
+
+	if (ctrlstat & (SSTICKYERR | SSTICKYORUN)) {
+		LOG_DEBUG("CMSIS-DAP: sticky error, CTRL/STAT 0x%08" PRIx32, ctrlstat);
+		/* A JTAG-DP clears the sticky flags written to one */
+		retval = cmsis_dap_jtag_dap_queue_dp_write(dap, DP_CTRL_STAT,
+				dap->dp_ctrl_stat | SSTICKYERR | SSTICKYORUN);
+		if (retval == ERROR_OK)
+			retval = cmsis_dap_swd_run_queue();
+		if (retval != ERROR_OK)
+			dap->select_valid = false;
+		return ERROR_JTAG_DEVICE_ERROR;
+	}
+
+	return ERROR_OK;
+}
+
+static const struct dap_ops cmsis_dap_jtag_dap_ops = {
+	.connect = cmsis_dap_jtag_dap_connect,
+	.send_sequence = cmsis_dap_jtag_dap_send_sequence,
+	.queue_dp_read = cmsis_dap_jtag_dap_queue_dp_read,
+	.queue_dp_write = cmsis_dap_jtag_dap_queue_dp_write,
+	.queue_ap_read = cmsis_dap_jtag_dap_queue_ap_read,
+	.queue_ap_write = cmsis_dap_jtag_dap_queue_ap_write,
+	.queue_ap_abort = cmsis_dap_jtag_dap_queue_ap_abort,
+	.run = cmsis_dap_jtag_dap_run,
+};
+
 static int cmsis_dap_get_serial_info(void)
 {
 	uint8_t *data;
@@ -1331,6 +1679,8 @@ static int cmsis_dap_init(void)
 	if (retval != ERROR_OK)
 		return retval;
 
+	dapdirect_mode = transport_is_dapdirect_jtag();
+
 	if (swd_mode) {
 		retval = cmsis_dap_swd_open();
 		if (retval != ERROR_OK)
@@ -1393,6 +1743,11 @@ static int cmsis_dap_init(void)
 		LOG_DEBUG("CMSIS-DAP: Packet Count = %u", pkt_cnt);
 	}
 
+	if (cmsis_dap_packet_count_override) {
+		cmsis_dap_handle->packet_count = cmsis_dap_packet_count_override;
+		LOG_INFO("CMSIS-DAP: using packet count %u", cmsis_dap_packet_count_override);
+	}
+
 	LOG_DEBUG("Allocating FIFO for %u pending packets", cmsis_dap_handle->packet_count);
 	for (unsigned int i = 0; i < cmsis_dap_handle->packet_count; i++) {
 		cmsis_dap_handle->pending_fifo[i].transfers = malloc(pending_queue_len
@@ -2106,7 +2461,9 @@ static int cmsis_dap_poll_trace(uint8_t *buf, size_t *size)
 	uint8_t trace_status;
 	size_t trace_count;
 
-	if (!cmsis_dap_handle->trace_enabled) {
+	/* SWO commands can't be interleaved with queued transfers
+	 * when called through keep_alive() */
+	if (!cmsis_dap_handle->trace_enabled || cmsis_dap_handle->pending_fifo_block_count) {
 		*size = 0;
 		return ERROR_OK;
 	}
@@ -2236,6 +2593,41 @@ COMMAND_HANDLER(cmsis_dap_handle_quirk_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(cmsis_dap_handle_packet_count_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		if (CMD_CTX->mode != COMMAND_CONFIG) {
+			command_print(CMD, "packet count can only be set before init");
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+
+		if (!strcmp(CMD_ARGV[0], "auto")) {
+			cmsis_dap_packet_count_override = 0;
+		} else {
+			unsigned int count;
+			COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], count);
+			if (count < 1 || count > MAX_PENDING_REQUESTS) {
+				command_print(CMD, "packet count must be between 1 and %d",
+					MAX_PENDING_REQUESTS);
+				return ERROR_COMMAND_ARGUMENT_INVALID;
+			}
+			cmsis_dap_packet_count_override = count;
+		}
+	}
+
+	if (cmsis_dap_handle)
+		command_print(CMD, "CMSIS-DAP packet count %u", cmsis_dap_handle->packet_count);
+	else if (cmsis_dap_packet_count_override)
+		command_print(CMD, "CMSIS-DAP packet count %u", cmsis_dap_packet_count_override);
+	else
+		command_print(CMD, "CMSIS-DAP packet count auto");
+
+	return ERROR_OK;
+}
+
 static const struct command_registration cmsis_dap_subcommand_handlers[] = {
 	{
 		.name = "info",
@@ -2262,8 +2654,9 @@ static const struct command_registration cmsis_dap_subcommand_handlers[] = {
 		.name = "backend",
 		.handler = &cmsis_dap_handle_backend_command,
 		.mode = COMMAND_CONFIG,
-		.help = "set the communication backend to use (USB bulk or HID).",
-		.usage = "(auto | usb_bulk | hid)",
+		.help = "set the communication backend to use (USB bulk, HID "
+			"or replay of a recording).",
+		.usage = "(auto | usb_bulk | hid | replay)",
 	},
 	{
 		.name = "quirk",
@@ -2272,6 +2665,15 @@ static const struct command_registration cmsis_dap_subcommand_handlers[] = {
 		.help = "allow expensive workarounds of known adapter quirks.",
 		.usage = "[enable | disable]",
 	},
+	{
+		.name = "packet_count",
+		.handler = &cmsis_dap_handle_packet_count_command,
+		.mode = COMMAND_ANY,
+		.help = "number of packets submitted to the adapter before "
+			"waiting for the first response, instead of the count reported "
+			"by the adapter.",
+		.usage = "[auto | count]",
+	},
 #if BUILD_CMSIS_DAP_USB
 	{
 		.name = "usb",
@@ -2281,6 +2683,13 @@ static const struct command_registration cmsis_dap_subcommand_handlers[] = {
 		.usage = "<cmd>",
 	},
 #endif
+	{
+		.name = "replay",
+		.chain = cmsis_dap_replay_subcommand_handlers,
+		.mode = COMMAND_ANY,
+		.help = "replay backend-specific commands",
+		.usage = "<cmd>",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -2304,7 +2713,7 @@ static const struct swd_driver cmsis_dap_swd_driver = {
 	.run = cmsis_dap_swd_run_queue,
 };
 
-static const char * const cmsis_dap_transport[] = { "swd", "jtag", NULL };
+static const char * const cmsis_dap_transport[] = { "swd", "jtag", "dapdirect_jtag", NULL };
 
 static struct jtag_interface cmsis_dap_interface = {
 	.supported = DEBUG_CAP_TMS_SEQ,
@@ -2327,4 +2736,5 @@ struct adapter_driver cmsis_dap_adapter_driver = {
 
 	.jtag_ops = &cmsis_dap_interface,
 	.swd_ops = &cmsis_dap_swd_driver,
+	.dap_jtag_ops = &cmsis_dap_jtag_dap_ops,
 };
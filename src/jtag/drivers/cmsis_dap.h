@@ -16,7 +16,7 @@ struct pending_transfer_result {
 
 /* Up to MIN(packet_count, MAX_PENDING_REQUESTS) requests may be issued
  * until the first response arrives */
-#define MAX_PENDING_REQUESTS 4
+#define MAX_PENDING_REQUESTS 16
 
 struct pending_request_block {
 	struct pending_transfer_result *transfers;
@@ -44,6 +44,13 @@ struct cmsis_dap {
 	 * The following variables keep track of it */
 	uint8_t common_swd_cmd;
 	bool swd_cmds_differ;
+	/* Index of the first transfer of the trailing run of identical
+	 * SWD operations in the packet being built */
+	unsigned int swd_run_start;
+	/* Set if the adapter has answered DAP_TransferBlock as invalid */
+	bool tfer_block_unsupported;
+	/* Device index of DAP_Transfer, the JTAG-DP position in dapdirect_jtag mode */
+	uint8_t dap_index;
 
 	/* Pending requests are organized as a FIFO - circular buffer */
 	struct pending_request_block pending_fifo[MAX_PENDING_REQUESTS];
@@ -72,7 +79,9 @@ struct cmsis_dap_backend {
 
 extern const struct cmsis_dap_backend cmsis_dap_hid_backend;
 extern const struct cmsis_dap_backend cmsis_dap_usb_backend;
+extern const struct cmsis_dap_backend cmsis_dap_replay_backend;
 extern const struct command_registration cmsis_dap_usb_subcommand_handlers[];
+extern const struct command_registration cmsis_dap_replay_subcommand_handlers[];
 
 #define REPORT_ID_SIZE   1
 
@@ -0,0 +1,225 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+ * CMSIS-DAP backend replaying the transfers logged with "adapter usb
+ * record" from an usb_bulk backend session. The recorded responses are
+ * returned in order, without any adapter, so that changes to the driver
+ * or to the queues can be measured (packet count, CPU time) on the same
+ * workload. The commands sent are compared with the recorded ones, a
+ * difference means the driver no longer follows the recording.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/log.h>
+#include <helper/command.h>
+#include <helper/replacements.h>
+
+#include "cmsis_dap.h"
+
+/* A line holds the hexadecimal dump of one packet */
+#define REPLAY_PACKET_SIZE	65536
+#define REPLAY_LINE_SIZE	(2 * REPLAY_PACKET_SIZE + 64)
+
+struct cmsis_dap_backend_data {
+	/* separate read positions for the commands and the responses */
+	FILE *out_file;
+	FILE *in_file;
+	char *line;
+	uint8_t *recorded;
+	unsigned int out_count;
+	unsigned int in_count;
+	unsigned int mismatches;
+};
+
+static char *cmsis_dap_replay_filename;
+
+static int cmsis_dap_replay_alloc(struct cmsis_dap *dap, unsigned int pkt_sz);
+static void cmsis_dap_replay_free(struct cmsis_dap *dap);
+
+static int cmsis_dap_replay_open(struct cmsis_dap *dap, uint16_t vids[], uint16_t pids[], const char *serial)
+{
+	if (!cmsis_dap_replay_filename) {
+		LOG_DEBUG("no CMSIS-DAP replay file set");
+		return ERROR_FAIL;
+	}
+
+	struct cmsis_dap_backend_data *bdata = calloc(1, sizeof(*bdata));
+	if (!bdata) {
+		LOG_ERROR("unable to allocate memory");
+		return ERROR_FAIL;
+	}
+
+	bdata->line = malloc(REPLAY_LINE_SIZE);
+	bdata->recorded = malloc(REPLAY_PACKET_SIZE);
+	bdata->out_file = fopen(cmsis_dap_replay_filename, "r");
+	bdata->in_file = fopen(cmsis_dap_replay_filename, "r");
+	if (!bdata->line || !bdata->recorded || !bdata->out_file || !bdata->in_file) {
+		LOG_ERROR("unable to open CMSIS-DAP replay file %s", cmsis_dap_replay_filename);
+		if (bdata->out_file)
+			fclose(bdata->out_file);
+		if (bdata->in_file)
+			fclose(bdata->in_file);
+		free(bdata->recorded);
+		free(bdata->line);
+		free(bdata);
+		return ERROR_FAIL;
+	}
+
+	dap->bdata = bdata;
+
+	LOG_INFO("CMSIS-DAP: replaying %s", cmsis_dap_replay_filename);
+
+	return cmsis_dap_replay_alloc(dap, 64);
+}
+
+static void cmsis_dap_replay_close(struct cmsis_dap *dap)
+{
+	struct cmsis_dap_backend_data *bdata = dap->bdata;
+
+	LOG_INFO("CMSIS-DAP replay: %u commands, %u responses, %u commands differ from the recording",
+		bdata->out_count, bdata->in_count, bdata->mismatches);
+
+	cmsis_dap_replay_free(dap);
+	fclose(bdata->out_file);
+	fclose(bdata->in_file);
+	free(bdata->recorded);
+	free(bdata->line);
+	free(bdata);
+	dap->bdata = NULL;
+}
+
+/* Read the next packet recorded in the direction 'in' or 'out' from file,
+ * return its length or -1 at the end of the recording. */
+static int cmsis_dap_replay_next(struct cmsis_dap_backend_data *bdata, FILE *file,
+	const char *direction, uint8_t *data, unsigned int size)
+{
+	char dir[4];
+	int offset;
+
+	while (fgets(bdata->line, REPLAY_LINE_SIZE, file)) {
+		if (sscanf(bdata->line, "%*s %3s %*x %n", dir, &offset) != 1)
+			continue;
+		if (strcmp(dir, direction))
+			continue;
+
+		const char *hex = bdata->line + offset;
+		unsigned int len = 0;
+		unsigned int byte;
+		while (len < size && sscanf(hex, "%2x", &byte) == 1) {
+			data[len++] = byte;
+			hex += 2;
+		}
+		return len;
+	}
+
+	return -1;
+}
+
+static int cmsis_dap_replay_read(struct cmsis_dap *dap, int transfer_timeout_ms,
+	struct timeval *wait_timeout)
+{
+	struct cmsis_dap_backend_data *bdata = dap->bdata;
+
+	int len = cmsis_dap_replay_next(bdata, bdata->in_file, "in",
+		dap->packet_buffer, dap->packet_buffer_size);
+	if (len < 0) {
+		LOG_ERROR("end of the CMSIS-DAP replay file");
+		return ERROR_TIMEOUT_REACHED;
+	}
+
+	memset(&dap->packet_buffer[len], 0, dap->packet_buffer_size - len);
+	bdata->in_count++;
+
+	return len;
+}
+
+static int cmsis_dap_replay_write(struct cmsis_dap *dap, int txlen, int timeout_ms)
+{
+	struct cmsis_dap_backend_data *bdata = dap->bdata;
+
+	int len = cmsis_dap_replay_next(bdata, bdata->out_file, "out",
+		bdata->recorded, REPLAY_PACKET_SIZE);
+	if (len < 0) {
+		LOG_ERROR("end of the CMSIS-DAP replay file");
+		return ERROR_FAIL;
+	}
+
+	if (len != txlen || memcmp(bdata->recorded, dap->command, txlen)) {
+		if (!bdata->mismatches)
+			LOG_WARNING("CMSIS-DAP replay: command %u differs from the recording",
+				bdata->out_count);
+		bdata->mismatches++;
+	}
+	bdata->out_count++;
+
+	return txlen;
+}
+
+static int cmsis_dap_replay_alloc(struct cmsis_dap *dap, unsigned int pkt_sz)
+{
+	uint8_t *buf = malloc(pkt_sz);
+	if (!buf) {
+		LOG_ERROR("unable to allocate CMSIS-DAP packet buffer");
+		return ERROR_FAIL;
+	}
+
+	/* Same layout as the usb_bulk backend, for the same packets */
+	dap->packet_buffer = buf;
+	dap->packet_size = pkt_sz;
+	dap->packet_buffer_size = pkt_sz;
+	dap->packet_usable_size = pkt_sz - 1;
+
+	dap->command = dap->packet_buffer;
+	dap->response = dap->packet_buffer;
+
+	return ERROR_OK;
+}
+
+static void cmsis_dap_replay_free(struct cmsis_dap *dap)
+{
+	free(dap->packet_buffer);
+	dap->packet_buffer = NULL;
+	dap->command = NULL;
+	dap->response = NULL;
+}
+
+static void cmsis_dap_replay_cancel_all(struct cmsis_dap *dap)
+{
+}
+
+COMMAND_HANDLER(cmsis_dap_handle_replay_file_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	free(cmsis_dap_replay_filename);
+	cmsis_dap_replay_filename = strdup(CMD_ARGV[0]);
+
+	return ERROR_OK;
+}
+
+const struct command_registration cmsis_dap_replay_subcommand_handlers[] = {
+	{
+		.name = "file",
+		.handler = &cmsis_dap_handle_replay_file_command,
+		.mode = COMMAND_CONFIG,
+		.help = "set the file recorded with 'adapter usb record' to replay "
+			"(for replay backend only)",
+		.usage = "<filename>",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+const struct cmsis_dap_backend cmsis_dap_replay_backend = {
+	.name = "replay",
+	.open = cmsis_dap_replay_open,
+	.close = cmsis_dap_replay_close,
+	.read = cmsis_dap_replay_read,
+	.write = cmsis_dap_replay_write,
+	.packet_buffer_alloc = cmsis_dap_replay_alloc,
+	.packet_buffer_free = cmsis_dap_replay_free,
+	.cancel_all = cmsis_dap_replay_cancel_all,
+};
@@ -28,6 +28,7 @@
 #include <libusb.h>
 #include <helper/log.h>
 #include <helper/replacements.h>
+#include <jtag/adapter.h>
 #include <jtag/jtag.h>	/* ERROR_JTAG_DEVICE_ERROR only */
 
 #include "cmsis_dap.h"
@@ -440,6 +441,28 @@ static void LIBUSB_CALL cmsis_dap_usb_callback(struct libusb_transfer *transfer)
 	}
 }
 
+static int cmsis_dap_usb_submit_read(struct cmsis_dap *dap, unsigned int idx,
+									 int transfer_timeout_ms)
+{
+	struct cmsis_dap_bulk_transfer *tr = &dap->bdata->response_transfers[idx];
+
+	libusb_fill_bulk_transfer(tr->transfer,
+							  dap->bdata->dev_handle, dap->bdata->ep_in,
+							  tr->buffer, dap->packet_size,
+							  &cmsis_dap_usb_callback, tr,
+							  transfer_timeout_ms);
+	LOG_DEBUG_IO("submit read @ %u", idx);
+	tr->status = CMSIS_DAP_TRANSFER_PENDING;
+	int err = libusb_submit_transfer(tr->transfer);
+	if (err) {
+		tr->status = CMSIS_DAP_TRANSFER_IDLE;
+		LOG_ERROR("error submitting USB read: %s", libusb_strerror(err));
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
 static int cmsis_dap_usb_read(struct cmsis_dap *dap, int transfer_timeout_ms,
 							  struct timeval *wait_timeout)
 {
@@ -449,19 +472,9 @@ static int cmsis_dap_usb_read(struct cmsis_dap *dap, int transfer_timeout_ms,
 	tr = &dap->bdata->response_transfers[dap->pending_fifo_get_idx];
 
 	if (tr->status == CMSIS_DAP_TRANSFER_IDLE) {
-		libusb_fill_bulk_transfer(tr->transfer,
-								  dap->bdata->dev_handle, dap->bdata->ep_in,
-								  tr->buffer, dap->packet_size,
-								  &cmsis_dap_usb_callback, tr,
-								  transfer_timeout_ms);
-		LOG_DEBUG_IO("submit read @ %u", dap->pending_fifo_get_idx);
-		tr->status = CMSIS_DAP_TRANSFER_PENDING;
-		err = libusb_submit_transfer(tr->transfer);
-		if (err) {
-			tr->status = CMSIS_DAP_TRANSFER_IDLE;
-			LOG_ERROR("error submitting USB read: %s", libusb_strerror(err));
-			return ERROR_FAIL;
-		}
+		err = cmsis_dap_usb_submit_read(dap, dap->pending_fifo_get_idx, transfer_timeout_ms);
+		if (err != ERROR_OK)
+			return err;
 	}
 
 	struct timeval tv = {
@@ -515,6 +528,7 @@ static int cmsis_dap_usb_read(struct cmsis_dap *dap, int transfer_timeout_ms,
 		LOG_DEBUG_IO("completed read @ %u, transferred %i",
 					 dap->pending_fifo_get_idx, transferred);
 		memcpy(dap->packet_buffer, tr->buffer, transferred);
+		adapter_usb_record(true, dap->bdata->ep_in, tr->buffer, transferred);
 		memset(&dap->packet_buffer[transferred], 0, dap->packet_buffer_size - transferred);
 		tr->status = CMSIS_DAP_TRANSFER_IDLE;
 	}
@@ -554,6 +568,7 @@ static int cmsis_dap_usb_write(struct cmsis_dap *dap, int txlen, int timeout_ms)
 	}
 
 	memcpy(tr->buffer, dap->packet_buffer, txlen);
+	adapter_usb_record(false, dap->bdata->ep_out, tr->buffer, txlen);
 
 	libusb_fill_bulk_transfer(tr->transfer,
 							  dap->bdata->dev_handle, dap->bdata->ep_out,
@@ -574,6 +589,14 @@ static int cmsis_dap_usb_write(struct cmsis_dap *dap, int txlen, int timeout_ms)
 		return ERROR_FAIL;
 	}
 
+	/* Have the response transfer in flight too, so that the adapter
+	 * can return it as soon as ready, while we prepare the next
+	 * requests. cmsis_dap_usb_read() then only waits for completion */
+	struct cmsis_dap_bulk_transfer *tr_resp;
+	tr_resp = &dap->bdata->response_transfers[dap->pending_fifo_put_idx];
+	if (tr_resp->status == CMSIS_DAP_TRANSFER_IDLE)
+		cmsis_dap_usb_submit_read(dap, dap->pending_fifo_put_idx, timeout_ms);
+
 	return ERROR_OK;
 }
 
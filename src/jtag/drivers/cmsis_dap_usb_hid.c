@@ -27,6 +27,7 @@
 #include <string.h>
 #include <hidapi.h>
 #include <helper/log.h>
+#include <jtag/adapter.h>
 
 #include "cmsis_dap.h"
 
@@ -220,6 +221,8 @@ static int cmsis_dap_hid_read(struct cmsis_dap *dap, int transfer_timeout_ms,
 		return ERROR_FAIL;
 	}
 
+	adapter_usb_record(true, 0, dap->response, retval);
+
 	return retval;
 }
 
@@ -232,6 +235,8 @@ static int cmsis_dap_hid_write(struct cmsis_dap *dap, int txlen, int timeout_ms)
 	/* Pad the rest of the TX buffer with 0's */
 	memset(dap->command + txlen, 0, dap->packet_size - txlen);
 
+	adapter_usb_record(false, 0, dap->command, dap->packet_size);
+
 	/* write data to device */
 	int retval = hid_write(dap->bdata->dev_handle, dap->packet_buffer, dap->packet_buffer_size);
 	if (retval == -1) {
@@ -305,6 +305,57 @@ static int dmem_ap_q_write(struct adiv5_ap *ap, unsigned int reg, uint32_t data)
 	return ERROR_OK;
 }
 
+/*
+ * Block transfers, e.g. a MEM-AP read or write through DRW. The register
+ * address is computed once and the data moved in a tight loop, the AP
+ * increments its TAR by itself.
+ */
+static int dmem_ap_q_read_buf(struct adiv5_ap *ap, unsigned int reg,
+		uint32_t *data, unsigned int count)
+{
+	unsigned int idx;
+
+	if (is_adiv6(ap->dap) || dmem_is_emulated_ap(ap, &idx)) {
+		for (unsigned int i = 0; i < count; i++) {
+			int retval = dmem_ap_q_read(ap, reg, data + i);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		return ERROR_OK;
+	}
+
+	volatile uint32_t *addr = (volatile uint32_t *)((uintptr_t)dmem_virt_base_addr +
+									dmem_get_ap_reg_offset(ap, reg));
+
+	for (unsigned int i = 0; i < count; i++)
+		data[i] = *addr;
+
+	return ERROR_OK;
+}
+
+static int dmem_ap_q_write_buf(struct adiv5_ap *ap, unsigned int reg,
+		const uint32_t *data, unsigned int count)
+{
+	unsigned int idx;
+
+	if (is_adiv6(ap->dap) || dmem_is_emulated_ap(ap, &idx)) {
+		for (unsigned int i = 0; i < count; i++) {
+			int retval = dmem_ap_q_write(ap, reg, data[i]);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		return ERROR_OK;
+	}
+
+	volatile uint32_t *addr = (volatile uint32_t *)((uintptr_t)dmem_virt_base_addr +
+									dmem_get_ap_reg_offset(ap, reg));
+
+	for (unsigned int i = 0; i < count; i++)
+		*addr = data[i];
+
+	return ERROR_OK;
+}
+
 static int dmem_ap_q_abort(struct adiv5_dap *dap, uint8_t *ack)
 {
 	return ERROR_OK;
@@ -600,6 +651,8 @@ static const struct dap_ops dmem_dap_ops = {
 	.queue_dp_write = dmem_dp_q_write,
 	.queue_ap_read = dmem_ap_q_read,
 	.queue_ap_write = dmem_ap_q_write,
+	.queue_ap_read_buf = dmem_ap_q_read_buf,
+	.queue_ap_write_buf = dmem_ap_q_write_buf,
 	.queue_ap_abort = dmem_ap_q_abort,
 	.run = dmem_dp_run,
 };
@@ -20,10 +20,12 @@
 #endif
 
 #include <jtag/jtag.h>
+#include <jtag/adapter.h>
 #include <jtag/interface.h>
 #include <jtag/commands.h>
 #include <jtag/minidriver.h>
 #include <helper/command.h>
+#include <helper/time_support.h>
 
 struct jtag_callback_entry {
 	struct jtag_callback_entry *next;
@@ -35,6 +37,8 @@ struct jtag_callback_entry {
 	jtag_callback_data_t data3;
 };
 
+extern struct adapter_driver *adapter_driver;
+
 static struct jtag_callback_entry *jtag_callback_queue_head;
 static struct jtag_callback_entry *jtag_callback_queue_tail;
 
@@ -85,13 +89,7 @@ int interface_jtag_add_ir_scan(struct jtag_tap *active,
 			tap->bypass = true;
 
 			field->num_bits = tap->ir_length;
-			if (tap->ir_bypass_value) {
-				uint8_t *v = cmd_queue_alloc(DIV_ROUND_UP(tap->ir_length, 8));
-				buf_set_u64(v, 0, tap->ir_length, tap->ir_bypass_value);
-				field->out_value = v;
-			} else {
-				field->out_value = buf_set_ones(cmd_queue_alloc(DIV_ROUND_UP(tap->ir_length, 8)), tap->ir_length);
-			}
+			field->out_value = tap->bypass_instr;
 			field->in_value = NULL; /* do not collect input for tap's in bypass */
 		}
 
@@ -106,12 +104,8 @@ int interface_jtag_add_ir_scan(struct jtag_tap *active,
 	return ERROR_OK;
 }
 
-/**
- * see jtag_add_dr_scan()
- *
- */
-int interface_jtag_add_dr_scan(struct jtag_tap *active, int in_num_fields,
-		const struct scan_field *in_fields, tap_state_t state)
+static int jtag_add_dr_scan_inner(struct jtag_tap *active, int in_num_fields,
+		const struct scan_field *in_fields, tap_state_t state, bool copy)
 {
 	/* count devices in bypass */
 
@@ -160,7 +154,13 @@ int interface_jtag_add_dr_scan(struct jtag_tap *active, int in_num_fields,
 #endif /* NDEBUG */
 
 			for (int j = 0; j < in_num_fields; j++) {
-				jtag_scan_field_clone(field, in_fields + j);
+				if (copy) {
+					jtag_scan_field_clone(field, in_fields + j);
+				} else {
+					field->num_bits = in_fields[j].num_bits;
+					field->out_value = in_fields[j].out_value;
+					field->in_value = in_fields[j].in_value;
+				}
 
 				field++;
 			}
@@ -183,8 +183,28 @@ int interface_jtag_add_dr_scan(struct jtag_tap *active, int in_num_fields,
 	return ERROR_OK;
 }
 
+/**
+ * see jtag_add_dr_scan()
+ *
+ */
+int interface_jtag_add_dr_scan(struct jtag_tap *active, int in_num_fields,
+		const struct scan_field *in_fields, tap_state_t state)
+{
+	return jtag_add_dr_scan_inner(active, in_num_fields, in_fields, state, true);
+}
+
+/**
+ * see jtag_add_dr_scan_nocopy()
+ *
+ */
+int interface_jtag_add_dr_scan_nocopy(struct jtag_tap *active, int in_num_fields,
+		const struct scan_field *in_fields, tap_state_t state)
+{
+	return jtag_add_dr_scan_inner(active, in_num_fields, in_fields, state, false);
+}
+
 static int jtag_add_plain_scan(int num_bits, const uint8_t *out_bits,
-		uint8_t *in_bits, tap_state_t state, bool ir_scan)
+		uint8_t *in_bits, tap_state_t state, bool ir_scan, bool copy)
 {
 	struct jtag_command *cmd = cmd_queue_alloc(sizeof(struct jtag_command));
 	struct scan_command *scan = cmd_queue_alloc(sizeof(struct scan_command));
@@ -201,7 +221,10 @@ static int jtag_add_plain_scan(int num_bits, const uint8_t *out_bits,
 	scan->end_state = state;
 
 	out_fields->num_bits = num_bits;
-	out_fields->out_value = buf_cpy(out_bits, cmd_queue_alloc(DIV_ROUND_UP(num_bits, 8)), num_bits);
+	if (copy)
+		out_fields->out_value = buf_cpy(out_bits, cmd_queue_alloc(DIV_ROUND_UP(num_bits, 8)), num_bits);
+	else
+		out_fields->out_value = out_bits;
 	out_fields->in_value = in_bits;
 
 	return ERROR_OK;
@@ -209,12 +232,17 @@ static int jtag_add_plain_scan(int num_bits, const uint8_t *out_bits,
 
 int interface_jtag_add_plain_dr_scan(int num_bits, const uint8_t *out_bits, uint8_t *in_bits, tap_state_t state)
 {
-	return jtag_add_plain_scan(num_bits, out_bits, in_bits, state, false);
+	return jtag_add_plain_scan(num_bits, out_bits, in_bits, state, false, true);
+}
+
+int interface_jtag_add_plain_dr_scan_nocopy(int num_bits, const uint8_t *out_bits, uint8_t *in_bits, tap_state_t state)
+{
+	return jtag_add_plain_scan(num_bits, out_bits, in_bits, state, false, false);
 }
 
 int interface_jtag_add_plain_ir_scan(int num_bits, const uint8_t *out_bits, uint8_t *in_bits, tap_state_t state)
 {
-	return jtag_add_plain_scan(num_bits, out_bits, in_bits, state, true);
+	return jtag_add_plain_scan(num_bits, out_bits, in_bits, state, true, true);
 }
 
 int interface_jtag_add_tlr(void)
@@ -363,6 +391,17 @@ void interface_jtag_add_callback4(jtag_callback_t callback,
 	}
 }
 
+static int jtag_callback_queue_run(struct jtag_callback_entry *entry)
+{
+	for (; entry; entry = entry->next) {
+		int retval = entry->callback(entry->data0, entry->data1, entry->data2, entry->data3);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return ERROR_OK;
+}
+
 int interface_jtag_execute_queue(void)
 {
 	static int reentry;
@@ -370,15 +409,13 @@ int interface_jtag_execute_queue(void)
 	assert(reentry == 0);
 	reentry++;
 
-	int retval = default_interface_jtag_execute_queue();
-	if (retval == ERROR_OK) {
-		struct jtag_callback_entry *entry;
-		for (entry = jtag_callback_queue_head; entry; entry = entry->next) {
-			retval = entry->callback(entry->data0, entry->data1, entry->data2, entry->data3);
-			if (retval != ERROR_OK)
-				break;
-		}
-	}
+	/* keep the order of execution with a queue still in flight, this queue
+	 * is dropped when the one in flight failed */
+	int retval = interface_jtag_execute_queue_wait();
+	if (retval == ERROR_OK)
+		retval = default_interface_jtag_execute_queue();
+	if (retval == ERROR_OK)
+		retval = jtag_callback_queue_run(jtag_callback_queue_head);
 
 	jtag_command_queue_reset();
 	jtag_callback_queue_reset();
@@ -388,6 +425,109 @@ int interface_jtag_execute_queue(void)
 	return retval;
 }
 
+/** A queue submitted to the adapter and not yet completed */
+struct jtag_async_queue {
+	struct cmd_queue_batch *batch;
+	struct jtag_callback_entry *callbacks;
+	jtag_queue_done_callback_t done;
+	void *priv;
+	/* adapter statistics, the time is the time spent blocked in the driver */
+	bool timed;
+	unsigned int commands;
+	uint64_t bits;
+	int64_t elapsed_us;
+};
+
+static struct jtag_async_queue *jtag_async_queue_in_flight;
+
+static int jtag_async_queue_complete(struct jtag_async_queue *queue, int retval)
+{
+	if (retval == ERROR_OK)
+		retval = jtag_callback_queue_run(queue->callbacks);
+
+	jtag_command_queue_batch_free(queue->batch);
+
+	if (queue->done)
+		queue->done(retval, queue->priv);
+	free(queue);
+
+	return retval;
+}
+
+int interface_jtag_execute_queue_wait(void)
+{
+	struct jtag_async_queue *queue = jtag_async_queue_in_flight;
+
+	if (!queue)
+		return ERROR_OK;
+
+	jtag_async_queue_in_flight = NULL;
+
+	int64_t start = queue->timed ? timeval_us() : 0;
+	int retval = adapter_driver->jtag_ops->execute_queue_wait();
+	if (queue->timed)
+		adapter_stats_flush(queue->commands, queue->bits,
+			queue->elapsed_us + timeval_us() - start);
+
+	return jtag_async_queue_complete(queue, retval);
+}
+
+int interface_jtag_execute_queue_async(jtag_queue_done_callback_t done, void *priv)
+{
+	/* only one queue in flight, while the next one is being built. When the
+	 * queue in flight failed, this one fails too, through its done callback */
+	jtag_set_error(interface_jtag_execute_queue_wait());
+
+	struct jtag_async_queue *queue = malloc(sizeof(*queue));
+	if (!queue) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	jtag_command_queue_coalesce();
+
+	queue->batch = jtag_command_queue_detach();
+	if (!queue->batch) {
+		LOG_ERROR("Out of memory");
+		free(queue);
+		return ERROR_FAIL;
+	}
+	queue->callbacks = jtag_callback_queue_head;
+	queue->done = done;
+	queue->priv = priv;
+	jtag_callback_queue_reset();
+
+	struct jtag_command *cmd_queue = jtag_command_queue_batch_get(queue->batch);
+	queue->timed = adapter_flush_timed();
+	queue->commands = 0;
+	queue->bits = 0;
+	queue->elapsed_us = 0;
+	if (queue->timed) {
+		for (struct jtag_command *c = cmd_queue; c; c = c->next) {
+			queue->commands++;
+			if (c->type == JTAG_SCAN)
+				queue->bits += jtag_scan_size(c->cmd.scan);
+		}
+		queue->elapsed_us = -timeval_us();
+	}
+
+	/* errors recorded while building the queue belong to it */
+	int retval = jtag_error_clear();
+	if (retval == ERROR_OK)
+		retval = adapter_driver->jtag_ops->execute_queue_async(cmd_queue);
+	if (queue->timed)
+		queue->elapsed_us += timeval_us();
+	if (retval != ERROR_OK) {
+		if (queue->timed)
+			adapter_stats_flush(queue->commands, queue->bits, queue->elapsed_us);
+		return jtag_async_queue_complete(queue, retval);
+	}
+
+	jtag_async_queue_in_flight = queue;
+
+	return ERROR_OK;
+}
+
 static int jtag_convert_to_callback4(jtag_callback_data_t data0,
 		jtag_callback_data_t data1, jtag_callback_data_t data2, jtag_callback_data_t data3)
 {
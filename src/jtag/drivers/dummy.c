@@ -10,6 +10,10 @@
 #endif
 
 #include <jtag/interface.h>
+#include <jtag/swd.h>
+#include <transport/transport.h>
+#include <target/arm_adi_v5.h>
+#include <target/cortex_m.h>
 #include "bitbang.h"
 #include "hello.h"
 
@@ -61,6 +65,325 @@ static int dummy_write(int tck, int tms, int tdi)
 	return ERROR_OK;
 }
 
+/*
+ * Simulated SWD target: a SW-DP, one AHB MEM-AP with a RAM region and a
+ * minimal Cortex-M debug register model (CPUID, DHCSR, DCRSR, DCRDR,
+ * DEMCR, AIRCR, DFSR), enough to examine, halt, step and access memory
+ * and core registers. Other addresses read as zero and ignore writes.
+ * The optional latency emulates the cost of a USB probe on each flush.
+ */
+#define DUMMY_SIM_DPIDR		0x2ba01477	/* SW-DP v1 */
+#define DUMMY_SIM_AP_IDR	0x24770011	/* AHB-AP for Cortex-M3/M4 */
+#define DUMMY_SIM_CPUID		0x410fc241	/* Cortex-M4 r0p1 */
+#define DUMMY_SIM_XPSR_T	BIT(24)
+
+/* request, turnaround, ack, turnaround, data and parity */
+#define DUMMY_SIM_SWD_BITS	46
+
+static struct dummy_sim {
+	/* configuration */
+	uint32_t ram_address;
+	uint32_t ram_size;
+	uint32_t flush_latency_us;
+	uint32_t bit_time_ns;
+
+	uint8_t *ram;
+
+	/* SW-DP */
+	uint32_t ctrl_stat;
+	uint32_t select;
+	uint32_t rdbuff;
+
+	/* MEM-AP */
+	uint32_t csw;
+	uint32_t tar;
+
+	/* Cortex-M core */
+	bool halted;
+	bool reset_st;
+	uint32_t dhcsr;
+	uint32_t dcrdr;
+	uint32_t demcr;
+	uint32_t dfsr;
+	uint32_t core_regs[128];
+
+	uint64_t queued_bits;
+} dummy_sim = {
+	.ram_address = 0x20000000,
+	.ram_size = 64 * 1024,
+};
+
+static void dummy_sim_core_reset(void)
+{
+	memset(dummy_sim.core_regs, 0, sizeof(dummy_sim.core_regs));
+	dummy_sim.core_regs[ARMV7M_XPSR] = DUMMY_SIM_XPSR_T;
+	dummy_sim.reset_st = true;
+	dummy_sim.halted = (dummy_sim.dhcsr & C_DEBUGEN) && (dummy_sim.demcr & VC_CORERESET);
+	if (dummy_sim.halted)
+		dummy_sim.dfsr |= DFSR_VCATCH;
+}
+
+static uint32_t dummy_sim_read_word(uint32_t address)
+{
+	uint32_t offset = address - dummy_sim.ram_address;
+	uint32_t value;
+
+	if (dummy_sim.ram && address >= dummy_sim.ram_address && offset < dummy_sim.ram_size)
+		return le_to_h_u32(dummy_sim.ram + offset);
+
+	switch (address) {
+	case CPUID:
+		return DUMMY_SIM_CPUID;
+	case NVIC_DFSR:
+		return dummy_sim.dfsr;
+	case DCB_DHCSR:
+		value = dummy_sim.dhcsr | S_REGRDY;
+		if (dummy_sim.halted)
+			value |= S_HALT;
+		if (dummy_sim.reset_st)
+			value |= S_RESET_ST;
+		dummy_sim.reset_st = false;
+		return value;
+	case DCB_DCRDR:
+		return dummy_sim.dcrdr;
+	case DCB_DEMCR:
+		return dummy_sim.demcr;
+	default:
+		return 0;
+	}
+}
+
+static void dummy_sim_write_word(uint32_t address, uint32_t value, unsigned int lanes)
+{
+	uint32_t offset = address - dummy_sim.ram_address;
+
+	if (dummy_sim.ram && address >= dummy_sim.ram_address && offset < dummy_sim.ram_size) {
+		for (unsigned int i = 0; i < 4; i++)
+			if (lanes & BIT(i))
+				dummy_sim.ram[offset + i] = value >> (8 * i);
+		return;
+	}
+
+	/* the debug registers only take word accesses */
+	if (lanes != 0xf)
+		return;
+
+	switch (address) {
+	case NVIC_AIRCR:
+		if ((value & 0xffff0000) == AIRCR_VECTKEY && (value & (AIRCR_SYSRESETREQ | AIRCR_VECTRESET)))
+			dummy_sim_core_reset();
+		break;
+	case NVIC_DFSR:
+		dummy_sim.dfsr &= ~value;
+		break;
+	case DCB_DHCSR:
+		if ((value & 0xffff0000) != DBGKEY)
+			break;
+		dummy_sim.dhcsr = value & (C_DEBUGEN | C_HALT | C_STEP | C_MASKINTS);
+		if (!(value & C_DEBUGEN)) {
+			dummy_sim.halted = false;
+		} else if (value & C_HALT) {
+			if (!dummy_sim.halted)
+				dummy_sim.dfsr |= DFSR_HALTED;
+			dummy_sim.halted = true;
+		} else if (dummy_sim.halted && !(value & C_STEP)) {
+			dummy_sim.halted = false;
+		}
+		/* a step completes at once, the core stays halted */
+		break;
+	case DCB_DCRSR:
+		if (value & DCRSR_WNR)
+			dummy_sim.core_regs[value & 0x7f] = dummy_sim.dcrdr;
+		else
+			dummy_sim.dcrdr = dummy_sim.core_regs[value & 0x7f];
+		break;
+	case DCB_DCRDR:
+		dummy_sim.dcrdr = value;
+		break;
+	case DCB_DEMCR:
+		dummy_sim.demcr = value;
+		break;
+	default:
+		break;
+	}
+}
+
+/* Access through DRW or BDn, TAR is the address of the first byte */
+static uint32_t dummy_sim_mem_ap_data(uint32_t address, bool is_read, uint32_t value, bool increment)
+{
+	unsigned int size = 1 << (dummy_sim.csw & CSW_SIZE_MASK);
+	unsigned int byte = address & 3;
+	unsigned int lanes;
+	uint32_t step;
+
+	if ((dummy_sim.csw & CSW_ADDRINC_MASK) == CSW_ADDRINC_PACKED) {
+		/* packed: all the units up to the end of the word */
+		lanes = (0xf << byte) & 0xf;
+		step = 4 - byte;
+	} else {
+		lanes = ((1 << size) - 1) << byte;
+		step = size;
+	}
+
+	if (is_read)
+		value = dummy_sim_read_word(address & ~3);
+	else
+		dummy_sim_write_word(address & ~3, value, lanes & 0xf);
+
+	/* TAR increments within a 1 KiB block */
+	if (increment && (dummy_sim.csw & CSW_ADDRINC_MASK) != CSW_ADDRINC_OFF)
+		dummy_sim.tar = (dummy_sim.tar & ~0x3ff) | ((dummy_sim.tar + step) & 0x3ff);
+
+	return value;
+}
+
+static uint32_t dummy_sim_ap_access(unsigned int reg, bool is_read, uint32_t value)
+{
+	/* only AP 0 exists */
+	if (dummy_sim.select & ADIV5_DP_SELECT_APSEL)
+		return 0;
+
+	switch (reg) {
+	case ADIV5_MEM_AP_REG_CSW:
+		if (!is_read) {
+			/* 64 bit and larger transfers are not supported */
+			if ((value & CSW_SIZE_MASK) > CSW_32BIT)
+				value = (value & ~CSW_SIZE_MASK) | CSW_32BIT;
+			dummy_sim.csw = value & ~CSW_DEVICE_EN;
+		}
+		return dummy_sim.csw | CSW_DEVICE_EN;
+	case ADIV5_MEM_AP_REG_TAR:
+		if (!is_read)
+			dummy_sim.tar = value;
+		return dummy_sim.tar;
+	case ADIV5_MEM_AP_REG_DRW:
+		return dummy_sim_mem_ap_data(dummy_sim.tar, is_read, value, true);
+	case ADIV5_MEM_AP_REG_BD0:
+	case ADIV5_MEM_AP_REG_BD1:
+	case ADIV5_MEM_AP_REG_BD2:
+	case ADIV5_MEM_AP_REG_BD3:
+		return dummy_sim_mem_ap_data((dummy_sim.tar & ~0xf) | (reg & 0xc), is_read, value, false);
+	case ADIV5_MEM_AP_REG_BASE:
+		return 0xffffffff;	/* no debug entries */
+	case ADIV5_AP_REG_IDR:
+		return DUMMY_SIM_AP_IDR;
+	default:
+		return 0;
+	}
+}
+
+static uint32_t dummy_sim_dp_access(unsigned int reg, bool is_read, uint32_t value)
+{
+	switch (reg) {
+	case DP_DPIDR:
+		/* a write is to ABORT, no sticky errors to clear */
+		return is_read ? DUMMY_SIM_DPIDR : 0;
+	case DP_CTRL_STAT:
+		if (dummy_sim.select & DP_SELECT_DPBANK)
+			return 0;
+		if (!is_read)
+			dummy_sim.ctrl_stat = value & (CDBGPWRUPREQ | CSYSPWRUPREQ);
+		/* the power domains are up as soon as requested */
+		return dummy_sim.ctrl_stat | ((dummy_sim.ctrl_stat & (CDBGPWRUPREQ | CSYSPWRUPREQ)) << 1);
+	case DP_SELECT:
+		if (!is_read)
+			dummy_sim.select = value;
+		return dummy_sim.rdbuff;	/* read is RESEND */
+	case DP_RDBUFF:
+		/* a write is to TARGETSEL, single drop only */
+		return dummy_sim.rdbuff;
+	default:
+		return 0;
+	}
+}
+
+static int dummy_swd_init(void)
+{
+	return ERROR_OK;
+}
+
+static int dummy_swd_switch_seq(enum swd_special_seq seq)
+{
+	switch (seq) {
+	case LINE_RESET:
+		dummy_sim.queued_bits += swd_seq_line_reset_len;
+		break;
+	case JTAG_TO_SWD:
+		dummy_sim.queued_bits += swd_seq_jtag_to_swd_len;
+		break;
+	case JTAG_TO_DORMANT:
+		dummy_sim.queued_bits += swd_seq_jtag_to_dormant_len;
+		break;
+	case SWD_TO_JTAG:
+		dummy_sim.queued_bits += swd_seq_swd_to_jtag_len;
+		break;
+	case SWD_TO_DORMANT:
+		dummy_sim.queued_bits += swd_seq_swd_to_dormant_len;
+		break;
+	case DORMANT_TO_SWD:
+		dummy_sim.queued_bits += swd_seq_dormant_to_swd_len;
+		break;
+	case DORMANT_TO_JTAG:
+		dummy_sim.queued_bits += swd_seq_dormant_to_jtag_len;
+		break;
+	default:
+		LOG_ERROR("Sequence %d not supported", seq);
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
+static void dummy_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data, uint32_t ap_delay_clk)
+{
+	unsigned int reg = (cmd & SWD_CMD_A32) >> 1;
+	bool is_read = cmd & SWD_CMD_RNW;
+
+	dummy_sim.queued_bits += DUMMY_SIM_SWD_BITS;
+
+	if (cmd & SWD_CMD_APNDP) {
+		dummy_sim.queued_bits += ap_delay_clk;
+		reg |= dummy_sim.select & ADIV5_DP_SELECT_APBANK;
+		if (is_read) {
+			/* AP reads are posted, return the previous result */
+			uint32_t value = dummy_sim.rdbuff;
+			dummy_sim.rdbuff = dummy_sim_ap_access(reg, true, 0);
+			data = value;
+		} else {
+			dummy_sim_ap_access(reg, false, data);
+		}
+	} else {
+		data = dummy_sim_dp_access(reg, is_read, data);
+	}
+
+	if (is_read && dst)
+		*dst = data;
+}
+
+static void dummy_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay_clk)
+{
+	assert(cmd & SWD_CMD_RNW);
+	dummy_swd_queue_cmd(cmd, value, 0, ap_delay_clk);
+}
+
+static void dummy_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay_clk)
+{
+	assert(!(cmd & SWD_CMD_RNW));
+	dummy_swd_queue_cmd(cmd, NULL, value, ap_delay_clk);
+}
+
+static int dummy_swd_run_queue(void)
+{
+	uint64_t us = dummy_sim.flush_latency_us
+		+ dummy_sim.queued_bits * dummy_sim.bit_time_ns / 1000;
+
+	dummy_sim.queued_bits = 0;
+	if (us)
+		jtag_sleep(us);
+
+	return ERROR_OK;
+}
+
 static int dummy_reset(int trst, int srst)
 {
 	dummy_clock = 0;
@@ -68,6 +391,9 @@ static int dummy_reset(int trst, int srst)
 	if (trst || (srst && (jtag_get_reset_config() & RESET_SRST_PULLS_TRST)))
 		dummy_state = TAP_RESET;
 
+	if (srst)
+		dummy_sim_core_reset();
+
 	LOG_DEBUG("reset to: %s", tap_state_name(dummy_state));
 	return ERROR_OK;
 }
@@ -111,36 +437,126 @@ static int dummy_init(void)
 {
 	bitbang_interface = &dummy_bitbang;
 
+	if (transport_is_swd()) {
+		dummy_sim.ram = calloc(dummy_sim.ram_size, 1);
+		if (!dummy_sim.ram && dummy_sim.ram_size) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		dummy_sim_core_reset();
+	}
+
 	return ERROR_OK;
 }
 
 static int dummy_quit(void)
 {
+	free(dummy_sim.ram);
+	dummy_sim.ram = NULL;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(dummy_handle_sim_ram_command)
+{
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	uint32_t address, size;
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], address);
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], size);
+	if ((address | size) & 3 || (size && address + size - 1 < address)) {
+		command_print(CMD, "RAM must be word aligned and below 4 GiB");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	dummy_sim.ram_address = address;
+	dummy_sim.ram_size = size;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(dummy_handle_sim_latency_command)
+{
+	if (CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC >= 1)
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], dummy_sim.flush_latency_us);
+	if (CMD_ARGC == 2)
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], dummy_sim.bit_time_ns);
+
+	command_print(CMD, "flush latency %" PRIu32 " us, bit time %" PRIu32 " ns",
+		dummy_sim.flush_latency_us, dummy_sim.bit_time_ns);
+
 	return ERROR_OK;
 }
 
+static const struct command_registration dummy_sim_command_handlers[] = {
+	{
+		.name = "ram",
+		.handler = dummy_handle_sim_ram_command,
+		.mode = COMMAND_CONFIG,
+		.help = "set the address and size of the simulated RAM",
+		.usage = "address size",
+	},
+	{
+		.name = "latency",
+		.handler = dummy_handle_sim_latency_command,
+		.mode = COMMAND_ANY,
+		.help = "set the simulated time of each queue flush and of each SWD bit",
+		.usage = "[flush_us [bit_ns]]",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration dummy_subcommand_handlers[] = {
+	{
+		.name = "sim",
+		.mode = COMMAND_ANY,
+		.help = "simulated SWD target commands",
+		.chain = dummy_sim_command_handlers,
+		.usage = "",
+	},
+	{
+		.chain = hello_command_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
 static const struct command_registration dummy_command_handlers[] = {
 	{
 		.name = "dummy",
 		.mode = COMMAND_ANY,
 		.help = "dummy interface driver commands",
-		.chain = hello_command_handlers,
+		.chain = dummy_subcommand_handlers,
 		.usage = "",
 	},
 	COMMAND_REGISTRATION_DONE,
 };
 
 /* The dummy driver is used to easily check the code path
- * where the target is unresponsive.
+ * where the target is unresponsive, or, with SWD, to run against
+ * the simulated target above.
  */
 static struct jtag_interface dummy_interface = {
 	.supported = DEBUG_CAP_TMS_SEQ,
 	.execute_queue = &bitbang_execute_queue,
 };
 
+static const struct swd_driver dummy_swd = {
+	.init = dummy_swd_init,
+	.switch_seq = dummy_swd_switch_seq,
+	.read_reg = dummy_swd_read_reg,
+	.write_reg = dummy_swd_write_reg,
+	.run = dummy_swd_run_queue,
+};
+
+static const char * const dummy_transports[] = { "jtag", "swd", NULL };
+
 struct adapter_driver dummy_adapter_driver = {
 	.name = "dummy",
-	.transports = jtag_only,
+	.transports = dummy_transports,
 	.commands = dummy_command_handlers,
 
 	.init = &dummy_init,
@@ -151,4 +567,5 @@ struct adapter_driver dummy_adapter_driver = {
 	.speed_div = &dummy_speed_div,
 
 	.jtag_ops = &dummy_interface,
+	.swd_ops = &dummy_swd,
 };
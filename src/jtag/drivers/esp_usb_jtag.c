@@ -176,12 +176,24 @@ struct jtag_proto_caps_speed_apb {
 /* Out data can be buffered for longer without issues (as long as the in buffer does not overflow),
  * so we'll use an out buffer that is much larger than the out ep size. */
 #define OUT_BUF_SZ (OUT_EP_SZ * 32)
+/* One out buffer is filled while the other one is being sent. */
+#define OUT_BUF_CT 2
 /* The in buffer cannot be larger than the device can offer, though. */
 #define IN_BUF_SZ 64
 
 /* Because a series of out commands can lead to a multitude of IN_BUF_SZ-sized in packets
- *to be read, we have multiple buffers to store those before the bitq interface reads them out. */
-#define IN_BUF_CT 8
+ *to be read, we have multiple buffers to store those before the bitq interface reads them out.
+ * Two full out buffers of capturing commands fill (2 * OUT_BUF_SZ * 2 / 8 / IN_BUF_SZ =) 16. */
+#define IN_BUF_CT 32
+/* Number of reads kept submitted, so that the adapter never waits for the host to empty its
+ * IN endpoint. */
+#define IN_XFER_CT 2
+
+enum esp_usb_jtag_in_buf_state {
+	IN_BUF_FREE = 0,
+	IN_BUF_POSTED,	/* a read into the buffer is submitted */
+	IN_BUF_FILLED,	/* holds in_buf_size_bits bits, maybe 0 */
+};
 
 #define ESP_USB_INTERFACE       1
 
@@ -191,13 +203,22 @@ struct esp_usb_jtag {
 	uint32_t base_speed_khz;
 	uint16_t div_min;
 	uint16_t div_max;
-	uint8_t out_buf[OUT_BUF_SZ];
+	uint8_t out_buf[OUT_BUF_CT][OUT_BUF_SZ];
+	unsigned int cur_out_buf;				/* out_buf being filled */
 	unsigned int out_buf_pos_nibbles;			/* write position in out_buf */
+	struct libusb_transfer *out_xfer[OUT_BUF_CT];
+	bool out_busy[OUT_BUF_CT];
 
 	uint8_t in_buf[IN_BUF_CT][IN_BUF_SZ];
 	unsigned int in_buf_size_bits[IN_BUF_CT];	/* size in bits of the data stored in an in_buf */
+	enum esp_usb_jtag_in_buf_state in_buf_state[IN_BUF_CT];
 	unsigned int cur_in_buf_rd, cur_in_buf_wr;	/* read/write index */
 	unsigned int in_buf_pos_bits;	/* which bit in the in buf needs to be returned to bitq next */
+	struct libusb_transfer *in_xfer[IN_XFER_CT];
+	unsigned int in_xfer_posted;	/* number of submitted reads */
+
+	int xfer_event;		/* set by the transfer callbacks */
+	int xfer_retval;	/* first error of the transfers */
 
 	unsigned int read_ep;
 	unsigned int write_ep;
@@ -226,112 +247,163 @@ static int esp_usb_target_chip_id;
 static int esp_usb_jtag_init(void);
 static int esp_usb_jtag_quit(void);
 
-/* Try to receive from USB endpoint into the current priv->in_buf */
-static int esp_usb_jtag_recv_buf(void)
+static LIBUSB_CALL void esp_usb_jtag_out_cb(struct libusb_transfer *transfer)
 {
-	if (priv->in_buf_size_bits[priv->cur_in_buf_wr] != 0)
-		LOG_ERROR("esp_usb_jtag: IN buffer overflow! (%d, size %d)",
-			priv->cur_in_buf_wr,
-			priv->in_buf_size_bits[priv->cur_in_buf_wr]);
-
-	unsigned int recvd = 0, ct = (priv->pending_in_bits + 7) / 8;
-	if (ct > IN_BUF_SZ)
-		ct = IN_BUF_SZ;
-	if (ct == 0) {
-		/* Note that the adapters IN EP specifically does *not* usually generate 0-byte in
-		 * packets if there has been no data since the last flush.
-		 * As such, we don't need (and shouldn't) try to read it. */
-		return ERROR_OK;
+	unsigned int idx = (uintptr_t)transfer->user_data;
+
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED ||
+		transfer->actual_length != transfer->length) {
+		LOG_ERROR("esp_usb_jtag: usb sent only %d out of %d bytes (status %d).",
+			transfer->actual_length, transfer->length, transfer->status);
+		if (priv->xfer_retval == ERROR_OK)
+			priv->xfer_retval = ERROR_FAIL;
 	}
+	LOG_DEBUG_IO("esp_usb_jtag: sent %d bytes.", transfer->actual_length);
 
-	priv->in_buf_size_bits[priv->cur_in_buf_wr] = 0;
-	while (recvd < ct) {
-		unsigned int tr;
-		int ret = jtag_libusb_bulk_read(priv->usb_device,
-			priv->read_ep,
-			(char *)priv->in_buf[priv->cur_in_buf_wr] + recvd,
-			ct,
-			LIBUSB_TIMEOUT_MS,	/*ms*/
-			(int *)&tr);
-		if (ret != ERROR_OK || tr == 0) {
-			/* Sometimes the hardware returns 0 bytes instead of NAKking the transaction. Ignore this. */
-			return ERROR_FAIL;
-		}
+	priv->out_busy[idx] = false;
+	priv->xfer_event = 1;
+}
 
-		if (tr != ct) {
-			/* Huh, short read? */
-			LOG_DEBUG("esp_usb_jtag: usb received only %d out of %d bytes.", tr, ct);
-		}
-		/* Adjust the amount of bits we still expect to read from the USB device after this. */
-		unsigned int bits_in_buf = priv->pending_in_bits;	/* initially assume we read
-									* everything that was pending */
-		if (bits_in_buf > tr * 8)
-			bits_in_buf = tr * 8;	/* ...but correct that if that was not the case. */
-		priv->pending_in_bits -= bits_in_buf;
-		priv->in_buf_size_bits[priv->cur_in_buf_wr] += bits_in_buf;
-		recvd += tr;
+/* Reads complete in the order they were submitted, so the data always belongs to the oldest
+ * bits we still expect from the adapter. */
+static LIBUSB_CALL void esp_usb_jtag_in_cb(struct libusb_transfer *transfer)
+{
+	unsigned int idx = (uintptr_t)transfer->user_data;
+	unsigned int tr = transfer->actual_length;
+
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED && priv->pending_in_bits) {
+		LOG_ERROR("esp_usb_jtag: usb read failed (status %d).", transfer->status);
+		if (priv->xfer_retval == ERROR_OK)
+			priv->xfer_retval = ERROR_FAIL;
 	}
-	/* next in buffer for the next time. */
-	priv->cur_in_buf_wr++;
-	if (priv->cur_in_buf_wr == IN_BUF_CT)
-		priv->cur_in_buf_wr = 0;
-	LOG_DEBUG_IO("esp_usb_jtag: In ep: received %d bytes; %d bytes (%d bits) left.", recvd,
+
+	/* Sometimes the hardware returns 0 bytes instead of NAKking the transaction. Ignore this;
+	 * the buffer is skipped by esp_usb_jtag_in(). */
+	unsigned int bits_in_buf = priv->pending_in_bits;	/* initially assume we read
+								* everything that was pending */
+	if (bits_in_buf > tr * 8)
+		bits_in_buf = tr * 8;	/* ...but correct that if that was not the case. */
+	priv->pending_in_bits -= bits_in_buf;
+	priv->in_buf_size_bits[idx] = bits_in_buf;
+	priv->in_buf_state[idx] = IN_BUF_FILLED;
+	priv->in_xfer_posted--;
+	priv->xfer_event = 1;
+
+	LOG_DEBUG_IO("esp_usb_jtag: In ep: received %d bytes; %d bytes (%d bits) left.", tr,
 		(priv->pending_in_bits + 7) / 8, priv->pending_in_bits);
-	return ERROR_OK;
 }
 
-/* Sends priv->out_buf to the USB device. */
+/* Keep reads submitted for the bits we expect from the adapter, including those of commands not
+ * sent yet: a read simply stays pending until the adapter has the data. */
+static void esp_usb_jtag_post_reads(void)
+{
+	while (priv->in_xfer_posted < IN_XFER_CT && priv->xfer_retval == ERROR_OK &&
+		priv->pending_in_bits > priv->in_xfer_posted * IN_BUF_SZ * 8) {
+		unsigned int idx = priv->cur_in_buf_wr;
+		/* in_xfer[] are used round robin, like in_buf[] */
+		struct libusb_transfer *transfer = priv->in_xfer[idx % IN_XFER_CT];
+
+		if (priv->in_buf_state[idx] != IN_BUF_FREE)
+			return;
+
+		libusb_fill_bulk_transfer(transfer, priv->usb_device, priv->read_ep,
+			priv->in_buf[idx], IN_BUF_SZ, esp_usb_jtag_in_cb, (void *)(uintptr_t)idx,
+			LIBUSB_TIMEOUT_MS);
+		if (libusb_submit_transfer(transfer) != LIBUSB_SUCCESS) {
+			LOG_ERROR("esp_usb_jtag: usb read failed.");
+			priv->xfer_retval = ERROR_FAIL;
+			return;
+		}
+		priv->in_buf_state[idx] = IN_BUF_POSTED;
+		priv->in_xfer_posted++;
+		priv->cur_in_buf_wr++;
+		if (priv->cur_in_buf_wr == IN_BUF_CT)
+			priv->cur_in_buf_wr = 0;
+	}
+}
+
+static void esp_usb_jtag_handle_events(void)
+{
+	priv->xfer_event = 0;
+	int ret = jtag_libusb_handle_events_completed(&priv->xfer_event);
+	if (ret < 0 && ret != LIBUSB_ERROR_INTERRUPTED) {
+		LOG_ERROR("esp_usb_jtag: libusb_handle_events() failed with %s", libusb_error_name(ret));
+		if (priv->xfer_retval == ERROR_OK)
+			priv->xfer_retval = ERROR_FAIL;
+	}
+	esp_usb_jtag_post_reads();
+}
+
+/* Wait for a sent out buffer to be free again. */
+static int esp_usb_jtag_wait_out_buf(unsigned int idx)
+{
+	while (priv->out_busy[idx] && priv->xfer_retval == ERROR_OK)
+		esp_usb_jtag_handle_events();
+	return priv->xfer_retval;
+}
+
+/* Cancel and collect the transfers still in flight, after an error. */
+static void esp_usb_jtag_purge(void)
+{
+	for (unsigned int i = 0; i < OUT_BUF_CT; i++)
+		if (priv->out_busy[i])
+			libusb_cancel_transfer(priv->out_xfer[i]);
+	for (unsigned int i = 0; i < IN_XFER_CT; i++)
+		libusb_cancel_transfer(priv->in_xfer[i]);
+
+	bool busy = true;
+	while (busy) {
+		busy = priv->in_xfer_posted > 0;
+		for (unsigned int i = 0; i < OUT_BUF_CT; i++)
+			busy = busy || priv->out_busy[i];
+		if (busy)
+			esp_usb_jtag_handle_events();
+	}
+}
+
+/* Sends the current priv->out_buf to the USB device, without waiting for it. */
 static int esp_usb_jtag_send_buf(void)
 {
+	unsigned int idx = priv->cur_out_buf;
 	unsigned int ct = priv->out_buf_pos_nibbles / 2;
-	unsigned int written = 0;
-
-	while (written < ct) {
-		int tr = 0, ret = jtag_libusb_bulk_write(priv->usb_device,
-			priv->write_ep,
-			(char *)priv->out_buf + written,
-			ct - written,
-			LIBUSB_TIMEOUT_MS,	/*ms*/
-			&tr);
-		LOG_DEBUG_IO("esp_usb_jtag: sent %d bytes.", tr);
-		if (written + tr != ct) {
-			LOG_DEBUG("esp_usb_jtag: usb sent only %d out of %d bytes.",
-				written + tr,
-				ct);
+
+	if (priv->xfer_retval != ERROR_OK)
+		return priv->xfer_retval;
+
+	if (ct > 0) {
+		libusb_fill_bulk_transfer(priv->out_xfer[idx], priv->usb_device, priv->write_ep,
+			priv->out_buf[idx], ct, esp_usb_jtag_out_cb, (void *)(uintptr_t)idx,
+			LIBUSB_TIMEOUT_MS);
+		if (libusb_submit_transfer(priv->out_xfer[idx]) != LIBUSB_SUCCESS) {
+			LOG_ERROR("esp_usb_jtag: usb write failed.");
+			priv->xfer_retval = ERROR_FAIL;
+			return priv->xfer_retval;
 		}
-		if (ret != ERROR_OK)
-			return ret;
-		written += tr;
+		priv->out_busy[idx] = true;
 	}
-	priv->out_buf_pos_nibbles = 0;
-
-	/* If there's more than a bufferful of data queuing up in the jtag adapters IN endpoint, empty
-	 * all but one buffer. */
-	while (priv->pending_in_bits > (IN_BUF_SZ + priv->hw_in_fifo_len - 1) * 8)
-		esp_usb_jtag_recv_buf();
+	esp_usb_jtag_post_reads();
 
-	return ERROR_OK;
+	/* Fill the other buffer meanwhile */
+	priv->out_buf_pos_nibbles = 0;
+	priv->cur_out_buf = (idx + 1) % OUT_BUF_CT;
+	return esp_usb_jtag_wait_out_buf(priv->cur_out_buf);
 }
 
 /* Simply adds a command to the buffer. Is called by the RLE encoding mechanism.
  *Also sends the intermediate buffer if there's enough to go into one USB packet. */
 static int esp_usb_jtag_command_add_raw(unsigned int cmd)
 {
-	int ret = ERROR_OK;
+	uint8_t *out_buf = priv->out_buf[priv->cur_out_buf];
 
 	if ((priv->out_buf_pos_nibbles & 1) == 0)
-		priv->out_buf[priv->out_buf_pos_nibbles / 2] = (cmd << 4);
+		out_buf[priv->out_buf_pos_nibbles / 2] = (cmd << 4);
 	else
-		priv->out_buf[priv->out_buf_pos_nibbles / 2] |= cmd;
+		out_buf[priv->out_buf_pos_nibbles / 2] |= cmd;
 	priv->out_buf_pos_nibbles++;
 
 	if (priv->out_buf_pos_nibbles == OUT_BUF_SZ * 2)
-		ret = esp_usb_jtag_send_buf();
-	if (ret == ERROR_OK && priv->out_buf_pos_nibbles % (OUT_EP_SZ * 2) == 0) {
-		if (priv->pending_in_bits > (IN_BUF_SZ + priv->hw_in_fifo_len - 1) * 8)
-			ret = esp_usb_jtag_send_buf();
-	}
-	return ret;
+		return esp_usb_jtag_send_buf();
+	return ERROR_OK;
 }
 
 /* Writes a command stream equivalent to writing `cmd` `ct` times. */
@@ -409,15 +481,30 @@ static int esp_usb_jtag_flush(void)
 	}
 	LOG_DEBUG_IO("esp_usb_jtag: Flush!");
 	/* Send off the buffer. */
-	ret = esp_usb_jtag_send_buf();
-	if (ret != ERROR_OK)
-		return ret;
-
-	/* Immediately fetch the response bits. */
-	while (priv->pending_in_bits > 0)
-		esp_usb_jtag_recv_buf();
+	esp_usb_jtag_send_buf();
+
+	/* Wait for all writes and the response bits. */
+	for (unsigned int i = 0; i < OUT_BUF_CT; i++)
+		esp_usb_jtag_wait_out_buf(i);
+	while (priv->in_xfer_posted > 0 && priv->xfer_retval == ERROR_OK)
+		esp_usb_jtag_handle_events();
+	if (priv->pending_in_bits > 0 && priv->xfer_retval == ERROR_OK) {
+		LOG_ERROR("esp_usb_jtag: IN buffer overflow! (%d bits left)", priv->pending_in_bits);
+		priv->xfer_retval = ERROR_FAIL;
+	}
 
-	return ERROR_OK;
+	ret = priv->xfer_retval;
+	if (ret != ERROR_OK) {
+		esp_usb_jtag_purge();
+		priv->pending_in_bits = 0;
+		priv->cur_in_buf_rd = 0;
+		priv->cur_in_buf_wr = 0;
+		priv->in_buf_pos_bits = 0;
+		memset(priv->in_buf_state, 0, sizeof(priv->in_buf_state));
+		memset(priv->in_buf_size_bits, 0, sizeof(priv->in_buf_size_bits));
+		priv->xfer_retval = ERROR_OK;
+	}
+	return ret;
 }
 
 /* Called by bitq interface to sleep for a determined amount of time */
@@ -441,19 +528,22 @@ static int esp_usb_jtag_reset(int trst, int srst)
 /* Called by bitq to see if the IN data already is returned to the host. */
 static int esp_usb_jtag_in_rdy(void)
 {
-	/* We read all bits in the flush() routine, so if we're here, we have bits or are at EOF. */
-	return 1;
+	/* Skip the reads that returned no data */
+	while (priv->in_buf_state[priv->cur_in_buf_rd] == IN_BUF_FILLED &&
+		priv->in_buf_size_bits[priv->cur_in_buf_rd] == 0) {
+		priv->in_buf_state[priv->cur_in_buf_rd] = IN_BUF_FREE;
+		priv->cur_in_buf_rd++;
+		if (priv->cur_in_buf_rd == IN_BUF_CT)
+			priv->cur_in_buf_rd = 0;
+	}
+	return priv->in_buf_state[priv->cur_in_buf_rd] == IN_BUF_FILLED;
 }
 
 /* Read one bit from the IN data */
 static int esp_usb_jtag_in(void)
 {
-	if (!esp_usb_jtag_in_rdy()) {
-		LOG_ERROR("esp_usb_jtag: Eeek! bitq asked us for in data while not ready!");
-		return -1;
-	}
-	if (priv->cur_in_buf_rd == priv->cur_in_buf_wr &&
-		priv->in_buf_size_bits[priv->cur_in_buf_rd] == 0)
+	/* Not received yet, or EOF */
+	if (!esp_usb_jtag_in_rdy())
 		return -1;
 
 	/* Extract the bit */
@@ -464,7 +554,8 @@ static int esp_usb_jtag_in(void)
 	if (priv->in_buf_pos_bits == priv->in_buf_size_bits[priv->cur_in_buf_rd]) {
 		/* No more bits in this buffer; mark as re-usable and move to next buffer. */
 		priv->in_buf_pos_bits = 0;
-		priv->in_buf_size_bits[priv->cur_in_buf_rd] = 0;/*indicate it is free again */
+		priv->in_buf_size_bits[priv->cur_in_buf_rd] = 0;
+		priv->in_buf_state[priv->cur_in_buf_rd] = IN_BUF_FREE;/*indicate it is free again */
 		priv->cur_in_buf_rd++;
 		if (priv->cur_in_buf_rd == IN_BUF_CT)
 			priv->cur_in_buf_rd = 0;
@@ -472,6 +563,18 @@ static int esp_usb_jtag_in(void)
 	return r;
 }
 
+static void esp_usb_jtag_free_transfers(void)
+{
+	for (unsigned int i = 0; i < OUT_BUF_CT; i++) {
+		libusb_free_transfer(priv->out_xfer[i]);
+		priv->out_xfer[i] = NULL;
+	}
+	for (unsigned int i = 0; i < IN_XFER_CT; i++) {
+		libusb_free_transfer(priv->in_xfer[i]);
+		priv->in_xfer[i] = NULL;
+	}
+}
+
 static int esp_usb_jtag_init(void)
 {
 	memset(priv, 0, sizeof(struct esp_usb_jtag));
@@ -573,6 +676,17 @@ static int esp_usb_jtag_init(void)
 	/* TODO: grab from (future) descriptor if we ever have a device with larger IN buffers */
 	priv->hw_in_fifo_len = 4;
 
+	for (unsigned int i = 0; i < OUT_BUF_CT; i++) {
+		priv->out_xfer[i] = libusb_alloc_transfer(0);
+		if (!priv->out_xfer[i])
+			goto out_free;
+	}
+	for (unsigned int i = 0; i < IN_XFER_CT; i++) {
+		priv->in_xfer[i] = libusb_alloc_transfer(0);
+		if (!priv->in_xfer[i])
+			goto out_free;
+	}
+
 	/* inform bridge board about the connected target chip for the specific operations
 	 * it is also safe to send this info to chips that have builtin usb jtag */
 	jtag_libusb_control_transfer(priv->usb_device,
@@ -587,6 +701,9 @@ static int esp_usb_jtag_init(void)
 
 	return ERROR_OK;
 
+out_free:
+	LOG_ERROR("esp_usb_jtag: could not allocate usb transfers!");
+	esp_usb_jtag_free_transfers();
 out:
 	if (priv->usb_device)
 		jtag_libusb_close(priv->usb_device);
@@ -599,6 +716,7 @@ static int esp_usb_jtag_quit(void)
 {
 	if (!priv->usb_device)
 		return ERROR_OK;
+	esp_usb_jtag_free_transfers();
 	jtag_libusb_close(priv->usb_device);
 	bitq_cleanup();
 	bitq_interface = NULL;
@@ -56,7 +56,21 @@
 #define SIO_WRITE_EEPROM	0x91
 #define SIO_ERASE_EEPROM	0x92
 
-#define FT232R_BUF_SIZE_EXTRA	4096
+/* The output buffer holds a whole JTAG queue, two samples per TCK. It
+ * starts at a multiple of the RX FIFO size and doubles when needed. */
+#define FT232R_BUF_SIZE		(64 * 1024)
+
+/* FIFO TX buffer has 128 bytes.
+ * FIFO RX buffer has 256 bytes.
+ * First two bytes of received packet contain contain modem
+ * and line status and are ignored.
+ * Unfortunately, transfer sizes bigger than 64 bytes
+ * frequently cause hang ups. */
+#define FT232R_PACKET_SIZE	64
+/* bytes written but not read back yet */
+#define FT232R_MAX_PENDING	128
+/* write transfers in flight, two fill FT232R_MAX_PENDING */
+#define FT232R_WRITE_TRANSFERS	2
 
 static uint16_t ft232r_vid = 0x0403; /* FTDI */
 static uint16_t ft232r_pid = 0x6001; /* FT232R */
@@ -65,6 +79,35 @@ static struct libusb_device_handle *adapter;
 static uint8_t *ft232r_output;
 static size_t ft232r_output_len;
 
+/* asynchronous transfers of ft232r_send_recv() */
+struct ft232r_transfer {
+	struct libusb_transfer *transfer;
+	bool busy;
+};
+
+static struct ft232r_transfer ft232r_write_xfer[FT232R_WRITE_TRANSFERS];
+static struct ft232r_transfer ft232r_read_xfer;
+static uint8_t ft232r_reply[FT232R_PACKET_SIZE];
+static size_t ft232r_total_read;
+static int ft232r_xfer_retval;
+static int ft232r_xfer_event;
+
+/* sample with TCK low for each (tms << 1 | tdi), see ft232r_init_samples() */
+static uint8_t ft232r_sample[4];
+static uint8_t ft232r_tck_mask;
+
+/* scans waiting for the readback of the output buffer */
+struct ft232r_pending_scan {
+	struct scan_command *cmd;
+	uint8_t *buffer;
+	size_t bit0_index;
+	int scan_size;
+	enum scan_type type;
+};
+
+static struct ft232r_pending_scan *ft232r_pending;
+static unsigned int ft232r_num_pending, ft232r_pending_size;
+
 /**
  * FT232R GPIO bit number to RS232 name
  */
@@ -86,90 +129,181 @@ static int tdo_gpio = 2;
 static int tms_gpio = 3;
 static int ntrst_gpio = 4;
 static int nsysrst_gpio = 6;
-static size_t ft232r_buf_size = FT232R_BUF_SIZE_EXTRA;
+static size_t ft232r_buf_size = FT232R_BUF_SIZE;
 /** 0xFFFF disables restore by default, after exit serial port will not work.
  *  0x15 sets TXD RTS DTR as outputs, after exit serial port will continue to work.
  */
 static uint16_t ft232r_restore_bitmode = 0xFFFF;
 
+static LIBUSB_CALL void ft232r_write_cb(struct libusb_transfer *transfer)
+{
+	struct ft232r_transfer *xfer = transfer->user_data;
+
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED ||
+			transfer->actual_length != transfer->length) {
+		if (ft232r_xfer_retval == ERROR_OK)
+			LOG_ERROR("usb bulk write failed");
+		ft232r_xfer_retval = ERROR_JTAG_DEVICE_ERROR;
+	}
+
+	xfer->busy = false;
+	ft232r_xfer_event = 1;
+}
+
+static LIBUSB_CALL void ft232r_read_cb(struct libusb_transfer *transfer)
+{
+	int n = transfer->actual_length;
+
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+		if (ft232r_xfer_retval == ERROR_OK)
+			LOG_ERROR("usb bulk read failed");
+		ft232r_xfer_retval = ERROR_JTAG_DEVICE_ERROR;
+	} else if (n > 2) {
+		/* Copy data, ignoring first 2 bytes. */
+		if (ft232r_total_read + n - 2 > ft232r_output_len) {
+			if (ft232r_xfer_retval == ERROR_OK)
+				LOG_ERROR("read more bytes than wrote");
+			ft232r_xfer_retval = ERROR_JTAG_DEVICE_ERROR;
+		} else {
+			memcpy(ft232r_output + ft232r_total_read, ft232r_reply + 2, n - 2);
+			ft232r_total_read += n - 2;
+		}
+	}
+
+	ft232r_read_xfer.busy = false;
+	ft232r_xfer_event = 1;
+}
+
+static bool ft232r_transfers_busy(void)
+{
+	if (ft232r_read_xfer.busy)
+		return true;
+	for (unsigned int i = 0; i < FT232R_WRITE_TRANSFERS; i++)
+		if (ft232r_write_xfer[i].busy)
+			return true;
+	return false;
+}
+
+static void ft232r_submit(struct ft232r_transfer *xfer)
+{
+	if (libusb_submit_transfer(xfer->transfer) != LIBUSB_SUCCESS) {
+		LOG_ERROR("usb bulk transfer failed");
+		ft232r_xfer_retval = ERROR_JTAG_DEVICE_ERROR;
+		return;
+	}
+	xfer->busy = true;
+}
+
 /**
  * Perform sync bitbang output/input transaction.
  * Before call, an array ft232r_output[] should be filled with data to send.
  * Counter ft232r_output_len contains the number of bytes to send.
  * On return, received data is put back to array ft232r_output[].
+ *
+ * Up to FT232R_WRITE_TRANSFERS writes and one read are kept in flight,
+ * so that the chip does not wait for the host between packets.
  */
 static int ft232r_send_recv(void)
 {
-	/* FIFO TX buffer has 128 bytes.
-	 * FIFO RX buffer has 256 bytes.
-	 * First two bytes of received packet contain contain modem
-	 * and line status and are ignored.
-	 * Unfortunately, transfer sizes bigger than 64 bytes
-	 * frequently cause hang ups. */
 	assert(ft232r_output_len > 0);
 
 	size_t total_written = 0;
-	size_t total_read = 0;
-	int rxfifo_free = 128;
+	ft232r_total_read = 0;
+	ft232r_xfer_retval = ERROR_OK;
 
-	while (total_read < ft232r_output_len) {
+	while (ft232r_total_read < ft232r_output_len && ft232r_xfer_retval == ERROR_OK) {
 		/* Write */
-		int bytes_to_write = ft232r_output_len - total_written;
-		if (bytes_to_write > 64)
-			bytes_to_write = 64;
-		if (bytes_to_write > rxfifo_free)
-			bytes_to_write = rxfifo_free;
-
-		if (bytes_to_write) {
-			int n;
-
-			if (jtag_libusb_bulk_write(adapter, IN_EP,
-						   (char *) ft232r_output + total_written,
-						   bytes_to_write, 1000, &n) != ERROR_OK) {
-				LOG_ERROR("usb bulk write failed");
-				return ERROR_JTAG_DEVICE_ERROR;
-			}
-
-			total_written += n;
-			rxfifo_free -= n;
+		for (unsigned int i = 0; i < FT232R_WRITE_TRANSFERS; i++) {
+			struct ft232r_transfer *xfer = &ft232r_write_xfer[i];
+			size_t pending = total_written - ft232r_total_read;
+			size_t bytes_to_write = MIN(ft232r_output_len - total_written,
+					MIN((size_t)FT232R_PACKET_SIZE, FT232R_MAX_PENDING - pending));
+			if (xfer->busy || !bytes_to_write)
+				continue;
+
+			libusb_fill_bulk_transfer(xfer->transfer, adapter, IN_EP,
+					ft232r_output + total_written, bytes_to_write,
+					ft232r_write_cb, xfer, 1000);
+			ft232r_submit(xfer);
+			if (ft232r_xfer_retval != ERROR_OK)
+				break;
+			total_written += bytes_to_write;
 		}
 
 		/* Read */
-		uint8_t reply[64];
-		int n;
+		if (!ft232r_read_xfer.busy && ft232r_xfer_retval == ERROR_OK) {
+			libusb_fill_bulk_transfer(ft232r_read_xfer.transfer, adapter, OUT_EP,
+					ft232r_reply, sizeof(ft232r_reply),
+					ft232r_read_cb, &ft232r_read_xfer, 1000);
+			ft232r_submit(&ft232r_read_xfer);
+		}
 
-		if (jtag_libusb_bulk_read(adapter, OUT_EP, (char *) reply,
-					  sizeof(reply), 1000, &n) != ERROR_OK) {
-			LOG_ERROR("usb bulk read failed");
-			return ERROR_JTAG_DEVICE_ERROR;
+		if (ft232r_xfer_retval != ERROR_OK)
+			break;
+
+		ft232r_xfer_event = 0;
+		int retval = jtag_libusb_handle_events_completed(&ft232r_xfer_event);
+		if (retval < 0 && retval != LIBUSB_ERROR_INTERRUPTED) {
+			LOG_ERROR("libusb_handle_events() failed with %s", libusb_error_name(retval));
+			ft232r_xfer_retval = ERROR_JTAG_DEVICE_ERROR;
 		}
-		if (n > 2) {
-			/* Copy data, ignoring first 2 bytes. */
-			memcpy(ft232r_output + total_read, reply + 2, n - 2);
-			int bytes_read = n - 2;
-			total_read += bytes_read;
-			rxfifo_free += bytes_read;
-			if (total_read > total_written) {
-				LOG_ERROR("read more bytes than wrote");
-				return ERROR_JTAG_DEVICE_ERROR;
-			}
+	}
+
+	/* collect the transfers still in flight, after an error */
+	if (ft232r_transfers_busy()) {
+		libusb_cancel_transfer(ft232r_read_xfer.transfer);
+		for (unsigned int i = 0; i < FT232R_WRITE_TRANSFERS; i++)
+			libusb_cancel_transfer(ft232r_write_xfer[i].transfer);
+		while (ft232r_transfers_busy()) {
+			ft232r_xfer_event = 0;
+			jtag_libusb_handle_events_completed(&ft232r_xfer_event);
 		}
 	}
+
 	ft232r_output_len = 0;
-	return ERROR_OK;
+	return ft232r_xfer_retval;
 }
 
-static void ft232r_increase_buf_size(size_t new_buf_size)
+/**
+ * Make room for @a bytes more samples in the send buffer.
+ */
+static bool ft232r_reserve(size_t bytes)
 {
-	uint8_t *new_buf_ptr;
-	if (new_buf_size >= ft232r_buf_size) {
-		new_buf_size += FT232R_BUF_SIZE_EXTRA;
-		new_buf_ptr = realloc(ft232r_output, new_buf_size);
-		if (new_buf_ptr) {
-			ft232r_output = new_buf_ptr;
-			ft232r_buf_size = new_buf_size;
-		}
+	size_t needed = ft232r_output_len + bytes;
+
+	if (needed <= ft232r_buf_size)
+		return true;
+
+	size_t new_buf_size = ft232r_buf_size;
+	while (new_buf_size < needed)
+		new_buf_size *= 2;
+
+	uint8_t *new_buf_ptr = realloc(ft232r_output, new_buf_size);
+	if (!new_buf_ptr) {
+		/* FIXME: should we just execute queue here? */
+		LOG_ERROR("ft232r_write: buffer overflow");
+		return false;
+	}
+
+	ft232r_output = new_buf_ptr;
+	ft232r_buf_size = new_buf_size;
+	return true;
+}
+
+/**
+ * Compute the samples for each TMS/TDI combination, once the pins are known.
+ */
+static void ft232r_init_samples(void)
+{
+	for (unsigned int i = 0; i < ARRAY_SIZE(ft232r_sample); i++) {
+		uint8_t out_value = (1<<ntrst_gpio) | (1<<nsysrst_gpio);
+		if (i & 2)
+			out_value |= (1<<tms_gpio);
+		if (i & 1)
+			out_value |= (1<<tdi_gpio);
+		ft232r_sample[i] = out_value;
 	}
+	ft232r_tck_mask = 1<<tck_gpio;
 }
 
 /**
@@ -177,29 +311,67 @@ static void ft232r_increase_buf_size(size_t new_buf_size)
  */
 static void ft232r_write(int tck, int tms, int tdi)
 {
-	unsigned out_value = (1<<ntrst_gpio) | (1<<nsysrst_gpio);
+	uint8_t out_value = ft232r_sample[(tms ? 2 : 0) | (tdi ? 1 : 0)];
 	if (tck)
-		out_value |= (1<<tck_gpio);
-	if (tms)
-		out_value |= (1<<tms_gpio);
-	if (tdi)
-		out_value |= (1<<tdi_gpio);
-
-	ft232r_increase_buf_size(ft232r_output_len);
+		out_value |= ft232r_tck_mask;
 
-	if (ft232r_output_len >= ft232r_buf_size) {
-		/* FIXME: should we just execute queue here? */
-		LOG_ERROR("ft232r_write: buffer overflow");
+	if (!ft232r_reserve(1))
 		return;
-	}
 	ft232r_output[ft232r_output_len++] = out_value;
 }
 
+/**
+ * Add one TCK cycle, low then high, with the given TMS and TDI.
+ * The caller has reserved the room.
+ */
+static inline void ft232r_write_cycle(int tms, int tdi)
+{
+	uint8_t out_value = ft232r_sample[(tms << 1) | tdi];
+
+	ft232r_output[ft232r_output_len++] = out_value;
+	ft232r_output[ft232r_output_len++] = out_value | ft232r_tck_mask;
+}
+
+/**
+ * Send the buffer and complete the scans waiting for its readback.
+ */
+static int ft232r_flush(void)
+{
+	int retval = ERROR_OK;
+
+	if (ft232r_output_len > 0)
+		retval = ft232r_send_recv();
+
+	for (unsigned int i = 0; i < ft232r_num_pending; i++) {
+		struct ft232r_pending_scan *scan = &ft232r_pending[i];
+
+		if (retval == ERROR_OK && scan->type != SCAN_OUT) {
+			for (int bit_cnt = 0; bit_cnt < scan->scan_size; bit_cnt++) {
+				int bytec = bit_cnt/8;
+				int bcval = 1 << (bit_cnt % 8);
+				int val = ft232r_output[scan->bit0_index + bit_cnt*2 + 1];
+
+				if (val & (1<<tdo_gpio))
+					scan->buffer[bytec] |= bcval;
+				else
+					scan->buffer[bytec] &= ~bcval;
+			}
+		}
+
+		if (retval == ERROR_OK && jtag_read_buffer(scan->buffer, scan->cmd) != ERROR_OK)
+			retval = ERROR_JTAG_QUEUE_FAILED;
+		free(scan->buffer);
+	}
+	ft232r_num_pending = 0;
+
+	return retval;
+}
+
 /**
  * Control /TRST and /SYSRST pins.
  * Perform immediate bitbang transaction.
  */
-static void ft232r_reset(int trst, int srst)
+static int ft232r_reset(int trst, int srst)
 {
 	unsigned out_value = (1<<ntrst_gpio) | (1<<nsysrst_gpio);
 	LOG_DEBUG("ft232r_reset(%d,%d)", trst, srst);
@@ -214,16 +386,11 @@ static void ft232r_reset(int trst, int srst)
 	else if (srst == 0)
 		out_value |= (1<<nsysrst_gpio);		/* switch /SYSRST high */
 
-	ft232r_increase_buf_size(ft232r_output_len);
-
-	if (ft232r_output_len >= ft232r_buf_size) {
-		/* FIXME: should we just execute queue here? */
-		LOG_ERROR("ft232r_write: buffer overflow");
-		return;
-	}
+	if (!ft232r_reserve(1))
+		return ERROR_FAIL;
 
 	ft232r_output[ft232r_output_len++] = out_value;
-	ft232r_send_recv();
+	return ft232r_flush();
 }
 
 static int ft232r_speed(int divisor)
@@ -305,6 +472,19 @@ static int ft232r_init(void)
 		return ERROR_JTAG_INIT_FAILED;
 	}
 
+	ft232r_read_xfer.transfer = libusb_alloc_transfer(0);
+	bool alloc_ok = ft232r_read_xfer.transfer;
+	for (unsigned int i = 0; i < FT232R_WRITE_TRANSFERS; i++) {
+		ft232r_write_xfer[i].transfer = libusb_alloc_transfer(0);
+		alloc_ok = alloc_ok && ft232r_write_xfer[i].transfer;
+	}
+	if (!alloc_ok) {
+		LOG_ERROR("Unable to allocate USB transfers");
+		return ERROR_JTAG_INIT_FAILED;
+	}
+
+	ft232r_init_samples();
+
 	return ERROR_OK;
 }
 
@@ -327,7 +507,18 @@ static int ft232r_quit(void)
 
 	free(ft232r_output); /* free used memory */
 	ft232r_output = NULL; /* reset pointer to memory */
-	ft232r_buf_size = FT232R_BUF_SIZE_EXTRA; /* reset next initial buffer size */
+	ft232r_buf_size = FT232R_BUF_SIZE; /* reset next initial buffer size */
+
+	libusb_free_transfer(ft232r_read_xfer.transfer);
+	ft232r_read_xfer.transfer = NULL;
+	for (unsigned int i = 0; i < FT232R_WRITE_TRANSFERS; i++) {
+		libusb_free_transfer(ft232r_write_xfer[i].transfer);
+		ft232r_write_xfer[i].transfer = NULL;
+	}
+
+	free(ft232r_pending);
+	ft232r_pending = NULL;
+	ft232r_pending_size = 0;
 
 	return ERROR_OK;
 }
@@ -745,10 +936,28 @@ static void syncbb_stableclocks(unsigned int num_cycles)
 	}
 }
 
-static void syncbb_scan(bool ir_scan, enum scan_type type, uint8_t *buffer, int scan_size)
+/**
+ * Queue a scan. Its data is read back by ft232r_flush(), which also
+ * frees @a buffer.
+ */
+static int syncbb_scan(struct scan_command *cmd, enum scan_type type, uint8_t *buffer, int scan_size)
 {
 	tap_state_t saved_end_state = tap_get_end_state();
-	int bit_cnt, bit0_index;
+	bool ir_scan = cmd->ir_scan;
+	size_t bit0_index;
+	int bit_cnt;
+
+	if (ft232r_num_pending == ft232r_pending_size) {
+		unsigned int size = ft232r_pending_size ? 2 * ft232r_pending_size : 16;
+		struct ft232r_pending_scan *pending = realloc(ft232r_pending, size * sizeof(*pending));
+		if (!pending) {
+			LOG_ERROR("Out of memory");
+			free(buffer);
+			return ERROR_FAIL;
+		}
+		ft232r_pending = pending;
+		ft232r_pending_size = size;
+	}
 
 	if (!((!ir_scan && (tap_get_state() == TAP_DRSHIFT)) || (ir_scan && (tap_get_state() == TAP_IRSHIFT)))) {
 		if (ir_scan)
@@ -760,6 +969,11 @@ static void syncbb_scan(bool ir_scan, enum scan_type type, uint8_t *buffer, int
 		syncbb_end_state(saved_end_state);
 	}
 
+	if (!ft232r_reserve(2 * (size_t)scan_size)) {
+		free(buffer);
+		return ERROR_FAIL;
+	}
+
 	bit0_index = ft232r_output_len;
 	for (bit_cnt = 0; bit_cnt < scan_size; bit_cnt++) {
 		int tms = (bit_cnt == scan_size-1) ? 1 : 0;
@@ -775,8 +989,7 @@ static void syncbb_scan(bool ir_scan, enum scan_type type, uint8_t *buffer, int
 		if ((type != SCAN_IN) && (buffer[bytec] & bcval))
 			tdi = 1;
 
-		ft232r_write(0, tms, tdi);
-		ft232r_write(1, tms, tdi);
+		ft232r_write_cycle(tms, tdi);
 	}
 
 	if (tap_get_state() != tap_get_end_state()) {
@@ -786,19 +999,16 @@ static void syncbb_scan(bool ir_scan, enum scan_type type, uint8_t *buffer, int
 		 */
 		syncbb_state_move(1);
 	}
-	ft232r_send_recv();
 
-	if (type != SCAN_OUT)
-		for (bit_cnt = 0; bit_cnt < scan_size; bit_cnt++) {
-			int bytec = bit_cnt/8;
-			int bcval = 1 << (bit_cnt % 8);
-			int val = ft232r_output[bit0_index + bit_cnt*2 + 1];
+	ft232r_pending[ft232r_num_pending++] = (struct ft232r_pending_scan) {
+		.cmd = cmd,
+		.buffer = buffer,
+		.bit0_index = bit0_index,
+		.scan_size = scan_size,
+		.type = type,
+	};
 
-			if (val & (1<<tdo_gpio))
-				buffer[bytec] |= bcval;
-			else
-				buffer[bytec] &= ~bcval;
-		}
+	return ERROR_OK;
 }
 
 static int syncbb_execute_queue(struct jtag_command *cmd_queue)
@@ -826,7 +1036,8 @@ static int syncbb_execute_queue(struct jtag_command *cmd_queue)
 					(jtag_get_reset_config() & RESET_SRST_PULLS_TRST))) {
 					tap_set_state(TAP_RESET);
 				}
-				ft232r_reset(cmd->cmd.reset->trst, cmd->cmd.reset->srst);
+				if (ft232r_reset(cmd->cmd.reset->trst, cmd->cmd.reset->srst) != ERROR_OK)
+					retval = ERROR_JTAG_QUEUE_FAILED;
 				break;
 
 			case JTAG_RUNTEST:
@@ -865,15 +1076,15 @@ static int syncbb_execute_queue(struct jtag_command *cmd_queue)
 				syncbb_end_state(cmd->cmd.scan->end_state);
 				scan_size = jtag_build_buffer(cmd->cmd.scan, &buffer);
 				type = jtag_scan_type(cmd->cmd.scan);
-				syncbb_scan(cmd->cmd.scan->ir_scan, type, buffer, scan_size);
-				if (jtag_read_buffer(buffer, cmd->cmd.scan) != ERROR_OK)
+				if (syncbb_scan(cmd->cmd.scan, type, buffer, scan_size) != ERROR_OK)
 					retval = ERROR_JTAG_QUEUE_FAILED;
-				free(buffer);
 				break;
 
 			case JTAG_SLEEP:
 				LOG_DEBUG_IO("sleep %" PRIu32, cmd->cmd.sleep->us);
 
+				if (ft232r_flush() != ERROR_OK)
+					retval = ERROR_JTAG_QUEUE_FAILED;
 				jtag_sleep(cmd->cmd.sleep->us);
 				break;
 
@@ -884,10 +1095,12 @@ static int syncbb_execute_queue(struct jtag_command *cmd_queue)
 				LOG_ERROR("BUG: unknown JTAG command type encountered");
 				exit(-1);
 		}
-		if (ft232r_output_len > 0)
-			ft232r_send_recv();
 		cmd = cmd->next;
 	}
+
+	/* the whole queue is sent at once */
+	if (ft232r_flush() != ERROR_OK)
+		retval = ERROR_JTAG_QUEUE_FAILED;
 /*	ft232r_blink(0);*/
 
 	return retval;
@@ -84,6 +84,7 @@ static uint8_t ftdi_channel;
 static uint8_t ftdi_jtag_mode = JTAG_MODE;
 
 static bool swd_mode;
+static bool ftdi_posted_flush;
 
 #define MAX_USB_IDS 8
 /* vid = pid = 0 marks the end of the list */
@@ -109,7 +110,9 @@ static struct signal *signals;
 static struct swd_cmd_queue_entry {
 	uint8_t cmd;
 	uint32_t *dst;
-	uint8_t trn_ack_data_parity_trn[DIV_ROUND_UP(4 + 3 + 32 + 1 + 4, 8)];
+	uint32_t data;
+	/* The bytes read by the transaction, see ftdi_swd_response() */
+	uint8_t trn_ack_data_parity_trn[DIV_ROUND_UP(1 + 3 + 32 + 1 + 1, 8)];
 } *swd_cmd_queue;
 static size_t swd_cmd_queue_length;
 static size_t swd_cmd_queue_alloced;
@@ -123,6 +126,22 @@ static uint16_t jtag_direction_init;
 
 static int ftdi_swd_switch_seq(enum swd_special_seq seq);
 
+/* The MPSSE commands of the SWD transactions, built for the GPIO state they
+ * start in, so that queuing a transaction only patches and copies them */
+static struct ftdi_swd_template {
+	bool built;
+	uint16_t output;
+	uint16_t direction;
+	/* GPIO state once the transaction is done */
+	uint16_t end_output;
+	uint16_t end_direction;
+	uint8_t read[4 + 6 + 3 + 2 + 6];
+	unsigned int read_len;
+	uint8_t write[4 + 6 + 2 + 6 + 7 + 3];
+	unsigned int write_len;
+	unsigned int write_data;
+} swd_template;
+
 static struct signal *find_signal_by_name(const char *name)
 {
 	for (struct signal *sig = signals; sig; sig = sig->next) {
@@ -150,7 +169,8 @@ static struct signal *create_signal(const char *name)
 	return *psig;
 }
 
-static int ftdi_set_signal(const struct signal *s, char value)
+/* Update output and direction for the signal level, without queuing any command */
+static int ftdi_update_signal(const struct signal *s, char value)
 {
 	bool data;
 	bool oe;
@@ -186,15 +206,44 @@ static int ftdi_set_signal(const struct signal *s, char value)
 		return ERROR_FAIL;
 	}
 
-	uint16_t old_output = output;
-	uint16_t old_direction = direction;
-
 	output = data ? output | s->data_mask : output & ~s->data_mask;
 	if (s->oe_mask == s->data_mask)
 		direction = oe ? direction | s->oe_mask : direction & ~s->oe_mask;
 	else
 		output = oe ? output | s->oe_mask : output & ~s->oe_mask;
 
+	return ERROR_OK;
+}
+
+/* Encode the MPSSE commands setting the GPIO bytes changed since old_output
+ * and old_direction, return their length */
+static unsigned int ftdi_gpio_cmds(uint16_t old_output, uint16_t old_direction, uint8_t *cmds)
+{
+	unsigned int len = 0;
+
+	if ((output & 0xff) != (old_output & 0xff) || (direction & 0xff) != (old_direction & 0xff)) {
+		cmds[len++] = 0x80;
+		cmds[len++] = output & 0xff;
+		cmds[len++] = direction & 0xff;
+	}
+	if ((output >> 8 != old_output >> 8) || (direction >> 8 != old_direction >> 8)) {
+		cmds[len++] = 0x82;
+		cmds[len++] = output >> 8;
+		cmds[len++] = direction >> 8;
+	}
+
+	return len;
+}
+
+static int ftdi_set_signal(const struct signal *s, char value)
+{
+	uint16_t old_output = output;
+	uint16_t old_direction = direction;
+
+	int retval = ftdi_update_signal(s, value);
+	if (retval != ERROR_OK)
+		return retval;
+
 	if ((output & 0xff) != (old_output & 0xff) || (direction & 0xff) != (old_direction & 0xff))
 		mpsse_set_data_bits_low_byte(mpsse_ctx, output & 0xff, direction & 0xff);
 	if ((output >> 8 != old_output >> 8) || (direction >> 8 != old_direction >> 8))
@@ -624,7 +673,7 @@ static void ftdi_execute_command(struct jtag_command *cmd)
 	}
 }
 
-static int ftdi_execute_queue(struct jtag_command *cmd_queue)
+static void ftdi_queue_commands(struct jtag_command *cmd_queue)
 {
 	/* blink, if the current layout has that feature */
 	struct signal *led = find_signal_by_name("LED");
@@ -638,7 +687,34 @@ static int ftdi_execute_queue(struct jtag_command *cmd_queue)
 
 	if (led)
 		ftdi_set_signal(led, '0');
+}
+
+static int ftdi_execute_queue(struct jtag_command *cmd_queue)
+{
+	ftdi_queue_commands(cmd_queue);
+
+	int retval = ftdi_posted_flush ? mpsse_flush_posted(mpsse_ctx) : mpsse_flush(mpsse_ctx);
+	if (retval != ERROR_OK)
+		LOG_ERROR("error while flushing MPSSE queue: %d", retval);
+
+	return retval;
+}
+
+/* The captured data lands in the scan fields of the queue, which the core
+ * keeps until ftdi_execute_queue_wait() */
+static int ftdi_execute_queue_async(struct jtag_command *cmd_queue)
+{
+	ftdi_queue_commands(cmd_queue);
 
+	int retval = mpsse_flush_async(mpsse_ctx);
+	if (retval != ERROR_OK)
+		LOG_ERROR("error while submitting MPSSE queue: %d", retval);
+
+	return retval;
+}
+
+static int ftdi_execute_queue_wait(void)
+{
 	int retval = mpsse_flush(mpsse_ctx);
 	if (retval != ERROR_OK)
 		LOG_ERROR("error while flushing MPSSE queue: %d", retval);
@@ -808,6 +884,9 @@ COMMAND_HANDLER(ftdi_handle_layout_signal_command)
 	sig->invert_oe = invert_oe;
 	sig->oe_mask = oe_mask;
 
+	/* SWDIO_OE may have changed */
+	swd_template.built = false;
+
 	return ERROR_OK;
 }
 
@@ -917,6 +996,19 @@ COMMAND_HANDLER(ftdi_handle_tdo_sample_edge_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(ftdi_handle_posted_flush_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_ENABLE(CMD_ARGV[0], ftdi_posted_flush);
+
+	command_print(CMD, "ftdi posted flush is %s", ftdi_posted_flush ? "enabled" : "disabled");
+
+	return ERROR_OK;
+}
+
 static const struct command_registration ftdi_subcommand_handlers[] = {
 	{
 		.name = "device_desc",
@@ -978,6 +1070,14 @@ static const struct command_registration ftdi_subcommand_handlers[] = {
 			"allow signalling speed increase)",
 		.usage = "(rising|falling)",
 	},
+	{
+		.name = "posted_flush",
+		.handler = &ftdi_handle_posted_flush_command,
+		.mode = COMMAND_ANY,
+		.help = "return from JTAG queue flushes without read data before "
+			"the adapter has executed them",
+		.usage = "[enable|disable]",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -1034,22 +1134,119 @@ static int ftdi_swd_init(void)
 	return swd_cmd_queue ? ERROR_OK : ERROR_FAIL;
 }
 
-static void ftdi_swd_swdio_en(bool enable)
+/* Encode the GPIO commands switching the SWDIO direction, return their length */
+static unsigned int ftdi_swd_swdio_en_cmds(bool enable, uint8_t *cmds)
 {
 	struct signal *oe = find_signal_by_name("SWDIO_OE");
-	if (oe) {
-		if (oe->data_mask)
-			ftdi_set_signal(oe, enable ? '1' : '0');
-		else {
-			/* Sets TDI/DO pin to input during rx when both pins are connected
-			   to SWDIO */
-			if (enable)
-				direction |= jtag_direction_init & 0x0002U;
-			else
-				direction &= ~0x0002U;
-			mpsse_set_data_bits_low_byte(mpsse_ctx, output & 0xff, direction & 0xff);
-		}
+	if (!oe)
+		return 0;
+
+	if (oe->data_mask) {
+		uint16_t old_output = output;
+		uint16_t old_direction = direction;
+
+		if (ftdi_update_signal(oe, enable ? '1' : '0') != ERROR_OK)
+			return 0;
+		return ftdi_gpio_cmds(old_output, old_direction, cmds);
 	}
+
+	/* Sets TDI/DO pin to input during rx when both pins are connected
+	   to SWDIO */
+	if (enable)
+		direction |= jtag_direction_init & 0x0002U;
+	else
+		direction &= ~0x0002U;
+	cmds[0] = 0x80;
+	cmds[1] = output & 0xff;
+	cmds[2] = direction & 0xff;
+	return 3;
+}
+
+static void ftdi_swd_swdio_en(bool enable)
+{
+	uint8_t cmds[6];
+	unsigned int len = ftdi_swd_swdio_en_cmds(enable, cmds);
+
+	if (len)
+		mpsse_queue_commands(mpsse_ctx, cmds, len, NULL, 0);
+}
+
+/* Append a byte mode MPSSE data command: clock out (or in) nbytes */
+static unsigned int ftdi_swd_byte_cmd(uint8_t *cmds, uint8_t mode, unsigned int nbytes)
+{
+	cmds[0] = mode;
+	cmds[1] = (nbytes - 1) & 0xff;
+	cmds[2] = (nbytes - 1) >> 8;
+	return 3;
+}
+
+/* Append a bit mode MPSSE data command: clock out (or in) nbits */
+static unsigned int ftdi_swd_bit_cmd(uint8_t *cmds, uint8_t mode, unsigned int nbits)
+{
+	cmds[0] = 0x02 | mode;
+	cmds[1] = nbits - 1;
+	return 2;
+}
+
+/**
+ * Build the commands of the read and write transactions for the current GPIO
+ * state. A read clocks out the request, turns SWDIO around and clocks in
+ * trn, ack, data, parity and trn. A write clocks in trn, ack and trn, then
+ * clocks out data and parity. The state changes are those of
+ * ftdi_swd_swdio_en(), the read data ends up as ftdi_swd_response() expects.
+ */
+static void ftdi_swd_build_templates(void)
+{
+	const uint8_t out_mode = SWD_MODE | 0x10;
+	const uint8_t in_mode = SWD_MODE | 0x20;
+	struct ftdi_swd_template *t = &swd_template;
+	uint8_t off[6], on[6];
+
+	t->output = output;
+	t->direction = direction;
+	unsigned int off_len = ftdi_swd_swdio_en_cmds(false, off);
+	unsigned int on_len = ftdi_swd_swdio_en_cmds(true, on);
+	t->end_output = output;
+	t->end_direction = direction;
+	output = t->output;
+	direction = t->direction;
+
+	/* Request, 8 bits */
+	unsigned int len = ftdi_swd_byte_cmd(t->read, out_mode, 1);
+	t->read[len++] = 0;
+	memcpy(&t->read[len], off, off_len);
+	len += off_len;
+	len += ftdi_swd_byte_cmd(&t->read[len], in_mode, 4);
+	len += ftdi_swd_bit_cmd(&t->read[len], in_mode, 1 + 3 + 32 + 1 + 1 - 32);
+	memcpy(&t->read[len], on, on_len);
+	t->read_len = len + on_len;
+
+	len = ftdi_swd_byte_cmd(t->write, out_mode, 1);
+	t->write[len++] = 0;
+	memcpy(&t->write[len], off, off_len);
+	len += off_len;
+	len += ftdi_swd_bit_cmd(&t->write[len], in_mode, 1 + 3 + 1);
+	memcpy(&t->write[len], on, on_len);
+	len += on_len;
+	len += ftdi_swd_byte_cmd(&t->write[len], out_mode, 4);
+	t->write_data = len;
+	len += 4;
+	len += ftdi_swd_bit_cmd(&t->write[len], out_mode, 1);
+	t->write[len++] = 0;
+	t->write_len = len;
+
+	t->built = true;
+}
+
+/* Decode the trn, ack, data, parity and trn bits read by a transaction,
+ * bit 0 being the first sampled. Bit mode reads fill the top bits of a byte. */
+static uint64_t ftdi_swd_response(const struct swd_cmd_queue_entry *q)
+{
+	if (q->cmd & SWD_CMD_RNW)
+		return le_to_h_u32(q->trn_ack_data_parity_trn)
+			| (uint64_t)(q->trn_ack_data_parity_trn[4] >> (8 - (1 + 3 + 32 + 1 + 1 - 32))) << 32;
+
+	return q->trn_ack_data_parity_trn[0] >> (8 - (1 + 3 + 1));
 }
 
 /**
@@ -1082,7 +1279,8 @@ static int ftdi_swd_run_queue(void)
 	}
 
 	for (size_t i = 0; i < swd_cmd_queue_length; i++) {
-		int ack = buf_get_u32(swd_cmd_queue[i].trn_ack_data_parity_trn, 1, 3);
+		uint64_t response = ftdi_swd_response(&swd_cmd_queue[i]);
+		int ack = (response >> 1) & 0x7;
 
 		/* Devices do not reply to DP_TARGETSEL write cmd, ignore received ack */
 		bool check_ack = swd_cmd_returns_ack(swd_cmd_queue[i].cmd);
@@ -1094,16 +1292,16 @@ static int ftdi_swd_run_queue(void)
 				swd_cmd_queue[i].cmd & SWD_CMD_APNDP ? "AP" : "DP",
 				swd_cmd_queue[i].cmd & SWD_CMD_RNW ? "read" : "write",
 				(swd_cmd_queue[i].cmd & SWD_CMD_A32) >> 1,
-				buf_get_u32(swd_cmd_queue[i].trn_ack_data_parity_trn,
-						1 + 3 + (swd_cmd_queue[i].cmd & SWD_CMD_RNW ? 0 : 1), 32));
+				swd_cmd_queue[i].cmd & SWD_CMD_RNW ? (uint32_t)(response >> (1 + 3))
+						: swd_cmd_queue[i].data);
 
 		if (ack != SWD_ACK_OK && check_ack) {
 			queued_retval = swd_ack_to_error_code(ack);
 			goto skip;
 
 		} else if (swd_cmd_queue[i].cmd & SWD_CMD_RNW) {
-			uint32_t data = buf_get_u32(swd_cmd_queue[i].trn_ack_data_parity_trn, 1 + 3, 32);
-			int parity = buf_get_u32(swd_cmd_queue[i].trn_ack_data_parity_trn, 1 + 3 + 32, 1);
+			uint32_t data = response >> (1 + 3);
+			int parity = (response >> (1 + 3 + 32)) & 1;
 
 			if (parity != parity_u32(data)) {
 				LOG_ERROR("SWD Read data parity mismatch");
@@ -1148,32 +1346,29 @@ static void ftdi_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data, uint32
 
 	size_t i = swd_cmd_queue_length++;
 	swd_cmd_queue[i].cmd = cmd | SWD_CMD_START | SWD_CMD_PARK;
+	swd_cmd_queue[i].data = data;
 
-	mpsse_clock_data_out(mpsse_ctx, &swd_cmd_queue[i].cmd, 0, 8, SWD_MODE);
+	struct ftdi_swd_template *t = &swd_template;
+	if (!t->built || output != t->output || direction != t->direction)
+		ftdi_swd_build_templates();
 
 	if (swd_cmd_queue[i].cmd & SWD_CMD_RNW) {
 		/* Queue a read transaction */
 		swd_cmd_queue[i].dst = dst;
 
-		ftdi_swd_swdio_en(false);
-		mpsse_clock_data_in(mpsse_ctx, swd_cmd_queue[i].trn_ack_data_parity_trn,
-				0, 1 + 3 + 32 + 1 + 1, SWD_MODE);
-		ftdi_swd_swdio_en(true);
+		t->read[3] = swd_cmd_queue[i].cmd;
+		mpsse_queue_commands(mpsse_ctx, t->read, t->read_len,
+				swd_cmd_queue[i].trn_ack_data_parity_trn, 4 + 1);
 	} else {
 		/* Queue a write transaction */
-		ftdi_swd_swdio_en(false);
-
-		mpsse_clock_data_in(mpsse_ctx, swd_cmd_queue[i].trn_ack_data_parity_trn,
-				0, 1 + 3 + 1, SWD_MODE);
-
-		ftdi_swd_swdio_en(true);
-
-		buf_set_u32(swd_cmd_queue[i].trn_ack_data_parity_trn, 1 + 3 + 1, 32, data);
-		buf_set_u32(swd_cmd_queue[i].trn_ack_data_parity_trn, 1 + 3 + 1 + 32, 1, parity_u32(data));
-
-		mpsse_clock_data_out(mpsse_ctx, swd_cmd_queue[i].trn_ack_data_parity_trn,
-				1 + 3 + 1, 32 + 1, SWD_MODE);
+		t->write[3] = swd_cmd_queue[i].cmd;
+		h_u32_to_le(&t->write[t->write_data], data);
+		t->write[t->write_len - 1] = parity_u32(data);
+		mpsse_queue_commands(mpsse_ctx, t->write, t->write_len,
+				swd_cmd_queue[i].trn_ack_data_parity_trn, 1);
 	}
+	output = t->end_output;
+	direction = t->end_direction;
 
 	/* Insert idle cycles after AP accesses to avoid WAIT */
 	if (cmd & SWD_CMD_APNDP)
@@ -1252,6 +1447,8 @@ static const char * const ftdi_transports[] = { "jtag", "swd", NULL };
 static struct jtag_interface ftdi_interface = {
 	.supported = DEBUG_CAP_TMS_SEQ,
 	.execute_queue = ftdi_execute_queue,
+	.execute_queue_async = ftdi_execute_queue_async,
+	.execute_queue_wait = ftdi_execute_queue_wait,
 };
 
 struct adapter_driver ftdi_adapter_driver = {
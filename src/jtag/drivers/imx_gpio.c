@@ -74,6 +74,7 @@ static inline bool gpio_level(int g)
 
 static bb_value_t imx_gpio_read(void);
 static int imx_gpio_write(int tck, int tms, int tdi);
+static int imx_gpio_shift(uint8_t tms, uint8_t tdi, unsigned int bits, uint8_t *tdo);
 
 static int imx_gpio_swdio_read(void);
 static void imx_gpio_swdio_drive(bool is_output);
@@ -135,6 +136,41 @@ static int imx_gpio_write(int tck, int tms, int tdi)
 	return ERROR_OK;
 }
 
+/* Requires tck, tms and tdi in the same GPIO bank */
+static int imx_gpio_shift(uint8_t tms, uint8_t tdi, unsigned int bits, uint8_t *tdo)
+{
+	volatile struct imx_gpio_regs *regs = &pio_base[tck_gpio / 32];
+	const uint32_t tck_mask = 1u << (tck_gpio & 0x1F);
+	const uint32_t tms_mask = 1u << (tms_gpio & 0x1F);
+	const uint32_t tdi_mask = 1u << (tdi_gpio & 0x1F);
+	uint8_t value = 0;
+
+	for (unsigned int i = 0; i < bits; i++) {
+		uint32_t dr = regs->dr & ~(tck_mask | tms_mask | tdi_mask);
+
+		if ((tms >> i) & 1)
+			dr |= tms_mask;
+		if ((tdi >> i) & 1)
+			dr |= tdi_mask;
+		regs->dr = dr;
+
+		for (unsigned int j = 0; j < jtag_delay; j++)
+			asm volatile ("");
+
+		value |= gpio_level(tdo_gpio) << i;
+
+		regs->dr = dr | tck_mask;
+
+		for (unsigned int j = 0; j < jtag_delay; j++)
+			asm volatile ("");
+	}
+
+	if (tdo)
+		*tdo = value;
+
+	return ERROR_OK;
+}
+
 static int imx_gpio_swd_write(int swclk, int swdio)
 {
 	swdio ? gpio_set(swdio_gpio) : gpio_clear(swdio_gpio);
@@ -520,6 +556,11 @@ static int imx_gpio_init(void)
 			gpio_set(trst_gpio);
 			gpio_mode_output_set(trst_gpio);
 		}
+
+		if (tms_gpio / 32 == tck_gpio / 32 && tdi_gpio / 32 == tck_gpio / 32)
+			imx_gpio_bitbang.shift = imx_gpio_shift;
+		else
+			imx_gpio_bitbang.shift = NULL;
 	}
 
 	if (transport_is_swd()) {
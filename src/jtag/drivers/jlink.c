@@ -50,8 +50,12 @@ static bool trace_enabled;
 
 #define JLINK_MAX_SPEED			12000
 #define JLINK_TAP_BUFFER_SIZE	2048
+/* jaylink_swd_io() takes the transaction length in bits as 16-bit value */
+#define JLINK_SWD_BUFFER_MAX_SIZE	8191
 
 static unsigned int swd_buffer_size = JLINK_TAP_BUFFER_SIZE;
+/* Size the SWD buffer to the device free memory, up to JLINK_SWD_BUFFER_MAX_SIZE */
+static bool swd_buffer_large;
 
 /* Maximum SWO frequency deviation. */
 #define SWO_MAX_FREQ_DEV	0.03
@@ -472,7 +476,8 @@ static bool adjust_swd_buffer_size(void)
 		return false;
 	}
 
-	tmp = MIN(JLINK_TAP_BUFFER_SIZE, (tmp - 16) / 2);
+	tmp = MIN(swd_buffer_large ? JLINK_SWD_BUFFER_MAX_SIZE : JLINK_TAP_BUFFER_SIZE,
+		(tmp - 16) / 2);
 
 	if (tmp != swd_buffer_size) {
 		swd_buffer_size = tmp;
@@ -1028,6 +1033,30 @@ COMMAND_HANDLER(jlink_handle_free_memory_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(jlink_handle_large_swd_buffer_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		COMMAND_PARSE_ENABLE(CMD_ARGV[0], swd_buffer_large);
+
+		if (devh && iface == JAYLINK_TIF_SWD) {
+			/* Run the queue filled for the previous size */
+			int retval = jlink_swd_run_queue();
+			if (retval != ERROR_OK)
+				return retval;
+			if (!adjust_swd_buffer_size())
+				return ERROR_FAIL;
+		}
+	}
+
+	command_print(CMD, "large SWD buffer is %s, %u bytes",
+		swd_buffer_large ? "enabled" : "disabled", swd_buffer_size);
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(jlink_handle_jlink_jtag_command)
 {
 	if (!CMD_ARGC) {
@@ -1882,6 +1911,13 @@ static const struct command_registration jlink_subcommand_handlers[] = {
 		.help = "show free device memory",
 		.usage = "",
 	},
+	{
+		.name = "large_swd_buffer",
+		.handler = &jlink_handle_large_swd_buffer_command,
+		.mode = COMMAND_ANY,
+		.help = "size the SWD transaction buffer to the free device memory",
+		.usage = "[enable|disable]",
+	},
 	{
 		.name = "hwstatus",
 		.handler = &jlink_handle_hwstatus_command,
@@ -1950,9 +1986,11 @@ static void jlink_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay_c
 
 static unsigned tap_length;
 /* In SWD mode use tms buffer for direction control */
-static uint8_t tms_buffer[JLINK_TAP_BUFFER_SIZE];
-static uint8_t tdi_buffer[JLINK_TAP_BUFFER_SIZE];
-static uint8_t tdo_buffer[JLINK_TAP_BUFFER_SIZE];
+static uint8_t tms_buffer[JLINK_SWD_BUFFER_MAX_SIZE];
+static uint8_t tdi_buffer[JLINK_SWD_BUFFER_MAX_SIZE];
+static uint8_t tdo_buffer[JLINK_SWD_BUFFER_MAX_SIZE];
+/* Idle cycles owed after the last SWD transaction, see jlink_swd_queue_idle() */
+static unsigned int swd_idle_cycles;
 
 struct pending_scan_result {
 	/** First bit position in tdo_buffer to read. */
@@ -1967,17 +2005,19 @@ struct pending_scan_result {
 	uint8_t swd_cmd;
 };
 
-#define MAX_PENDING_SCAN_RESULTS 256
+#define MAX_PENDING_SCAN_RESULTS 2048
 
 static int pending_scan_results_length;
 static struct pending_scan_result pending_scan_results_buffer[MAX_PENDING_SCAN_RESULTS];
 
 static void jlink_tap_init(void)
 {
+	/* Only the part used since the last call may be dirty */
+	memset(tms_buffer, 0, DIV_ROUND_UP(tap_length, 8));
+	memset(tdi_buffer, 0, DIV_ROUND_UP(tap_length, 8));
 	tap_length = 0;
+	swd_idle_cycles = 0;
 	pending_scan_results_length = 0;
-	memset(tms_buffer, 0, sizeof(tms_buffer));
-	memset(tdi_buffer, 0, sizeof(tdi_buffer));
 }
 
 static void jlink_clock_data(const uint8_t *out, unsigned out_offset,
@@ -2091,6 +2131,20 @@ static void jlink_queue_data_in(uint32_t len)
 	tap_length += len;
 }
 
+/*
+ * Idle cycles are only owed once the next transaction header or the end
+ * of the queue is known, so the delay after an AP access and the cycles
+ * needed at the end of the queue are clocked out as one run.
+ */
+static void jlink_swd_queue_idle(unsigned int min_cycles)
+{
+	unsigned int cycles = MAX(swd_idle_cycles, min_cycles);
+
+	if (cycles)
+		jlink_queue_data_out(NULL, cycles);
+	swd_idle_cycles = 0;
+}
+
 static int jlink_swd_switch_seq(enum swd_special_seq seq)
 {
 	const uint8_t *s;
@@ -2137,6 +2191,7 @@ static int jlink_swd_switch_seq(enum swd_special_seq seq)
 			return ERROR_FAIL;
 	}
 
+	jlink_swd_queue_idle(0);
 	jlink_queue_data_out(s, s_len);
 
 	return ERROR_OK;
@@ -2158,7 +2213,7 @@ static int jlink_swd_run_queue(void)
 	 * A transaction must be followed by another transaction or at least 8 idle
 	 * cycles to ensure that data is clocked through the AP.
 	 */
-	jlink_queue_data_out(NULL, 8);
+	jlink_swd_queue_idle(8);
 
 	ret = jaylink_swd_io(devh, tms_buffer, tdi_buffer, tdo_buffer, tap_length);
 
@@ -2202,7 +2257,7 @@ skip:
 static void jlink_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data, uint32_t ap_delay_clk)
 {
 	uint8_t data_parity_trn[DIV_ROUND_UP(32 + 1, 8)];
-	if (tap_length + 46 + 8 + ap_delay_clk >= swd_buffer_size * 8 ||
+	if (tap_length + swd_idle_cycles + 46 + MAX(8, ap_delay_clk) >= swd_buffer_size * 8 ||
 	    pending_scan_results_length == MAX_PENDING_SCAN_RESULTS) {
 		/* Not enough room in the queue. Run the queue. */
 		queued_retval = jlink_swd_run_queue();
@@ -2214,6 +2269,7 @@ static void jlink_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data, uint3
 	pending_scan_results_buffer[pending_scan_results_length].swd_cmd = cmd;
 	cmd |= SWD_CMD_START | SWD_CMD_PARK;
 
+	jlink_swd_queue_idle(0);
 	jlink_queue_data_out(&cmd, 8);
 
 	pending_scan_results_buffer[pending_scan_results_length].first = tap_length;
@@ -2239,7 +2295,7 @@ static void jlink_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data, uint3
 
 	/* Insert idle cycles after AP accesses to avoid WAIT. */
 	if (cmd & SWD_CMD_APNDP)
-		jlink_queue_data_out(NULL, ap_delay_clk);
+		swd_idle_cycles = ap_delay_clk;
 }
 
 static const struct swd_driver jlink_swd = {
@@ -37,6 +37,31 @@
 #define CMD_SCAN_CHAIN		2
 #define CMD_SCAN_CHAIN_FLIP_TMS	3
 #define CMD_STOP_SIMU		4
+#define CMD_BATCH		5
+
+/*
+ * Batched protocol extension, enabled with "jtag_vpi batch on".
+ *
+ * A whole JTAG queue is sent as one CMD_BATCH message:
+ *   u32 CMD_BATCH, u32 payload length, u32 number of commands,
+ * followed by the commands, each:
+ *   u32 cmd (CMD_RESET, CMD_TMS_SEQ, CMD_SCAN_CHAIN or
+ *            CMD_SCAN_CHAIN_FLIP_TMS), u32 nb_bits,
+ *   DIV_ROUND_UP(nb_bits, 8) bytes of TMS or TDI data.
+ * The server answers with a single message:
+ *   u32 CMD_BATCH, u32 length,
+ * followed by the TDO data of every scan command, in order, each padded
+ * to whole bytes. Scans are not limited to XFERT_MAX_SIZE.
+ *
+ * All fields are little endian like in struct vpi_cmd. Both message types
+ * start with the command, so a server can accept the legacy messages too,
+ * e.g. CMD_STOP_SIMU which is always sent as a legacy message.
+ */
+#define BATCH_HEADER_SIZE	12
+#define BATCH_REPLY_HEADER_SIZE	8
+#define BATCH_CMD_HEADER_SIZE	8
+/* send the batch early once it is this big */
+#define BATCH_MAX_SIZE		(1024 * 1024)
 
 /* jtag_vpi server port and address to connect to */
 static int server_port = DEFAULT_SERVER_PORT;
@@ -45,6 +70,9 @@ static char *server_address;
 /* Send CMD_STOP_SIMU to server when OpenOCD exits? */
 static bool stop_sim_on_exit;
 
+/* Use the batched protocol extension? */
+static bool batch_enabled;
+
 static int sockfd;
 static struct sockaddr_in serv_addr;
 
@@ -66,6 +94,31 @@ struct vpi_cmd {
 	};
 };
 
+/* Queue of the batched protocol, see CMD_BATCH */
+struct vpi_batch_read {
+	uint8_t *bits;		/* destination of the TDO data, or NULL */
+	unsigned int nb_bytes;
+};
+
+struct vpi_batch_scan {
+	struct scan_command *cmd;
+	uint8_t *buf;
+};
+
+static struct {
+	uint8_t *buf;		/* starts with BATCH_HEADER_SIZE bytes for the header */
+	size_t len, size;
+	uint32_t count;
+
+	struct vpi_batch_read *reads;
+	unsigned int num_reads, reads_size;
+	size_t reply_len;
+
+	/* scans waiting for the reply before jtag_read_buffer() */
+	struct vpi_batch_scan *scans;
+	unsigned int num_scans, scans_size;
+} batch;
+
 static char *jtag_vpi_cmd_to_str(int cmd_num)
 {
 	switch (cmd_num) {
@@ -79,14 +132,83 @@ static char *jtag_vpi_cmd_to_str(int cmd_num)
 		return "CMD_SCAN_CHAIN_FLIP_TMS";
 	case CMD_STOP_SIMU:
 		return "CMD_STOP_SIMU";
+	case CMD_BATCH:
+		return "CMD_BATCH";
 	default:
 		return "<unknown>";
 	}
 }
 
+static int jtag_vpi_send(const void *data, size_t size)
+{
+	size_t sent = 0;
+
+	while (sent < size) {
+		int retval = write_socket(sockfd, (const char *)data + sent, size - sent);
+		if (retval < 0) {
+			/* Account for the case when socket write is interrupted. */
+#ifdef _WIN32
+			int wsa_err = WSAGetLastError();
+			if (wsa_err == WSAEINTR)
+				continue;
+#else
+			if (errno == EINTR)
+				continue;
+#endif
+			/* Otherwise this is an error using the socket, most likely fatal
+			   for the connection. B*/
+			log_socket_error("jtag_vpi xmit");
+			/* TODO: Clean way how adapter drivers can report fatal errors
+			   to upper layers of OpenOCD and let it perform an orderly shutdown? */
+			exit(-1);
+		} else if (retval == 0) {
+			/* This means we could not send all data, which is most likely fatal
+			   for the jtag_vpi connection (the underlying TCP connection likely not
+			   usable anymore) */
+			LOG_ERROR("jtag_vpi: Could not send all data through jtag_vpi connection.");
+			exit(-1);
+		}
+		sent += retval;
+	}
+
+	return ERROR_OK;
+}
+
+static int jtag_vpi_receive(void *data, size_t size)
+{
+	size_t bytes_buffered = 0;
+	while (bytes_buffered < size) {
+		int retval = read_socket(sockfd, (char *)data + bytes_buffered, size - bytes_buffered);
+		if (retval < 0) {
+#ifdef _WIN32
+			int wsa_err = WSAGetLastError();
+			if (wsa_err == WSAEINTR) {
+				/* socket read interrupted by WSACancelBlockingCall() */
+				continue;
+			}
+#else
+			if (errno == EINTR) {
+				/* socket read interrupted by a signal */
+				continue;
+			}
+#endif
+			/* Otherwise, this is an error when accessing the socket. */
+			log_socket_error("jtag_vpi recv");
+			exit(-1);
+		} else if (retval == 0) {
+			/* Connection closed by the other side */
+			LOG_ERROR("Connection prematurely closed by jtag_vpi server.");
+			exit(-1);
+		}
+		/* Otherwise, we have successfully received some data */
+		bytes_buffered += retval;
+	}
+
+	return ERROR_OK;
+}
+
 static int jtag_vpi_send_cmd(struct vpi_cmd *vpi)
 {
-	int retval;
 
 	/* Optional low-level JTAG debug */
 	if (LOG_LEVEL_IS(LOG_LVL_DEBUG_IO)) {
@@ -125,74 +247,181 @@ static int jtag_vpi_send_cmd(struct vpi_cmd *vpi)
 	h_u32_to_le(vpi->length_buf, vpi->length);
 	h_u32_to_le(vpi->nb_bits_buf, vpi->nb_bits);
 
-retry_write:
-	retval = write_socket(sockfd, vpi, sizeof(struct vpi_cmd));
+	return jtag_vpi_send(vpi, sizeof(struct vpi_cmd));
+}
 
-	if (retval < 0) {
-		/* Account for the case when socket write is interrupted. */
-#ifdef _WIN32
-		int wsa_err = WSAGetLastError();
-		if (wsa_err == WSAEINTR)
-			goto retry_write;
-#else
-		if (errno == EINTR)
-			goto retry_write;
-#endif
-		/* Otherwise this is an error using the socket, most likely fatal
-		   for the connection. B*/
-		log_socket_error("jtag_vpi xmit");
-		/* TODO: Clean way how adapter drivers can report fatal errors
-		   to upper layers of OpenOCD and let it perform an orderly shutdown? */
-		exit(-1);
-	} else if (retval < (int)sizeof(struct vpi_cmd)) {
-		/* This means we could not send all data, which is most likely fatal
-		   for the jtag_vpi connection (the underlying TCP connection likely not
-		   usable anymore) */
-		LOG_ERROR("jtag_vpi: Could not send all data through jtag_vpi connection.");
-		exit(-1);
+static int jtag_vpi_receive_cmd(struct vpi_cmd *vpi)
+{
+	jtag_vpi_receive(vpi, sizeof(struct vpi_cmd));
+
+	/* Use little endian when transmitting/receiving jtag_vpi cmds. */
+	vpi->cmd = le_to_h_u32(vpi->cmd_buf);
+	vpi->length = le_to_h_u32(vpi->length_buf);
+	vpi->nb_bits = le_to_h_u32(vpi->nb_bits_buf);
+
+	return ERROR_OK;
+}
+
+static void *jtag_vpi_grow(void *array, unsigned int *size, size_t elem_size)
+{
+	unsigned int new_size = *size ? 2 * *size : 64;
+	void *p = realloc(array, new_size * elem_size);
+	if (!p) {
+		LOG_ERROR("Out of memory");
+		return NULL;
+	}
+	*size = new_size;
+	return p;
+}
+
+/**
+ * jtag_vpi_batch_add - append a command to the batch
+ * @param cmd the command
+ * @param bits data of the command, or NULL to send ones
+ * @param nb_bits number of bits
+ */
+static int jtag_vpi_batch_add(uint32_t cmd, const uint8_t *bits, unsigned int nb_bits)
+{
+	unsigned int nb_bytes = DIV_ROUND_UP(nb_bits, 8);
+	size_t needed = batch.len + BATCH_CMD_HEADER_SIZE + nb_bytes;
+
+	if (!batch.len)
+		needed += BATCH_HEADER_SIZE;
+
+	if (needed > batch.size) {
+		size_t size = batch.size ? batch.size : 4096;
+		while (size < needed)
+			size *= 2;
+		uint8_t *buf = realloc(batch.buf, size);
+		if (!buf) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		batch.buf = buf;
+		batch.size = size;
+	}
+
+	if (!batch.len)
+		batch.len = BATCH_HEADER_SIZE;
+
+	uint8_t *p = batch.buf + batch.len;
+	h_u32_to_le(p, cmd);
+	h_u32_to_le(p + 4, nb_bits);
+	if (bits)
+		memcpy(p + BATCH_CMD_HEADER_SIZE, bits, nb_bytes);
+	else
+		memset(p + BATCH_CMD_HEADER_SIZE, 0xff, nb_bytes);
+
+	batch.len = needed;
+	batch.count++;
+
+	return ERROR_OK;
+}
+
+/**
+ * jtag_vpi_batch_add_read - expect the TDO data of a scan in the reply
+ * @param bits where to store the data, or NULL to drop it
+ * @param nb_bits number of bits
+ */
+static int jtag_vpi_batch_add_read(uint8_t *bits, unsigned int nb_bits)
+{
+	if (batch.num_reads == batch.reads_size) {
+		struct vpi_batch_read *reads = jtag_vpi_grow(batch.reads,
+				&batch.reads_size, sizeof(*reads));
+		if (!reads)
+			return ERROR_FAIL;
+		batch.reads = reads;
 	}
 
-	/* Otherwise the packet has been sent successfully. */
+	batch.reads[batch.num_reads].bits = bits;
+	batch.reads[batch.num_reads].nb_bytes = DIV_ROUND_UP(nb_bits, 8);
+	batch.num_reads++;
+	batch.reply_len += DIV_ROUND_UP(nb_bits, 8);
+
 	return ERROR_OK;
 }
 
-static int jtag_vpi_receive_cmd(struct vpi_cmd *vpi)
+static int jtag_vpi_batch_add_scan(struct scan_command *cmd, uint8_t *buf)
 {
-	unsigned bytes_buffered = 0;
-	while (bytes_buffered < sizeof(struct vpi_cmd)) {
-		int bytes_to_receive = sizeof(struct vpi_cmd) - bytes_buffered;
-		int retval = read_socket(sockfd, ((char *)vpi) + bytes_buffered, bytes_to_receive);
-		if (retval < 0) {
-#ifdef _WIN32
-			int wsa_err = WSAGetLastError();
-			if (wsa_err == WSAEINTR) {
-				/* socket read interrupted by WSACancelBlockingCall() */
-				continue;
+	if (batch.num_scans == batch.scans_size) {
+		struct vpi_batch_scan *scans = jtag_vpi_grow(batch.scans,
+				&batch.scans_size, sizeof(*scans));
+		if (!scans)
+			return ERROR_FAIL;
+		batch.scans = scans;
+	}
+
+	batch.scans[batch.num_scans].cmd = cmd;
+	batch.scans[batch.num_scans].buf = buf;
+	batch.num_scans++;
+
+	return ERROR_OK;
+}
+
+/**
+ * jtag_vpi_batch_flush - send the batch and wait for its reply
+ *
+ * Distributes the TDO data of the reply and completes the queued scans.
+ */
+static int jtag_vpi_batch_flush(void)
+{
+	int retval = ERROR_OK;
+
+	if (batch.count) {
+		h_u32_to_le(batch.buf, CMD_BATCH);
+		h_u32_to_le(batch.buf + 4, batch.len - BATCH_HEADER_SIZE);
+		h_u32_to_le(batch.buf + 8, batch.count);
+
+		LOG_DEBUG_IO("sending JTAG VPI batch: commands=%" PRIu32 ", length=%zu, "
+				"reply length=%zu", batch.count, batch.len - BATCH_HEADER_SIZE,
+				batch.reply_len);
+
+		jtag_vpi_send(batch.buf, batch.len);
+
+		uint8_t header[BATCH_REPLY_HEADER_SIZE];
+		jtag_vpi_receive(header, sizeof(header));
+		uint32_t cmd = le_to_h_u32(header);
+		uint32_t length = le_to_h_u32(header + 4);
+
+		/* read the whole reply even if it is wrong, to stay in sync */
+		uint8_t *reply = NULL;
+		if (length) {
+			reply = malloc(length);
+			if (!reply) {
+				LOG_ERROR("Out of memory");
+				exit(-1);
 			}
-#else
-			if (errno == EINTR) {
-				/* socket read interrupted by a signal */
-				continue;
+			jtag_vpi_receive(reply, length);
+		}
+
+		if (cmd != CMD_BATCH || length != batch.reply_len) {
+			LOG_ERROR("jtag_vpi: invalid batch reply, cmd=%s, length=%" PRIu32
+					" (expected %zu)", jtag_vpi_cmd_to_str(cmd), length, batch.reply_len);
+			retval = ERROR_FAIL;
+		} else {
+			const uint8_t *p = reply;
+			for (unsigned int i = 0; i < batch.num_reads; i++) {
+				if (batch.reads[i].bits)
+					memcpy(batch.reads[i].bits, p, batch.reads[i].nb_bytes);
+				p += batch.reads[i].nb_bytes;
 			}
-#endif
-			/* Otherwise, this is an error when accessing the socket. */
-			log_socket_error("jtag_vpi recv");
-			exit(-1);
-		} else if (retval == 0) {
-			/* Connection closed by the other side */
-			LOG_ERROR("Connection prematurely closed by jtag_vpi server.");
-			exit(-1);
 		}
-		/* Otherwise, we have successfully received some data */
-		bytes_buffered += retval;
+		free(reply);
 	}
 
-	/* Use little endian when transmitting/receiving jtag_vpi cmds. */
-	vpi->cmd = le_to_h_u32(vpi->cmd_buf);
-	vpi->length = le_to_h_u32(vpi->length_buf);
-	vpi->nb_bits = le_to_h_u32(vpi->nb_bits_buf);
+	for (unsigned int i = 0; i < batch.num_scans; i++) {
+		if (retval == ERROR_OK)
+			retval = jtag_read_buffer(batch.scans[i].buf, batch.scans[i].cmd);
+		free(batch.scans[i].buf);
+	}
 
-	return ERROR_OK;
+	batch.len = 0;
+	batch.count = 0;
+	batch.num_reads = 0;
+	batch.reply_len = 0;
+	batch.num_scans = 0;
+
+	return retval;
 }
 
 /**
@@ -205,6 +434,9 @@ static int jtag_vpi_reset(int trst, int srst)
 	struct vpi_cmd vpi;
 	memset(&vpi, 0, sizeof(struct vpi_cmd));
 
+	if (batch_enabled)
+		return jtag_vpi_batch_add(CMD_RESET, NULL, 0);
+
 	vpi.cmd = CMD_RESET;
 	vpi.length = 0;
 	return jtag_vpi_send_cmd(&vpi);
@@ -226,6 +458,9 @@ static int jtag_vpi_tms_seq(const uint8_t *bits, int nb_bits)
 	struct vpi_cmd vpi;
 	int nb_bytes;
 
+	if (batch_enabled)
+		return jtag_vpi_batch_add(CMD_TMS_SEQ, bits, nb_bits);
+
 	memset(&vpi, 0, sizeof(struct vpi_cmd));
 	nb_bytes = DIV_ROUND_UP(nb_bits, 8);
 
@@ -340,6 +575,14 @@ static int jtag_vpi_queue_tdi(uint8_t *bits, int nb_bits, int tap_shift)
 	int nb_xfer = DIV_ROUND_UP(nb_bits, XFERT_MAX_SIZE * 8);
 	int retval;
 
+	if (batch_enabled) {
+		retval = jtag_vpi_batch_add(tap_shift ? CMD_SCAN_CHAIN_FLIP_TMS : CMD_SCAN_CHAIN,
+				bits, nb_bits);
+		if (retval != ERROR_OK)
+			return retval;
+		return jtag_vpi_batch_add_read(bits, nb_bits);
+	}
+
 	while (nb_xfer) {
 		if (nb_xfer ==  1) {
 			retval = jtag_vpi_queue_tdi_xfer(bits, nb_bits, tap_shift);
@@ -425,11 +668,20 @@ static int jtag_vpi_scan(struct scan_command *cmd)
 			tap_set_state(TAP_DRPAUSE);
 	}
 
-	retval = jtag_read_buffer(buf, cmd);
-	if (retval != ERROR_OK)
-		return retval;
+	if (batch_enabled) {
+		/* the data arrives with the reply to the batch */
+		retval = jtag_vpi_batch_add_scan(cmd, buf);
+		if (retval != ERROR_OK) {
+			free(buf);
+			return retval;
+		}
+	} else {
+		retval = jtag_read_buffer(buf, cmd);
+		if (retval != ERROR_OK)
+			return retval;
 
-	free(buf);
+		free(buf);
+	}
 
 	if (cmd->end_state != TAP_DRSHIFT) {
 		retval = jtag_vpi_state_move(cmd->end_state);
@@ -506,6 +758,9 @@ static int jtag_vpi_execute_queue(struct jtag_command *cmd_queue)
 			retval = jtag_vpi_tms(cmd->cmd.tms);
 			break;
 		case JTAG_SLEEP:
+			/* the commands before the sleep must reach the simulation first */
+			if (batch_enabled)
+				retval = jtag_vpi_batch_flush();
 			jtag_sleep(cmd->cmd.sleep->us);
 			break;
 		case JTAG_SCAN:
@@ -517,8 +772,16 @@ static int jtag_vpi_execute_queue(struct jtag_command *cmd_queue)
 			retval = ERROR_FAIL;
 			break;
 		}
+
+		if (retval == ERROR_OK && batch.len > BATCH_MAX_SIZE)
+			retval = jtag_vpi_batch_flush();
 	}
 
+	/* also completes the scans queued before an error */
+	int flush_retval = jtag_vpi_batch_flush();
+	if (retval == ERROR_OK)
+		retval = flush_retval;
+
 	return retval;
 }
 
@@ -586,6 +849,9 @@ static int jtag_vpi_quit(void)
 		log_socket_error("jtag_vpi");
 	}
 	free(server_address);
+	free(batch.buf);
+	free(batch.reads);
+	free(batch.scans);
 	return ERROR_OK;
 }
 
@@ -622,6 +888,15 @@ COMMAND_HANDLER(jtag_vpi_stop_sim_on_exit_handler)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(jtag_vpi_batch_handler)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_ON_OFF(CMD_ARGV[0], batch_enabled);
+	return ERROR_OK;
+}
+
 static const struct command_registration jtag_vpi_subcommand_handlers[] = {
 	{
 		.name = "set_port",
@@ -645,6 +920,14 @@ static const struct command_registration jtag_vpi_subcommand_handlers[] = {
 			"before OpenOCD exits (default: off)",
 		.usage = "<on|off>",
 	},
+	{
+		.name = "batch",
+		.handler = &jtag_vpi_batch_handler,
+		.mode = COMMAND_CONFIG,
+		.help = "Configure if the whole JTAG queue is sent as one message "
+			"(needs a server supporting CMD_BATCH, default: off)",
+		.usage = "<on|off>",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
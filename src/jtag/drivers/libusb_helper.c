@@ -243,6 +243,8 @@ int jtag_libusb_control_transfer(struct libusb_device_handle *dev, uint8_t reque
 	if (transferred)
 		*transferred = retval;
 
+	adapter_usb_record(request_type & LIBUSB_ENDPOINT_IN, 0, (uint8_t *)bytes, retval);
+
 	return ERROR_OK;
 }
 
@@ -260,6 +262,9 @@ int jtag_libusb_bulk_write(struct libusb_device_handle *dev, int ep, char *bytes
 		return jtag_libusb_error(ret);
 	}
 
+	adapter_stats_usb(*transferred, 0);
+	adapter_usb_record(false, ep, (uint8_t *)bytes, *transferred);
+
 	return ERROR_OK;
 }
 
@@ -277,6 +282,9 @@ int jtag_libusb_bulk_read(struct libusb_device_handle *dev, int ep, char *bytes,
 		return jtag_libusb_error(ret);
 	}
 
+	adapter_stats_usb(0, *transferred);
+	adapter_usb_record(true, ep, (uint8_t *)bytes, *transferred);
+
 	return ERROR_OK;
 }
 
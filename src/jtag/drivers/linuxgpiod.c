@@ -14,14 +14,40 @@
 #endif
 
 #include <gpiod.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
 #include <jtag/adapter.h>
 #include <jtag/interface.h>
 #include <transport/transport.h>
+#include <helper/bits.h>
 #include "bitbang.h"
 
+/* gpio v2 uAPI, Linux 5.10 and later */
+#ifdef GPIO_V2_GET_LINE_IOCTL
+#define LINUXGPIOD_BULK
+#endif
+
 static struct gpiod_chip *gpiod_chip[ADAPTER_GPIO_IDX_NUM] = {};
 static struct gpiod_line *gpiod_line[ADAPTER_GPIO_IDX_NUM] = {};
 
+#ifdef LINUXGPIOD_BULK
+/*
+ * When the JTAG or SWD lines are on the same chip, they are requested
+ * together through the gpio v2 uAPI and written, or read, with a single
+ * ioctl instead of one libgpiod call per line. The other lines still go
+ * through libgpiod.
+ */
+static int bulk_fd = -1;
+/* position of each line in the request, or -1 */
+static int bulk_bit[ADAPTER_GPIO_IDX_NUM];
+static struct gpio_v2_line_config bulk_config;
+/* index in bulk_config of the attribute holding the output values */
+static unsigned int bulk_values_attr;
+/* current values of the output lines */
+static uint64_t bulk_values;
+#endif
+
 static int last_swclk;
 static int last_swdio;
 static bool last_stored;
@@ -41,11 +67,202 @@ static bool is_gpio_config_valid(enum adapter_gpio_config_index idx)
 		&& adapter_gpio_config[idx].gpio_num < 10000;
 }
 
+#ifdef LINUXGPIOD_BULK
+static uint64_t bulk_line_flags(enum adapter_gpio_config_index idx, bool output)
+{
+	uint64_t flags = output ? GPIO_V2_LINE_FLAG_OUTPUT : GPIO_V2_LINE_FLAG_INPUT;
+
+	if (output) {
+		switch (adapter_gpio_config[idx].drive) {
+		case ADAPTER_GPIO_DRIVE_MODE_PUSH_PULL:
+			break;
+		case ADAPTER_GPIO_DRIVE_MODE_OPEN_DRAIN:
+			flags |= GPIO_V2_LINE_FLAG_OPEN_DRAIN;
+			break;
+		case ADAPTER_GPIO_DRIVE_MODE_OPEN_SOURCE:
+			flags |= GPIO_V2_LINE_FLAG_OPEN_SOURCE;
+			break;
+		}
+	}
+
+	switch (adapter_gpio_config[idx].pull) {
+	case ADAPTER_GPIO_PULL_NONE:
+		flags |= GPIO_V2_LINE_FLAG_BIAS_DISABLED;
+		break;
+	case ADAPTER_GPIO_PULL_UP:
+		flags |= GPIO_V2_LINE_FLAG_BIAS_PULL_UP;
+		break;
+	case ADAPTER_GPIO_PULL_DOWN:
+		flags |= GPIO_V2_LINE_FLAG_BIAS_PULL_DOWN;
+		break;
+	}
+
+	if (adapter_gpio_config[idx].active_low)
+		flags |= GPIO_V2_LINE_FLAG_ACTIVE_LOW;
+
+	return flags;
+}
+
+/* Request @a lines together, if they are all on the same chip */
+static bool bulk_request(const enum adapter_gpio_config_index *lines, unsigned int num_lines)
+{
+	unsigned int chip_num = adapter_gpio_config[lines[0]].chip_num;
+	struct gpio_v2_line_request req;
+	uint64_t outputs = 0;
+	char path[32];
+
+	for (unsigned int i = 0; i < num_lines; i++)
+		if (adapter_gpio_config[lines[i]].chip_num != chip_num)
+			return false;
+
+	snprintf(path, sizeof(path), "/dev/gpiochip%u", chip_num);
+	int chip_fd = open(path, O_RDWR | O_CLOEXEC);
+	if (chip_fd < 0)
+		return false;
+
+	memset(&req, 0, sizeof(req));
+	memset(&bulk_config, 0, sizeof(bulk_config));
+	strcpy(req.consumer, "OpenOCD");
+	req.num_lines = num_lines;
+	bulk_values = 0;
+
+	for (unsigned int i = 0; i < num_lines; i++) {
+		enum adapter_gpio_config_index idx = lines[i];
+		bool output = adapter_gpio_config[idx].init_state != ADAPTER_GPIO_INIT_STATE_INPUT;
+
+		req.offsets[i] = adapter_gpio_config[idx].gpio_num;
+		bulk_config.attrs[i].attr.id = GPIO_V2_LINE_ATTR_ID_FLAGS;
+		bulk_config.attrs[i].attr.flags = bulk_line_flags(idx, output);
+		bulk_config.attrs[i].mask = BIT(i);
+		if (output)
+			outputs |= BIT(i);
+		if (adapter_gpio_config[idx].init_state == ADAPTER_GPIO_INIT_STATE_ACTIVE)
+			bulk_values |= BIT(i);
+	}
+
+	bulk_values_attr = num_lines;
+	bulk_config.attrs[num_lines].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+	bulk_config.attrs[num_lines].attr.values = bulk_values;
+	bulk_config.attrs[num_lines].mask = outputs;
+	bulk_config.num_attrs = num_lines + 1;
+	req.config = bulk_config;
+
+	int retval = ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req);
+	close(chip_fd);
+	if (retval < 0) {
+		LOG_DEBUG("gpio v2 line request failed, using one request per line");
+		return false;
+	}
+
+	bulk_fd = req.fd;
+	for (unsigned int i = 0; i < num_lines; i++)
+		bulk_bit[lines[i]] = i;
+
+	LOG_DEBUG("%u lines of gpiochip%u requested together", num_lines, chip_num);
+
+	return true;
+}
+
+/* Set the lines in @a mask to @a values; lines already at the value are skipped */
+static int bulk_set(uint64_t values, uint64_t mask)
+{
+	mask &= values ^ bulk_values;
+	if (!mask)
+		return ERROR_OK;
+
+	struct gpio_v2_line_values v = {
+		.bits = values,
+		.mask = mask,
+	};
+	if (ioctl(bulk_fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &v) < 0) {
+		LOG_WARNING("writing gpio lines failed");
+		return ERROR_FAIL;
+	}
+
+	bulk_values = (bulk_values & ~mask) | (values & mask);
+
+	return ERROR_OK;
+}
+
+static int bulk_get(enum adapter_gpio_config_index idx)
+{
+	struct gpio_v2_line_values v = {
+		.mask = BIT(bulk_bit[idx]),
+	};
+	if (ioctl(bulk_fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &v) < 0)
+		return -1;
+
+	return !!(v.bits & v.mask);
+}
+
+static uint64_t bulk_bit_value(enum adapter_gpio_config_index idx, int value)
+{
+	return value ? BIT(bulk_bit[idx]) : 0;
+}
+
+/*
+ * TCK, TMS and TDI change in a single ioctl. Bitbang only changes TMS
+ * and TDI together with a falling TCK, so they are stable at the rising
+ * edge as when TCK was written last.
+ */
+static int bulk_jtag_write(int tck, int tms, int tdi)
+{
+	return bulk_set(bulk_bit_value(ADAPTER_GPIO_IDX_TCK, tck) |
+			bulk_bit_value(ADAPTER_GPIO_IDX_TMS, tms) |
+			bulk_bit_value(ADAPTER_GPIO_IDX_TDI, tdi),
+			bulk_bit_value(ADAPTER_GPIO_IDX_TCK, 1) |
+			bulk_bit_value(ADAPTER_GPIO_IDX_TMS, 1) |
+			bulk_bit_value(ADAPTER_GPIO_IDX_TDI, 1));
+}
+
+/* Bitbang interface shift, two writes and one read per bit */
+static int linuxgpiod_shift(uint8_t tms, uint8_t tdi, unsigned int bits, uint8_t *tdo)
+{
+	uint8_t value = 0;
+	int retval;
+
+	for (unsigned int i = 0; i < bits; i++) {
+		retval = bulk_jtag_write(0, (tms >> i) & 1, (tdi >> i) & 1);
+		if (retval != ERROR_OK)
+			return retval;
+
+		if (tdo) {
+			int bit = bulk_get(ADAPTER_GPIO_IDX_TDO);
+			if (bit < 0) {
+				LOG_WARNING("reading tdo failed");
+				return ERROR_FAIL;
+			}
+			value |= bit << i;
+		}
+
+		retval = bulk_jtag_write(1, (tms >> i) & 1, (tdi >> i) & 1);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	if (tdo)
+		*tdo = value;
+
+	return ERROR_OK;
+}
+#endif
+
 /* Bitbang interface read of TDO */
 static bb_value_t linuxgpiod_read(void)
 {
 	int retval;
 
+#ifdef LINUXGPIOD_BULK
+	if (bulk_fd >= 0) {
+		retval = bulk_get(ADAPTER_GPIO_IDX_TDO);
+		if (retval < 0) {
+			LOG_WARNING("reading tdo failed");
+			return 0;
+		}
+		return retval ? BB_HIGH : BB_LOW;
+	}
+#endif
+
 	retval = gpiod_line_get_value(gpiod_line[ADAPTER_GPIO_IDX_TDO]);
 	if (retval < 0) {
 		LOG_WARNING("reading tdo failed");
@@ -71,6 +288,11 @@ static int linuxgpiod_write(int tck, int tms, int tdi)
 
 	int retval;
 
+#ifdef LINUXGPIOD_BULK
+	if (bulk_fd >= 0)
+		return bulk_jtag_write(tck, tms, tdi);
+#endif
+
 	if (!first_time) {
 		last_tck = !tck;
 		last_tms = !tms;
@@ -108,6 +330,17 @@ static int linuxgpiod_swdio_read(void)
 {
 	int retval;
 
+#ifdef LINUXGPIOD_BULK
+	if (bulk_fd >= 0) {
+		retval = bulk_get(ADAPTER_GPIO_IDX_SWDIO);
+		if (retval < 0) {
+			LOG_WARNING("Fail read swdio");
+			return 0;
+		}
+		return retval;
+	}
+#endif
+
 	retval = gpiod_line_get_value(gpiod_line[ADAPTER_GPIO_IDX_SWDIO]);
 	if (retval < 0) {
 		LOG_WARNING("Fail read swdio");
@@ -117,10 +350,53 @@ static int linuxgpiod_swdio_read(void)
 	return retval;
 }
 
+#ifdef LINUXGPIOD_BULK
+/* The direction changes in place, without releasing the line */
+static void bulk_swdio_drive(bool is_output)
+{
+	int bit = bulk_bit[ADAPTER_GPIO_IDX_SWDIO];
+	int retval;
+
+	if (is_output && gpiod_line[ADAPTER_GPIO_IDX_SWDIO_DIR]) {
+		retval = gpiod_line_set_value(gpiod_line[ADAPTER_GPIO_IDX_SWDIO_DIR], 1);
+		if (retval < 0)
+			LOG_WARNING("Fail set swdio_dir");
+	}
+
+	bulk_config.attrs[bit].attr.flags = bulk_line_flags(ADAPTER_GPIO_IDX_SWDIO, is_output);
+	if (is_output) {
+		bulk_values |= BIT(bit);
+		bulk_config.attrs[bulk_values_attr].mask |= BIT(bit);
+	} else {
+		bulk_config.attrs[bulk_values_attr].mask &= ~BIT(bit);
+	}
+	/* keep the other outputs where they are */
+	bulk_config.attrs[bulk_values_attr].attr.values = bulk_values;
+
+	if (ioctl(bulk_fd, GPIO_V2_LINE_SET_CONFIG_IOCTL, &bulk_config) < 0)
+		LOG_WARNING("Fail set swdio direction");
+
+	if (!is_output && gpiod_line[ADAPTER_GPIO_IDX_SWDIO_DIR]) {
+		retval = gpiod_line_set_value(gpiod_line[ADAPTER_GPIO_IDX_SWDIO_DIR], 0);
+		if (retval < 0)
+			LOG_WARNING("Fail set swdio_dir");
+	}
+}
+#endif
+
 static void linuxgpiod_swdio_drive(bool is_output)
 {
 	int retval;
 
+#ifdef LINUXGPIOD_BULK
+	if (bulk_fd >= 0) {
+		bulk_swdio_drive(is_output);
+		last_stored = false;
+		swdio_input = !is_output;
+		return;
+	}
+#endif
+
 	/*
 	 * FIXME: change direction requires release and re-require the line
 	 * https://stackoverflow.com/questions/58735140/
@@ -156,6 +432,16 @@ static int linuxgpiod_swd_write(int swclk, int swdio)
 {
 	int retval;
 
+#ifdef LINUXGPIOD_BULK
+	if (bulk_fd >= 0) {
+		uint64_t mask = bulk_bit_value(ADAPTER_GPIO_IDX_SWCLK, 1);
+		if (!swdio_input)
+			mask |= bulk_bit_value(ADAPTER_GPIO_IDX_SWDIO, 1);
+		return bulk_set(bulk_bit_value(ADAPTER_GPIO_IDX_SWCLK, swclk) |
+				bulk_bit_value(ADAPTER_GPIO_IDX_SWDIO, swdio), mask);
+	}
+#endif
+
 	if (!swdio_input) {
 		if (!last_stored || swdio != last_swdio) {
 			retval = gpiod_line_set_value(gpiod_line[ADAPTER_GPIO_IDX_SWDIO], swdio);
@@ -270,6 +556,13 @@ static int linuxgpiod_quit(void)
 	for (int i = 0; i < ADAPTER_GPIO_IDX_NUM; ++i)
 		helper_release(i);
 
+#ifdef LINUXGPIOD_BULK
+	if (bulk_fd >= 0) {
+		close(bulk_fd);
+		bulk_fd = -1;
+	}
+#endif
+
 	return ERROR_OK;
 }
 
@@ -360,13 +653,43 @@ static int helper_get_line(enum adapter_gpio_config_index idx)
 	return ERROR_OK;
 }
 
+/* Request the lines of the hot path, together if possible */
+static int helper_get_lines(const enum adapter_gpio_config_index *lines, unsigned int num_lines)
+{
+#ifdef LINUXGPIOD_BULK
+	if (bulk_request(lines, num_lines))
+		return ERROR_OK;
+#endif
+
+	for (unsigned int i = 0; i < num_lines; i++) {
+		int retval = helper_get_line(lines[i]);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return ERROR_OK;
+}
+
 static int linuxgpiod_init(void)
 {
+	static const enum adapter_gpio_config_index jtag_lines[] = {
+		ADAPTER_GPIO_IDX_TDO, ADAPTER_GPIO_IDX_TDI,
+		ADAPTER_GPIO_IDX_TCK, ADAPTER_GPIO_IDX_TMS,
+	};
+	static const enum adapter_gpio_config_index swd_lines[] = {
+		ADAPTER_GPIO_IDX_SWDIO, ADAPTER_GPIO_IDX_SWCLK,
+	};
+
 	LOG_INFO("Linux GPIOD JTAG/SWD bitbang driver");
 
 	bitbang_interface = &linuxgpiod_bitbang;
 	adapter_gpio_config = adapter_gpio_get_config();
 
+#ifdef LINUXGPIOD_BULK
+	for (int i = 0; i < ADAPTER_GPIO_IDX_NUM; ++i)
+		bulk_bit[i] = -1;
+#endif
+
 	/*
 	 * Configure JTAG/SWD signals. Default directions and initial states are handled
 	 * by adapter.c and "adapter gpio" command.
@@ -378,12 +701,13 @@ static int linuxgpiod_init(void)
 			goto out_error;
 		}
 
-		if (helper_get_line(ADAPTER_GPIO_IDX_TDO) != ERROR_OK
-				|| helper_get_line(ADAPTER_GPIO_IDX_TDI) != ERROR_OK
-				|| helper_get_line(ADAPTER_GPIO_IDX_TCK) != ERROR_OK
-				|| helper_get_line(ADAPTER_GPIO_IDX_TMS) != ERROR_OK
+		if (helper_get_lines(jtag_lines, ARRAY_SIZE(jtag_lines)) != ERROR_OK
 				|| helper_get_line(ADAPTER_GPIO_IDX_TRST) != ERROR_OK)
 			goto out_error;
+
+#ifdef LINUXGPIOD_BULK
+		linuxgpiod_bitbang.shift = bulk_fd >= 0 ? linuxgpiod_shift : NULL;
+#endif
 	}
 
 	if (transport_is_swd()) {
@@ -400,17 +724,14 @@ static int linuxgpiod_init(void)
 		 * configured to send the swdio signal from the target to the GPIO.
 		 */
 		if (adapter_gpio_config[ADAPTER_GPIO_IDX_SWDIO].init_state == ADAPTER_GPIO_INIT_STATE_INPUT) {
-			retval1 = helper_get_line(ADAPTER_GPIO_IDX_SWDIO);
+			retval1 = helper_get_lines(swd_lines, ARRAY_SIZE(swd_lines));
 			retval2 = helper_get_line(ADAPTER_GPIO_IDX_SWDIO_DIR);
 		} else {
 			retval1 = helper_get_line(ADAPTER_GPIO_IDX_SWDIO_DIR);
-			retval2 = helper_get_line(ADAPTER_GPIO_IDX_SWDIO);
+			retval2 = helper_get_lines(swd_lines, ARRAY_SIZE(swd_lines));
 		}
 		if (retval1 != ERROR_OK || retval2 != ERROR_OK)
 			goto out_error;
-
-		if (helper_get_line(ADAPTER_GPIO_IDX_SWCLK) != ERROR_OK)
-			goto out_error;
 	}
 
 	if (helper_get_line(ADAPTER_GPIO_IDX_SRST) != ERROR_OK
@@ -52,6 +52,24 @@
 #define SIO_RESET_PURGE_RX 1
 #define SIO_RESET_PURGE_TX 2
 
+/* Number of command buffers that can be handed to the device at once */
+#define MPSSE_RING_SIZE 4
+
+/* A buffer of MPSSE commands, submitted and completed in ring order */
+struct mpsse_buffer {
+	struct mpsse_ctx *ctx;
+	uint8_t *write_buffer;
+	unsigned write_count;
+	unsigned write_transferred;
+	uint8_t *read_buffer;
+	unsigned read_count;
+	unsigned read_transferred;
+	struct bit_copy_queue read_queue;
+	struct libusb_transfer *write_transfer;
+	bool write_done;
+	bool pending;
+};
+
 struct mpsse_ctx {
 	struct libusb_context *usb_ctx;
 	struct libusb_device_handle *usb_dev;
@@ -72,9 +90,21 @@ struct mpsse_ctx {
 	uint8_t *read_chunk;
 	unsigned read_chunk_size;
 	struct bit_copy_queue read_queue;
+	/* A single transfer reads the data of all the pending buffers in turn,
+	 * as the device sends it in one stream */
+	struct libusb_transfer *read_transfer;
+	bool read_active;
+	/* The write and read buffers above are those of ring[ring_put] */
+	struct mpsse_buffer ring[MPSSE_RING_SIZE];
+	unsigned ring_put;
+	unsigned ring_get;
+	unsigned ring_count;
 	int retval;
 };
 
+static void mpsse_cancel_all(struct mpsse_ctx *ctx);
+static int mpsse_submit(struct mpsse_ctx *ctx);
+
 /* Returns true if the string descriptor indexed by str_index in device matches string */
 static bool string_descriptor_equal(struct libusb_device_handle *device, uint8_t str_index,
 	const char *string)
@@ -341,17 +371,28 @@ struct mpsse_ctx *mpsse_open(const uint16_t vids[], const uint16_t pids[], const
 	ctx->read_size = 16384;
 	ctx->write_size = 16384;
 	ctx->read_chunk = malloc(ctx->read_chunk_size);
-	ctx->read_buffer = malloc(ctx->read_size);
-
-	/* Use calloc to make valgrind happy: buffer_write() sets payload
-	 * on bit basis, so some bits can be left uninitialized in write_buffer.
-	 * Although this is perfectly ok with MPSSE, valgrind reports
-	 * Syscall param ioctl(USBDEVFS_SUBMITURB).buffer points to uninitialised byte(s) */
-	ctx->write_buffer = calloc(1, ctx->write_size);
-
-	if (!ctx->read_chunk || !ctx->read_buffer || !ctx->write_buffer)
+	ctx->read_transfer = libusb_alloc_transfer(0);
+	if (!ctx->read_chunk || !ctx->read_transfer)
 		goto error;
 
+	for (unsigned int i = 0; i < MPSSE_RING_SIZE; i++) {
+		struct mpsse_buffer *buf = &ctx->ring[i];
+
+		buf->ctx = ctx;
+		bit_copy_queue_init(&buf->read_queue);
+		buf->read_buffer = malloc(ctx->read_size);
+		/* Use calloc to make valgrind happy: buffer_write() sets payload
+		 * on bit basis, so some bits can be left uninitialized in write_buffer.
+		 * Although this is perfectly ok with MPSSE, valgrind reports
+		 * Syscall param ioctl(USBDEVFS_SUBMITURB).buffer points to uninitialised byte(s) */
+		buf->write_buffer = calloc(1, ctx->write_size);
+		buf->write_transfer = libusb_alloc_transfer(0);
+		if (!buf->read_buffer || !buf->write_buffer || !buf->write_transfer)
+			goto error;
+	}
+	ctx->write_buffer = ctx->ring[0].write_buffer;
+	ctx->read_buffer = ctx->ring[0].read_buffer;
+
 	ctx->interface = channel;
 	ctx->index = channel + 1;
 	ctx->usb_read_timeout = 5000;
@@ -404,14 +445,24 @@ error:
 
 void mpsse_close(struct mpsse_ctx *ctx)
 {
-	if (ctx->usb_dev)
+	if (ctx->usb_dev) {
+		mpsse_cancel_all(ctx);
 		libusb_close(ctx->usb_dev);
+	}
 	if (ctx->usb_ctx)
 		libusb_exit(ctx->usb_ctx);
 	bit_copy_discard(&ctx->read_queue);
 
-	free(ctx->write_buffer);
-	free(ctx->read_buffer);
+	for (unsigned int i = 0; i < MPSSE_RING_SIZE; i++) {
+		struct mpsse_buffer *buf = &ctx->ring[i];
+
+		if (buf->ctx)
+			bit_copy_discard(&buf->read_queue);
+		free(buf->write_buffer);
+		free(buf->read_buffer);
+		libusb_free_transfer(buf->write_transfer);
+	}
+	libusb_free_transfer(ctx->read_transfer);
 	free(ctx->read_chunk);
 	free(ctx);
 }
@@ -425,6 +476,7 @@ void mpsse_purge(struct mpsse_ctx *ctx)
 {
 	int err;
 	LOG_DEBUG("-");
+	mpsse_cancel_all(ctx);
 	ctx->write_count = 0;
 	ctx->read_count = 0;
 	ctx->retval = ERROR_OK;
@@ -516,7 +568,7 @@ void mpsse_clock_data(struct mpsse_ctx *ctx, const uint8_t *out, unsigned out_of
 		/* Guarantee buffer space enough for a minimum size transfer */
 		if (buffer_write_space(ctx) + (length < 8) < (out || (!out && !in) ? 4 : 3)
 				|| (in && buffer_read_space(ctx) < 1))
-			ctx->retval = mpsse_flush(ctx);
+			ctx->retval = mpsse_submit(ctx);
 
 		if (length < 8) {
 			/* Transfer remaining bits in bit mode */
@@ -590,7 +642,7 @@ void mpsse_clock_tms_cs(struct mpsse_ctx *ctx, const uint8_t *out, unsigned out_
 	while (length > 0) {
 		/* Guarantee buffer space enough for a minimum size transfer */
 		if (buffer_write_space(ctx) < 3 || (in && buffer_read_space(ctx) < 1))
-			ctx->retval = mpsse_flush(ctx);
+			ctx->retval = mpsse_submit(ctx);
 
 		/* Byte transfer */
 		unsigned this_bits = length;
@@ -623,6 +675,26 @@ void mpsse_clock_tms_cs(struct mpsse_ctx *ctx, const uint8_t *out, unsigned out_
 	}
 }
 
+void mpsse_queue_commands(struct mpsse_ctx *ctx, const uint8_t *cmds, unsigned cmd_len, uint8_t *in,
+	unsigned in_len)
+{
+	LOG_DEBUG_IO("%d bytes, read %d", cmd_len, in_len);
+
+	if (ctx->retval != ERROR_OK) {
+		LOG_DEBUG_IO("Ignoring command due to previous error");
+		return;
+	}
+
+	assert(cmd_len < ctx->write_size && in_len <= ctx->read_size);
+	if (buffer_write_space(ctx) < cmd_len || buffer_read_space(ctx) < in_len)
+		ctx->retval = mpsse_submit(ctx);
+
+	memcpy(ctx->write_buffer + ctx->write_count, cmds, cmd_len);
+	ctx->write_count += cmd_len;
+	if (in_len)
+		buffer_add_read(ctx, in, 0, in_len * 8, 0);
+}
+
 void mpsse_set_data_bits_low_byte(struct mpsse_ctx *ctx, uint8_t data, uint8_t dir)
 {
 	LOG_DEBUG_IO("-");
@@ -633,7 +705,7 @@ void mpsse_set_data_bits_low_byte(struct mpsse_ctx *ctx, uint8_t data, uint8_t d
 	}
 
 	if (buffer_write_space(ctx) < 3)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_submit(ctx);
 
 	buffer_write_byte(ctx, 0x80);
 	buffer_write_byte(ctx, data);
@@ -650,7 +722,7 @@ void mpsse_set_data_bits_high_byte(struct mpsse_ctx *ctx, uint8_t data, uint8_t
 	}
 
 	if (buffer_write_space(ctx) < 3)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_submit(ctx);
 
 	buffer_write_byte(ctx, 0x82);
 	buffer_write_byte(ctx, data);
@@ -667,7 +739,7 @@ void mpsse_read_data_bits_low_byte(struct mpsse_ctx *ctx, uint8_t *data)
 	}
 
 	if (buffer_write_space(ctx) < 1 || buffer_read_space(ctx) < 1)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_submit(ctx);
 
 	buffer_write_byte(ctx, 0x81);
 	buffer_add_read(ctx, data, 0, 8, 0);
@@ -683,7 +755,7 @@ void mpsse_read_data_bits_high_byte(struct mpsse_ctx *ctx, uint8_t *data)
 	}
 
 	if (buffer_write_space(ctx) < 1 || buffer_read_space(ctx) < 1)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_submit(ctx);
 
 	buffer_write_byte(ctx, 0x83);
 	buffer_add_read(ctx, data, 0, 8, 0);
@@ -698,7 +770,7 @@ static void single_byte_boolean_helper(struct mpsse_ctx *ctx, bool var, uint8_t
 	}
 
 	if (buffer_write_space(ctx) < 1)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_submit(ctx);
 
 	buffer_write_byte(ctx, var ? val_if_true : val_if_false);
 }
@@ -719,7 +791,7 @@ void mpsse_set_divisor(struct mpsse_ctx *ctx, uint16_t divisor)
 	}
 
 	if (buffer_write_space(ctx) < 3)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_submit(ctx);
 
 	buffer_write_byte(ctx, 0x86);
 	buffer_write_byte(ctx, divisor & 0xff);
@@ -779,121 +851,101 @@ int mpsse_set_frequency(struct mpsse_ctx *ctx, int frequency)
 	return frequency;
 }
 
-/* Context needed by the callbacks */
-struct transfer_result {
-	struct mpsse_ctx *ctx;
-	bool done;
-	unsigned transferred;
-};
+static bool buffer_done(struct mpsse_buffer *buf)
+{
+	return buf->write_done
+		&& (buf->read_transferred == buf->read_count || !buf->ctx->read_active);
+}
+
+/* Skip the pending buffers whose read data is complete, return false if none is left */
+static bool read_cb_next_buffer(struct mpsse_ctx *ctx, unsigned *idx, unsigned *left)
+{
+	while (*left > 0) {
+		struct mpsse_buffer *buf = &ctx->ring[*idx];
+		if (buf->read_transferred < buf->read_count)
+			return true;
+		*idx = (*idx + 1) % MPSSE_RING_SIZE;
+		(*left)--;
+	}
+	return false;
+}
 
 static LIBUSB_CALL void read_cb(struct libusb_transfer *transfer)
 {
-	struct transfer_result *res = transfer->user_data;
-	struct mpsse_ctx *ctx = res->ctx;
+	struct mpsse_ctx *ctx = transfer->user_data;
 
 	unsigned packet_size = ctx->max_packet_size;
 
 	DEBUG_PRINT_BUF(transfer->buffer, transfer->actual_length);
 
 	/* Strip the two status bytes sent at the beginning of each USB packet
-	 * while copying the chunk buffer to the read buffer */
+	 * while copying the chunk buffer to the read buffers of the pending
+	 * command buffers, oldest first */
 	unsigned num_packets = DIV_ROUND_UP(transfer->actual_length, packet_size);
 	unsigned chunk_remains = transfer->actual_length;
+	unsigned idx = ctx->ring_get;
+	unsigned left = ctx->ring_count;
 	for (unsigned i = 0; i < num_packets && chunk_remains > 2; i++) {
 		unsigned this_size = packet_size - 2;
 		if (this_size > chunk_remains - 2)
 			this_size = chunk_remains - 2;
-		if (this_size > ctx->read_count - res->transferred)
-			this_size = ctx->read_count - res->transferred;
-		memcpy(ctx->read_buffer + res->transferred,
-			ctx->read_chunk + packet_size * i + 2,
-			this_size);
-		res->transferred += this_size;
 		chunk_remains -= this_size + 2;
-		if (res->transferred == ctx->read_count) {
-			res->done = true;
-			break;
+
+		const uint8_t *data = ctx->read_chunk + packet_size * i + 2;
+		while (this_size > 0 && read_cb_next_buffer(ctx, &idx, &left)) {
+			struct mpsse_buffer *buf = &ctx->ring[idx];
+			unsigned size = MIN(this_size, buf->read_count - buf->read_transferred);
+			memcpy(buf->read_buffer + buf->read_transferred, data, size);
+			buf->read_transferred += size;
+			data += size;
+			this_size -= size;
 		}
 	}
+	read_cb_next_buffer(ctx, &idx, &left);
 
-	LOG_DEBUG_IO("raw chunk %d, transferred %d of %d", transfer->actual_length, res->transferred,
-		ctx->read_count);
+	LOG_DEBUG_IO("raw chunk %d, %u buffers waiting for data", transfer->actual_length, left);
 
-	if (!res->done)
-		if (libusb_submit_transfer(transfer) != LIBUSB_SUCCESS)
-			res->done = true;
+	/* Keep reading while some pending buffer is waiting for data */
+	ctx->read_active = false;
+	if (left == 0 || transfer->status == LIBUSB_TRANSFER_CANCELLED)
+		return;
+	if (libusb_submit_transfer(transfer) == LIBUSB_SUCCESS)
+		ctx->read_active = true;
 }
 
 static LIBUSB_CALL void write_cb(struct libusb_transfer *transfer)
 {
-	struct transfer_result *res = transfer->user_data;
-	struct mpsse_ctx *ctx = res->ctx;
+	struct mpsse_buffer *buf = transfer->user_data;
 
-	res->transferred += transfer->actual_length;
+	buf->write_transferred += transfer->actual_length;
 
-	LOG_DEBUG_IO("transferred %d of %d", res->transferred, ctx->write_count);
+	LOG_DEBUG_IO("transferred %d of %d", buf->write_transferred, buf->write_count);
 
 	DEBUG_PRINT_BUF(transfer->buffer, transfer->actual_length);
 
-	if (res->transferred == ctx->write_count)
-		res->done = true;
+	if (buf->write_transferred == buf->write_count
+			|| transfer->status == LIBUSB_TRANSFER_CANCELLED)
+		buf->write_done = true;
 	else {
-		transfer->length = ctx->write_count - res->transferred;
-		transfer->buffer = ctx->write_buffer + res->transferred;
+		transfer->length = buf->write_count - buf->write_transferred;
+		transfer->buffer = buf->write_buffer + buf->write_transferred;
 		if (libusb_submit_transfer(transfer) != LIBUSB_SUCCESS)
-			res->done = true;
+			buf->write_done = true;
 	}
 }
 
-int mpsse_flush(struct mpsse_ctx *ctx)
+/* Wait for the oldest pending buffer, then hand its read data to the caller */
+static int mpsse_complete(struct mpsse_ctx *ctx)
 {
-	int retval = ctx->retval;
-
-	if (retval != ERROR_OK) {
-		LOG_DEBUG_IO("Ignoring flush due to previous error");
-		assert(ctx->write_count == 0 && ctx->read_count == 0);
-		ctx->retval = ERROR_OK;
-		return retval;
-	}
-
-	LOG_DEBUG_IO("write %d%s, read %d", ctx->write_count, ctx->read_count ? "+1" : "",
-			ctx->read_count);
-	assert(ctx->write_count > 0 || ctx->read_count == 0); /* No read data without write data */
-
-	if (ctx->write_count == 0)
-		return retval;
-
-	struct libusb_transfer *read_transfer = NULL;
-	struct transfer_result read_result = { .ctx = ctx, .done = true };
-	if (ctx->read_count) {
-		buffer_write_byte(ctx, 0x87); /* SEND_IMMEDIATE */
-		read_result.done = false;
-		/* delay read transaction to ensure the FTDI chip can support us with data
-		   immediately after processing the MPSSE commands in the write transaction */
-	}
+	struct mpsse_buffer *buf = &ctx->ring[ctx->ring_get];
+	int retval = LIBUSB_SUCCESS;
 
-	struct transfer_result write_result = { .ctx = ctx, .done = false };
-	struct libusb_transfer *write_transfer = libusb_alloc_transfer(0);
-	libusb_fill_bulk_transfer(write_transfer, ctx->usb_dev, ctx->out_ep, ctx->write_buffer,
-		ctx->write_count, write_cb, &write_result, ctx->usb_write_timeout);
-	retval = libusb_submit_transfer(write_transfer);
-	if (retval != LIBUSB_SUCCESS)
-		goto error_check;
-
-	if (ctx->read_count) {
-		read_transfer = libusb_alloc_transfer(0);
-		libusb_fill_bulk_transfer(read_transfer, ctx->usb_dev, ctx->in_ep, ctx->read_chunk,
-			ctx->read_chunk_size, read_cb, &read_result,
-			ctx->usb_read_timeout);
-		retval = libusb_submit_transfer(read_transfer);
-		if (retval != LIBUSB_SUCCESS)
-			goto error_check;
-	}
+	assert(ctx->ring_count > 0 && buf->pending);
 
 	/* Polling loop, more or less taken from libftdi */
 	int64_t start = timeval_ms();
 	int64_t warn_after = 2000;
-	while (!write_result.done || !read_result.done) {
+	while (!buffer_done(buf)) {
 		struct timeval timeout_usb;
 
 		timeout_usb.tv_sec = 1;
@@ -913,43 +965,190 @@ int mpsse_flush(struct mpsse_ctx *ctx)
 			continue;
 
 		if (retval != LIBUSB_SUCCESS) {
-			libusb_cancel_transfer(write_transfer);
-			if (read_transfer)
-				libusb_cancel_transfer(read_transfer);
+			libusb_cancel_transfer(buf->write_transfer);
+			if (ctx->read_active)
+				libusb_cancel_transfer(ctx->read_transfer);
 		}
 	}
 
-error_check:
 	if (retval != LIBUSB_SUCCESS) {
 		LOG_ERROR("libusb_handle_events() failed with %s", libusb_error_name(retval));
 		retval = ERROR_FAIL;
-	} else if (write_result.transferred < ctx->write_count) {
+	} else if (buf->write_transferred < buf->write_count) {
 		LOG_ERROR("ftdi device did not accept all data: %d, tried %d",
-			write_result.transferred,
-			ctx->write_count);
+			buf->write_transferred,
+			buf->write_count);
 		retval = ERROR_FAIL;
-	} else if (read_result.transferred < ctx->read_count) {
+	} else if (buf->read_transferred < buf->read_count) {
 		LOG_ERROR("ftdi device did not return all data: %d, expected %d",
-			read_result.transferred,
-			ctx->read_count);
+			buf->read_transferred,
+			buf->read_count);
 		retval = ERROR_FAIL;
-	} else if (ctx->read_count) {
-		ctx->write_count = 0;
-		ctx->read_count = 0;
-		bit_copy_execute(&ctx->read_queue);
-		retval = ERROR_OK;
 	} else {
-		ctx->write_count = 0;
-		bit_copy_discard(&ctx->read_queue);
 		retval = ERROR_OK;
 	}
 
-	if (retval != ERROR_OK)
+	if (retval == ERROR_OK)
+		bit_copy_execute(&buf->read_queue);
+	else
+		bit_copy_discard(&buf->read_queue);
+
+	buf->pending = false;
+	ctx->ring_get = (ctx->ring_get + 1) % MPSSE_RING_SIZE;
+	ctx->ring_count--;
+
+	return retval;
+}
+
+/* Cancel the pending buffers and wait for libusb to give their transfers back */
+static void mpsse_cancel_all(struct mpsse_ctx *ctx)
+{
+	if (!ctx->ring_count)
+		return;
+
+	for (unsigned int i = 0; i < MPSSE_RING_SIZE; i++)
+		if (ctx->ring[i].pending && !ctx->ring[i].write_done)
+			libusb_cancel_transfer(ctx->ring[i].write_transfer);
+	if (ctx->read_active)
+		libusb_cancel_transfer(ctx->read_transfer);
+
+	while (ctx->ring_count) {
+		struct mpsse_buffer *buf = &ctx->ring[ctx->ring_get];
+
+		while (!buf->write_done || ctx->read_active) {
+			struct timeval timeout_usb = { .tv_sec = 1, .tv_usec = 0 };
+			int retval = libusb_handle_events_timeout_completed(ctx->usb_ctx, &timeout_usb, NULL);
+			if (retval != LIBUSB_SUCCESS && retval != LIBUSB_ERROR_INTERRUPTED)
+				break;
+		}
+		bit_copy_discard(&buf->read_queue);
+		buf->pending = false;
+		ctx->ring_get = (ctx->ring_get + 1) % MPSSE_RING_SIZE;
+		ctx->ring_count--;
+	}
+
+	ctx->ring_put = ctx->ring_get;
+	ctx->write_buffer = ctx->ring[ctx->ring_put].write_buffer;
+	ctx->read_buffer = ctx->ring[ctx->ring_put].read_buffer;
+}
+
+/* Hand the buffered commands to the device without waiting for them to
+ * complete, then continue in the next buffer of the ring. This only waits
+ * when the whole ring is pending. */
+static int mpsse_submit(struct mpsse_ctx *ctx)
+{
+	if (ctx->write_count == 0)
+		return ERROR_OK;
+
+	struct mpsse_buffer *buf = &ctx->ring[ctx->ring_put];
+	assert(!buf->pending && buf->write_buffer == ctx->write_buffer);
+
+	if (ctx->read_count)
+		buffer_write_byte(ctx, 0x87); /* SEND_IMMEDIATE */
+
+	buf->write_count = ctx->write_count;
+	buf->write_transferred = 0;
+	buf->write_done = false;
+	buf->read_count = ctx->read_count;
+	buf->read_transferred = 0;
+	list_splice_init(&ctx->read_queue.list, &buf->read_queue.list);
+
+	libusb_fill_bulk_transfer(buf->write_transfer, ctx->usb_dev, ctx->out_ep, buf->write_buffer,
+		buf->write_count, write_cb, buf, ctx->usb_write_timeout);
+	int retval = libusb_submit_transfer(buf->write_transfer);
+	if (retval != LIBUSB_SUCCESS) {
+		LOG_ERROR("libusb_submit_transfer() failed with %s", libusb_error_name(retval));
+		bit_copy_discard(&buf->read_queue);
 		mpsse_purge(ctx);
+		return ERROR_FAIL;
+	}
+
+	buf->pending = true;
+	ctx->ring_count++;
+	ctx->ring_put = (ctx->ring_put + 1) % MPSSE_RING_SIZE;
+	ctx->write_count = 0;
+	ctx->read_count = 0;
+	ctx->write_buffer = ctx->ring[ctx->ring_put].write_buffer;
+	ctx->read_buffer = ctx->ring[ctx->ring_put].read_buffer;
+
+	/* delay read transaction to ensure the FTDI chip can support us with data
+	   immediately after processing the MPSSE commands in the write transaction */
+	if (buf->read_count && !ctx->read_active) {
+		libusb_fill_bulk_transfer(ctx->read_transfer, ctx->usb_dev, ctx->in_ep, ctx->read_chunk,
+			ctx->read_chunk_size, read_cb, ctx, ctx->usb_read_timeout);
+		retval = libusb_submit_transfer(ctx->read_transfer);
+		if (retval != LIBUSB_SUCCESS) {
+			LOG_ERROR("libusb_submit_transfer() failed with %s", libusb_error_name(retval));
+			mpsse_purge(ctx);
+			return ERROR_FAIL;
+		}
+		ctx->read_active = true;
+	}
+
+	if (ctx->ring_count == MPSSE_RING_SIZE) {
+		retval = mpsse_complete(ctx);
+		if (retval != ERROR_OK) {
+			mpsse_purge(ctx);
+			return retval;
+		}
+	}
+
+	return ERROR_OK;
+}
+
+static bool mpsse_read_pending(struct mpsse_ctx *ctx)
+{
+	if (ctx->read_count)
+		return true;
+
+	for (unsigned int i = 0; i < MPSSE_RING_SIZE; i++)
+		if (ctx->ring[i].pending && ctx->ring[i].read_count)
+			return true;
+
+	return false;
+}
+
+int mpsse_flush(struct mpsse_ctx *ctx)
+{
+	int retval = ctx->retval;
+
+	if (retval != ERROR_OK) {
+		LOG_DEBUG_IO("Ignoring flush due to previous error");
+		assert(ctx->write_count == 0 && ctx->read_count == 0);
+		ctx->retval = ERROR_OK;
+		return retval;
+	}
+
+	LOG_DEBUG_IO("write %d%s, read %d, %u pending", ctx->write_count, ctx->read_count ? "+1" : "",
+			ctx->read_count, ctx->ring_count);
+	assert(ctx->write_count > 0 || ctx->read_count == 0); /* No read data without write data */
+
+	retval = mpsse_submit(ctx);
 
-	libusb_free_transfer(write_transfer);
-	if (read_transfer)
-		libusb_free_transfer(read_transfer);
+	while (retval == ERROR_OK && ctx->ring_count) {
+		retval = mpsse_complete(ctx);
+		if (retval != ERROR_OK)
+			mpsse_purge(ctx);
+	}
 
 	return retval;
 }
+
+int mpsse_flush_async(struct mpsse_ctx *ctx)
+{
+	if (ctx->retval != ERROR_OK)
+		return mpsse_flush(ctx);
+
+	LOG_DEBUG_IO("submit %d, read %d, %u pending", ctx->write_count, ctx->read_count,
+			ctx->ring_count);
+
+	return mpsse_submit(ctx);
+}
+
+int mpsse_flush_posted(struct mpsse_ctx *ctx)
+{
+	if (mpsse_read_pending(ctx))
+		return mpsse_flush(ctx);
+
+	return mpsse_flush_async(ctx);
+}
@@ -54,6 +54,10 @@ void mpsse_clock_tms_cs_out(struct mpsse_ctx *ctx, const uint8_t *out, unsigned
 			   unsigned length, bool tdi, uint8_t mode);
 void mpsse_clock_tms_cs(struct mpsse_ctx *ctx, const uint8_t *out, unsigned out_offset, uint8_t *in,
 		       unsigned in_offset, unsigned length, bool tdi, uint8_t mode);
+/* Queue MPSSE commands prepared by the caller. They must make the device return exactly in_len
+ * bytes, which are copied to in after the following mpsse_flush(). */
+void mpsse_queue_commands(struct mpsse_ctx *ctx, const uint8_t *cmds, unsigned cmd_len, uint8_t *in,
+			 unsigned in_len);
 void mpsse_set_data_bits_low_byte(struct mpsse_ctx *ctx, uint8_t data, uint8_t dir);
 void mpsse_set_data_bits_high_byte(struct mpsse_ctx *ctx, uint8_t data, uint8_t dir);
 void mpsse_read_data_bits_low_byte(struct mpsse_ctx *ctx, uint8_t *data);
@@ -69,6 +73,13 @@ int mpsse_set_frequency(struct mpsse_ctx *ctx, int frequency);
 
 /* Queue handling */
 int mpsse_flush(struct mpsse_ctx *ctx);
+/* Like mpsse_flush(), but when no read data is expected only hands the commands to the device,
+ * so it keeps executing them while the next ones are queued. Errors are then reported by a later
+ * flush. */
+int mpsse_flush_posted(struct mpsse_ctx *ctx);
+/* Hand the commands to the device and return, also when read data is expected. The read data
+ * is copied to the caller's buffers, and errors are reported, by the next mpsse_flush(). */
+int mpsse_flush_async(struct mpsse_ctx *ctx);
 void mpsse_purge(struct mpsse_ctx *ctx);
 
 #endif /* OPENOCD_JTAG_DRIVERS_MPSSE_H */
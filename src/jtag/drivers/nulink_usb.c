@@ -941,6 +941,85 @@ static int nulink_usb_write_mem(void *handle, uint32_t addr, uint32_t size,
 	return retval;
 }
 
+/* Entries of one CMD_WRITE_REG or CMD_WRITE_RAM command, as in nulink_usb_read_mem32() */
+#define NULINK_QUEUE_MAX_ENTRIES 3
+
+static int nulink_usb_run_queue_cmd(void *handle, uint32_t cmd_id,
+		const struct hl_queue_entry *queue, unsigned int count)
+{
+	struct nulink_usb_handle *h = handle;
+	uint8_t read_old = 0;
+
+	for (unsigned int i = 0; i < count; i++)
+		if (queue[i].op != HL_QUEUE_WRITE_DEBUG_REG)
+			read_old |= BIT(i);
+
+	nulink_usb_init_buffer(handle, 8 + 12 * count);
+	/* set command ID */
+	h_u32_to_le(h->cmdbuf + h->cmdidx, cmd_id);
+	h->cmdidx += 4;
+	/* Count of registers */
+	h->cmdbuf[h->cmdidx] = count;
+	h->cmdidx += 1;
+	/* Array of bool value (u8ReadOld) */
+	h->cmdbuf[h->cmdidx] = read_old;
+	h->cmdidx += 1;
+	/* Array of bool value (u8Verify) */
+	h->cmdbuf[h->cmdidx] = 0x00;
+	h->cmdidx += 1;
+	/* ignore */
+	h->cmdbuf[h->cmdidx] = 0;
+	h->cmdidx += 1;
+
+	for (unsigned int i = 0; i < count; i++) {
+		bool write = queue[i].op == HL_QUEUE_WRITE_DEBUG_REG;
+		/* u32Addr */
+		h_u32_to_le(h->cmdbuf + h->cmdidx, queue[i].addr);
+		h->cmdidx += 4;
+		/* u32Data */
+		h_u32_to_le(h->cmdbuf + h->cmdidx, write ? queue[i].val : 0);
+		h->cmdidx += 4;
+		/* u32Mask, the bits kept */
+		h_u32_to_le(h->cmdbuf + h->cmdidx, write ? 0x00000000UL : 0xFFFFFFFFUL);
+		h->cmdidx += 4;
+	}
+
+	int res = nulink_usb_xfer(handle, h->databuf, 4 * count * 2);
+	if (res != ERROR_OK)
+		return res;
+
+	for (unsigned int i = 0; i < count; i++)
+		if (queue[i].op != HL_QUEUE_WRITE_DEBUG_REG)
+			*queue[i].dst = le_to_h_u32(h->databuf + 4 * (2 * i + 1));
+
+	return ERROR_OK;
+}
+
+/* Core register reads go in CMD_WRITE_REG commands, memory accesses in
+ * CMD_WRITE_RAM commands, each carrying up to NULINK_QUEUE_MAX_ENTRIES */
+static int nulink_usb_run_queue(void *handle, const struct hl_queue_entry *queue,
+		unsigned int count)
+{
+	assert(handle);
+
+	for (unsigned int i = 0; i < count; ) {
+		bool reg = queue[i].op == HL_QUEUE_READ_REG;
+		unsigned int n = 1;
+
+		while (i + n < count && n < NULINK_QUEUE_MAX_ENTRIES &&
+				(queue[i + n].op == HL_QUEUE_READ_REG) == reg)
+			n++;
+
+		int res = nulink_usb_run_queue_cmd(handle, reg ? CMD_WRITE_REG : CMD_WRITE_RAM,
+				&queue[i], n);
+		if (res != ERROR_OK)
+			return res;
+		i += n;
+	}
+
+	return ERROR_OK;
+}
+
 static int nulink_usb_override_target(const char *targetname)
 {
 	LOG_DEBUG("nulink_usb_override_target");
@@ -1171,4 +1250,5 @@ struct hl_layout_api nulink_usb_layout_api = {
 	.write_debug_reg = nulink_usb_write_debug_reg,
 	.override_target = nulink_usb_override_target,
 	.speed = nulink_speed,
+	.run_queue = nulink_usb_run_queue,
 };
@@ -18,12 +18,26 @@
 #endif
 #include "helper/system.h"
 #include "helper/replacements.h"
+#include <helper/binarybuffer.h>
 #include <jtag/interface.h>
 #include "bitbang.h"
 
 /* arbitrary limit on host name length: */
 #define REMOTE_BITBANG_HOST_MAX 255
 
+/* Requests of the binary protocol extension */
+#define REMOTE_BITBANG_QUERY		'X'	/* reply: 'X', capabilities */
+#define REMOTE_BITBANG_SHIFT		'J'	/* bits, tms, tdi; reply: tdo */
+#define REMOTE_BITBANG_SHIFT_OUT	'j'	/* bits, tms, tdi */
+#define REMOTE_BITBANG_SWD_OUT		'W'	/* bits, swdio[] */
+#define REMOTE_BITBANG_SWD_IN		'w'	/* bits; reply: swdio[] */
+
+/* Capabilities reported in the reply to REMOTE_BITBANG_QUERY */
+#define REMOTE_BITBANG_CAP_SHIFT	BIT(0)
+#define REMOTE_BITBANG_CAP_SWD		BIT(1)
+
+#define REMOTE_BITBANG_SWD_MAX_BITS	64
+
 static char *remote_bitbang_host;
 static char *remote_bitbang_port;
 
@@ -32,6 +46,7 @@ static uint8_t remote_bitbang_send_buf[512];
 static unsigned int remote_bitbang_send_buf_used;
 
 static bool use_remote_sleep;
+static bool use_binary_protocol;
 
 /* Circular buffer. When start == end, the buffer is empty. */
 static char remote_bitbang_recv_buf[256];
@@ -50,6 +65,17 @@ static bool remote_bitbang_recv_buf_empty(void)
 	return remote_bitbang_recv_buf_start == remote_bitbang_recv_buf_end;
 }
 
+static unsigned int remote_bitbang_recv_buf_used(void)
+{
+	return (remote_bitbang_recv_buf_end + sizeof(remote_bitbang_recv_buf) -
+		remote_bitbang_recv_buf_start) % sizeof(remote_bitbang_recv_buf);
+}
+
+/* Destinations of the TDO bytes requested by REMOTE_BITBANG_SHIFT, not
+ * received yet. Limited like the number of outstanding 'R' requests. */
+static uint8_t *remote_bitbang_tdo_pending[sizeof(remote_bitbang_recv_buf) - 1];
+static unsigned int remote_bitbang_tdo_pending_count;
+
 static unsigned int remote_bitbang_recv_buf_contiguous_available_space(void)
 {
 	if (remote_bitbang_recv_buf_end >= remote_bitbang_recv_buf_start) {
@@ -198,16 +224,44 @@ static int remote_bitbang_sample(void)
 	return remote_bitbang_queue('R', NO_FLUSH);
 }
 
-static bb_value_t remote_bitbang_read_sample(void)
+/* Return the next received byte, waiting for it if needed, or -1 on error. */
+static int remote_bitbang_recv_byte(void)
 {
 	if (remote_bitbang_recv_buf_empty()) {
 		if (remote_bitbang_fill_buf(BLOCK) != ERROR_OK)
-			return BB_ERROR;
+			return -1;
 	}
 	assert(!remote_bitbang_recv_buf_empty());
-	int c = remote_bitbang_recv_buf[remote_bitbang_recv_buf_start];
+	uint8_t c = remote_bitbang_recv_buf[remote_bitbang_recv_buf_start];
 	remote_bitbang_recv_buf_start =
 		(remote_bitbang_recv_buf_start + 1) % sizeof(remote_bitbang_recv_buf);
+	return c;
+}
+
+static int remote_bitbang_collect_tdo(void)
+{
+	unsigned int count = remote_bitbang_tdo_pending_count;
+
+	remote_bitbang_tdo_pending_count = 0;
+	for (unsigned int i = 0; i < count; i++) {
+		int c = remote_bitbang_recv_byte();
+		if (c < 0)
+			return ERROR_FAIL;
+		*remote_bitbang_tdo_pending[i] = c;
+	}
+
+	return ERROR_OK;
+}
+
+static bb_value_t remote_bitbang_read_sample(void)
+{
+	/* replies arrive in request order */
+	if (remote_bitbang_tdo_pending_count && remote_bitbang_collect_tdo() != ERROR_OK)
+		return BB_ERROR;
+
+	int c = remote_bitbang_recv_byte();
+	if (c < 0)
+		return BB_ERROR;
 	return char_to_int(c);
 }
 
@@ -217,6 +271,34 @@ static int remote_bitbang_write(int tck, int tms, int tdi)
 	return remote_bitbang_queue(c, NO_FLUSH);
 }
 
+static int remote_bitbang_shift(uint8_t tms, uint8_t tdi, unsigned int bits, uint8_t *tdo)
+{
+	if (tdo) {
+		if (remote_bitbang_tdo_pending_count == ARRAY_SIZE(remote_bitbang_tdo_pending) &&
+				remote_bitbang_collect_tdo() != ERROR_OK)
+			return ERROR_FAIL;
+		/* keep the replies flowing, as for remote_bitbang_sample() */
+		if (remote_bitbang_fill_buf(NO_BLOCK) != ERROR_OK)
+			return ERROR_FAIL;
+		remote_bitbang_tdo_pending[remote_bitbang_tdo_pending_count++] = tdo;
+	}
+
+	if (remote_bitbang_queue(tdo ? REMOTE_BITBANG_SHIFT : REMOTE_BITBANG_SHIFT_OUT,
+			NO_FLUSH) != ERROR_OK ||
+			remote_bitbang_queue(bits, NO_FLUSH) != ERROR_OK ||
+			remote_bitbang_queue(tms, NO_FLUSH) != ERROR_OK)
+		return ERROR_FAIL;
+	return remote_bitbang_queue(tdi, NO_FLUSH);
+}
+
+/* Send the queued requests and wait for the outstanding TDO samples. */
+static int remote_bitbang_sync(void)
+{
+	if (remote_bitbang_tdo_pending_count)
+		return remote_bitbang_collect_tdo();
+	return remote_bitbang_flush();
+}
+
 static int remote_bitbang_reset(int trst, int srst)
 {
 	char c = 'r' + ((trst ? 0x2 : 0x0) | (srst ? 0x1 : 0x0));
@@ -278,6 +360,44 @@ static int remote_bitbang_swd_write(int swclk, int swdio)
 	return remote_bitbang_queue(c, NO_FLUSH);
 }
 
+static int remote_bitbang_swd_exchange(bool rnw, uint8_t *buf, unsigned int offset,
+		unsigned int bit_cnt)
+{
+	while (bit_cnt) {
+		unsigned int bits = MIN(bit_cnt, REMOTE_BITBANG_SWD_MAX_BITS);
+		unsigned int bytes = DIV_ROUND_UP(bits, 8);
+		uint8_t data[DIV_ROUND_UP(REMOTE_BITBANG_SWD_MAX_BITS, 8)] = { 0 };
+
+		if (rnw && buf) {
+			if (remote_bitbang_queue(REMOTE_BITBANG_SWD_IN, NO_FLUSH) != ERROR_OK ||
+					remote_bitbang_queue(bits, NO_FLUSH) != ERROR_OK)
+				return ERROR_FAIL;
+			for (unsigned int i = 0; i < bytes; i++) {
+				int c = remote_bitbang_recv_byte();
+				if (c < 0)
+					return ERROR_FAIL;
+				data[i] = c;
+			}
+			buf_set_buf(data, 0, buf, offset, bits);
+		} else {
+			/* SWDIO is not driven while reading, send zeros as swd_write() does */
+			if (!rnw)
+				buf_set_buf(buf, offset, data, 0, bits);
+			if (remote_bitbang_queue(REMOTE_BITBANG_SWD_OUT, NO_FLUSH) != ERROR_OK ||
+					remote_bitbang_queue(bits, NO_FLUSH) != ERROR_OK)
+				return ERROR_FAIL;
+			for (unsigned int i = 0; i < bytes; i++)
+				if (remote_bitbang_queue(data[i], NO_FLUSH) != ERROR_OK)
+					return ERROR_FAIL;
+		}
+
+		offset += bits;
+		bit_cnt -= bits;
+	}
+
+	return ERROR_OK;
+}
+
 static struct bitbang_interface remote_bitbang_bitbang = {
 	.buf_size = sizeof(remote_bitbang_recv_buf) - 1,
 	.sample = &remote_bitbang_sample,
@@ -288,7 +408,7 @@ static struct bitbang_interface remote_bitbang_bitbang = {
 	.swd_write = &remote_bitbang_swd_write,
 	.blink = &remote_bitbang_blink,
 	.sleep = &remote_bitbang_sleep,
-	.flush = &remote_bitbang_flush,
+	.flush = &remote_bitbang_sync,
 };
 
 static int remote_bitbang_init_tcp(void)
@@ -368,6 +488,53 @@ static int remote_bitbang_init_unix(void)
 	return fd;
 }
 
+/* Enable the binary requests the remote supports; keep ASCII otherwise. */
+static int remote_bitbang_negotiate(void)
+{
+	remote_bitbang_bitbang.shift = NULL;
+	remote_bitbang_bitbang.swd_exchange = NULL;
+
+	if (remote_bitbang_queue(REMOTE_BITBANG_QUERY, FLUSH_SEND_BUF) != ERROR_OK)
+		return ERROR_FAIL;
+
+	/* a remote without the extension may never answer */
+	while (remote_bitbang_recv_buf_used() < 2) {
+		fd_set rfds;
+		struct timeval tv = { .tv_sec = 1 };
+
+		FD_ZERO(&rfds);
+		FD_SET(remote_bitbang_fd, &rfds);
+		int retval = socket_select(remote_bitbang_fd + 1, &rfds, NULL, NULL, &tv);
+		if (retval < 0) {
+			log_socket_error("remote_bitbang_negotiate");
+			return ERROR_FAIL;
+		}
+		if (retval == 0) {
+			LOG_WARNING("remote_bitbang: no reply to the protocol query, using ASCII protocol");
+			return ERROR_OK;
+		}
+		if (remote_bitbang_fill_buf(NO_BLOCK) != ERROR_OK)
+			return ERROR_FAIL;
+	}
+
+	int c = remote_bitbang_recv_byte();
+	int caps = remote_bitbang_recv_byte();
+	if (c != REMOTE_BITBANG_QUERY || caps < 0) {
+		LOG_ERROR("remote_bitbang: invalid reply to the protocol query");
+		return ERROR_FAIL;
+	}
+
+	if (caps & REMOTE_BITBANG_CAP_SHIFT)
+		remote_bitbang_bitbang.shift = &remote_bitbang_shift;
+	if (caps & REMOTE_BITBANG_CAP_SWD)
+		remote_bitbang_bitbang.swd_exchange = &remote_bitbang_swd_exchange;
+	LOG_INFO("remote_bitbang: binary requests for%s%s",
+			(caps & REMOTE_BITBANG_CAP_SHIFT) ? " JTAG" : "",
+			(caps & REMOTE_BITBANG_CAP_SWD) ? " SWD" : "");
+
+	return ERROR_OK;
+}
+
 static int remote_bitbang_init(void)
 {
 	bitbang_interface = &remote_bitbang_bitbang;
@@ -386,6 +553,10 @@ static int remote_bitbang_init(void)
 
 	socket_nonblock(remote_bitbang_fd);
 
+	remote_bitbang_tdo_pending_count = 0;
+	if (use_binary_protocol && remote_bitbang_negotiate() != ERROR_OK)
+		return ERROR_FAIL;
+
 	LOG_INFO("remote_bitbang driver initialized");
 	return ERROR_OK;
 }
@@ -424,6 +595,16 @@ COMMAND_HANDLER(remote_bitbang_handle_remote_bitbang_use_remote_sleep_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(remote_bitbang_handle_remote_bitbang_use_binary_protocol_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_ON_OFF(CMD_ARGV[0], use_binary_protocol);
+
+	return ERROR_OK;
+}
+
 static const struct command_registration remote_bitbang_subcommand_handlers[] = {
 	{
 		.name = "port",
@@ -449,6 +630,14 @@ static const struct command_registration remote_bitbang_subcommand_handlers[] =
 			"instruction stream for the remote host.",
 		.usage = "(on|off)",
 	},
+	{
+		.name = "use_binary_protocol",
+		.handler = remote_bitbang_handle_remote_bitbang_use_binary_protocol_command,
+		.mode = COMMAND_CONFIG,
+		.help = "Query the remote host for the binary protocol extension "
+			"and use it when available.",
+		.usage = "(on|off)",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -169,6 +169,8 @@ struct stlink_tcp_priv {
 	uint8_t *recv_buf;
 	/** */
 	struct stlink_tcp_version version;
+	/** command in progress, keep_alive() is called while waiting */
+	bool busy;
 };
 
 struct stlink_backend {
@@ -291,6 +293,8 @@ struct stlink_usb_handle {
 	struct dap_queue queue[MAX_QUEUE_DEPTH];
 	/** first element available in the queue */
 	unsigned int queue_index;
+	/** keep the data and the status IN requests of memory reads in flight together */
+	bool pipelined_reads;
 };
 
 /** */
@@ -936,6 +940,7 @@ static int stlink_tcp_send_cmd(void *handle, int send_size, int recv_size, bool
 	uint8_t *recv_buf = h->tcp_backend_priv.recv_buf;
 	const int64_t timeout = timeval_ms() + 1000; /* 1 second */
 
+	h->tcp_backend_priv.busy = true;
 	while (remaining_bytes > 0) {
 		if (timeval_ms() > timeout) {
 			LOG_DEBUG("received size %d (expected %d)", recv_size - remaining_bytes, recv_size);
@@ -955,6 +960,7 @@ static int stlink_tcp_send_cmd(void *handle, int send_size, int recv_size, bool
 		recv_buf += received;
 		remaining_bytes -= received;
 	}
+	h->tcp_backend_priv.busy = false;
 
 	if (retval != ERROR_OK) {
 		LOG_ERROR("failed to receive USB CMD response");
@@ -2109,7 +2115,8 @@ static int stlink_usb_trace_read(void *handle, uint8_t *buf, size_t *size)
 
 	assert(handle);
 
-	if (h->trace.enabled && (h->version.flags & STLINK_F_HAS_TRACE)) {
+	if (h->trace.enabled && (h->version.flags & STLINK_F_HAS_TRACE) &&
+			!h->tcp_backend_priv.busy) {
 		int res;
 
 		stlink_usb_init_buffer(handle, h->rx_ep, 10);
@@ -2463,6 +2470,54 @@ static int stlink_usb_write_reg(void *handle, unsigned int regsel, uint32_t val)
 	return stlink_cmd_allow_retry(handle, h->databuf, 2);
 }
 
+/* READALLREGS returns r0-r15, xPSR, MSP and PSP, in DCRSR.REGSEL order */
+#define STLINK_READALLREGS_NUM          19
+
+/** */
+static int stlink_usb_run_queue(void *handle, const struct hl_queue_entry *queue,
+		unsigned int count)
+{
+	struct stlink_usb_handle *h = handle;
+	unsigned int num_core_regs = 0;
+	bool core_regs_read = false;
+	int res;
+
+	assert(handle);
+
+	for (unsigned int i = 0; i < count; i++)
+		if (queue[i].op == HL_QUEUE_READ_REG && queue[i].addr < STLINK_READALLREGS_NUM)
+			num_core_regs++;
+
+	/* one command for all the core registers */
+	if (num_core_regs > 1) {
+		res = stlink_usb_read_regs(handle);
+		if (res == ERROR_OK) {
+			const uint8_t *regs = h->databuf;
+			if (h->version.jtag_api != STLINK_JTAG_API_V1)
+				regs += 4;
+
+			for (unsigned int i = 0; i < count; i++)
+				if (queue[i].op == HL_QUEUE_READ_REG && queue[i].addr < STLINK_READALLREGS_NUM)
+					*queue[i].dst = le_to_h_u32(regs + 4 * queue[i].addr);
+			core_regs_read = true;
+		} else {
+			LOG_DEBUG("READALLREGS failed, reading the registers one by one");
+		}
+	}
+
+	for (unsigned int i = 0; i < count; i++) {
+		if (core_regs_read && queue[i].op == HL_QUEUE_READ_REG &&
+				queue[i].addr < STLINK_READALLREGS_NUM)
+			continue;
+
+		res = hl_layout_run_queue_entry(&stlink_usb_layout_api, handle, &queue[i]);
+		if (res != ERROR_OK)
+			return res;
+	}
+
+	return ERROR_OK;
+}
+
 static int stlink_usb_get_rw_status(void *handle)
 {
 	struct stlink_usb_handle *h = handle;
@@ -2484,11 +2539,78 @@ static int stlink_usb_get_rw_status(void *handle)
 	}
 }
 
+/**
+ * Complete a memory read command prepared in cmdbuf: fetch @a size bytes
+ * into databuf, copy @a len of them into @a buffer and check the R/W status.
+ * With pipelined reads the status command and both IN requests are queued
+ * together, so the status is not delayed by a second USB round trip.
+ */
+static int stlink_usb_read_mem_xfer(void *handle, int size, uint8_t *buffer, uint16_t len)
+{
+	struct stlink_usb_handle *h = handle;
+	int res;
+
+	assert(handle);
+
+#ifdef USE_LIBUSB_ASYNCIO
+	if (h->pipelined_reads && h->version.stlink != 1 &&
+			h->version.jtag_api != STLINK_JTAG_API_V1) {
+		uint8_t status_cmd[STLINK_CMD_SIZE_V2] = { STLINK_DEBUG_COMMAND };
+		uint8_t status[12];
+		int status_size = 2;
+		struct jtag_xfer transfers[4];
+
+		if (h->version.flags & STLINK_F_HAS_GETLASTRWSTATUS2) {
+			status_cmd[1] = STLINK_DEBUG_APIV2_GETLASTRWSTATUS2;
+			status_size = 12;
+		} else {
+			status_cmd[1] = STLINK_DEBUG_APIV2_GETLASTRWSTATUS;
+		}
+
+		memset(transfers, 0, sizeof(transfers));
+
+		transfers[0].ep = h->tx_ep;
+		transfers[0].buf = h->cmdbuf;
+		transfers[0].size = STLINK_CMD_SIZE_V2;
+
+		transfers[1].ep = h->rx_ep;
+		transfers[1].buf = h->databuf;
+		transfers[1].size = size;
+
+		transfers[2].ep = h->tx_ep;
+		transfers[2].buf = status_cmd;
+		transfers[2].size = STLINK_CMD_SIZE_V2;
+
+		transfers[3].ep = h->rx_ep;
+		transfers[3].buf = status;
+		transfers[3].size = status_size;
+
+		res = jtag_libusb_bulk_transfer_n(h->usb_backend_priv.fd, transfers,
+				ARRAY_SIZE(transfers), STLINK_WRITE_TIMEOUT);
+		if (res != ERROR_OK)
+			return res;
+
+		memcpy(buffer, h->databuf, len);
+		memcpy(h->databuf, status, status_size);
+
+		return stlink_usb_error_check(handle);
+	}
+#endif
+
+	res = stlink_usb_xfer_noerrcheck(handle, h->databuf, size);
+
+	if (res != ERROR_OK)
+		return res;
+
+	memcpy(buffer, h->databuf, len);
+
+	return stlink_usb_get_rw_status(handle);
+}
+
 /** */
 static int stlink_usb_read_mem8(void *handle, uint8_t ap_num, uint32_t csw,
 		uint32_t addr, uint16_t len, uint8_t *buffer)
 {
-	int res;
 	uint16_t read_len = len;
 	struct stlink_usb_handle *h = handle;
 
@@ -2519,14 +2641,7 @@ static int stlink_usb_read_mem8(void *handle, uint8_t ap_num, uint32_t csw,
 	if (read_len == 1)
 		read_len++;
 
-	res = stlink_usb_xfer_noerrcheck(handle, h->databuf, read_len);
-
-	if (res != ERROR_OK)
-		return res;
-
-	memcpy(buffer, h->databuf, len);
-
-	return stlink_usb_get_rw_status(handle);
+	return stlink_usb_read_mem_xfer(handle, read_len, buffer, len);
 }
 
 /** */
@@ -2571,7 +2686,6 @@ static int stlink_usb_write_mem8(void *handle, uint8_t ap_num, uint32_t csw,
 static int stlink_usb_read_mem16(void *handle, uint8_t ap_num, uint32_t csw,
 		uint32_t addr, uint16_t len, uint8_t *buffer)
 {
-	int res;
 	struct stlink_usb_handle *h = handle;
 
 	assert(handle);
@@ -2605,14 +2719,7 @@ static int stlink_usb_read_mem16(void *handle, uint8_t ap_num, uint32_t csw,
 	h_u24_to_le(h->cmdbuf + h->cmdidx, csw >> 8);
 	h->cmdidx += 3;
 
-	res = stlink_usb_xfer_noerrcheck(handle, h->databuf, len);
-
-	if (res != ERROR_OK)
-		return res;
-
-	memcpy(buffer, h->databuf, len);
-
-	return stlink_usb_get_rw_status(handle);
+	return stlink_usb_read_mem_xfer(handle, len, buffer, len);
 }
 
 /** */
@@ -2665,7 +2772,6 @@ static int stlink_usb_write_mem16(void *handle, uint8_t ap_num, uint32_t csw,
 static int stlink_usb_read_mem32(void *handle, uint8_t ap_num, uint32_t csw,
 		uint32_t addr, uint16_t len, uint8_t *buffer)
 {
-	int res;
 	struct stlink_usb_handle *h = handle;
 
 	assert(handle);
@@ -2696,14 +2802,7 @@ static int stlink_usb_read_mem32(void *handle, uint8_t ap_num, uint32_t csw,
 	h_u24_to_le(h->cmdbuf + h->cmdidx, csw >> 8);
 	h->cmdidx += 3;
 
-	res = stlink_usb_xfer_noerrcheck(handle, h->databuf, len);
-
-	if (res != ERROR_OK)
-		return res;
-
-	memcpy(buffer, h->databuf, len);
-
-	return stlink_usb_get_rw_status(handle);
+	return stlink_usb_read_mem_xfer(handle, len, buffer, len);
 }
 
 /** */
@@ -2782,13 +2881,7 @@ static int stlink_usb_read_mem32_noaddrinc(void *handle, uint8_t ap_num, uint32_
 	h_u24_to_le(h->cmdbuf + h->cmdidx, csw >> 8);
 	h->cmdidx += 3;
 
-	int retval = stlink_usb_xfer_noerrcheck(handle, h->databuf, len);
-	if (retval != ERROR_OK)
-		return retval;
-
-	memcpy(buffer, h->databuf, len);
-
-	return stlink_usb_get_rw_status(handle);
+	return stlink_usb_read_mem_xfer(handle, len, buffer, len);
 }
 
 static int stlink_usb_write_mem32_noaddrinc(void *handle, uint8_t ap_num, uint32_t csw,
@@ -3725,6 +3818,9 @@ static struct stlink_backend stlink_tcp_backend = {
 	.read_trace = stlink_tcp_read_trace,
 };
 
+/** queue the status request of memory reads together with the data */
+static bool stlink_pipelined_reads;
+
 static int stlink_open(struct hl_interface_param *param, enum stlink_mode mode, void **fd)
 {
 	struct stlink_usb_handle *h;
@@ -3746,10 +3842,12 @@ static int stlink_open(struct hl_interface_param *param, enum stlink_mode mode,
 			  adapter_get_required_serial() ? adapter_get_required_serial() : "");
 	}
 
-	if (param->use_stlink_tcp)
+	if (param->use_stlink_tcp) {
 		h->backend = &stlink_tcp_backend;
-	else
+	} else {
 		h->backend = &stlink_usb_backend;
+		h->pipelined_reads = stlink_pipelined_reads;
+	}
 
 	if (stlink_usb_open(h, param) != ERROR_OK)
 		goto error_open;
@@ -4072,6 +4170,8 @@ struct hl_layout_api stlink_usb_layout_api = {
 	.config_trace = stlink_config_trace,
 	/** */
 	.poll_trace = stlink_usb_trace_read,
+	/** */
+	.run_queue = stlink_usb_run_queue,
 };
 
 /*****************************************************************************
@@ -4915,47 +5015,19 @@ static int stlink_swim_op_srst(void)
 static int stlink_swim_op_read_mem(uint32_t addr, uint32_t size,
 								   uint32_t count, uint8_t *buffer)
 {
-	int retval;
-	uint32_t bytes_remaining;
-
 	LOG_DEBUG_IO("read at 0x%08" PRIx32 " len %" PRIu32 "*0x%08" PRIx32, addr, size, count);
-	count *= size;
 
-	while (count) {
-		bytes_remaining = (count > STLINK_SWIM_DATA_SIZE) ? STLINK_SWIM_DATA_SIZE : count;
-		retval = stlink_swim_readbytes(stlink_dap_handle, addr, bytes_remaining, buffer);
-		if (retval != ERROR_OK)
-			return retval;
-
-		buffer += bytes_remaining;
-		addr += bytes_remaining;
-		count -= bytes_remaining;
-	}
-
-	return ERROR_OK;
+	/* swim_read_mem() splits at STLINK_SWIM_DATA_SIZE */
+	return stlink_swim_readbytes(stlink_dap_handle, addr, size * count, buffer);
 }
 
 static int stlink_swim_op_write_mem(uint32_t addr, uint32_t size,
 									uint32_t count, const uint8_t *buffer)
 {
-	int retval;
-	uint32_t bytes_remaining;
-
 	LOG_DEBUG_IO("write at 0x%08" PRIx32 " len %" PRIu32 "*0x%08" PRIx32, addr, size, count);
-	count *= size;
-
-	while (count) {
-		bytes_remaining = (count > STLINK_SWIM_DATA_SIZE) ? STLINK_SWIM_DATA_SIZE : count;
-		retval = stlink_swim_writebytes(stlink_dap_handle, addr, bytes_remaining, buffer);
-		if (retval != ERROR_OK)
-			return retval;
 
-		buffer += bytes_remaining;
-		addr += bytes_remaining;
-		count -= bytes_remaining;
-	}
-
-	return ERROR_OK;
+	/* swim_write_mem() splits at STLINK_SWIM_DATA_SIZE */
+	return stlink_swim_writebytes(stlink_dap_handle, addr, size * count, buffer);
 }
 
 static int stlink_swim_op_reconnect(void)
@@ -5072,6 +5144,23 @@ COMMAND_HANDLER(stlink_dap_cmd_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(stlink_dap_pipelined_reads_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		COMMAND_PARSE_ENABLE(CMD_ARGV[0], stlink_pipelined_reads);
+		if (stlink_dap_handle && !stlink_dap_param.use_stlink_tcp)
+			stlink_dap_handle->pipelined_reads = stlink_pipelined_reads;
+	}
+
+	command_print(CMD, "st-link pipelined reads %s",
+		stlink_pipelined_reads ? "enabled" : "disabled");
+
+	return ERROR_OK;
+}
+
 /** */
 static const struct command_registration stlink_dap_subcommand_handlers[] = {
 	{
@@ -5095,6 +5184,14 @@ static const struct command_registration stlink_dap_subcommand_handlers[] = {
 		.help = "send arbitrary command",
 		.usage = "rx_n (tx_byte)+",
 	},
+	{
+		.name = "pipelined_reads",
+		.handler = stlink_dap_pipelined_reads_command,
+		.mode = COMMAND_ANY,
+		.help = "queue the status request of memory reads together with "
+			"the data request",
+		.usage = "[enable|disable]",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -5216,6 +5313,7 @@ static const struct swim_driver stlink_swim_ops = {
 	.read_mem = stlink_swim_op_read_mem,
 	.write_mem = stlink_swim_op_write_mem,
 	.reconnect = stlink_swim_op_reconnect,
+	.max_transfer = STLINK_SWIM_DATA_SIZE,
 };
 
 static const char *const stlink_dap_transport[] = { "dapdirect_swd", "dapdirect_jtag", "swim", NULL };
@@ -633,6 +633,40 @@ static int icdi_usb_write_mem(void *handle, uint32_t addr, uint32_t size,
 	return retval;
 }
 
+/* Words read by a single memory read of icdi_usb_run_queue() */
+#define ICDI_QUEUE_MAX_WORDS 16
+
+/* The ICDI has no command for several registers, but consecutive word reads
+ * are merged in a single memory read */
+static int icdi_usb_run_queue(void *handle, const struct hl_queue_entry *queue,
+		unsigned int count)
+{
+	for (unsigned int i = 0; i < count; ) {
+		unsigned int n = 1;
+		int result;
+
+		if (queue[i].op == HL_QUEUE_READ_U32)
+			while (i + n < count && n < ICDI_QUEUE_MAX_WORDS &&
+					queue[i + n].op == HL_QUEUE_READ_U32 &&
+					queue[i + n].addr == queue[i].addr + 4 * n)
+				n++;
+
+		if (n == 1) {
+			result = hl_layout_run_queue_entry(&icdi_usb_layout_api, handle, &queue[i]);
+		} else {
+			uint8_t buf[4 * ICDI_QUEUE_MAX_WORDS];
+			result = icdi_usb_read_mem(handle, queue[i].addr, 4, n, buf);
+			for (unsigned int j = 0; result == ERROR_OK && j < n; j++)
+				*queue[i + j].dst = le_to_h_u32(buf + 4 * j);
+		}
+		if (result != ERROR_OK)
+			return result;
+		i += n;
+	}
+
+	return ERROR_OK;
+}
+
 static int icdi_usb_override_target(const char *targetname)
 {
 	return !strcmp(targetname, "cortex_m");
@@ -761,4 +795,5 @@ struct hl_layout_api icdi_usb_layout_api = {
 	.write_debug_reg = icdi_usb_write_debug_reg,
 	.override_target = icdi_usb_override_target,
 	.custom_command = icdi_send_remote_cmd,
+	.run_queue = icdi_usb_run_queue,
 };
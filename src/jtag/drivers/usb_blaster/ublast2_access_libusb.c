@@ -29,6 +29,11 @@
 /** Maximum size of a single firmware section. Entire EZ-USB code space = 16kB */
 #define SECTION_BUFFERSIZE		16384
 
+#define USBBLASTER_TIMEOUT_MS		1000
+
+static struct libusb_transfer *write_transfer, *read_transfer;
+static int write_completed, read_completed;
+
 static int ublast2_libusb_read(struct ublast_lowlevel *low, uint8_t *buf,
 			      unsigned size, uint32_t *bytes_read)
 {
@@ -62,6 +67,79 @@ static int ublast2_libusb_write(struct ublast_lowlevel *low, uint8_t *buf,
 
 }
 
+static LIBUSB_CALL void ublast2_libusb_cb(struct libusb_transfer *transfer)
+{
+	int *completed = transfer->user_data;
+
+	*completed = 1;
+}
+
+static int ublast2_libusb_wait(struct libusb_transfer *transfer, int *completed)
+{
+	while (!*completed) {
+		int ret = jtag_libusb_handle_events_completed(completed);
+		if (ret < 0 && ret != LIBUSB_ERROR_INTERRUPTED) {
+			LOG_ERROR("libusb_handle_events() failed with %s", libusb_error_name(ret));
+			libusb_cancel_transfer(transfer);
+		}
+	}
+
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+		LOG_ERROR("usb bulk transfer failed with status %d", transfer->status);
+		return ERROR_JTAG_DEVICE_ERROR;
+	}
+
+	return ERROR_OK;
+}
+
+/*
+ * Write the whole buffer in a single transfer, split in 512 bytes packets
+ * on a high speed link, while the TDO bytes are read back. Keeping the
+ * read submitted avoids a stall of the firmware when its IN endpoint
+ * buffers are full.
+ */
+static int ublast2_libusb_write_read(struct ublast_lowlevel *low, uint8_t *buf,
+				     int size, uint8_t *rbuf, unsigned rsize)
+{
+	unsigned int received = 0;
+	int ret = ERROR_OK;
+
+	write_completed = 0;
+	libusb_fill_bulk_transfer(write_transfer, low->libusb_dev,
+				  USBBLASTER_EPOUT | LIBUSB_ENDPOINT_OUT, buf, size,
+				  ublast2_libusb_cb, &write_completed, USBBLASTER_TIMEOUT_MS);
+	if (libusb_submit_transfer(write_transfer) != LIBUSB_SUCCESS) {
+		LOG_ERROR("usb bulk write failed");
+		return ERROR_JTAG_DEVICE_ERROR;
+	}
+
+	/* the firmware sends short packets, resubmit until all bytes are in */
+	while (ret == ERROR_OK && received < rsize) {
+		read_completed = 0;
+		libusb_fill_bulk_transfer(read_transfer, low->libusb_dev,
+					  USBBLASTER_EPIN | LIBUSB_ENDPOINT_IN,
+					  rbuf + received, rsize - received,
+					  ublast2_libusb_cb, &read_completed, USBBLASTER_TIMEOUT_MS);
+		if (libusb_submit_transfer(read_transfer) != LIBUSB_SUCCESS) {
+			LOG_ERROR("usb bulk read failed");
+			ret = ERROR_JTAG_DEVICE_ERROR;
+			break;
+		}
+		ret = ublast2_libusb_wait(read_transfer, &read_completed);
+		received += read_transfer->actual_length;
+	}
+
+	if (ret != ERROR_OK)
+		libusb_cancel_transfer(write_transfer);
+	int write_ret = ublast2_libusb_wait(write_transfer, &write_completed);
+	if (ret == ERROR_OK && write_transfer->actual_length != size) {
+		LOG_ERROR("usb bulk write: %d of %d bytes written", write_transfer->actual_length, size);
+		ret = ERROR_JTAG_DEVICE_ERROR;
+	}
+
+	return ret != ERROR_OK ? ret : write_ret;
+}
+
 static int ublast2_write_firmware_section(struct libusb_device_handle *libusb_dev,
 				   struct image *firmware_image, int section_index)
 {
@@ -194,6 +272,8 @@ error_release_usb:
 	return ret;
 }
 
+static int ublast2_libusb_quit(struct ublast_lowlevel *low);
+
 static int ublast2_libusb_init(struct ublast_lowlevel *low)
 {
 	const uint16_t vids[] = { low->ublast_vid_uninit, 0 };
@@ -253,11 +333,24 @@ static int ublast2_libusb_init(struct ublast_lowlevel *low)
 
 	LOG_INFO("Altera USB-Blaster II found (Firm. rev. = %s)", buffer);
 
+	write_transfer = libusb_alloc_transfer(0);
+	read_transfer = libusb_alloc_transfer(0);
+	if (!write_transfer || !read_transfer) {
+		LOG_ERROR("unable to allocate usb transfers");
+		ublast2_libusb_quit(low);
+		return ERROR_JTAG_INIT_FAILED;
+	}
+
 	return ERROR_OK;
 }
 
 static int ublast2_libusb_quit(struct ublast_lowlevel *low)
 {
+	libusb_free_transfer(write_transfer);
+	libusb_free_transfer(read_transfer);
+	write_transfer = NULL;
+	read_transfer = NULL;
+
 	if (libusb_release_interface(low->libusb_dev, 0))
 		LOG_ERROR("usb release interface failed");
 
@@ -270,6 +363,7 @@ static struct ublast_lowlevel low = {
 	.close = ublast2_libusb_quit,
 	.read = ublast2_libusb_read,
 	.write = ublast2_libusb_write,
+	.write_read = ublast2_libusb_write_read,
 	.flags = COPY_TDO_BUFFER,
 };
 
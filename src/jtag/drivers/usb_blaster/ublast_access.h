@@ -35,6 +35,9 @@ struct ublast_lowlevel {
 	int (*open)(struct ublast_lowlevel *low);
 	int (*close)(struct ublast_lowlevel *low);
 	int (*speed)(struct ublast_lowlevel *low, int speed);
+	/* optional, write buf and read back rsize bytes while the write is in flight */
+	int (*write_read)(struct ublast_lowlevel *low, uint8_t *buf, int size,
+			  uint8_t *rbuf, unsigned rsize);
 
 	void *priv;
 	int flags;
@@ -89,6 +89,14 @@
 /* USB-Blaster II specific command */
 #define CMD_COPY_TDO_BUFFER	0x5F
 
+/* scan waiting for its TDO bytes, see ublast_complete_scans() */
+struct ublast_pending_scan {
+	struct scan_command *cmd;
+	uint8_t *buf;
+	int nb8, nb1;		/* byte-shifted and bitbanged TDO bytes */
+	size_t tdo_offset;	/* position in the TDO stream */
+};
+
 enum gpio_steer {
 	FIXED_0 = 0,
 	FIXED_1,
@@ -106,6 +114,20 @@ struct ublast_info {
 	uint8_t buf[BUF_LEN];
 	int bufidx;
 
+	/*
+	 * Deferred TDO reads, when the lowlevel driver provides write_read().
+	 * The TDO bytes of the whole queue are collected in tdo[] while the
+	 * buffer is written, and handed to the scans at the end of the queue.
+	 */
+	bool defer_tdo;
+	uint8_t *tdo;
+	size_t tdo_size;
+	size_t tdo_len;		/* bytes received */
+	size_t tdo_ready;	/* bytes sent back by the commands in buf[] */
+	int tdo_error;
+	struct ublast_pending_scan *pending;
+	unsigned int num_pending, pending_size;
+
 	char *lowlevel_name;
 	struct ublast_lowlevel *drv;
 	uint16_t ublast_vid, ublast_pid;
@@ -185,11 +207,43 @@ static int nb_buf_remaining(void)
 	return BUF_LEN - info.bufidx;
 }
 
+static void ublast_flush_deferred(void)
+{
+	int ret;
+
+	if (info.tdo_len + info.tdo_ready > info.tdo_size) {
+		size_t size = MAX(info.tdo_size * 2, info.tdo_len + info.tdo_ready);
+		uint8_t *tdo = realloc(info.tdo, size);
+		if (!tdo) {
+			LOG_ERROR("Out of memory");
+			info.tdo_error = ERROR_FAIL;
+			return;
+		}
+		info.tdo = tdo;
+		info.tdo_size = size;
+	}
+
+	ret = info.drv->write_read(info.drv, info.buf, info.bufidx,
+				   info.tdo + info.tdo_len, info.tdo_ready);
+	LOG_DEBUG_IO("(size=%d, read=%zu) -> %d", info.bufidx, info.tdo_ready, ret);
+	if (ret != ERROR_OK)
+		info.tdo_error = ret;
+	info.tdo_len += info.tdo_ready;
+	info.tdo_ready = 0;
+}
+
 static void ublast_flush_buffer(void)
 {
 	uint32_t retlen;
 	int nb = info.bufidx, ret = ERROR_OK;
 
+	if (info.defer_tdo) {
+		if (nb > 0 && info.tdo_error == ERROR_OK)
+			ublast_flush_deferred();
+		info.bufidx = 0;
+		return;
+	}
+
 	while (ret == ERROR_OK && nb > 0) {
 		ret = ublast_buf_write(info.buf, nb, &retlen);
 		nb -= retlen;
@@ -305,6 +359,24 @@ static uint8_t ublast_build_out(enum scan_type type)
  * @param trst 1 if TRST is to be asserted
  * @param srst 1 if SRST is to be asserted
  */
+/**
+ * ublast_queue_copy_tdo - queue the return of the TDO bytes (deferred mode)
+ * @param nb_bytes the number of TDO bytes read since the last copy
+ *
+ * The bytes are then read back by the flush of the buffer holding the copy
+ * command.
+ */
+static void ublast_queue_copy_tdo(int nb_bytes)
+{
+	if (nb_buf_remaining() < 1)
+		ublast_flush_buffer();
+	info.tdo_ready += nb_bytes;
+	if (info.flags & COPY_TDO_BUFFER)
+		ublast_queue_byte(CMD_COPY_TDO_BUFFER);
+	else if (nb_buf_remaining() == 0)
+		ublast_flush_buffer();
+}
+
 static void ublast_reset(int trst, int srst)
 {
 	uint8_t out_value;
@@ -640,7 +712,9 @@ static void ublast_queue_tdi(uint8_t *bits, int nb_bits, enum scan_type scan)
 			ublast_queue_bytes(&bits[i], trans);
 		else
 			ublast_queue_bytes(byte0, trans);
-		if (read_tdos) {
+		if (read_tdos && info.defer_tdo) {
+			ublast_queue_copy_tdo(trans);
+		} else if (read_tdos) {
 			if (info.flags & COPY_TDO_BUFFER)
 				ublast_queue_byte(CMD_COPY_TDO_BUFFER);
 			ublast_read_byteshifted_tdos(&tdos[i], trans);
@@ -657,13 +731,16 @@ static void ublast_queue_tdi(uint8_t *bits, int nb_bits, enum scan_type scan)
 		else
 			ublast_clock_tdi(tdi, scan);
 	}
-	if (nb1 && read_tdos) {
+	if (nb1 && read_tdos && info.defer_tdo) {
+		ublast_queue_copy_tdo(nb1);
+	} else if (nb1 && read_tdos) {
 		if (info.flags & COPY_TDO_BUFFER)
 			ublast_queue_byte(CMD_COPY_TDO_BUFFER);
 		ublast_read_bitbang_tdos(&tdos[nb8], nb1);
 	}
 
-	if (bits)
+	/* in deferred mode, the TDO bits are stored by ublast_complete_scans() */
+	if (bits && !(read_tdos && info.defer_tdo))
 		memcpy(bits, tdos, DIV_ROUND_UP(nb_bits, 8));
 	free(tdos);
 
@@ -688,6 +765,81 @@ static void ublast_stableclocks(unsigned int num_cycles)
 	ublast_queue_tdi(NULL, num_cycles, SCAN_OUT);
 }
 
+/**
+ * ublast_defer_scan - record a scan whose TDO is read back later
+ * @param cmd the scan command
+ * @param buf the scan buffer, freed by ublast_complete_scans()
+ * @param nb_bits the number of bits
+ *
+ * Must be called before the scan is queued, to record its position in the
+ * TDO stream.
+ */
+static int ublast_defer_scan(struct scan_command *cmd, uint8_t *buf, int nb_bits)
+{
+	if (info.num_pending == info.pending_size) {
+		unsigned int size = info.pending_size ? 2 * info.pending_size : 16;
+		struct ublast_pending_scan *pending = realloc(info.pending, size * sizeof(*pending));
+		if (!pending) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		info.pending = pending;
+		info.pending_size = size;
+	}
+
+	/* same split as in ublast_queue_tdi() */
+	int nb8 = nb_bits / 8;
+	int nb1 = nb_bits % 8;
+	if (nb8 > 0 && nb1 == 0) {
+		nb8--;
+		nb1 = 8;
+	}
+
+	info.pending[info.num_pending++] = (struct ublast_pending_scan) {
+		.cmd = cmd,
+		.buf = buf,
+		.nb8 = nb8,
+		.nb1 = nb1,
+		.tdo_offset = info.tdo_len + info.tdo_ready,
+	};
+	return ERROR_OK;
+}
+
+/**
+ * ublast_complete_scans - flush the buffer and read back the deferred scans
+ *
+ * Returns ERROR_OK if OK, ERROR_xxx if a read/write error occurred.
+ */
+static int ublast_complete_scans(void)
+{
+	int ret;
+
+	ublast_flush_buffer();
+
+	ret = info.tdo_error;
+	for (unsigned int i = 0; i < info.num_pending; i++) {
+		struct ublast_pending_scan *scan = &info.pending[i];
+
+		if (ret == ERROR_OK) {
+			const uint8_t *tdo = info.tdo + scan->tdo_offset;
+
+			memcpy(scan->buf, tdo, scan->nb8);
+			for (int j = 0; j < scan->nb1; j++)
+				if (tdo[scan->nb8 + j] & READ_TDO)
+					scan->buf[scan->nb8] |= (1 << j);
+				else
+					scan->buf[scan->nb8] &= ~(1 << j);
+			ret = jtag_read_buffer(scan->buf, scan->cmd);
+		}
+		free(scan->buf);
+	}
+
+	info.num_pending = 0;
+	info.tdo_len = 0;
+	info.tdo_error = ERROR_OK;
+	return ret;
+}
+
 /**
  * ublast_scan - launches a DR-scan or IR-scan
  * @param cmd the command to launch
@@ -720,10 +872,19 @@ static int ublast_scan(struct scan_command *cmd)
 		  scan_bits, log_buf, cmd->end_state);
 	free(log_buf);
 
-	ublast_queue_tdi(buf, scan_bits, type);
+	if (info.defer_tdo && type != SCAN_OUT) {
+		ret = ublast_defer_scan(cmd, buf, scan_bits);
+		if (ret != ERROR_OK) {
+			free(buf);
+			return ret;
+		}
+		ublast_queue_tdi(buf, scan_bits, type);
+	} else {
+		ublast_queue_tdi(buf, scan_bits, type);
 
-	ret = jtag_read_buffer(buf, cmd);
-	free(buf);
+		ret = jtag_read_buffer(buf, cmd);
+		free(buf);
+	}
 	/*
 	 * ublast_queue_tdi sends the last bit with TMS=1. We are therefore
 	 * already in Exit1-DR/IR and have to skip the first step on our way
@@ -797,6 +958,7 @@ static int ublast_execute_queue(struct jtag_command *cmd_queue)
 			ublast_tms(cmd->cmd.tms);
 			break;
 		case JTAG_SLEEP:
+			ret = ublast_complete_scans();
 			ublast_usleep(cmd->cmd.sleep->us);
 			break;
 		case JTAG_SCAN:
@@ -810,7 +972,9 @@ static int ublast_execute_queue(struct jtag_command *cmd_queue)
 		}
 	}
 
-	ublast_flush_buffer();
+	int retval = ublast_complete_scans();
+	if (ret == ERROR_OK)
+		ret = retval;
 	return ret;
 }
 
@@ -863,6 +1027,9 @@ static int ublast_init(void)
 	info.drv->firmware_path = info.firmware_path;
 
 	info.flags |= info.drv->flags;
+	info.defer_tdo = info.drv->write_read;
+	if (info.defer_tdo)
+		LOG_DEBUG("TDO reads deferred to the end of the queue");
 
 	ret = info.drv->open(info.drv);
 
@@ -890,6 +1057,14 @@ static int ublast_quit(void)
 	uint32_t retlen;
 
 	ublast_buf_write(&byte0, 1, &retlen);
+
+	free(info.tdo);
+	info.tdo = NULL;
+	info.tdo_size = 0;
+	free(info.pending);
+	info.pending = NULL;
+	info.pending_size = 0;
+
 	return info.drv->close(info.drv);
 }
 
@@ -59,6 +59,7 @@
 #define VD_SHEADER_LEN 16
 
 #define VD_MAX_MEMORIES 20
+#define VD_MAX_WINDOW 16
 #define VD_POLL_INTERVAL 500
 #define VD_SCALE_PSTOMS 1000000000
 
@@ -184,6 +185,13 @@ struct vd_rdata {
 	uint8_t *rdata;
 };
 
+struct vd_batch {                /* batch of requests sent, response not read yet */
+	struct vd_shm *shm;          /* copy of the request, receives the response */
+	unsigned int count;          /* number of requests */
+	struct vd_rdata rdataq;      /* read data destinations */
+	int64_t ts;
+};
+
 struct vd_client {
 	uint8_t trans_batch;
 	bool trans_first;
@@ -209,6 +217,10 @@ struct vd_client {
 	char bfm_path[128];
 	char mem_path[VD_MAX_MEMORIES][128];
 	struct vd_rdata rdataq;
+	unsigned int batch_window;   /* batches in flight, 0 or 1 to wait for each */
+	unsigned int batch_first;
+	unsigned int batch_pending;
+	struct vd_batch batches[VD_MAX_WINDOW];
 };
 
 struct vd_jtag_hdr {
@@ -246,7 +258,8 @@ static int vdebug_socket_open(char *server_addr, uint32_t port)
 {
 	int hsock;
 	int rc = 0;
-	uint32_t buflen = sizeof(struct vd_shm); /* size of the send and rcv buffer */
+	/* size of the send and rcv buffer, room for all the batches in flight */
+	uint32_t buflen = sizeof(struct vd_shm) * MAX(vdc.batch_window, 1);
 	struct addrinfo *ainfo = NULL;
 	struct addrinfo ahint = { 0, AF_INET, SOCK_STREAM, 0, 0, NULL, NULL, NULL };
 
@@ -330,11 +343,20 @@ static int vdebug_socket_send(int hsock, struct vd_shm *pmem)
 	return rc;
 }
 
+static int vdebug_batch_wait(int hsock, unsigned int max_pending);
+
 static uint32_t vdebug_wait_server(int hsock, struct vd_shm *pmem)
 {
 	if (!hsock)
 		return VD_ERR_SOC_OPEN;
 
+	/* responses arrive in order, collect those of the batches in flight */
+	if (vdc.batch_pending) {
+		int rc = vdebug_batch_wait(hsock, 0);
+		if (rc)
+			return rc;
+	}
+
 	int st = vdebug_socket_send(hsock, pmem);
 	if (st <= 0)
 		return VD_ERR_SOC_SEND;
@@ -350,25 +372,20 @@ static uint32_t vdebug_wait_server(int hsock, struct vd_shm *pmem)
 	return rc;
 }
 
-static int vdebug_run_jtag_queue(int hsock, struct vd_shm *pm, unsigned int count)
+static void vdebug_jtag_queue_done(struct vd_shm *pm, unsigned int count, struct vd_rdata *rdataq)
 {
 	uint8_t  num_pre, num_post, tdi, tms;
 	unsigned int num, anum, bytes, hwords, words;
 	unsigned int req, waddr, rwords;
-	int64_t ts, te;
+	bool trans_first, trans_last;
 	uint8_t *tdo;
-	int rc;
 	uint64_t jhdr;
 	struct vd_rdata *rd;
 
 	req = 0;                            /* beginning of request */
 	waddr = 0;
 	rwords = 0;
-	h_u16_to_le(pm->wbytes, le_to_h_u16(pm->wwords) * vdc.buf_width);
-	h_u16_to_le(pm->rbytes, le_to_h_u16(pm->rwords) * vdc.buf_width);
-	ts = timeval_ms();
-	rc = vdebug_wait_server(hsock, pm);
-	while (!rc && (req < count)) {      /* loop over requests to read data and print out */
+	while (req < count) {               /* loop over requests to read data and print out */
 		jhdr = le_to_h_u64(&pm->wd8[waddr * 4]);
 		words = jhdr >> 48;
 		hwords = (jhdr >> 32) & 0xffff;
@@ -380,14 +397,14 @@ static int vdebug_run_jtag_queue(int hsock, struct vd_shm *pm, unsigned int coun
 		else
 			num = anum - num_pre;
 		bytes = (num + 7) / 8;
-		vdc.trans_last = (req + 1) < count ? 0 : 1;
-		vdc.trans_first = waddr ? 0 : 1;
+		trans_last = (req + 1) < count ? 0 : 1;
+		trans_first = waddr ? 0 : 1;
 		if (((jhdr >> 30) & 0x3) == 3) { /* cmd is read */
 			if (!rwords) {
-				rd = &vdc.rdataq;
+				rd = rdataq;
 				tdo = rd->rdata;
 			} else {
-				rd = list_first_entry(&vdc.rdataq.lh, struct vd_rdata, lh);
+				rd = list_first_entry(&rdataq->lh, struct vd_rdata, lh);
 				tdo = rd->rdata;
 				list_del(&rd->lh);
 				free(rd);
@@ -404,63 +421,43 @@ static int vdebug_run_jtag_queue(int hsock, struct vd_shm *pm, unsigned int coun
 		tdi = (pm->wd8[waddr * 4] >> num_pre) | (pm->wd8[waddr * 4 + 1] << (8 - num_pre));
 		tms = (pm->wd8[waddr * 4 + 4] >> num_pre) | (pm->wd8[waddr * 4 + 4 + 1] << (8 - num_pre));
 		LOG_DEBUG_IO("%04x L:%02d O:%05x @%03x DI:%02x MS:%02x DO:%02x",
-			le_to_h_u16(pm->wid) - count + req, num, (vdc.trans_first << 14) | (vdc.trans_last << 15),
+			le_to_h_u16(pm->wid) - count + req, num, (trans_first << 14) | (trans_last << 15),
 			waddr - 2, tdi, tms, (tdo ? tdo[0] : 0xdd));
 		waddr += hwords * 2;           /* start of next request */
 		req += 1;
 	}
-
-	if (rc) {
-		LOG_ERROR("0x%x executing transaction", rc);
-		rc = ERROR_FAIL;
-	}
-
-	te = timeval_ms();
-	vdc.targ_time += (uint32_t)(te - ts);
-	h_u16_to_le(pm->offseth, 0);      /* reset buffer write address */
-	h_u32_to_le(pm->offset, 0);
-	h_u16_to_le(pm->rwords, 0);
-	h_u16_to_le(pm->waddr, 0);
-	assert(list_empty(&vdc.rdataq.lh));/* list should be empty after run queue */
-
-	return rc;
 }
 
-static int vdebug_run_reg_queue(int hsock, struct vd_shm *pm, unsigned int count)
+static void vdebug_reg_queue_done(struct vd_shm *pm, unsigned int count, struct vd_rdata *rdataq)
 {
 	unsigned int num, awidth, wwidth;
 	unsigned int req, waddr, rwords;
+	bool trans_first, trans_last;
 	uint8_t aspace;
 	uint32_t addr;
-	int64_t ts, te;
 	uint8_t *data;
-	int rc;
 	uint64_t rhdr;
 	struct vd_rdata *rd;
 
 	req = 0;                            /* beginning of request */
 	waddr = 0;
 	rwords = 0;
-	h_u16_to_le(pm->wbytes, le_to_h_u16(pm->wwords) * vdc.buf_width);
-	h_u16_to_le(pm->rbytes, le_to_h_u16(pm->rwords) * vdc.buf_width);
-	ts = timeval_ms();
-	rc = vdebug_wait_server(hsock, pm);
-	while (!rc && (req < count)) {      /* loop over requests to read data and print out */
+	while (req < count) {               /* loop over requests to read data and print out */
 		rhdr = le_to_h_u64(&pm->wd8[waddr * 4]);
 		addr = rhdr >> 32;              /* reconstruct data for a single request */
 		num = (rhdr >> 16) & 0x7ff;
 		aspace = rhdr & 0x3;
 		awidth = (1 << ((rhdr >> 27) & 0x7));
 		wwidth = (awidth + vdc.buf_width - 1) / vdc.buf_width;
-		vdc.trans_last = (req + 1) < count ? 0 : 1;
-		vdc.trans_first = waddr ? 0 : 1;
+		trans_last = (req + 1) < count ? 0 : 1;
+		trans_first = waddr ? 0 : 1;
 		if (((rhdr >> 30) & 0x3) == 2) { /* cmd is read */
 			if (num) {
 				if (!rwords) {
-					rd = &vdc.rdataq;
+					rd = rdataq;
 					data = rd->rdata;
 				} else {
-					rd = list_first_entry(&vdc.rdataq.lh, struct vd_rdata, lh);
+					rd = list_first_entry(&rdataq->lh, struct vd_rdata, lh);
 					data = rd->rdata;
 					list_del(&rd->lh);
 					free(rd);
@@ -469,31 +466,130 @@ static int vdebug_run_reg_queue(int hsock, struct vd_shm *pm, unsigned int count
 					memcpy(&data[j * awidth], &pm->rd8[(rwords + j) * awidth], awidth);
 			}
 			LOG_DEBUG("read  %04x AS:%1x RG:%1x O:%05x @%03x D:%08x", le_to_h_u16(pm->wid) - count + req,
-				aspace, addr << 2, (vdc.trans_first << 14) | (vdc.trans_last << 15), waddr,
+				aspace, addr << 2, (trans_first << 14) | (trans_last << 15), waddr,
 				(num ? le_to_h_u32(&pm->rd8[rwords * 4]) : 0xdead));
 			rwords += num * wwidth;
 			waddr += sizeof(uint64_t) / 4; /* waddr past header */
 		} else {
 			LOG_DEBUG("write %04x AS:%1x RG:%1x O:%05x @%03x D:%08x", le_to_h_u16(pm->wid) - count + req,
-				aspace, addr << 2, (vdc.trans_first << 14) | (vdc.trans_last << 15), waddr,
+				aspace, addr << 2, (trans_first << 14) | (trans_last << 15), waddr,
 				le_to_h_u32(&pm->wd8[(waddr + num + 1) * 4]));
 			waddr += sizeof(uint64_t) / 4 + (num * wwidth * awidth + 3) / 4;
 		}
 		req += 1;
 	}
+}
+
+static void vdebug_queue_done(struct vd_shm *pm, unsigned int count, struct vd_rdata *rdataq)
+{
+	if (pm->cmd == VD_CMD_JTAGSHTAP)
+		vdebug_jtag_queue_done(pm, count, rdataq);
+	else
+		vdebug_reg_queue_done(pm, count, rdataq);
+}
+
+static void vdebug_rdataq_discard(struct vd_rdata *rdataq)
+{
+	struct vd_rdata *rd, *tmp;
+
+	list_for_each_entry_safe(rd, tmp, &rdataq->lh, lh) {
+		list_del(&rd->lh);
+		free(rd);
+	}
+}
+
+/*
+ * Send the batch in pm without waiting for its response, the request is kept
+ * in a free batch buffer, with the read data destinations, to process the
+ * response once it arrives.
+ */
+static int vdebug_batch_send(int hsock, struct vd_shm *pm, unsigned int count)
+{
+	struct vd_batch *b = &vdc.batches[(vdc.batch_first + vdc.batch_pending) % vdc.batch_window];
+
+	if (!hsock)
+		return VD_ERR_SOC_OPEN;
+
+	if (vdebug_socket_send(hsock, pm) <= 0)
+		return VD_ERR_SOC_SEND;
+
+	memcpy(b->shm, pm, VD_CHEADER_LEN + le_to_h_u16(pm->wbytes));
+	b->count = count;
+	b->rdataq.rdata = vdc.rdataq.rdata;
+	list_splice_init(&vdc.rdataq.lh, &b->rdataq.lh);
+	b->ts = timeval_ms();
+	vdc.batch_pending++;
+
+	return 0;
+}
+
+/* Process responses until no more than max_pending batches are in flight */
+static int vdebug_batch_wait(int hsock, unsigned int max_pending)
+{
+	int rc = 0;
+
+	while (vdc.batch_pending > max_pending) {
+		struct vd_batch *b = &vdc.batches[vdc.batch_first];
+		int st;
+
+		if (vdebug_socket_receive(hsock, b->shm) <= 0)
+			st = VD_ERR_SOC_RECV;
+		else
+			st = le_to_h_u32(b->shm->status);
+		LOG_DEBUG_IO("batch_wait: cmd %02" PRIx8 " done, %u requests, status %d",
+			b->shm->cmd, b->count, st);
+
+		if (!st)
+			vdebug_queue_done(b->shm, b->count, &b->rdataq);
+		vdebug_rdataq_discard(&b->rdataq);
+		vdc.targ_time += (uint32_t)(timeval_ms() - b->ts);
+
+		vdc.batch_first = (vdc.batch_first + 1) % vdc.batch_window;
+		vdc.batch_pending--;
+		if (!rc)               /* keep the first error */
+			rc = st;
+	}
+
+	return rc;
+}
+
+/*
+ * Execute the batch of requests in pm. A batch flushed only because the
+ * buffer is full is sent asynchronously if a batch window is configured,
+ * the caller continues to fill pm while the server works on it.
+ */
+static int vdebug_run_queue(int hsock, struct vd_shm *pm, unsigned int count, bool async)
+{
+	int64_t ts, te;
+	int rc;
+
+	h_u16_to_le(pm->wbytes, le_to_h_u16(pm->wwords) * vdc.buf_width);
+	h_u16_to_le(pm->rbytes, le_to_h_u16(pm->rwords) * vdc.buf_width);
+	if (vdc.batch_window > 1 && (async || vdc.batch_pending)) {
+		rc = vdebug_batch_send(hsock, pm, count);
+		if (!rc)
+			rc = vdebug_batch_wait(hsock, async ? vdc.batch_window - 1 : 0);
+		if (rc)                /* do not leave batches behind an error */
+			vdebug_batch_wait(hsock, 0);
+	} else {
+		ts = timeval_ms();
+		rc = vdebug_wait_server(hsock, pm);
+		if (!rc)
+			vdebug_queue_done(pm, count, &vdc.rdataq);
+		te = timeval_ms();
+		vdc.targ_time += (uint32_t)(te - ts);
+	}
 
 	if (rc) {
 		LOG_ERROR("0x%x executing transaction", rc);
 		rc = ERROR_FAIL;
 	}
 
-	te = timeval_ms();
-	vdc.targ_time += (uint32_t)(te - ts);
+	vdebug_rdataq_discard(&vdc.rdataq);
 	h_u16_to_le(pm->offseth, 0);      /* reset buffer write address */
 	h_u32_to_le(pm->offset, 0);
 	h_u16_to_le(pm->rwords, 0);
 	h_u16_to_le(pm->waddr, 0);
-	assert(list_empty(&vdc.rdataq.lh));/* list should be empty after run queue */
 
 	return rc;
 }
@@ -628,6 +724,7 @@ static int vdebug_jtag_shift_tap(int hsock, struct vd_shm *pm, uint8_t num_pre,
 {
 	const uint32_t tobits = 8;
 	uint16_t bytes, hwords, anum, words, waddr;
+	bool f_full = false;
 	int rc = 0;
 
 	pm->cmd = VD_CMD_JTAGSHTAP;
@@ -646,6 +743,7 @@ static int vdebug_jtag_shift_tap(int hsock, struct vd_shm *pm, uint8_t num_pre,
 	/* buffer overflow check and flush */
 	if (4 * waddr + sizeof(uint64_t) + 8 * hwords + 64 > VD_BUFFER_LEN) {
 		vdc.trans_last = 1;        /* force flush within 64B of buffer end */
+		f_full = true;
 	} else if (4 * waddr + sizeof(uint64_t) + 8 * hwords > VD_BUFFER_LEN) {
 		/* this req does not fit, discard it */
 		LOG_ERROR("%04x L:%02d O:%05x @%04x too many bits to shift",
@@ -718,7 +816,7 @@ static int vdebug_jtag_shift_tap(int hsock, struct vd_shm *pm, uint8_t num_pre,
 	else if (!vdc.trans_last)          /* buffered request */
 		h_u16_to_le(pm->offseth, waddr + hwords * 2);  /* offset for next transaction, must be even */
 	else                               /* execute batch of requests */
-		rc = vdebug_run_jtag_queue(hsock, pm, le_to_h_u16(pm->waddr));
+		rc = vdebug_run_queue(hsock, pm, le_to_h_u16(pm->waddr), f_full && !f_last);
 	vdc.trans_first = vdc.trans_last; /* flush forces trans_first flag */
 
 	return rc;
@@ -737,7 +835,8 @@ static int vdebug_reg_write(int hsock, struct vd_shm *pm, const uint32_t reg,
 	else
 		waddr = le_to_h_u16(pm->offseth);   /* continue from the previous transaction */
 
-	if (4 * waddr + 2 * sizeof(uint64_t) + 4 > VD_BUFFER_LEN)
+	bool f_full = 4 * waddr + 2 * sizeof(uint64_t) + 4 > VD_BUFFER_LEN;
+	if (f_full)
 		vdc.trans_last = 1;    /* force flush, no room for next request */
 
 	uint64_t rhdr = ((uint64_t)reg << 32) + (1UL << 30) + (2UL << 27) + (1UL << 16) + aspace;
@@ -749,7 +848,7 @@ static int vdebug_reg_write(int hsock, struct vd_shm *pm, const uint32_t reg,
 	if (!vdc.trans_last)       /* buffered request */
 		h_u16_to_le(pm->offseth, waddr + 3);
 	else
-		rc = vdebug_run_reg_queue(hsock, pm, le_to_h_u16(pm->waddr));
+		rc = vdebug_run_queue(hsock, pm, le_to_h_u16(pm->waddr), f_full && !f_last);
 	vdc.trans_first = vdc.trans_last; /* flush forces trans_first flag */
 
 	return rc;
@@ -768,7 +867,8 @@ static int vdebug_reg_read(int hsock, struct vd_shm *pm, const uint32_t reg,
 	else
 		waddr = le_to_h_u16(pm->offseth);   /* continue from the previous transaction */
 
-	if (4 * waddr + 2 * sizeof(uint64_t) + 4 > VD_BUFFER_LEN)
+	bool f_full = 4 * waddr + 2 * sizeof(uint64_t) + 4 > VD_BUFFER_LEN;
+	if (f_full)
 		vdc.trans_last = 1;    /* force flush, no room for next request */
 
 	uint64_t rhdr = ((uint64_t)reg << 32) + (2UL << 30) + (2UL << 27) + ((data ? 1UL : 0UL) << 16) + aspace;
@@ -792,7 +892,7 @@ static int vdebug_reg_read(int hsock, struct vd_shm *pm, const uint32_t reg,
 	if (!vdc.trans_last)       /* buffered request */
 		h_u16_to_le(pm->offseth, waddr + 2);
 	else
-		rc = vdebug_run_reg_queue(hsock, pm, le_to_h_u16(pm->waddr));
+		rc = vdebug_run_queue(hsock, pm, le_to_h_u16(pm->waddr), f_full && !f_last);
 	vdc.trans_first = vdc.trans_last; /* flush forces trans_first flag */
 
 	return rc;
@@ -839,19 +939,45 @@ static void vdebug_mem_close(int hsock, struct vd_shm *pm, uint8_t ndx)
 }
 
 
+static void vdebug_batch_free(void)
+{
+	for (unsigned int i = 0; i < VD_MAX_WINDOW; i++) {
+		free(vdc.batches[i].shm);
+		vdc.batches[i].shm = NULL;
+	}
+	vdc.batch_first = 0;
+	vdc.batch_pending = 0;
+}
+
+static int vdebug_batch_alloc(void)
+{
+	for (unsigned int i = 0; i < vdc.batch_window; i++) {
+		vdc.batches[i].shm = calloc(1, sizeof(struct vd_shm));
+		if (!vdc.batches[i].shm)
+			return ERROR_FAIL;
+		INIT_LIST_HEAD(&vdc.batches[i].rdataq.lh);
+	}
+
+	return ERROR_OK;
+}
+
 static int vdebug_init(void)
 {
 	vdc.hsocket = vdebug_socket_open(vdc.server_name, vdc.server_port);
 	pbuf = calloc(1, sizeof(struct vd_shm));
-	if (!pbuf) {
+	if (!pbuf || vdebug_batch_alloc() != ERROR_OK) {
 		close_socket(vdc.hsocket);
 		vdc.hsocket = 0;
+		free(pbuf);
+		pbuf = NULL;
+		vdebug_batch_free();
 		LOG_ERROR("cannot allocate %zu bytes", sizeof(struct vd_shm));
 		return ERROR_FAIL;
 	}
 	if (vdc.hsocket <= 0) {
 		free(pbuf);
 		pbuf = NULL;
+		vdebug_batch_free();
 		LOG_ERROR("cannot connect to vdebug server %s:%" PRIu16,
 			vdc.server_name, vdc.server_port);
 		return ERROR_FAIL;
@@ -869,6 +995,7 @@ static int vdebug_init(void)
 		vdc.hsocket = 0;
 		free(pbuf);
 		pbuf = NULL;
+		vdebug_batch_free();
 	} else {
 		for (uint8_t i = 0; i < vdc.mem_ndx; i++) {
 			rc = vdebug_mem_open(vdc.hsocket, pbuf, vdc.mem_path[i], i);
@@ -895,6 +1022,7 @@ static int vdebug_quit(void)
 		close_socket(vdc.hsocket);
 	free(pbuf);
 	pbuf = NULL;
+	vdebug_batch_free();
 
 	return ERROR_OK;
 }
@@ -1172,7 +1300,12 @@ static int vdebug_dap_queue_ap_abort(struct adiv5_dap *dap, uint8_t *ack)
 static int vdebug_dap_run(struct adiv5_dap *dap)
 {
 	if (le_to_h_u16(pbuf->waddr))
-		return vdebug_run_reg_queue(vdc.hsocket, pbuf, le_to_h_u16(pbuf->waddr));
+		return vdebug_run_queue(vdc.hsocket, pbuf, le_to_h_u16(pbuf->waddr), false);
+
+	if (vdc.batch_pending && vdebug_batch_wait(vdc.hsocket, 0)) {
+		LOG_ERROR("executing transaction");
+		return ERROR_FAIL;
+	}
 
 	return ERROR_OK;
 }
@@ -1262,6 +1395,23 @@ COMMAND_HANDLER(vdebug_set_batching)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(vdebug_set_window)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	unsigned int window;
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], window);
+	if (window > VD_MAX_WINDOW) {
+		LOG_ERROR("window of %u batches, maximum is %d", window, VD_MAX_WINDOW);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+	vdc.batch_window = window;
+	LOG_DEBUG("window: set to %u", vdc.batch_window);
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(vdebug_set_polling)
 {
 	if (CMD_ARGC != 2)
@@ -1303,6 +1453,13 @@ static const struct command_registration vdebug_command_handlers[] = {
 		.help = "set the transaction batching no|wr|rd [0|1|2]",
 		.usage = "<level>",
 	},
+	{
+		.name = "window",
+		.handler = &vdebug_set_window,
+		.mode = COMMAND_CONFIG,
+		.help = "set the number of request batches in flight",
+		.usage = "<batches>",
+	},
 	{
 		.name = "polling",
 		.handler = &vdebug_set_polling,
@@ -237,6 +237,8 @@ struct xds110_info {
 	uint32_t txn_request_size;
 	uint32_t txn_result_size;
 	uint32_t txn_result_count;
+	/* Error of a queue flushed early because it was full */
+	int queued_retval;
 };
 
 static struct xds110_info xds110 = {
@@ -259,7 +261,8 @@ static struct xds110_info xds110 = {
 	.hardware = 0,
 	.txn_request_size = 0,
 	.txn_result_size = 0,
-	.txn_result_count = 0
+	.txn_result_count = 0,
+	.queued_retval = ERROR_OK
 };
 
 static inline void xds110_set_u32(uint8_t *buffer, uint32_t value)
@@ -553,20 +556,18 @@ static bool usb_get_response(uint32_t *total_bytes_read, uint32_t timeout)
 	if (timeout > 500)
 		timeout = 500; /* ms */
 
-	/* If there's more data to retrieve, get it now */
+	/*
+	 * If there's more data to retrieve, get it now. Read straight into
+	 * xds110.read_payload and ask for all of the remaining data at once,
+	 * so a large DAP or scan result is not split into MAX_PACKET sized
+	 * transfers. A device sending more than expected makes the transfer
+	 * overflow, which is not a valid packet either.
+	 */
 	while ((count < size) && success) {
-		success = usb_read(buffer, sizeof(buffer), &bytes_read, timeout);
-		if (success) {
-			if ((count + bytes_read) > size) {
-				/* Read too much data, not a valid packet, abort */
-				success = false;
-			} else {
-				/* Copy this data over to xds110.read_payload */
-				memcpy((void *)&xds110.read_payload[count], (void *)buffer,
-					bytes_read);
-				count += bytes_read;
-			}
-		}
+		success = usb_read(&xds110.read_payload[count], size - count,
+					&bytes_read, timeout);
+		if (success)
+			count += bytes_read;
 	}
 
 	if (!success)
@@ -1254,9 +1255,13 @@ static int xds110_swd_run_queue(void)
 	uint32_t result;
 	uint32_t value;
 	bool success = true;
+	int retval;
 
-	if (xds110.txn_request_size == 0)
-		return ERROR_OK;
+	if (xds110.txn_request_size == 0) {
+		retval = xds110.queued_retval;
+		xds110.queued_retval = ERROR_OK;
+		return retval;
+	}
 
 	/* Terminate request queue */
 	xds110.txn_requests[xds110.txn_request_size++] = 0;
@@ -1298,7 +1303,12 @@ static int xds110_swd_run_queue(void)
 	xds110.txn_result_size = 0;
 	xds110.txn_result_count = 0;
 
-	return (success) ? ERROR_OK : ERROR_FAIL;
+	retval = xds110.queued_retval;
+	xds110.queued_retval = ERROR_OK;
+	if (retval == ERROR_OK && !success)
+		retval = ERROR_FAIL;
+
+	return retval;
 }
 
 static void xds110_swd_queue_cmd(uint8_t cmd, uint32_t *value)
@@ -1311,10 +1321,18 @@ static void xds110_swd_queue_cmd(uint8_t cmd, uint32_t *value)
 	uint32_t address = ((cmd & SWD_CMD_A32) >> 1);
 	uint32_t request_size = (is_read_request) ? 1 : 5;
 
-	/* Check if new request would be too large to fit */
+	/*
+	 * Check if new request would be too large to fit. A MEM-AP block
+	 * transfer usually fills the queue several times; keep the first
+	 * error of these early flushes for the caller's next run_queue.
+	 */
 	if (((xds110.txn_request_size + request_size + 1) > MAX_DATA_BLOCK) ||
-		((xds110.txn_result_count + 1) > MAX_RESULT_QUEUE))
-		xds110_swd_run_queue();
+		((xds110.txn_result_count + 1) > MAX_RESULT_QUEUE)) {
+		int retval = xds110.queued_retval;
+		xds110.queued_retval = xds110_swd_run_queue();
+		if (retval != ERROR_OK)
+			xds110.queued_retval = retval;
+	}
 
 	/* Set the START bit in cmd to ensure cmd is not zero */
 	/* (a value of zero is used to terminate the buffer) */
@@ -13,6 +13,8 @@
 #include <stdlib.h>
 #include <math.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <linux/pci.h>
 
 #include <jtag/interface.h>
@@ -38,6 +40,17 @@
 #define XLNX_XVC_VSEC_ID	0x8
 #define XLNX_XVC_MAX_BITS	0x20
 
+/* AXI-to-JTAG (XVC over AXI) registers, in a memory BAR */
+#define XLNX_AXI_XVC_LEN_REG	0x00
+#define XLNX_AXI_XVC_TMS_REG	0x04
+#define XLNX_AXI_XVC_TDI_REG	0x08
+#define XLNX_AXI_XVC_TDO_REG	0x0C
+#define XLNX_AXI_XVC_CTRL_REG	0x10
+#define XLNX_AXI_XVC_SIZE	0x14
+#define XLNX_AXI_XVC_CTRL_ENABLE	BIT(0)
+/* the shift of 32 bits takes a few AXI clocks, this is a generous bound */
+#define XLNX_AXI_XVC_POLL_MAX	100000
+
 #define MASK_ACK(x) (((x) >> 9) & 0x7)
 #define MASK_PAR(x) ((int)((x) & 0x1))
 
@@ -45,9 +58,27 @@ struct xlnx_pcie_xvc {
 	int fd;
 	unsigned offset;
 	char *device;
+
+	/* AXI XVC in a memory BAR, see "xlnx_pcie_xvc bar"; bar < 0 for
+	 * the XVC capability in the configuration space */
+	int bar;
+	uint32_t bar_offset;
+	void *map;
+	size_t map_size;
+	volatile uint32_t *regs;
+
+	/* length and TMS of the last transaction, writes of an unchanged
+	 * value are skipped, e.g. during long scans */
+	bool cache_valid;
+	uint32_t len_cache;
+	uint32_t tms_cache;
 };
 
-static struct xlnx_pcie_xvc xlnx_pcie_xvc_state;
+static struct xlnx_pcie_xvc xlnx_pcie_xvc_state = {
+	.fd = -1,
+	.bar = -1,
+	.map = MAP_FAILED,
+};
 static struct xlnx_pcie_xvc *xlnx_pcie_xvc = &xlnx_pcie_xvc_state;
 
 static int xlnx_pcie_xvc_read_reg(const int offset, uint32_t *val)
@@ -91,27 +122,93 @@ static int xlnx_pcie_xvc_write_reg(const int offset, const uint32_t val)
 	return ERROR_OK;
 }
 
-static int xlnx_pcie_xvc_transact(size_t num_bits, uint32_t tms, uint32_t tdi,
+static uint32_t xlnx_pcie_xvc_bar_read(const int offset)
+{
+	uint32_t val = xlnx_pcie_xvc->regs[offset / 4];
+	return le_to_h_u32((const uint8_t *)&val);
+}
+
+static void xlnx_pcie_xvc_bar_write(const int offset, const uint32_t val)
+{
+	uint32_t le;
+	h_u32_to_le((uint8_t *)&le, val);
+	xlnx_pcie_xvc->regs[offset / 4] = le;
+}
+
+/* Shift through the AXI XVC registers, no system call involved */
+static int xlnx_pcie_xvc_transact_bar(size_t num_bits, uint32_t tms, uint32_t tdi,
+				  uint32_t *tdo)
+{
+	if (!xlnx_pcie_xvc->cache_valid || xlnx_pcie_xvc->len_cache != num_bits)
+		xlnx_pcie_xvc_bar_write(XLNX_AXI_XVC_LEN_REG, num_bits);
+	if (!xlnx_pcie_xvc->cache_valid || xlnx_pcie_xvc->tms_cache != tms)
+		xlnx_pcie_xvc_bar_write(XLNX_AXI_XVC_TMS_REG, tms);
+	xlnx_pcie_xvc_bar_write(XLNX_AXI_XVC_TDI_REG, tdi);
+	xlnx_pcie_xvc_bar_write(XLNX_AXI_XVC_CTRL_REG, XLNX_AXI_XVC_CTRL_ENABLE);
+
+	unsigned int polls = 0;
+	while (xlnx_pcie_xvc_bar_read(XLNX_AXI_XVC_CTRL_REG) & XLNX_AXI_XVC_CTRL_ENABLE) {
+		if (++polls == XLNX_AXI_XVC_POLL_MAX) {
+			LOG_ERROR("Timeout waiting for the AXI XVC shift to complete");
+			xlnx_pcie_xvc->cache_valid = false;
+			return ERROR_JTAG_DEVICE_ERROR;
+		}
+	}
+
+	if (tdo)
+		*tdo = xlnx_pcie_xvc_bar_read(XLNX_AXI_XVC_TDO_REG);
+
+	return ERROR_OK;
+}
+
+static int xlnx_pcie_xvc_transact_cfg(size_t num_bits, uint32_t tms, uint32_t tdi,
 				  uint32_t *tdo)
 {
 	int err;
 
-	err = xlnx_pcie_xvc_write_reg(XLNX_XVC_LEN_REG, num_bits);
-	if (err != ERROR_OK)
-		return err;
+	if (!xlnx_pcie_xvc->cache_valid || xlnx_pcie_xvc->len_cache != num_bits) {
+		err = xlnx_pcie_xvc_write_reg(XLNX_XVC_LEN_REG, num_bits);
+		if (err != ERROR_OK)
+			goto err_out;
+	}
 
-	err = xlnx_pcie_xvc_write_reg(XLNX_XVC_TMS_REG, tms);
-	if (err != ERROR_OK)
-		return err;
+	if (!xlnx_pcie_xvc->cache_valid || xlnx_pcie_xvc->tms_cache != tms) {
+		err = xlnx_pcie_xvc_write_reg(XLNX_XVC_TMS_REG, tms);
+		if (err != ERROR_OK)
+			goto err_out;
+	}
 
 	err = xlnx_pcie_xvc_write_reg(XLNX_XVC_TDX_REG, tdi);
 	if (err != ERROR_OK)
-		return err;
+		goto err_out;
 
 	err = xlnx_pcie_xvc_read_reg(XLNX_XVC_TDX_REG, tdo);
+	if (err != ERROR_OK)
+		goto err_out;
+
+	return ERROR_OK;
+
+err_out:
+	xlnx_pcie_xvc->cache_valid = false;
+	return err;
+}
+
+static int xlnx_pcie_xvc_transact(size_t num_bits, uint32_t tms, uint32_t tdi,
+				  uint32_t *tdo)
+{
+	int err;
+
+	if (xlnx_pcie_xvc->regs)
+		err = xlnx_pcie_xvc_transact_bar(num_bits, tms, tdi, tdo);
+	else
+		err = xlnx_pcie_xvc_transact_cfg(num_bits, tms, tdi, tdo);
 	if (err != ERROR_OK)
 		return err;
 
+	xlnx_pcie_xvc->len_cache = num_bits;
+	xlnx_pcie_xvc->tms_cache = tms;
+	xlnx_pcie_xvc->cache_valid = true;
+
 	if (tdo)
 		LOG_DEBUG_IO("Transact num_bits: %zu, tms: %" PRIx32 ", tdi: %" PRIx32 ", tdo: %" PRIx32,
 			     num_bits, tms, tdi, *tdo);
@@ -379,12 +476,62 @@ static int xlnx_pcie_xvc_execute_queue(struct jtag_command *cmd_queue)
 }
 
 
+static int xlnx_pcie_xvc_init_bar(void)
+{
+	char filename[PATH_MAX];
+	struct stat st;
+
+	snprintf(filename, PATH_MAX, "/sys/bus/pci/devices/%s/resource%d",
+		 xlnx_pcie_xvc->device, xlnx_pcie_xvc->bar);
+	xlnx_pcie_xvc->fd = open(filename, O_RDWR | O_SYNC);
+	if (xlnx_pcie_xvc->fd < 0) {
+		LOG_ERROR("Failed to open device: %s", filename);
+		return ERROR_JTAG_INIT_FAILED;
+	}
+
+	if (fstat(xlnx_pcie_xvc->fd, &st) < 0 ||
+	    (uint64_t)xlnx_pcie_xvc->bar_offset + XLNX_AXI_XVC_SIZE > (uint64_t)st.st_size) {
+		LOG_ERROR("AXI XVC registers at offset 0x%" PRIx32 " are outside of %s",
+			  xlnx_pcie_xvc->bar_offset, filename);
+		goto err_close;
+	}
+
+	/* map the pages holding the registers */
+	size_t page_size = sysconf(_SC_PAGE_SIZE);
+	off_t map_offset = xlnx_pcie_xvc->bar_offset & ~(page_size - 1);
+	xlnx_pcie_xvc->map_size = xlnx_pcie_xvc->bar_offset - map_offset + XLNX_AXI_XVC_SIZE;
+	xlnx_pcie_xvc->map = mmap(NULL, xlnx_pcie_xvc->map_size, PROT_READ | PROT_WRITE,
+				  MAP_SHARED, xlnx_pcie_xvc->fd, map_offset);
+	if (xlnx_pcie_xvc->map == MAP_FAILED) {
+		LOG_ERROR("mmap: %s", strerror(errno));
+		goto err_close;
+	}
+
+	xlnx_pcie_xvc->regs = (volatile uint32_t *)((uint8_t *)xlnx_pcie_xvc->map +
+						    (xlnx_pcie_xvc->bar_offset - map_offset));
+
+	LOG_INFO("Using AXI XVC in BAR%d of %s at offset: 0x%" PRIx32,
+		 xlnx_pcie_xvc->bar, xlnx_pcie_xvc->device, xlnx_pcie_xvc->bar_offset);
+
+	return ERROR_OK;
+
+err_close:
+	close(xlnx_pcie_xvc->fd);
+	xlnx_pcie_xvc->fd = -1;
+	return ERROR_JTAG_INIT_FAILED;
+}
+
 static int xlnx_pcie_xvc_init(void)
 {
 	char filename[PATH_MAX];
 	uint32_t cap, vh;
 	int err;
 
+	xlnx_pcie_xvc->cache_valid = false;
+
+	if (xlnx_pcie_xvc->bar >= 0)
+		return xlnx_pcie_xvc_init_bar();
+
 	snprintf(filename, PATH_MAX, "/sys/bus/pci/devices/%s/config",
 		 xlnx_pcie_xvc->device);
 	xlnx_pcie_xvc->fd = open(filename, O_RDWR | O_SYNC);
@@ -438,6 +585,12 @@ static int xlnx_pcie_xvc_quit(void)
 {
 	int err;
 
+	if (xlnx_pcie_xvc->map != MAP_FAILED) {
+		munmap(xlnx_pcie_xvc->map, xlnx_pcie_xvc->map_size);
+		xlnx_pcie_xvc->map = MAP_FAILED;
+		xlnx_pcie_xvc->regs = NULL;
+	}
+
 	err = close(xlnx_pcie_xvc->fd);
 	if (err)
 		return err;
@@ -460,6 +613,31 @@ COMMAND_HANDLER(xlnx_pcie_xvc_handle_config_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(xlnx_pcie_xvc_handle_bar_command)
+{
+	if (CMD_ARGC < 1 || CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	unsigned int bar;
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], bar);
+	if (bar > 5) {
+		command_print(CMD, "BAR must be between 0 and 5");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	uint32_t offset = 0;
+	if (CMD_ARGC == 2)
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], offset);
+	if (offset % 4) {
+		command_print(CMD, "offset must be 32-bit aligned");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	xlnx_pcie_xvc->bar = bar;
+	xlnx_pcie_xvc->bar_offset = offset;
+	return ERROR_OK;
+}
+
 static const struct command_registration xlnx_pcie_xvc_subcommand_handlers[] = {
 	{
 		.name = "config",
@@ -468,6 +646,13 @@ static const struct command_registration xlnx_pcie_xvc_subcommand_handlers[] = {
 		.help = "Configure XVC/PCIe JTAG adapter",
 		.usage = "device",
 	},
+	{
+		.name = "bar",
+		.handler = xlnx_pcie_xvc_handle_bar_command,
+		.mode = COMMAND_CONFIG,
+		.help = "Use the AXI XVC registers mapped in a memory BAR",
+		.usage = "bar_number [offset]",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
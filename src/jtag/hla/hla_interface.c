@@ -123,10 +123,73 @@ static int hl_interface_quit(void)
 	jtag_command_queue_reset();
 
 	free((void *)hl_if.param.device_desc);
+	free(hl_if.queue);
+	hl_if.queue = NULL;
+	hl_if.queue_len = 0;
+	hl_if.queue_size = 0;
 
 	return ERROR_OK;
 }
 
+static int hl_queue_add(struct hl_interface *adapter, enum hl_queue_op op,
+		uint32_t addr, uint32_t val, uint32_t *dst)
+{
+	if (adapter->queue_len == adapter->queue_size) {
+		unsigned int size = adapter->queue_size ? 2 * adapter->queue_size : 32;
+		struct hl_queue_entry *queue = realloc(adapter->queue, size * sizeof(*queue));
+		if (!queue) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		adapter->queue = queue;
+		adapter->queue_size = size;
+	}
+
+	adapter->queue[adapter->queue_len++] = (struct hl_queue_entry) {
+		.op = op,
+		.addr = addr,
+		.val = val,
+		.dst = dst,
+	};
+	return ERROR_OK;
+}
+
+int hl_queue_read_reg(struct hl_interface *adapter, unsigned int regsel, uint32_t *val)
+{
+	return hl_queue_add(adapter, HL_QUEUE_READ_REG, regsel, 0, val);
+}
+
+int hl_queue_read_u32(struct hl_interface *adapter, uint32_t addr, uint32_t *val)
+{
+	return hl_queue_add(adapter, HL_QUEUE_READ_U32, addr, 0, val);
+}
+
+int hl_queue_write_debug_reg(struct hl_interface *adapter, uint32_t addr, uint32_t val)
+{
+	return hl_queue_add(adapter, HL_QUEUE_WRITE_DEBUG_REG, addr, val, NULL);
+}
+
+int hl_queue_flush(struct hl_interface *adapter)
+{
+	const struct hl_layout_api *api = adapter->layout->api;
+	unsigned int count = adapter->queue_len;
+	int retval = ERROR_OK;
+
+	adapter->queue_len = 0;
+	if (!count)
+		return ERROR_OK;
+
+	LOG_DEBUG_IO("%u queued accesses", count);
+
+	if (api->run_queue)
+		return api->run_queue(adapter->handle, adapter->queue, count);
+
+	for (unsigned int i = 0; i < count && retval == ERROR_OK; i++)
+		retval = hl_layout_run_queue_entry(api, adapter->handle, &adapter->queue[i]);
+
+	return retval;
+}
+
 static int hl_interface_reset(int req_trst, int req_srst)
 {
 	return hl_if.layout->api->assert_srst(hl_if.handle, req_srst ? 0 : 1);
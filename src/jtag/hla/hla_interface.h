@@ -14,6 +14,8 @@
 /** */
 struct target;
 /** */
+struct hl_queue_entry;
+/** */
 enum e_hl_transports;
 /** */
 extern const char *hl_transports[];
@@ -46,6 +48,12 @@ struct hl_interface {
 	const struct hl_layout *layout;
 	/** */
 	void *handle;
+	/** accesses waiting for hl_queue_flush() */
+	struct hl_queue_entry *queue;
+	/** */
+	unsigned int queue_len;
+	/** */
+	unsigned int queue_size;
 };
 
 /** */
@@ -56,4 +64,13 @@ int hl_interface_init_target(struct target *t);
 int hl_interface_init_reset(void);
 int hl_interface_override_target(const char **targetname);
 
+/** Queue the read of a core register, stored at @a val by hl_queue_flush() */
+int hl_queue_read_reg(struct hl_interface *adapter, unsigned int regsel, uint32_t *val);
+/** Queue the read of a 32 bit word, stored at @a val by hl_queue_flush() */
+int hl_queue_read_u32(struct hl_interface *adapter, uint32_t addr, uint32_t *val);
+/** Queue a write to a debug register */
+int hl_queue_write_debug_reg(struct hl_interface *adapter, uint32_t addr, uint32_t val);
+/** Run the queued accesses, with a single adapter call if it supports it */
+int hl_queue_flush(struct hl_interface *adapter);
+
 #endif /* OPENOCD_JTAG_HLA_HLA_INTERFACE_H */
@@ -88,3 +88,24 @@ int hl_layout_init(struct hl_interface *adapter)
 	}
 	return ERROR_OK;
 }
+
+int hl_layout_run_queue_entry(const struct hl_layout_api *api, void *handle,
+		const struct hl_queue_entry *entry)
+{
+	uint8_t buf[4];
+	int retval;
+
+	switch (entry->op) {
+	case HL_QUEUE_READ_REG:
+		return api->read_reg(handle, entry->addr, entry->dst);
+	case HL_QUEUE_READ_U32:
+		retval = api->read_mem(handle, entry->addr, 4, 1, buf);
+		if (retval == ERROR_OK)
+			*entry->dst = le_to_h_u32(buf);
+		return retval;
+	case HL_QUEUE_WRITE_DEBUG_REG:
+		return api->write_debug_reg(handle, entry->addr, entry->val);
+	}
+
+	return ERROR_FAIL;
+}
@@ -18,6 +18,25 @@
 struct hl_interface;
 struct hl_interface_param;
 
+/** Access queued by hl_queue_read_reg() and friends */
+enum hl_queue_op {
+	HL_QUEUE_READ_REG,
+	HL_QUEUE_READ_U32,
+	HL_QUEUE_WRITE_DEBUG_REG,
+};
+
+/** */
+struct hl_queue_entry {
+	/** */
+	enum hl_queue_op op;
+	/** register selection index for HL_QUEUE_READ_REG, else address */
+	uint32_t addr;
+	/** value to write */
+	uint32_t val;
+	/** storage for the value read */
+	uint32_t *dst;
+};
+
 /** */
 extern struct hl_layout_api stlink_usb_layout_api;
 extern struct hl_layout_api icdi_usb_layout_api;
@@ -114,6 +133,21 @@ struct hl_layout_api {
 	int (*poll_trace)(void *handle, uint8_t *buf, size_t *size);
 	/** */
 	enum target_state (*state)(void *fd);
+	/**
+	 * Run a queue of accesses, grouping them in as few USB transfers as
+	 * the adapter allows (optional)
+	 *
+	 * When missing, the accesses are run one by one with read_reg,
+	 * read_mem and write_debug_reg. The register reads may be run
+	 * before the memory accesses queued with them.
+	 *
+	 * @param handle A pointer to the device-specific handle
+	 * @param queue The accesses, in the order they were queued
+	 * @param count The number of accesses
+	 * @returns ERROR_OK on success, or an error code on failure.
+	 */
+	int (*run_queue)(void *handle, const struct hl_queue_entry *queue,
+			unsigned int count);
 };
 
 /** */
@@ -132,5 +166,8 @@ struct hl_layout {
 const struct hl_layout *hl_layout_get_list(void);
 /** */
 int hl_layout_init(struct hl_interface *adapter);
+/** Run a single queued access with the synchronous calls of @a api */
+int hl_layout_run_queue_entry(const struct hl_layout_api *api, void *handle,
+		const struct hl_queue_entry *entry);
 
 #endif /* OPENOCD_JTAG_HLA_HLA_LAYOUT_H */
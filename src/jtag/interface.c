@@ -197,6 +197,96 @@ int tap_get_tms_path_len(tap_state_t from, tap_state_t to)
 	return (*tms_seqs)[tap_move_ndx(from)][tap_move_ndx(to)].bit_count;
 }
 
+/* Shortest TMS sequence between any two TAP states, [from_state][to_state],
+ * indexed by tap_state_t. Paths never pass through TAP_RESET, so they are
+ * valid pathmove sequences; TAP_RESET itself is reached with five TMS high.
+ * Generated by breadth-first search over tap_state_transition().
+ *
+ * Columns, to state:
+ *	DREXIT2, DREXIT1, DRSHIFT, DRPAUSE, IRSELECT, DRUPDATE, DRCAPTURE, DRSELECT,
+ *	IREXIT2, IREXIT1, IRSHIFT, IRPAUSE, IDLE, IRUPDATE, IRCAPTURE, RESET
+ */
+static const struct tms_sequences any_tms_seqs[16][16] = {
+	[TAP_DREXIT2] = {
+		B8(0, 0), B8(10, 2), B8(0, 1), B8(010, 3), B8(111, 3), B8(1, 1), B8(011, 3), B8(11, 2),
+		B8(1010111, 7), B8(10111, 5), B8(00111, 5), B8(010111, 6), B8(01, 2), B8(110111, 6), B8(0111, 4), B8(11111, 5),
+	},
+	[TAP_DREXIT1] = {
+		B8(10, 2), B8(0, 0), B8(010, 3), B8(0, 1), B8(111, 3), B8(1, 1), B8(011, 3), B8(11, 2),
+		B8(1010111, 7), B8(10111, 5), B8(00111, 5), B8(010111, 6), B8(01, 2), B8(110111, 6), B8(0111, 4), B8(11111, 5),
+	},
+	[TAP_DRSHIFT] = {
+		B8(101, 3), B8(1, 1), B8(0, 0), B8(01, 2), B8(1111, 4), B8(11, 2), B8(0111, 4), B8(111, 3),
+		B8(10101111, 8), B8(101111, 6), B8(001111, 6), B8(0101111, 7), B8(011, 3), B8(1101111, 7), B8(01111, 5), B8(11111, 5),
+	},
+	[TAP_DRPAUSE] = {
+		B8(1, 1), B8(101, 3), B8(01, 2), B8(0, 0), B8(1111, 4), B8(11, 2), B8(0111, 4), B8(111, 3),
+		B8(10101111, 8), B8(101111, 6), B8(001111, 6), B8(0101111, 7), B8(011, 3), B8(1101111, 7), B8(01111, 5), B8(11111, 5),
+	},
+	[TAP_IRSELECT] = {
+		B8(10101110, 8), B8(101110, 6), B8(001110, 6), B8(0101110, 7), B8(0, 0), B8(1101110, 7), B8(01110, 5), B8(1110, 4),
+		B8(1010, 4), B8(10, 2), B8(00, 2), B8(010, 3), B8(0110, 4), B8(110, 3), B8(0, 1), B8(11111, 5),
+	},
+	[TAP_DRUPDATE] = {
+		B8(10101, 5), B8(101, 3), B8(001, 3), B8(0101, 4), B8(11, 2), B8(0, 0), B8(01, 2), B8(1, 1),
+		B8(101011, 6), B8(1011, 4), B8(0011, 4), B8(01011, 5), B8(0, 1), B8(11011, 5), B8(011, 3), B8(11111, 5),
+	},
+	[TAP_DRCAPTURE] = {
+		B8(101, 3), B8(1, 1), B8(0, 1), B8(01, 2), B8(1111, 4), B8(11, 2), B8(0, 0), B8(111, 3),
+		B8(10101111, 8), B8(101111, 6), B8(001111, 6), B8(0101111, 7), B8(011, 3), B8(1101111, 7), B8(01111, 5), B8(11111, 5),
+	},
+	[TAP_DRSELECT] = {
+		B8(1010, 4), B8(10, 2), B8(00, 2), B8(010, 3), B8(1, 1), B8(110, 3), B8(0, 1), B8(0, 0),
+		B8(10101, 5), B8(101, 3), B8(001, 3), B8(0101, 4), B8(0110, 4), B8(1101, 4), B8(01, 2), B8(11111, 5),
+	},
+	[TAP_IREXIT2] = {
+		B8(101011, 6), B8(1011, 4), B8(0011, 4), B8(01011, 5), B8(111, 3), B8(11011, 5), B8(011, 3), B8(11, 2),
+		B8(0, 0), B8(10, 2), B8(0, 1), B8(010, 3), B8(01, 2), B8(1, 1), B8(0111, 4), B8(11111, 5),
+	},
+	[TAP_IREXIT1] = {
+		B8(101011, 6), B8(1011, 4), B8(0011, 4), B8(01011, 5), B8(111, 3), B8(11011, 5), B8(011, 3), B8(11, 2),
+		B8(10, 2), B8(0, 0), B8(010, 3), B8(0, 1), B8(01, 2), B8(1, 1), B8(0111, 4), B8(11111, 5),
+	},
+	[TAP_IRSHIFT] = {
+		B8(1010111, 7), B8(10111, 5), B8(00111, 5), B8(010111, 6), B8(1111, 4), B8(110111, 6), B8(0111, 4), B8(111, 3),
+		B8(101, 3), B8(1, 1), B8(0, 0), B8(01, 2), B8(011, 3), B8(11, 2), B8(01111, 5), B8(11111, 5),
+	},
+	[TAP_IRPAUSE] = {
+		B8(1010111, 7), B8(10111, 5), B8(00111, 5), B8(010111, 6), B8(1111, 4), B8(110111, 6), B8(0111, 4), B8(111, 3),
+		B8(1, 1), B8(101, 3), B8(01, 2), B8(0, 0), B8(011, 3), B8(11, 2), B8(01111, 5), B8(11111, 5),
+	},
+	[TAP_IDLE] = {
+		B8(10101, 5), B8(101, 3), B8(001, 3), B8(0101, 4), B8(11, 2), B8(1101, 4), B8(01, 2), B8(1, 1),
+		B8(101011, 6), B8(1011, 4), B8(0011, 4), B8(01011, 5), B8(0, 0), B8(11011, 5), B8(011, 3), B8(11111, 5),
+	},
+	[TAP_IRUPDATE] = {
+		B8(10101, 5), B8(101, 3), B8(001, 3), B8(0101, 4), B8(11, 2), B8(1101, 4), B8(01, 2), B8(1, 1),
+		B8(101011, 6), B8(1011, 4), B8(0011, 4), B8(01011, 5), B8(0, 1), B8(0, 0), B8(011, 3), B8(11111, 5),
+	},
+	[TAP_IRCAPTURE] = {
+		B8(1010111, 7), B8(10111, 5), B8(00111, 5), B8(010111, 6), B8(1111, 4), B8(110111, 6), B8(0111, 4), B8(111, 3),
+		B8(101, 3), B8(1, 1), B8(0, 1), B8(01, 2), B8(011, 3), B8(11, 2), B8(0, 0), B8(11111, 5),
+	},
+	[TAP_RESET] = {
+		B8(101010, 6), B8(1010, 4), B8(0010, 4), B8(01010, 5), B8(110, 3), B8(11010, 5), B8(010, 3), B8(10, 2),
+		B8(1010110, 7), B8(10110, 5), B8(00110, 5), B8(010110, 6), B8(0, 1), B8(110110, 6), B8(0110, 4), B8(11111, 5),
+	},
+};
+
+int tap_get_tms_path_any(tap_state_t from, tap_state_t to)
+{
+	assert(from >= TAP_DREXIT2 && from <= TAP_RESET);
+	assert(to >= TAP_DREXIT2 && to <= TAP_RESET);
+	return any_tms_seqs[from][to].bits;
+}
+
+int tap_get_tms_path_any_len(tap_state_t from, tap_state_t to)
+{
+	assert(from >= TAP_DREXIT2 && from <= TAP_RESET);
+	assert(to >= TAP_DREXIT2 && to <= TAP_RESET);
+	return any_tms_seqs[from][to].bit_count;
+}
+
 bool tap_is_state_stable(tap_state_t astate)
 {
 	bool is_stable;
@@ -111,6 +111,29 @@ int tap_get_tms_path(tap_state_t from, tap_state_t to);
  */
 int tap_get_tms_path_len(tap_state_t from, tap_state_t to);
 
+/**
+ * Like tap_get_tms_path(), but from and to any TAP state, not only the
+ * stable ones, using a constant table of the shortest sequences.
+ * The sequence never passes through TAP_RESET unless that is the
+ * destination, and it is empty when @a from equals @a to (except for
+ * TAP_RESET, which is always reached with five TMS high clocks).
+ *
+ * The length of the sequence, at most 8 bits, must be determined with
+ * a parallel call to tap_get_tms_path_any_len().
+ *
+ * @param from The starting state.
+ * @param to The desired final state.
+ * @return int The required TMS bit sequence, with the first bit in the
+ * sequence at bit 0.
+ */
+int tap_get_tms_path_any(tap_state_t from, tap_state_t to);
+
+/**
+ * @returns the number of bits in the TMS sequence given by
+ * tap_get_tms_path_any().
+ */
+int tap_get_tms_path_any_len(tap_state_t from, tap_state_t to);
+
 
 /**
  * Function tap_move_ndx
@@ -193,6 +216,24 @@ struct jtag_interface {
 	 */
 
 	int (*execute_queue)(struct jtag_command *cmd_queue);
+
+	/**
+	 * Optional: start executing the commands in the supplied queue
+	 * and return without waiting for the transfer to complete.
+	 * The queue is kept valid by the core until execute_queue_wait()
+	 * has returned. At most one queue is in flight at any time.
+	 * @param cmd_queue - a linked list of commands to execute
+	 * @returns ERROR_OK if the queue has been submitted, or an error code.
+	 */
+	int (*execute_queue_async)(struct jtag_command *cmd_queue);
+
+	/**
+	 * Wait for completion of the queue started by execute_queue_async(),
+	 * leaving captured data in the scan fields of that queue.
+	 * Mandatory if execute_queue_async() is implemented.
+	 * @returns ERROR_OK on success, or an error code on failure.
+	 */
+	int (*execute_queue_wait)(void);
 };
 
 /**
@@ -135,6 +135,8 @@ struct jtag_tap {
 
 	/** Bypass instruction value */
 	uint64_t ir_bypass_value;
+	/** Bypass instruction, as shifted while another TAP is the active one */
+	uint8_t *bypass_instr;
 
 	struct jtag_tap_event_action *event_action;
 
@@ -256,6 +258,24 @@ void jtag_set_verify_capture_ir(bool enable);
 /** @returns True if IR scan verification will be performed. */
 bool jtag_will_verify_capture_ir(void);
 
+/**
+ * Enable or disable the reuse of the scan chain found by the last complete
+ * examination, to skip most of it when reconnecting to the same chain.
+ * Disabling it also forgets the cached chain.
+ */
+void jtag_set_chain_cache(bool enable);
+/** @returns True if the cached scan chain can be used. */
+bool jtag_will_use_chain_cache(void);
+
+/**
+ * Enable or disable skipping an IR scan that would load the instruction
+ * already selected by the previous one, to the same TAP and with all the
+ * other TAPs still in BYPASS.
+ */
+void jtag_set_ir_cache(bool enable);
+/** @returns True if redundant IR scans are skipped. */
+bool jtag_will_use_ir_cache(void);
+
 /** Set ms to sleep after jtag_execute_queue() flushes queue. Debug purposes. */
 void jtag_set_flush_queue_sleep(int ms);
 
@@ -330,6 +350,23 @@ void jtag_add_dr_scan_check(struct jtag_tap *tap, int num_fields,
 void jtag_add_plain_dr_scan(int num_bits,
 		const uint8_t *out_bits, uint8_t *in_bits, tap_state_t endstate);
 
+/**
+ * The same as jtag_add_dr_scan(), except that the queue refers to the
+ * out_value buffers of the fields instead of copying them, which saves
+ * memory and time for large shifts like FPGA bitstreams.
+ * The caller guarantees that those buffers remain valid and unchanged
+ * until the queue has been executed, and that they do not overlap any
+ * in_value buffer.
+ */
+void jtag_add_dr_scan_nocopy(struct jtag_tap *tap, int num_fields,
+		const struct scan_field *fields, tap_state_t endstate);
+/**
+ * The same as jtag_add_plain_dr_scan(), except that out_bits is not
+ * copied, with the same requirements as jtag_add_dr_scan_nocopy().
+ */
+void jtag_add_plain_dr_scan_nocopy(int num_bits,
+		const uint8_t *out_bits, uint8_t *in_bits, tap_state_t endstate);
+
 /**
  * Defines the type of data passed to the jtag_callback_t interface.
  * The underlying type must allow storing an @c int or pointer type.
@@ -522,6 +559,38 @@ int jtag_execute_queue(void);
 /** same as jtag_execute_queue() but does not clear the error flag */
 void jtag_execute_queue_noclear(void);
 
+/**
+ * Completion callback of jtag_execute_queue_async().
+ * @param retval The result of the queue, as jtag_execute_queue() would
+ * have returned it.
+ * @param priv The private data passed to jtag_execute_queue_async().
+ */
+typedef void (*jtag_queue_done_callback_t)(int retval, void *priv);
+
+/**
+ * Submit the queued commands and return, possibly before they have been
+ * executed, so the caller can build the next queue while the adapter
+ * transfers this one. Data captured by the queued scans and callbacks
+ * added with jtag_add_callback() are only valid once @a done is called.
+ *
+ * At most one queue is in flight: a new submission, jtag_execute_queue()
+ * and jtag_execute_queue_wait() first complete the previous one.
+ * With adapters lacking asynchronous support the queue is executed and
+ * @a done is called before this function returns.
+ *
+ * @param done Called on completion of the queue; may be NULL.
+ * @param priv Private data passed to @a done.
+ * @returns ERROR_OK if the queue has been submitted (or executed without
+ * error), or an error code.
+ */
+int jtag_execute_queue_async(jtag_queue_done_callback_t done, void *priv);
+
+/**
+ * Wait for the queue submitted by jtag_execute_queue_async() to complete.
+ * @returns the result of the in-flight queue, or ERROR_OK if none.
+ */
+int jtag_execute_queue_wait(void);
+
 /** @returns the number of times the scan queue has been flushed */
 unsigned int jtag_get_flush_queue_count(void);
 
@@ -49,6 +49,12 @@ int interface_jtag_add_dr_scan(struct jtag_tap *active,
 int interface_jtag_add_plain_dr_scan(
 		int num_bits, const uint8_t *out_bits, uint8_t *in_bits,
 		tap_state_t endstate);
+int interface_jtag_add_dr_scan_nocopy(struct jtag_tap *active,
+		int num_fields, const struct scan_field *fields,
+		tap_state_t endstate);
+int interface_jtag_add_plain_dr_scan_nocopy(
+		int num_bits, const uint8_t *out_bits, uint8_t *in_bits,
+		tap_state_t endstate);
 
 int interface_jtag_add_tlr(void);
 int interface_jtag_add_pathmove(unsigned int num_states, const tap_state_t *path);
@@ -69,6 +75,8 @@ int interface_jtag_add_reset(int trst, int srst);
 int interface_jtag_add_sleep(uint32_t us);
 int interface_jtag_add_clocks(unsigned int num_cycles);
 int interface_jtag_execute_queue(void);
+int interface_jtag_execute_queue_async(jtag_queue_done_callback_t done, void *priv);
+int interface_jtag_execute_queue_wait(void);
 
 /**
  * Calls the interface callback to execute the queue.  This routine
@@ -26,12 +26,45 @@ int swim_system_reset(void)
 	return adapter_driver->swim_ops->srst();
 }
 
+unsigned int swim_max_transfer(void)
+{
+	assert(adapter_driver->swim_ops);
+
+	return adapter_driver->swim_ops->max_transfer;
+}
+
+/*
+ * Split an access in the fewest ROTF/WOTF commands the adapter allows.
+ * Only the last command can be shorter than the maximum size, the units
+ * are never split across two commands.
+ */
+static uint32_t swim_transfer_count(uint32_t size, uint32_t count)
+{
+	unsigned int max_transfer = swim_max_transfer();
+
+	if (!max_transfer || count * size <= max_transfer)
+		return count;
+
+	return MAX(max_transfer / size, 1);
+}
+
 int swim_read_mem(uint32_t addr, uint32_t size, uint32_t count,
 				  uint8_t *buffer)
 {
 	assert(adapter_driver->swim_ops);
 
-	return adapter_driver->swim_ops->read_mem(addr, size, count, buffer);
+	while (count) {
+		uint32_t n = swim_transfer_count(size, count);
+		int retval = adapter_driver->swim_ops->read_mem(addr, size, n, buffer);
+		if (retval != ERROR_OK)
+			return retval;
+
+		addr += n * size;
+		buffer += n * size;
+		count -= n;
+	}
+
+	return ERROR_OK;
 }
 
 int swim_write_mem(uint32_t addr, uint32_t size, uint32_t count,
@@ -39,7 +72,18 @@ int swim_write_mem(uint32_t addr, uint32_t size, uint32_t count,
 {
 	assert(adapter_driver->swim_ops);
 
-	return adapter_driver->swim_ops->write_mem(addr, size, count, buffer);
+	while (count) {
+		uint32_t n = swim_transfer_count(size, count);
+		int retval = adapter_driver->swim_ops->write_mem(addr, size, n, buffer);
+		if (retval != ERROR_OK)
+			return retval;
+
+		addr += n * size;
+		buffer += n * size;
+		count -= n;
+	}
+
+	return ERROR_OK;
 }
 
 int swim_reconnect(void)
@@ -56,6 +56,14 @@ struct swim_driver {
 	 * @return ERROR_OK on success, else a fault code.
 	 */
 	int (*reconnect)(void);
+
+	/**
+	 * Largest number of bytes the adapter moves in a single ROTF or WOTF
+	 * command. Longer accesses are split by swim_read_mem() and
+	 * swim_write_mem(), so read_mem() and write_mem() never get more.
+	 * Zero means no limit.
+	 */
+	unsigned int max_transfer;
 };
 
 int swim_system_reset(void);
@@ -64,5 +72,6 @@ int swim_read_mem(uint32_t addr, uint32_t size, uint32_t count,
 int swim_write_mem(uint32_t addr, uint32_t size, uint32_t count,
 				   const uint8_t *buffer);
 int swim_reconnect(void);
+unsigned int swim_max_transfer(void);
 
 #endif /* OPENOCD_JTAG_SWIM_H */
@@ -26,6 +26,7 @@
 #include "interface.h"
 #include "interfaces.h"
 #include "tcl.h"
+#include "commands.h"
 
 #ifdef HAVE_STRINGS_H
 #include <strings.h>
@@ -686,6 +687,59 @@ COMMAND_HANDLER(handle_jtag_init_command)
 	return jtag_init(CMD_CTX);
 }
 
+COMMAND_HANDLER(handle_jtag_chain_cache)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		bool enable;
+		COMMAND_PARSE_ENABLE(CMD_ARGV[0], enable);
+		jtag_set_chain_cache(enable);
+	}
+
+	const char *status = jtag_will_use_chain_cache() ? "enabled" : "disabled";
+	command_print(CMD, "JTAG chain cache is %s", status);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_jtag_ir_cache)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		bool enable;
+		COMMAND_PARSE_ENABLE(CMD_ARGV[0], enable);
+		jtag_set_ir_cache(enable);
+	}
+
+	const char *status = jtag_will_use_ir_cache() ? "enabled" : "disabled";
+	command_print(CMD, "JTAG IR cache is %s", status);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_jtag_queue_stats)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct cmd_queue_stats stats;
+	cmd_queue_get_stats(&stats);
+
+	command_print(CMD, "pages in use:    %u", stats.pages_in_use);
+	command_print(CMD, "peak pages:      %u", stats.peak_pages);
+	command_print(CMD, "free pages:      %u", stats.free_pages);
+	command_print(CMD, "bytes in use:    %zu", stats.bytes_in_use);
+	command_print(CMD, "peak bytes:      %zu", stats.peak_bytes);
+	command_print(CMD, "page allocs:     %llu", stats.page_allocs);
+	command_print(CMD, "page reuse hits: %llu", stats.reuse_hits);
+
+	return ERROR_OK;
+}
+
 static const struct command_registration jtag_subcommand_handlers[] = {
 	{
 		.name = "init",
@@ -774,6 +828,29 @@ static const struct command_registration jtag_subcommand_handlers[] = {
 		.help = "Returns list of all JTAG tap names.",
 		.usage = "",
 	},
+	{
+		.name = "chain_cache",
+		.mode = COMMAND_ANY,
+		.handler = handle_jtag_chain_cache,
+		.help = "Enable or disable skipping the full examination of "
+			"a scan chain found unchanged since the last one.",
+		.usage = "['enable'|'disable']",
+	},
+	{
+		.name = "ir_cache",
+		.mode = COMMAND_ANY,
+		.handler = handle_jtag_ir_cache,
+		.help = "Enable or disable skipping IR scans which would select "
+			"the instruction already selected.",
+		.usage = "['enable'|'disable']",
+	},
+	{
+		.name = "queue_stats",
+		.mode = COMMAND_ANY,
+		.handler = handle_jtag_queue_stats,
+		.help = "Show memory usage statistics of the JTAG command queue.",
+		.usage = "",
+	},
 	{
 		.chain = jtag_command_handlers_to_move,
 	},
@@ -21,6 +21,8 @@
 #include <transport/transport.h>
 #include <helper/util.h>
 #include <helper/configuration.h>
+#include <helper/event_log.h>
+#include <helper/perf.h>
 #include <flash/nor/core.h>
 #include <flash/nand/core.h>
 #include <pld/pld.h>
@@ -32,6 +34,7 @@
 #include <server/server.h>
 #include <server/gdb_server.h>
 #include <server/rtt_server.h>
+#include <server/watch_server.h>
 
 #ifdef HAVE_STRINGS_H
 #include <strings.h>
@@ -237,16 +240,21 @@ static struct command_context *setup_command_handler(Jim_Interp *interp)
 	log_init();
 	LOG_DEBUG("log_init: complete");
 
+	startup_profile_mark("embedded startup.tcl");
 	struct command_context *cmd_ctx = command_init(openocd_startup_tcl, interp);
 
 	/* register subsystem commands */
+	startup_profile_mark("command registration");
 	typedef int (*command_registrant_t)(struct command_context *cmd_ctx_value);
 	static const command_registrant_t command_registrants[] = {
 		&openocd_register_commands,
 		&server_register_commands,
 		&gdb_register_commands,
 		&log_register_commands,
+		&event_log_register_commands,
+		&perf_register_commands,
 		&rtt_server_register_commands,
+		&watch_server_register_commands,
 		&transport_register_commands,
 		&adapter_register_commands,
 		&target_register_commands,
@@ -298,11 +306,13 @@ static int openocd_thread(int argc, char *argv[], struct command_context *cmd_ct
 		return ERROR_FAIL;
 	}
 
+	startup_profile_mark("server init");
 	ret = server_init(cmd_ctx);
 	if (ret != ERROR_OK)
 		return ERROR_FAIL;
 
 	if (init_at_startup) {
+		startup_profile_mark("init");
 		ret = command_run_line(cmd_ctx, "init");
 		if (ret != ERROR_OK) {
 			server_quit();
@@ -310,6 +320,8 @@ static int openocd_thread(int argc, char *argv[], struct command_context *cmd_ct
 		}
 	}
 
+	startup_profile_report();
+
 	ret = server_loop(cmd_ctx);
 
 	int last_signal = server_quit();
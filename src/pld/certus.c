@@ -160,7 +160,7 @@ static int lattice_certus_program_config_map(struct jtag_tap *tap, struct lattic
 	field.num_bits = (bit_file->raw_bit.length - bit_file->offset) * 8;
 	field.out_value = bit_file->raw_bit.data + bit_file->offset;
 	field.in_value = NULL;
-	jtag_add_dr_scan(tap, 1, &field, TAP_IDLE);
+	jtag_add_dr_scan_nocopy(tap, 1, &field, TAP_IDLE);
 
 	return jtag_execute_queue();
 }
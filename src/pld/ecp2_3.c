@@ -144,7 +144,7 @@ static int lattice_ecp2_3_program_config_map(struct lattice_pld_device *lattice_
 	field.num_bits = (bit_file->raw_bit.length - bit_file->offset) * 8;
 	field.out_value = bit_file->raw_bit.data + bit_file->offset;
 	field.in_value = NULL;
-	jtag_add_dr_scan(tap, 1, &field, TAP_IDLE);
+	jtag_add_dr_scan_nocopy(tap, 1, &field, TAP_IDLE);
 	jtag_add_runtest(256, TAP_IDLE);
 	jtag_add_sleep(2000);
 	return jtag_execute_queue();
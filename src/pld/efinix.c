@@ -186,7 +186,7 @@ static int efinix_load(struct pld_device *pld_device, const char *filename)
 	field[1].out_value = buf;
 	field[1].in_value = NULL;
 
-	jtag_add_dr_scan(tap, 2, field, TAP_DRPAUSE);
+	jtag_add_dr_scan_nocopy(tap, 2, field, TAP_DRPAUSE);
 	retval = jtag_execute_queue();
 	free(bit_file.data);
 	free(buf);
@@ -203,7 +203,7 @@ static int gatemate_load(struct pld_device *pld_device, const char *filename)
 	field.num_bits = bit_file.raw_file.length * 8;
 	field.out_value = bit_file.raw_file.data;
 	field.in_value = NULL;
-	jtag_add_dr_scan(tap, 1, &field, TAP_IDLE);
+	jtag_add_dr_scan_nocopy(tap, 1, &field, TAP_IDLE);
 
 	retval = jtag_execute_queue();
 	free(bit_file.raw_file.data);
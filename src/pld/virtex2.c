@@ -225,41 +225,130 @@ static int virtex2_load_cleanup(struct pld_device *pld_device)
 	return jtag_execute_queue();
 }
 
-static int virtex2_load(struct pld_device *pld_device, const char *filename)
+/* the bitstream is shifted in chunks of this size, so memory use stays bounded */
+#define VIRTEX2_LOAD_CHUNK_SIZE (1024 * 1024)
+
+static void virtex2_chunk_done(int retval, void *priv)
 {
-	struct virtex2_pld_device *virtex2_info = pld_device->driver_priv;
-	struct xilinx_bit_file bit_file;
-	int retval;
-	unsigned int i;
-	struct scan_field field;
+	int *result = priv;
 
-	field.in_value = NULL;
+	if (*result == ERROR_OK)
+		*result = retval;
+}
 
-	retval = xilinx_read_bit_file(&bit_file, filename);
-	if (retval != ERROR_OK)
-		return retval;
+/*
+ * Shift @a length bytes of @a input_file into the DR of @a tap as a single
+ * Shift-DR pass, split into plain scans that stay in Shift-DR in between.
+ * The bypass bits of the other TAPs are shifted before the first and after
+ * the last chunk, as jtag_add_dr_scan() would place them.
+ * Two buffers alternate, so the next chunk is read from the file while the
+ * adapter shifts the previous one.
+ */
+static int virtex2_shift_bitstream(struct jtag_tap *tap, FILE *input_file, size_t length)
+{
+	unsigned int bypass_before = 0, bypass_after = 0;
+	bool seen = false;
 
-	retval = virtex2_load_prepare(pld_device);
-	if (retval != ERROR_OK) {
-		xilinx_free_bit_file(&bit_file);
-		return retval;
+	if (!length) {
+		LOG_ERROR("empty bitstream");
+		return ERROR_PLD_FILE_LOAD_FAILED;
 	}
 
-	for (i = 0; i < bit_file.length; i++)
-		bit_file.data[i] = flip_u32(bit_file.data[i], 8);
+	for (struct jtag_tap *t = jtag_tap_next_enabled(NULL); t; t = jtag_tap_next_enabled(t)) {
+		if (t == tap)
+			seen = true;
+		else if (seen)
+			bypass_after++;
+		else
+			bypass_before++;
+	}
 
-	field.num_bits = bit_file.length * 8;
-	field.out_value = bit_file.data;
+	uint8_t *buffers[2] = {
+		malloc(MIN(length, VIRTEX2_LOAD_CHUNK_SIZE)),
+		malloc(MIN(length, VIRTEX2_LOAD_CHUNK_SIZE)),
+	};
+	uint8_t *bypass = calloc(DIV_ROUND_UP(jtag_tap_count_enabled(), 8), 1);
+	if (!buffers[0] || !buffers[1] || !bypass) {
+		LOG_ERROR("Out of memory");
+		free(buffers[0]);
+		free(buffers[1]);
+		free(bypass);
+		return ERROR_FAIL;
+	}
 
-	jtag_add_dr_scan(virtex2_info->tap, 1, &field, TAP_DRPAUSE);
-	retval = jtag_execute_queue();
-	if (retval != ERROR_OK) {
-		xilinx_free_bit_file(&bit_file);
-		return retval;
+	if (bypass_before)
+		jtag_add_plain_dr_scan_nocopy(bypass_before, bypass, NULL, TAP_DRSHIFT);
+
+	int retval = ERROR_OK;
+	/* result of the chunks in flight */
+	int shift_retval = ERROR_OK;
+	size_t done = 0;
+	unsigned int chunk = 0;
+	while (done < length) {
+		size_t size = MIN(length - done, VIRTEX2_LOAD_CHUNK_SIZE);
+		/* the chunk which used this buffer completed when the last one was submitted */
+		uint8_t *buffer = buffers[chunk++ % 2];
+
+		if (fread(buffer, 1, size, input_file) != size) {
+			LOG_ERROR("couldn't read bitstream");
+			retval = ERROR_PLD_FILE_LOAD_FAILED;
+			break;
+		}
+
+		for (size_t i = 0; i < size; i++)
+			buffer[i] = flip_u32(buffer[i], 8);
+
+		done += size;
+		bool last = (done == length && !bypass_after);
+		jtag_add_plain_dr_scan_nocopy(size * 8, buffer, NULL,
+			last ? TAP_DRPAUSE : TAP_DRSHIFT);
+
+		retval = jtag_execute_queue_async(virtex2_chunk_done, &shift_retval);
+		if (retval == ERROR_OK)
+			retval = shift_retval;
+		if (retval != ERROR_OK)
+			break;
+
+		LOG_DEBUG("virtex2: %zu of %zu bytes submitted", done, length);
+	}
+
+	/* complete the last chunk before its buffer is freed */
+	int wait_retval = jtag_execute_queue_wait();
+	if (retval == ERROR_OK)
+		retval = wait_retval;
+	if (retval == ERROR_OK)
+		retval = shift_retval;
+
+	if (retval == ERROR_OK && bypass_after) {
+		jtag_add_plain_dr_scan_nocopy(bypass_after, bypass, NULL, TAP_DRPAUSE);
+		retval = jtag_execute_queue();
 	}
 
-	retval = virtex2_load_cleanup(pld_device);
+	free(buffers[0]);
+	free(buffers[1]);
+	free(bypass);
+
+	return retval;
+}
+
+static int virtex2_load(struct pld_device *pld_device, const char *filename)
+{
+	struct virtex2_pld_device *virtex2_info = pld_device->driver_priv;
+	struct xilinx_bit_file bit_file;
+	FILE *input_file;
+	int retval;
+
+	retval = xilinx_open_bit_file(&bit_file, filename, &input_file);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = virtex2_load_prepare(pld_device);
+	if (retval == ERROR_OK)
+		retval = virtex2_shift_bitstream(virtex2_info->tap, input_file, bit_file.length);
+	if (retval == ERROR_OK)
+		retval = virtex2_load_cleanup(pld_device);
 
+	fclose(input_file);
 	xilinx_free_bit_file(&bit_file);
 
 	return retval;
@@ -15,11 +15,10 @@
 
 #include <helper/system.h>
 
-static int read_section(FILE *input_file, int length_size, char section,
-	uint32_t *buffer_length, uint8_t **buffer)
+static int read_section_length(FILE *input_file, int length_size, char section,
+	uint32_t *length)
 {
 	uint8_t length_buffer[4];
-	int length;
 	char section_char;
 	int read_count;
 
@@ -40,14 +39,29 @@ static int read_section(FILE *input_file, int length_size, char section,
 		return ERROR_PLD_FILE_LOAD_FAILED;
 
 	if (length_size == 4)
-		length = be_to_h_u32(length_buffer);
+		*length = be_to_h_u32(length_buffer);
 	else	/* (length_size == 2) */
-		length = be_to_h_u16(length_buffer);
+		*length = be_to_h_u16(length_buffer);
+
+	return ERROR_OK;
+}
+
+static int read_section(FILE *input_file, int length_size, char section,
+	uint32_t *buffer_length, uint8_t **buffer)
+{
+	uint32_t length;
+	size_t read_count;
+
+	int retval = read_section_length(input_file, length_size, section, &length);
+	if (retval != ERROR_OK)
+		return retval;
 
 	if (buffer_length)
 		*buffer_length = length;
 
 	*buffer = malloc(length);
+	if (!*buffer)
+		return ERROR_PLD_FILE_LOAD_FAILED;
 
 	read_count = fread(*buffer, 1, length, input_file);
 	if (read_count != length)
@@ -56,12 +70,18 @@ static int read_section(FILE *input_file, int length_size, char section,
 	return ERROR_OK;
 }
 
-int xilinx_read_bit_file(struct xilinx_bit_file *bit_file, const char *filename)
+/**
+ * Read the header of a bit file. On success @a data_file is left open at
+ * the start of the bitstream, @a bit_file->length bytes long, and
+ * @a bit_file->data is not allocated.
+ */
+int xilinx_open_bit_file(struct xilinx_bit_file *bit_file, const char *filename,
+	FILE **data_file)
 {
 	FILE *input_file;
 	int read_count;
 
-	if (!filename || !bit_file)
+	if (!filename || !bit_file || !data_file)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
 	input_file = fopen(filename, "rb");
@@ -83,39 +103,41 @@ int xilinx_read_bit_file(struct xilinx_bit_file *bit_file, const char *filename)
 		return ERROR_PLD_FILE_LOAD_FAILED;
 	}
 
-	if (read_section(input_file, 2, 'a', NULL, &bit_file->source_file) != ERROR_OK) {
+	if (read_section(input_file, 2, 'a', NULL, &bit_file->source_file) != ERROR_OK ||
+			read_section(input_file, 2, 'b', NULL, &bit_file->part_name) != ERROR_OK ||
+			read_section(input_file, 2, 'c', NULL, &bit_file->date) != ERROR_OK ||
+			read_section(input_file, 2, 'd', NULL, &bit_file->time) != ERROR_OK ||
+			read_section_length(input_file, 4, 'e', &bit_file->length) != ERROR_OK) {
 		xilinx_free_bit_file(bit_file);
 		fclose(input_file);
 		return ERROR_PLD_FILE_LOAD_FAILED;
 	}
 
-	if (read_section(input_file, 2, 'b', NULL, &bit_file->part_name) != ERROR_OK) {
-		xilinx_free_bit_file(bit_file);
-		fclose(input_file);
-		return ERROR_PLD_FILE_LOAD_FAILED;
-	}
+	LOG_DEBUG("bit_file: %s %s %s,%s %" PRIu32 "", bit_file->source_file, bit_file->part_name,
+		bit_file->date, bit_file->time, bit_file->length);
 
-	if (read_section(input_file, 2, 'c', NULL, &bit_file->date) != ERROR_OK) {
-		xilinx_free_bit_file(bit_file);
-		fclose(input_file);
-		return ERROR_PLD_FILE_LOAD_FAILED;
-	}
+	*data_file = input_file;
 
-	if (read_section(input_file, 2, 'd', NULL, &bit_file->time) != ERROR_OK) {
-		xilinx_free_bit_file(bit_file);
-		fclose(input_file);
-		return ERROR_PLD_FILE_LOAD_FAILED;
-	}
+	return ERROR_OK;
+}
+
+int xilinx_read_bit_file(struct xilinx_bit_file *bit_file, const char *filename)
+{
+	FILE *input_file;
 
-	if (read_section(input_file, 4, 'e', &bit_file->length, &bit_file->data) != ERROR_OK) {
+	int retval = xilinx_open_bit_file(bit_file, filename, &input_file);
+	if (retval != ERROR_OK)
+		return retval;
+
+	bit_file->data = malloc(bit_file->length);
+	if (!bit_file->data ||
+			fread(bit_file->data, 1, bit_file->length, input_file) != bit_file->length) {
+		LOG_ERROR("couldn't read bitstream from file '%s'", filename);
 		xilinx_free_bit_file(bit_file);
 		fclose(input_file);
 		return ERROR_PLD_FILE_LOAD_FAILED;
 	}
 
-	LOG_DEBUG("bit_file: %s %s %s,%s %" PRIu32 "", bit_file->source_file, bit_file->part_name,
-		bit_file->date, bit_file->time, bit_file->length);
-
 	fclose(input_file);
 
 	return ERROR_OK;
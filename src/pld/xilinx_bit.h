@@ -9,6 +9,7 @@
 #define OPENOCD_PLD_XILINX_BIT_H
 
 #include "helper/types.h"
+#include <stdio.h>
 
 struct xilinx_bit_file {
 	uint8_t unknown_header[13];
@@ -21,6 +22,8 @@ struct xilinx_bit_file {
 };
 
 int xilinx_read_bit_file(struct xilinx_bit_file *bit_file, const char *filename);
+int xilinx_open_bit_file(struct xilinx_bit_file *bit_file, const char *filename,
+	FILE **data_file);
 
 void xilinx_free_bit_file(struct xilinx_bit_file *bit_file);
 
@@ -75,6 +75,7 @@ static const struct freertos_params freertos_params_list[] = {
 static bool freertos_detect_rtos(struct target *target);
 static int freertos_create(struct target *target);
 static int freertos_update_threads(struct rtos *rtos);
+static int freertos_thread_list_signature(struct rtos *rtos, uint32_t *signature);
 static int freertos_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 		struct rtos_reg **reg_list, int *num_regs);
 static int freertos_get_symbol_list_to_lookup(struct symbol_table_elem *symbol_list[]);
@@ -85,6 +86,7 @@ const struct rtos_type freertos_rtos = {
 	.detect_rtos = freertos_detect_rtos,
 	.create = freertos_create,
 	.update_threads = freertos_update_threads,
+	.thread_list_signature = freertos_thread_list_signature,
 	.get_thread_reg_list = freertos_get_thread_reg_list,
 	.get_symbol_list_to_lookup = freertos_get_symbol_list_to_lookup,
 };
@@ -130,6 +132,40 @@ static const struct symbols freertos_symbol_list[] = {
 /* may be problems reading if sizes are not 32 bit long integers. */
 /* test mallocs for failure */
 
+struct freertos_walk {
+	const struct freertos_params *param;
+	uint32_t thread_list_size;
+	uint32_t tasks_found;
+	/* items left to read in each list */
+	uint32_t *list_counts;
+};
+
+static int freertos_list_node(struct rtos *rtos, unsigned int list,
+		target_addr_t node, const uint8_t *data, target_addr_t *next, void *priv)
+{
+	struct freertos_walk *walk = priv;
+
+	if (walk->tasks_found >= walk->thread_list_size)
+		return ERROR_OK;
+
+	struct thread_detail *detail = &rtos->thread_details[walk->tasks_found++];
+	detail->threadid = target_buffer_get_u32(rtos->target, data);
+	detail->thread_name_str = NULL;
+	detail->extra_info_str = NULL;
+	LOG_DEBUG("FreeRTOS: Read Thread ID at 0x%" PRIx64 ", value 0x%" PRIx64,
+										node + walk->param->list_elem_content_offset,
+										detail->threadid);
+
+	if (--walk->list_counts[list] > 0) {
+		*next = target_buffer_get_u32(rtos->target, data + walk->param->pointer_width);
+		LOG_DEBUG("FreeRTOS: Read next thread location at 0x%" PRIx64 ", value 0x%" PRIx64,
+										node + walk->param->list_elem_next_offset,
+										*next);
+	}
+
+	return ERROR_OK;
+}
+
 static int freertos_update_threads(struct rtos *rtos)
 {
 	int retval;
@@ -273,116 +309,199 @@ static int freertos_update_threads(struct rtos *rtos)
 	list_of_lists[num_lists++] = rtos->symbols[FREERTOS_VAL_X_SUSPENDED_TASK_LIST].address;
 	list_of_lists[num_lists++] = rtos->symbols[FREERTOS_VAL_X_TASKS_WAITING_TERMINATION].address;
 
+	/* Read the headers of all lists at once */
+	uint8_t *headers = malloc(num_lists * param->list_width);
+	struct target_memory_sg *ranges = malloc(num_lists * sizeof(*ranges));
+	struct freertos_walk walk = {
+		.param = param,
+		.thread_list_size = thread_list_size,
+		.tasks_found = tasks_found,
+		.list_counts = calloc(num_lists, sizeof(uint32_t)),
+	};
+	target_addr_t *nodes = calloc(num_lists, sizeof(*nodes));
+	if (!headers || !ranges || !walk.list_counts || !nodes) {
+		LOG_ERROR("Out of memory");
+		retval = ERROR_FAIL;
+		goto out;
+	}
+
+	unsigned int num_ranges = 0;
 	for (unsigned int i = 0; i < num_lists; i++) {
 		if (list_of_lists[i] == 0)
 			continue;
+		target_memory_sg_range(&ranges[num_ranges++], list_of_lists[i], param->list_width,
+			headers + i * param->list_width);
+	}
+	retval = target_read_memory_sg(rtos->target, ranges, num_ranges);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error reading FreeRTOS thread lists");
+		goto out;
+	}
 
-		/* Read the number of threads in this list */
-		uint32_t list_thread_count = 0;
-		retval = target_read_u32(rtos->target,
-				list_of_lists[i],
-				&list_thread_count);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading number of threads in FreeRTOS thread list");
-			free(list_of_lists);
-			return retval;
-		}
-		LOG_DEBUG("FreeRTOS: Read thread count for list %u at 0x%" PRIx64 ", value %" PRIu32,
-										i, list_of_lists[i], list_thread_count);
+	for (unsigned int i = 0; i < num_lists; i++) {
+		if (list_of_lists[i] == 0)
+			continue;
 
-		if (list_thread_count == 0)
+		const uint8_t *header = headers + i * param->list_width;
+		walk.list_counts[i] = target_buffer_get_u32(rtos->target, header);
+		LOG_DEBUG("FreeRTOS: Read thread count for list %u at 0x%" PRIx64 ", value %" PRIu32,
+										i, list_of_lists[i], walk.list_counts[i]);
+		if (walk.list_counts[i] == 0)
 			continue;
 
-		/* Read the location of first list item */
-		uint32_t prev_list_elem_ptr = -1;
-		uint32_t list_elem_ptr = 0;
-		retval = target_read_u32(rtos->target,
-				list_of_lists[i] + param->list_next_offset,
-				&list_elem_ptr);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading first thread item location in FreeRTOS thread list");
-			free(list_of_lists);
-			return retval;
-		}
-		LOG_DEBUG("FreeRTOS: Read first item for list %u at 0x%" PRIx64 ", value 0x%" PRIx32,
-										i, list_of_lists[i] + param->list_next_offset, list_elem_ptr);
-
-		while ((list_thread_count > 0) && (list_elem_ptr != 0) &&
-				(list_elem_ptr != prev_list_elem_ptr) &&
-				(tasks_found < thread_list_size)) {
-			/* Get the location of the thread structure. */
-			retval = target_read_u32(rtos->target,
-					list_elem_ptr + param->list_elem_content_offset,
-					&pointer_casts_are_bad);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Error reading thread list item object in FreeRTOS thread list");
-				free(list_of_lists);
-				return retval;
-			}
-			rtos->thread_details[tasks_found].threadid = pointer_casts_are_bad;
-			LOG_DEBUG("FreeRTOS: Read Thread ID at 0x%" PRIx32 ", value 0x%" PRIx64,
-										list_elem_ptr + param->list_elem_content_offset,
-										rtos->thread_details[tasks_found].threadid);
+		nodes[i] = target_buffer_get_u32(rtos->target, header + param->list_next_offset);
+		LOG_DEBUG("FreeRTOS: Read first item for list %u at 0x%" PRIx64 ", value 0x%" PRIx64,
+										i, list_of_lists[i] + param->list_next_offset, nodes[i]);
+	}
 
-			/* get thread name */
+	/* Walk all lists in parallel, reading the thread ID and the next item */
+	const struct rtos_list_field fields[] = {
+		{ param->list_elem_content_offset, param->pointer_width },
+		{ param->list_elem_next_offset, param->pointer_width },
+	};
+	retval = rtos_walk_lists(rtos, nodes, num_lists, fields, ARRAY_SIZE(fields),
+			freertos_list_node, &walk);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error reading FreeRTOS thread list items");
+		goto out;
+	}
 
-			#define FREERTOS_THREAD_NAME_STR_SIZE (200)
-			char tmp_str[FREERTOS_THREAD_NAME_STR_SIZE];
+	/* Read the names of all threads at once */
+	#define FREERTOS_THREAD_NAME_STR_SIZE (200)
+	unsigned int first_task = tasks_found;
+	unsigned int num_tasks = walk.tasks_found - first_task;
+	char *names = malloc(num_tasks * FREERTOS_THREAD_NAME_STR_SIZE);
+	struct target_memory_sg *name_ranges = malloc(num_tasks * sizeof(*name_ranges));
+	if (!names || !name_ranges) {
+		LOG_ERROR("Out of memory");
+		free(name_ranges);
+		free(names);
+		retval = ERROR_FAIL;
+		goto out;
+	}
+	for (unsigned int i = 0; i < num_tasks; i++)
+		target_memory_sg_range(&name_ranges[i],
+			rtos->thread_details[first_task + i].threadid + param->thread_name_offset,
+			FREERTOS_THREAD_NAME_STR_SIZE,
+			(uint8_t *)names + i * FREERTOS_THREAD_NAME_STR_SIZE);
+	retval = target_read_memory_sg(rtos->target, name_ranges, num_tasks);
+	free(name_ranges);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error reading FreeRTOS thread names");
+		free(names);
+		goto out;
+	}
 
-			/* Read the thread name */
-			retval = target_read_buffer(rtos->target,
-					rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
-					FREERTOS_THREAD_NAME_STR_SIZE,
-					(uint8_t *)&tmp_str);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Error reading first thread item location in FreeRTOS thread list");
-				free(list_of_lists);
-				return retval;
-			}
-			tmp_str[FREERTOS_THREAD_NAME_STR_SIZE-1] = '\x00';
-			LOG_DEBUG("FreeRTOS: Read Thread Name at 0x%" PRIx64 ", value '%s'",
-										rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
+	for (unsigned int i = 0; i < num_tasks; i++) {
+		struct thread_detail *detail = &rtos->thread_details[first_task + i];
+		char *tmp_str = names + i * FREERTOS_THREAD_NAME_STR_SIZE;
+
+		tmp_str[FREERTOS_THREAD_NAME_STR_SIZE-1] = '\x00';
+		LOG_DEBUG("FreeRTOS: Read Thread Name at 0x%" PRIx64 ", value '%s'",
+										detail->threadid + param->thread_name_offset,
 										tmp_str);
 
-			if (tmp_str[0] == '\x00')
-				strcpy(tmp_str, "No Name");
-
-			rtos->thread_details[tasks_found].thread_name_str =
-				malloc(strlen(tmp_str)+1);
-			strcpy(rtos->thread_details[tasks_found].thread_name_str, tmp_str);
-			rtos->thread_details[tasks_found].exists = true;
-
-			if (rtos->thread_details[tasks_found].threadid == rtos->current_thread) {
-				char running_str[] = "State: Running";
-				rtos->thread_details[tasks_found].extra_info_str = malloc(
-						sizeof(running_str));
-				strcpy(rtos->thread_details[tasks_found].extra_info_str,
-					running_str);
-			} else
-				rtos->thread_details[tasks_found].extra_info_str = NULL;
-
-			tasks_found++;
-			list_thread_count--;
-			rtos->thread_count = tasks_found;
-
-			prev_list_elem_ptr = list_elem_ptr;
-			list_elem_ptr = 0;
-			retval = target_read_u32(rtos->target,
-					prev_list_elem_ptr + param->list_elem_next_offset,
-					&list_elem_ptr);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Error reading next thread item location in FreeRTOS thread list");
-				free(list_of_lists);
-				return retval;
-			}
-			LOG_DEBUG("FreeRTOS: Read next thread location at 0x%" PRIx32 ", value 0x%" PRIx32,
-										prev_list_elem_ptr + param->list_elem_next_offset,
-										list_elem_ptr);
+		if (tmp_str[0] == '\x00')
+			strcpy(tmp_str, "No Name");
+
+		detail->thread_name_str = malloc(strlen(tmp_str)+1);
+		strcpy(detail->thread_name_str, tmp_str);
+		detail->exists = true;
+
+		if (detail->threadid == rtos->current_thread) {
+			char running_str[] = "State: Running";
+			detail->extra_info_str = malloc(sizeof(running_str));
+			strcpy(detail->extra_info_str, running_str);
+		} else
+			detail->extra_info_str = NULL;
+
+		rtos->thread_count = first_task + i + 1;
+	}
+	free(names);
+	retval = ERROR_OK;
+
+out:
+	free(nodes);
+	free(walk.list_counts);
+	free(ranges);
+	free(headers);
+	free(list_of_lists);
+	return retval;
+}
+
+static uint32_t freertos_hash(uint32_t hash, const uint8_t *data, size_t len)
+{
+	/* FNV-1a */
+	for (size_t i = 0; i < len; i++)
+		hash = (hash ^ data[i]) * 16777619u;
+	return hash;
+}
+
+/* FreeRTOS has no counter of thread list changes, so hash the current TCB,
+ * the task count and the headers of all task lists instead. A task moving
+ * between lists changes the item counts and the list pointers, at the cost
+ * of a handful of block reads instead of several reads per task. */
+static int freertos_thread_list_signature(struct rtos *rtos, uint32_t *signature)
+{
+	const struct freertos_params *param = rtos->rtos_specific_params;
+	int retval;
+
+	if (!param || !rtos->symbols ||
+			rtos->symbols[FREERTOS_VAL_UX_TOP_USED_PRIORITY].address == 0)
+		return ERROR_FAIL;
+
+	static const enum freertos_symbol_values words[] = {
+		FREERTOS_VAL_PX_CURRENT_TCB,
+		FREERTOS_VAL_UX_CURRENT_NUMBER_OF_TASKS,
+		FREERTOS_VAL_X_SCHEDULER_RUNNING,
+		FREERTOS_VAL_UX_TOP_USED_PRIORITY,
+	};
+	uint32_t hash = 2166136261u;
+	uint32_t top_used_priority = 0;
+	for (unsigned int i = 0; i < ARRAY_SIZE(words); i++) {
+		uint8_t value[4];
+		retval = target_read_buffer(rtos->target, rtos->symbols[words[i]].address,
+				sizeof(value), value);
+		if (retval != ERROR_OK)
+			return retval;
+		hash = freertos_hash(hash, value, sizeof(value));
+		if (words[i] == FREERTOS_VAL_UX_TOP_USED_PRIORITY)
+			top_used_priority = target_buffer_get_u32(rtos->target, value);
+	}
+
+	if (top_used_priority > FREERTOS_MAX_PRIORITIES)
+		return ERROR_FAIL;
+
+	static const enum freertos_symbol_values lists[] = {
+		FREERTOS_VAL_PX_READY_TASKS_LISTS,
+		FREERTOS_VAL_X_DELAYED_TASK_LIST1,
+		FREERTOS_VAL_X_DELAYED_TASK_LIST2,
+		FREERTOS_VAL_X_PENDING_READY_LIST,
+		FREERTOS_VAL_X_SUSPENDED_TASK_LIST,
+		FREERTOS_VAL_X_TASKS_WAITING_TERMINATION,
+	};
+	uint8_t *headers = malloc((top_used_priority + 1) * param->list_width);
+	if (!headers)
+		return ERROR_FAIL;
+	for (unsigned int i = 0; i < ARRAY_SIZE(lists); i++) {
+		symbol_address_t address = rtos->symbols[lists[i]].address;
+		if (address == 0)
+			continue;
+		/* the ready lists are an array of one list per priority */
+		uint32_t size = param->list_width;
+		if (lists[i] == FREERTOS_VAL_PX_READY_TASKS_LISTS)
+			size *= top_used_priority + 1;
+		retval = target_read_buffer(rtos->target, address, size, headers);
+		if (retval != ERROR_OK) {
+			free(headers);
+			return retval;
 		}
+		hash = freertos_hash(hash, headers, size);
 	}
+	free(headers);
 
-	free(list_of_lists);
-	return 0;
+	*signature = hash;
+	return ERROR_OK;
 }
 
 static int freertos_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
@@ -254,6 +254,60 @@ static int is_thread_id_valid_arm926ejs(const struct rtos *rtos, int64_t thread_
 	return (thread_id != 0 && thread_id != 1);
 }
 
+struct threadx_walk {
+	const struct threadx_params *param;
+	int thread_list_size;
+	int tasks_found;
+	/* name pointer of each thread */
+	target_addr_t *name_ptrs;
+};
+
+static target_addr_t threadx_get_ptr(struct target *target,
+		const struct threadx_params *param, const uint8_t *data)
+{
+	if (param->pointer_width == 8)
+		return target_buffer_get_u64(target, data);
+	return target_buffer_get_u32(target, data);
+}
+
+static int threadx_thread_node(struct rtos *rtos, unsigned int list,
+		target_addr_t node, const uint8_t *data, target_addr_t *next, void *priv)
+{
+	struct threadx_walk *walk = priv;
+	const struct threadx_params *param = walk->param;
+	struct thread_detail *detail = &rtos->thread_details[walk->tasks_found];
+	unsigned int i;
+
+	/* Save the thread pointer */
+	detail->threadid = node;
+	walk->name_ptrs[walk->tasks_found] = threadx_get_ptr(rtos->target, param, data);
+
+	int64_t thread_status = target_buffer_get_u32(rtos->target,
+			data + param->pointer_width);
+	for (i = 0; (i < THREADX_NUM_STATES) &&
+			(threadx_thread_states[i].value != thread_status); i++) {
+		/* empty */
+	}
+
+	const char *state_desc;
+	if  (i < THREADX_NUM_STATES)
+		state_desc = threadx_thread_states[i].desc;
+	else
+		state_desc = "Unknown state";
+
+	detail->thread_name_str = NULL;
+	detail->extra_info_str = malloc(strlen(state_desc)+8);
+	sprintf(detail->extra_info_str, "State: %s", state_desc);
+
+	detail->exists = true;
+
+	/* Get the location of the next thread structure. */
+	if (++walk->tasks_found < walk->thread_list_size)
+		*next = threadx_get_ptr(rtos->target, param, data + param->pointer_width + 4);
+
+	return ERROR_OK;
+}
+
 static int threadx_update_threads(struct rtos *rtos)
 {
 	int retval;
@@ -346,94 +400,74 @@ static int threadx_update_threads(struct rtos *rtos)
 		return retval;
 	}
 
-	/* loop over all threads */
-	int64_t prev_thread_ptr = 0;
-	while ((thread_ptr != prev_thread_ptr) && (tasks_found < thread_list_size)) {
-
-		#define THREADX_THREAD_NAME_STR_SIZE (200)
-		char tmp_str[THREADX_THREAD_NAME_STR_SIZE];
-		unsigned int i = 0;
-		int64_t name_ptr = 0;
-
-		/* Save the thread pointer */
-		rtos->thread_details[tasks_found].threadid = thread_ptr;
-
-		/* read the name pointer */
-		retval = target_read_buffer(rtos->target,
-				thread_ptr + param->thread_name_offset,
-				param->pointer_width,
-				(uint8_t *)&name_ptr);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Could not read ThreadX thread name pointer from target");
-			return retval;
-		}
+	/* Walk the created thread list, reading the name pointer, the state and
+	 * the next pointer of a thread at once */
+	struct threadx_walk walk = {
+		.param = param,
+		.thread_list_size = thread_list_size,
+		.tasks_found = tasks_found,
+		.name_ptrs = calloc(thread_list_size, sizeof(target_addr_t)),
+	};
+	if (!walk.name_ptrs) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
 
-		/* Read the thread name */
-		tmp_str[0] = '\x00';
+	const struct rtos_list_field fields[] = {
+		{ param->thread_name_offset, param->pointer_width },
+		{ param->thread_state_offset, 4 },
+		{ param->thread_next_offset, param->pointer_width },
+	};
+	target_addr_t node = thread_ptr;
+	retval = rtos_walk_lists(rtos, &node, 1, fields, ARRAY_SIZE(fields),
+			threadx_thread_node, &walk);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error reading ThreadX thread list");
+		free(walk.name_ptrs);
+		return retval;
+	}
 
+	/* Read the names of all threads at once */
+	#define THREADX_THREAD_NAME_STR_SIZE (200)
+	char *names = calloc(thread_list_size, THREADX_THREAD_NAME_STR_SIZE);
+	struct target_memory_sg *ranges = malloc(thread_list_size * sizeof(*ranges));
+	if (!names || !ranges) {
+		LOG_ERROR("Out of memory");
+		free(ranges);
+		free(names);
+		free(walk.name_ptrs);
+		return ERROR_FAIL;
+	}
+
+	unsigned int num_ranges = 0;
+	for (int i = tasks_found; i < walk.tasks_found; i++) {
 		/* Check if thread has a valid name */
-		if (name_ptr != 0) {
-			retval =
-				target_read_buffer(rtos->target,
-					name_ptr,
-					THREADX_THREAD_NAME_STR_SIZE,
-					(uint8_t *)&tmp_str);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Error reading thread name from ThreadX target");
-				return retval;
-			}
-			tmp_str[THREADX_THREAD_NAME_STR_SIZE - 1] = '\x00';
-		}
+		if (walk.name_ptrs[i] != 0)
+			target_memory_sg_range(&ranges[num_ranges++], walk.name_ptrs[i],
+				THREADX_THREAD_NAME_STR_SIZE,
+				(uint8_t *)names + i * THREADX_THREAD_NAME_STR_SIZE);
+	}
+	retval = target_read_memory_sg(rtos->target, ranges, num_ranges);
+	free(ranges);
+	free(walk.name_ptrs);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error reading thread name from ThreadX target");
+		free(names);
+		return retval;
+	}
+
+	for (; tasks_found < walk.tasks_found; tasks_found++) {
+		char *tmp_str = names + tasks_found * THREADX_THREAD_NAME_STR_SIZE;
 
+		tmp_str[THREADX_THREAD_NAME_STR_SIZE - 1] = '\x00';
 		if (tmp_str[0] == '\x00')
 			strcpy(tmp_str, "No Name");
 
 		rtos->thread_details[tasks_found].thread_name_str =
 			malloc(strlen(tmp_str)+1);
 		strcpy(rtos->thread_details[tasks_found].thread_name_str, tmp_str);
-
-		/* Read the thread status */
-		int64_t thread_status = 0;
-		retval = target_read_buffer(rtos->target,
-				thread_ptr + param->thread_state_offset,
-				4,
-				(uint8_t *)&thread_status);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading thread state from ThreadX target");
-			return retval;
-		}
-
-		for (i = 0; (i < THREADX_NUM_STATES) &&
-				(threadx_thread_states[i].value != thread_status); i++) {
-			/* empty */
-		}
-
-		const char *state_desc;
-		if  (i < THREADX_NUM_STATES)
-			state_desc = threadx_thread_states[i].desc;
-		else
-			state_desc = "Unknown state";
-
-		rtos->thread_details[tasks_found].extra_info_str = malloc(strlen(
-					state_desc)+8);
-		sprintf(rtos->thread_details[tasks_found].extra_info_str, "State: %s", state_desc);
-
-		rtos->thread_details[tasks_found].exists = true;
-
-		tasks_found++;
-		prev_thread_ptr = thread_ptr;
-
-		/* Get the location of the next thread structure. */
-		thread_ptr = 0;
-		retval = target_read_buffer(rtos->target,
-				prev_thread_ptr + param->thread_next_offset,
-				param->pointer_width,
-				(uint8_t *) &thread_ptr);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading next thread pointer in ThreadX thread list");
-			return retval;
-		}
 	}
+	free(names);
 
 	rtos->thread_count = tasks_found;
 
@@ -82,6 +82,41 @@ static int hwthread_fill_thread(struct rtos *rtos, struct target *curr, int thre
 	return ERROR_OK;
 }
 
+/*
+ * Read the general registers GDB asks for of each halted core, once at
+ * halt, so that the following thread switches, e.g. for "info threads",
+ * are served from the register caches. Failures are not fatal here, the
+ * register access that needs the value reports them.
+ */
+static void hwthread_fetch_registers(struct target *target)
+{
+	struct target_list *head;
+
+	foreach_smp_target(head, target->smp_targets) {
+		struct target *curr = head->target;
+
+		if (!target_was_examined(curr) || curr->state != TARGET_HALTED)
+			continue;
+
+		struct reg **reg_list;
+		int reg_list_size;
+		if (target_get_gdb_reg_list(curr, &reg_list, &reg_list_size,
+				REG_CLASS_GENERAL) != ERROR_OK)
+			continue;
+
+		for (int i = 0; i < reg_list_size; i++) {
+			struct reg *reg = reg_list[i];
+			if (!reg || !reg->exist || reg->hidden || reg->valid)
+				continue;
+			if (register_cache_fetch(curr, reg) != ERROR_OK) {
+				LOG_TARGET_DEBUG(curr, "cannot fetch register %s", reg->name);
+				break;
+			}
+		}
+		free(reg_list);
+	}
+}
+
 static int hwthread_update_threads(struct rtos *rtos)
 {
 	int threads_found = 0;
@@ -198,6 +233,9 @@ static int hwthread_update_threads(struct rtos *rtos)
 
 	rtos->thread_count = threads_found;
 
+	if (target->smp)
+		hwthread_fetch_registers(target);
+
 	/* we found an interesting thread, set it as current */
 	if (current_thread != 0)
 		rtos->current_thread = current_thread;
@@ -315,7 +353,7 @@ static int hwthread_get_thread_reg(struct rtos *rtos, int64_t thread_id,
 		return ERROR_FAIL;
 	}
 
-	if (reg->type->get(reg) != ERROR_OK)
+	if (register_cache_fetch(curr, reg) != ERROR_OK)
 		return ERROR_FAIL;
 
 	rtos_reg->number = reg->number;
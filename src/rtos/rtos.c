@@ -10,6 +10,7 @@
 #endif
 
 #include "rtos.h"
+#include "rtos_elf.h"
 #include "target/target.h"
 #include "helper/log.h"
 #include "helper/binarybuffer.h"
@@ -183,6 +184,74 @@ static struct symbol_table_elem *next_symbol(struct rtos *os, char *cur_symbol,
 	return s;
 }
 
+/* Resolve the symbols of the RTOS, or of each RTOS in turn when
+ * auto-detecting, from the symbol index of the -rtos-elf file. The same
+ * ".lto_priv.0" fallback as in the GDB lookup below is applied.
+ *
+ * Returns 1 if an RTOS has been detected, 0 if not, or -1 when the ELF
+ * file can't be used and the lookup has to go through GDB instead. */
+static int rtos_qsymbol_elf(struct target *target)
+{
+	struct rtos *os = target->rtos;
+	struct rtos_elf_symbols *index;
+	int rtos_detected = 0;
+
+	if (rtos_elf_symbols_load(target->rtos_elf, &index) != ERROR_OK) {
+		LOG_WARNING("RTOS: can't read symbols from %s, asking GDB instead", target->rtos_elf);
+		return -1;
+	}
+
+	while (true) {
+		struct symbol_table_elem *missing = NULL;
+
+		if (!os->symbols)
+			os->type->get_symbol_list_to_lookup(&os->symbols);
+
+		for (struct symbol_table_elem *s = os->symbols; s->symbol_name; s++) {
+			char lto_name[GDB_BUFFER_SIZE / 2 + 1];
+			uint64_t addr = 0;
+
+			if (!rtos_elf_symbols_lookup(index, s->symbol_name, &addr)) {
+				snprintf(lto_name, sizeof(lto_name), "%s.lto_priv.0", s->symbol_name);
+				if (!rtos_elf_symbols_lookup(index, lto_name, &addr) && !s->optional) {
+					missing = s;
+					break;
+				}
+			}
+
+			LOG_DEBUG("RTOS: Address of symbol '%s' is 0x%" PRIx64, s->symbol_name, addr);
+			s->address = addr;
+		}
+
+		if (!missing)
+			break;
+
+		if (!target->rtos_auto_detect) {
+			LOG_WARNING("RTOS %s not detected. (symbol \'%s\' not found in %s)",
+				os->type->name, missing->symbol_name, target->rtos_elf);
+			goto done;
+		}
+
+		if (!rtos_try_next(target)) {
+			LOG_WARNING("No RTOS could be auto-detected!");
+			goto done;
+		}
+	}
+
+	if (!target->rtos_auto_detect) {
+		rtos_detected = 1;
+	} else if (os->type->detect_rtos(target)) {
+		LOG_INFO("Auto-detected RTOS: %s", os->type->name);
+		rtos_detected = 1;
+	} else {
+		LOG_WARNING("No RTOS could be auto-detected!");
+	}
+
+done:
+	rtos_elf_symbols_free(index);
+	return rtos_detected;
+}
+
 /* rtos_qsymbol() processes and replies to all qSymbol packets from GDB.
  *
  * GDB sends a qSymbol:: packet (empty address, empty name) to notify
@@ -206,6 +275,9 @@ static struct symbol_table_elem *next_symbol(struct rtos *os, char *cur_symbol,
  * symbol here from the -flto case.  (Each subsequent static symbol with
  * the same name is exported as .lto_priv.1, .lto_priv.2, etc.)
  *
+ * When the target has an -rtos-elf file, all symbols are resolved from it
+ * on the first qSymbol:: packet instead, see rtos_qsymbol_elf().
+ *
  * rtos_qsymbol() returns 1 if an RTOS has been detected, or 0 otherwise.
  */
 int rtos_qsymbol(struct connection *connection, char const *packet, int packet_size)
@@ -223,6 +295,14 @@ int rtos_qsymbol(struct connection *connection, char const *packet, int packet_s
 	if (!os)
 		goto done;
 
+	if (target->rtos_elf && !strcmp(packet, "qSymbol::")) {
+		int ret = rtos_qsymbol_elf(target);
+		if (ret >= 0) {
+			rtos_detected = ret;
+			goto done;
+		}
+	}
+
 	/* Decode any symbol name in the packet*/
 	size_t len = unhexify((uint8_t *)cur_sym, strchr(packet + 8, ':') + 1, strlen(strchr(packet + 8, ':') + 1));
 	cur_sym[len] = 0;
@@ -393,7 +473,9 @@ int rtos_thread_packet(struct connection *connection, char const *packet, int pa
 				target->rtos_auto_detect = false;
 				target->rtos->type->create(target);
 			}
-			target->rtos->type->update_threads(target->rtos);
+			/* symbols changed, walk the thread lists again */
+			target->rtos->thread_list_valid = false;
+			rtos_update_threads(target);
 		}
 		return ERROR_OK;
 	} else if (strncmp(packet, "qfThreadInfo", 12) == 0) {
@@ -687,8 +769,28 @@ static int rtos_try_next(struct target *target)
 
 int rtos_update_threads(struct target *target)
 {
-	if ((target->rtos) && (target->rtos->type))
-		target->rtos->type->update_threads(target->rtos);
+	struct rtos *rtos = target->rtos;
+	if (!rtos || !rtos->type)
+		return ERROR_OK;
+
+	uint32_t signature = 0;
+	bool have_signature = rtos->type->thread_list_signature &&
+		rtos->type->thread_list_signature(rtos, &signature) == ERROR_OK;
+
+	if (have_signature && rtos->thread_list_valid &&
+			signature == rtos->thread_list_signature) {
+		LOG_DEBUG("%s thread lists unchanged, keeping %d threads",
+			rtos->type->name, rtos->thread_count);
+		/* as after a rebuild, gdb has to select a thread again */
+		rtos->current_threadid = -1;
+		return ERROR_OK;
+	}
+
+	int retval = rtos->type->update_threads(rtos);
+	rtos->thread_list_valid = have_signature && retval == ERROR_OK;
+	rtos->thread_list_signature = signature;
+	rtos->thread_list_generation++;
+
 	return ERROR_OK;
 }
 
@@ -705,11 +807,87 @@ void rtos_free_threadlist(struct rtos *rtos)
 		free(rtos->thread_details);
 		rtos->thread_details = NULL;
 		rtos->thread_count = 0;
+		rtos->thread_list_valid = false;
 		rtos->current_threadid = -1;
 		rtos->current_thread = 0;
 	}
 }
 
+/**
+ * Walk several linked lists of the target in lockstep. The current node of
+ * every list not finished yet is read with a single scatter-gather access
+ * per step, so the number of round trips is the length of the longest list
+ * rather than the total number of nodes and fields.
+ *
+ * @param nodes First node of each list, 0 for an empty list. Used as the
+ * walk position, all entries are 0 on success.
+ * @param fields The fields read from each node, passed one after the other
+ * in the data of @a node_fn.
+ * @param node_fn Called for each node in the order of the lists, sets the
+ * next node of the list or 0 to end it. A node pointing to itself also
+ * ends the list.
+ */
+int rtos_walk_lists(struct rtos *rtos, target_addr_t *nodes, unsigned int num_lists,
+		const struct rtos_list_field *fields, unsigned int num_fields,
+		rtos_list_node_fn node_fn, void *priv)
+{
+	uint32_t node_size = 0;
+	for (unsigned int f = 0; f < num_fields; f++)
+		node_size += fields[f].size;
+
+	struct target_memory_sg *ranges = malloc(num_lists * num_fields * sizeof(*ranges));
+	unsigned int *active = malloc(num_lists * sizeof(*active));
+	uint8_t *data = malloc(num_lists * node_size);
+	int retval = ERROR_OK;
+
+	if (!ranges || !active || !data) {
+		LOG_ERROR("Out of memory");
+		retval = ERROR_FAIL;
+		goto out;
+	}
+
+	while (true) {
+		unsigned int num_active = 0, num_ranges = 0;
+
+		for (unsigned int l = 0; l < num_lists; l++) {
+			if (!nodes[l])
+				continue;
+
+			uint8_t *p = data + num_active * node_size;
+			for (unsigned int f = 0; f < num_fields; f++) {
+				target_memory_sg_range(&ranges[num_ranges++], nodes[l] + fields[f].offset,
+					fields[f].size, p);
+				p += fields[f].size;
+			}
+			active[num_active++] = l;
+		}
+
+		if (!num_active)
+			break;
+
+		retval = target_read_memory_sg(rtos->target, ranges, num_ranges);
+		if (retval != ERROR_OK)
+			break;
+
+		for (unsigned int i = 0; i < num_active; i++) {
+			unsigned int l = active[i];
+			target_addr_t next = 0;
+
+			retval = node_fn(rtos, l, nodes[l], data + i * node_size, &next, priv);
+			if (retval != ERROR_OK)
+				goto out;
+
+			nodes[l] = (next == nodes[l]) ? 0 : next;
+		}
+	}
+
+out:
+	free(data);
+	free(active);
+	free(ranges);
+	return retval;
+}
+
 int rtos_read_buffer(struct target *target, target_addr_t address,
 		uint32_t size, uint8_t *buffer)
 {
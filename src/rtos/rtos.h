@@ -45,6 +45,12 @@ struct rtos {
 	threadid_t current_thread;
 	struct thread_detail *thread_details;
 	int thread_count;
+	/* signature of the kernel thread lists the thread details were built
+	 * from, see rtos_update_threads() */
+	bool thread_list_valid;
+	uint32_t thread_list_signature;
+	/* incremented each time the thread details are rebuilt */
+	unsigned int thread_list_generation;
 	int (*gdb_thread_packet)(struct connection *connection, char const *packet, int packet_size);
 	int (*gdb_target_for_threadid)(struct connection *connection, int64_t thread_id, struct target **p_target);
 	void *rtos_specific_params;
@@ -62,6 +68,10 @@ struct rtos_type {
 	int (*create)(struct target *target);
 	int (*smp_init)(struct target *target);
 	int (*update_threads)(struct rtos *rtos);
+	/** Optional. Compute a cheap signature of the kernel thread lists, e.g.
+	 * from a change counter or the list heads. update_threads() is skipped
+	 * while the signature does not change. */
+	int (*thread_list_signature)(struct rtos *rtos, uint32_t *signature);
 	/** Return a list of general registers, with their values filled out. */
 	int (*get_thread_reg_list)(struct rtos *rtos, int64_t thread_id,
 			struct rtos_reg **reg_list, int *num_regs);
@@ -111,6 +121,15 @@ struct rtos_register_stacking {
 		uint8_t *stack_data);
 };
 
+/** A field read from each list node by rtos_walk_lists(). */
+struct rtos_list_field {
+	uint32_t offset;	/* from the node address */
+	uint32_t size;		/* in bytes */
+};
+
+typedef int (*rtos_list_node_fn)(struct rtos *rtos, unsigned int list,
+		target_addr_t node, const uint8_t *data, target_addr_t *next, void *priv);
+
 #define GDB_THREAD_PACKET_NOT_CONSUMED (-40)
 
 int rtos_create(struct jim_getopt_info *goi, struct target *target);
@@ -129,6 +148,9 @@ int rtos_get_gdb_reg_list(struct connection *connection);
 int rtos_update_threads(struct target *target);
 void rtos_free_threadlist(struct rtos *rtos);
 int rtos_smp_init(struct target *target);
+int rtos_walk_lists(struct rtos *rtos, target_addr_t *nodes, unsigned int num_lists,
+		const struct rtos_list_field *fields, unsigned int num_fields,
+		rtos_list_node_fn node_fn, void *priv);
 /*  function for handling symbol access */
 int rtos_qsymbol(struct connection *connection, char const *packet, int packet_size);
 int rtos_read_buffer(struct target *target, target_addr_t address,
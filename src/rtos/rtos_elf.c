@@ -0,0 +1,309 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+ * Symbol index built from the ELF symbol table of the application, so
+ * that RTOS symbols can be resolved without a qSymbol round trip to GDB
+ * for each of them. See the -rtos-elf target option.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "rtos_elf.h"
+#include <helper/fileio.h>
+#include <helper/log.h>
+
+/* Only the few fields needed here, as byte offsets. The host <elf.h> is
+ * not available everywhere, see helper/replacements.h */
+#define ELF_EI_CLASS			4
+#define ELF_EI_DATA				5
+#define ELF_CLASS32				1
+#define ELF_CLASS64				2
+#define ELF_DATA2LSB			1
+#define ELF_DATA2MSB			2
+#define ELF_SHT_SYMTAB			2
+#define ELF_SHN_UNDEF			0
+#define ELF_STT_SECTION			3
+#define ELF_STT_FILE			4
+
+struct rtos_elf_layout {
+	size_t ehdr_size;
+	size_t e_shoff, e_shentsize, e_shnum;
+	size_t shdr_size;
+	size_t sh_type, sh_offset, sh_size, sh_link, sh_entsize;
+	size_t sym_size;
+	size_t st_name, st_value, st_info, st_shndx;
+	unsigned int addr_size;
+};
+
+static const struct rtos_elf_layout rtos_elf32_layout = {
+	.ehdr_size = 52, .e_shoff = 32, .e_shentsize = 46, .e_shnum = 48,
+	.shdr_size = 40, .sh_type = 4, .sh_offset = 16, .sh_size = 20, .sh_link = 24, .sh_entsize = 36,
+	.sym_size = 16, .st_name = 0, .st_value = 4, .st_info = 12, .st_shndx = 14,
+	.addr_size = 4,
+};
+
+static const struct rtos_elf_layout rtos_elf64_layout = {
+	.ehdr_size = 64, .e_shoff = 40, .e_shentsize = 58, .e_shnum = 60,
+	.shdr_size = 64, .sh_type = 4, .sh_offset = 24, .sh_size = 32, .sh_link = 40, .sh_entsize = 56,
+	.sym_size = 24, .st_name = 0, .st_value = 8, .st_info = 4, .st_shndx = 6,
+	.addr_size = 8,
+};
+
+struct rtos_elf_symbol {
+	const char *name;	/* NULL for an empty slot */
+	uint64_t address;
+};
+
+struct rtos_elf_symbols {
+	char *strtab;		/* copy of the symbol string table */
+	struct rtos_elf_symbol *table;
+	size_t mask;		/* table size - 1, the size is a power of two */
+	size_t count;
+};
+
+struct rtos_elf_reader {
+	const uint8_t *data;
+	size_t size;
+	bool little_endian;
+	const struct rtos_elf_layout *layout;
+};
+
+static uint64_t rtos_elf_field(const struct rtos_elf_reader *r, size_t offset, unsigned int size)
+{
+	const uint8_t *p = r->data + offset;
+
+	switch (size) {
+	case 1:
+		return *p;
+	case 2:
+		return r->little_endian ? le_to_h_u16(p) : be_to_h_u16(p);
+	case 4:
+		return r->little_endian ? le_to_h_u32(p) : be_to_h_u32(p);
+	default:
+		return r->little_endian ? le_to_h_u64(p) : be_to_h_u64(p);
+	}
+}
+
+static bool rtos_elf_in_file(const struct rtos_elf_reader *r, uint64_t offset, uint64_t size)
+{
+	return offset <= r->size && size <= r->size - offset;
+}
+
+static uint32_t rtos_elf_hash(const char *name)
+{
+	/* FNV-1a */
+	uint32_t hash = 2166136261u;
+	while (*name) {
+		hash ^= (uint8_t)*name++;
+		hash *= 16777619;
+	}
+	return hash;
+}
+
+static void rtos_elf_symbols_insert(struct rtos_elf_symbols *symbols,
+		const char *name, uint64_t address)
+{
+	size_t i = rtos_elf_hash(name) & symbols->mask;
+
+	while (symbols->table[i].name) {
+		/* keep the first definition, like GDB's minimal symbols */
+		if (!strcmp(symbols->table[i].name, name))
+			return;
+		i = (i + 1) & symbols->mask;
+	}
+
+	symbols->table[i].name = name;
+	symbols->table[i].address = address;
+	symbols->count++;
+}
+
+static int rtos_elf_symbols_parse(const struct rtos_elf_reader *r,
+		struct rtos_elf_symbols *symbols)
+{
+	const struct rtos_elf_layout *l = r->layout;
+
+	if (r->size < l->ehdr_size)
+		return ERROR_FAIL;
+
+	uint64_t shoff = rtos_elf_field(r, l->e_shoff, l->addr_size);
+	unsigned int shentsize = rtos_elf_field(r, l->e_shentsize, 2);
+	unsigned int shnum = rtos_elf_field(r, l->e_shnum, 2);
+
+	if (shentsize < l->shdr_size || !rtos_elf_in_file(r, shoff, (uint64_t)shentsize * shnum)) {
+		LOG_ERROR("invalid ELF section header table");
+		return ERROR_FAIL;
+	}
+
+	for (unsigned int i = 0; i < shnum; i++) {
+		size_t sh = shoff + (size_t)i * shentsize;
+		if (rtos_elf_field(r, sh + l->sh_type, 4) != ELF_SHT_SYMTAB)
+			continue;
+
+		uint64_t symoff = rtos_elf_field(r, sh + l->sh_offset, l->addr_size);
+		uint64_t symsize = rtos_elf_field(r, sh + l->sh_size, l->addr_size);
+		uint64_t entsize = rtos_elf_field(r, sh + l->sh_entsize, l->addr_size);
+		uint32_t link = rtos_elf_field(r, sh + l->sh_link, 4);
+		if (entsize < l->sym_size || link >= shnum || !rtos_elf_in_file(r, symoff, symsize)) {
+			LOG_ERROR("invalid ELF symbol table");
+			return ERROR_FAIL;
+		}
+
+		size_t str = shoff + (size_t)link * shentsize;
+		uint64_t stroff = rtos_elf_field(r, str + l->sh_offset, l->addr_size);
+		uint64_t strsize = rtos_elf_field(r, str + l->sh_size, l->addr_size);
+		if (strsize == 0 || !rtos_elf_in_file(r, stroff, strsize)) {
+			LOG_ERROR("invalid ELF symbol string table");
+			return ERROR_FAIL;
+		}
+
+		size_t nsyms = symsize / entsize;
+		size_t table_size = 16;
+		while (table_size < 2 * nsyms)
+			table_size <<= 1;
+
+		symbols->strtab = malloc(strsize + 1);
+		symbols->table = calloc(table_size, sizeof(*symbols->table));
+		if (!symbols->strtab || !symbols->table) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		memcpy(symbols->strtab, r->data + stroff, strsize);
+		symbols->strtab[strsize] = '\0';
+		symbols->mask = table_size - 1;
+
+		for (size_t j = 0; j < nsyms; j++) {
+			size_t sym = symoff + j * entsize;
+			uint32_t name = rtos_elf_field(r, sym + l->st_name, 4);
+			unsigned int type = rtos_elf_field(r, sym + l->st_info, 1) & 0xf;
+			unsigned int shndx = rtos_elf_field(r, sym + l->st_shndx, 2);
+
+			if (name == 0 || name >= strsize || shndx == ELF_SHN_UNDEF ||
+					type == ELF_STT_SECTION || type == ELF_STT_FILE)
+				continue;
+
+			rtos_elf_symbols_insert(symbols, symbols->strtab + name,
+				rtos_elf_field(r, sym + l->st_value, l->addr_size));
+		}
+
+		/* an executable has a single symbol table */
+		return ERROR_OK;
+	}
+
+	LOG_ERROR("ELF file has no symbol table, is it stripped?");
+	return ERROR_FAIL;
+}
+
+/**
+ * Load the symbol table of the ELF file @a url into a hash index.
+ * The file is only needed during the call.
+ */
+int rtos_elf_symbols_load(const char *url, struct rtos_elf_symbols **symbols)
+{
+	struct fileio *fileio;
+	size_t size, read_bytes;
+	const uint8_t *data;
+	uint8_t *buffer = NULL;
+
+	int retval = fileio_open(&fileio, url, FILEIO_READ, FILEIO_BINARY);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = fileio_size(fileio, &size);
+	if (retval != ERROR_OK)
+		goto out;
+
+	if (fileio_map(fileio, &data) != ERROR_OK) {
+		buffer = malloc(size);
+		if (!buffer) {
+			LOG_ERROR("Out of memory");
+			retval = ERROR_FAIL;
+			goto out;
+		}
+		retval = fileio_read(fileio, size, buffer, &read_bytes);
+		if (retval != ERROR_OK)
+			goto out;
+		if (read_bytes != size) {
+			retval = ERROR_FILEIO_OPERATION_FAILED;
+			goto out;
+		}
+		data = buffer;
+	}
+
+	struct rtos_elf_reader reader = {
+		.data = data,
+		.size = size,
+	};
+
+	if (size < 16 || memcmp(data, "\177ELF", 4) != 0) {
+		LOG_ERROR("%s is not an ELF file", url);
+		retval = ERROR_FAIL;
+		goto out;
+	}
+
+	if (data[ELF_EI_CLASS] == ELF_CLASS32) {
+		reader.layout = &rtos_elf32_layout;
+	} else if (data[ELF_EI_CLASS] == ELF_CLASS64) {
+		reader.layout = &rtos_elf64_layout;
+	} else {
+		LOG_ERROR("invalid ELF file class");
+		retval = ERROR_FAIL;
+		goto out;
+	}
+
+	if (data[ELF_EI_DATA] == ELF_DATA2LSB) {
+		reader.little_endian = true;
+	} else if (data[ELF_EI_DATA] != ELF_DATA2MSB) {
+		LOG_ERROR("invalid ELF file endianness");
+		retval = ERROR_FAIL;
+		goto out;
+	}
+
+	struct rtos_elf_symbols *s = calloc(1, sizeof(*s));
+	if (!s) {
+		LOG_ERROR("Out of memory");
+		retval = ERROR_FAIL;
+		goto out;
+	}
+
+	retval = rtos_elf_symbols_parse(&reader, s);
+	if (retval != ERROR_OK) {
+		rtos_elf_symbols_free(s);
+		goto out;
+	}
+
+	LOG_DEBUG("RTOS: %zu symbols indexed from %s", s->count, url);
+	*symbols = s;
+
+out:
+	free(buffer);
+	fileio_close(fileio);
+	return retval;
+}
+
+bool rtos_elf_symbols_lookup(const struct rtos_elf_symbols *symbols,
+		const char *name, uint64_t *address)
+{
+	size_t i = rtos_elf_hash(name) & symbols->mask;
+
+	while (symbols->table[i].name) {
+		if (!strcmp(symbols->table[i].name, name)) {
+			*address = symbols->table[i].address;
+			return true;
+		}
+		i = (i + 1) & symbols->mask;
+	}
+
+	return false;
+}
+
+void rtos_elf_symbols_free(struct rtos_elf_symbols *symbols)
+{
+	if (!symbols)
+		return;
+
+	free(symbols->table);
+	free(symbols->strtab);
+	free(symbols);
+}
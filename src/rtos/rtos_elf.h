@@ -0,0 +1,15 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_RTOS_RTOS_ELF_H
+#define OPENOCD_RTOS_RTOS_ELF_H
+
+#include <helper/types.h>
+
+struct rtos_elf_symbols;
+
+int rtos_elf_symbols_load(const char *url, struct rtos_elf_symbols **symbols);
+bool rtos_elf_symbols_lookup(const struct rtos_elf_symbols *symbols,
+		const char *name, uint64_t *address);
+void rtos_elf_symbols_free(struct rtos_elf_symbols *symbols);
+
+#endif /* OPENOCD_RTOS_RTOS_ELF_H */
@@ -503,73 +503,80 @@ static uint32_t zephyr_kptr(const struct rtos *rtos, enum zephyr_offsets off)
 	return rtos->symbols[ZEPHYR_VAL__KERNEL].address + params->offsets[off];
 }
 
-static int zephyr_fetch_thread(const struct rtos *rtos,
-				struct zephyr_thread *thread, uint32_t ptr)
+struct zephyr_walk {
+	struct zephyr_array thread_array;
+	uint32_t current_thread;
+	int64_t curr_id;
+};
+
+/* Offsets of the thread fields in the data of zephyr_thread_node(), see
+ * the fields array of zephyr_fetch_thread_list() */
+#define ZEPHYR_DATA_ENTRY			0
+#define ZEPHYR_DATA_NEXT_THREAD		4
+#define ZEPHYR_DATA_STACK_POINTER	8
+#define ZEPHYR_DATA_STATE			12
+#define ZEPHYR_DATA_USER_OPTIONS	13
+#define ZEPHYR_DATA_PRIO			14
+#define ZEPHYR_DATA_NAME			15
+
+static int zephyr_thread_node(struct rtos *rtos, unsigned int list,
+		target_addr_t node, const uint8_t *data, target_addr_t *next, void *priv)
 {
 	const struct zephyr_params *param = rtos->rtos_specific_params;
-	int retval;
-
-	thread->ptr = ptr;
-
-	retval = target_read_u32(rtos->target, ptr + param->offsets[OFFSET_T_ENTRY],
-				 &thread->entry);
-	if (retval != ERROR_OK)
-		return retval;
-
-	retval = target_read_u32(rtos->target,
-				 ptr + param->offsets[OFFSET_T_NEXT_THREAD],
-				 &thread->next_ptr);
-	if (retval != ERROR_OK)
-		return retval;
-
-	retval = target_read_u32(rtos->target,
-				 ptr + param->offsets[OFFSET_T_STACK_POINTER],
-				 &thread->stack_pointer);
-	if (retval != ERROR_OK)
-		return retval;
-
-	retval = target_read_u8(rtos->target, ptr + param->offsets[OFFSET_T_STATE],
-				&thread->state);
-	if (retval != ERROR_OK)
-		return retval;
-
-	retval = target_read_u8(rtos->target,
-				ptr + param->offsets[OFFSET_T_USER_OPTIONS],
-				&thread->user_options);
-	if (retval != ERROR_OK)
-		return retval;
+	struct zephyr_walk *walk = priv;
+	struct zephyr_thread thread;
+	struct thread_detail *td;
 
-	uint8_t prio;
-	retval = target_read_u8(rtos->target,
-				ptr + param->offsets[OFFSET_T_PRIO], &prio);
-	if (retval != ERROR_OK)
-		return retval;
-	thread->prio = prio;
+	thread.ptr = node;
+	thread.entry = target_buffer_get_u32(rtos->target, data + ZEPHYR_DATA_ENTRY);
+	thread.next_ptr = target_buffer_get_u32(rtos->target, data + ZEPHYR_DATA_NEXT_THREAD);
+	thread.stack_pointer = target_buffer_get_u32(rtos->target, data + ZEPHYR_DATA_STACK_POINTER);
+	thread.state = data[ZEPHYR_DATA_STATE];
+	thread.user_options = data[ZEPHYR_DATA_USER_OPTIONS];
+	thread.prio = data[ZEPHYR_DATA_PRIO];
 
-	thread->name[0] = '\0';
+	thread.name[0] = '\0';
 	if (param->offsets[OFFSET_T_NAME] != UNIMPLEMENTED) {
-		retval = target_read_buffer(rtos->target,
-					ptr + param->offsets[OFFSET_T_NAME],
-					sizeof(thread->name) - 1, (uint8_t *)thread->name);
-		if (retval != ERROR_OK)
-			return retval;
-
-		thread->name[sizeof(thread->name) - 1] = '\0';
+		memcpy(thread.name, data + ZEPHYR_DATA_NAME, sizeof(thread.name) - 1);
+		thread.name[sizeof(thread.name) - 1] = '\0';
 	}
 
 	LOG_DEBUG("Fetched thread%" PRIx32 ": {entry@0x%" PRIx32
 		", state=%" PRIu8 ", useropts=%" PRIu8 ", prio=%" PRId8 "}",
-		ptr, thread->entry, thread->state, thread->user_options, thread->prio);
+		thread.ptr, thread.entry, thread.state, thread.user_options, thread.prio);
+
+	td = zephyr_array_append(&walk->thread_array, sizeof(*td));
+	if (!td)
+		return ERROR_FAIL;
+
+	td->threadid = thread.ptr;
+	td->exists = true;
+
+	if (thread.name[0])
+		td->thread_name_str = strdup(thread.name);
+	else
+		td->thread_name_str = alloc_printf("thr_%" PRIx32 "_%" PRIx32,
+						   thread.entry, thread.ptr);
+	td->extra_info_str = alloc_printf("prio:%" PRId8 ",useropts:%" PRIu8,
+					  thread.prio, thread.user_options);
+	if (!td->thread_name_str || !td->extra_info_str)
+		return ERROR_FAIL;
+
+	if (td->threadid == walk->current_thread)
+		walk->curr_id = (int64_t)walk->thread_array.elements - 1;
 
+	*next = thread.next_ptr;
 	return ERROR_OK;
 }
 
 static int zephyr_fetch_thread_list(struct rtos *rtos, uint32_t current_thread)
 {
-	struct zephyr_array thread_array;
-	struct zephyr_thread thread;
+	const struct zephyr_params *param = rtos->rtos_specific_params;
+	struct zephyr_walk walk = {
+		.current_thread = current_thread,
+		.curr_id = -1,
+	};
 	struct thread_detail *td;
-	int64_t curr_id = -1;
 	uint32_t curr;
 	int retval;
 
@@ -580,54 +587,48 @@ static int zephyr_fetch_thread_list(struct rtos *rtos, uint32_t current_thread)
 		return retval;
 	}
 
-	zephyr_array_init(&thread_array);
-
-	for (; curr; curr = thread.next_ptr) {
-		retval = zephyr_fetch_thread(rtos, &thread, curr);
-		if (retval != ERROR_OK)
-			goto error;
-
-		td = zephyr_array_append(&thread_array, sizeof(*td));
-		if (!td)
-			goto error;
-
-		td->threadid = thread.ptr;
-		td->exists = true;
-
-		if (thread.name[0])
-			td->thread_name_str = strdup(thread.name);
-		else
-			td->thread_name_str = alloc_printf("thr_%" PRIx32 "_%" PRIx32,
-							   thread.entry, thread.ptr);
-		td->extra_info_str = alloc_printf("prio:%" PRId8 ",useropts:%" PRIu8,
-						  thread.prio, thread.user_options);
-		if (!td->thread_name_str || !td->extra_info_str)
-			goto error;
-
-		if (td->threadid == current_thread)
-			curr_id = (int64_t)thread_array.elements - 1;
-	}
+	zephyr_array_init(&walk.thread_array);
+
+	/* All fields of a thread are read in one batch */
+	const struct rtos_list_field fields[] = {
+		{ param->offsets[OFFSET_T_ENTRY], 4 },
+		{ param->offsets[OFFSET_T_NEXT_THREAD], 4 },
+		{ param->offsets[OFFSET_T_STACK_POINTER], 4 },
+		{ param->offsets[OFFSET_T_STATE], 1 },
+		{ param->offsets[OFFSET_T_USER_OPTIONS], 1 },
+		{ param->offsets[OFFSET_T_PRIO], 1 },
+		{ param->offsets[OFFSET_T_NAME], sizeof(((struct zephyr_thread *)NULL)->name) - 1 },
+	};
+	unsigned int num_fields = ARRAY_SIZE(fields);
+	if (param->offsets[OFFSET_T_NAME] == UNIMPLEMENTED)
+		num_fields--;
+
+	target_addr_t node = curr;
+	retval = rtos_walk_lists(rtos, &node, 1, fields, num_fields,
+			zephyr_thread_node, &walk);
+	if (retval != ERROR_OK)
+		goto error;
 
-	LOG_DEBUG("Got information for %zu threads", thread_array.elements);
+	LOG_DEBUG("Got information for %zu threads", walk.thread_array.elements);
 
 	rtos_free_threadlist(rtos);
 
-	rtos->thread_count = (int)thread_array.elements;
-	rtos->thread_details = zephyr_array_detach_ptr(&thread_array);
+	rtos->thread_count = (int)walk.thread_array.elements;
+	rtos->thread_details = zephyr_array_detach_ptr(&walk.thread_array);
 
-	rtos->current_threadid = curr_id;
+	rtos->current_threadid = walk.curr_id;
 	rtos->current_thread = current_thread;
 
 	return ERROR_OK;
 
 error:
-	td = thread_array.ptr;
-	for (size_t i = 0; i < thread_array.elements; i++) {
+	td = walk.thread_array.ptr;
+	for (size_t i = 0; i < walk.thread_array.elements; i++) {
 		free(td[i].thread_name_str);
 		free(td[i].extra_info_str);
 	}
 
-	zephyr_array_free(&thread_array);
+	zephyr_array_free(&walk.thread_array);
 
 	return ERROR_FAIL;
 }
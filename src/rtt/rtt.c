@@ -41,8 +41,17 @@ static struct {
 
 	struct rtt_sink_list **sink_list;
 	size_t sink_list_length;
+	/** Fill levels of the last read and statistics, per sink list entry. */
+	struct rtt_channel_fill *fill;
+	struct rtt_channel_stats *stats;
 
 	unsigned int polling_interval;
+	/** Whether the polling interval adapts to the channel fill levels. */
+	bool adaptive;
+	unsigned int min_interval;
+	unsigned int max_interval;
+	/** Interval the read callback is registered with. */
+	unsigned int current_interval;
 } rtt;
 
 int rtt_init(void)
@@ -50,8 +59,10 @@ int rtt_init(void)
 	rtt.sink_list_length = 1;
 	rtt.sink_list = calloc(rtt.sink_list_length,
 		sizeof(struct rtt_sink_list *));
+	rtt.fill = calloc(rtt.sink_list_length, sizeof(struct rtt_channel_fill));
+	rtt.stats = calloc(rtt.sink_list_length, sizeof(struct rtt_channel_stats));
 
-	if (!rtt.sink_list)
+	if (!rtt.sink_list || !rtt.fill || !rtt.stats)
 		return ERROR_FAIL;
 
 	rtt.sink_list[0] = NULL;
@@ -64,17 +75,83 @@ int rtt_init(void)
 
 int rtt_exit(void)
 {
+	free(rtt.stats);
+	free(rtt.fill);
 	free(rtt.sink_list);
 
 	return ERROR_OK;
 }
 
+static int read_channel_callback(void *user_data);
+
+static void set_timer_interval(unsigned int interval)
+{
+	if (rtt.current_interval == interval)
+		return;
+
+	target_unregister_timer_callback(&read_channel_callback, NULL);
+	target_register_timer_callback(&read_channel_callback, interval, 1, NULL);
+	rtt.current_interval = interval;
+}
+
+/*
+ * Update the channel statistics from the fill levels of the last read, and
+ * pick the next polling interval in adaptive mode: double it while no data
+ * arrives, halve it from a quarter full buffer, and poll as fast as allowed
+ * from a half full buffer or when a read could not drain the buffer.
+ */
+static void update_channel_stats(void)
+{
+	bool data = false;
+	bool drain = false;
+	unsigned int max_fill = 0;
+
+	for (size_t i = 0; i < rtt.sink_list_length; i++) {
+		const struct rtt_channel_fill *fill = &rtt.fill[i];
+		struct rtt_channel_stats *stats = &rtt.stats[i];
+
+		if (!fill->size)
+			continue;
+
+		unsigned int percent = (uint64_t)fill->pending * 100 / fill->size;
+
+		stats->polls++;
+		stats->bytes += fill->read;
+		stats->max_fill = MAX(stats->max_fill, percent);
+
+		if (fill->pending)
+			stats->polls_with_data++;
+
+		/* one byte of a ring buffer always stays empty */
+		if (fill->pending >= fill->size - 1)
+			stats->polls_full++;
+
+		data |= fill->pending > 0;
+		drain |= fill->read < fill->pending;
+		max_fill = MAX(max_fill, percent);
+	}
+
+	if (!rtt.adaptive)
+		return;
+
+	unsigned int interval = rtt.current_interval;
+
+	if (!data)
+		interval = MIN(rtt.max_interval, 2 * interval);
+	else if (drain || max_fill >= 50)
+		interval = rtt.min_interval;
+	else if (max_fill >= 25)
+		interval = MAX(rtt.min_interval, interval / 2);
+
+	set_timer_interval(interval);
+}
+
 static int read_channel_callback(void *user_data)
 {
 	int ret;
 
 	ret = rtt.source.read(rtt.target, &rtt.ctrl, rtt.sink_list,
-		rtt.sink_list_length, NULL);
+		rtt.sink_list_length, rtt.fill, NULL);
 
 	if (ret != ERROR_OK) {
 		target_unregister_timer_callback(&read_channel_callback, NULL);
@@ -82,6 +159,8 @@ static int read_channel_callback(void *user_data)
 		return ret;
 	}
 
+	update_channel_stats();
+
 	return ERROR_OK;
 }
 
@@ -155,8 +234,11 @@ int rtt_start(void)
 	if (ret != ERROR_OK)
 		return ret;
 
+	memset(rtt.stats, 0, rtt.sink_list_length * sizeof(*rtt.stats));
+
+	rtt.current_interval = rtt.adaptive ? rtt.min_interval : rtt.polling_interval;
 	target_register_timer_callback(&read_channel_callback,
-		rtt.polling_interval, 1, NULL);
+		rtt.current_interval, 1, NULL);
 	rtt.started = true;
 
 	return ERROR_OK;
@@ -185,6 +267,8 @@ int rtt_stop(void)
 static int adjust_sink_list(size_t length)
 {
 	struct rtt_sink_list **tmp;
+	struct rtt_channel_fill *fill;
+	struct rtt_channel_stats *stats;
 
 	if (length <= rtt.sink_list_length)
 		return ERROR_OK;
@@ -194,10 +278,28 @@ static int adjust_sink_list(size_t length)
 	if (!tmp)
 		return ERROR_FAIL;
 
-	for (size_t i = rtt.sink_list_length; i < length; i++)
+	rtt.sink_list = tmp;
+
+	fill = realloc(rtt.fill, sizeof(struct rtt_channel_fill) * length);
+
+	if (!fill)
+		return ERROR_FAIL;
+
+	rtt.fill = fill;
+
+	stats = realloc(rtt.stats, sizeof(struct rtt_channel_stats) * length);
+
+	if (!stats)
+		return ERROR_FAIL;
+
+	rtt.stats = stats;
+
+	for (size_t i = rtt.sink_list_length; i < length; i++) {
 		tmp[i] = NULL;
+		memset(&fill[i], 0, sizeof(fill[i]));
+		memset(&stats[i], 0, sizeof(stats[i]));
+	}
 
-	rtt.sink_list = tmp;
 	rtt.sink_list_length = length;
 
 	return ERROR_OK;
@@ -274,13 +376,50 @@ int rtt_set_polling_interval(unsigned int interval)
 	if (!interval)
 		return ERROR_FAIL;
 
-	if (rtt.polling_interval != interval) {
-		target_unregister_timer_callback(&read_channel_callback, NULL);
-		target_register_timer_callback(&read_channel_callback, interval, 1,
-			NULL);
-	}
+	if (rtt.started)
+		set_timer_interval(interval);
 
 	rtt.polling_interval = interval;
+	rtt.adaptive = false;
+
+	return ERROR_OK;
+}
+
+bool rtt_get_adaptive_polling(unsigned int *min_interval,
+		unsigned int *max_interval, unsigned int *interval)
+{
+	*min_interval = rtt.min_interval;
+	*max_interval = rtt.max_interval;
+	*interval = rtt.started ? rtt.current_interval : rtt.min_interval;
+
+	return rtt.adaptive;
+}
+
+int rtt_set_adaptive_polling(unsigned int min_interval,
+		unsigned int max_interval)
+{
+	if (!min_interval || min_interval > max_interval)
+		return ERROR_FAIL;
+
+	rtt.min_interval = min_interval;
+	rtt.max_interval = max_interval;
+	rtt.adaptive = true;
+
+	if (rtt.started)
+		set_timer_interval(min_interval);
+
+	return ERROR_OK;
+}
+
+int rtt_get_channel_stats(unsigned int channel_index,
+		struct rtt_channel_stats *stats)
+{
+	if (channel_index >= rtt.sink_list_length) {
+		memset(stats, 0, sizeof(*stats));
+		return ERROR_OK;
+	}
+
+	*stats = rtt.stats[channel_index];
 
 	return ERROR_OK;
 }
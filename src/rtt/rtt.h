@@ -77,6 +77,30 @@ struct rtt_channel_info {
 	uint32_t flags;
 };
 
+/** Fill level of an up-channel seen by a read of the RTT source. */
+struct rtt_channel_fill {
+	/** Buffer size in bytes, 0 if the channel was not read. */
+	uint32_t size;
+	/** Bytes pending in the buffer before the read. */
+	uint32_t pending;
+	/** Bytes read, less than pending if the read was truncated. */
+	uint32_t read;
+};
+
+/** Up-channel statistics, see rtt_get_channel_stats(). */
+struct rtt_channel_stats {
+	/** Number of polls of the channel. */
+	unsigned int polls;
+	/** Number of polls finding data. */
+	unsigned int polls_with_data;
+	/** Number of polls finding the buffer full, the target may have lost data. */
+	unsigned int polls_full;
+	/** Highest fill level seen, in percent of the buffer size. */
+	unsigned int max_fill;
+	/** Total bytes read. */
+	uint64_t bytes;
+};
+
 typedef int (*rtt_sink_read)(unsigned int channel, const uint8_t *buffer,
 		size_t length, void *user_data);
 
@@ -110,7 +134,7 @@ typedef int (*rtt_source_start)(struct target *target,
 typedef int (*rtt_source_stop)(struct target *target, void *user_data);
 typedef int (*rtt_source_read)(struct target *target,
 		const struct rtt_control *ctrl, struct rtt_sink_list **sinks,
-		size_t num_channels, void *user_data);
+		size_t num_channels, struct rtt_channel_fill *fill, void *user_data);
 typedef int (*rtt_source_write)(struct target *target,
 		struct rtt_control *ctrl, unsigned int channel,
 		const uint8_t *buffer, size_t *length, void *user_data);
@@ -194,6 +218,42 @@ int rtt_get_polling_interval(unsigned int *interval);
  */
 int rtt_set_polling_interval(unsigned int interval);
 
+/**
+ * Get the adaptive polling interval range.
+ *
+ * @param[out] min_interval Minimum polling interval in milliseconds.
+ * @param[out] max_interval Maximum polling interval in milliseconds.
+ * @param[out] interval Current polling interval in milliseconds.
+ *
+ * @returns Whether adaptive polling is enabled.
+ */
+bool rtt_get_adaptive_polling(unsigned int *min_interval,
+		unsigned int *max_interval, unsigned int *interval);
+
+/**
+ * Enable adaptive polling. The interval doubles after each poll without
+ * data, up to @a max_interval, and shrinks towards @a min_interval as the
+ * up-channel buffers fill up. rtt_set_polling_interval() disables it.
+ *
+ * @param[in] min_interval Minimum polling interval in milliseconds.
+ * @param[in] max_interval Maximum polling interval in milliseconds.
+ *
+ * @returns ERROR_OK on success, an error code on failure.
+ */
+int rtt_set_adaptive_polling(unsigned int min_interval,
+		unsigned int max_interval);
+
+/**
+ * Get the statistics of an up-channel since RTT was started.
+ *
+ * @param[in] channel_index Channel index.
+ * @param[out] stats Channel statistics.
+ *
+ * @returns ERROR_OK on success, an error code on failure.
+ */
+int rtt_get_channel_stats(unsigned int channel_index,
+		struct rtt_channel_stats *stats);
+
 /**
  * Get whether RTT is started.
  *
@@ -75,7 +75,13 @@ COMMAND_HANDLER(handle_rtt_polling_interval_command)
 {
 	if (CMD_ARGC == 0) {
 		int ret;
-		unsigned int interval;
+		unsigned int interval, min_interval, max_interval;
+
+		if (rtt_get_adaptive_polling(&min_interval, &max_interval, &interval)) {
+			command_print(CMD, "%u-%u ms, adaptive, now %u ms", min_interval,
+				max_interval, interval);
+			return ERROR_OK;
+		}
 
 		ret = rtt_get_polling_interval(&interval);
 
@@ -96,6 +102,18 @@ COMMAND_HANDLER(handle_rtt_polling_interval_command)
 			command_print(CMD, "Failed to set polling interval");
 			return ret;
 		}
+	} else if (CMD_ARGC == 2) {
+		int ret;
+		unsigned int min_interval, max_interval;
+
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], min_interval);
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], max_interval);
+		ret = rtt_set_adaptive_polling(min_interval, max_interval);
+
+		if (ret != ERROR_OK) {
+			command_print(CMD, "Failed to set adaptive polling interval");
+			return ret;
+		}
 	} else {
 		return ERROR_COMMAND_SYNTAX_ERROR;
 	}
@@ -103,6 +121,35 @@ COMMAND_HANDLER(handle_rtt_polling_interval_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_rtt_stats_command)
+{
+	const struct rtt_control *ctrl;
+	struct rtt_channel_stats stats;
+
+	if (CMD_ARGC > 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!rtt_found_cb()) {
+		command_print(CMD, "rtt: Control block not available");
+		return ERROR_FAIL;
+	}
+
+	ctrl = rtt_get_control();
+
+	for (unsigned int i = 0; i < ctrl->num_up_channels; i++) {
+		rtt_get_channel_stats(i, &stats);
+
+		if (!stats.polls)
+			continue;
+
+		command_print(CMD, "%u: polls %u, with data %u, full %u, max fill %u%%, %" PRIu64 " bytes",
+			i, stats.polls, stats.polls_with_data, stats.polls_full,
+			stats.max_fill, stats.bytes);
+	}
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_rtt_channels_command)
 {
 	int ret;
@@ -244,8 +291,16 @@ static const struct command_registration rtt_subcommand_handlers[] = {
 		.name = "polling_interval",
 		.handler = handle_rtt_polling_interval_command,
 		.mode = COMMAND_EXEC,
-		.help = "show or set polling interval in ms",
-		.usage = "[interval]"
+		.help = "show or set polling interval in ms, or the range of "
+			"an adaptive polling interval",
+		.usage = "[interval | min_interval max_interval]"
+	},
+	{
+		.name = "stats",
+		.handler = handle_rtt_stats_command,
+		.mode = COMMAND_EXEC,
+		.help = "show up-channel fill statistics",
+		.usage = ""
 	},
 	{
 		.name = "channels",
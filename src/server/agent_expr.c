@@ -0,0 +1,417 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/binarybuffer.h>
+#include <helper/log.h>
+#include <target/register.h>
+#include <target/target.h>
+
+#include "agent_expr.h"
+
+/**
+ * @file
+ *
+ * Evaluator for the GDB agent expression bytecode, see "Agent Expressions"
+ * in the GDB manual. Values on the stack are 64 bits wide, multi-byte
+ * operands in the bytecode are big endian.
+ */
+
+/* opcodes, numbered as in GDB's ax.def */
+enum agent_op {
+	AX_OP_ADD = 0x02,
+	AX_OP_SUB = 0x03,
+	AX_OP_MUL = 0x04,
+	AX_OP_DIV_SIGNED = 0x05,
+	AX_OP_DIV_UNSIGNED = 0x06,
+	AX_OP_REM_SIGNED = 0x07,
+	AX_OP_REM_UNSIGNED = 0x08,
+	AX_OP_LSH = 0x09,
+	AX_OP_RSH_SIGNED = 0x0a,
+	AX_OP_RSH_UNSIGNED = 0x0b,
+	AX_OP_LOG_NOT = 0x0e,
+	AX_OP_BIT_AND = 0x0f,
+	AX_OP_BIT_OR = 0x10,
+	AX_OP_BIT_XOR = 0x11,
+	AX_OP_BIT_NOT = 0x12,
+	AX_OP_EQUAL = 0x13,
+	AX_OP_LESS_SIGNED = 0x14,
+	AX_OP_LESS_UNSIGNED = 0x15,
+	AX_OP_EXT = 0x16,
+	AX_OP_REF8 = 0x17,
+	AX_OP_REF16 = 0x18,
+	AX_OP_REF32 = 0x19,
+	AX_OP_REF64 = 0x1a,
+	AX_OP_IF_GOTO = 0x20,
+	AX_OP_GOTO = 0x21,
+	AX_OP_CONST8 = 0x22,
+	AX_OP_CONST16 = 0x23,
+	AX_OP_CONST32 = 0x24,
+	AX_OP_CONST64 = 0x25,
+	AX_OP_REG = 0x26,
+	AX_OP_END = 0x27,
+	AX_OP_DUP = 0x28,
+	AX_OP_POP = 0x29,
+	AX_OP_ZERO_EXT = 0x2a,
+	AX_OP_SWAP = 0x2b,
+	AX_OP_PICK = 0x32,
+	AX_OP_ROT = 0x33,
+};
+
+#define AGENT_EXPR_STACK_SIZE	64
+/* bound the run time of expressions looping with goto */
+#define AGENT_EXPR_MAX_STEPS	10000
+
+struct agent_expr_state {
+	struct target *target;
+	struct reg **reg_list;
+	int reg_list_size;
+	uint64_t stack[AGENT_EXPR_STACK_SIZE];
+	unsigned int sp;
+};
+
+static int agent_expr_reg(struct agent_expr_state *state, unsigned int num,
+		uint64_t *value)
+{
+	if (!state->reg_list) {
+		int retval = target_get_gdb_reg_list(state->target, &state->reg_list,
+				&state->reg_list_size, REG_CLASS_ALL);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	if (num >= (unsigned int)state->reg_list_size) {
+		LOG_DEBUG("agent expression register %u out of range", num);
+		return ERROR_FAIL;
+	}
+
+	struct reg *reg = state->reg_list[num];
+	if (!reg->exist)
+		return ERROR_FAIL;
+	if (!reg->valid) {
+		int retval = reg->type->get(reg);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	*value = buf_get_u64(reg->value, 0, MIN(reg->size, 64));
+	return ERROR_OK;
+}
+
+static int agent_expr_ref(struct agent_expr_state *state, unsigned int size,
+		uint64_t *value)
+{
+	target_addr_t address = *value;
+	int retval;
+
+	switch (size) {
+	case 1: {
+		uint8_t v;
+		retval = target_read_u8(state->target, address, &v);
+		*value = v;
+		break;
+	}
+	case 2: {
+		uint16_t v;
+		retval = target_read_u16(state->target, address, &v);
+		*value = v;
+		break;
+	}
+	case 4: {
+		uint32_t v;
+		retval = target_read_u32(state->target, address, &v);
+		*value = v;
+		break;
+	}
+	default: {
+		uint64_t v;
+		retval = target_read_u64(state->target, address, &v);
+		*value = v;
+		break;
+	}
+	}
+
+	return retval;
+}
+
+static uint64_t agent_expr_operand(const uint8_t *bytecode, size_t pc, unsigned int size)
+{
+	uint64_t value = 0;
+	for (unsigned int i = 0; i < size; i++)
+		value = (value << 8) | bytecode[pc + i];
+	return value;
+}
+
+static int agent_expr_run(struct agent_expr_state *state, const uint8_t *bytecode,
+		size_t len, uint64_t *result)
+{
+	uint64_t *stack = state->stack;
+	size_t pc = 0;
+
+	for (unsigned int steps = 0; steps < AGENT_EXPR_MAX_STEPS; steps++) {
+		if (pc >= len) {
+			LOG_DEBUG("agent expression runs past its end");
+			return ERROR_FAIL;
+		}
+
+		uint8_t op = bytecode[pc++];
+
+		/* operand bytes following the opcode, and stack items consumed and
+		 * left here to validate stack handling once for all opcodes */
+		unsigned int operand = 0;
+		unsigned int pops = 0;
+		unsigned int pushes = 0;
+		switch (op) {
+		case AX_OP_ADD:
+		case AX_OP_SUB:
+		case AX_OP_MUL:
+		case AX_OP_DIV_SIGNED:
+		case AX_OP_DIV_UNSIGNED:
+		case AX_OP_REM_SIGNED:
+		case AX_OP_REM_UNSIGNED:
+		case AX_OP_LSH:
+		case AX_OP_RSH_SIGNED:
+		case AX_OP_RSH_UNSIGNED:
+		case AX_OP_BIT_AND:
+		case AX_OP_BIT_OR:
+		case AX_OP_BIT_XOR:
+		case AX_OP_EQUAL:
+		case AX_OP_LESS_SIGNED:
+		case AX_OP_LESS_UNSIGNED:
+			pops = 2;
+			pushes = 1;
+			break;
+		case AX_OP_LOG_NOT:
+		case AX_OP_BIT_NOT:
+		case AX_OP_REF8:
+		case AX_OP_REF16:
+		case AX_OP_REF32:
+		case AX_OP_REF64:
+			pops = 1;
+			pushes = 1;
+			break;
+		case AX_OP_EXT:
+		case AX_OP_ZERO_EXT:
+			operand = 1;
+			pops = 1;
+			pushes = 1;
+			break;
+		case AX_OP_IF_GOTO:
+			operand = 2;
+			pops = 1;
+			break;
+		case AX_OP_GOTO:
+			operand = 2;
+			break;
+		case AX_OP_CONST8:
+			operand = 1;
+			pushes = 1;
+			break;
+		case AX_OP_CONST16:
+		case AX_OP_REG:
+			operand = 2;
+			pushes = 1;
+			break;
+		case AX_OP_CONST32:
+			operand = 4;
+			pushes = 1;
+			break;
+		case AX_OP_CONST64:
+			operand = 8;
+			pushes = 1;
+			break;
+		case AX_OP_END:
+		case AX_OP_POP:
+			pops = 1;
+			break;
+		case AX_OP_DUP:
+			pops = 1;
+			pushes = 2;
+			break;
+		case AX_OP_SWAP:
+			pops = 2;
+			pushes = 2;
+			break;
+		case AX_OP_PICK:
+			operand = 1;
+			break;
+		case AX_OP_ROT:
+			pops = 3;
+			pushes = 3;
+			break;
+		default:
+			LOG_DEBUG("unsupported agent expression opcode 0x%02" PRIx8, op);
+			return ERROR_FAIL;
+		}
+
+		if (pc + operand > len) {
+			LOG_DEBUG("truncated agent expression");
+			return ERROR_FAIL;
+		}
+		uint64_t arg = agent_expr_operand(bytecode, pc, operand);
+		pc += operand;
+
+		if (op == AX_OP_PICK) {
+			pops = arg + 1;
+			pushes = arg + 2;
+		}
+		if (state->sp < pops || state->sp - pops + pushes > AGENT_EXPR_STACK_SIZE) {
+			LOG_DEBUG("agent expression stack under- or overflow");
+			return ERROR_FAIL;
+		}
+
+		unsigned int sp = state->sp;
+		uint64_t a = sp >= 2 ? stack[sp - 2] : 0;
+		uint64_t b = sp >= 1 ? stack[sp - 1] : 0;
+		int retval;
+
+		switch (op) {
+		case AX_OP_ADD:
+			a += b;
+			break;
+		case AX_OP_SUB:
+			a -= b;
+			break;
+		case AX_OP_MUL:
+			a *= b;
+			break;
+		case AX_OP_DIV_SIGNED:
+		case AX_OP_DIV_UNSIGNED:
+		case AX_OP_REM_SIGNED:
+		case AX_OP_REM_UNSIGNED:
+			if (b == 0) {
+				LOG_DEBUG("agent expression divides by zero");
+				return ERROR_FAIL;
+			}
+			/* INT64_MIN / -1 overflows, x / -1 is -x (modulo 2^64), x % -1 is 0 */
+			if (op == AX_OP_DIV_SIGNED && (int64_t)b == -1)
+				a = -a;
+			else if (op == AX_OP_DIV_SIGNED)
+				a = (int64_t)a / (int64_t)b;
+			else if (op == AX_OP_DIV_UNSIGNED)
+				a /= b;
+			else if (op == AX_OP_REM_SIGNED && (int64_t)b == -1)
+				a = 0;
+			else if (op == AX_OP_REM_SIGNED)
+				a = (int64_t)a % (int64_t)b;
+			else
+				a %= b;
+			break;
+		case AX_OP_LSH:
+			a = b < 64 ? a << b : 0;
+			break;
+		case AX_OP_RSH_SIGNED:
+			a = (int64_t)a >> MIN(b, 63);
+			break;
+		case AX_OP_RSH_UNSIGNED:
+			a = b < 64 ? a >> b : 0;
+			break;
+		case AX_OP_BIT_AND:
+			a &= b;
+			break;
+		case AX_OP_BIT_OR:
+			a |= b;
+			break;
+		case AX_OP_BIT_XOR:
+			a ^= b;
+			break;
+		case AX_OP_EQUAL:
+			a = a == b;
+			break;
+		case AX_OP_LESS_SIGNED:
+			a = (int64_t)a < (int64_t)b;
+			break;
+		case AX_OP_LESS_UNSIGNED:
+			a = a < b;
+			break;
+		case AX_OP_LOG_NOT:
+			stack[sp - 1] = !b;
+			break;
+		case AX_OP_BIT_NOT:
+			stack[sp - 1] = ~b;
+			break;
+		case AX_OP_REF8:
+		case AX_OP_REF16:
+		case AX_OP_REF32:
+		case AX_OP_REF64:
+			retval = agent_expr_ref(state, 1 << (op - AX_OP_REF8), &stack[sp - 1]);
+			if (retval != ERROR_OK)
+				return retval;
+			break;
+		case AX_OP_EXT:
+			if (arg > 0 && arg < 64) {
+				uint64_t sign = 1ULL << (arg - 1);
+				b &= (sign << 1) - 1;
+				stack[sp - 1] = (b ^ sign) - sign;
+			}
+			break;
+		case AX_OP_ZERO_EXT:
+			if (arg < 64)
+				stack[sp - 1] = b & ((1ULL << arg) - 1);
+			break;
+		case AX_OP_IF_GOTO:
+			if (b)
+				pc = arg;
+			break;
+		case AX_OP_GOTO:
+			pc = arg;
+			break;
+		case AX_OP_CONST8:
+		case AX_OP_CONST16:
+		case AX_OP_CONST32:
+		case AX_OP_CONST64:
+			stack[sp] = arg;
+			break;
+		case AX_OP_REG:
+			retval = agent_expr_reg(state, arg, &stack[sp]);
+			if (retval != ERROR_OK)
+				return retval;
+			break;
+		case AX_OP_END:
+			*result = b;
+			return ERROR_OK;
+		case AX_OP_DUP:
+			stack[sp] = b;
+			break;
+		case AX_OP_SWAP:
+			stack[sp - 2] = b;
+			stack[sp - 1] = a;
+			break;
+		case AX_OP_PICK:
+			stack[sp] = stack[sp - 1 - arg];
+			break;
+		case AX_OP_ROT:
+			/* ... c a b -> ... b c a */
+			stack[sp - 1] = a;
+			stack[sp - 2] = stack[sp - 3];
+			stack[sp - 3] = b;
+			break;
+		default:
+			break;
+		}
+
+		/* binary operators leave their result in a */
+		if (pops == 2 && pushes == 1)
+			stack[sp - 2] = a;
+
+		state->sp = sp - pops + pushes;
+	}
+
+	LOG_DEBUG("agent expression did not terminate");
+	return ERROR_FAIL;
+}
+
+int agent_expr_eval(struct target *target, const uint8_t *bytecode,
+		size_t len, uint64_t *result)
+{
+	struct agent_expr_state state = {
+		.target = target,
+	};
+
+	int retval = agent_expr_run(&state, bytecode, len, result);
+	free(state.reg_list);
+
+	return retval;
+}
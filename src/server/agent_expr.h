@@ -0,0 +1,29 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_SERVER_AGENT_EXPR_H
+#define OPENOCD_SERVER_AGENT_EXPR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct target;
+
+/**
+ * Evaluate a GDB agent expression, as sent by GDB for target side
+ * breakpoint conditions, against the current state of a halted target.
+ *
+ * Register numbers are GDB register numbers of the target's register list.
+ * Trace, trace state variable, printf and floating point opcodes are not
+ * supported.
+ *
+ * @param target The halted target
+ * @param bytecode The expression bytecode
+ * @param len Length of the bytecode in bytes
+ * @param result The value on top of the stack at the end opcode
+ * @returns ERROR_OK on success, or ERROR_FAIL if the expression is invalid
+ * or accessing the target failed.
+ */
+int agent_expr_eval(struct target *target, const uint8_t *bytecode,
+		size_t len, uint64_t *result);
+
+#endif /* OPENOCD_SERVER_AGENT_EXPR_H */
@@ -36,10 +36,14 @@
 #include "server.h"
 #include <flash/nor/core.h>
 #include "gdb_server.h"
+#include "agent_expr.h"
 #include <target/image.h>
 #include <jtag/jtag.h>
 #include "rtos/rtos.h"
 #include "target/smp.h"
+#include <helper/event_log.h>
+#include <helper/perf.h>
+#include <helper/time_support.h>
 
 /**
  * @file
@@ -59,19 +63,116 @@ enum gdb_output_flag {
 	GDB_OUTPUT_ALL,
 };
 
-struct target_desc_format {
+/* generated target description, reused while the register layout it was
+ * generated from does not change */
+struct gdb_tdesc_cache {
+	struct target *target;
+	uint32_t layout;
 	char *tdesc;
 	uint32_t tdesc_length;
+	struct gdb_tdesc_cache *next;
+};
+
+/* amount of complete flash sectors collected before being programmed
+ * when streaming vFlashWrite */
+#define GDB_VFLASH_STREAM_CHUNK		(32 * 1024)
+
+/* largest target read done at once while other GDB connections exist */
+#define GDB_READ_SLICE_SIZE			4096
+
+#define GDB_MEM_CACHE_PAGE_SIZE		256
+#define GDB_MEM_CACHE_PAGES			256
+
+struct gdb_mem_cache_page {
+	target_addr_t address;
+	bool valid;
+	uint8_t data[GDB_MEM_CACHE_PAGE_SIZE];
+};
+
+/* host copy of target memory read by GDB, only valid for the target and
+ * memory generation it was filled from */
+struct gdb_mem_cache {
+	struct target *target;
+	unsigned int generation;
+	unsigned int next_victim;
+	struct gdb_mem_cache_page pages[GDB_MEM_CACHE_PAGES];
+};
+
+#define GDB_CRC_CACHE_ENTRIES		64
+#define GDB_CRC_SHADOW_CHUNK_SIZE	(64 * 1024)
+
+/* qCRC results, GDB compare-sections asks again for every section on each
+ * run. Same validity rules as struct gdb_mem_cache */
+struct gdb_crc_cache {
+	struct target *target;
+	unsigned int generation;
+	unsigned int count;
+	unsigned int next_victim;
+	struct {
+		target_addr_t address;
+		uint32_t len;
+		uint32_t crc;
+	} entries[GDB_CRC_CACHE_ENTRIES];
+};
+
+/* memory declared by 'gdb memory_cache_ram', cached only while halted */
+struct gdb_mem_cache_ram {
+	target_addr_t address;
+	target_addr_t size;
+	struct gdb_mem_cache_ram *next;
+};
+
+/* one agent expression of a target side breakpoint condition, GDB stops
+ * at the breakpoint when any condition for its address is true */
+struct gdb_bp_condition {
+	struct target *target;
+	target_addr_t address;
+	uint8_t *bytecode;
+	size_t len;
+	struct gdb_bp_condition *next;
+};
+
+/* memory read split in slices to not hold off other GDB connections */
+struct gdb_pending_read {
+	bool active;
+	bool binary;
+	target_addr_t addr;
+	uint32_t len;
+	uint32_t done;
+	uint8_t *buffer;
+	int64_t start_us;
+};
+
+/* request processing statistics of a connection, see 'gdb stats' */
+struct gdb_connection_stats {
+	uint64_t packets;
+	uint64_t total_us;
+	uint64_t max_us;
 };
 
 /* private connection data for GDB */
 struct gdb_connection {
-	char buffer[GDB_BUFFER_SIZE + 1]; /* Extra byte for null-termination */
+	/* raw input buffer and decoded packet buffer, both buffer_size + 1 bytes
+	 * (extra byte for null-termination) */
+	char *buffer;
+	char *packet_buffer;
+	unsigned int buffer_size;
+	/* outgoing packet being built, including the '$' header and room for
+	 * the '#xx' trailer, see gdb_packet_start() */
+	char *out_buffer;
+	size_t out_size;
+	size_t out_len;
+	unsigned char out_checksum;
 	char *buf_p;
 	int buf_cnt;
 	bool ctrl_c;
 	enum target_state frontend_state;
 	struct image *vflash_image;
+	/* streamed vFlashWrite: set once flash programming has started, the
+	 * first error is kept to be reported by vFlashDone */
+	bool vflash_started;
+	int vflash_error;
+	uint32_t vflash_written;
 	bool closed;
 	/* set to prevent re-entrance from log messages during gdb_get_packet()
 	 * and gdb_put_packet(). */
@@ -93,21 +194,40 @@ struct gdb_connection {
 	bool attached;
 	/* set when extended protocol is used */
 	bool extended_protocol;
-	/* temporarily used for target description support */
-	struct target_desc_format target_desc;
-	/* temporarily used for thread list support */
+	/* qXfer:threads XML, kept while the RTOS thread details are unchanged */
 	char *thread_list;
+	unsigned int thread_list_generation;
 	/* flag to mask the output from gdb_log_callback() */
 	enum gdb_output_flag output_flag;
 	/* Unique index for this GDB connection. */
 	unsigned int unique_index;
+	/* memory read cache, allocated on first use */
+	struct gdb_mem_cache *mem_cache;
+	/* qCRC result cache, allocated on first use */
+	struct gdb_crc_cache *crc_cache;
+	struct gdb_pending_read pending_read;
+	/* time the packet being processed was received */
+	int64_t packet_start_us;
+	/* latency profile of the packet being processed, see 'perf report' */
+	struct perf_sample packet_perf;
+	struct gdb_connection_stats stats;
+	/* list of all GDB connections, for 'gdb stats' */
+	struct connection *connection;
+	struct gdb_connection *next;
 };
 
 #if 0
 #define _DEBUG_GDB_IO_
 #endif
 
+/* binary data (X and x packets) escapes '#', '$', '}' and '*' as 0x7d
+ * followed by the original byte xor 0x20 */
+#define GDB_BINARY_ESCAPE		0x7d
+#define GDB_BINARY_ESCAPE_XOR	0x20
+
 static struct gdb_connection *current_gdb_connection;
+static struct gdb_connection *gdb_connections;
+static struct gdb_bp_condition *gdb_bp_conditions;
 
 static int gdb_breakpoint_override;
 static enum breakpoint_type gdb_breakpoint_override_type;
@@ -120,6 +240,8 @@ static void gdb_log_callback(void *priv, const char *file, unsigned line,
 		const char *function, const char *string);
 
 static void gdb_sig_halted(struct connection *connection);
+static void gdb_mem_cache_invalidate(struct gdb_connection *gdb_con);
+static void gdb_bp_conditions_remove(struct target *target, const target_addr_t *address);
 
 /* number of gdb connections, mainly to suppress gdb related debugging spam
  * in helper/log.c when no gdb connections are actually active */
@@ -131,6 +253,9 @@ static int gdb_actual_connections;
 static bool gdb_use_memory_map = true;
 /* enabled by default*/
 static bool gdb_flash_program = true;
+/* program complete flash sectors while vFlashWrite packets still arrive,
+ * disabled by default */
+static bool gdb_flash_program_streaming;
 
 /* if set, data aborts cause an error to be reported in memory read packets
  * see the code in gdb_read_memory_packet() for further explanations.
@@ -145,6 +270,14 @@ static int gdb_report_register_access_error;
  * via qXfer:features:read packet */
 /* enabled by default */
 static bool gdb_use_target_description = true;
+static struct gdb_tdesc_cache *gdb_tdesc_cache;
+
+/* maximum packet size advertised in qSupported, used for new connections */
+static unsigned int gdb_buffer_size = GDB_BUFFER_SIZE;
+
+/* set to cache memory read by GDB packets, disabled by default */
+static bool gdb_use_memory_cache;
+static struct gdb_mem_cache_ram *gdb_memory_cache_ram;
 
 /* current processing free-run type, used by file-I/O */
 static char gdb_running_type;
@@ -222,14 +355,14 @@ static int gdb_get_char_inner(struct connection *connection, int *next_char)
 #endif
 	for (;; ) {
 		if (connection->service->type != CONNECTION_TCP)
-			gdb_con->buf_cnt = read(connection->fd, gdb_con->buffer, GDB_BUFFER_SIZE);
+			gdb_con->buf_cnt = read(connection->fd, gdb_con->buffer, gdb_con->buffer_size);
 		else {
 			retval = check_pending(connection, 1, NULL);
 			if (retval != ERROR_OK)
 				return retval;
 			gdb_con->buf_cnt = read_socket(connection->fd,
 					gdb_con->buffer,
-					GDB_BUFFER_SIZE);
+					gdb_con->buffer_size);
 		}
 
 		if (gdb_con->buf_cnt > 0)
@@ -401,17 +534,140 @@ static void gdb_log_outgoing_packet(struct connection *connection, char *packet_
 			gdb_connection->unique_index, packet_len, packet_buf, checksum);
 }
 
-static int gdb_put_packet_inner(struct connection *connection,
-		char *buffer, int len)
+/* Make room for len more payload characters plus the '#xx' trailer in the
+ * outgoing packet buffer. */
+static int gdb_packet_reserve(struct gdb_connection *gdb_con, size_t len)
 {
-	int i;
-	unsigned char my_checksum = 0;
+	size_t needed = gdb_con->out_len + len + 3;
+	if (needed <= gdb_con->out_size)
+		return ERROR_OK;
+
+	size_t size = MAX(needed, 2 * gdb_con->out_size);
+	char *out_buffer = realloc(gdb_con->out_buffer, size);
+	if (!out_buffer) {
+		LOG_ERROR("Out of memory building a %zu bytes GDB packet", needed);
+		return ERROR_FAIL;
+	}
+	gdb_con->out_buffer = out_buffer;
+	gdb_con->out_size = size;
+
+	return ERROR_OK;
+}
+
+/* Start building a packet in the connection's output buffer. The payload is
+ * appended with the gdb_packet_append*() functions, which encode directly
+ * into the buffer and keep the checksum up to date, and gdb_packet_send()
+ * transmits it with a single write. The target must not be accessed until
+ * the packet has been sent, as log output could be forwarded to GDB. */
+static int gdb_packet_start(struct connection *connection, size_t len)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+
+	gdb_con->busy = true;
+	gdb_con->out_len = 0;
+	gdb_con->out_checksum = 0;
+	int retval = gdb_packet_reserve(gdb_con, len + 1);
+	if (retval != ERROR_OK)
+		return retval;
+	gdb_con->out_buffer[gdb_con->out_len++] = '$';
+
+	return ERROR_OK;
+}
+
+static int gdb_packet_append(struct connection *connection,
+		const char *data, size_t len)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+
+	int retval = gdb_packet_reserve(gdb_con, len);
+	if (retval != ERROR_OK)
+		return retval;
+
+	char *out = gdb_con->out_buffer + gdb_con->out_len;
+	unsigned char checksum = gdb_con->out_checksum;
+	for (size_t i = 0; i < len; i++) {
+		out[i] = data[i];
+		checksum += data[i];
+	}
+	gdb_con->out_len += len;
+	gdb_con->out_checksum = checksum;
+
+	return ERROR_OK;
+}
+
+/* append data as two lower case hex digits per byte */
+static int gdb_packet_append_hex(struct connection *connection,
+		const uint8_t *data, size_t len)
+{
+	static const char hex_digits[] = "0123456789abcdef";
+	struct gdb_connection *gdb_con = connection->priv;
+
+	int retval = gdb_packet_reserve(gdb_con, 2 * len);
+	if (retval != ERROR_OK)
+		return retval;
+
+	char *out = gdb_con->out_buffer + gdb_con->out_len;
+	unsigned char checksum = gdb_con->out_checksum;
+	for (size_t i = 0; i < len; i++) {
+		char hi = hex_digits[data[i] >> 4];
+		char lo = hex_digits[data[i] & 0xf];
+		*out++ = hi;
+		*out++ = lo;
+		checksum += hi + lo;
+	}
+	gdb_con->out_len += 2 * len;
+	gdb_con->out_checksum = checksum;
+
+	return ERROR_OK;
+}
+
+/* Append binary data for the x packet reply, escaped the inverse of the
+ * decoding done by gdb_get_packet_inner() for X packets. */
+static int gdb_packet_append_binary(struct connection *connection,
+		const uint8_t *data, size_t len)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+
+	/* worst case every byte is escaped */
+	int retval = gdb_packet_reserve(gdb_con, 2 * len);
+	if (retval != ERROR_OK)
+		return retval;
+
+	char *out = gdb_con->out_buffer + gdb_con->out_len;
+	unsigned char checksum = gdb_con->out_checksum;
+	size_t count = 0;
+	for (size_t i = 0; i < len; i++) {
+		uint8_t c = data[i];
+		if (c == '#' || c == '$' || c == '*' || c == GDB_BINARY_ESCAPE) {
+			out[count++] = GDB_BINARY_ESCAPE;
+			checksum += GDB_BINARY_ESCAPE;
+			c ^= GDB_BINARY_ESCAPE_XOR;
+		}
+		out[count++] = c;
+		checksum += c;
+	}
+	gdb_con->out_len += count;
+	gdb_con->out_checksum = checksum;
+
+	return ERROR_OK;
+}
+
+/* Transmit the packet built in the output buffer and wait for GDB to
+ * acknowledge it, retransmitting on a negative reply. */
+static int gdb_packet_transmit(struct connection *connection)
+{
+	static const char hex_digits[] = "0123456789abcdef";
 	int reply;
 	int retval;
 	struct gdb_connection *gdb_con = connection->priv;
+	unsigned char my_checksum = gdb_con->out_checksum;
+	char *buffer = gdb_con->out_buffer;
+	int len = gdb_con->out_len;
 
-	for (i = 0; i < len; i++)
-		my_checksum += buffer[i];
+	/* gdb_packet_reserve() always leaves room for the trailer */
+	buffer[len++] = '#';
+	buffer[len++] = hex_digits[my_checksum >> 4];
+	buffer[len++] = hex_digits[my_checksum & 0xf];
 
 #ifdef _DEBUG_GDB_IO_
 	/*
@@ -441,31 +697,12 @@ static int gdb_put_packet_inner(struct connection *connection,
 #endif
 
 	while (1) {
-		gdb_log_outgoing_packet(connection, buffer, len, my_checksum);
-
-		char local_buffer[1024];
-		local_buffer[0] = '$';
-		if ((size_t)len + 4 <= sizeof(local_buffer)) {
-			/* performance gain on smaller packets by only a single call to gdb_write() */
-			memcpy(local_buffer + 1, buffer, len++);
-			len += snprintf(local_buffer + len, sizeof(local_buffer) - len, "#%02x", my_checksum);
-			retval = gdb_write(connection, local_buffer, len);
-			if (retval != ERROR_OK)
-				return retval;
-		} else {
-			/* larger packets are transmitted directly from caller supplied buffer
-			 * by several calls to gdb_write() to avoid dynamic allocation */
-			snprintf(local_buffer + 1, sizeof(local_buffer) - 1, "#%02x", my_checksum);
-			retval = gdb_write(connection, local_buffer, 1);
-			if (retval != ERROR_OK)
-				return retval;
-			retval = gdb_write(connection, buffer, len);
-			if (retval != ERROR_OK)
-				return retval;
-			retval = gdb_write(connection, local_buffer + 1, 3);
-			if (retval != ERROR_OK)
-				return retval;
-		}
+		gdb_log_outgoing_packet(connection, buffer + 1, len - 4, my_checksum);
+
+		/* header, payload and checksum go out with a single write */
+		retval = gdb_write(connection, buffer, len);
+		if (retval != ERROR_OK)
+			return retval;
 
 		if (gdb_con->noack_mode)
 			break;
@@ -522,11 +759,11 @@ static int gdb_put_packet_inner(struct connection *connection,
 	return ERROR_OK;
 }
 
-int gdb_put_packet(struct connection *connection, char *buffer, int len)
+/* send the packet started by gdb_packet_start() */
+static int gdb_packet_send(struct connection *connection)
 {
 	struct gdb_connection *gdb_con = connection->priv;
-	gdb_con->busy = true;
-	int retval = gdb_put_packet_inner(connection, buffer, len);
+	int retval = gdb_packet_transmit(connection);
 	gdb_con->busy = false;
 
 	/* we sent some data, reset timer for keep alive messages */
@@ -535,6 +772,20 @@ int gdb_put_packet(struct connection *connection, char *buffer, int len)
 	return retval;
 }
 
+int gdb_put_packet(struct connection *connection, char *buffer, int len)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+	int retval = gdb_packet_start(connection, len);
+	if (retval == ERROR_OK)
+		retval = gdb_packet_append(connection, buffer, len);
+	if (retval != ERROR_OK) {
+		gdb_con->busy = false;
+		return retval;
+	}
+
+	return gdb_packet_send(connection);
+}
+
 static inline int fetch_packet(struct connection *connection,
 		int *checksum_ok, int noack, int *len, char *buffer)
 {
@@ -578,14 +829,14 @@ static inline int fetch_packet(struct connection *connection,
 					break;
 				}
 
-				if (character == '}') {
+				if (character == GDB_BINARY_ESCAPE) {
 					/* data transmitted in binary mode (X packet)
 					 * uses 0x7d as escape character */
 					my_checksum += character & 0xff;
 					character = *buf++;
 					i++;
 					my_checksum += character & 0xff;
-					buffer[count++] = (character ^ 0x20) & 0xff;
+					buffer[count++] = (character ^ GDB_BINARY_ESCAPE_XOR) & 0xff;
 				} else {
 					my_checksum += character & 0xff;
 					buffer[count++] = character & 0xff;
@@ -609,7 +860,7 @@ static inline int fetch_packet(struct connection *connection,
 		if (character == '#')
 			break;
 
-		if (character == '}') {
+		if (character == GDB_BINARY_ESCAPE) {
 			/* data transmitted in binary mode (X packet)
 			 * uses 0x7d as escape character */
 			my_checksum += character & 0xff;
@@ -619,7 +870,7 @@ static inline int fetch_packet(struct connection *connection,
 				break;
 
 			my_checksum += character & 0xff;
-			buffer[count++] = (character ^ 0x20) & 0xff;
+			buffer[count++] = (character ^ GDB_BINARY_ESCAPE_XOR) & 0xff;
 		} else {
 			my_checksum += character & 0xff;
 			buffer[count++] = character & 0xff;
@@ -926,6 +1177,44 @@ static void gdb_fileio_reply(struct target *target, struct connection *connectio
 	}
 }
 
+/* Evaluate the conditions of the breakpoint the target halted at. Returns
+ * false only when the breakpoint has conditions and all of them are false,
+ * errors during evaluation report the stop to GDB. */
+static bool gdb_bp_condition_met(struct target *target)
+{
+	if (target->debug_reason != DBG_REASON_BREAKPOINT || !gdb_bp_conditions)
+		return true;
+
+	struct reg *pc = register_get_by_name(target->reg_cache, "pc", true);
+	if (!pc)
+		return true;
+	if (!pc->valid && pc->type->get(pc) != ERROR_OK)
+		return true;
+	target_addr_t address = buf_get_u64(pc->value, 0, MIN(pc->size, 64));
+
+	bool conditional = false;
+	for (struct gdb_bp_condition *c = gdb_bp_conditions; c; c = c->next) {
+		if (c->target != target || c->address != address)
+			continue;
+
+		conditional = true;
+		uint64_t result;
+		if (agent_expr_eval(target, c->bytecode, c->len, &result) != ERROR_OK) {
+			LOG_TARGET_WARNING(target, "failed to evaluate breakpoint condition at "
+				TARGET_ADDR_FMT ", stopping", address);
+			return true;
+		}
+		if (result)
+			return true;
+	}
+
+	if (conditional)
+		LOG_TARGET_DEBUG(target, "breakpoint condition at " TARGET_ADDR_FMT
+			" is false, resuming", address);
+
+	return !conditional;
+}
+
 static void gdb_frontend_halted(struct target *target, struct connection *connection)
 {
 	struct gdb_connection *gdb_connection = connection->priv;
@@ -940,6 +1229,18 @@ static void gdb_frontend_halted(struct target *target, struct connection *connec
 	 * that are to be ignored.
 	 */
 	if (gdb_connection->frontend_state == TARGET_RUNNING) {
+		/* already resumed by the breakpoint condition check of another
+		 * connection */
+		if (target->state != TARGET_HALTED)
+			return;
+
+		/* target side breakpoint conditions, keep running without
+		 * involving GDB while they are false */
+		if (!gdb_bp_condition_met(target)) {
+			target_resume(target, 1, 0x0, 1, 0);
+			return;
+		}
+
 		/* stop forwarding log packets! */
 		gdb_connection->output_flag = GDB_OUTPUT_NO;
 
@@ -957,6 +1258,24 @@ static int gdb_target_callback_event_handler(struct target *target,
 	struct connection *connection = priv;
 	struct gdb_service *gdb_service = connection->service->priv;
 
+	/* any target of a SMP group may have altered the shared memory */
+	switch (event) {
+		case TARGET_EVENT_HALTED:
+		case TARGET_EVENT_RESUMED:
+		case TARGET_EVENT_DEBUG_HALTED:
+		case TARGET_EVENT_DEBUG_RESUMED:
+		case TARGET_EVENT_RESET_START:
+		case TARGET_EVENT_RESET_END:
+		case TARGET_EVENT_EXAMINE_START:
+		case TARGET_EVENT_GDB_FLASH_ERASE_START:
+		case TARGET_EVENT_GDB_FLASH_WRITE_START:
+		case TARGET_EVENT_GDB_FLASH_WRITE_END:
+			gdb_mem_cache_invalidate(connection->priv);
+			break;
+		default:
+			break;
+	}
+
 	if (gdb_service->target != target)
 		return ERROR_OK;
 
@@ -982,6 +1301,28 @@ static int gdb_new_connection(struct connection *connection)
 	int initial_ack;
 	static unsigned int next_unique_id = 1;
 
+	if (!gdb_connection) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	/* the packet size is sampled here, so changing it only affects new connections */
+	gdb_connection->buffer_size = gdb_buffer_size;
+	gdb_connection->buffer = malloc(gdb_buffer_size + 1);
+	gdb_connection->packet_buffer = malloc(gdb_buffer_size + 1);
+	/* grown on demand for larger replies, '$' plus payload plus '#xx' */
+	gdb_connection->out_size = gdb_buffer_size + 4;
+	gdb_connection->out_buffer = malloc(gdb_connection->out_size);
+	if (!gdb_connection->buffer || !gdb_connection->packet_buffer ||
+			!gdb_connection->out_buffer) {
+		LOG_ERROR("Out of memory allocating %u bytes GDB packet buffers", gdb_buffer_size);
+		free(gdb_connection->buffer);
+		free(gdb_connection->packet_buffer);
+		free(gdb_connection->out_buffer);
+		free(gdb_connection);
+		return ERROR_FAIL;
+	}
+
 	target = get_target_from_connection(connection);
 	connection->priv = gdb_connection;
 	connection->cmd_ctx->current_target = target;
@@ -992,6 +1333,9 @@ static int gdb_new_connection(struct connection *connection)
 	gdb_connection->ctrl_c = false;
 	gdb_connection->frontend_state = TARGET_HALTED;
 	gdb_connection->vflash_image = NULL;
+	gdb_connection->vflash_started = false;
+	gdb_connection->vflash_error = ERROR_OK;
+	gdb_connection->vflash_written = 0;
 	gdb_connection->closed = false;
 	gdb_connection->busy = false;
 	gdb_connection->noack_mode = 0;
@@ -999,11 +1343,17 @@ static int gdb_new_connection(struct connection *connection)
 	gdb_connection->mem_write_error = false;
 	gdb_connection->attached = true;
 	gdb_connection->extended_protocol = false;
-	gdb_connection->target_desc.tdesc = NULL;
-	gdb_connection->target_desc.tdesc_length = 0;
 	gdb_connection->thread_list = NULL;
 	gdb_connection->output_flag = GDB_OUTPUT_NO;
 	gdb_connection->unique_index = next_unique_id++;
+	gdb_connection->mem_cache = NULL;
+	gdb_connection->crc_cache = NULL;
+	memset(&gdb_connection->pending_read, 0, sizeof(gdb_connection->pending_read));
+	gdb_connection->packet_start_us = 0;
+	memset(&gdb_connection->stats, 0, sizeof(gdb_connection->stats));
+	gdb_connection->connection = connection;
+	gdb_connection->next = gdb_connections;
+	gdb_connections = gdb_connection;
 
 	/* output goes through gdb connection */
 	command_set_output_handler(connection->cmd_ctx, gdb_output, connection);
@@ -1014,6 +1364,7 @@ static int gdb_new_connection(struct connection *connection)
 	 */
 	breakpoint_clear_target(target);
 	watchpoint_clear_target(target);
+	gdb_bp_conditions_remove(target, NULL);
 
 	/* Since version 3.95 (gdb-19990504), with the exclusion of 6.5~6.8, GDB
 	 * sends an ACK at connection with the following comment in its source code:
@@ -1117,6 +1468,19 @@ static int gdb_connection_closed(struct connection *connection)
 	/* if this connection registered a debug-message receiver delete it */
 	delete_debug_msg_receiver(connection->cmd_ctx, target);
 
+	free(gdb_connection->buffer);
+	free(gdb_connection->packet_buffer);
+	free(gdb_connection->out_buffer);
+	free(gdb_connection->thread_list);
+	free(gdb_connection->mem_cache);
+	free(gdb_connection->crc_cache);
+	free(gdb_connection->pending_read.buffer);
+	for (struct gdb_connection **p = &gdb_connections; *p; p = &(*p)->next) {
+		if (*p == gdb_connection) {
+			*p = gdb_connection->next;
+			break;
+		}
+	}
 	free(connection->priv);
 	connection->priv = NULL;
 
@@ -1261,12 +1625,20 @@ static int gdb_get_registers_packet(struct connection *connection,
 	if (retval != ERROR_OK)
 		return gdb_error(connection, retval);
 
+	bool fetch = false;
 	for (i = 0; i < reg_list_size; i++) {
 		if (!reg_list[i] || reg_list[i]->exist == false || reg_list[i]->hidden)
 			continue;
 		reg_packet_size += DIV_ROUND_UP(reg_list[i]->size, 8) * 2;
+		if (!reg_list[i]->valid)
+			fetch = true;
 	}
 
+	/* fill the register cache in one go if the target can, anything left
+	 * invalid is read one by one below */
+	if (fetch)
+		target_read_all_core_regs(target, REG_CLASS_GENERAL);
+
 	assert(reg_packet_size > 0);
 
 	reg_packet = malloc(reg_packet_size + 1); /* plus one for string termination null */
@@ -1398,6 +1770,10 @@ static int gdb_get_register_packet(struct connection *connection,
 
 	reg_packet = calloc(DIV_ROUND_UP(reg_list[reg_num]->size, 8) * 2 + 1, 1); /* plus one for string termination null */
 
+	/* GDB usually asks for the other registers not sent by 'g' next */
+	if (!reg_list[reg_num]->valid)
+		target_read_all_core_regs(target, REG_CLASS_ALL);
+
 	retval = gdb_get_reg_value_as_str(target, reg_packet, reg_list[reg_num]);
 	if (retval != ERROR_OK && gdb_report_register_access_error) {
 		LOG_DEBUG("Couldn't get register %s.", reg_list[reg_num]->name);
@@ -1495,46 +1871,240 @@ static int gdb_error(struct connection *connection, int retval)
 	return ERROR_OK;
 }
 
-static int gdb_read_memory_packet(struct connection *connection,
-		char const *packet, int packet_size)
+static void gdb_mem_cache_invalidate(struct gdb_connection *gdb_con)
 {
-	struct target *target = get_target_from_connection(connection);
-	char *separator;
-	uint64_t addr = 0;
-	uint32_t len = 0;
+	if (gdb_con->crc_cache)
+		gdb_con->crc_cache->count = 0;
 
-	uint8_t *buffer;
-	char *hex_buffer;
+	if (!gdb_con->mem_cache)
+		return;
 
-	int retval = ERROR_OK;
+	for (unsigned int i = 0; i < GDB_MEM_CACHE_PAGES; i++)
+		gdb_con->mem_cache->pages[i].valid = false;
+}
 
-	/* skip command character */
-	packet++;
+/* Flash content only changes by erase or write, which go through the target
+ * memory API or the GDB flash events. RAM may be changed by the target code,
+ * so it is only cached while halted. Anything else may have side effects on
+ * read and is never cached. */
+static bool gdb_mem_cache_page_cacheable(struct target *target, target_addr_t page)
+{
+	target_addr_t page_end = page + GDB_MEM_CACHE_PAGE_SIZE - 1;
+	struct flash_bank *bank;
 
-	addr = strtoull(packet, &separator, 16);
+	if (page_end < page)
+		return false;
 
-	if (*separator != ',') {
-		LOG_ERROR("incomplete read memory packet received, dropping connection");
-		return ERROR_SERVER_REMOTE_CLOSED;
+	if (get_flash_bank_by_addr(target, page, false, &bank) == ERROR_OK && bank
+			&& page_end <= bank->base + bank->size - 1)
+		return true;
+
+	if (target->state != TARGET_HALTED)
+		return false;
+
+	for (struct gdb_mem_cache_ram *r = gdb_memory_cache_ram; r; r = r->next) {
+		if (page >= r->address && page_end <= r->address + r->size - 1)
+			return true;
 	}
 
-	len = strtoul(separator + 1, NULL, 16);
+	return false;
+}
 
-	if (!len) {
-		LOG_WARNING("invalid read memory packet received (len == 0)");
-		gdb_put_packet(connection, "", 0);
+static int gdb_read_buffer_cached(struct connection *connection, struct target *target,
+		target_addr_t addr, uint32_t len, uint8_t *buffer)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+	target_addr_t first = addr & ~(target_addr_t)(GDB_MEM_CACHE_PAGE_SIZE - 1);
+	target_addr_t last = (addr + len - 1) & ~(target_addr_t)(GDB_MEM_CACHE_PAGE_SIZE - 1);
+
+	/* flash content written or verified by OpenOCD */
+	if (flash_shadow_read(target, addr, len, buffer))
 		return ERROR_OK;
+
+	if (!gdb_use_memory_cache || last < first)
+		return target_read_buffer(target, addr, len, buffer);
+
+	/* a request touching anything not cacheable is passed through as a whole */
+	for (target_addr_t page = first; ; page += GDB_MEM_CACHE_PAGE_SIZE) {
+		if (!gdb_mem_cache_page_cacheable(target, page))
+			return target_read_buffer(target, addr, len, buffer);
+		if (page == last)
+			break;
 	}
 
-	buffer = malloc(len);
+	if (!gdb_con->mem_cache) {
+		gdb_con->mem_cache = calloc(1, sizeof(struct gdb_mem_cache));
+		if (!gdb_con->mem_cache)
+			return target_read_buffer(target, addr, len, buffer);
+	}
 
-	LOG_DEBUG("addr: 0x%16.16" PRIx64 ", len: 0x%8.8" PRIx32 "", addr, len);
+	struct gdb_mem_cache *cache = gdb_con->mem_cache;
+	if (cache->target != target || cache->generation != target->memory_generation) {
+		gdb_mem_cache_invalidate(gdb_con);
+		cache->target = target;
+		cache->generation = target->memory_generation;
+	}
+
+	for (target_addr_t page = first; ; page += GDB_MEM_CACHE_PAGE_SIZE) {
+		struct gdb_mem_cache_page *p = NULL;
+		for (unsigned int i = 0; i < GDB_MEM_CACHE_PAGES; i++) {
+			if (cache->pages[i].valid && cache->pages[i].address == page) {
+				p = &cache->pages[i];
+				break;
+			}
+		}
+
+		if (!p) {
+			p = &cache->pages[cache->next_victim];
+			cache->next_victim = (cache->next_victim + 1) % GDB_MEM_CACHE_PAGES;
+			p->valid = false;
+			int retval = target_read_buffer(target, page, GDB_MEM_CACHE_PAGE_SIZE, p->data);
+			if (retval != ERROR_OK)
+				return target_read_buffer(target, addr, len, buffer);
+			p->address = page;
+			p->valid = true;
+		}
+
+		target_addr_t start = MAX(addr, page);
+		target_addr_t end = MIN(addr + len - 1, page + GDB_MEM_CACHE_PAGE_SIZE - 1);
+		memcpy(buffer + (start - addr), p->data + (start - page), end - start + 1);
+
+		if (page == last)
+			break;
+	}
+
+	return ERROR_OK;
+}
+
+/* Same rules as gdb_mem_cache_page_cacheable() for a whole range */
+static bool gdb_crc_cache_range_cacheable(struct target *target, target_addr_t addr, uint32_t len)
+{
+	target_addr_t end = addr + len - 1;
+	struct flash_bank *bank;
+
+	if (!len || end < addr)
+		return false;
+
+	if (get_flash_bank_by_addr(target, addr, false, &bank) == ERROR_OK && bank
+			&& end <= bank->base + bank->size - 1)
+		return true;
+
+	if (target->state != TARGET_HALTED)
+		return false;
+
+	for (struct gdb_mem_cache_ram *r = gdb_memory_cache_ram; r; r = r->next) {
+		if (addr >= r->address && end <= r->address + r->size - 1)
+			return true;
+	}
+
+	return false;
+}
+
+/* CRC of flash content written and verified by OpenOCD, computed on the
+ * host. False unless the flash shadow covers the whole range. */
+static bool gdb_checksum_flash_shadow(struct target *target, target_addr_t addr,
+		uint32_t len, uint32_t *checksum)
+{
+	uint32_t chunk_size = MIN(len, GDB_CRC_SHADOW_CHUNK_SIZE);
+	uint32_t crc = 0xffffffff;
+
+	if (!len)
+		return false;
+
+	uint8_t *buffer = malloc(chunk_size);
+	if (!buffer)
+		return false;
+
+	for (uint32_t done = 0; done < len; done += chunk_size) {
+		uint32_t n = MIN(len - done, chunk_size);
+		if (!flash_shadow_read(target, addr + done, n, buffer)
+				|| image_calculate_checksum_update(buffer, n, &crc) != ERROR_OK) {
+			free(buffer);
+			return false;
+		}
+	}
+
+	free(buffer);
+	*checksum = crc;
+	return true;
+}
+
+static int gdb_checksum_memory(struct connection *connection, struct target *target,
+		target_addr_t addr, uint32_t len, uint32_t *checksum)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+	bool cacheable = gdb_use_memory_cache && gdb_crc_cache_range_cacheable(target, addr, len);
+	struct gdb_crc_cache *cache = gdb_con->crc_cache;
+
+	if (cacheable && !cache)
+		cache = gdb_con->crc_cache = calloc(1, sizeof(struct gdb_crc_cache));
+
+	if (cacheable && cache) {
+		if (cache->target != target || cache->generation != target->memory_generation) {
+			cache->count = 0;
+			cache->target = target;
+			cache->generation = target->memory_generation;
+		}
+
+		for (unsigned int i = 0; i < cache->count; i++) {
+			if (cache->entries[i].address == addr && cache->entries[i].len == len) {
+				*checksum = cache->entries[i].crc;
+				return ERROR_OK;
+			}
+		}
+	}
+
+	if (gdb_checksum_flash_shadow(target, addr, len, checksum))
+		return ERROR_OK;
+
+	int retval = target_checksum_memory(target, addr, len, checksum);
+	if (retval != ERROR_OK || !cacheable || !cache)
+		return retval;
+
+	unsigned int i = cache->count;
+	if (i < GDB_CRC_CACHE_ENTRIES) {
+		cache->count++;
+	} else {
+		i = cache->next_victim;
+		cache->next_victim = (cache->next_victim + 1) % GDB_CRC_CACHE_ENTRIES;
+	}
+	cache->entries[i].address = addr;
+	cache->entries[i].len = len;
+	cache->entries[i].crc = *checksum;
+
+	return ERROR_OK;
+}
+
+static void gdb_stats_update(struct gdb_connection *gdb_con, int64_t start_us)
+{
+	uint64_t elapsed = timeval_us() - start_us;
+
+	gdb_con->stats.packets++;
+	gdb_con->stats.total_us += elapsed;
+	gdb_con->stats.max_us = MAX(gdb_con->stats.max_us, elapsed);
+}
+
+/* Read the next slice of the pending memory read, or all of it when this is
+ * the only GDB connection, and send the reply once complete. */
+static int gdb_read_memory_continue(struct connection *connection)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+	struct gdb_pending_read *read = &gdb_con->pending_read;
+	struct target *target = get_target_from_connection(connection);
+	int retval = ERROR_OK;
+
+	uint32_t slice = read->len - read->done;
+	if (gdb_actual_connections > 1)
+		slice = MIN(slice, GDB_READ_SLICE_SIZE);
+
+	target_addr_t addr = read->addr + read->done;
+	uint8_t *buffer = read->buffer + read->done;
 
 	retval = ERROR_NOT_IMPLEMENTED;
 	if (target->rtos)
-		retval = rtos_read_buffer(target, addr, len, buffer);
+		retval = rtos_read_buffer(target, addr, slice, buffer);
 	if (retval == ERROR_NOT_IMPLEMENTED)
-		retval = target_read_buffer(target, addr, len, buffer);
+		retval = gdb_read_buffer_cached(connection, target, addr, slice, buffer);
 
 	if ((retval != ERROR_OK) && !gdb_report_data_abort) {
 		/* TODO : Here we have to lie and send back all zero's lest stack traces won't work.
@@ -1550,24 +2120,111 @@ static int gdb_read_memory_packet(struct connection *connection,
 		 * For now, the default is to fix up things to make current GDB versions work.
 		 * This can be overwritten using the "gdb report_data_abort <'enable'|'disable'>" command.
 		 */
-		memset(buffer, 0, len);
+		memset(buffer, 0, slice);
 		retval = ERROR_OK;
 	}
 
-	if (retval == ERROR_OK) {
-		hex_buffer = malloc(len * 2 + 1);
+	if (retval == ERROR_OK) {
+		read->done += slice;
+		if (read->done < read->len) {
+			/* let the other connections run, then come back for more */
+			connection->input_pending = true;
+			return ERROR_OK;
+		}
+
+		/* encode straight into the outgoing packet, worst case for both
+		 * encodings is two characters per byte */
+		retval = gdb_packet_start(connection, 2 * read->len + 1);
+		if (retval == ERROR_OK) {
+			if (read->binary) {
+				retval = gdb_packet_append(connection, "b", 1);
+				if (retval == ERROR_OK)
+					retval = gdb_packet_append_binary(connection, read->buffer, read->len);
+			} else {
+				retval = gdb_packet_append_hex(connection, read->buffer, read->len);
+			}
+		}
+
+		if (retval == ERROR_OK) {
+			retval = gdb_packet_send(connection);
+		} else {
+			gdb_con->busy = false;
+			retval = gdb_error(connection, retval);
+		}
+	} else
+		retval = gdb_error(connection, retval);
+
+	free(read->buffer);
+	read->buffer = NULL;
+	read->active = false;
+	connection->input_pending = gdb_con->buf_cnt > 0;
+	gdb_stats_update(gdb_con, read->start_us);
+	perf_end(&gdb_con->packet_perf, retval);
+
+	return retval;
+}
+
+static int gdb_read_memory(struct connection *connection,
+		char const *packet, bool binary)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+	struct gdb_pending_read *read = &gdb_con->pending_read;
+	char *separator;
+	uint64_t addr = 0;
+	uint32_t len = 0;
+
+	/* skip command character */
+	packet++;
+
+	addr = strtoull(packet, &separator, 16);
+
+	if (*separator != ',') {
+		LOG_ERROR("incomplete read memory packet received, dropping connection");
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+
+	len = strtoul(separator + 1, NULL, 16);
 
-		size_t pkt_len = hexify(hex_buffer, buffer, len, len * 2 + 1);
+	if (!len) {
+		if (binary) {
+			/* zero length x packet probes for support of the packet */
+			gdb_put_packet(connection, "b", 1);
+			return ERROR_OK;
+		}
+		LOG_WARNING("invalid read memory packet received (len == 0)");
+		gdb_put_packet(connection, "", 0);
+		return ERROR_OK;
+	}
 
-		gdb_put_packet(connection, hex_buffer, pkt_len);
+	read->buffer = malloc(len);
+	if (!read->buffer) {
+		LOG_ERROR("Out of memory reading %" PRIu32 " bytes", len);
+		return gdb_error(connection, ERROR_FAIL);
+	}
 
-		free(hex_buffer);
-	} else
-		retval = gdb_error(connection, retval);
+	LOG_DEBUG("addr: 0x%16.16" PRIx64 ", len: 0x%8.8" PRIx32 "", addr, len);
 
-	free(buffer);
+	read->active = true;
+	read->binary = binary;
+	read->addr = addr;
+	read->len = len;
+	read->done = 0;
+	read->start_us = gdb_con->packet_start_us;
 
-	return retval;
+	return gdb_read_memory_continue(connection);
+}
+
+static int gdb_read_memory_packet(struct connection *connection,
+		char const *packet, int packet_size)
+{
+	return gdb_read_memory(connection, packet, false);
+}
+
+/* 'x addr,length' replies with 'b' followed by the escaped binary data */
+static int gdb_read_memory_binary_packet(struct connection *connection,
+		char const *packet, int packet_size)
+{
+	return gdb_read_memory(connection, packet, true);
 }
 
 static int gdb_write_memory_packet(struct connection *connection,
@@ -1728,6 +2385,75 @@ static int gdb_step_continue_packet(struct connection *connection,
 	return retval;
 }
 
+/* remove the conditions of the breakpoint at address, or of all breakpoints
+ * of the target if address is NULL, or of all targets if target is NULL */
+static void gdb_bp_conditions_remove(struct target *target, const target_addr_t *address)
+{
+	struct gdb_bp_condition **p = &gdb_bp_conditions;
+
+	while (*p) {
+		struct gdb_bp_condition *c = *p;
+		if ((!target || c->target == target) && (!address || c->address == *address)) {
+			*p = c->next;
+			free(c->bytecode);
+			free(c);
+		} else {
+			p = &c->next;
+		}
+	}
+}
+
+/* Parse the ";X<len>,<bytecode>" condition list GDB appends to Z0 and Z1
+ * packets into a new list. Breakpoint commands (";cmds:") are ignored. */
+static int gdb_bp_conditions_parse(struct target *target, target_addr_t address,
+		const char *list, struct gdb_bp_condition **conditions)
+{
+	*conditions = NULL;
+
+	while (*list == ';') {
+		list++;
+		if (strncmp(list, "cmds:", 5) == 0)
+			break;
+
+		char *separator;
+		size_t len = 0;
+		if (*list == 'X')
+			len = strtoul(list + 1, &separator, 16);
+		if (!len || *separator != ',' || strlen(separator + 1) < 2 * len)
+			goto error;
+
+		struct gdb_bp_condition *c = calloc(1, sizeof(*c));
+		uint8_t *bytecode = malloc(len);
+		if (!c || !bytecode) {
+			free(c);
+			free(bytecode);
+			goto error;
+		}
+		c->target = target;
+		c->address = address;
+		c->bytecode = bytecode;
+		c->len = len;
+		c->next = *conditions;
+		*conditions = c;
+
+		if (unhexify(bytecode, separator + 1, len) != len)
+			goto error;
+		list = separator + 1 + 2 * len;
+	}
+
+	return ERROR_OK;
+
+error:
+	LOG_ERROR("invalid breakpoint condition list");
+	while (*conditions) {
+		struct gdb_bp_condition *next = (*conditions)->next;
+		free((*conditions)->bytecode);
+		free(*conditions);
+		*conditions = next;
+	}
+	return ERROR_FAIL;
+}
+
 static int gdb_breakpoint_watchpoint_packet(struct connection *connection,
 		char const *packet, int packet_size)
 {
@@ -1780,7 +2506,29 @@ static int gdb_breakpoint_watchpoint_packet(struct connection *connection,
 		case 0:
 		case 1:
 			if (packet[0] == 'Z') {
-				retval = breakpoint_add(target, address, size, bp_type);
+				struct gdb_bp_condition *conditions;
+				retval = gdb_bp_conditions_parse(target, address, separator, &conditions);
+				/* GDB inserts the breakpoint again to update its conditions */
+				if (retval == ERROR_OK && !breakpoint_find(target, address))
+					retval = breakpoint_add(target, address, size, bp_type);
+				if (retval == ERROR_OK) {
+					gdb_bp_conditions_remove(target, &address);
+					while (conditions) {
+						struct gdb_bp_condition *next = conditions->next;
+						conditions->next = gdb_bp_conditions;
+						gdb_bp_conditions = conditions;
+						conditions = next;
+					}
+				} else {
+					/* free the parsed conditions */
+					while (conditions) {
+						struct gdb_bp_condition *next = conditions->next;
+						free(conditions->bytecode);
+						free(conditions);
+						conditions = next;
+					}
+				}
+
 				if (retval == ERROR_NOT_IMPLEMENTED) {
 					/* Send empty reply to report that breakpoints of this type are not supported */
 					gdb_put_packet(connection, "", 0);
@@ -1792,6 +2540,7 @@ static int gdb_breakpoint_watchpoint_packet(struct connection *connection,
 					gdb_put_packet(connection, "OK", 2);
 			} else {
 				breakpoint_remove(target, address);
+				gdb_bp_conditions_remove(target, &address);
 				gdb_put_packet(connection, "OK", 2);
 			}
 			break;
@@ -2549,27 +3298,111 @@ error:
 	return retval;
 }
 
-static int gdb_get_target_description_chunk(struct target *target, struct target_desc_format *target_desc,
-		char **chunk, int32_t offset, uint32_t length)
+static uint32_t gdb_tdesc_layout_hash(uint32_t hash, uint64_t value)
 {
-	if (!target_desc) {
-		LOG_ERROR("Unable to Generate Target Description");
-		return ERROR_FAIL;
+	/* FNV-1a over the bytes of value */
+	for (unsigned int i = 0; i < sizeof(value); i++) {
+		hash ^= (value >> (8 * i)) & 0xff;
+		hash *= 16777619;
+	}
+	return hash;
+}
+
+static uint32_t gdb_tdesc_layout_hash_regs(uint32_t hash, struct target *target)
+{
+	for (struct reg_cache *cache = target->reg_cache; cache; cache = cache->next) {
+		hash = gdb_tdesc_layout_hash(hash, (uintptr_t)cache->reg_list);
+		hash = gdb_tdesc_layout_hash(hash, cache->num_regs);
+		for (unsigned int i = 0; i < cache->num_regs; i++) {
+			const struct reg *reg = &cache->reg_list[i];
+			hash = gdb_tdesc_layout_hash(hash, reg->exist | (reg->hidden << 1)
+					| ((uint64_t)reg->size << 32));
+			hash = gdb_tdesc_layout_hash(hash, reg->number);
+			hash = gdb_tdesc_layout_hash(hash, (uintptr_t)reg->name);
+			hash = gdb_tdesc_layout_hash(hash, (uintptr_t)reg->feature);
+			hash = gdb_tdesc_layout_hash(hash, (uintptr_t)reg->reg_data_type);
+		}
 	}
 
-	char *tdesc = target_desc->tdesc;
-	uint32_t tdesc_length = target_desc->tdesc_length;
+	return hash;
+}
 
-	if (!tdesc) {
-		int retval = gdb_generate_target_description(target, &tdesc);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Unable to Generate Target Description");
+/* Cheap fingerprint of everything the target description is generated
+ * from: the register caches of the target, or of its SMP group, and the
+ * existence, visibility, size, number, name and type of every register. */
+static uint32_t gdb_tdesc_layout(struct target *target)
+{
+	uint32_t hash = 2166136261u;
+	const char *architecture = target_get_gdb_arch(target);
+
+	hash = gdb_tdesc_layout_hash(hash, (uintptr_t)architecture);
+
+	if (target->smp) {
+		struct target_list *head;
+		foreach_smp_target(head, target->smp_targets)
+			hash = gdb_tdesc_layout_hash_regs(hash, head->target);
+	} else {
+		hash = gdb_tdesc_layout_hash_regs(hash, target);
+	}
+
+	return hash;
+}
+
+/* Return the target description, generated again only when the register
+ * layout of the target changed since it was last generated. */
+static int gdb_get_cached_target_description(struct target *target,
+		const char **tdesc, uint32_t *tdesc_length)
+{
+	struct gdb_tdesc_cache *cache;
+	uint32_t layout = gdb_tdesc_layout(target);
+
+	for (cache = gdb_tdesc_cache; cache; cache = cache->next)
+		if (cache->target == target)
+			break;
+
+	if (!cache) {
+		cache = calloc(1, sizeof(*cache));
+		if (!cache) {
+			LOG_ERROR("Unable to allocate memory");
 			return ERROR_FAIL;
 		}
+		cache->target = target;
+		cache->next = gdb_tdesc_cache;
+		gdb_tdesc_cache = cache;
+	}
+
+	if (!cache->tdesc || cache->layout != layout) {
+		char *xml;
+		int retval = gdb_generate_target_description(target, &xml);
+		if (retval != ERROR_OK)
+			return retval;
 
-		tdesc_length = strlen(tdesc);
+		free(cache->tdesc);
+		cache->tdesc = xml;
+		cache->tdesc_length = strlen(xml);
+		cache->layout = layout;
 	}
 
+	*tdesc = cache->tdesc;
+	*tdesc_length = cache->tdesc_length;
+	return ERROR_OK;
+}
+
+static int gdb_get_target_description_chunk(struct target *target,
+		char **chunk, int32_t offset, uint32_t length)
+{
+	const char *tdesc;
+	uint32_t tdesc_length;
+
+	int retval = gdb_get_cached_target_description(target, &tdesc, &tdesc_length);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Unable to Generate Target Description");
+		return ERROR_FAIL;
+	}
+
+	if (offset < 0 || (uint32_t)offset > tdesc_length)
+		offset = tdesc_length;
+
 	char transfer_type;
 
 	if (length < (tdesc_length - offset))
@@ -2585,21 +3418,13 @@ static int gdb_get_target_description_chunk(struct target *target, struct target
 
 	(*chunk)[0] = transfer_type;
 	if (transfer_type == 'm') {
-		strncpy((*chunk) + 1, tdesc + offset, length);
+		memcpy((*chunk) + 1, tdesc + offset, length);
 		(*chunk)[1 + length] = '\0';
 	} else {
-		strncpy((*chunk) + 1, tdesc + offset, tdesc_length - offset);
+		memcpy((*chunk) + 1, tdesc + offset, tdesc_length - offset);
 		(*chunk)[1 + (tdesc_length - offset)] = '\0';
-
-		/* After gdb-server sends out last chunk, invalidate tdesc. */
-		free(tdesc);
-		tdesc = NULL;
-		tdesc_length = 0;
 	}
 
-	target_desc->tdesc = tdesc;
-	target_desc->tdesc_length = tdesc_length;
-
 	return ERROR_OK;
 }
 
@@ -2704,15 +3529,27 @@ static int gdb_generate_thread_list(struct target *target, char **thread_list_ou
 	return retval;
 }
 
-static int gdb_get_thread_list_chunk(struct target *target, char **thread_list,
-		char **chunk, int32_t offset, uint32_t length)
+static int gdb_get_thread_list_chunk(struct target *target,
+		struct gdb_connection *gdb_con, char **chunk, int32_t offset, uint32_t length)
 {
+	char **thread_list = &gdb_con->thread_list;
+
+	/* a transfer starts at offset 0, the cached XML is reused unless the
+	 * RTOS has rebuilt its thread details since it was generated */
+	if (*thread_list && offset == 0 && (!target->rtos ||
+			target->rtos->thread_list_generation != gdb_con->thread_list_generation)) {
+		free(*thread_list);
+		*thread_list = NULL;
+	}
+
 	if (!*thread_list) {
 		int retval = gdb_generate_thread_list(target, thread_list);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("Unable to Generate Thread List");
 			return ERROR_FAIL;
 		}
+		if (target->rtos)
+			gdb_con->thread_list_generation = target->rtos->thread_list_generation;
 	}
 
 	size_t thread_list_length = strlen(*thread_list);
@@ -2738,12 +3575,6 @@ static int gdb_get_thread_list_chunk(struct target *target, char **thread_list,
 	strncpy((*chunk) + 1, (*thread_list) + offset, length);
 	(*chunk)[1 + length] = '\0';
 
-	/* After gdb-server sends out last chunk, invalidate thread list. */
-	if (transfer_type == 'l') {
-		free(*thread_list);
-		*thread_list = NULL;
-	}
-
 	return ERROR_OK;
 }
 
@@ -2850,7 +3681,7 @@ static int gdb_query_packet(struct connection *connection,
 			len = strtoul(separator + 1, NULL, 16);
 
 			gdb_connection->output_flag = GDB_OUTPUT_NOTIF;
-			retval = target_checksum_memory(target, addr, len, &checksum);
+			retval = gdb_checksum_memory(connection, target, addr, len, &checksum);
 			gdb_connection->output_flag = GDB_OUTPUT_NO;
 
 			if (retval == ERROR_OK) {
@@ -2891,8 +3722,8 @@ static int gdb_query_packet(struct connection *connection,
 			&buffer,
 			&pos,
 			&size,
-			"PacketSize=%x;qXfer:memory-map:read%c;qXfer:features:read%c;qXfer:threads:read+;QStartNoAckMode+;vContSupported+",
-			GDB_BUFFER_SIZE,
+			"PacketSize=%x;qXfer:memory-map:read%c;qXfer:features:read%c;qXfer:threads:read+;QStartNoAckMode+;vContSupported+;binary-upload+;ConditionalBreakpoints+",
+			gdb_connection->buffer_size,
 			(gdb_use_memory_map && (flash_get_bank_count() > 0)) ? '+' : '-',
 			gdb_target_desc_supported ? '+' : '-');
 
@@ -2928,8 +3759,7 @@ static int gdb_query_packet(struct connection *connection,
 		 * there are *more* chunks to transfer. 'l' for it is the *last*
 		 * chunk of target description.
 		 */
-		retval = gdb_get_target_description_chunk(target, &gdb_connection->target_desc,
-				&xml, offset, length);
+		retval = gdb_get_target_description_chunk(target, &xml, offset, length);
 		if (retval != ERROR_OK) {
 			gdb_error(connection, retval);
 			return retval;
@@ -2959,7 +3789,7 @@ static int gdb_query_packet(struct connection *connection,
 		 * there are *more* chunks to transfer. 'l' for it is the *last*
 		 * chunk of target description.
 		 */
-		retval = gdb_get_thread_list_chunk(target, &gdb_connection->thread_list,
+		retval = gdb_get_thread_list_chunk(target, gdb_connection,
 						   &xml, offset, length);
 		if (retval != ERROR_OK) {
 			gdb_error(connection, retval);
@@ -2970,6 +3800,17 @@ static int gdb_query_packet(struct connection *connection,
 
 		free(xml);
 		return ERROR_OK;
+	} else if (strncmp(packet, "QNonStop:", 9) == 0) {
+		/* The targets halt and resume the cores of a SMP group and the
+		 * threads of an RTOS together, while GDB in non-stop mode keeps
+		 * a run state per thread. Refuse non-stop until the targets can
+		 * run a single thread. */
+		if (packet[9] == '1') {
+			gdb_send_error(connection, EINVAL);
+			return ERROR_OK;
+		}
+		gdb_put_packet(connection, "OK", 2);
+		return ERROR_OK;
 	} else if (strncmp(packet, "QStartNoAckMode", 15) == 0) {
 		gdb_connection->noack_mode = 1;
 		gdb_put_packet(connection, "OK", 2);
@@ -3201,6 +4042,7 @@ static void gdb_restart_inferior(struct connection *connection, const char *pack
 
 	breakpoint_clear_target(target);
 	watchpoint_clear_target(target);
+	gdb_bp_conditions_remove(target, NULL);
 	command_run_linef(connection->cmd_ctx, "ocd_gdb_restart %s",
 			target_name(target));
 	/* set connection as attached after reset */
@@ -3251,6 +4093,105 @@ static bool gdb_handle_vrun_packet(struct connection *connection, const char *pa
 	return true;
 }
 
+/* Find the start of the flash sector holding addr */
+static bool gdb_vflash_sector_start(struct target *target, target_addr_t addr,
+		target_addr_t *start)
+{
+	struct flash_bank *bank;
+
+	if (get_flash_bank_by_addr(target, addr, false, &bank) != ERROR_OK || !bank
+			|| !bank->sectors)
+		return false;
+
+	for (unsigned int i = 0; i < bank->num_sectors; i++) {
+		target_addr_t sector = bank->base + bank->sectors[i].offset;
+		if (addr >= sector && addr - sector < bank->sectors[i].size) {
+			*start = sector;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Program the part of the vFlash image below limit and keep the rest. */
+static int gdb_vflash_program(struct connection *connection, target_addr_t limit)
+{
+	struct gdb_connection *gdb_connection = connection->priv;
+	struct target *target = get_target_from_connection(connection);
+	struct image *image = gdb_connection->vflash_image;
+	struct image done, rest;
+	int retval = ERROR_OK;
+
+	image_open(&done, "", "build");
+	image_open(&rest, "", "build");
+
+	for (unsigned int i = 0; i < image->num_sections && retval == ERROR_OK; i++) {
+		struct imagesection *section = &image->sections[i];
+		const uint8_t *data = section->private;
+		target_addr_t base = section->base_address;
+		uint32_t size = section->size;
+
+		if (base < limit) {
+			uint32_t n = MIN(size, limit - base);
+			retval = image_add_section(&done, base, n, section->flags, data);
+			base += n;
+			data += n;
+			size -= n;
+		}
+		if (size && retval == ERROR_OK)
+			retval = image_add_section(&rest, base, size, section->flags, data);
+	}
+
+	if (retval == ERROR_OK && done.num_sections) {
+		uint32_t written = 0;
+
+		if (!gdb_connection->vflash_started) {
+			target_call_event_callbacks(target, TARGET_EVENT_GDB_FLASH_WRITE_START);
+			gdb_connection->vflash_started = true;
+		}
+		retval = flash_write(target, &done, &written, false);
+		gdb_connection->vflash_written += written;
+	}
+
+	image_close(&done);
+	image_close(image);
+	*image = rest;
+
+	return retval;
+}
+
+/* GDB sends vFlashWrite in ascending address order, so every flash sector
+ * below the one holding the last byte received is complete and, once
+ * enough of them are buffered, can be programmed. */
+static void gdb_vflash_stream(struct connection *connection)
+{
+	struct gdb_connection *gdb_connection = connection->priv;
+	struct target *target = get_target_from_connection(connection);
+	struct image *image = gdb_connection->vflash_image;
+	struct imagesection *last = &image->sections[image->num_sections - 1];
+	target_addr_t limit;
+
+	if (!gdb_vflash_sector_start(target, last->base_address + last->size - 1, &limit))
+		return;
+
+	uint64_t complete = 0;
+	for (unsigned int i = 0; i < image->num_sections; i++) {
+		struct imagesection *section = &image->sections[i];
+		if (section->base_address < limit)
+			complete += MIN(section->size, limit - section->base_address);
+	}
+
+	if (complete < GDB_VFLASH_STREAM_CHUNK)
+		return;
+
+	int retval = gdb_vflash_program(connection, limit);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("flash programming of streamed vFlashWrite failed");
+		gdb_connection->vflash_error = retval;
+	}
+}
+
 static int gdb_v_packet(struct connection *connection,
 		char const *packet, int packet_size)
 {
@@ -3363,6 +4304,13 @@ static int gdb_v_packet(struct connection *connection,
 		}
 		length = packet_size - (parse - packet);
 
+		/* after a streaming failure the data is dropped, vFlashDone
+		 * reports the error */
+		if (gdb_connection->vflash_error != ERROR_OK) {
+			gdb_put_packet(connection, "OK", 2);
+			return ERROR_OK;
+		}
+
 		/* create a new image if there isn't already one */
 		if (!gdb_connection->vflash_image) {
 			gdb_connection->vflash_image = malloc(sizeof(struct image));
@@ -3375,8 +4323,13 @@ static int gdb_v_packet(struct connection *connection,
 		if (retval != ERROR_OK)
 			return retval;
 
+		/* reply first, so that GDB sends the next packet while the
+		 * completed sectors are programmed */
 		gdb_put_packet(connection, "OK", 2);
 
+		if (gdb_flash_program_streaming)
+			gdb_vflash_stream(connection);
+
 		return ERROR_OK;
 	}
 
@@ -3385,19 +4338,31 @@ static int gdb_v_packet(struct connection *connection,
 
 		/* GDB command 'flash-erase' does not send a vFlashWrite,
 		 * so nothing to write here. */
-		if (!gdb_connection->vflash_image) {
+		if (!gdb_connection->vflash_image && !gdb_connection->vflash_started
+				&& gdb_connection->vflash_error == ERROR_OK) {
 			gdb_put_packet(connection, "OK", 2);
 			return ERROR_OK;
 		}
 
-		/* process the flashing buffer. No need to erase as GDB
-		 * always issues a vFlashErase first. */
-		target_call_event_callbacks(target,
-				TARGET_EVENT_GDB_FLASH_WRITE_START);
-		result = flash_write(target, gdb_connection->vflash_image,
-			&written, false);
+		/* process the flashing buffer, or what is left of it when
+		 * streaming. No need to erase as GDB always issues a vFlashErase
+		 * first. */
+		if (!gdb_connection->vflash_started)
+			target_call_event_callbacks(target,
+					TARGET_EVENT_GDB_FLASH_WRITE_START);
+		result = gdb_connection->vflash_error;
+		written = gdb_connection->vflash_written;
+		if (result == ERROR_OK && gdb_connection->vflash_image) {
+			uint32_t left = 0;
+			result = flash_write(target, gdb_connection->vflash_image,
+				&left, false);
+			written += left;
+		}
 		target_call_event_callbacks(target,
 			TARGET_EVENT_GDB_FLASH_WRITE_END);
+		gdb_connection->vflash_started = false;
+		gdb_connection->vflash_error = ERROR_OK;
+		gdb_connection->vflash_written = 0;
 		if (result != ERROR_OK) {
 			if (result == ERROR_FLASH_DST_OUT_OF_BANK)
 				gdb_put_packet(connection, "E.memtype", 9);
@@ -3408,9 +4373,11 @@ static int gdb_v_packet(struct connection *connection,
 			gdb_put_packet(connection, "OK", 2);
 		}
 
-		image_close(gdb_connection->vflash_image);
-		free(gdb_connection->vflash_image);
-		gdb_connection->vflash_image = NULL;
+		if (gdb_connection->vflash_image) {
+			image_close(gdb_connection->vflash_image);
+			free(gdb_connection->vflash_image);
+			gdb_connection->vflash_image = NULL;
+		}
 
 		return ERROR_OK;
 	}
@@ -3503,20 +4470,45 @@ static void gdb_sig_halted(struct connection *connection)
 	gdb_put_packet(connection, sig_reply, 3);
 }
 
-static int gdb_input_inner(struct connection *connection)
+/* Length of the name of a packet in the latency profile: the command
+ * name of the general query and 'v' packets, e.g. "qXfer" or "vCont",
+ * else the packet letter, with the type of the breakpoint packets */
+static size_t gdb_packet_name_len(const char *packet, int packet_size)
 {
-	/* Do not allocate this on the stack */
-	static char gdb_packet_buffer[GDB_BUFFER_SIZE + 1]; /* Extra byte for null-termination */
+	if (packet[0] == 'q' || packet[0] == 'Q' || packet[0] == 'v') {
+		int len = 1;
+		while (len < packet_size && isalnum((unsigned char)packet[len]))
+			len++;
+		return len;
+	}
+
+	if ((packet[0] == 'Z' || packet[0] == 'z') && packet_size > 1)
+		return 2;
+
+	return 1;
+}
 
+static int gdb_input_inner(struct connection *connection)
+{
 	struct target *target;
+	struct gdb_connection *gdb_con = connection->priv;
+	char *gdb_packet_buffer = gdb_con->packet_buffer;
 	char const *packet = gdb_packet_buffer;
 	int packet_size;
 	int retval;
-	struct gdb_connection *gdb_con = connection->priv;
 	static bool warn_use_ext;
 
 	target = get_target_from_connection(connection);
 
+	/* GDB waits for the reply of a sliced memory read before sending
+	 * anything but Ctrl-C, so finish it before looking at new input */
+	if (gdb_con->pending_read.active) {
+		gdb_con->output_flag = GDB_OUTPUT_NOTIF;
+		retval = gdb_read_memory_continue(connection);
+		gdb_con->output_flag = GDB_OUTPUT_NO;
+		return retval;
+	}
+
 	/* drain input buffer. If one of the packets fail, then an error
 	 * packet is replied, if applicable.
 	 *
@@ -3529,7 +4521,7 @@ static int gdb_input_inner(struct connection *connection)
 	 * drain the rest of the buffer.
 	 */
 	do {
-		packet_size = GDB_BUFFER_SIZE;
+		packet_size = gdb_con->buffer_size;
 		retval = gdb_get_packet(connection, gdb_packet_buffer, &packet_size);
 		if (retval != ERROR_OK)
 			return retval;
@@ -3540,6 +4532,11 @@ static int gdb_input_inner(struct connection *connection)
 		if (packet_size > 0) {
 
 			gdb_log_incoming_packet(connection, gdb_packet_buffer);
+			gdb_con->packet_start_us = timeval_us();
+			uint32_t packet_id = (uint8_t)packet[0] | (packet_size > 1 ? (uint8_t)packet[1] << 8 : 0);
+			event_log_begin(EVENT_LOG_GDB_PACKET, packet_id);
+			perf_begin(&gdb_con->packet_perf, PERF_GDB_PACKET, packet,
+				gdb_packet_name_len(packet, packet_size));
 
 			retval = ERROR_OK;
 			switch (packet[0]) {
@@ -3573,6 +4570,11 @@ static int gdb_input_inner(struct connection *connection)
 					retval = gdb_read_memory_packet(connection, packet, packet_size);
 					gdb_con->output_flag = GDB_OUTPUT_NO;
 					break;
+				case 'x':
+					gdb_con->output_flag = GDB_OUTPUT_NOTIF;
+					retval = gdb_read_memory_binary_packet(connection, packet, packet_size);
+					gdb_con->output_flag = GDB_OUTPUT_NO;
+					break;
 				case 'M':
 					gdb_con->output_flag = GDB_OUTPUT_NOTIF;
 					retval = gdb_write_memory_packet(connection, packet, packet_size);
@@ -3723,9 +4725,19 @@ static int gdb_input_inner(struct connection *connection)
 					break;
 			}
 
+			event_log_end(EVENT_LOG_GDB_PACKET, retval);
+
+			/* a sliced read is accounted when the reply is sent */
+			if (!gdb_con->pending_read.active)
+				perf_end(&gdb_con->packet_perf, retval);
+
 			/* if a packet handler returned an error, exit input loop */
 			if (retval != ERROR_OK)
 				return retval;
+
+			/* a sliced read records its time when the reply is sent */
+			if (!gdb_con->pending_read.active)
+				gdb_stats_update(gdb_con, gdb_con->packet_start_us);
 		}
 
 		if (gdb_con->ctrl_c) {
@@ -3745,7 +4757,10 @@ static int gdb_input_inner(struct connection *connection)
 			}
 		}
 
-	} while (gdb_con->buf_cnt > 0);
+		/* with several GDB connections, handle one packet per turn;
+		 * input_pending brings us back for the rest */
+	} while (gdb_con->buf_cnt > 0 && !gdb_con->pending_read.active
+			&& gdb_actual_connections <= 1);
 
 	return ERROR_OK;
 }
@@ -3826,6 +4841,7 @@ static const struct service_driver gdb_service_driver = {
 	.input_handler = gdb_input,
 	.connection_closed_handler = gdb_connection_closed,
 	.keep_client_alive_handler = gdb_keep_client_alive,
+	.flush_output_handler = NULL,
 };
 
 static int gdb_target_start(struct target *target, const char *port)
@@ -3947,6 +4963,37 @@ COMMAND_HANDLER(handle_gdb_sync_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_gdb_stats_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	bool reset = false;
+	if (CMD_ARGC == 1) {
+		if (strcmp(CMD_ARGV[0], "reset") != 0)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		reset = true;
+	}
+
+	for (struct gdb_connection *c = gdb_connections; c; c = c->next) {
+		struct target *target = get_target_from_connection(c->connection);
+		struct gdb_connection_stats *stats = &c->stats;
+
+		if (reset) {
+			memset(stats, 0, sizeof(*stats));
+			continue;
+		}
+
+		command_print(CMD, "connection %u, target %s: %" PRIu64 " packets, "
+				"average %" PRIu64 " us, max %" PRIu64 " us",
+				c->unique_index, target_name(target), stats->packets,
+				stats->packets ? stats->total_us / stats->packets : 0,
+				stats->max_us);
+	}
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_gdb_port_command)
 {
 	int retval = CALL_COMMAND_HANDLER(server_pipe_command, &gdb_port);
@@ -3966,6 +5013,47 @@ COMMAND_HANDLER(handle_gdb_memory_map_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_gdb_memory_cache_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_ENABLE(CMD_ARGV[0], gdb_use_memory_cache);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_gdb_memory_cache_ram_command)
+{
+	if (CMD_ARGC == 0) {
+		for (struct gdb_mem_cache_ram *r = gdb_memory_cache_ram; r; r = r->next)
+			command_print(CMD, TARGET_ADDR_FMT " " TARGET_ADDR_FMT, r->address, r->size);
+		return ERROR_OK;
+	}
+
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	target_addr_t address, size;
+	COMMAND_PARSE_ADDRESS(CMD_ARGV[0], address);
+	COMMAND_PARSE_ADDRESS(CMD_ARGV[1], size);
+	if (!size || address + size - 1 < address) {
+		command_print(CMD, "invalid memory range");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	struct gdb_mem_cache_ram *r = malloc(sizeof(*r));
+	if (!r) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	r->address = address;
+	r->size = size;
+	r->next = gdb_memory_cache_ram;
+	gdb_memory_cache_ram = r;
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_gdb_flash_program_command)
 {
 	if (CMD_ARGC != 1)
@@ -3975,6 +5063,15 @@ COMMAND_HANDLER(handle_gdb_flash_program_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_gdb_flash_program_streaming_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_ENABLE(CMD_ARGV[0], gdb_flash_program_streaming);
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_gdb_report_data_abort_command)
 {
 	if (CMD_ARGC != 1)
@@ -3984,6 +5081,26 @@ COMMAND_HANDLER(handle_gdb_report_data_abort_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_gdb_max_packet_size_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		unsigned int size;
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], size);
+		if (size < GDB_BUFFER_SIZE_MIN || size > GDB_BUFFER_SIZE_MAX) {
+			command_print(CMD, "packet size must be between %u and %u bytes",
+				GDB_BUFFER_SIZE_MIN, GDB_BUFFER_SIZE_MAX);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		gdb_buffer_size = size;
+	}
+
+	command_print(CMD, "%u", gdb_buffer_size);
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_gdb_report_register_access_error)
 {
 	if (CMD_ARGC != 1)
@@ -4079,6 +5196,14 @@ static const struct command_registration gdb_subcommand_handlers[] = {
 			"target state",
 		.usage = ""
 	},
+	{
+		.name = "stats",
+		.handler = handle_gdb_stats_command,
+		.mode = COMMAND_EXEC,
+		.help = "Display the packet processing time of each GDB "
+			"connection, or reset the statistics",
+		.usage = "['reset']",
+	},
 	{
 		.name = "port",
 		.handler = handle_gdb_port_command,
@@ -4099,6 +5224,21 @@ static const struct command_registration gdb_subcommand_handlers[] = {
 		.help = "enable or disable memory map",
 		.usage = "('enable'|'disable')"
 	},
+	{
+		.name = "memory_cache",
+		.handler = handle_gdb_memory_cache_command,
+		.mode = COMMAND_ANY,
+		.help = "enable or disable caching memory read by gdb",
+		.usage = "('enable'|'disable')"
+	},
+	{
+		.name = "memory_cache_ram",
+		.handler = handle_gdb_memory_cache_ram_command,
+		.mode = COMMAND_ANY,
+		.help = "add a RAM region that may be cached while the target "
+			"is halted, or list the regions",
+		.usage = "[address size]"
+	},
 	{
 		.name = "flash_program",
 		.handler = handle_gdb_flash_program_command,
@@ -4106,6 +5246,14 @@ static const struct command_registration gdb_subcommand_handlers[] = {
 		.help = "enable or disable flash program",
 		.usage = "('enable'|'disable')"
 	},
+	{
+		.name = "flash_program_streaming",
+		.handler = handle_gdb_flash_program_streaming_command,
+		.mode = COMMAND_ANY,
+		.help = "enable or disable programming flash while gdb is still "
+			"sending the image",
+		.usage = "('enable'|'disable')"
+	},
 	{
 		.name = "report_data_abort",
 		.handler = handle_gdb_report_data_abort_command,
@@ -4113,6 +5261,14 @@ static const struct command_registration gdb_subcommand_handlers[] = {
 		.help = "enable or disable reporting data aborts",
 		.usage = "('enable'|'disable')"
 	},
+	{
+		.name = "max_packet_size",
+		.handler = handle_gdb_max_packet_size_command,
+		.mode = COMMAND_ANY,
+		.help = "Display or set the maximum packet size advertised to "
+			"GDB. Only affects new connections.",
+		.usage = "[size]"
+	},
 	{
 		.name = "report_register_access_error",
 		.handler = handle_gdb_report_register_access_error,
@@ -4167,6 +5323,21 @@ void gdb_service_free(void)
 {
 	free(gdb_port);
 	free(gdb_port_next);
+
+	while (gdb_tdesc_cache) {
+		struct gdb_tdesc_cache *next = gdb_tdesc_cache->next;
+		free(gdb_tdesc_cache->tdesc);
+		free(gdb_tdesc_cache);
+		gdb_tdesc_cache = next;
+	}
+
+	while (gdb_memory_cache_ram) {
+		struct gdb_mem_cache_ram *next = gdb_memory_cache_ram->next;
+		free(gdb_memory_cache_ram);
+		gdb_memory_cache_ram = next;
+	}
+
+	gdb_bp_conditions_remove(NULL, NULL);
 }
 
 int gdb_get_actual_connections(void)
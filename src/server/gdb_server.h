@@ -23,6 +23,8 @@ struct reg;
 #include <server/server.h>
 
 #define GDB_BUFFER_SIZE 16384
+#define GDB_BUFFER_SIZE_MIN 1024
+#define GDB_BUFFER_SIZE_MAX (256 * 1024)
 
 int gdb_target_add_all(struct target *target);
 int gdb_register_commands(struct command_context *command_context);
@@ -745,6 +745,7 @@ static const struct service_driver ipdbg_service_driver = {
 	.input_handler = ipdbg_on_connection_input,
 	.connection_closed_handler = ipdbg_on_connection_closed,
 	.keep_client_alive_handler = NULL,
+	.flush_output_handler = NULL,
 };
 
 static struct ipdbg_hub *ipdbg_get_hub_by_name(const char *name)
@@ -9,7 +9,12 @@
 #endif
 
 #include <stdint.h>
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+#include <helper/nvp.h>
 #include <rtt/rtt.h>
+#include <target/target.h>
 
 #include "server.h"
 #include "rtt_server.h"
@@ -28,46 +33,215 @@ struct rtt_service {
 	char *hello_message;
 };
 
-static int read_callback(unsigned int channel, const uint8_t *buffer,
-		size_t length, void *user_data)
-{
-	int ret;
-	struct connection *connection;
-	size_t offset;
+/* Interval in ms to retry sending queued data to a client that is slow */
+#define RTT_FLUSH_RETRY_INTERVAL	10
 
-	connection = (struct connection *)user_data;
-	offset = 0;
+/* What to do when the output buffer of a client is full */
+enum rtt_overflow_policy {
+	/* drop the oldest queued data */
+	RTT_OVERFLOW_DROP,
+	/* wait for the client, stalling RTT polling */
+	RTT_OVERFLOW_BLOCK,
+};
+
+static const struct nvp nvp_rtt_overflow[] = {
+	{ .name = "drop",  .value = RTT_OVERFLOW_DROP },
+	{ .name = "block", .value = RTT_OVERFLOW_BLOCK },
+	{ .name = NULL,    .value = -1 },
+};
+
+/* Output buffer settings for new connections */
+static size_t rtt_buffer_size = 64 * 1024;
+static enum rtt_overflow_policy rtt_overflow = RTT_OVERFLOW_DROP;
+
+/* Output ring of a connection. Data received from RTT is queued here and
+ * sent without blocking, the queued data in one call. */
+struct rtt_connection {
+	uint8_t *buffer;
+	size_t size;
+	/* position of the oldest queued byte */
+	size_t head;
+	size_t length;
+	enum rtt_overflow_policy overflow;
+	/* bytes dropped since the last warning */
+	size_t dropped;
+	/* whether the retry timer is registered */
+	bool retry;
+};
 
-	while (offset < length) {
-		ret = connection_write(connection, buffer + offset, length - offset);
+/* Send as much queued data as possible, or all of it if @a block is set. */
+static int rtt_connection_flush(struct connection *connection, bool block)
+{
+	struct rtt_connection *out = connection->priv;
+
+	while (out->length) {
+		size_t first = MIN(out->length, out->size - out->head);
+		int ret;
+
+#ifndef _WIN32
+		if (connection->service->type == CONNECTION_TCP) {
+			struct iovec iov[2] = {
+				{ .iov_base = out->buffer + out->head, .iov_len = first },
+				{ .iov_base = out->buffer, .iov_len = out->length - first },
+			};
+			struct msghdr msg = {
+				.msg_iov = iov,
+				.msg_iovlen = (out->length > first) ? 2 : 1,
+			};
+
+			ret = sendmsg(connection->fd_out, &msg, block ? 0 : MSG_DONTWAIT);
+
+			if (ret < 0 && !block && (errno == EAGAIN || errno == EWOULDBLOCK))
+				return ERROR_OK;
+		} else
+#endif
+		{
+			ret = connection_write(connection, out->buffer + out->head, first);
+		}
 
 		if (ret < 0) {
 			LOG_ERROR("Failed to write data to socket.");
 			return ERROR_FAIL;
 		}
 
-		offset += ret;
+		out->head = (out->head + ret) % out->size;
+		out->length -= ret;
+	}
+
+	out->head = 0;
+
+	return ERROR_OK;
+}
+
+static int rtt_flush_callback(void *priv)
+{
+	struct connection *connection = priv;
+	struct rtt_connection *out = connection->priv;
+	int ret;
+
+	ret = rtt_connection_flush(connection, false);
+
+	if (ret != ERROR_OK || !out->length) {
+		target_unregister_timer_callback(&rtt_flush_callback, connection);
+		out->retry = false;
+	}
+
+	return ret;
+}
+
+static int rtt_connection_write(struct connection *connection,
+		const uint8_t *buffer, size_t length)
+{
+	struct rtt_connection *out = connection->priv;
+	int ret;
+
+	if (length > out->size - out->length) {
+		if (out->overflow == RTT_OVERFLOW_BLOCK) {
+			ret = rtt_connection_flush(connection, true);
+
+			if (ret != ERROR_OK)
+				return ret;
+
+			/* what does not fit into the empty buffer is sent directly */
+			while (length > out->size) {
+				ret = connection_write(connection, buffer, length - out->size);
+
+				if (ret < 0) {
+					LOG_ERROR("Failed to write data to socket.");
+					return ERROR_FAIL;
+				}
+
+				buffer += ret;
+				length -= ret;
+			}
+		} else {
+			/* make room by dropping the oldest data */
+			if (length >= out->size) {
+				out->dropped += out->length + length - out->size;
+				buffer += length - out->size;
+				length = out->size;
+				out->head = 0;
+				out->length = 0;
+			} else {
+				size_t drop = length - (out->size - out->length);
+
+				out->dropped += drop;
+				out->head = (out->head + drop) % out->size;
+				out->length -= drop;
+			}
+		}
+	}
+
+	size_t tail = (out->head + out->length) % out->size;
+	size_t first = MIN(length, out->size - tail);
+
+	memcpy(out->buffer + tail, buffer, first);
+	memcpy(out->buffer, buffer + first, length - first);
+	out->length += length;
+
+	ret = rtt_connection_flush(connection, false);
+
+	if (ret != ERROR_OK)
+		return ret;
+
+	if (out->dropped && !out->length) {
+		LOG_WARNING("rtt: Client too slow, dropped %zu bytes", out->dropped);
+		out->dropped = 0;
+	}
+
+	if (out->length && !out->retry) {
+		target_register_timer_callback(&rtt_flush_callback,
+			RTT_FLUSH_RETRY_INTERVAL, TARGET_TIMER_TYPE_PERIODIC, connection);
+		out->retry = true;
 	}
 
 	return ERROR_OK;
 }
 
+static int read_callback(unsigned int channel, const uint8_t *buffer,
+		size_t length, void *user_data)
+{
+	return rtt_connection_write(user_data, buffer, length);
+}
+
 static int rtt_new_connection(struct connection *connection)
 {
 	int ret;
 	struct rtt_service *service;
+	struct rtt_connection *out;
 
 	service = connection->service->priv;
 
 	LOG_DEBUG("rtt: New connection for channel %u", service->channel);
 
+	out = calloc(1, sizeof(*out));
+
+	if (!out)
+		return ERROR_FAIL;
+
+	out->size = rtt_buffer_size;
+	out->overflow = rtt_overflow;
+	out->buffer = malloc(out->size);
+
+	if (!out->buffer) {
+		free(out);
+		return ERROR_FAIL;
+	}
+
+	connection->priv = out;
+
 	ret = rtt_register_sink(service->channel, &read_callback, connection);
 
-	if (ret != ERROR_OK)
+	if (ret != ERROR_OK) {
+		free(out->buffer);
+		free(out);
+		connection->priv = NULL;
 		return ret;
+	}
 
 	if (service->hello_message)
-		connection_write(connection, service->hello_message, strlen(service->hello_message));
+		rtt_connection_write(connection, (const uint8_t *)service->hello_message,
+			strlen(service->hello_message));
 
 	return ERROR_OK;
 }
@@ -75,10 +249,18 @@ static int rtt_new_connection(struct connection *connection)
 static int rtt_connection_closed(struct connection *connection)
 {
 	struct rtt_service *service;
+	struct rtt_connection *out = connection->priv;
 
 	service = (struct rtt_service *)connection->service->priv;
 	rtt_unregister_sink(service->channel, &read_callback, connection);
 
+	if (out->retry)
+		target_unregister_timer_callback(&rtt_flush_callback, connection);
+
+	free(out->buffer);
+	free(out);
+	connection->priv = NULL;
+
 	LOG_DEBUG("rtt: Connection for channel %u closed", service->channel);
 
 	return ERROR_OK;
@@ -114,6 +296,7 @@ static const struct service_driver rtt_service_driver = {
 	.input_handler = rtt_input,
 	.connection_closed_handler = rtt_connection_closed,
 	.keep_client_alive_handler = NULL,
+	.flush_output_handler = NULL,
 };
 
 COMMAND_HANDLER(handle_rtt_start_command)
@@ -155,6 +338,39 @@ COMMAND_HANDLER(handle_rtt_start_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_rtt_buffer_command)
+{
+	if (CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC >= 1) {
+		uint32_t size;
+
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], size);
+
+		if (!size) {
+			command_print(CMD, "buffer size must not be zero");
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+
+		rtt_buffer_size = size;
+	}
+
+	if (CMD_ARGC == 2) {
+		const struct nvp *n = nvp_name2value(nvp_rtt_overflow, CMD_ARGV[1]);
+
+		if (!n->name)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+
+		rtt_overflow = n->value;
+	}
+
+	command_print(CMD, "%zu %s", rtt_buffer_size,
+		nvp_value2name(nvp_rtt_overflow, rtt_overflow)->name);
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_rtt_stop_command)
 {
 	if (CMD_ARGC != 1)
@@ -180,6 +396,14 @@ static const struct command_registration rtt_server_subcommand_handlers[] = {
 		.help = "Stop a RTT server",
 		.usage = "<port>"
 	},
+	{
+		.name = "buffer",
+		.handler = handle_rtt_buffer_command,
+		.mode = COMMAND_ANY,
+		.help = "Show or set the output buffer size of new connections "
+			"and whether to drop old data or block when it is full",
+		.usage = "[size ['drop'|'block']]"
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
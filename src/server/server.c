@@ -16,6 +16,7 @@
 #endif
 
 #include "server.h"
+#include <helper/event_log.h>
 #include <helper/time_support.h>
 #include <target/target.h>
 #include <target/target_request.h>
@@ -214,6 +215,7 @@ int add_service(const struct service_driver *driver, const char *port,
 	c->input = driver->input_handler;
 	c->connection_closed = driver->connection_closed_handler;
 	c->keep_client_alive = driver->keep_client_alive_handler;
+	c->flush_output = driver->flush_output_handler;
 	c->priv = priv;
 	c->next = NULL;
 	long portnumber;
@@ -411,12 +413,23 @@ static int remove_services(void)
 	return ERROR_OK;
 }
 
+static void server_flush_output(void)
+{
+	for (struct service *s = services; s; s = s->next)
+		if (s->flush_output)
+			for (struct connection *c = s->connections; c; c = c->next)
+				s->flush_output(c);
+}
+
 void server_keep_clients_alive(void)
 {
 	for (struct service *s = services; s; s = s->next)
 		if (s->keep_client_alive)
 			for (struct connection *c = s->connections; c; c = c->next)
 				s->keep_client_alive(c);
+
+	/* show the progress of long running commands */
+	server_flush_output();
 }
 
 int server_loop(struct command_context *command_context)
@@ -440,6 +453,9 @@ int server_loop(struct command_context *command_context)
 #endif
 
 	while (shutdown_openocd == CONTINUE_MAIN_LOOP) {
+		/* set when a connection has buffered input or unfinished work */
+		bool input_pending = false;
+
 		/* monitor sockets for activity */
 		fd_max = 0;
 		FD_ZERO(&read_fds);
@@ -462,13 +478,15 @@ int server_loop(struct command_context *command_context)
 					FD_SET(c->fd, &read_fds);
 					if (c->fd > fd_max)
 						fd_max = c->fd;
+					if (c->input_pending)
+						input_pending = true;
 				}
 			}
 		}
 
 		struct timeval tv;
 		tv.tv_sec = 0;
-		if (poll_ok) {
+		if (poll_ok || input_pending) {
 			/* we're just polling this iteration, this is faster on embedded
 			 * hosts */
 			tv.tv_usec = 0;
@@ -481,6 +499,9 @@ int server_loop(struct command_context *command_context)
 			else if (timeout_ms > polling_period)
 				timeout_ms = polling_period;
 			tv.tv_usec = timeout_ms * 1000;
+			/* write out the buffered logs before going idle */
+			log_flush();
+			event_log_flush();
 			/* Only while we're sleeping we'll let others run */
 			retval = socket_select(fd_max + 1, &read_fds, NULL, NULL, &tv);
 		}
@@ -525,6 +546,13 @@ int server_loop(struct command_context *command_context)
 		} else {
 			/* There was something to do, next time we'll just poll */
 			poll_ok = true;
+
+			/* A connection that always has input pending must not
+			 * starve the timers, e.g. the target polling */
+			if (timeval_ms() >= next_event) {
+				target_call_timer_callbacks();
+				next_event = target_timer_next_event();
+			}
 		}
 
 		/* This is a simple back-off algorithm where we immediately
@@ -583,6 +611,9 @@ int server_loop(struct command_context *command_context)
 			}
 		}
 
+		/* send the output of this iteration at once */
+		server_flush_output();
+
 #ifdef _WIN32
 		MSG msg;
 		while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
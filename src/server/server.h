@@ -62,6 +62,11 @@ struct service_driver {
 	int (*connection_closed_handler)(struct connection *connection);
 	/** called periodically to send keep-alive messages on the connection */
 	void (*keep_client_alive_handler)(struct connection *connection);
+	/**
+	 * optional, called once per server loop iteration and during long
+	 * running commands to send the output buffered for the connection
+	 */
+	void (*flush_output_handler)(struct connection *connection);
 };
 
 struct service {
@@ -78,6 +83,7 @@ struct service {
 	int (*input)(struct connection *connection);
 	int (*connection_closed)(struct connection *connection);
 	void (*keep_client_alive)(struct connection *connection);
+	void (*flush_output)(struct connection *connection);
 	void *priv;
 	struct service *next;
 };
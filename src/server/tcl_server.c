@@ -11,12 +11,30 @@
 
 #include "tcl_server.h"
 #include <target/target.h>
+#include <target/register.h>
 #include <helper/binarybuffer.h>
+#include <helper/time_support.h>
 
 #define TCL_SERVER_VERSION		"TCL Server 0.1"
 #define TCL_LINE_INITIAL		(4*1024)
 #define TCL_LINE_MAX			(4*1024*1024)
 
+/*
+ * Binary framing, enabled per connection with "tcl binary on".
+ * Request: type (u8), payload length (u32), payload.
+ * Reply: type (u8), status (i32), payload length (u32), payload.
+ * Integers are little-endian.
+ */
+#define TCL_FRAME_HEADER		5
+#define TCL_FRAME_REPLY_HEADER	9
+#define TCL_FRAME_COMMAND		'c'	/* Tcl command, reply is the result */
+#define TCL_FRAME_READ_MEMORY	'm'	/* address (u64), count (u32), reply is the data */
+#define TCL_FRAME_WRITE_MEMORY	'M'	/* address (u64), data */
+#define TCL_FRAME_GET_REGS		'g'	/* NUL terminated names, reply is size (u32) and value of each */
+#define TCL_FRAME_SET_REGS		'G'	/* NUL terminated name and value of each register */
+#define TCL_FRAME_NOTIFICATION	'n'	/* sent by the server, see tcl notifications */
+#define TCL_FRAME_TRACE			't'	/* sent by the server, raw trace data */
+
 struct tcl_connection {
 	int tc_linedrop;
 	int tc_lineoffset;
@@ -26,6 +44,19 @@ struct tcl_connection {
 	enum target_state tc_laststate;
 	bool tc_notify;
 	bool tc_trace;
+	bool tc_binary;
+	/* asynchronous output, see tcl_output_async() */
+	uint8_t *tc_outq;
+	size_t tc_outq_head;
+	size_t tc_outq_len;
+	size_t tc_outq_dropped;
+	/* trace data not sent yet */
+	uint8_t *tc_trace_buf;
+	size_t tc_trace_len;
+	/* last notification sent and identical ones merged since */
+	char tc_last_notification[256];
+	int64_t tc_last_notification_ms;
+	unsigned int tc_repeat_count;
 };
 
 static char *tcl_port;
@@ -35,6 +66,204 @@ static int tcl_new_connection(struct connection *connection);
 static int tcl_input(struct connection *connection);
 static int tcl_output(struct connection *connection, const void *buf, ssize_t len);
 static int tcl_closed(struct connection *connection);
+static int tcl_output_frame(struct connection *connection, uint8_t type, int status,
+		const void *data, size_t len);
+static int tcl_input_text(struct connection *connection, const unsigned char *in, ssize_t rlen);
+static int tcl_input_frames(struct connection *connection);
+
+/* queue size for notifications and trace data of a slow client */
+#define TCL_OUTPUT_QUEUE_SIZE	(1024 * 1024)
+/* trace data is sent in messages of up to this size ... */
+#define TCL_TRACE_COALESCE_SIZE	4096
+/* ... or at this interval in ms, which is also the window in which
+ * identical notifications are merged */
+#define TCL_NOTIFY_INTERVAL		20
+
+/*
+ * Send as much of the asynchronous output queue as possible, or all of
+ * it if @a block is set.
+ */
+static int tcl_output_flush(struct connection *connection, bool block)
+{
+	struct tcl_connection *tclc = connection->priv;
+
+	while (tclc->tc_outq_len) {
+		const uint8_t *data = tclc->tc_outq + tclc->tc_outq_head;
+		int ret;
+
+#ifndef _WIN32
+		if (connection->service->type == CONNECTION_TCP) {
+			ret = send(connection->fd_out, data, tclc->tc_outq_len, block ? 0 : MSG_DONTWAIT);
+
+			if (ret < 0 && !block && (errno == EAGAIN || errno == EWOULDBLOCK))
+				return ERROR_OK;
+		} else
+#endif
+		{
+			ret = connection_write(connection, data, tclc->tc_outq_len);
+		}
+
+		if (ret <= 0) {
+			LOG_ERROR("error during write: %s", strerror(errno));
+			tclc->tc_outerror = 1;
+			return ERROR_SERVER_REMOTE_CLOSED;
+		}
+
+		tclc->tc_outq_head += ret;
+		tclc->tc_outq_len -= ret;
+	}
+
+	tclc->tc_outq_head = 0;
+
+	return ERROR_OK;
+}
+
+/*
+ * Queue notification or trace output without blocking the server loop.
+ * Data that does not fit in the queue of a slow client is dropped.
+ */
+static void tcl_output_async(struct connection *connection, const void *data, size_t len)
+{
+	struct tcl_connection *tclc = connection->priv;
+
+	if (tclc->tc_outerror)
+		return;
+
+	if (!tclc->tc_outq) {
+		tclc->tc_outq = malloc(TCL_OUTPUT_QUEUE_SIZE);
+		if (!tclc->tc_outq) {
+			LOG_ERROR("Out of memory");
+			return;
+		}
+	}
+
+	if (len > TCL_OUTPUT_QUEUE_SIZE - tclc->tc_outq_len) {
+		if (!tclc->tc_outq_dropped)
+			LOG_WARNING("tcl: client is too slow, dropping notifications");
+		tclc->tc_outq_dropped += len;
+		return;
+	}
+
+	if (len > TCL_OUTPUT_QUEUE_SIZE - tclc->tc_outq_head - tclc->tc_outq_len) {
+		memmove(tclc->tc_outq, tclc->tc_outq + tclc->tc_outq_head, tclc->tc_outq_len);
+		tclc->tc_outq_head = 0;
+	}
+
+	memcpy(tclc->tc_outq + tclc->tc_outq_head + tclc->tc_outq_len, data, len);
+	tclc->tc_outq_len += len;
+	tclc->tc_outq_dropped = 0;
+
+	tcl_output_flush(connection, false);
+}
+
+static void tcl_output_async_message(struct connection *connection, uint8_t type,
+		const char *text, size_t len)
+{
+	struct tcl_connection *tclc = connection->priv;
+	size_t header_len = tclc->tc_binary ? TCL_FRAME_REPLY_HEADER : 0;
+
+	/* a single write, so that the queue never holds a partial message */
+	uint8_t *buf = malloc(header_len + len + 1);
+	if (!buf) {
+		LOG_ERROR("Out of memory");
+		return;
+	}
+
+	if (tclc->tc_binary) {
+		buf[0] = type;
+		h_u32_to_le(buf + 1, ERROR_OK);
+		h_u32_to_le(buf + 5, len);
+		memcpy(buf + header_len, text, len);
+	} else {
+		memcpy(buf, text, len);
+		buf[len++] = '\x1a';
+	}
+
+	tcl_output_async(connection, buf, header_len + len);
+	free(buf);
+}
+
+static void tcl_flush_trace(struct connection *connection)
+{
+	struct tcl_connection *tclc = connection->priv;
+	const char *header = "type target_trace data ";
+	const char *trailer = "\r\n";
+
+	if (!tclc->tc_trace_len)
+		return;
+
+	if (tclc->tc_binary) {
+		tcl_output_async_message(connection, TCL_FRAME_TRACE,
+			(const char *)tclc->tc_trace_buf, tclc->tc_trace_len);
+		tclc->tc_trace_len = 0;
+		return;
+	}
+
+	size_t hex_len = tclc->tc_trace_len * 2 + 1;
+	size_t max_len = hex_len + strlen(header) + strlen(trailer);
+	char *buf = malloc(max_len);
+	if (buf) {
+		size_t len = strlen(header);
+		memcpy(buf, header, len);
+		len += hexify(buf + len, tclc->tc_trace_buf, tclc->tc_trace_len, hex_len);
+		memcpy(buf + len, trailer, strlen(trailer));
+		len += strlen(trailer);
+		tcl_output_async_message(connection, TCL_FRAME_TRACE, buf, len);
+		free(buf);
+	}
+	tclc->tc_trace_len = 0;
+}
+
+/* report the notifications merged into the last one sent */
+static void tcl_flush_repeats(struct connection *connection)
+{
+	struct tcl_connection *tclc = connection->priv;
+	char buf[300];
+
+	if (!tclc->tc_repeat_count)
+		return;
+
+	/* the last notification without its "\r\n", plus the count */
+	int len = snprintf(buf, sizeof(buf), "%.*s count %u\r\n",
+		(int)strlen(tclc->tc_last_notification) - 2, tclc->tc_last_notification,
+		tclc->tc_repeat_count);
+	tclc->tc_repeat_count = 0;
+	tcl_output_async_message(connection, TCL_FRAME_NOTIFICATION, buf, MIN(len, (int)sizeof(buf) - 1));
+}
+
+/* send an asynchronous notification, @a text ends with "\r\n" */
+static void tcl_output_notification(struct connection *connection, const char *text)
+{
+	struct tcl_connection *tclc = connection->priv;
+	int64_t now = timeval_ms();
+
+	/* an identical notification shortly after is only counted */
+	if (!strcmp(text, tclc->tc_last_notification) &&
+			now - tclc->tc_last_notification_ms < TCL_NOTIFY_INTERVAL) {
+		tclc->tc_repeat_count++;
+		return;
+	}
+
+	/* keep the order with the trace data and repeats received before */
+	tcl_flush_trace(connection);
+	tcl_flush_repeats(connection);
+
+	snprintf(tclc->tc_last_notification, sizeof(tclc->tc_last_notification), "%s", text);
+	tclc->tc_last_notification_ms = now;
+
+	tcl_output_async_message(connection, TCL_FRAME_NOTIFICATION, text, strlen(text));
+}
+
+static int tcl_timer_callback(void *priv)
+{
+	struct connection *connection = priv;
+
+	tcl_flush_trace(connection);
+	tcl_flush_repeats(connection);
+	tcl_output_flush(connection, false);
+
+	return ERROR_OK;
+}
 
 static int tcl_target_callback_event_handler(struct target *target,
 		enum target_event event, void *priv)
@@ -46,15 +275,15 @@ static int tcl_target_callback_event_handler(struct target *target,
 	tclc = connection->priv;
 
 	if (tclc->tc_notify) {
-		snprintf(buf, sizeof(buf), "type target_event event %s\r\n\x1a", target_event_name(event));
-		tcl_output(connection, buf, strlen(buf));
+		snprintf(buf, sizeof(buf), "type target_event event %s\r\n", target_event_name(event));
+		tcl_output_notification(connection, buf);
 	}
 
 	if (tclc->tc_laststate != target->state) {
 		tclc->tc_laststate = target->state;
 		if (tclc->tc_notify) {
-			snprintf(buf, sizeof(buf), "type target_state state %s\r\n\x1a", target_state_name(target));
-			tcl_output(connection, buf, strlen(buf));
+			snprintf(buf, sizeof(buf), "type target_state state %s\r\n", target_state_name(target));
+			tcl_output_notification(connection, buf);
 		}
 	}
 
@@ -71,8 +300,8 @@ static int tcl_target_callback_reset_handler(struct target *target,
 	tclc = connection->priv;
 
 	if (tclc->tc_notify) {
-		snprintf(buf, sizeof(buf), "type target_reset mode %s\r\n\x1a", target_reset_mode_name(reset_mode));
-		tcl_output(connection, buf, strlen(buf));
+		snprintf(buf, sizeof(buf), "type target_reset mode %s\r\n", target_reset_mode_name(reset_mode));
+		tcl_output_notification(connection, buf);
 	}
 
 	return ERROR_OK;
@@ -83,22 +312,31 @@ static int tcl_target_callback_trace_handler(struct target *target,
 {
 	struct connection *connection = priv;
 	struct tcl_connection *tclc;
-	char *header = "type target_trace data ";
-	char *trailer = "\r\n\x1a";
-	size_t hex_len = len * 2 + 1;
-	size_t max_len = hex_len + strlen(header) + strlen(trailer);
-	char *buf, *hex;
 
 	tclc = connection->priv;
 
-	if (tclc->tc_trace) {
-		hex = malloc(hex_len);
-		buf = malloc(max_len);
-		hexify(hex, data, len, hex_len);
-		snprintf(buf, max_len, "%s%s%s", header, hex, trailer);
-		tcl_output(connection, buf, strlen(buf));
-		free(hex);
-		free(buf);
+	if (!tclc->tc_trace)
+		return ERROR_OK;
+
+	if (!tclc->tc_trace_buf) {
+		tclc->tc_trace_buf = malloc(TCL_TRACE_COALESCE_SIZE);
+		if (!tclc->tc_trace_buf) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+	}
+
+	/* collect the data, the timer callback sends what is left */
+	while (len) {
+		size_t chunk = MIN(len, TCL_TRACE_COALESCE_SIZE - tclc->tc_trace_len);
+
+		memcpy(tclc->tc_trace_buf + tclc->tc_trace_len, data, chunk);
+		tclc->tc_trace_len += chunk;
+		data += chunk;
+		len -= chunk;
+
+		if (tclc->tc_trace_len == TCL_TRACE_COALESCE_SIZE)
+			tcl_flush_trace(connection);
 	}
 
 	return ERROR_OK;
@@ -118,6 +356,10 @@ int tcl_output(struct connection *connection, const void *data, ssize_t len)
 	if (tclc->tc_outerror)
 		return ERROR_SERVER_REMOTE_CLOSED;
 
+	/* queued notifications go first */
+	if (tcl_output_flush(connection, true) != ERROR_OK)
+		return ERROR_SERVER_REMOTE_CLOSED;
+
 	wlen = connection_write(connection, data, len);
 
 	if (wlen == len)
@@ -128,6 +370,21 @@ int tcl_output(struct connection *connection, const void *data, ssize_t len)
 	return ERROR_SERVER_REMOTE_CLOSED;
 }
 
+static int tcl_output_frame(struct connection *connection, uint8_t type, int status,
+		const void *data, size_t len)
+{
+	uint8_t header[TCL_FRAME_REPLY_HEADER];
+
+	header[0] = type;
+	h_u32_to_le(header + 1, status);
+	h_u32_to_le(header + 5, len);
+
+	int retval = tcl_output(connection, header, sizeof(header));
+	if (retval == ERROR_OK && len)
+		retval = tcl_output(connection, data, len);
+	return retval;
+}
+
 /* connections */
 static int tcl_new_connection(struct connection *connection)
 {
@@ -156,34 +413,23 @@ static int tcl_new_connection(struct connection *connection)
 	target_register_event_callback(tcl_target_callback_event_handler, connection);
 	target_register_reset_callback(tcl_target_callback_reset_handler, connection);
 	target_register_trace_callback(tcl_target_callback_trace_handler, connection);
+	target_register_timer_callback(tcl_timer_callback, TCL_NOTIFY_INTERVAL,
+		TARGET_TIMER_TYPE_PERIODIC, connection);
 
 	return ERROR_OK;
 }
 
-static int tcl_input(struct connection *connection)
+static int tcl_input_text(struct connection *connection, const unsigned char *in, ssize_t rlen)
 {
 	Jim_Interp *interp = (Jim_Interp *)connection->cmd_ctx->interp;
+	struct tcl_connection *tclc = connection->priv;
 	int retval;
 	int i;
-	ssize_t rlen;
 	const char *result;
 	int reslen;
-	struct tcl_connection *tclc;
-	unsigned char in[256];
 	char *tc_line_new;
 	int tc_line_size_new;
 
-	rlen = connection_read(connection, &in, sizeof(in));
-	if (rlen <= 0) {
-		if (rlen < 0)
-			LOG_ERROR("error during read: %s", strerror(errno));
-		return ERROR_SERVER_REMOTE_CLOSED;
-	}
-
-	tclc = connection->priv;
-	if (!tclc)
-		return ERROR_CONNECTION_REJECTED;
-
 	/* push as much data into the line as possible */
 	for (i = 0; i < rlen; i++) {
 		/* buffer the data */
@@ -241,11 +487,245 @@ static int tcl_input(struct connection *connection)
 
 		tclc->tc_lineoffset = 0;
 		tclc->tc_linedrop = 0;
+
+		/* "tcl binary on" was run, the rest of the input is framed */
+		if (tclc->tc_binary) {
+			memcpy(tclc->tc_line, in + i + 1, rlen - i - 1);
+			tclc->tc_lineoffset = rlen - i - 1;
+			return tcl_input_frames(connection);
+		}
+	}
+
+	return ERROR_OK;
+}
+
+/* make room for @a size bytes in the line buffer */
+static int tcl_line_reserve(struct tcl_connection *tclc, int size)
+{
+	if (size <= tclc->tc_line_size)
+		return ERROR_OK;
+
+	char *tc_line_new = realloc(tclc->tc_line, size);
+	if (!tc_line_new)
+		return ERROR_FAIL;
+
+	tclc->tc_line = tc_line_new;
+	tclc->tc_line_size = size;
+	return ERROR_OK;
+}
+
+static int tcl_frame_command(struct connection *connection, const uint8_t *payload, uint32_t len)
+{
+	Jim_Interp *interp = (Jim_Interp *)connection->cmd_ctx->interp;
+	const char *result;
+	int reslen;
+
+	char *line = strndup((const char *)payload, len);
+	if (!line)
+		return tcl_output_frame(connection, TCL_FRAME_COMMAND, ERROR_FAIL, NULL, 0);
+
+	int retval = command_run_line(connection->cmd_ctx, line);
+	free(line);
+
+	result = Jim_GetString(Jim_GetResult(interp), &reslen);
+	return tcl_output_frame(connection, TCL_FRAME_COMMAND, retval, result, reslen);
+}
+
+static int tcl_frame_memory(struct connection *connection, struct target *target,
+		uint8_t type, const uint8_t *payload, uint32_t len)
+{
+	int retval;
+
+	if (len < 8 || (type == TCL_FRAME_READ_MEMORY && len != 12))
+		return tcl_output_frame(connection, type, ERROR_COMMAND_SYNTAX_ERROR, NULL, 0);
+
+	target_addr_t address = le_to_h_u64(payload);
+
+	if (type == TCL_FRAME_WRITE_MEMORY) {
+		retval = target_write_buffer(target, address, len - 8, payload + 8);
+		return tcl_output_frame(connection, type, retval, NULL, 0);
+	}
+
+	uint32_t count = le_to_h_u32(payload + 8);
+	if (count > TCL_LINE_MAX)
+		return tcl_output_frame(connection, type, ERROR_COMMAND_ARGUMENT_OVERFLOW, NULL, 0);
+
+	uint8_t *buffer = malloc(count);
+	if (!buffer && count)
+		return tcl_output_frame(connection, type, ERROR_FAIL, NULL, 0);
+
+	/* the data goes from the target read straight to the socket */
+	retval = target_read_buffer(target, address, count, buffer);
+	if (retval != ERROR_OK)
+		count = 0;
+	retval = tcl_output_frame(connection, type, retval, buffer, count);
+	free(buffer);
+	return retval;
+}
+
+static int tcl_frame_registers(struct connection *connection, struct target *target,
+		uint8_t type, const uint8_t *payload, uint32_t len)
+{
+	uint8_t *reply = NULL;
+	size_t reply_len = 0;
+	uint32_t offset = 0;
+	int retval = ERROR_OK;
+
+	while (offset < len && retval == ERROR_OK) {
+		const char *name = (const char *)payload + offset;
+		size_t name_len = strnlen(name, len - offset);
+		if (name_len == len - offset) {
+			retval = ERROR_COMMAND_SYNTAX_ERROR;
+			break;
+		}
+		offset += name_len + 1;
+
+		struct reg *reg = register_get_by_name(target->reg_cache, name, false);
+		if (!reg || !reg->exist) {
+			LOG_ERROR("unknown register '%s'", name);
+			retval = ERROR_FAIL;
+			break;
+		}
+
+		size_t size = DIV_ROUND_UP(reg->size, 8);
+
+		if (type == TCL_FRAME_SET_REGS) {
+			if (len - offset < size) {
+				retval = ERROR_COMMAND_SYNTAX_ERROR;
+				break;
+			}
+			retval = reg->type->set(reg, (uint8_t *)payload + offset);
+			offset += size;
+			continue;
+		}
+
+		if (!reg->valid) {
+			retval = reg->type->get(reg);
+			if (retval != ERROR_OK)
+				break;
+		}
+
+		uint8_t *new_reply = realloc(reply, reply_len + 4 + size);
+		if (!new_reply) {
+			retval = ERROR_FAIL;
+			break;
+		}
+		reply = new_reply;
+		h_u32_to_le(reply + reply_len, reg->size);
+		memcpy(reply + reply_len + 4, reg->value, size);
+		reply_len += 4 + size;
+	}
+
+	if (retval != ERROR_OK)
+		reply_len = 0;
+	retval = tcl_output_frame(connection, type, retval, reply, reply_len);
+	free(reply);
+	return retval;
+}
+
+static int tcl_frame_execute(struct connection *connection, uint8_t type,
+		const uint8_t *payload, uint32_t len)
+{
+	if (type == TCL_FRAME_COMMAND)
+		return tcl_frame_command(connection, payload, len);
+
+	struct target *target = get_current_target_or_null(connection->cmd_ctx);
+	if (!target)
+		return tcl_output_frame(connection, type, ERROR_FAIL, NULL, 0);
+
+	switch (type) {
+	case TCL_FRAME_READ_MEMORY:
+	case TCL_FRAME_WRITE_MEMORY:
+		return tcl_frame_memory(connection, target, type, payload, len);
+	case TCL_FRAME_GET_REGS:
+	case TCL_FRAME_SET_REGS:
+		return tcl_frame_registers(connection, target, type, payload, len);
+	default:
+		return tcl_output_frame(connection, type, ERROR_COMMAND_NOTFOUND, NULL, 0);
+	}
+}
+
+/* run the complete frames in the line buffer */
+static int tcl_input_frames(struct connection *connection)
+{
+	struct tcl_connection *tclc = connection->priv;
+
+	while (tclc->tc_lineoffset >= TCL_FRAME_HEADER) {
+		uint8_t *frame = (uint8_t *)tclc->tc_line;
+		uint32_t len = le_to_h_u32(frame + 1);
+
+		if (len > TCL_LINE_MAX - TCL_FRAME_HEADER) {
+			/* the stream cannot be resynchronized */
+			LOG_ERROR("tcl: frame too long (%" PRIu32 " bytes)", len);
+			return ERROR_SERVER_REMOTE_CLOSED;
+		}
+
+		int frame_len = TCL_FRAME_HEADER + len;
+		if (tcl_line_reserve(tclc, frame_len) != ERROR_OK) {
+			LOG_ERROR("Out of memory");
+			return ERROR_SERVER_REMOTE_CLOSED;
+		}
+		if (tclc->tc_lineoffset < frame_len)
+			break;
+
+		frame = (uint8_t *)tclc->tc_line;
+		int retval = tcl_frame_execute(connection, frame[0], frame + TCL_FRAME_HEADER, len);
+		if (retval != ERROR_OK)
+			return retval;
+
+		tclc->tc_lineoffset -= frame_len;
+		memmove(tclc->tc_line, tclc->tc_line + frame_len, tclc->tc_lineoffset);
+
+		/* "tcl binary off" was run, back to text commands */
+		if (!tclc->tc_binary) {
+			int rest = tclc->tc_lineoffset;
+			unsigned char *in = malloc(rest + 1);
+			if (!in)
+				return ERROR_SERVER_REMOTE_CLOSED;
+			memcpy(in, tclc->tc_line, rest);
+			tclc->tc_lineoffset = 0;
+			retval = tcl_input_text(connection, in, rest);
+			free(in);
+			return retval;
+		}
 	}
 
 	return ERROR_OK;
 }
 
+static int tcl_input(struct connection *connection)
+{
+	ssize_t rlen;
+	struct tcl_connection *tclc;
+	unsigned char in[256];
+
+	tclc = connection->priv;
+	if (!tclc)
+		return ERROR_CONNECTION_REJECTED;
+
+	if (tclc->tc_binary) {
+		/* read straight into the frame buffer, tcl_input_frames()
+		 * grows it to hold the frame being received */
+		rlen = connection_read(connection, tclc->tc_line + tclc->tc_lineoffset,
+				tclc->tc_line_size - tclc->tc_lineoffset);
+	} else {
+		rlen = connection_read(connection, &in, sizeof(in));
+	}
+
+	if (rlen <= 0) {
+		if (rlen < 0)
+			LOG_ERROR("error during read: %s", strerror(errno));
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+
+	if (tclc->tc_binary) {
+		tclc->tc_lineoffset += rlen;
+		return tcl_input_frames(connection);
+	}
+
+	return tcl_input_text(connection, in, rlen);
+}
+
 static int tcl_closed(struct connection *connection)
 {
 	struct tcl_connection *tclc;
@@ -254,6 +734,8 @@ static int tcl_closed(struct connection *connection)
 	/* cleanup connection context */
 	if (tclc) {
 		free(tclc->tc_line);
+		free(tclc->tc_outq);
+		free(tclc->tc_trace_buf);
 		free(tclc);
 		connection->priv = NULL;
 	}
@@ -261,6 +743,7 @@ static int tcl_closed(struct connection *connection)
 	target_unregister_event_callback(tcl_target_callback_event_handler, connection);
 	target_unregister_reset_callback(tcl_target_callback_reset_handler, connection);
 	target_unregister_trace_callback(tcl_target_callback_trace_handler, connection);
+	target_unregister_timer_callback(tcl_timer_callback, connection);
 
 	return ERROR_OK;
 }
@@ -272,6 +755,7 @@ static const struct service_driver tcl_service_driver = {
 	.input_handler = tcl_input,
 	.connection_closed_handler = tcl_closed,
 	.keep_client_alive_handler = NULL,
+	.flush_output_handler = NULL,
 };
 
 int tcl_init(void)
@@ -323,6 +807,23 @@ COMMAND_HANDLER(handle_tcl_trace_command)
 	}
 }
 
+COMMAND_HANDLER(handle_tcl_binary_command)
+{
+	struct connection *connection = NULL;
+	struct tcl_connection *tclc = NULL;
+
+	if (CMD_CTX->output_handler_priv)
+		connection = CMD_CTX->output_handler_priv;
+
+	if (connection && !strcmp(connection->service->name, "tcl")) {
+		tclc = connection->priv;
+		return CALL_COMMAND_HANDLER(handle_command_parse_bool, &tclc->tc_binary, "Binary framing ");
+	} else {
+		LOG_ERROR("%s: can only be called from the tcl server", CMD_NAME);
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+}
+
 static const struct command_registration tcl_subcommand_handlers[] = {
 	{
 		.name = "port",
@@ -347,6 +848,13 @@ static const struct command_registration tcl_subcommand_handlers[] = {
 		.help = "Target trace output",
 		.usage = "[on|off]",
 	},
+	{
+		.name = "binary",
+		.handler = handle_tcl_binary_command,
+		.mode = COMMAND_EXEC,
+		.help = "Binary framing of the Tcl server connection",
+		.usage = "[on|off]",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
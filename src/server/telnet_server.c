@@ -34,18 +34,100 @@ static char *negotiate =
 /* The only way we can detect that the socket is closed is the first time
  * we write to it, we will fail. Subsequent write operations will
  * succeed. Shudder!
+ *
+ * Send as much of the buffered output as possible. A slow client does
+ * not block the server loop, the rest is sent on a later flush.
  */
+static int telnet_output_flush(struct connection *connection)
+{
+	struct telnet_connection *t_con = connection->priv;
+
+	while (t_con->outq_len && !t_con->closed) {
+		const uint8_t *data = t_con->outq + t_con->outq_head;
+		int ret;
+
+#ifndef _WIN32
+		if (connection->service->type == CONNECTION_TCP) {
+			ret = send(connection->fd_out, data, t_con->outq_len, MSG_DONTWAIT);
+
+			if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+				return ERROR_OK;
+		} else
+#endif
+		{
+			ret = connection_write(connection, data, t_con->outq_len);
+		}
+
+		if (ret <= 0) {
+			t_con->closed = true;
+			break;
+		}
+
+		t_con->outq_head += ret;
+		t_con->outq_len -= ret;
+	}
+
+	t_con->outq_head = 0;
+
+	return t_con->closed ? ERROR_SERVER_REMOTE_CLOSED : ERROR_OK;
+}
+
+/* service handler, once per server loop iteration */
+static void telnet_flush_output(struct connection *connection)
+{
+	telnet_output_flush(connection);
+}
+
+static void telnet_queue(struct telnet_connection *t_con, const void *data, size_t len)
+{
+	if (len > TELNET_OUTPUT_QUEUE_SIZE - t_con->outq_head - t_con->outq_len) {
+		memmove(t_con->outq, t_con->outq + t_con->outq_head, t_con->outq_len);
+		t_con->outq_head = 0;
+	}
+
+	memcpy(t_con->outq + t_con->outq_head + t_con->outq_len, data, len);
+	t_con->outq_len += len;
+}
+
+/* Buffer the output, it is sent by telnet_output_flush() */
 static int telnet_write(struct connection *connection, const void *data,
 	int len)
 {
 	struct telnet_connection *t_con = connection->priv;
+	char note[80];
+
 	if (t_con->closed)
 		return ERROR_SERVER_REMOTE_CLOSED;
 
-	if (connection_write(connection, data, len) == len)
+	if (!t_con->outq) {
+		t_con->outq = malloc(TELNET_OUTPUT_QUEUE_SIZE);
+		if (!t_con->outq) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+	}
+
+	if (t_con->outq_len + len > TELNET_OUTPUT_FLUSH_SIZE)
+		telnet_output_flush(connection);
+
+	/* tell what was lost once there is room again */
+	int note_len = 0;
+	if (t_con->outq_dropped)
+		note_len = snprintf(note, sizeof(note), "\r\n*** output truncated, %zu bytes dropped ***\r\n",
+			t_con->outq_dropped);
+
+	if ((size_t)(note_len + len) > TELNET_OUTPUT_QUEUE_SIZE - t_con->outq_len) {
+		t_con->outq_dropped += len;
 		return ERROR_OK;
-	t_con->closed = true;
-	return ERROR_SERVER_REMOTE_CLOSED;
+	}
+
+	if (note_len) {
+		telnet_queue(t_con, note, note_len);
+		t_con->outq_dropped = 0;
+	}
+	telnet_queue(t_con, data, len);
+
+	return ERROR_OK;
 }
 
 /* output an audible bell */
@@ -747,7 +829,7 @@ static void telnet_auto_complete(struct connection *connection)
 	Jim_DecrRefCount(command_context->interp, list);
 }
 
-static int telnet_input(struct connection *connection)
+static int telnet_input_data(struct connection *connection)
 {
 	int bytes_read;
 	unsigned char buffer[TELNET_BUFFER_SIZE];
@@ -903,6 +985,16 @@ static int telnet_input(struct connection *connection)
 	return ERROR_OK;
 }
 
+static int telnet_input(struct connection *connection)
+{
+	int retval = telnet_input_data(connection);
+
+	/* echo and command output without waiting for the end of the loop */
+	telnet_output_flush(connection);
+
+	return retval;
+}
+
 static int telnet_connection_closed(struct connection *connection)
 {
 	struct telnet_connection *t_con = connection->priv;
@@ -910,6 +1002,10 @@ static int telnet_connection_closed(struct connection *connection)
 
 	log_remove_callback(telnet_log_callback, connection);
 
+	/* last chance for the output, e.g. of "shutdown" */
+	telnet_output_flush(connection);
+	free(t_con->outq);
+
 	free(t_con->prompt);
 	t_con->prompt = NULL;
 
@@ -937,6 +1033,7 @@ static const struct service_driver telnet_service_driver = {
 	.input_handler = telnet_input,
 	.connection_closed_handler = telnet_connection_closed,
 	.keep_client_alive_handler = NULL,
+	.flush_output_handler = telnet_flush_output,
 };
 
 int telnet_init(char *banner)
@@ -21,6 +21,11 @@
 #define TELNET_LINE_HISTORY_SIZE (128)
 #define TELNET_LINE_MAX_SIZE (10*256)
 
+/* output buffered for a slow client, beyond it the output is dropped */
+#define TELNET_OUTPUT_QUEUE_SIZE (1024*1024)
+/* buffered output is sent once per server loop iteration or above this size */
+#define TELNET_OUTPUT_FLUSH_SIZE (16*1024)
+
 enum telnet_states {
 	TELNET_STATE_DATA,
 	TELNET_STATE_IAC,
@@ -45,6 +50,11 @@ struct telnet_connection {
 	size_t next_history;
 	size_t current_history;
 	bool closed;
+	/* output not sent yet, see telnet_write() */
+	uint8_t *outq;
+	size_t outq_head;
+	size_t outq_len;
+	size_t outq_dropped;
 };
 
 struct telnet_service {
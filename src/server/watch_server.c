@@ -0,0 +1,496 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/time_support.h>
+#include <target/target.h>
+
+#include "server.h"
+#include "watch_server.h"
+
+/**
+ * @file
+ *
+ * Watch server.
+ *
+ * Samples a set of target variables at a fixed rate while the target runs
+ * and streams timestamped binary records to TCP clients, to plot them live.
+ * All the variables of a sample are read with a single scatter-gather
+ * memory access, i.e. one adapter round trip on targets implementing
+ * read_memory_sg.
+ *
+ * On connection the client receives a line of text describing the records:
+ *
+ *   openocd-watch <rate> <record size> <width>@<address> ...
+ *
+ * followed by the records. A record holds the sample time in microseconds
+ * since the server start (8 bytes), the sample number (4 bytes), then the
+ * value of each variable in the order of the line above, all little endian.
+ * Sample numbers skipped by a record have been lost, either because the
+ * target could not be read or because the client was too slow.
+ */
+
+/* Samples taken in a row by a late timer tick before giving up on them */
+#define WATCH_MAX_BURST		64
+
+#define WATCH_RECORD_HEADER_SIZE	12
+
+struct watch_var {
+	target_addr_t address;
+	uint32_t width;
+};
+
+/* variables of the next server */
+static struct watch_var *watch_vars;
+static unsigned int watch_num_vars;
+
+struct watch_connection {
+	struct connection *connection;
+	/* end of a record the socket did not take, sent before the next one */
+	uint8_t *pending;
+	size_t pending_len;
+	unsigned int dropped;
+	struct watch_connection *next;
+};
+
+/* Allocated as a single block, remove_service() frees it */
+struct watch_service {
+	struct target *target;
+	unsigned int num_vars;
+	int64_t period_us;
+	int64_t start_us;
+	int64_t next_us;
+	uint32_t sequence;
+	unsigned int errors;
+	size_t record_size;
+	struct watch_connection *clients;
+	struct watch_var *vars;
+	struct target_memory_sg *ranges;
+	uint8_t *data;
+	uint8_t *record;
+};
+
+static struct watch_service *watch_service;
+static char *watch_port;
+
+/* Send what the socket takes without blocking, keep the rest pending */
+static int watch_connection_send(struct watch_connection *client,
+		const uint8_t *data, size_t len)
+{
+	struct connection *connection = client->connection;
+	int ret;
+
+#ifndef _WIN32
+	if (connection->service->type == CONNECTION_TCP) {
+		ret = send(connection->fd_out, data, len, MSG_DONTWAIT);
+		if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			ret = 0;
+	} else
+#endif
+	{
+		ret = connection_write(connection, data, len);
+	}
+
+	if (ret < 0) {
+		LOG_ERROR("watch: failed to write data to socket");
+		return ERROR_FAIL;
+	}
+
+	client->pending_len = len - ret;
+	if (client->pending_len)
+		memmove(client->pending, data + ret, client->pending_len);
+
+	return ERROR_OK;
+}
+
+static void watch_send_record(struct watch_service *w)
+{
+	for (struct watch_connection *client = w->clients; client; client = client->next) {
+		if (client->pending_len) {
+			uint8_t *pending = client->pending;
+			if (watch_connection_send(client, pending, client->pending_len) != ERROR_OK)
+				continue;
+			if (client->pending_len) {
+				client->dropped++;
+				continue;
+			}
+		}
+
+		if (client->dropped) {
+			LOG_WARNING("watch: client too slow, dropped %u samples", client->dropped);
+			client->dropped = 0;
+		}
+
+		watch_connection_send(client, w->record, w->record_size);
+	}
+}
+
+static void watch_sample(struct watch_service *w)
+{
+	struct target *target = w->target;
+	uint32_t sequence = w->sequence++;
+	int64_t timestamp = timeval_us() - w->start_us;
+
+	int retval = target_read_memory_sg(target, w->ranges, w->num_vars);
+	if (retval != ERROR_OK) {
+		if (!w->errors++)
+			LOG_TARGET_WARNING(target, "watch: reading the variables failed, samples are skipped");
+		return;
+	}
+
+	if (w->errors) {
+		LOG_TARGET_INFO(target, "watch: sampling again after %u failed reads", w->errors);
+		w->errors = 0;
+	}
+
+	uint8_t *p = w->record;
+	h_u64_to_le(p, timestamp);
+	h_u32_to_le(p + 8, sequence);
+	p += WATCH_RECORD_HEADER_SIZE;
+
+	for (unsigned int i = 0; i < w->num_vars; i++) {
+		const uint8_t *value = w->ranges[i].buffer;
+
+		switch (w->vars[i].width) {
+		case 1:
+			*p = *value;
+			break;
+		case 2:
+			h_u16_to_le(p, target_buffer_get_u16(target, value));
+			break;
+		default:
+			h_u32_to_le(p, target_buffer_get_u32(target, value));
+			break;
+		}
+		p += w->vars[i].width;
+	}
+
+	watch_send_record(w);
+}
+
+static int watch_timer_callback(void *priv)
+{
+	struct watch_service *w = priv;
+	int64_t now = timeval_us();
+
+	if (!w->clients) {
+		w->next_us = now;
+		return ERROR_OK;
+	}
+
+	/* timer ticks are at best 1 ms apart, faster rates take a few
+	 * samples per tick */
+	for (unsigned int n = 0; w->next_us <= now && n < WATCH_MAX_BURST; n++) {
+		watch_sample(w);
+		w->next_us += w->period_us;
+	}
+
+	if (w->next_us <= now) {
+		unsigned int lost = (now - w->next_us) / w->period_us + 1;
+		LOG_DEBUG("watch: sampling is late, %u samples skipped", lost);
+		w->sequence += lost;
+		w->next_us += (int64_t)lost * w->period_us;
+	}
+
+	return ERROR_OK;
+}
+
+static int watch_new_connection(struct connection *connection)
+{
+	struct watch_service *w = connection->service->priv;
+
+	struct watch_connection *client = calloc(1, sizeof(*client));
+	if (!client)
+		return ERROR_FAIL;
+
+	client->pending = malloc(w->record_size);
+	if (!client->pending) {
+		free(client);
+		return ERROR_FAIL;
+	}
+
+	char *line = alloc_printf("openocd-watch %" PRId64 " %zu",
+		(int64_t)(1000000 / w->period_us), w->record_size);
+	for (unsigned int i = 0; line && i < w->num_vars; i++) {
+		char *prev = line;
+		line = alloc_printf("%s %" PRIu32 "@" TARGET_ADDR_FMT, prev,
+			w->vars[i].width, w->vars[i].address);
+		free(prev);
+	}
+	if (!line) {
+		free(client->pending);
+		free(client);
+		return ERROR_FAIL;
+	}
+	int ret = connection_write(connection, line, strlen(line));
+	if (ret >= 0)
+		ret = connection_write(connection, "\n", 1);
+	free(line);
+	if (ret < 0) {
+		free(client->pending);
+		free(client);
+		return ERROR_FAIL;
+	}
+
+	client->connection = connection;
+	client->next = w->clients;
+	w->clients = client;
+	connection->priv = client;
+
+	return ERROR_OK;
+}
+
+static int watch_connection_closed(struct connection *connection)
+{
+	struct watch_service *w = connection->service->priv;
+	struct watch_connection *client = connection->priv;
+
+	for (struct watch_connection **p = &w->clients; *p; p = &(*p)->next) {
+		if (*p == client) {
+			*p = client->next;
+			break;
+		}
+	}
+
+	free(client->pending);
+	free(client);
+	connection->priv = NULL;
+
+	return ERROR_OK;
+}
+
+static int watch_input(struct connection *connection)
+{
+	unsigned char buffer[64];
+
+	/* nothing is expected from the client */
+	int bytes_read = connection_read(connection, buffer, sizeof(buffer));
+	if (!bytes_read)
+		return ERROR_SERVER_REMOTE_CLOSED;
+	if (bytes_read < 0) {
+		LOG_ERROR("error during read: %s", strerror(errno));
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+
+	return ERROR_OK;
+}
+
+static const struct service_driver watch_service_driver = {
+	.name = "watch",
+	.new_connection_during_keep_alive_handler = NULL,
+	.new_connection_handler = watch_new_connection,
+	.input_handler = watch_input,
+	.connection_closed_handler = watch_connection_closed,
+	.keep_client_alive_handler = NULL,
+	.flush_output_handler = NULL,
+};
+
+static void watch_stop(void)
+{
+	if (!watch_service)
+		return;
+
+	target_unregister_timer_callback(watch_timer_callback, watch_service);
+	/* frees watch_service */
+	remove_service("watch", watch_port);
+	watch_service = NULL;
+	free(watch_port);
+	watch_port = NULL;
+}
+
+COMMAND_HANDLER(handle_watch_add_command)
+{
+	struct watch_var var;
+
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_ADDRESS(CMD_ARGV[0], var.address);
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], var.width);
+
+	if (var.width != 1 && var.width != 2 && var.width != 4) {
+		command_print(CMD, "width must be 1, 2 or 4 bytes");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+	if (var.address % var.width) {
+		command_print(CMD, "address must be aligned to the width");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	struct watch_var *vars = realloc(watch_vars, (watch_num_vars + 1) * sizeof(*vars));
+	if (!vars) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	watch_vars = vars;
+	watch_vars[watch_num_vars++] = var;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_watch_clear_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	free(watch_vars);
+	watch_vars = NULL;
+	watch_num_vars = 0;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_watch_list_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	for (unsigned int i = 0; i < watch_num_vars; i++)
+		command_print(CMD, TARGET_ADDR_FMT " %" PRIu32, watch_vars[i].address,
+			watch_vars[i].width);
+
+	if (watch_service)
+		command_print(CMD, "streaming on port %s", watch_port);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_watch_start_command)
+{
+	unsigned int rate;
+
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], rate);
+	if (rate == 0 || rate > 1000000) {
+		command_print(CMD, "rate must be between 1 and 1000000 samples per second");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	if (!watch_num_vars) {
+		command_print(CMD, "no variable to watch, use 'watch add' first");
+		return ERROR_FAIL;
+	}
+
+	struct target *target = get_current_target(CMD_CTX);
+
+	watch_stop();
+
+	size_t record_size = WATCH_RECORD_HEADER_SIZE;
+	for (unsigned int i = 0; i < watch_num_vars; i++)
+		record_size += watch_vars[i].width;
+
+	/* struct, vars, ranges, data (4 bytes per variable), record */
+	size_t vars_offset = sizeof(struct watch_service);
+	size_t ranges_offset = vars_offset + watch_num_vars * sizeof(struct watch_var);
+	size_t data_offset = ranges_offset + watch_num_vars * sizeof(struct target_memory_sg);
+	size_t record_offset = data_offset + watch_num_vars * 4;
+	uint8_t *block = calloc(1, record_offset + record_size);
+	if (!block) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	struct watch_service *w = (struct watch_service *)block;
+	w->target = target;
+	w->num_vars = watch_num_vars;
+	w->period_us = 1000000 / rate;
+	w->record_size = record_size;
+	w->vars = (struct watch_var *)(block + vars_offset);
+	w->ranges = (struct target_memory_sg *)(block + ranges_offset);
+	w->data = block + data_offset;
+	w->record = block + record_offset;
+
+	for (unsigned int i = 0; i < watch_num_vars; i++) {
+		w->vars[i] = watch_vars[i];
+		w->ranges[i].address = watch_vars[i].address;
+		w->ranges[i].size = watch_vars[i].width;
+		w->ranges[i].count = 1;
+		w->ranges[i].buffer = w->data + 4 * i;
+	}
+
+	w->start_us = timeval_us();
+	w->next_us = w->start_us;
+
+	int retval = add_service(&watch_service_driver, CMD_ARGV[0], CONNECTION_LIMIT_UNLIMITED, w);
+	if (retval != ERROR_OK) {
+		free(block);
+		return retval;
+	}
+
+	watch_service = w;
+	watch_port = strdup(CMD_ARGV[0]);
+
+	unsigned int period_ms = w->period_us / 1000;
+	return target_register_timer_callback(watch_timer_callback, MAX(period_ms, 1u),
+		TARGET_TIMER_TYPE_PERIODIC, w);
+}
+
+COMMAND_HANDLER(handle_watch_stop_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	watch_stop();
+
+	return ERROR_OK;
+}
+
+static const struct command_registration watch_subcommand_handlers[] = {
+	{
+		.name = "add",
+		.handler = handle_watch_add_command,
+		.mode = COMMAND_ANY,
+		.help = "add a variable to sample, for the next 'watch start'",
+		.usage = "<address> <1|2|4>",
+	},
+	{
+		.name = "clear",
+		.handler = handle_watch_clear_command,
+		.mode = COMMAND_ANY,
+		.help = "remove all the variables",
+		.usage = "",
+	},
+	{
+		.name = "list",
+		.handler = handle_watch_list_command,
+		.mode = COMMAND_ANY,
+		.help = "list the variables and the server port",
+		.usage = "",
+	},
+	{
+		.name = "start",
+		.handler = handle_watch_start_command,
+		.mode = COMMAND_EXEC,
+		.help = "sample the variables of the current target at the given "
+			"rate and stream the samples to the TCP port",
+		.usage = "<port> <samples_per_second>",
+	},
+	{
+		.name = "stop",
+		.handler = handle_watch_stop_command,
+		.mode = COMMAND_EXEC,
+		.help = "stop sampling and close the server",
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration watch_command_handlers[] = {
+	{
+		.name = "watch",
+		.mode = COMMAND_ANY,
+		.help = "stream samples of target variables",
+		.usage = "",
+		.chain = watch_subcommand_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int watch_server_register_commands(struct command_context *ctx)
+{
+	return register_commands(ctx, NULL, watch_command_handlers);
+}
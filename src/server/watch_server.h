@@ -0,0 +1,10 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_SERVER_WATCH_SERVER_H
+#define OPENOCD_SERVER_WATCH_SERVER_H
+
+#include <helper/command.h>
+
+int watch_server_register_commands(struct command_context *ctx);
+
+#endif /* OPENOCD_SERVER_WATCH_SERVER_H */
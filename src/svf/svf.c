@@ -23,6 +23,7 @@
 #include "helper/system.h"
 #include <helper/time_support.h>
 #include <helper/nvp.h>
+#include <helper/fileio.h>
 #include <stdbool.h>
 
 /* SVF command */
@@ -201,15 +202,24 @@ struct svf_check_tdo_para {
 	int bit_len;		/* bit length to check */
 };
 
+/* initial size, the array grows with the number of checks in a batch */
 #define SVF_CHECK_TDO_PARA_SIZE 1024
 static struct svf_check_tdo_para *svf_check_tdo_para;
 static int svf_check_tdo_para_index;
+static int svf_check_tdo_para_size;
 
 static int svf_read_command_from_file(FILE *fd);
 static int svf_check_tdo(void);
 static int svf_add_check_para(uint8_t enabled, int buffer_offset, int bit_len);
 static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str);
 static int svf_execute_tap(void);
+static bool svf_is_binary(FILE *fd);
+static int svf_binary_open(const char *filename);
+static void svf_binary_close(void);
+static bool svf_binary_is_open(void);
+static bool svf_binary_at_end(void);
+static int svf_read_command_from_binary(void);
+static int svf_run_binary_command(struct command_context *cmd_ctx);
 
 static FILE *svf_fd;
 static char *svf_read_line;
@@ -220,8 +230,12 @@ static int svf_line_number;
 static int svf_getline(char **lineptr, size_t *n, FILE *stream);
 
 #define SVF_MAX_BUFFER_SIZE_TO_COMMIT   (1024 * 1024)
+/* limit of -batch_size, in KiB */
+#define SVF_MAX_BATCH_SIZE_KB           (512 * 1024)
 static uint8_t *svf_tdi_buffer, *svf_tdo_buffer, *svf_mask_buffer;
 static int svf_buffer_index, svf_buffer_size;
+/* scan data queued before the JTAG queue is run and TDO is checked */
+static int svf_batch_size;
 static int svf_quiet;
 static int svf_nil;
 static int svf_ignore_error;
@@ -313,6 +327,19 @@ static void svf_free_xxd_para(struct svf_xxr_para *para)
 	}
 }
 
+/* Set the length of an XXR parameter, returns the previous length */
+static int svf_xxr_set_len(struct svf_xxr_para *para, int len)
+{
+	int orig_len = para->len;
+
+	para->len = len;
+	/* If we are to enlarge the buffers, all parts of para need to be freed */
+	if (orig_len < len)
+		svf_free_xxd_para(para);
+
+	return orig_len;
+}
+
 int svf_add_statemove(tap_state_t state_to)
 {
 	tap_state_t state_from = cmd_queue_cur_state;
@@ -349,6 +376,7 @@ int svf_add_statemove(tap_state_t state_to)
 
 enum svf_cmd_param {
 	OPT_ADDCYCLES,
+	OPT_BATCH_SIZE,
 	OPT_IGNORE_ERROR,
 	OPT_NIL,
 	OPT_NORESET,
@@ -364,6 +392,7 @@ enum svf_cmd_param {
 
 static const struct nvp svf_cmd_opts[] = {
 	{ .name = "-addcycles",    .value = OPT_ADDCYCLES },
+	{ .name = "-batch_size",   .value = OPT_BATCH_SIZE },
 	{ .name = "-ignore_error", .value = OPT_IGNORE_ERROR },
 	{ .name = "-nil",          .value = OPT_NIL },
 	{ .name = "-noreset",      .value = OPT_NORESET },
@@ -381,7 +410,7 @@ static const struct nvp svf_cmd_opts[] = {
 COMMAND_HANDLER(handle_svf_command)
 {
 #define SVF_MIN_NUM_OF_OPTIONS 1
-#define SVF_MAX_NUM_OF_OPTIONS 8
+#define SVF_MAX_NUM_OF_OPTIONS 10
 	int command_num = 0;
 	int ret = ERROR_OK;
 	int64_t time_measure_ms;
@@ -393,6 +422,7 @@ COMMAND_HANDLER(handle_svf_command)
 	 * that should be affected
 	 */
 	struct jtag_tap *tap = NULL;
+	const char *filename = NULL;
 
 	if ((CMD_ARGC < SVF_MIN_NUM_OF_OPTIONS) || (CMD_ARGC > SVF_MAX_NUM_OF_OPTIONS))
 		return ERROR_COMMAND_SYNTAX_ERROR;
@@ -404,6 +434,7 @@ COMMAND_HANDLER(handle_svf_command)
 	svf_ignore_error = 0;
 	svf_noreset = false;
 	svf_addcycles = 0;
+	svf_batch_size = SVF_MAX_BUFFER_SIZE_TO_COMMIT;
 
 	for (unsigned int i = 0; i < CMD_ARGC; i++) {
 		const struct nvp *n = nvp_name2value(svf_cmd_opts, CMD_ARGV[i]);
@@ -420,6 +451,22 @@ COMMAND_HANDLER(handle_svf_command)
 			i++;
 			break;
 
+		case OPT_BATCH_SIZE: {
+			unsigned int batch_kb;
+			if (i + 1 >= CMD_ARGC || parse_uint(CMD_ARGV[i + 1], &batch_kb) != ERROR_OK ||
+					batch_kb == 0 || batch_kb > SVF_MAX_BATCH_SIZE_KB) {
+				command_print(CMD, "batch_size: invalid size, 1 to %u KiB",
+					SVF_MAX_BATCH_SIZE_KB);
+				if (svf_fd)
+					fclose(svf_fd);
+				svf_fd = NULL;
+				return ERROR_COMMAND_ARGUMENT_INVALID;
+			}
+			svf_batch_size = batch_kb * 1024;
+			i++;
+			break;
+		}
+
 		case OPT_TAP:
 			tap = jtag_tap_by_string(CMD_ARGV[i+1]);
 			if (!tap) {
@@ -473,6 +520,7 @@ COMMAND_HANDLER(handle_svf_command)
 				return ERROR_COMMAND_SYNTAX_ERROR;
 			}
 			LOG_USER("svf processing file: \"%s\"", CMD_ARGV[i]);
+			filename = CMD_ARGV[i];
 			break;
 		}
 	}
@@ -488,7 +536,8 @@ COMMAND_HANDLER(handle_svf_command)
 	svf_command_buffer_size = 0;
 
 	svf_check_tdo_para_index = 0;
-	svf_check_tdo_para = malloc(sizeof(struct svf_check_tdo_para) * SVF_CHECK_TDO_PARA_SIZE);
+	svf_check_tdo_para_size = SVF_CHECK_TDO_PARA_SIZE;
+	svf_check_tdo_para = malloc(sizeof(struct svf_check_tdo_para) * svf_check_tdo_para_size);
 	if (!svf_check_tdo_para) {
 		LOG_ERROR("not enough memory");
 		ret = ERROR_FAIL;
@@ -496,11 +545,11 @@ COMMAND_HANDLER(handle_svf_command)
 	}
 
 	svf_buffer_index = 0;
-	/* double the buffer size */
+	/* add room beyond the batch size */
 	/* in case current command cannot be committed, and next command is a bit scan command */
-	/* here is 32K bits for this big scan command, it should be enough */
+	/* here is 8M bits for this big scan command, it should be enough */
 	/* buffer will be reallocated if buffer size is not enough */
-	if (svf_realloc_buffers(2 * SVF_MAX_BUFFER_SIZE_TO_COMMIT) != ERROR_OK) {
+	if (svf_realloc_buffers(svf_batch_size + SVF_MAX_BUFFER_SIZE_TO_COMMIT) != ERROR_OK) {
 		ret = ERROR_FAIL;
 		goto free_all;
 	}
@@ -560,7 +609,14 @@ COMMAND_HANDLER(handle_svf_command)
 		}
 	}
 
-	if (svf_progress_enabled) {
+	if (svf_is_binary(svf_fd)) {
+		/* compiled by "svf compile", sets svf_total_lines */
+		if (svf_binary_open(filename) != ERROR_OK) {
+			command_print(CMD, "failed to load compiled svf file");
+			ret = ERROR_FAIL;
+			goto free_all;
+		}
+	} else if (svf_progress_enabled) {
 		/* Count total lines in file. */
 		while (!feof(svf_fd)) {
 			svf_getline(&svf_command_buffer, &svf_command_buffer_size, svf_fd);
@@ -568,7 +624,8 @@ COMMAND_HANDLER(handle_svf_command)
 		}
 		rewind(svf_fd);
 	}
-	while (svf_read_command_from_file(svf_fd) == ERROR_OK) {
+	while ((svf_binary_is_open() ? svf_read_command_from_binary()
+			: svf_read_command_from_file(svf_fd)) == ERROR_OK) {
 		/* Log Output */
 		if (svf_quiet) {
 			if (svf_progress_enabled) {
@@ -586,7 +643,8 @@ COMMAND_HANDLER(handle_svf_command)
 				LOG_USER_N("%s", svf_read_line);
 		}
 		/* Run Command */
-		if (svf_run_command(CMD_CTX, svf_command_buffer) != ERROR_OK) {
+		if ((svf_binary_is_open() ? svf_run_binary_command(CMD_CTX)
+				: svf_run_command(CMD_CTX, svf_command_buffer)) != ERROR_OK) {
 			LOG_ERROR("fail to run command at line %d", svf_line_number);
 			ret = ERROR_FAIL;
 			break;
@@ -594,6 +652,11 @@ COMMAND_HANDLER(handle_svf_command)
 		command_num++;
 	}
 
+	if (ret == ERROR_OK && svf_binary_is_open() && !svf_binary_at_end()) {
+		LOG_ERROR("compiled svf file is corrupted after line %d", svf_line_number);
+		ret = ERROR_FAIL;
+	}
+
 	if ((!svf_nil) && (jtag_execute_queue() != ERROR_OK))
 		ret = ERROR_FAIL;
 	else if (svf_check_tdo() != ERROR_OK)
@@ -616,6 +679,7 @@ free_all:
 
 	fclose(svf_fd);
 	svf_fd = NULL;
+	svf_binary_close();
 
 	/* free buffers */
 	free(svf_command_buffer);
@@ -625,6 +689,7 @@ free_all:
 	free(svf_check_tdo_para);
 	svf_check_tdo_para = NULL;
 	svf_check_tdo_para_index = 0;
+	svf_check_tdo_para_size = 0;
 
 	free(svf_tdi_buffer);
 	svf_tdi_buffer = NULL;
@@ -953,9 +1018,16 @@ static int svf_check_tdo(void)
 
 static int svf_add_check_para(uint8_t enabled, int buffer_offset, int bit_len)
 {
-	if (svf_check_tdo_para_index >= SVF_CHECK_TDO_PARA_SIZE) {
-		LOG_ERROR("toooooo many operation undone");
-		return ERROR_FAIL;
+	if (svf_check_tdo_para_index >= svf_check_tdo_para_size) {
+		/* checks are only done when the batch is run, keep them all */
+		struct svf_check_tdo_para *para = realloc(svf_check_tdo_para,
+				2 * svf_check_tdo_para_size * sizeof(*para));
+		if (!para) {
+			LOG_ERROR("not enough memory");
+			return ERROR_FAIL;
+		}
+		svf_check_tdo_para = para;
+		svf_check_tdo_para_size *= 2;
 	}
 
 	svf_check_tdo_para[svf_check_tdo_para_index].line_num = svf_line_number;
@@ -979,6 +1051,277 @@ static int svf_execute_tap(void)
 	return ERROR_OK;
 }
 
+/*
+ * Apply the defaults for the data sections an XXR command left out and,
+ * for SIR and SDR, queue the scan with the header and trailer. The new
+ * length and the given sections are already in @a para, @a orig_len is
+ * the previous length.
+ */
+static int svf_xxr_execute(int command, struct svf_xxr_para *para, int orig_len)
+{
+	struct scan_field field;
+	int i;
+
+	/* If a command changes the length of the last scan of the same type and the
+	 * MASK parameter is absent, */
+	/* the mask pattern used is all cares */
+	if (!(para->data_mask & XXR_MASK) && (orig_len != para->len)) {
+		/* MASK not defined and length changed */
+		if (ERROR_OK !=
+		svf_adjust_array_length(&para->mask, orig_len,
+			para->len)) {
+			LOG_ERROR("fail to adjust length of array");
+			return ERROR_FAIL;
+		}
+		buf_set_ones(para->mask, para->len);
+	}
+	/* If TDO is absent, no comparison is needed, set the mask to 0 */
+	if (!(para->data_mask & XXR_TDO)) {
+		if (!para->tdo) {
+			if (ERROR_OK !=
+			svf_adjust_array_length(&para->tdo, orig_len,
+				para->len)) {
+				LOG_ERROR("fail to adjust length of array");
+				return ERROR_FAIL;
+			}
+		}
+		if (!para->mask) {
+			if (ERROR_OK !=
+			svf_adjust_array_length(&para->mask, orig_len,
+				para->len)) {
+				LOG_ERROR("fail to adjust length of array");
+				return ERROR_FAIL;
+			}
+		}
+		memset(para->mask, 0, (para->len + 7) >> 3);
+	}
+	/* do scan if necessary */
+	if (command == SDR) {
+		/* check buffer size first, reallocate if necessary */
+		i = svf_para.hdr_para.len + svf_para.sdr_para.len +
+				svf_para.tdr_para.len;
+		if ((svf_buffer_size - svf_buffer_index) < ((i + 7) >> 3)) {
+			/* reallocate buffer */
+			if (svf_realloc_buffers(svf_buffer_index + ((i + 7) >> 3)) != ERROR_OK) {
+				LOG_ERROR("not enough memory");
+				return ERROR_FAIL;
+			}
+		}
+
+		/* assemble dr data */
+		i = 0;
+		buf_set_buf(svf_para.hdr_para.tdi,
+				0,
+				&svf_tdi_buffer[svf_buffer_index],
+				i,
+				svf_para.hdr_para.len);
+		i += svf_para.hdr_para.len;
+		buf_set_buf(svf_para.sdr_para.tdi,
+				0,
+				&svf_tdi_buffer[svf_buffer_index],
+				i,
+				svf_para.sdr_para.len);
+		i += svf_para.sdr_para.len;
+		buf_set_buf(svf_para.tdr_para.tdi,
+				0,
+				&svf_tdi_buffer[svf_buffer_index],
+				i,
+				svf_para.tdr_para.len);
+		i += svf_para.tdr_para.len;
+
+		/* add check data */
+		if (svf_para.sdr_para.data_mask & XXR_TDO) {
+			/* assemble dr mask data */
+			i = 0;
+			buf_set_buf(svf_para.hdr_para.mask,
+					0,
+					&svf_mask_buffer[svf_buffer_index],
+					i,
+					svf_para.hdr_para.len);
+			i += svf_para.hdr_para.len;
+			buf_set_buf(svf_para.sdr_para.mask,
+					0,
+					&svf_mask_buffer[svf_buffer_index],
+					i,
+					svf_para.sdr_para.len);
+			i += svf_para.sdr_para.len;
+			buf_set_buf(svf_para.tdr_para.mask,
+					0,
+					&svf_mask_buffer[svf_buffer_index],
+					i,
+					svf_para.tdr_para.len);
+
+			/* assemble dr check data */
+			i = 0;
+			buf_set_buf(svf_para.hdr_para.tdo,
+					0,
+					&svf_tdo_buffer[svf_buffer_index],
+					i,
+					svf_para.hdr_para.len);
+			i += svf_para.hdr_para.len;
+			buf_set_buf(svf_para.sdr_para.tdo,
+					0,
+					&svf_tdo_buffer[svf_buffer_index],
+					i,
+					svf_para.sdr_para.len);
+			i += svf_para.sdr_para.len;
+			buf_set_buf(svf_para.tdr_para.tdo,
+					0,
+					&svf_tdo_buffer[svf_buffer_index],
+					i,
+					svf_para.tdr_para.len);
+			i += svf_para.tdr_para.len;
+
+			if (svf_add_check_para(1, svf_buffer_index, i) != ERROR_OK)
+				return ERROR_FAIL;
+		} else if (svf_add_check_para(0, svf_buffer_index, i) != ERROR_OK) {
+			return ERROR_FAIL;
+		}
+		field.num_bits = i;
+		field.out_value = &svf_tdi_buffer[svf_buffer_index];
+		field.in_value = (para->data_mask & XXR_TDO) ? &svf_tdi_buffer[svf_buffer_index] : NULL;
+		if (!svf_nil) {
+			/* NOTE:  doesn't use SVF-specified state paths */
+			if (field.in_value)
+				jtag_add_plain_dr_scan(field.num_bits,
+						field.out_value,
+						field.in_value,
+						svf_para.dr_end_state);
+			else
+				/* TDI stays in svf_tdi_buffer until the queue is executed */
+				jtag_add_plain_dr_scan_nocopy(field.num_bits,
+						field.out_value,
+						NULL,
+						svf_para.dr_end_state);
+		}
+
+		if (svf_addcycles)
+			jtag_add_clocks(svf_addcycles);
+
+		svf_buffer_index += (i + 7) >> 3;
+	} else if (command == SIR) {
+		/* check buffer size first, reallocate if necessary */
+		i = svf_para.hir_para.len + svf_para.sir_para.len +
+				svf_para.tir_para.len;
+		if ((svf_buffer_size - svf_buffer_index) < ((i + 7) >> 3)) {
+			if (svf_realloc_buffers(svf_buffer_index + ((i + 7) >> 3)) != ERROR_OK) {
+				LOG_ERROR("not enough memory");
+				return ERROR_FAIL;
+			}
+		}
+
+		/* assemble ir data */
+		i = 0;
+		buf_set_buf(svf_para.hir_para.tdi,
+				0,
+				&svf_tdi_buffer[svf_buffer_index],
+				i,
+				svf_para.hir_para.len);
+		i += svf_para.hir_para.len;
+		buf_set_buf(svf_para.sir_para.tdi,
+				0,
+				&svf_tdi_buffer[svf_buffer_index],
+				i,
+				svf_para.sir_para.len);
+		i += svf_para.sir_para.len;
+		buf_set_buf(svf_para.tir_para.tdi,
+				0,
+				&svf_tdi_buffer[svf_buffer_index],
+				i,
+				svf_para.tir_para.len);
+		i += svf_para.tir_para.len;
+
+		/* add check data */
+		if (svf_para.sir_para.data_mask & XXR_TDO) {
+			/* assemble dr mask data */
+			i = 0;
+			buf_set_buf(svf_para.hir_para.mask,
+					0,
+					&svf_mask_buffer[svf_buffer_index],
+					i,
+					svf_para.hir_para.len);
+			i += svf_para.hir_para.len;
+			buf_set_buf(svf_para.sir_para.mask,
+					0,
+					&svf_mask_buffer[svf_buffer_index],
+					i,
+					svf_para.sir_para.len);
+			i += svf_para.sir_para.len;
+			buf_set_buf(svf_para.tir_para.mask,
+					0,
+					&svf_mask_buffer[svf_buffer_index],
+					i,
+					svf_para.tir_para.len);
+
+			/* assemble dr check data */
+			i = 0;
+			buf_set_buf(svf_para.hir_para.tdo,
+					0,
+					&svf_tdo_buffer[svf_buffer_index],
+					i,
+					svf_para.hir_para.len);
+			i += svf_para.hir_para.len;
+			buf_set_buf(svf_para.sir_para.tdo,
+					0,
+					&svf_tdo_buffer[svf_buffer_index],
+					i,
+					svf_para.sir_para.len);
+			i += svf_para.sir_para.len;
+			buf_set_buf(svf_para.tir_para.tdo,
+					0,
+					&svf_tdo_buffer[svf_buffer_index],
+					i,
+					svf_para.tir_para.len);
+			i += svf_para.tir_para.len;
+
+			if (svf_add_check_para(1, svf_buffer_index, i) != ERROR_OK)
+				return ERROR_FAIL;
+		} else if (svf_add_check_para(0, svf_buffer_index, i) != ERROR_OK) {
+			return ERROR_FAIL;
+		}
+		field.num_bits = i;
+		field.out_value = &svf_tdi_buffer[svf_buffer_index];
+		field.in_value = (para->data_mask & XXR_TDO) ? &svf_tdi_buffer[svf_buffer_index] : NULL;
+		if (!svf_nil) {
+			/* NOTE:  doesn't use SVF-specified state paths */
+			jtag_add_plain_ir_scan(field.num_bits,
+					field.out_value,
+					field.in_value,
+					svf_para.ir_end_state);
+		}
+
+		svf_buffer_index += (i + 7) >> 3;
+	}
+
+	return ERROR_OK;
+}
+
+/*
+ * Run the JTAG queue after a command if it is due. @a may_execute is
+ * false for the commands that must not be split from the next one.
+ */
+static int svf_command_done(int command, bool may_execute)
+{
+	if (debug_level >= LOG_LVL_DEBUG) {
+		/* for convenient debugging, execute tap if possible */
+		if ((svf_buffer_index > 0) && may_execute) {
+			if (svf_execute_tap() != ERROR_OK)
+				return ERROR_FAIL;
+
+			/* output debug info */
+			if ((command == SIR) || (command == SDR))
+				SVF_BUF_LOG(DEBUG, svf_tdi_buffer, svf_check_tdo_para[0].bit_len, "TDO read");
+		}
+	} else {
+		/* for fast executing, execute tap once the batch is full, the
+		 * TDO checks of all its scans are done together afterwards */
+		if ((svf_buffer_index >= svf_batch_size) && may_execute)
+			return svf_execute_tap();
+	}
+
+	return ERROR_OK;
+}
+
 static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
 {
 	char *argus[256], command;
@@ -993,7 +1336,6 @@ static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
 	/* for XXR */
 	struct svf_xxr_para *xxr_para_tmp;
 	uint8_t **pbuffer_tmp;
-	struct scan_field field;
 	/* for STATE */
 	tap_state_t *path = NULL, state;
 	/* flag padding commands skipped due to -tap command */
@@ -1099,20 +1441,7 @@ xxr_common:
 				LOG_ERROR("invalid parameter of %s", argus[0]);
 				return ERROR_FAIL;
 			}
-			i_tmp = xxr_para_tmp->len;
-			xxr_para_tmp->len = atoi(argus[1]);
-			/* If we are to enlarge the buffers, all parts of xxr_para_tmp
-			 * need to be freed */
-			if (i_tmp < xxr_para_tmp->len) {
-				free(xxr_para_tmp->tdi);
-				xxr_para_tmp->tdi = NULL;
-				free(xxr_para_tmp->tdo);
-				xxr_para_tmp->tdo = NULL;
-				free(xxr_para_tmp->mask);
-				xxr_para_tmp->mask = NULL;
-				free(xxr_para_tmp->smask);
-				xxr_para_tmp->smask = NULL;
-			}
+			i_tmp = svf_xxr_set_len(xxr_para_tmp, atoi(argus[1]));
 
 			LOG_DEBUG("\tlength = %d", xxr_para_tmp->len);
 			xxr_para_tmp->data_mask = 0;
@@ -1152,225 +1481,8 @@ xxr_common:
 				}
 				SVF_BUF_LOG(DEBUG, *pbuffer_tmp, xxr_para_tmp->len, argus[i]);
 			}
-			/* If a command changes the length of the last scan of the same type and the
-			 * MASK parameter is absent, */
-			/* the mask pattern used is all cares */
-			if (!(xxr_para_tmp->data_mask & XXR_MASK) && (i_tmp != xxr_para_tmp->len)) {
-				/* MASK not defined and length changed */
-				if (ERROR_OK !=
-				svf_adjust_array_length(&xxr_para_tmp->mask, i_tmp,
-					xxr_para_tmp->len)) {
-					LOG_ERROR("fail to adjust length of array");
-					return ERROR_FAIL;
-				}
-				buf_set_ones(xxr_para_tmp->mask, xxr_para_tmp->len);
-			}
-			/* If TDO is absent, no comparison is needed, set the mask to 0 */
-			if (!(xxr_para_tmp->data_mask & XXR_TDO)) {
-				if (!xxr_para_tmp->tdo) {
-					if (ERROR_OK !=
-					svf_adjust_array_length(&xxr_para_tmp->tdo, i_tmp,
-						xxr_para_tmp->len)) {
-						LOG_ERROR("fail to adjust length of array");
-						return ERROR_FAIL;
-					}
-				}
-				if (!xxr_para_tmp->mask) {
-					if (ERROR_OK !=
-					svf_adjust_array_length(&xxr_para_tmp->mask, i_tmp,
-						xxr_para_tmp->len)) {
-						LOG_ERROR("fail to adjust length of array");
-						return ERROR_FAIL;
-					}
-				}
-				memset(xxr_para_tmp->mask, 0, (xxr_para_tmp->len + 7) >> 3);
-			}
-			/* do scan if necessary */
-			if (command == SDR) {
-				/* check buffer size first, reallocate if necessary */
-				i = svf_para.hdr_para.len + svf_para.sdr_para.len +
-						svf_para.tdr_para.len;
-				if ((svf_buffer_size - svf_buffer_index) < ((i + 7) >> 3)) {
-					/* reallocate buffer */
-					if (svf_realloc_buffers(svf_buffer_index + ((i + 7) >> 3)) != ERROR_OK) {
-						LOG_ERROR("not enough memory");
-						return ERROR_FAIL;
-					}
-				}
-
-				/* assemble dr data */
-				i = 0;
-				buf_set_buf(svf_para.hdr_para.tdi,
-						0,
-						&svf_tdi_buffer[svf_buffer_index],
-						i,
-						svf_para.hdr_para.len);
-				i += svf_para.hdr_para.len;
-				buf_set_buf(svf_para.sdr_para.tdi,
-						0,
-						&svf_tdi_buffer[svf_buffer_index],
-						i,
-						svf_para.sdr_para.len);
-				i += svf_para.sdr_para.len;
-				buf_set_buf(svf_para.tdr_para.tdi,
-						0,
-						&svf_tdi_buffer[svf_buffer_index],
-						i,
-						svf_para.tdr_para.len);
-				i += svf_para.tdr_para.len;
-
-				/* add check data */
-				if (svf_para.sdr_para.data_mask & XXR_TDO) {
-					/* assemble dr mask data */
-					i = 0;
-					buf_set_buf(svf_para.hdr_para.mask,
-							0,
-							&svf_mask_buffer[svf_buffer_index],
-							i,
-							svf_para.hdr_para.len);
-					i += svf_para.hdr_para.len;
-					buf_set_buf(svf_para.sdr_para.mask,
-							0,
-							&svf_mask_buffer[svf_buffer_index],
-							i,
-							svf_para.sdr_para.len);
-					i += svf_para.sdr_para.len;
-					buf_set_buf(svf_para.tdr_para.mask,
-							0,
-							&svf_mask_buffer[svf_buffer_index],
-							i,
-							svf_para.tdr_para.len);
-
-					/* assemble dr check data */
-					i = 0;
-					buf_set_buf(svf_para.hdr_para.tdo,
-							0,
-							&svf_tdo_buffer[svf_buffer_index],
-							i,
-							svf_para.hdr_para.len);
-					i += svf_para.hdr_para.len;
-					buf_set_buf(svf_para.sdr_para.tdo,
-							0,
-							&svf_tdo_buffer[svf_buffer_index],
-							i,
-							svf_para.sdr_para.len);
-					i += svf_para.sdr_para.len;
-					buf_set_buf(svf_para.tdr_para.tdo,
-							0,
-							&svf_tdo_buffer[svf_buffer_index],
-							i,
-							svf_para.tdr_para.len);
-					i += svf_para.tdr_para.len;
-
-					svf_add_check_para(1, svf_buffer_index, i);
-				} else
-					svf_add_check_para(0, svf_buffer_index, i);
-				field.num_bits = i;
-				field.out_value = &svf_tdi_buffer[svf_buffer_index];
-				field.in_value = (xxr_para_tmp->data_mask & XXR_TDO) ? &svf_tdi_buffer[svf_buffer_index] : NULL;
-				if (!svf_nil) {
-					/* NOTE:  doesn't use SVF-specified state paths */
-					jtag_add_plain_dr_scan(field.num_bits,
-							field.out_value,
-							field.in_value,
-							svf_para.dr_end_state);
-				}
-
-				if (svf_addcycles)
-					jtag_add_clocks(svf_addcycles);
-
-				svf_buffer_index += (i + 7) >> 3;
-			} else if (command == SIR) {
-				/* check buffer size first, reallocate if necessary */
-				i = svf_para.hir_para.len + svf_para.sir_para.len +
-						svf_para.tir_para.len;
-				if ((svf_buffer_size - svf_buffer_index) < ((i + 7) >> 3)) {
-					if (svf_realloc_buffers(svf_buffer_index + ((i + 7) >> 3)) != ERROR_OK) {
-						LOG_ERROR("not enough memory");
-						return ERROR_FAIL;
-					}
-				}
-
-				/* assemble ir data */
-				i = 0;
-				buf_set_buf(svf_para.hir_para.tdi,
-						0,
-						&svf_tdi_buffer[svf_buffer_index],
-						i,
-						svf_para.hir_para.len);
-				i += svf_para.hir_para.len;
-				buf_set_buf(svf_para.sir_para.tdi,
-						0,
-						&svf_tdi_buffer[svf_buffer_index],
-						i,
-						svf_para.sir_para.len);
-				i += svf_para.sir_para.len;
-				buf_set_buf(svf_para.tir_para.tdi,
-						0,
-						&svf_tdi_buffer[svf_buffer_index],
-						i,
-						svf_para.tir_para.len);
-				i += svf_para.tir_para.len;
-
-				/* add check data */
-				if (svf_para.sir_para.data_mask & XXR_TDO) {
-					/* assemble dr mask data */
-					i = 0;
-					buf_set_buf(svf_para.hir_para.mask,
-							0,
-							&svf_mask_buffer[svf_buffer_index],
-							i,
-							svf_para.hir_para.len);
-					i += svf_para.hir_para.len;
-					buf_set_buf(svf_para.sir_para.mask,
-							0,
-							&svf_mask_buffer[svf_buffer_index],
-							i,
-							svf_para.sir_para.len);
-					i += svf_para.sir_para.len;
-					buf_set_buf(svf_para.tir_para.mask,
-							0,
-							&svf_mask_buffer[svf_buffer_index],
-							i,
-							svf_para.tir_para.len);
-
-					/* assemble dr check data */
-					i = 0;
-					buf_set_buf(svf_para.hir_para.tdo,
-							0,
-							&svf_tdo_buffer[svf_buffer_index],
-							i,
-							svf_para.hir_para.len);
-					i += svf_para.hir_para.len;
-					buf_set_buf(svf_para.sir_para.tdo,
-							0,
-							&svf_tdo_buffer[svf_buffer_index],
-							i,
-							svf_para.sir_para.len);
-					i += svf_para.sir_para.len;
-					buf_set_buf(svf_para.tir_para.tdo,
-							0,
-							&svf_tdo_buffer[svf_buffer_index],
-							i,
-							svf_para.tir_para.len);
-					i += svf_para.tir_para.len;
-
-					svf_add_check_para(1, svf_buffer_index, i);
-				} else
-					svf_add_check_para(0, svf_buffer_index, i);
-				field.num_bits = i;
-				field.out_value = &svf_tdi_buffer[svf_buffer_index];
-				field.in_value = (xxr_para_tmp->data_mask & XXR_TDO) ? &svf_tdi_buffer[svf_buffer_index] : NULL;
-				if (!svf_nil) {
-					/* NOTE:  doesn't use SVF-specified state paths */
-					jtag_add_plain_ir_scan(field.num_bits,
-							field.out_value,
-							field.in_value,
-							svf_para.ir_end_state);
-				}
-
-				svf_buffer_index += (i + 7) >> 3;
-			}
+			if (svf_xxr_execute(command, xxr_para_tmp, i_tmp) != ERROR_OK)
+				return ERROR_FAIL;
 			break;
 		case PIO:
 		case PIOMAP:
@@ -1604,38 +1716,464 @@ xxr_common:
 			LOG_USER("(Above Padding command skipped, as per -tap argument)");
 	}
 
-	if (debug_level >= LOG_LVL_DEBUG) {
-		/* for convenient debugging, execute tap if possible */
-		if ((svf_buffer_index > 0) &&
-				(((command != STATE) && (command != RUNTEST)) ||
-						((command == STATE) && (num_of_argu == 2)))) {
-			if (svf_execute_tap() != ERROR_OK)
+	return svf_command_done(command, ((command != STATE) && (command != RUNTEST)) ||
+			((command == STATE) && (num_of_argu == 2)));
+}
+
+/*
+ * Compiled SVF
+ *
+ * "svf compile" parses a SVF file once and stores each command as a
+ * record, with the TDI, TDO, MASK and SMASK sections of the XXR commands
+ * already converted to binary. Replaying such a file skips the line
+ * reading, the tokenizing and the hex conversion of the scan data, which
+ * is nearly all of the parsing time for large files.
+ *
+ * All values are little endian:
+ *	header:	magic (8 bytes), number of lines of the SVF file (u32)
+ *	record:	kind (u8), SVF line number (u32), then
+ *		SVF_BINARY_TEXT: length (u32) and the normalized command
+ *		SVF_BINARY_XXR: command (u8), data_mask (u8), length in bits (u32)
+ *			and one section per bit set in data_mask, in TDI, TDO, MASK,
+ *			SMASK order, each of DIV_ROUND_UP(length, 8) bytes
+ */
+#define SVF_BINARY_MAGIC		"OCDSVFB1"
+#define SVF_BINARY_MAGIC_SIZE	8
+#define SVF_BINARY_HEADER_SIZE	(SVF_BINARY_MAGIC_SIZE + 4)
+#define SVF_BINARY_TEXT			0
+#define SVF_BINARY_XXR			1
+
+static const int svf_xxr_sections[] = { XXR_TDI, XXR_TDO, XXR_MASK, XXR_SMASK };
+
+struct svf_binary {
+	struct fileio *fileio;
+	uint8_t *buffer;		/* file contents if the file could not be mapped */
+	const uint8_t *data;	/* NULL if no compiled file is open */
+	size_t size;
+	size_t pos;
+
+	/* current record, if it is an XXR one */
+	bool xxr;
+	int command;
+	int data_mask;
+	int len;
+	const uint8_t *sections;
+};
+
+static struct svf_binary svf_binary;
+
+static bool svf_is_binary(FILE *fd)
+{
+	char magic[SVF_BINARY_MAGIC_SIZE];
+	bool binary = fread(magic, 1, sizeof(magic), fd) == sizeof(magic) &&
+		!memcmp(magic, SVF_BINARY_MAGIC, sizeof(magic));
+
+	rewind(fd);
+	return binary;
+}
+
+static int svf_binary_open(const char *filename)
+{
+	struct svf_binary *b = &svf_binary;
+	size_t read_bytes;
+
+	int retval = fileio_open(&b->fileio, filename, FILEIO_READ, FILEIO_BINARY);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = fileio_size(b->fileio, &b->size);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (fileio_map(b->fileio, &b->data) != ERROR_OK) {
+		b->buffer = malloc(b->size);
+		if (!b->buffer) {
+			LOG_ERROR("not enough memory");
+			return ERROR_FAIL;
+		}
+		retval = fileio_read(b->fileio, b->size, b->buffer, &read_bytes);
+		if (retval != ERROR_OK)
+			return retval;
+		if (read_bytes != b->size)
+			return ERROR_FILEIO_OPERATION_FAILED;
+		b->data = b->buffer;
+	}
+
+	if (b->size < SVF_BINARY_HEADER_SIZE) {
+		b->data = NULL;
+		return ERROR_FAIL;
+	}
+
+	svf_total_lines = le_to_h_u32(b->data + SVF_BINARY_MAGIC_SIZE);
+	b->pos = SVF_BINARY_HEADER_SIZE;
+
+	return ERROR_OK;
+}
+
+static void svf_binary_close(void)
+{
+	struct svf_binary *b = &svf_binary;
+
+	if (b->fileio)
+		fileio_close(b->fileio);
+	free(b->buffer);
+	memset(b, 0, sizeof(*b));
+}
+
+static bool svf_binary_is_open(void)
+{
+	return !!svf_binary.data;
+}
+
+static bool svf_binary_at_end(void)
+{
+	return svf_binary.pos == svf_binary.size;
+}
+
+static bool svf_is_xxr_command(int command)
+{
+	switch (command) {
+	case HDR:
+	case HIR:
+	case TDR:
+	case TIR:
+	case SDR:
+	case SIR:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* Make svf_read_line, which is logged for each command, hold @a len bytes */
+static int svf_binary_reserve_line(size_t len)
+{
+	if (svf_read_line_size < len) {
+		char *line = realloc(svf_read_line, len);
+		if (!line) {
+			LOG_ERROR("not enough memory");
+			return ERROR_FAIL;
+		}
+		svf_read_line = line;
+		svf_read_line_size = len;
+	}
+	return ERROR_OK;
+}
+
+static int svf_read_command_from_binary(void)
+{
+	struct svf_binary *b = &svf_binary;
+	size_t left = b->size - b->pos;
+	const uint8_t *p = b->data + b->pos;
+
+	if (left < 5)
+		return ERROR_FAIL;
+
+	unsigned int kind = p[0];
+	svf_line_number = le_to_h_u32(p + 1);
+	p += 5;
+	left -= 5;
+
+	if (kind == SVF_BINARY_TEXT) {
+		if (left < 4)
+			return ERROR_FAIL;
+		uint32_t len = le_to_h_u32(p);
+		if (left - 4 < len)
+			return ERROR_FAIL;
+
+		/* svf_run_command() modifies the string, use a copy */
+		if (svf_command_buffer_size < len + 1) {
+			char *buf = realloc(svf_command_buffer, len + 1);
+			if (!buf) {
+				LOG_ERROR("not enough memory");
 				return ERROR_FAIL;
+			}
+			svf_command_buffer = buf;
+			svf_command_buffer_size = len + 1;
+		}
+		memcpy(svf_command_buffer, p + 4, len);
+		svf_command_buffer[len] = '\0';
 
-			/* output debug info */
-			if ((command == SIR) || (command == SDR))
-				SVF_BUF_LOG(DEBUG, svf_tdi_buffer, svf_check_tdo_para[0].bit_len, "TDO read");
+		if (svf_binary_reserve_line(len + 3) != ERROR_OK)
+			return ERROR_FAIL;
+		sprintf(svf_read_line, "%s;\n", svf_command_buffer);
+
+		b->xxr = false;
+		b->pos += 5 + 4 + len;
+		return ERROR_OK;
+	}
+
+	if (kind != SVF_BINARY_XXR || left < 6)
+		return ERROR_FAIL;
+
+	b->command = p[0];
+	b->data_mask = p[1];
+	uint32_t len = le_to_h_u32(p + 2);
+	if (!svf_is_xxr_command(b->command) || (b->data_mask & ~0xf) || len > INT_MAX)
+		return ERROR_FAIL;
+	b->xxr = true;
+	b->len = len;
+	b->sections = p + 6;
+
+	uint64_t size = 0;
+	for (unsigned int i = 0; i < ARRAY_SIZE(svf_xxr_sections); i++)
+		if (b->data_mask & svf_xxr_sections[i])
+			size += DIV_ROUND_UP(len, 8);
+	if (left - 6 < size)
+		return ERROR_FAIL;
+
+	if (svf_binary_reserve_line(32) != ERROR_OK)
+		return ERROR_FAIL;
+	sprintf(svf_read_line, "%s %d;\n", svf_command_name[b->command], b->len);
+
+	b->pos += 5 + 6 + size;
+	return ERROR_OK;
+}
+
+/* counterpart of svf_run_command() for the records of a compiled file */
+static int svf_run_binary_command(struct command_context *cmd_ctx)
+{
+	struct svf_binary *b = &svf_binary;
+	struct svf_xxr_para *para;
+
+	if (!b->xxr)
+		return svf_run_command(cmd_ctx, svf_command_buffer);
+
+	switch (b->command) {
+	case HDR:
+		para = &svf_para.hdr_para;
+		break;
+	case HIR:
+		para = &svf_para.hir_para;
+		break;
+	case TDR:
+		para = &svf_para.tdr_para;
+		break;
+	case TIR:
+		para = &svf_para.tir_para;
+		break;
+	case SDR:
+		para = &svf_para.sdr_para;
+		break;
+	default:
+		para = &svf_para.sir_para;
+		break;
+	}
+
+	if (svf_tap_is_specified && b->command != SDR && b->command != SIR) {
+		if (!svf_quiet)
+			LOG_USER("(Above Padding command skipped, as per -tap argument)");
+		return svf_command_done(b->command, true);
+	}
+
+	uint8_t **buffers[] = { &para->tdi, &para->tdo, &para->mask, &para->smask };
+	const uint8_t *data = b->sections;
+	size_t bytes = DIV_ROUND_UP(b->len, 8);
+	int orig_len = svf_xxr_set_len(para, b->len);
+
+	LOG_DEBUG("\tlength = %d", para->len);
+	para->data_mask = b->data_mask;
+	for (unsigned int i = 0; i < ARRAY_SIZE(svf_xxr_sections); i++) {
+		if (!(b->data_mask & svf_xxr_sections[i]))
+			continue;
+		if (svf_adjust_array_length(buffers[i], orig_len, para->len) != ERROR_OK) {
+			LOG_ERROR("fail to adjust length of array");
+			return ERROR_FAIL;
 		}
-	} else {
-		/* for fast executing, execute tap if necessary */
-		/* half of the buffer is for the next command */
-		if (((svf_buffer_index >= SVF_MAX_BUFFER_SIZE_TO_COMMIT) ||
-				(svf_check_tdo_para_index >= SVF_CHECK_TDO_PARA_SIZE / 2)) &&
-				(((command != STATE) && (command != RUNTEST)) ||
-						((command == STATE) && (num_of_argu == 2))))
-			return svf_execute_tap();
+		memcpy(*buffers[i], data, bytes);
+		data += bytes;
 	}
 
+	if (svf_xxr_execute(b->command, para, orig_len) != ERROR_OK)
+		return ERROR_FAIL;
+
+	return svf_command_done(b->command, true);
+}
+
+static int svf_fwrite(FILE *fd, const void *data, size_t size)
+{
+	if (fwrite(data, 1, size, fd) != size) {
+		LOG_ERROR("fail to write compiled svf file");
+		return ERROR_FAIL;
+	}
 	return ERROR_OK;
 }
 
+/* Store the command in svf_command_buffer as a record of a compiled file */
+static int svf_compile_command(FILE *out)
+{
+	char *argus[256];
+	int num_of_argu = 0;
+	uint8_t *sections[ARRAY_SIZE(svf_xxr_sections)] = { NULL };
+	uint8_t record[5 + 6];
+	int retval = ERROR_FAIL;
+
+	/* svf_parse_cmd_string() modifies the string, keep the original */
+	char *str = strdup(svf_command_buffer);
+	if (!str) {
+		LOG_ERROR("not enough memory");
+		return ERROR_FAIL;
+	}
+
+	if (svf_parse_cmd_string(str, strlen(str), argus, &num_of_argu) != ERROR_OK)
+		goto out;
+
+	int command = svf_find_string_in_array(argus[0],
+			(char **)svf_command_name, ARRAY_SIZE(svf_command_name));
+
+	h_u32_to_le(record + 1, svf_line_number);
+
+	if (!svf_is_xxr_command(command)) {
+		/* checked when the record runs */
+		size_t len = strlen(svf_command_buffer);
+		record[0] = SVF_BINARY_TEXT;
+		h_u32_to_le(record + 5, len);
+		if (svf_fwrite(out, record, 5 + 4) == ERROR_OK)
+			retval = svf_fwrite(out, svf_command_buffer, len);
+		goto out;
+	}
+
+	/* XXR length [TDI (tdi)] [TDO (tdo)][MASK (mask)] [SMASK (smask)] */
+	if ((num_of_argu > 10) || (num_of_argu % 2)) {
+		LOG_ERROR("invalid parameter of %s", argus[0]);
+		goto out;
+	}
+
+	int len = atoi(argus[1]);
+	int data_mask = 0;
+	for (int i = 2; i < num_of_argu; i += 2) {
+		size_t arg_len = strlen(argus[i + 1]);
+		if (arg_len < 3 || argus[i + 1][0] != '(' || argus[i + 1][arg_len - 1] != ')') {
+			LOG_ERROR("data section error");
+			goto out;
+		}
+		argus[i + 1][arg_len - 1] = '\0';
+
+		unsigned int section;
+		if (!strcmp(argus[i], "TDI")) {
+			section = 0;
+		} else if (!strcmp(argus[i], "TDO")) {
+			section = 1;
+		} else if (!strcmp(argus[i], "MASK")) {
+			section = 2;
+		} else if (!strcmp(argus[i], "SMASK")) {
+			section = 3;
+		} else {
+			LOG_ERROR("unknown parameter: %s", argus[i]);
+			goto out;
+		}
+		if (svf_copy_hexstring_to_binary(&argus[i + 1][1], &sections[section], 0, len) != ERROR_OK) {
+			LOG_ERROR("fail to parse hex value");
+			goto out;
+		}
+		data_mask |= svf_xxr_sections[section];
+	}
+
+	record[0] = SVF_BINARY_XXR;
+	record[5] = command;
+	record[6] = data_mask;
+	h_u32_to_le(record + 7, len);
+	retval = svf_fwrite(out, record, sizeof(record));
+	for (unsigned int i = 0; i < ARRAY_SIZE(sections) && retval == ERROR_OK; i++)
+		if (sections[i])
+			retval = svf_fwrite(out, sections[i], DIV_ROUND_UP(len, 8));
+
+out:
+	for (unsigned int i = 0; i < ARRAY_SIZE(sections); i++)
+		free(sections[i]);
+	free(str);
+	return retval;
+}
+
+static int svf_compile(struct command_invocation *cmd, const char *in_name, const char *out_name)
+{
+	uint8_t header[SVF_BINARY_HEADER_SIZE];
+	int command_num = 0;
+	int ret;
+
+	svf_fd = fopen(in_name, "r");
+	if (!svf_fd) {
+		int err = errno;
+		command_print(CMD, "open(\"%s\"): %s", in_name, strerror(err));
+		return ERROR_FAIL;
+	}
+
+	FILE *out = fopen(out_name, "wb");
+	if (!out) {
+		int err = errno;
+		command_print(CMD, "open(\"%s\"): %s", out_name, strerror(err));
+		fclose(svf_fd);
+		svf_fd = NULL;
+		return ERROR_FAIL;
+	}
+
+	/* the line count is filled in at the end */
+	memcpy(header, SVF_BINARY_MAGIC, SVF_BINARY_MAGIC_SIZE);
+	h_u32_to_le(header + SVF_BINARY_MAGIC_SIZE, 0);
+	ret = svf_fwrite(out, header, sizeof(header));
+
+	svf_line_number = 0;
+	while (ret == ERROR_OK && svf_read_command_from_file(svf_fd) == ERROR_OK) {
+		ret = svf_compile_command(out);
+		if (ret != ERROR_OK)
+			LOG_ERROR("fail to compile command at line %d", svf_line_number);
+		command_num++;
+	}
+
+	if (ret == ERROR_OK) {
+		h_u32_to_le(header + SVF_BINARY_MAGIC_SIZE, svf_line_number);
+		if (fseek(out, 0, SEEK_SET) != 0)
+			ret = ERROR_FAIL;
+		else
+			ret = svf_fwrite(out, header, sizeof(header));
+	}
+	if (fclose(out) != 0)
+		ret = ERROR_FAIL;
+	if (ret != ERROR_OK)
+		remove(out_name);
+
+	fclose(svf_fd);
+	svf_fd = NULL;
+
+	free(svf_command_buffer);
+	svf_command_buffer = NULL;
+	svf_command_buffer_size = 0;
+
+	if (ret == ERROR_OK)
+		command_print(CMD, "svf file compiled, %d commands", command_num);
+	else
+		command_print(CMD, "svf file compile failed");
+
+	return ret;
+}
+
+COMMAND_HANDLER(handle_svf_compile_command)
+{
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	return svf_compile(CMD, CMD_ARGV[0], CMD_ARGV[1]);
+}
+
+static const struct command_registration svf_subcommand_handlers[] = {
+	{
+		.name = "compile",
+		.handler = handle_svf_compile_command,
+		.mode = COMMAND_EXEC,
+		.help = "Compiles a SVF file to a binary file that runs faster.",
+		.usage = "svf_file binary_file",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
 static const struct command_registration svf_command_handlers[] = {
 	{
 		.name = "svf",
 		.handler = handle_svf_command,
 		.mode = COMMAND_EXEC,
 		.help = "Runs a SVF file.",
-		.usage = "[-tap device.tap] [-quiet] [-nil] [-progress] [-ignore_error] [-noreset] [-addcycles numcycles] file",
+		.usage = "[-tap device.tap] [-quiet] [-nil] [-progress] [-ignore_error] [-noreset] [-addcycles numcycles] [-batch_size kbytes] file",
+		.chain = svf_subcommand_handlers,
 	},
 	COMMAND_REGISTRATION_DONE
 };
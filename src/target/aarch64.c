@@ -321,40 +321,121 @@ static int aarch64_wait_halt_one(struct target *target)
 	return retval;
 }
 
+/*
+ * Run the DAP queues of all PEs of an SMP group and of their CTIs. They
+ * normally share one DAP, which is then only run once.
+ */
+static int aarch64_smp_dap_run(struct target *target)
+{
+	struct adiv5_dap *last = NULL;
+	struct target_list *head;
+	int retval = ERROR_OK;
+
+	foreach_smp_target(head, target->smp_targets) {
+		struct target *curr = head->target;
+		struct armv8_common *armv8 = target_to_armv8(curr);
+
+		if (!target_was_examined(curr))
+			continue;
+
+		struct adiv5_dap *daps[] = { armv8->debug_ap->dap, arm_cti_dap(armv8->cti) };
+		for (unsigned int i = 0; i < ARRAY_SIZE(daps); i++) {
+			if (daps[i] == last)
+				continue;
+			int ret = dap_run(daps[i]);
+			if (retval == ERROR_OK)
+				retval = ret;
+			last = daps[i];
+		}
+	}
+
+	return retval;
+}
+
+static unsigned int aarch64_smp_count(struct target *target)
+{
+	struct target_list *head;
+	unsigned int n = 0;
+
+	foreach_smp_target(head, target->smp_targets)
+		n++;
+
+	return n;
+}
+
+static bool aarch64_smp_halt_candidate(struct target *curr, struct target *target, bool exc_target)
+{
+	if (exc_target && curr == target)
+		return false;
+
+	return target_was_examined(curr) && curr->state == TARGET_RUNNING;
+}
+
 static int aarch64_prepare_halt_smp(struct target *target, bool exc_target, struct target **p_first)
 {
 	int retval = ERROR_OK;
 	struct target_list *head;
 	struct target *first = NULL;
+	unsigned int i;
 
 	LOG_DEBUG("target %s exc %i", target_name(target), exc_target);
 
+	/* CTIGATE and EDSCR of each PE, read in one go and written back in one go */
+	uint32_t *regs = calloc(2 * aarch64_smp_count(target), sizeof(*regs));
+	if (!regs) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	i = 0;
 	foreach_smp_target(head, target->smp_targets) {
 		struct target *curr = head->target;
 		struct armv8_common *armv8 = target_to_armv8(curr);
 
-		if (exc_target && curr == target)
-			continue;
-		if (!target_was_examined(curr))
-			continue;
-		if (curr->state != TARGET_RUNNING)
+		if (aarch64_smp_halt_candidate(curr, target, exc_target)) {
+			retval = arm_cti_queue_read_reg(armv8->cti, CTI_GATE, &regs[2 * i]);
+			if (retval == ERROR_OK)
+				retval = mem_ap_read_u32(armv8->debug_ap,
+						armv8->debug_base + CPUV8_DBG_DSCR, &regs[2 * i + 1]);
+			if (retval != ERROR_OK)
+				break;
+		}
+		i++;
+	}
+	if (retval == ERROR_OK)
+		retval = aarch64_smp_dap_run(target);
+
+	i = 0;
+	foreach_smp_target(head, target->smp_targets) {
+		struct target *curr = head->target;
+		struct armv8_common *armv8 = target_to_armv8(curr);
+
+		if (retval != ERROR_OK)
+			break;
+		if (!aarch64_smp_halt_candidate(curr, target, exc_target)) {
+			i++;
 			continue;
+		}
 
 		/* HACK: mark this target as prepared for halting */
 		curr->debug_reason = DBG_REASON_DBGRQ;
 
 		/* open the gate for channel 0 to let HALT requests pass to the CTM */
-		retval = arm_cti_ungate_channel(armv8->cti, 0);
+		retval = arm_cti_queue_write_reg(armv8->cti, CTI_GATE, regs[2 * i] | CTI_CHNL(0));
 		if (retval == ERROR_OK)
-			retval = aarch64_set_dscr_bits(curr, DSCR_HDE, DSCR_HDE);
-		if (retval != ERROR_OK)
-			break;
+			retval = mem_ap_write_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DSCR, regs[2 * i + 1] | DSCR_HDE);
 
 		LOG_DEBUG("target %s prepared", target_name(curr));
 
 		if (!first)
 			first = curr;
+		i++;
 	}
+	if (retval == ERROR_OK)
+		retval = aarch64_smp_dap_run(target);
+
+	free(regs);
 
 	if (p_first) {
 		if (exc_target && first)
@@ -413,29 +494,48 @@ static int aarch64_halt_smp(struct target *target, bool exc_target)
 	if (retval != ERROR_OK)
 		return retval;
 
-	/* wait for all PEs to halt */
+	/* wait for all PEs to halt, polling all PRSRs in one DAP transaction */
+	uint32_t *prsr = calloc(aarch64_smp_count(target), sizeof(*prsr));
+	if (!prsr) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
 	int64_t then = timeval_ms();
 	for (;;) {
-		bool all_halted = true;
+		struct target *not_halted = NULL;
 		struct target_list *head;
-		struct target *curr;
+		unsigned int i = 0;
 
 		foreach_smp_target(head, target->smp_targets) {
-			int halted;
+			struct target *curr = head->target;
+			struct armv8_common *armv8 = target_to_armv8(curr);
 
-			curr = head->target;
+			if (target_was_examined(curr)) {
+				retval = mem_ap_read_u32(armv8->debug_ap,
+						armv8->debug_base + CPUV8_DBG_PRSR, &prsr[i]);
+				if (retval != ERROR_OK)
+					break;
+			}
+			i++;
+		}
+		if (retval == ERROR_OK)
+			retval = aarch64_smp_dap_run(target);
+		if (retval != ERROR_OK)
+			break;
 
-			if (!target_was_examined(curr))
-				continue;
+		i = 0;
+		foreach_smp_target(head, target->smp_targets) {
+			struct target *curr = head->target;
 
-			retval = aarch64_check_state_one(curr, PRSR_HALT, PRSR_HALT, &halted, NULL);
-			if (retval != ERROR_OK || !halted) {
-				all_halted = false;
+			if (target_was_examined(curr) && !(prsr[i] & PRSR_HALT)) {
+				not_halted = curr;
 				break;
 			}
+			i++;
 		}
 
-		if (all_halted)
+		if (!not_halted)
 			break;
 
 		if (timeval_ms() > then + 1000) {
@@ -450,11 +550,12 @@ static int aarch64_halt_smp(struct target *target, bool exc_target)
 		 * cluster explicitly. So if we find that a core has not halted
 		 * yet, we trigger an explicit halt for the second cluster.
 		 */
-		retval = aarch64_halt_one(curr, HALT_LAZY);
+		retval = aarch64_halt_one(not_halted, HALT_LAZY);
 		if (retval != ERROR_OK)
 			break;
 	}
 
+	free(prsr);
 	return retval;
 }
 
@@ -1021,6 +1122,8 @@ static int aarch64_post_debug_entry(struct target *target)
 	enum arm_mode target_mode = ARM_MODE_ANY;
 	uint32_t instr;
 
+	arm_mmu_tlb_invalidate(&armv8->arm);
+
 	switch (armv8->arm.core_mode) {
 	case ARMV8_64_EL0T:
 		target_mode = ARMV8_64_EL1H;
@@ -2042,32 +2145,91 @@ static int aarch64_deassert_reset(struct target *target)
 	return ERROR_OK;
 }
 
-static int aarch64_write_cpu_memory_slow(struct target *target,
-	uint32_t size, uint32_t count, const uint8_t *buffer, uint32_t *dscr)
+/* Number of elements queued in one DAP transaction by the slow paths */
+#define AARCH64_DCC_QUEUE_DEPTH	64
+
+static uint32_t aarch64_store_opcode(struct armv8_common *armv8, uint32_t size)
+{
+	if (size == 1)
+		return armv8_opcode(armv8, ARMV8_OPC_STRB_IP);
+	else if (size == 2)
+		return armv8_opcode(armv8, ARMV8_OPC_STRH_IP);
+	else if (size == 4)
+		return armv8_opcode(armv8, ARMV8_OPC_STRW_IP);
+	else
+		return armv8_opcode(armv8, ARMV8_OPC_STRD_IP);
+}
+
+static uint32_t aarch64_load_opcode(struct armv8_common *armv8, uint32_t size)
+{
+	if (size == 1)
+		return armv8_opcode(armv8, ARMV8_OPC_LDRB_IP);
+	else if (size == 2)
+		return armv8_opcode(armv8, ARMV8_OPC_LDRH_IP);
+	else if (size == 4)
+		return armv8_opcode(armv8, ARMV8_OPC_LDRW_IP);
+	else
+		return armv8_opcode(armv8, ARMV8_OPC_LDRD_IP);
+}
+
+/*
+ * Check the sticky flags after a queued DCC sequence. An ITR or DTR
+ * overrun means the core did not keep up with the debugger; the flags
+ * are cleared, the DTRs drained and *overrun is set so that the caller
+ * can redo the chunk one instruction at a time.
+ */
+static int aarch64_check_dcc_queue(struct target *target, uint32_t dscr, bool *overrun)
 {
 	struct armv8_common *armv8 = target_to_armv8(target);
 	struct arm_dpm *dpm = &armv8->dpm;
-	struct arm *arm = &armv8->arm;
+	uint32_t value;
 	int retval;
 
-	if (size > 4 && arm->core_state != ARM_STATE_AARCH64) {
-		LOG_ERROR("memory write sizes greater than 4 bytes is only supported for AArch64 state");
-		return ERROR_FAIL;
-	}
+	dpm->dscr = dscr;
+	*overrun = false;
 
-	armv8_reg_current(arm, 1)->dirty = true;
+	if (dscr & (DSCR_ITO | DSCR_TXU | DSCR_RTO)) {
+		LOG_DEBUG("DCC overrun, dscr = 0x%08" PRIx32 ", retrying without queueing", dscr);
+		*overrun = true;
 
-	/* change DCC to normal mode if necessary */
-	if (*dscr & DSCR_MA) {
-		*dscr &= ~DSCR_MA;
-		retval =  mem_ap_write_atomic_u32(armv8->debug_ap,
-				armv8->debug_base + CPUV8_DBG_DSCR, *dscr);
+		retval = mem_ap_write_atomic_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_DRCR, DRCR_CSE);
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_atomic_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DSCR, &dscr);
 		if (retval != ERROR_OK)
 			return retval;
+
+		dpm->dscr = dscr;
+		if (dscr & DSCR_DTR_RX_FULL) {
+			retval = dpm->instr_execute(dpm, ARMV8_MRS(SYSTEM_DBG_DTRRX_EL0, 1));
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		if (dscr & DSCR_DTR_TX_FULL)
+			return mem_ap_read_atomic_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DTRTX, &value);
+		return ERROR_OK;
+	}
+
+	if (dscr & DSCR_ERR) {
+		LOG_ERROR("DSCR.ERR=1 during memory access, dscr = 0x%08" PRIx32, dscr);
+		armv8_dpm_handle_exception(dpm, true);
+		return ERROR_FAIL;
 	}
 
+	return ERROR_OK;
+}
+
+static int aarch64_write_cpu_memory_polled(struct target *target,
+	uint32_t size, uint32_t count, const uint8_t *buffer)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+	struct arm_dpm *dpm = &armv8->dpm;
+	struct arm *arm = &armv8->arm;
+	int retval;
+
 	while (count) {
-		uint32_t opcode;
 		uint64_t data;
 
 		/* write the data to store into DTRRX (and DTRTX for 64-bit) */
@@ -2098,22 +2260,152 @@ static int aarch64_write_cpu_memory_slow(struct target *target,
 		if (retval != ERROR_OK)
 			return retval;
 
+		retval = dpm->instr_execute(dpm, aarch64_store_opcode(armv8, size));
+		if (retval != ERROR_OK)
+			return retval;
+
+		/* Advance */
+		buffer += size;
+		--count;
+	}
+
+	return ERROR_OK;
+}
+
+/*
+ * Same sequence as aarch64_write_cpu_memory_polled(), but all the DTR and
+ * ITR accesses are queued and sent in a single DAP transaction. The
+ * core executes each instruction long before the next DAP access lands,
+ * so EDSCR.ITE is only checked once at the end through the sticky flags.
+ * AArch64 state only, the ITR encoding differs in AArch32.
+ */
+static int aarch64_write_cpu_memory_queued(struct target *target,
+	uint32_t size, uint32_t count, const uint8_t *buffer, bool *overrun)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+	uint32_t opcode = aarch64_store_opcode(armv8, size);
+	uint32_t move = size <= 4 ? ARMV8_MRS(SYSTEM_DBG_DTRRX_EL0, 1)
+		: ARMV8_MRS(SYSTEM_DBG_DBGDTR_EL0, 1);
+	uint32_t dscr;
+	int retval = ERROR_OK;
+
+	for (uint32_t i = 0; i < count && retval == ERROR_OK; i++, buffer += size) {
+		uint64_t data;
+
 		if (size == 1)
-			opcode = armv8_opcode(armv8, ARMV8_OPC_STRB_IP);
+			data = *buffer;
 		else if (size == 2)
-			opcode = armv8_opcode(armv8, ARMV8_OPC_STRH_IP);
+			data = target_buffer_get_u16(target, buffer);
 		else if (size == 4)
-			opcode = armv8_opcode(armv8, ARMV8_OPC_STRW_IP);
+			data = target_buffer_get_u32(target, buffer);
 		else
-			opcode = armv8_opcode(armv8, ARMV8_OPC_STRD_IP);
+			data = target_buffer_get_u64(target, buffer);
+
+		retval = mem_ap_write_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_DTRRX, (uint32_t)data);
+		if (retval == ERROR_OK && size > 4)
+			retval = mem_ap_write_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DTRTX, (uint32_t)(data >> 32));
+		if (retval == ERROR_OK)
+			retval = mem_ap_write_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_ITR, move);
+		if (retval == ERROR_OK)
+			retval = mem_ap_write_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_ITR, opcode);
+	}
+	if (retval == ERROR_OK)
+		retval = mem_ap_read_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_DSCR, &dscr);
+	if (retval == ERROR_OK)
+		retval = dap_run(armv8->debug_ap->dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return aarch64_check_dcc_queue(target, dscr, overrun);
+}
+
+/*
+ * Split an access into a head up to the first word boundary, a body of
+ * aligned words for the DCC memory access mode and the remaining tail.
+ * X0 is post-incremented by both modes, so the three parts are issued
+ * back to back without reloading the address.
+ * Only byte and halfword accesses are split; the body is then read as
+ * words, which assumes little-endian data like mem_ap_read_buf_noincr().
+ */
+static void aarch64_plan_cpu_memory(struct target *target, uint64_t address,
+	uint32_t size, uint32_t count, uint32_t *head, uint32_t *words, uint32_t *tail)
+{
+	*head = 0;
+	*words = 0;
+	*tail = count;
 
-		retval = dpm->instr_execute(dpm, opcode);
+	if (size == 4 && (address % 4) == 0) {
+		*words = count;
+		*tail = 0;
+		return;
+	}
+
+	if (size > 2 || (address % size) != 0 || target->endianness != TARGET_LITTLE_ENDIAN)
+		return;
+
+	uint32_t head_bytes = (4 - (address % 4)) % 4;
+	uint64_t bytes = (uint64_t)size * count;
+
+	/* the body needs at least two words to pay for the mode switches */
+	if (bytes < head_bytes + 8)
+		return;
+
+	*head = head_bytes / size;
+	*words = (bytes - head_bytes) / 4;
+	*tail = count - *head - *words * (4 / size);
+}
+
+static int aarch64_write_cpu_memory_slow(struct target *target,
+	uint64_t address, uint32_t size, uint32_t count, const uint8_t *buffer,
+	uint32_t *dscr)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+	struct arm_dpm *dpm = &armv8->dpm;
+	struct arm *arm = &armv8->arm;
+	int retval;
+
+	if (size > 4 && arm->core_state != ARM_STATE_AARCH64) {
+		LOG_ERROR("memory write sizes greater than 4 bytes is only supported for AArch64 state");
+		return ERROR_FAIL;
+	}
+
+	armv8_reg_current(arm, 1)->dirty = true;
+
+	/* change DCC to normal mode if necessary */
+	if (*dscr & DSCR_MA) {
+		*dscr &= ~DSCR_MA;
+		retval =  mem_ap_write_atomic_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_DSCR, *dscr);
 		if (retval != ERROR_OK)
 			return retval;
+	}
 
-		/* Advance */
-		buffer += size;
-		--count;
+	if (arm->core_state != ARM_STATE_AARCH64)
+		return aarch64_write_cpu_memory_polled(target, size, count, buffer);
+
+	while (count) {
+		uint32_t n = MIN(count, AARCH64_DCC_QUEUE_DEPTH);
+		bool overrun;
+
+		retval = aarch64_write_cpu_memory_queued(target, size, n, buffer, &overrun);
+		if (retval == ERROR_OK && overrun) {
+			/* X0 advanced by an unknown amount, reload it */
+			retval = dpm->instr_write_data_dcc_64(dpm,
+					ARMV8_MRS(SYSTEM_DBG_DBGDTR_EL0, 0), address);
+			if (retval == ERROR_OK)
+				retval = aarch64_write_cpu_memory_polled(target, size, n, buffer);
+		}
+		if (retval != ERROR_OK)
+			return retval;
+
+		address += n * size;
+		buffer += n * size;
+		count -= n;
 	}
 
 	return ERROR_OK;
@@ -2207,10 +2499,22 @@ static int aarch64_write_cpu_memory(struct target *target,
 	if (retval != ERROR_OK)
 		return retval;
 
-	if (size == 4 && (address % 4) == 0)
-		retval = aarch64_write_cpu_memory_fast(target, count, buffer, &dscr);
-	else
-		retval = aarch64_write_cpu_memory_slow(target, size, count, buffer, &dscr);
+	uint32_t head, words, tail;
+	aarch64_plan_cpu_memory(target, address, size, count, &head, &words, &tail);
+
+	retval = ERROR_OK;
+	if (head) {
+		retval = aarch64_write_cpu_memory_slow(target, address, size, head, buffer, &dscr);
+		address += head * size;
+		buffer += head * size;
+	}
+	if (retval == ERROR_OK && words) {
+		retval = aarch64_write_cpu_memory_fast(target, words, buffer, &dscr);
+		address += words * 4;
+		buffer += words * 4;
+	}
+	if (retval == ERROR_OK && tail)
+		retval = aarch64_write_cpu_memory_slow(target, address, size, tail, buffer, &dscr);
 
 	if (retval != ERROR_OK) {
 		/* Unset DTR mode */
@@ -2239,46 +2543,32 @@ static int aarch64_write_cpu_memory(struct target *target,
 	return ERROR_OK;
 }
 
-static int aarch64_read_cpu_memory_slow(struct target *target,
-	uint32_t size, uint32_t count, uint8_t *buffer, uint32_t *dscr)
+static void aarch64_set_read_data(struct target *target, uint32_t size,
+	uint8_t *buffer, uint64_t data)
+{
+	if (size == 1)
+		*buffer = (uint8_t)data;
+	else if (size == 2)
+		target_buffer_set_u16(target, buffer, (uint16_t)data);
+	else if (size == 4)
+		target_buffer_set_u32(target, buffer, (uint32_t)data);
+	else
+		target_buffer_set_u64(target, buffer, data);
+}
+
+static int aarch64_read_cpu_memory_polled(struct target *target,
+	uint32_t size, uint32_t count, uint8_t *buffer)
 {
 	struct armv8_common *armv8 = target_to_armv8(target);
 	struct arm_dpm *dpm = &armv8->dpm;
 	struct arm *arm = &armv8->arm;
 	int retval;
 
-	if (size > 4 && arm->core_state != ARM_STATE_AARCH64) {
-		LOG_ERROR("memory read sizes greater than 4 bytes is only supported for AArch64 state");
-		return ERROR_FAIL;
-	}
-
-	armv8_reg_current(arm, 1)->dirty = true;
-
-	/* change DCC to normal mode (if necessary) */
-	if (*dscr & DSCR_MA) {
-		*dscr &= DSCR_MA;
-		retval =  mem_ap_write_atomic_u32(armv8->debug_ap,
-				armv8->debug_base + CPUV8_DBG_DSCR, *dscr);
-		if (retval != ERROR_OK)
-			return retval;
-	}
-
 	while (count) {
-		uint32_t opcode;
 		uint32_t lower;
 		uint32_t higher;
-		uint64_t data;
-
-		if (size == 1)
-			opcode = armv8_opcode(armv8, ARMV8_OPC_LDRB_IP);
-		else if (size == 2)
-			opcode = armv8_opcode(armv8, ARMV8_OPC_LDRH_IP);
-		else if (size == 4)
-			opcode = armv8_opcode(armv8, ARMV8_OPC_LDRW_IP);
-		else
-			opcode = armv8_opcode(armv8, ARMV8_OPC_LDRD_IP);
 
-		retval = dpm->instr_execute(dpm, opcode);
+		retval = dpm->instr_execute(dpm, aarch64_load_opcode(armv8, size));
 		if (retval != ERROR_OK)
 			return retval;
 
@@ -2304,16 +2594,7 @@ static int aarch64_read_cpu_memory_slow(struct target *target,
 		if (retval != ERROR_OK)
 			return retval;
 
-		data = (uint64_t)lower | (uint64_t)higher << 32;
-
-		if (size == 1)
-			*buffer = (uint8_t)data;
-		else if (size == 2)
-			target_buffer_set_u16(target, buffer, (uint16_t)data);
-		else if (size == 4)
-			target_buffer_set_u32(target, buffer, (uint32_t)data);
-		else
-			target_buffer_set_u64(target, buffer, data);
+		aarch64_set_read_data(target, size, buffer, (uint64_t)lower | (uint64_t)higher << 32);
 
 		/* Advance */
 		buffer += size;
@@ -2323,6 +2604,105 @@ static int aarch64_read_cpu_memory_slow(struct target *target,
 	return ERROR_OK;
 }
 
+/*
+ * Queued counterpart of aarch64_read_cpu_memory_polled(), see
+ * aarch64_write_cpu_memory_queued().
+ */
+static int aarch64_read_cpu_memory_queued(struct target *target,
+	uint32_t size, uint32_t count, uint8_t *buffer, bool *overrun)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+	uint32_t opcode = aarch64_load_opcode(armv8, size);
+	uint32_t move = size <= 4 ? ARMV8_MSR_GP(SYSTEM_DBG_DTRTX_EL0, 1)
+		: ARMV8_MSR_GP(SYSTEM_DBG_DBGDTR_EL0, 1);
+	uint32_t data[2 * AARCH64_DCC_QUEUE_DEPTH];
+	uint32_t dscr;
+	int retval = ERROR_OK;
+
+	for (uint32_t i = 0; i < count && retval == ERROR_OK; i++) {
+		retval = mem_ap_write_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_ITR, opcode);
+		if (retval == ERROR_OK)
+			retval = mem_ap_write_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_ITR, move);
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DTRTX, &data[2 * i]);
+		data[2 * i + 1] = 0;
+		if (retval == ERROR_OK && size > 4)
+			retval = mem_ap_read_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DTRRX, &data[2 * i + 1]);
+	}
+	if (retval == ERROR_OK)
+		retval = mem_ap_read_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_DSCR, &dscr);
+	if (retval == ERROR_OK)
+		retval = dap_run(armv8->debug_ap->dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = aarch64_check_dcc_queue(target, dscr, overrun);
+	if (retval != ERROR_OK || *overrun)
+		return retval;
+
+	for (uint32_t i = 0; i < count; i++, buffer += size)
+		aarch64_set_read_data(target, size, buffer,
+			(uint64_t)data[2 * i] | (uint64_t)data[2 * i + 1] << 32);
+
+	return ERROR_OK;
+}
+
+static int aarch64_read_cpu_memory_slow(struct target *target,
+	uint64_t address, uint32_t size, uint32_t count, uint8_t *buffer,
+	uint32_t *dscr)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+	struct arm_dpm *dpm = &armv8->dpm;
+	struct arm *arm = &armv8->arm;
+	int retval;
+
+	if (size > 4 && arm->core_state != ARM_STATE_AARCH64) {
+		LOG_ERROR("memory read sizes greater than 4 bytes is only supported for AArch64 state");
+		return ERROR_FAIL;
+	}
+
+	armv8_reg_current(arm, 1)->dirty = true;
+
+	/* change DCC to normal mode (if necessary) */
+	if (*dscr & DSCR_MA) {
+		*dscr &= ~DSCR_MA;
+		retval =  mem_ap_write_atomic_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_DSCR, *dscr);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	if (arm->core_state != ARM_STATE_AARCH64)
+		return aarch64_read_cpu_memory_polled(target, size, count, buffer);
+
+	while (count) {
+		uint32_t n = MIN(count, AARCH64_DCC_QUEUE_DEPTH);
+		bool overrun;
+
+		retval = aarch64_read_cpu_memory_queued(target, size, n, buffer, &overrun);
+		if (retval == ERROR_OK && overrun) {
+			/* X0 advanced by an unknown amount, reload it */
+			retval = dpm->instr_write_data_dcc_64(dpm,
+					ARMV8_MRS(SYSTEM_DBG_DBGDTR_EL0, 0), address);
+			if (retval == ERROR_OK)
+				retval = aarch64_read_cpu_memory_polled(target, size, n, buffer);
+		}
+		if (retval != ERROR_OK)
+			return retval;
+
+		address += n * size;
+		buffer += n * size;
+		count -= n;
+	}
+
+	return ERROR_OK;
+}
+
 static int aarch64_read_cpu_memory_fast(struct target *target,
 	uint32_t count, uint8_t *buffer, uint32_t *dscr)
 {
@@ -2450,10 +2830,22 @@ static int aarch64_read_cpu_memory(struct target *target,
 	if (retval != ERROR_OK)
 		return retval;
 
-	if (size == 4 && (address % 4) == 0)
-		retval = aarch64_read_cpu_memory_fast(target, count, buffer, &dscr);
-	else
-		retval = aarch64_read_cpu_memory_slow(target, size, count, buffer, &dscr);
+	uint32_t head, words, tail;
+	aarch64_plan_cpu_memory(target, address, size, count, &head, &words, &tail);
+
+	retval = ERROR_OK;
+	if (head) {
+		retval = aarch64_read_cpu_memory_slow(target, address, size, head, buffer, &dscr);
+		address += head * size;
+		buffer += head * size;
+	}
+	if (retval == ERROR_OK && words) {
+		retval = aarch64_read_cpu_memory_fast(target, words, buffer, &dscr);
+		address += words * 4;
+		buffer += words * 4;
+	}
+	if (retval == ERROR_OK && tail)
+		retval = aarch64_read_cpu_memory_slow(target, address, size, tail, buffer, &dscr);
 
 	if (dscr & DSCR_MA) {
 		dscr &= ~DSCR_MA;
@@ -2483,13 +2875,34 @@ static int aarch64_read_cpu_memory(struct target *target,
 	return ERROR_OK;
 }
 
+/* Write the dirty data cache lines back and invalidate them before a
+ * bulk AP transfer, the bus does not see the core caches */
+static int aarch64_bulk_ap_prepare(struct target *target)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+	struct armv8_cache_common *cache = &armv8->armv8_mmu.armv8_cache;
+
+	if (!cache->d_u_cache_enabled || !cache->flush_all_data_cache)
+		return ERROR_OK;
+
+	return cache->flush_all_data_cache(target);
+}
+
 static int aarch64_read_phys_memory(struct target *target,
 	target_addr_t address, uint32_t size,
 	uint32_t count, uint8_t *buffer)
 {
+	struct arm *arm = target_to_arm(target);
 	int retval = ERROR_COMMAND_SYNTAX_ERROR;
 
 	if (count && buffer) {
+		if (arm_bulk_ap_use(arm, size, count)) {
+			retval = aarch64_bulk_ap_prepare(target);
+			if (retval != ERROR_OK)
+				return retval;
+			return mem_ap_read_buf(arm->bulk_ap, buffer, size, count, address);
+		}
+
 		/* read memory through APB-AP */
 		retval = aarch64_mmu_modify(target, 0);
 		if (retval != ERROR_OK)
@@ -2523,6 +2936,8 @@ static int aarch64_write_phys_memory(struct target *target,
 	target_addr_t address, uint32_t size,
 	uint32_t count, const uint8_t *buffer)
 {
+	struct armv8_common *armv8 = target_to_armv8(target);
+	struct arm *arm = &armv8->arm;
 	int retval = ERROR_COMMAND_SYNTAX_ERROR;
 
 	if (count && buffer) {
@@ -2530,6 +2945,20 @@ static int aarch64_write_phys_memory(struct target *target,
 		retval = aarch64_mmu_modify(target, 0);
 		if (retval != ERROR_OK)
 			return retval;
+
+		if (arm_bulk_ap_use(arm, size, count)) {
+			retval = aarch64_bulk_ap_prepare(target);
+			if (retval != ERROR_OK)
+				return retval;
+			retval = mem_ap_write_buf(arm->bulk_ap, buffer, size, count, address);
+			if (retval != ERROR_OK)
+				return retval;
+			/* the data written may be code, the MMU is off so VA is PA */
+			if (armv8->armv8_mmu.armv8_cache.i_cache_enabled)
+				retval = armv8_cache_i_inner_inval_virt(armv8, address, size * count);
+			return retval;
+		}
+
 		return aarch64_write_cpu_memory(target, address, size, count, buffer);
 	}
 
@@ -2731,6 +3160,10 @@ static int aarch64_examine_first(struct target *target)
 	target->state = TARGET_UNKNOWN;
 	target->debug_reason = DBG_REASON_NOTHALTED;
 	aarch64->isrmasking_mode = AARCH64_ISRMASK_ON;
+	retval = arm_bulk_ap_setup(target);
+	if (retval != ERROR_OK)
+		return retval;
+
 	target_set_examined(target);
 	return ERROR_OK;
 }
@@ -2833,6 +3266,7 @@ static void aarch64_deinit_target(struct target *target)
 
 	if (armv8->debug_ap)
 		dap_put_ap(armv8->debug_ap);
+	arm_bulk_ap_free(&armv8->arm);
 
 	armv8_free_reg_cache(target);
 	free(aarch64->brp_list);
@@ -3120,6 +3554,7 @@ COMMAND_HANDLER(aarch64_mcrmrc_command)
 		/* NOTE: parameters reordered! */
 		/* ARMV4_5_MCR(cpnum, op1, 0, crn, crm, op2) */
 		int retval = arm->mcr(target, cpnum, op1, op2, crn, crm, value);
+		arm_mmu_tlb_invalidate(arm);
 		if (retval != ERROR_OK)
 			return retval;
 	} else {
@@ -3182,6 +3617,9 @@ static const struct command_registration aarch64_exec_command_handlers[] = {
 	{
 		.chain = smp_command_handlers,
 	},
+	{
+		.chain = arm_bulk_ap_command_handlers,
+	},
 
 
 	COMMAND_REGISTRATION_DONE
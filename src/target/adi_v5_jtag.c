@@ -641,6 +641,11 @@ static int jtagdp_overrun_check(struct adiv5_dap *dap)
 			} else
 				break;
 		}
+
+		/* The replay restored SELECT and then re-issued every SELECT
+		 * write of the journal, so the cached value matches the DP again */
+		if (retval == ERROR_OK && !list_empty(&replay_list))
+			dap->select_valid = true;
 	}
 
  done:
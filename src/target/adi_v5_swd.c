@@ -36,9 +36,11 @@
 
 #include "arm.h"
 #include "arm_adi_v5.h"
+#include <helper/perf.h>
 #include <helper/time_support.h>
 
 #include <transport/transport.h>
+#include <jtag/adapter.h>
 #include <jtag/interface.h>
 
 #include <jtag/swd.h>
@@ -46,10 +48,16 @@
 /* for debug, set do_sync to true to force synchronous transfers */
 static bool do_sync;
 
+/* Number of transfers queued since the last run, for the adapter statistics */
+static unsigned int swd_queued_transfers;
+
 static struct adiv5_dap *swd_multidrop_selected_dap;
 
 static bool swd_multidrop_in_swd_state;
 
+/* Incremented on each failed run: all the multidrop DPs have to be checked again */
+static unsigned int swd_multidrop_check_gen = 1;
+
 
 static int swd_queue_dp_write_inner(struct adiv5_dap *dap, unsigned int reg,
 		uint32_t data);
@@ -68,6 +76,7 @@ static void swd_finish_read(struct adiv5_dap *dap)
 	const struct swd_driver *swd = adiv5_dap_swd_driver(dap);
 	if (dap->last_read) {
 		swd->read_reg(swd_cmd(true, false, DP_RDBUFF), dap->last_read, 0);
+		swd_queued_transfers++;
 		dap->last_read = NULL;
 	}
 }
@@ -84,8 +93,19 @@ static void swd_clear_sticky_errors(struct adiv5_dap *dap)
 static int swd_run_inner(struct adiv5_dap *dap)
 {
 	const struct swd_driver *swd = adiv5_dap_swd_driver(dap);
+	/* the count restarts on every run, whether it is timed or not */
+	unsigned int transfers = swd_queued_transfers;
+	swd_queued_transfers = 0;
+
+	perf_count_flush();
+	if (!adapter_flush_timed())
+		return swd->run();
+
+	int64_t start = timeval_us();
+	int retval = swd->run();
+	adapter_stats_flush(transfers, 0, timeval_us() - start);
 
-	return swd->run();
+	return retval;
 }
 
 static inline int check_sync(struct adiv5_dap *dap)
@@ -130,6 +150,7 @@ static int swd_queue_dp_read_inner(struct adiv5_dap *dap, unsigned int reg,
 		return retval;
 
 	swd->read_reg(swd_cmd(true, false, reg), data, 0);
+	swd_queued_transfers++;
 
 	return check_sync(dap);
 }
@@ -147,6 +168,7 @@ static int swd_queue_dp_write_inner(struct adiv5_dap *dap, unsigned int reg,
 		dap->select = data | (dap->select & (0xffffffffull << 32));
 
 		swd->write_reg(swd_cmd(false, false, reg), data, 0);
+		swd_queued_transfers++;
 
 		retval = check_sync(dap);
 		dap->select_valid = (retval == ERROR_OK);
@@ -165,6 +187,7 @@ static int swd_queue_dp_write_inner(struct adiv5_dap *dap, unsigned int reg,
 
 	if (retval == ERROR_OK) {
 		swd->write_reg(swd_cmd(false, false, reg), data, 0);
+		swd_queued_transfers++;
 
 		retval = check_sync(dap);
 	}
@@ -251,6 +274,7 @@ static int swd_multidrop_select_inner(struct adiv5_dap *dap, uint32_t *dpidr_ptr
 	LOG_DEBUG_IO("Selected DP_TARGETSEL 0x%08" PRIx32, dap->multidrop_targetsel);
 	swd_multidrop_selected_dap = dap;
 	swd_multidrop_in_swd_state = true;
+	dap->multidrop_check_gen = swd_multidrop_check_gen;
 
 	if (dpidr_ptr)
 		*dpidr_ptr = dpidr;
@@ -261,6 +285,42 @@ static int swd_multidrop_select_inner(struct adiv5_dap *dap, uint32_t *dpidr_ptr
 	return retval;
 }
 
+/*
+ * Switch back to a multidrop DP already checked by swd_multidrop_select_inner().
+ * The selection sequence is only queued, so the operations for this DP run
+ * in the same batch as the ones queued for the previous DP. A wrong or
+ * missing DP makes the next run fail, which forces a full reconnect.
+ */
+static int swd_multidrop_reselect(struct adiv5_dap *dap)
+{
+	/* Only read to take the connection out of reset */
+	static uint32_t dpidr;
+
+	/* The posted read of the previous DP must complete before the switch */
+	if (swd_multidrop_selected_dap)
+		swd_finish_read(swd_multidrop_selected_dap);
+
+	swd_send_sequence(dap, LINE_RESET);
+
+	/* Same SELECT cache handling as swd_multidrop_select_inner() */
+	dap->select = 0;
+	dap->select_dpbanksel_valid = true;
+	dap->select_valid = false;
+	dap->select1_valid = false;
+
+	int retval = swd_queue_dp_write_inner(dap, DP_TARGETSEL, dap->multidrop_targetsel);
+	if (retval == ERROR_OK)
+		retval = swd_queue_dp_read_inner(dap, DP_DPIDR, &dpidr);
+	if (retval == ERROR_OK)
+		retval = swd_queue_dp_write_inner(dap, DP_ABORT, ORUNERRCLR);
+	if (retval != ERROR_OK)
+		return retval;
+
+	LOG_DEBUG_IO("Reselected DP_TARGETSEL 0x%08" PRIx32, dap->multidrop_targetsel);
+	swd_multidrop_selected_dap = dap;
+	return ERROR_OK;
+}
+
 static int swd_multidrop_select(struct adiv5_dap *dap)
 {
 	if (!dap_is_multidrop(dap))
@@ -269,6 +329,10 @@ static int swd_multidrop_select(struct adiv5_dap *dap)
 	if (swd_multidrop_selected_dap == dap)
 		return ERROR_OK;
 
+	if (swd_multidrop_in_swd_state && dap->multidrop_check_gen == swd_multidrop_check_gen
+			&& swd_multidrop_reselect(dap) == ERROR_OK)
+		return ERROR_OK;
+
 	int retval = ERROR_OK;
 	for (unsigned int retry = 0; ; retry++) {
 		bool clear_sticky = retry > 0;
@@ -306,6 +370,7 @@ static int swd_connect_multidrop(struct adiv5_dap *dap)
 
 		/* Clear link state, including the SELECT cache. */
 		dap->do_reconnect = false;
+		dap->multidrop_check_gen = 0;
 		dap_invalidate_cache(dap);
 		swd_multidrop_selected_dap = NULL;
 
@@ -587,6 +652,7 @@ static int swd_queue_ap_read(struct adiv5_ap *ap, unsigned reg,
 		return retval;
 
 	swd->read_reg(swd_cmd(true, true, reg), dap->last_read, ap->memaccess_tck);
+	swd_queued_transfers++;
 	dap->last_read = data;
 
 	return check_sync(dap);
@@ -614,6 +680,7 @@ static int swd_queue_ap_write(struct adiv5_ap *ap, unsigned reg,
 		return retval;
 
 	swd->write_reg(swd_cmd(false, true, reg), data, ap->memaccess_tck);
+	swd_queued_transfers++;
 
 	return check_sync(dap);
 }
@@ -631,6 +698,9 @@ static int swd_run(struct adiv5_dap *dap)
 	if (retval != ERROR_OK) {
 		/* fault response */
 		dap->do_reconnect = true;
+		/* The failure may come from an operation queued for another
+		 * DP before a quick reselect: check all the DPs again */
+		swd_multidrop_check_gen++;
 	}
 
 	return retval;
@@ -671,6 +741,7 @@ static void swd_quit(struct adiv5_dap *dap)
 	}
 
 	/* flush the queue to shift out the sequence before exit */
+	swd_queued_transfers = 0;
 	swd->run();
 }
 
@@ -56,99 +56,66 @@ static int arc_mem_write_block32(struct target *target, uint32_t addr,
 	return ERROR_OK;
 }
 
-/* Write half-word at half-word-aligned address */
-static int arc_mem_write_block16(struct target *target, uint32_t addr,
-	uint32_t count, void *buf)
+/* Write bytes in target endianness at any address. Only the partial words
+ * at both edges are read back; they are merged with the new data and the
+ * whole range is written as one auto-incremented block. */
+static int arc_mem_write_block_unaligned(struct target *target, uint32_t addr,
+	uint32_t len, const uint8_t *buf)
 {
 	struct arc_common *arc = target_to_arc(target);
-	uint32_t i;
-	uint32_t buffer_he;
-	uint8_t buffer_te[sizeof(uint32_t)];
-	uint8_t halfword_te[sizeof(uint16_t)];
+	uint32_t start = addr & ~3u;
+	uint32_t end = (addr + len + 3) & ~3u;
+	uint32_t words = (end - start) / 4;
+	int retval = ERROR_OK;
 
-	LOG_DEBUG("Write 2-byte memory block: addr=0x%08" PRIx32 ", count=%" PRIu32,
-			addr, count);
+	LOG_DEBUG("Write unaligned memory block: addr=0x%08" PRIx32 ", len=%" PRIu32,
+			addr, len);
 
-	/* Check arguments */
-	assert(!(addr & 1));
+	uint32_t *block_he = calloc(words, sizeof(uint32_t));
+	uint8_t *block_te = calloc(words, sizeof(uint32_t));
+	if (!block_he || !block_te) {
+		LOG_ERROR("Unable to allocate memory");
+		retval = ERROR_FAIL;
+		goto exit;
+	}
 
 	/* We will read data from memory, so we need to flush the cache. */
-	CHECK_RETVAL(arc_cache_flush(target));
-
-	/* non-word writes are less common than 4-byte writes, so I suppose we can
-	 * allow ourselves to write this in a cycle, instead of calling arc_jtag
-	 * with count > 1. */
-	for (i = 0; i < count; i++) {
-		/* We can read only word at word-aligned address. Also *jtag_read_memory
-		 * functions return data in host endianness, so host endianness !=
-		 * target endianness we have to convert data back to target endianness,
-		 * or bytes will be at the wrong places.So:
-		 *   1) read word
-		 *   2) convert to target endianness
-		 *   3) make changes
-		 *   4) convert back to host endianness
-		 *   5) write word back to target.
-		 */
-		bool is_slow_memory = arc_mem_is_slow_memory(arc,
-			(addr + i * sizeof(uint16_t)) & ~3u, 4, 1);
-		CHECK_RETVAL(arc_jtag_read_memory(&arc->jtag_info,
-				(addr + i * sizeof(uint16_t)) & ~3u, 1, &buffer_he,
-				is_slow_memory));
-		target_buffer_set_u32(target, buffer_te, buffer_he);
-
-		/* buf is in host endianness, convert to target */
-		target_buffer_set_u16(target, halfword_te, ((uint16_t *)buf)[i]);
-
-		memcpy(buffer_te  + ((addr + i * sizeof(uint16_t)) & 3u),
-			halfword_te, sizeof(uint16_t));
-
-		buffer_he = target_buffer_get_u32(target, buffer_te);
-
-		CHECK_RETVAL(arc_jtag_write_memory(&arc->jtag_info,
-			(addr + i * sizeof(uint16_t)) & ~3u, 1, &buffer_he));
+	retval = arc_cache_flush(target);
+	if (retval != ERROR_OK)
+		goto exit;
+
+	/* Read-modify-write of the edge words, a single read if they are close */
+	bool head = addr & 3u;
+	bool tail = (addr + len) & 3u;
+	if (words <= 2 && (head || tail)) {
+		retval = arc_jtag_read_memory(&arc->jtag_info, start, words, block_he,
+				arc_mem_is_slow_memory(arc, start, 4, words));
+	} else {
+		if (head)
+			retval = arc_jtag_read_memory(&arc->jtag_info, start, 1, block_he,
+					arc_mem_is_slow_memory(arc, start, 4, 1));
+		if (retval == ERROR_OK && tail)
+			retval = arc_jtag_read_memory(&arc->jtag_info, end - 4, 1,
+					block_he + words - 1, arc_mem_is_slow_memory(arc, end - 4, 4, 1));
 	}
+	if (retval != ERROR_OK)
+		goto exit;
 
-	/* Invalidate caches. */
-	CHECK_RETVAL(arc_cache_invalidate(target));
-
-	return ERROR_OK;
-}
-
-/* Write byte at address */
-static int arc_mem_write_block8(struct target *target, uint32_t addr,
-	uint32_t count, void *buf)
-{
-	struct arc_common *arc = target_to_arc(target);
-	uint32_t i;
-	uint32_t buffer_he;
-	uint8_t buffer_te[sizeof(uint32_t)];
+	target_buffer_set_u32_array(target, block_te, words, block_he);
+	memcpy(block_te + (addr & 3u), buf, len);
+	target_buffer_get_u32_array(target, block_te, words, block_he);
 
-
-	LOG_DEBUG("Write 1-byte memory block: addr=0x%08" PRIx32 ", count=%" PRIu32,
-			addr, count);
-
-	/* We will read data from memory, so we need to flush the cache. */
-	CHECK_RETVAL(arc_cache_flush(target));
-
-	/* non-word writes are less common than 4-byte writes, so I suppose we can
-	 * allow ourselves to write this in a cycle, instead of calling arc_jtag
-	 * with count > 1. */
-	for (i = 0; i < count; i++) {
-		/* See comment in arc_mem_write_block16 for details. Since it is a byte
-		 * there is not need to convert write buffer to target endianness, but
-		 * we still have to convert read buffer. */
-		CHECK_RETVAL(arc_jtag_read_memory(&arc->jtag_info, (addr + i) & ~3, 1, &buffer_he,
-			    arc_mem_is_slow_memory(arc, (addr + i) & ~3, 4, 1)));
-		target_buffer_set_u32(target, buffer_te, buffer_he);
-		memcpy(buffer_te  + ((addr + i) & 3), (uint8_t *)buf + i, 1);
-		buffer_he = target_buffer_get_u32(target, buffer_te);
-		CHECK_RETVAL(arc_jtag_write_memory(&arc->jtag_info, (addr + i) & ~3, 1, &buffer_he));
-	}
+	retval = arc_jtag_write_memory(&arc->jtag_info, start, words, block_he);
+	if (retval != ERROR_OK)
+		goto exit;
 
 	/* Invalidate caches. */
-	CHECK_RETVAL(arc_cache_invalidate(target));
+	retval = arc_cache_invalidate(target);
 
-	return ERROR_OK;
+exit:
+	free(block_he);
+	free(block_te);
+	return retval;
 }
 
 /* ----- Exported functions ------------------------------------------------ */
@@ -173,43 +140,26 @@ int arc_mem_write(struct target *target, target_addr_t address, uint32_t size,
 	if (((size == 4) && (address & 0x3u)) || ((size == 2) && (address & 0x1u)))
 		return ERROR_TARGET_UNALIGNED_ACCESS;
 
-	/* correct endianness if we have word or hword access */
-	if (size > 1) {
-		/*
-		 * arc_..._write_mem with size 4/2 requires uint32_t/uint16_t
-		 * in host endianness, but byte array represents target endianness.
-		 */
-		tunnel = calloc(1, count * size * sizeof(uint8_t));
-
-		if (!tunnel) {
-			LOG_ERROR("Unable to allocate memory");
-			return ERROR_FAIL;
-		}
+	/* Byte and half-word data is written as a byte array in target
+	 * endianness, merged with the edge words. */
+	if (size < 4)
+		return arc_mem_write_block_unaligned(target, address, count * size, buffer);
 
-		switch (size) {
-		case 4:
-			target_buffer_get_u32_array(target, buffer, count,
-				(uint32_t *)tunnel);
-			break;
-		case 2:
-			target_buffer_get_u16_array(target, buffer, count,
-				(uint16_t *)tunnel);
-			break;
-		}
-		buffer = tunnel;
-	}
+	/*
+	 * arc_..._write_mem with size 4 requires uint32_t in host endianness,
+	 * but byte array represents target endianness.
+	 */
+	tunnel = calloc(1, count * size * sizeof(uint8_t));
 
-	if (size == 4) {
-		retval = arc_mem_write_block32(target, address, count, (void *)buffer);
-	} else if (size == 2) {
-		/* We convert buffer from host endianness to target. But then in
-		 * write_block16, we do the reverse. Is there a way to avoid this without
-		 * breaking other cases? */
-		retval = arc_mem_write_block16(target, address, count, (void *)buffer);
-	} else {
-		retval = arc_mem_write_block8(target, address, count, (void *)buffer);
+	if (!tunnel) {
+		LOG_ERROR("Unable to allocate memory");
+		return ERROR_FAIL;
 	}
 
+	target_buffer_get_u32_array(target, buffer, count, (uint32_t *)tunnel);
+
+	retval = arc_mem_write_block32(target, address, count, tunnel);
+
 	free(tunnel);
 
 	return retval;
@@ -165,6 +165,27 @@ enum arm_vfp_version {
 
 #define ARM_COMMON_MAGIC 0x0A450A45U
 
+/** Number of VA pages remembered by the MMU translation cache. */
+#define ARM_MMU_TLB_SIZE 64
+
+/**
+ * One VA page translated by the core. The whole PAR value is kept so that
+ * memory attributes can still be decoded on a hit.
+ */
+struct arm_mmu_tlb_entry {
+	bool valid;
+	enum arm_mode mode;
+	target_addr_t va_page;
+	uint64_t par;
+};
+
+/** Selection of arm::bulk_ap, see arm_bulk_ap_setup() */
+enum arm_bulk_ap_mode {
+	ARM_BULK_AP_OFF,
+	ARM_BULK_AP_AUTO,
+	ARM_BULK_AP_NUM,
+};
+
 /**
  * Represents a generic ARM core, with standard application registers.
  *
@@ -250,11 +271,20 @@ struct arm {
 
 	void *arch_info;
 
+	/** Translations done while halted, dropped on debug entry. */
+	struct arm_mmu_tlb_entry mmu_tlb[ARM_MMU_TLB_SIZE];
+
 	/** For targets conforming to ARM Debug Interface v5,
 	 * this handle references the Debug Access Port (DAP)
 	 * used to make requests to the target.
 	 */
 	struct adiv5_dap *dap;
+
+	/** MEM-AP to the system bus taking the large physical memory
+	 * transfers instead of the core, NULL if none. */
+	struct adiv5_ap *bulk_ap;
+	enum arm_bulk_ap_mode bulk_ap_mode;
+	uint64_t bulk_ap_num;
 };
 
 /** Convert target handle to generic ARM target state handle. */
@@ -292,8 +322,12 @@ struct reg_cache *armv8_build_reg_cache(struct target *target);
 
 extern const struct command_registration arm_command_handlers[];
 extern const struct command_registration arm_all_profiles_command_handlers[];
+extern const struct command_registration arm_bulk_ap_command_handlers[];
 
 int arm_arch_state(struct target *target);
+bool arm_mmu_tlb_lookup(struct arm *arm, target_addr_t va, uint64_t *par);
+void arm_mmu_tlb_insert(struct arm *arm, target_addr_t va, uint64_t par);
+void arm_mmu_tlb_invalidate(struct arm *arm);
 const char *arm_get_gdb_arch(const struct target *target);
 int arm_get_gdb_reg_list(struct target *target,
 		struct reg **reg_list[], int *reg_list_size,
@@ -324,6 +358,10 @@ int arm_checksum_memory(struct target *target,
 int arm_blank_check_memory(struct target *target,
 		struct target_memory_check_block *blocks, int num_blocks, uint8_t erased_value);
 
+int arm_bulk_ap_setup(struct target *target);
+void arm_bulk_ap_free(struct arm *arm);
+bool arm_bulk_ap_use(struct arm *arm, uint32_t size, uint32_t count);
+
 void arm_set_cpsr(struct arm *arm, uint32_t cpsr);
 struct reg *arm_reg_current(struct arm *arm, unsigned regnum);
 struct reg *armv8_reg_current(struct arm *arm, unsigned regnum);
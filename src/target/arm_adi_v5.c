@@ -62,6 +62,7 @@
 #include "config.h"
 #endif
 
+#include "jtag/adapter.h"
 #include "jtag/interface.h"
 #include "arm.h"
 #include "arm_adi_v5.h"
@@ -304,9 +305,19 @@ int mem_ap_write_u32(struct adiv5_ap *ap, target_addr_t address,
 			value);
 }
 
+/* Note a write left in the queue, reported if the run including it fails */
+static void dap_defer_write(struct adiv5_dap *dap, target_addr_t address)
+{
+	if (!dap->deferred_write_pending) {
+		dap->deferred_write_pending = true;
+		dap->deferred_write_address = address;
+	}
+}
+
 /**
  * Synchronous write of a word to memory or a system register.
  * As a side effect, this flushes any queued transactions.
+ * Inside a dap_defer_atomic_begin() section the write is only queued.
  *
  * @param ap The MEM-AP to access.
  * @param address Address to be written; it must be writable by
@@ -318,12 +329,118 @@ int mem_ap_write_u32(struct adiv5_ap *ap, target_addr_t address,
 int mem_ap_write_atomic_u32(struct adiv5_ap *ap, target_addr_t address,
 		uint32_t value)
 {
+	struct adiv5_dap *dap = ap->dap;
 	int retval = mem_ap_write_u32(ap, address, value);
 
 	if (retval != ERROR_OK)
 		return retval;
 
-	return dap_run(ap->dap);
+	if (dap->defer_atomic) {
+		dap_defer_write(dap, address);
+		return ERROR_OK;
+	}
+
+	return dap_run(dap);
+}
+
+void dap_defer_atomic_begin(struct adiv5_dap *dap)
+{
+	dap->defer_atomic++;
+}
+
+void dap_batch_begin(struct adiv5_dap *dap)
+{
+	dap->batch++;
+	dap_defer_atomic_begin(dap);
+}
+
+int dap_batch_end(struct adiv5_dap *dap)
+{
+	assert(dap->batch);
+	dap->batch--;
+	return dap_defer_atomic_end(dap);
+}
+
+int dap_defer_atomic_end(struct adiv5_dap *dap)
+{
+	assert(dap->defer_atomic);
+	if (--dap->defer_atomic || !dap->deferred_write_pending)
+		return ERROR_OK;
+
+	return dap_run(dap);
+}
+
+int dap_run_deferred_report(struct adiv5_dap *dap, int retval)
+{
+	dap->deferred_write_pending = false;
+	if (retval != ERROR_OK)
+		LOG_ERROR("DAP transaction failed, it included deferred writes starting at "
+				TARGET_ADDR_FMT, dap->deferred_write_address);
+	return retval;
+}
+
+/**
+ * Synchronous single word transfers on the MEM-APs of one or several DAPs.
+ * The transfers for all the APs of a DAP are queued together and flushed
+ * with a single dap_run(), instead of one run per AP. This is meant for
+ * accessing all the cores of an SMP group at once.
+ * DAPs on the same SWD multidrop bus share the adapter queue and switching
+ * between them can be queued, so they are all flushed by a single run.
+ *
+ * @param accesses The transfers to do; read words are stored in their value.
+ * @param count Number of entries in accesses.
+ *
+ * @return ERROR_OK for success; otherwise the first fault code. The DAPs
+ * queued after a failing one are still run.
+ */
+int mem_ap_batch_run(struct mem_ap_batch_access *accesses, unsigned int count)
+{
+	int retval = ERROR_OK;
+	struct adiv5_dap *unrun_dap = NULL;
+
+	for (unsigned int i = 0; i < count; i++) {
+		struct adiv5_dap *dap = accesses[i].ap->dap;
+		bool done = false;
+
+		/* skip the DAPs already handled for an earlier entry */
+		for (unsigned int j = 0; j < i && !done; j++)
+			done = accesses[j].ap->dap == dap;
+		if (done)
+			continue;
+
+		if (unrun_dap && !(dap_is_multidrop(unrun_dap) && dap_is_multidrop(dap))) {
+			int ret2 = dap_run(unrun_dap);
+			if (retval == ERROR_OK)
+				retval = ret2;	/* store the first error code ignore others */
+			unrun_dap = NULL;
+		}
+
+		int ret2 = ERROR_OK;
+		for (unsigned int j = i; j < count && ret2 == ERROR_OK; j++) {
+			struct mem_ap_batch_access *access = &accesses[j];
+			if (access->ap->dap != dap)
+				continue;
+
+			if (access->write)
+				ret2 = mem_ap_write_u32(access->ap, access->address, access->value);
+			else
+				ret2 = mem_ap_read_u32(access->ap, access->address, &access->value);
+		}
+
+		/* The run of the last multidrop DAP also flushes the previous ones */
+		if (ret2 == ERROR_OK)
+			unrun_dap = dap;
+		else if (retval == ERROR_OK)
+			retval = ret2;
+	}
+
+	if (unrun_dap) {
+		int ret2 = dap_run(unrun_dap);
+		if (retval == ERROR_OK)
+			retval = ret2;
+	}
+
+	return retval;
 }
 
 /**
@@ -459,7 +576,75 @@ static int mem_ap_setup_transfer_verify_size_packing_fallback(struct adiv5_ap *a
 }
 
 /**
- * Synchronous write of a block of memory, using a specific access size.
+ * Number of DRW transfers to queue before running them, 0 to queue the whole
+ * block. The adapter batch size counts the entries of a queue flush, which
+ * are DAP transfers with SWD but JTAG commands with JTAG-DP, where a MEM-AP
+ * transfer is a DR scan followed by an idle run if memaccess_tck is set.
+ */
+static unsigned int mem_ap_batch_size(struct adiv5_ap *ap)
+{
+	unsigned int batch = adapter_get_batch_size();
+
+	if (batch && ap->dap->ops == &jtag_dp_ops && ap->memaccess_tck)
+		batch = MAX(batch / 2, 1u);
+
+	return batch;
+}
+
+/**
+ * Plan the next segment of a mem_ap_write() or mem_ap_read(): a run of
+ * transfers that share one CSW setting and need no TAR rewrite.
+ *
+ * Bytes and halfwords are transferred one at a time up to the first word
+ * aligned address (head), then packed four bytes per DRW access (body) and
+ * one at a time again for the last bytes (tail). Word aligned packed
+ * transfers never cross a TAR auto-increment block, so the body is only
+ * split at the block boundaries.
+ *
+ * The same plan is used to unpack the DRW words read back, once packing
+ * support has been probed.
+ *
+ * @param ap The MEM-AP.
+ * @param size Transfer width in bytes.
+ * @param address Address of the segment.
+ * @param nbytes Remaining bytes to transfer.
+ * @param addrinc TAR will be autoincremented.
+ * @param pack Packed transfers can be used, if supported by the MEM-AP.
+ * @param seg_pack Set to true if the segment should use packed transfers.
+ *
+ * @return Length of the segment in bytes.
+ */
+static size_t mem_ap_plan_segment(struct adiv5_ap *ap, uint32_t size,
+		target_addr_t address, size_t nbytes, bool addrinc, bool pack, bool *seg_pack)
+{
+	*seg_pack = false;
+	if (!addrinc)
+		return nbytes;
+
+	size_t seg = MIN(nbytes, max_tar_block_size(ap->tar_autoincr_block, address));
+
+	pack = pack && size < 4 && address % size == 0
+		&& !(ap->packed_transfers_probed && !ap->packed_transfers_supported);
+	if (pack) {
+		if ((address & 3) == 0 && seg >= 4) {
+			*seg_pack = true;
+			return seg & ~3;
+		}
+		if (address & 3)
+			seg = MIN(seg, 4 - (address & 3));
+	}
+
+	/* A single transfer crossing the block boundary invalidates the TAR cache */
+	seg -= seg % size;
+	if (seg == 0)
+		seg = size;
+
+	return MIN(seg, nbytes);
+}
+
+/**
+ * Queue the write of a block of memory, using a specific access size.
+ * The queue may be run part way if the adapter batch size is limited.
  *
  * @param ap The MEM-AP to access.
  * @param buffer The data buffer to write. No particular alignment is assumed.
@@ -471,7 +656,7 @@ static int mem_ap_setup_transfer_verify_size_packing_fallback(struct adiv5_ap *a
  *  should normally be true, except when writing to e.g. a FIFO.
  * @return ERROR_OK on success, otherwise an error code.
  */
-static int mem_ap_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t size, uint32_t count,
+static int mem_ap_queue_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t size, uint32_t count,
 		target_addr_t address, bool addrinc)
 {
 	struct adiv5_dap *dap = ap->dap;
@@ -515,100 +700,201 @@ static int mem_ap_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t siz
 	/* Nuvoton NPCX quirks prevent packed writes */
 	bool pack = !dap->nu_npcx_quirks;
 
+	unsigned int batch = mem_ap_batch_size(ap);
+	unsigned int queued = 0;
+
 	while (nbytes > 0) {
+		bool seg_pack;
+		size_t seg_bytes = mem_ap_plan_segment(ap, size, address, nbytes,
+					addrinc, pack, &seg_pack);
+		/* TI BE-32 quirks need TAR to be set before each transfer */
+		if (ti_be_addr_xor)
+			seg_bytes = size;
+
 		unsigned int this_size;
 		retval = mem_ap_setup_transfer_verify_size_packing_fallback(ap,
 					size, address ^ ti_be_addr_xor,
-					addrinc, pack && nbytes >= 4, &this_size);
+					addrinc, seg_pack, &this_size);
 		if (retval != ERROR_OK)
 			return retval;
 
-		/* How many source bytes each transfer will consume, and their location in the DRW,
-		 * depends on the type of transfer and alignment. See ARM document IHI0031C. */
-		uint32_t drw_byte_idx = address;
-		unsigned int drw_ops = DIV_ROUND_UP(this_size, 4);
-
-		while (drw_ops--) {
-			uint32_t outvalue = 0;
-			if (dap->nu_npcx_quirks && this_size <= 2) {
-				switch (this_size) {
-				case 2:
-					{
-						/* Alternate low and high byte to all byte lanes */
-						uint32_t low = *buffer++;
-						uint32_t high = *buffer++;
-						outvalue |= low << 8 * (drw_byte_idx++ & 3);
-						outvalue |= high << 8 * (drw_byte_idx++ & 3);
-						outvalue |= low << 8 * (drw_byte_idx++ & 3);
-						outvalue |= high << 8 * (drw_byte_idx & 3);
-					}
+		/* Packing just found unsupported, plan again */
+		if (seg_pack && this_size != 4)
+			continue;
+
+		/* Whole DRW words go to the adapter a block at a time if it can */
+		while (this_size == 4 && seg_bytes > 0 && dap->ops->queue_ap_write_buf
+				&& !dap->nu_npcx_quirks) {
+			uint32_t words[64];
+			unsigned int n = MIN(seg_bytes / 4, ARRAY_SIZE(words));
+			if (batch)
+				n = MIN(n, batch - queued);
+
+			for (unsigned int i = 0; i < n; i++) {
+				uint32_t drw_byte_idx = address + 4 * i;
+				words[i] = 0;
+				for (unsigned int j = 0; j < 4; j++)
+					words[i] |= (uint32_t)*buffer++ <<
+								8 * ((drw_byte_idx++ & 3) ^ ti_be_lane_xor);
+			}
+
+			retval = dap_queue_ap_write_buf(ap, MEM_AP_REG_DRW(dap), words, n);
+			if (retval != ERROR_OK)
+				break;
+
+			for (unsigned int i = 0; i < n; i++)
+				mem_ap_update_tar_cache(ap);
+			queued += n;
+			seg_bytes -= 4 * n;
+			nbytes -= 4 * n;
+			if (addrinc)
+				address += 4 * n;
+
+			if (batch && queued >= batch && nbytes > 0) {
+				retval = dap_run(dap);
+				if (retval != ERROR_OK)
 					break;
-				case 1:
-					{
-						/* Mirror output byte to all byte lanes */
-						uint32_t data = *buffer++;
-						outvalue |= data;
-						outvalue |= data << 8;
-						outvalue |= data << 16;
-						outvalue |= data << 24;
+				queued = 0;
+			}
+		}
+		if (retval != ERROR_OK)
+			break;
+
+		for (; seg_bytes > 0; seg_bytes -= this_size) {
+			/* How many source bytes each transfer will consume, and their location in the DRW,
+			 * depends on the type of transfer and alignment. See ARM document IHI0031C. */
+			uint32_t drw_byte_idx = address;
+			unsigned int drw_ops = DIV_ROUND_UP(this_size, 4);
+			queued += drw_ops;
+
+			while (drw_ops--) {
+				uint32_t outvalue = 0;
+				if (dap->nu_npcx_quirks && this_size <= 2) {
+					switch (this_size) {
+					case 2:
+						{
+							/* Alternate low and high byte to all byte lanes */
+							uint32_t low = *buffer++;
+							uint32_t high = *buffer++;
+							outvalue |= low << 8 * (drw_byte_idx++ & 3);
+							outvalue |= high << 8 * (drw_byte_idx++ & 3);
+							outvalue |= low << 8 * (drw_byte_idx++ & 3);
+							outvalue |= high << 8 * (drw_byte_idx & 3);
+						}
+						break;
+					case 1:
+						{
+							/* Mirror output byte to all byte lanes */
+							uint32_t data = *buffer++;
+							outvalue |= data;
+							outvalue |= data << 8;
+							outvalue |= data << 16;
+							outvalue |= data << 24;
+						}
 					}
+				} else {
+					unsigned int drw_bytes = MIN(this_size, 4);
+					while (drw_bytes--)
+						outvalue |= (uint32_t)*buffer++ <<
+									8 * ((drw_byte_idx++ & 3) ^ ti_be_lane_xor);
 				}
-			} else {
-				unsigned int drw_bytes = MIN(this_size, 4);
-				while (drw_bytes--)
-					outvalue |= (uint32_t)*buffer++ <<
-								8 * ((drw_byte_idx++ & 3) ^ ti_be_lane_xor);
-			}
 
-			retval = dap_queue_ap_write(ap, MEM_AP_REG_DRW(dap), outvalue);
+				retval = dap_queue_ap_write(ap, MEM_AP_REG_DRW(dap), outvalue);
+				if (retval != ERROR_OK)
+					break;
+			}
 			if (retval != ERROR_OK)
 				break;
+
+			mem_ap_update_tar_cache(ap);
+			nbytes -= this_size;
+			if (addrinc)
+				address += this_size;
+
+			if (batch && queued >= batch && nbytes > 0) {
+				retval = dap_run(dap);
+				if (retval != ERROR_OK)
+					break;
+				queued = 0;
+			}
 		}
 		if (retval != ERROR_OK)
 			break;
+	}
+
+	return retval;
+}
+
+static void mem_ap_report_write_error(struct adiv5_ap *ap)
+{
+	target_addr_t tar;
+	if (mem_ap_read_tar(ap, &tar) == ERROR_OK)
+		LOG_ERROR("Failed to write memory at " TARGET_ADDR_FMT, tar);
+	else
+		LOG_ERROR("Failed to write memory and, additionally, failed to find out where");
+}
+
+/**
+ * Synchronous write of a block of memory, using a specific access size.
+ *
+ * @param ap The MEM-AP to access.
+ * @param buffer The data buffer to write. No particular alignment is assumed.
+ * @param size Which access size to use, in bytes. 1, 2, or 4.
+ *	If large data extension is available also accepts sizes 8, 16, 32.
+ * @param count The number of writes to do (in size units, not bytes).
+ * @param address Address to be written; it must be writable by the currently selected MEM-AP.
+ * @param addrinc Whether the target address should be increased for each write or not. This
+ *  should normally be true, except when writing to e.g. a FIFO.
+ * @return ERROR_OK on success, otherwise an error code.
+ */
+static int mem_ap_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t size, uint32_t count,
+		target_addr_t address, bool addrinc)
+{
+	int retval = mem_ap_queue_write(ap, buffer, size, count, address, addrinc);
+	if (retval == ERROR_TARGET_UNALIGNED_ACCESS || retval == ERROR_TARGET_SIZE_NOT_SUPPORTED)
+		return retval;
 
-		mem_ap_update_tar_cache(ap);
-		nbytes -= this_size;
-		if (addrinc)
-			address += this_size;
+	if (retval == ERROR_OK && ap->dap->batch) {
+		dap_defer_write(ap->dap, address);
+		return ERROR_OK;
 	}
 
-	/* REVISIT: Might want to have a queued version of this function that does not run. */
 	if (retval == ERROR_OK)
-		retval = dap_run(dap);
+		retval = dap_run(ap->dap);
 
-	if (retval != ERROR_OK) {
-		target_addr_t tar;
-		if (mem_ap_read_tar(ap, &tar) == ERROR_OK)
-			LOG_ERROR("Failed to write memory at " TARGET_ADDR_FMT, tar);
-		else
-			LOG_ERROR("Failed to write memory and, additionally, failed to find out where");
-	}
+	if (retval != ERROR_OK)
+		mem_ap_report_write_error(ap);
 
 	return retval;
 }
 
 /**
- * Synchronous read of a block of memory, using a specific access size.
+ * Queue the read of a block of memory, using a specific access size.
+ * The queue may be run part way if the adapter batch size is limited.
+ * Each read stores the entire DRW word in a buffer allocated here. Once the
+ * queue has run, mem_ap_read_unpack() copies the data to the caller's buffer.
  *
  * @param ap The MEM-AP to access.
- * @param buffer The data buffer to receive the data. No particular alignment is assumed.
  * @param size Which access size to use, in bytes. 1, 2, or 4.
  *	If large data extension is available also accepts sizes 8, 16, 32.
  * @param count The number of reads to do (in size units, not bytes).
  * @param adr Address to be read; it must be readable by the currently selected MEM-AP.
  * @param addrinc Whether the target address should be increased after each read or not. This
  *  should normally be true, except when reading from e.g. a FIFO.
+ * @param read_buf Set to the buffer of DRW words, to be freed by the caller.
+ *	NULL if it could not be allocated.
  * @return ERROR_OK on success, otherwise an error code.
  */
-static int mem_ap_read(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size, uint32_t count,
-		target_addr_t adr, bool addrinc)
+static int mem_ap_queue_read(struct adiv5_ap *ap, uint32_t size, uint32_t count,
+		target_addr_t adr, bool addrinc, uint32_t **read_buf)
 {
 	struct adiv5_dap *dap = ap->dap;
 	size_t nbytes = size * count;
 	target_addr_t address = adr;
 	int retval = ERROR_OK;
 
+	*read_buf = NULL;
+
 	/* TI BE-32 Quirks mode:
 	 * Reads on big-endian TMS570 behave strangely differently than writes.
 	 * They read from the physical address requested, but with DRW byte-reversed.
@@ -627,48 +913,163 @@ static int mem_ap_read(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size, uint
 	/* Allocate buffer to hold the sequence of DRW reads that will be made. This is a significant
 	 * over-allocation if packed transfers are going to be used, but determining the real need at
 	 * this point would be messy. */
-	uint32_t *read_buf = calloc(count, MAX(sizeof(uint32_t), size));
+	*read_buf = calloc(count, MAX(sizeof(uint32_t), size));
 
 	/* Multiplication count * sizeof(uint32_t) may overflow, calloc() is safe */
-	uint32_t *read_ptr = read_buf;
-	if (!read_buf) {
+	uint32_t *read_ptr = *read_buf;
+	if (!read_ptr) {
 		LOG_ERROR("Failed to allocate read buffer");
 		return ERROR_FAIL;
 	}
 
+	unsigned int batch = mem_ap_batch_size(ap);
+	unsigned int queued = 0;
+
 	/* Queue up all reads. Each read will store the entire DRW word in the read buffer. How many
 	 * useful bytes it contains, and their location in the word, depends on the type of transfer
 	 * and alignment. */
 	while (nbytes > 0) {
+		bool seg_pack;
+		size_t seg_bytes = mem_ap_plan_segment(ap, size, address, nbytes,
+					addrinc, true, &seg_pack);
+
 		unsigned int this_size;
 		retval = mem_ap_setup_transfer_verify_size_packing_fallback(ap,
 					size, address,
-					addrinc, nbytes >= 4, &this_size);
+					addrinc, seg_pack, &this_size);
 		if (retval != ERROR_OK)
 			break;
 
+		/* Packing just found unsupported, plan again */
+		if (seg_pack && this_size != 4)
+			continue;
+
+		/* Whole DRW words come from the adapter a block at a time if it can */
+		while (this_size == 4 && seg_bytes > 0 && dap->ops->queue_ap_read_buf) {
+			unsigned int n = seg_bytes / 4;
+			if (batch)
+				n = MIN(n, batch - queued);
+
+			retval = dap_queue_ap_read_buf(ap, MEM_AP_REG_DRW(dap), read_ptr, n);
+			if (retval != ERROR_OK)
+				break;
+
+			for (unsigned int i = 0; i < n; i++)
+				mem_ap_update_tar_cache(ap);
+			read_ptr += n;
+			queued += n;
+			seg_bytes -= 4 * n;
+			nbytes -= 4 * n;
+			if (addrinc)
+				address += 4 * n;
+
+			if (batch && queued >= batch && nbytes > 0) {
+				retval = dap_run(dap);
+				if (retval != ERROR_OK)
+					break;
+				queued = 0;
+			}
+		}
+		if (retval != ERROR_OK)
+			break;
+
+		for (; seg_bytes > 0; seg_bytes -= this_size) {
+			unsigned int drw_ops = DIV_ROUND_UP(this_size, 4);
+			queued += drw_ops;
+			while (drw_ops--) {
+				retval = dap_queue_ap_read(ap, MEM_AP_REG_DRW(dap), read_ptr++);
+				if (retval != ERROR_OK)
+					break;
+			}
+
+			nbytes -= this_size;
+			if (addrinc)
+				address += this_size;
 
-		unsigned int drw_ops = DIV_ROUND_UP(this_size, 4);
-		while (drw_ops--) {
-			retval = dap_queue_ap_read(ap, MEM_AP_REG_DRW(dap), read_ptr++);
+			mem_ap_update_tar_cache(ap);
+
+			if (retval == ERROR_OK && batch && queued >= batch && nbytes > 0) {
+				retval = dap_run(dap);
+				if (retval != ERROR_OK)
+					break;
+				queued = 0;
+			}
 			if (retval != ERROR_OK)
 				break;
 		}
+		if (retval != ERROR_OK)
+			break;
+	}
+
+	return retval;
+}
 
-		nbytes -= this_size;
-		if (addrinc)
-			address += this_size;
+/**
+ * Copy the data read by mem_ap_queue_read() from the DRW words to the caller's
+ * buffer, picking the correct word and byte lane.
+ *
+ * @param nbytes Number of bytes to copy, possibly less than size * count
+ *	if the read failed part way.
+ */
+static void mem_ap_read_unpack(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size,
+		target_addr_t address, bool addrinc, const uint32_t *read_ptr, size_t nbytes)
+{
+	target_addr_t ti_be_lane_xor = ap->dap->ti_be_32_quirks ? 3 : 0;
+
+	while (nbytes > 0) {
+		bool seg_pack;
+		size_t seg_bytes = mem_ap_plan_segment(ap, size, address, nbytes,
+					addrinc, true, &seg_pack);
 
-		mem_ap_update_tar_cache(ap);
+		/* Convert transfers longer than 32-bit on word-at-a-time basis */
+		unsigned int this_size = seg_pack ? 4 : MIN(size, 4);
+		if (seg_bytes < this_size)
+			break;
+
+		nbytes -= seg_bytes;
+		for (; seg_bytes >= this_size; seg_bytes -= this_size) {
+			switch (this_size) {
+			case 4:
+				*buffer++ = *read_ptr >> 8 * ((address++ & 3) ^ ti_be_lane_xor);
+				*buffer++ = *read_ptr >> 8 * ((address++ & 3) ^ ti_be_lane_xor);
+				/* fallthrough */
+			case 2:
+				*buffer++ = *read_ptr >> 8 * ((address++ & 3) ^ ti_be_lane_xor);
+				/* fallthrough */
+			case 1:
+				*buffer++ = *read_ptr >> 8 * ((address++ & 3) ^ ti_be_lane_xor);
+			}
+
+			read_ptr++;
+		}
 	}
+}
+
+/**
+ * Synchronous read of a block of memory, using a specific access size.
+ *
+ * @param ap The MEM-AP to access.
+ * @param buffer The data buffer to receive the data. No particular alignment is assumed.
+ * @param size Which access size to use, in bytes. 1, 2, or 4.
+ *	If large data extension is available also accepts sizes 8, 16, 32.
+ * @param count The number of reads to do (in size units, not bytes).
+ * @param adr Address to be read; it must be readable by the currently selected MEM-AP.
+ * @param addrinc Whether the target address should be increased after each read or not. This
+ *  should normally be true, except when reading from e.g. a FIFO.
+ * @return ERROR_OK on success, otherwise an error code.
+ */
+static int mem_ap_read(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size, uint32_t count,
+		target_addr_t adr, bool addrinc)
+{
+	uint32_t *read_buf;
+	int retval = mem_ap_queue_read(ap, size, count, adr, addrinc, &read_buf);
+	if (!read_buf)
+		return retval;
 
 	if (retval == ERROR_OK)
-		retval = dap_run(dap);
+		retval = dap_run(ap->dap);
 
-	/* Restore state */
-	address = adr;
-	nbytes = size * count;
-	read_ptr = read_buf;
+	size_t nbytes = size * count;
 
 	/* If something failed, read TAR to find out how much data was successfully read, so we can
 	 * at least give the caller what we have. */
@@ -679,41 +1080,15 @@ static int mem_ap_read(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size, uint
 		if (mem_ap_read_tar(ap, &tar) == ERROR_OK) {
 			/* TAR is incremented after failed transfer on some devices (eg Cortex-M4) */
 			LOG_ERROR("Failed to read memory at " TARGET_ADDR_FMT, tar);
-			if (nbytes > tar - address)
-				nbytes = tar - address;
+			if (nbytes > tar - adr)
+				nbytes = tar - adr;
 		} else {
 			LOG_ERROR("Failed to read memory and, additionally, failed to find out where");
 			nbytes = 0;
 		}
 	}
 
-	target_addr_t ti_be_lane_xor = dap->ti_be_32_quirks ? 3 : 0;
-
-	/* Replay loop to populate caller's buffer from the correct word and byte lane */
-	while (nbytes > 0) {
-		/* Convert transfers longer than 32-bit on word-at-a-time basis */
-		unsigned int this_size = MIN(size, 4);
-
-		if (size < 4 && addrinc && ap->packed_transfers_supported && nbytes >= 4
-				&& max_tar_block_size(ap->tar_autoincr_block, address) >= 4) {
-			this_size = 4;	/* Packed read of 4 bytes or 2 halfwords */
-		}
-
-		switch (this_size) {
-		case 4:
-			*buffer++ = *read_ptr >> 8 * ((address++ & 3) ^ ti_be_lane_xor);
-			*buffer++ = *read_ptr >> 8 * ((address++ & 3) ^ ti_be_lane_xor);
-			/* fallthrough */
-		case 2:
-			*buffer++ = *read_ptr >> 8 * ((address++ & 3) ^ ti_be_lane_xor);
-			/* fallthrough */
-		case 1:
-			*buffer++ = *read_ptr >> 8 * ((address++ & 3) ^ ti_be_lane_xor);
-		}
-
-		read_ptr++;
-		nbytes -= this_size;
-	}
+	mem_ap_read_unpack(ap, buffer, size, adr, addrinc, read_buf, nbytes);
 
 	free(read_buf);
 	return retval;
@@ -743,6 +1118,79 @@ int mem_ap_write_buf_noincr(struct adiv5_ap *ap,
 	return mem_ap_write(ap, buffer, size, count, address, false);
 }
 
+/**
+ * Synchronous read of several blocks of memory. All the blocks are queued
+ * before a single dap_run(), instead of one run per block.
+ *
+ * @param ap The MEM-AP to access.
+ * @param ranges The blocks to read, see mem_ap_read_buf() for their fields.
+ * @param num_ranges Number of entries in ranges.
+ * @return ERROR_OK on success, otherwise an error code. On error the content
+ *	of all the buffers is undefined.
+ */
+int mem_ap_read_buf_sg(struct adiv5_ap *ap, struct target_memory_sg *ranges,
+		unsigned int num_ranges)
+{
+	uint32_t **read_bufs = calloc(num_ranges, sizeof(*read_bufs));
+	if (!read_bufs) {
+		LOG_ERROR("Failed to allocate read buffer");
+		return ERROR_FAIL;
+	}
+
+	int retval = ERROR_OK;
+	for (unsigned int i = 0; i < num_ranges && retval == ERROR_OK; i++)
+		retval = mem_ap_queue_read(ap, ranges[i].size, ranges[i].count,
+				ranges[i].address, true, &read_bufs[i]);
+
+	if (retval == ERROR_OK)
+		retval = dap_run(ap->dap);
+
+	for (unsigned int i = 0; i < num_ranges; i++) {
+		if (!read_bufs[i])
+			continue;
+		if (retval == ERROR_OK)
+			mem_ap_read_unpack(ap, ranges[i].buffer, ranges[i].size, ranges[i].address,
+					true, read_bufs[i], ranges[i].size * ranges[i].count);
+		free(read_bufs[i]);
+	}
+	free(read_bufs);
+
+	if (retval != ERROR_OK)
+		LOG_ERROR("Failed to read %u memory blocks", num_ranges);
+
+	return retval;
+}
+
+/**
+ * Synchronous write of several blocks of memory. All the blocks are queued
+ * before a single dap_run(), instead of one run per block.
+ *
+ * @param ap The MEM-AP to access.
+ * @param ranges The blocks to write, see mem_ap_write_buf() for their fields.
+ *	The buffers are only read.
+ * @param num_ranges Number of entries in ranges.
+ * @return ERROR_OK on success, otherwise an error code.
+ */
+int mem_ap_write_buf_sg(struct adiv5_ap *ap, const struct target_memory_sg *ranges,
+		unsigned int num_ranges)
+{
+	int retval = ERROR_OK;
+	for (unsigned int i = 0; i < num_ranges && retval == ERROR_OK; i++)
+		retval = mem_ap_queue_write(ap, ranges[i].buffer, ranges[i].size,
+				ranges[i].count, ranges[i].address, true);
+
+	if (retval == ERROR_TARGET_UNALIGNED_ACCESS || retval == ERROR_TARGET_SIZE_NOT_SUPPORTED)
+		return retval;
+
+	if (retval == ERROR_OK)
+		retval = dap_run(ap->dap);
+
+	if (retval != ERROR_OK)
+		mem_ap_report_write_error(ap);
+
+	return retval;
+}
+
 /*--------------------------------------------------------------------------*/
 
 
@@ -885,6 +1333,8 @@ int dap_dp_init_or_reconnect(struct adiv5_dap *dap)
  *
  * @param ap The MEM-AP being initialized.
  */
+static int mem_ap_probe_tar_autoincr_block(struct adiv5_ap *ap);
+
 int mem_ap_init(struct adiv5_ap *ap)
 {
 	/* check that we support packed transfers */
@@ -934,6 +1384,13 @@ int mem_ap_init(struct adiv5_ap *ap)
 	LOG_DEBUG("MEM_AP CFG: large data %d, long address %d, big-endian %d",
 			!!(cfg & MEM_AP_REG_CFG_LD), !!(cfg & MEM_AP_REG_CFG_LA), !!(cfg & MEM_AP_REG_CFG_BE));
 
+	if (dap->tar_autoincr_probe && !ap->tar_autoincr_block_probed) {
+		/* Not fatal, the default block size is always safe */
+		if (mem_ap_probe_tar_autoincr_block(ap) != ERROR_OK)
+			LOG_DEBUG("AP#0x%" PRIx64 " cannot probe TAR autoincrement block", ap->ap_num);
+		ap->tar_autoincr_block_probed = true;
+	}
+
 	return ERROR_OK;
 }
 
@@ -1100,6 +1557,68 @@ bool is_ap_num_valid(struct adiv5_dap *dap, uint64_t ap_num)
 	return false;
 }
 
+/* Result of an earlier dap_find_get_ap() */
+struct dap_find_ap_cache_entry {
+	struct list_head lh;
+	enum ap_type type;
+	uint64_t ap_num;
+};
+
+static int dap_read_ap_idr(struct adiv5_ap *ap, uint32_t *id_val)
+{
+	int retval = dap_queue_ap_read(ap, AP_REG_IDR(ap->dap), id_val);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return dap_run(ap->dap);
+}
+
+/*
+ * Check the AP found by a previous search for the same type. A single IDR
+ * read replaces the scan of all the lower AP numbers.
+ */
+static struct adiv5_ap *dap_find_get_cached_ap(struct adiv5_dap *dap, enum ap_type type_to_find)
+{
+	struct dap_find_ap_cache_entry *entry;
+
+	list_for_each_entry(entry, &dap->find_ap_cache, lh) {
+		if (entry->type != type_to_find)
+			continue;
+
+		struct adiv5_ap *ap = dap_get_ap(dap, entry->ap_num);
+		if (ap) {
+			uint32_t id_val = 0;
+			int retval = dap_read_ap_idr(ap, &id_val);
+			if (retval == ERROR_OK && (id_val & AP_TYPE_MASK) == type_to_find) {
+				LOG_DEBUG("Found %s at cached AP index: %" PRIu64 " (IDR=0x%08" PRIX32 ")",
+						ap_type_to_description(type_to_find),
+						entry->ap_num, id_val);
+				return ap;
+			}
+			dap_put_ap(ap);
+		}
+
+		LOG_DEBUG("Cached AP index %" PRIu64 " is no longer a %s",
+				entry->ap_num, ap_type_to_description(type_to_find));
+		list_del(&entry->lh);
+		free(entry);
+		return NULL;
+	}
+
+	return NULL;
+}
+
+static void dap_find_ap_cache_add(struct adiv5_dap *dap, enum ap_type type, uint64_t ap_num)
+{
+	struct dap_find_ap_cache_entry *entry = malloc(sizeof(*entry));
+	if (!entry)
+		return; /* only a missed optimization */
+
+	entry->type = type;
+	entry->ap_num = ap_num;
+	list_add_tail(&entry->lh, &dap->find_ap_cache);
+}
+
 /*
  * This function checks the ID for each access port to find the requested Access Port type
  * It also calls dap_get_ap() to increment the AP refcount
@@ -1112,6 +1631,12 @@ int dap_find_get_ap(struct adiv5_dap *dap, enum ap_type type_to_find, struct adi
 		return ERROR_FAIL;
 	}
 
+	struct adiv5_ap *cached_ap = dap_find_get_cached_ap(dap, type_to_find);
+	if (cached_ap) {
+		*ap_out = cached_ap;
+		return ERROR_OK;
+	}
+
 	/* Maximum AP number is 255 since the SELECT register is 8 bits */
 	for (unsigned int ap_num = 0; ap_num <= DP_APSEL_MAX; ap_num++) {
 		struct adiv5_ap *ap = dap_get_ap(dap, ap_num);
@@ -1137,6 +1662,7 @@ int dap_find_get_ap(struct adiv5_dap *dap, enum ap_type type_to_find, struct adi
 						ap_type_to_description(type_to_find),
 						ap_num, id_val);
 
+			dap_find_ap_cache_add(dap, type_to_find, ap_num);
 			*ap_out = ap;
 			return ERROR_OK;
 		}
@@ -1221,6 +1747,7 @@ int dap_put_ap(struct adiv5_ap *ap)
 		ap->ap_num = DP_APSEL_INVALID;
 		ap->memaccess_tck = 255;
 		ap->tar_autoincr_block = (1 << 10);
+		ap->tar_autoincr_block_probed = false;
 		ap->csw_default = CSW_AHB_DEFAULT;
 		ap->cfg_reg = MEM_AP_REG_CFG_INVALID;
 	}
@@ -1723,6 +2250,69 @@ static int dap_devtype_display(struct command_invocation *cmd, uint32_t devtype)
 	return ERROR_OK;
 }
 
+/**
+ * Find the size of the TAR autoincrement block of a MEM-AP, up to 4 KiB.
+ * Let TAR increment across the 1 KiB and 2 KiB boundaries of the ROM table
+ * pointed by BASE and read TAR back: it wraps at the end of the block.
+ * The ROM table is 4 KiB in size and reading it has no side effects.
+ * A larger block is not detected, but is never needed inside a 4 KiB page.
+ */
+static int mem_ap_probe_tar_autoincr_block(struct adiv5_ap *ap)
+{
+	target_addr_t dbgbase, invalid_entry;
+	uint32_t apid;
+	int retval = dap_get_debugbase(ap, &dbgbase, &apid);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (is_64bit_ap(ap))
+		invalid_entry = 0xFFFFFFFFFFFFFFFFull;
+	else
+		invalid_entry = 0xFFFFFFFFul;
+
+	if (dbgbase == invalid_entry || (dbgbase & 0x3) == 0x2)
+		return ERROR_FAIL;
+
+	target_addr_t rom_base = dbgbase & 0xFFFFFFFFFFFFF000ull;
+	struct cs_component_vals v;
+	retval = rtp_read_cs_regs(CS_ACCESS_MEM_AP, ap, rom_base, &v);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (!is_valid_arm_cs_cidr(v.cid))
+		return ERROR_FAIL;
+	const unsigned int class = ARM_CS_CIDR_CLASS(v.cid);
+	if (class != ARM_CS_CLASS_0X1_ROM_TABLE
+			&& !(class == ARM_CS_CLASS_0X9_CS_COMPONENT
+				&& (v.devarch & ARM_CS_C9_DEVARCH_PRESENT)
+				&& (v.devarch & DEVARCH_ID_MASK) == DEVARCH_ROM_C_0X9))
+		return ERROR_FAIL;
+
+	uint32_t block = ap->tar_autoincr_block;
+	for (uint32_t size = block; size < 4096; size <<= 1) {
+		uint32_t dummy;
+		target_addr_t tar;
+
+		/* The access at the end of the block increments TAR past it, unless it wraps */
+		retval = mem_ap_setup_transfer(ap, CSW_32BIT | CSW_ADDRINC_SINGLE, rom_base + size - 4);
+		if (retval == ERROR_OK)
+			retval = dap_queue_ap_read(ap, MEM_AP_REG_DRW(ap->dap), &dummy);
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_tar(ap, &tar);
+		if (retval != ERROR_OK)
+			return retval;
+
+		if (tar != rom_base + size)
+			break;
+		block = size << 1;
+	}
+
+	LOG_DEBUG("AP#0x%" PRIx64 " TAR autoincrement block: %" PRIu32 " bytes", ap->ap_num, block);
+	ap->tar_autoincr_block = block;
+
+	return ERROR_OK;
+}
+
 /**
  * Actions/operations to be executed while parsing ROM tables.
  */
@@ -2251,6 +2841,7 @@ struct dap_lookup_data {
 	/* output */
 	uint64_t component_base;
 	uint64_t ap_num;
+	struct cs_component_vals vals;
 };
 
 static int dap_lookup_cs_component_cs_component(int retval,
@@ -2280,9 +2871,116 @@ static int dap_lookup_cs_component_cs_component(int retval,
 	/* Found! */
 	lookup->component_base = v->component_base;
 	lookup->ap_num = v->ap->ap_num;
+	lookup->vals = *v;
 	return CORESIGHT_COMPONENT_FOUND;
 }
 
+/*
+ * Result of an earlier dap_lookup_cs_component(), together with the ID
+ * registers of the ROM table root and of the component found. Re-reading
+ * these is enough to trust the result again, without a new ROM table walk.
+ */
+struct dap_cs_lookup_cache_entry {
+	struct list_head lh;
+	uint64_t ap_num;
+	unsigned int type;
+	unsigned int idx;
+	struct cs_component_vals root;
+	struct cs_component_vals found;
+};
+
+/* Read the ID registers of the root of the ROM table walked by rtp_ap() */
+static int dap_read_rom_root(struct adiv5_ap *ap, struct cs_component_vals *v)
+{
+	if (is_adiv6(ap->dap))
+		return rtp_read_cs_regs(CS_ACCESS_AP, ap, 0, v);
+
+	target_addr_t dbgbase, invalid_entry;
+	uint32_t apid;
+	int retval = dap_get_debugbase(ap, &dbgbase, &apid);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (is_64bit_ap(ap))
+		invalid_entry = 0xFFFFFFFFFFFFFFFFull;
+	else
+		invalid_entry = 0xFFFFFFFFul;
+
+	if (apid == 0 || dbgbase == invalid_entry || (dbgbase & 0x3) == 0x2)
+		return ERROR_FAIL;
+
+	return rtp_read_cs_regs(CS_ACCESS_MEM_AP, ap, dbgbase & 0xFFFFFFFFFFFFF000ull, v);
+}
+
+static bool cs_component_vals_match(const struct cs_component_vals *a,
+		const struct cs_component_vals *b)
+{
+	return a->component_base == b->component_base
+		&& a->pid == b->pid
+		&& a->cid == b->cid
+		&& a->devarch == b->devarch
+		&& a->devtype_memtype == b->devtype_memtype;
+}
+
+static int dap_lookup_cs_component_cached(struct adiv5_ap *ap, uint8_t type,
+		unsigned int idx, const struct cs_component_vals *root, target_addr_t *addr)
+{
+	struct adiv5_dap *dap = ap->dap;
+	struct dap_cs_lookup_cache_entry *entry;
+
+	list_for_each_entry(entry, &dap->cs_lookup_cache, lh) {
+		if (entry->ap_num != ap->ap_num || entry->type != type || entry->idx != idx)
+			continue;
+
+		struct cs_component_vals v;
+		int retval = ERROR_FAIL;
+		if (cs_component_vals_match(&entry->root, root))
+			retval = rtp_read_cs_regs(entry->found.mode, ap, entry->found.component_base, &v);
+		if (retval == ERROR_OK && cs_component_vals_match(&entry->found, &v)) {
+			LOG_DEBUG("CS lookup found in cache at 0x%" PRIx64, entry->found.component_base);
+			*addr = entry->found.component_base;
+			return ERROR_OK;
+		}
+
+		LOG_DEBUG("CS lookup cache entry at 0x%" PRIx64 " is stale", entry->found.component_base);
+		list_del(&entry->lh);
+		free(entry);
+		return ERROR_FAIL;
+	}
+
+	return ERROR_FAIL;
+}
+
+static void dap_cs_lookup_cache_add(struct adiv5_ap *ap, uint8_t type, unsigned int idx,
+		const struct cs_component_vals *root, const struct cs_component_vals *found)
+{
+	struct dap_cs_lookup_cache_entry *entry = malloc(sizeof(*entry));
+	if (!entry)
+		return; /* only a missed optimization */
+
+	entry->ap_num = ap->ap_num;
+	entry->type = type;
+	entry->idx = idx;
+	entry->root = *root;
+	entry->found = *found;
+	list_add_tail(&entry->lh, &ap->dap->cs_lookup_cache);
+}
+
+void dap_topology_cache_free(struct adiv5_dap *dap)
+{
+	struct dap_find_ap_cache_entry *ap_entry, *ap_tmp;
+	list_for_each_entry_safe(ap_entry, ap_tmp, &dap->find_ap_cache, lh) {
+		list_del(&ap_entry->lh);
+		free(ap_entry);
+	}
+
+	struct dap_cs_lookup_cache_entry *cs_entry, *cs_tmp;
+	list_for_each_entry_safe(cs_entry, cs_tmp, &dap->cs_lookup_cache, lh) {
+		list_del(&cs_entry->lh);
+		free(cs_entry);
+	}
+}
+
 int dap_lookup_cs_component(struct adiv5_ap *ap, uint8_t type,
 		target_addr_t *addr, int32_t core_id)
 {
@@ -2298,6 +2996,11 @@ int dap_lookup_cs_component(struct adiv5_ap *ap, uint8_t type,
 		.priv            = &lookup,
 	};
 
+	struct cs_component_vals root;
+	bool root_valid = dap_read_rom_root(ap, &root) == ERROR_OK;
+	if (root_valid && dap_lookup_cs_component_cached(ap, type, core_id, &root, addr) == ERROR_OK)
+		return ERROR_OK;
+
 	int retval = rtp_ap(&dap_lookup_cs_component_ops, ap, 0);
 	if (retval == CORESIGHT_COMPONENT_FOUND) {
 		if (lookup.ap_num != ap->ap_num) {
@@ -2305,6 +3008,8 @@ int dap_lookup_cs_component(struct adiv5_ap *ap, uint8_t type,
 			LOG_DEBUG("CS lookup ended in AP # 0x%" PRIx64 ". Ignore it", lookup.ap_num);
 			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
 		}
+		if (root_valid)
+			dap_cs_lookup_cache_add(ap, type, core_id, &root, &lookup.vals);
 		LOG_DEBUG("CS lookup found at 0x%" PRIx64, lookup.component_base);
 		*addr = lookup.component_base;
 		return ERROR_OK;
@@ -2892,6 +3597,13 @@ COMMAND_HANDLER(dap_ti_be_32_quirks_command)
 		"TI BE-32 quirks mode");
 }
 
+COMMAND_HANDLER(dap_tar_autoincr_probe_command)
+{
+	struct adiv5_dap *dap = adiv5_get_dap(CMD_DATA);
+	return CALL_COMMAND_HANDLER(handle_command_parse_bool, &dap->tar_autoincr_probe,
+		"TAR autoincrement block probe");
+}
+
 COMMAND_HANDLER(dap_nu_npcx_quirks_command)
 {
 	struct adiv5_dap *dap = adiv5_get_dap(CMD_DATA);
@@ -2978,5 +3690,12 @@ const struct command_registration dap_instance_commands[] = {
 		.help = "set/get quirks mode for Nuvoton NPCX controllers",
 		.usage = "[enable]",
 	},
+	{
+		.name = "tar_autoincr_probe",
+		.handler = dap_tar_autoincr_probe_command,
+		.mode = COMMAND_ANY,
+		.help = "set/get probing of the TAR autoincrement block size of MEM-APs",
+		.usage = "[enable]",
+	},
 	COMMAND_REGISTRATION_DONE
 };
@@ -20,6 +20,7 @@
  * resources accessed through a MEM-AP.
  */
 
+#include <helper/event_log.h>
 #include <helper/list.h>
 #include "arm_jtag.h"
 #include "helper/bits.h"
@@ -308,6 +309,9 @@ struct adiv5_ap {
 	/* Size of TAR autoincrement block, ARM ADI Specification requires at least 10 bits */
 	uint32_t tar_autoincr_block;
 
+	/* true if tar_autoincr_block has been probed on the ROM table of the MEM-AP */
+	bool tar_autoincr_block_probed;
+
 	/* true if packed transfers are supported by the MEM-AP */
 	bool packed_transfers_supported;
 	bool packed_transfers_probed;
@@ -357,6 +361,12 @@ struct adiv5_dap {
 	/* number of dap_cmd objects in the pool */
 	size_t cmd_pool_size;
 
+	/* APs found by dap_find_get_ap(), revalidated before reuse */
+	struct list_head find_ap_cache;
+
+	/* components found by dap_lookup_cs_component(), revalidated before reuse */
+	struct list_head cs_lookup_cache;
+
 	struct jtag_tap *tap;
 	/* Control config */
 	uint32_t dp_ctrl_stat;
@@ -401,6 +411,19 @@ struct adiv5_dap {
 	 * The work around is to repeat the data in all 4 bytes of DRW */
 	bool nu_npcx_quirks;
 
+	/** Probe the size of the TAR autoincrement block of each MEM-AP */
+	bool tar_autoincr_probe;
+
+	/** Nesting level of dap_defer_atomic_begin() sections */
+	unsigned int defer_atomic;
+	/** Nesting level of dap_batch_begin() sections */
+	unsigned int batch;
+
+	/** An atomic write was deferred and has not been run yet */
+	bool deferred_write_pending;
+	/** Address of the first pending deferred write, to report its failure */
+	target_addr_t deferred_write_address;
+
 	/**
 	 * STLINK adapter need to know if last AP operation was read or write, and
 	 * in case of write has to flush it with a dummy read from DP_RDBUFF
@@ -423,6 +446,8 @@ struct adiv5_dap {
 	bool multidrop_dp_id_valid;
 	/** TINSTANCE field of multidrop_targetsel has been configured */
 	bool multidrop_instance_id_valid;
+	/** SWD multidrop check generation when DPIDR and DLPIDR were last checked, 0 if never */
+	unsigned int multidrop_check_gen;
 
 	/**
 	 * Record if enter in SWD required passing through DORMANT
@@ -467,6 +492,14 @@ struct dap_ops {
 	int (*queue_ap_write)(struct adiv5_ap *ap, unsigned reg,
 			uint32_t data);
 
+	/** Optional; @a count reads of the same AP register, as in a
+	 * MEM-AP block read through DRW. */
+	int (*queue_ap_read_buf)(struct adiv5_ap *ap, unsigned int reg,
+			uint32_t *data, unsigned int count);
+	/** Optional; @a count writes of the same AP register. */
+	int (*queue_ap_write_buf)(struct adiv5_ap *ap, unsigned int reg,
+			const uint32_t *data, unsigned int count);
+
 	/** AP operation abort. */
 	int (*queue_ap_abort)(struct adiv5_dap *dap, uint8_t *ack);
 
@@ -618,6 +651,66 @@ static inline int dap_queue_ap_write(struct adiv5_ap *ap,
 	return ap->dap->ops->queue_ap_write(ap, reg, data);
 }
 
+/**
+ * Queue @a count reads of the same AP register, e.g. the DRW of a MEM-AP
+ * with address increment. Adapters able to move a whole block at once
+ * provide queue_ap_read_buf, others get one queue_ap_read per word.
+ *
+ * @param ap The AP used for reading.
+ * @param reg The number of the AP register being read.
+ * @param data Where to store the @a count values (in host endianness).
+ * @param count Number of reads.
+ *
+ * @return ERROR_OK for success, else a fault code.
+ */
+static inline int dap_queue_ap_read_buf(struct adiv5_ap *ap,
+		unsigned int reg, uint32_t *data, unsigned int count)
+{
+	assert(ap->dap->ops);
+	if (!ap->dap->ops->queue_ap_read_buf) {
+		for (unsigned int i = 0; i < count; i++) {
+			int retval = dap_queue_ap_read(ap, reg, data + i);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		return ERROR_OK;
+	}
+	if (ap->refcount == 0) {
+		ap->refcount = 1;
+		LOG_ERROR("BUG: refcount AP#0x%" PRIx64 " used without get", ap->ap_num);
+	}
+	return ap->dap->ops->queue_ap_read_buf(ap, reg, data, count);
+}
+
+/**
+ * Queue @a count writes of the same AP register, see dap_queue_ap_read_buf().
+ *
+ * @param ap The AP used for writing.
+ * @param reg The number of the AP register being written.
+ * @param data The @a count values to write (host endianness).
+ * @param count Number of writes.
+ *
+ * @return ERROR_OK for success, else a fault code.
+ */
+static inline int dap_queue_ap_write_buf(struct adiv5_ap *ap,
+		unsigned int reg, const uint32_t *data, unsigned int count)
+{
+	assert(ap->dap->ops);
+	if (!ap->dap->ops->queue_ap_write_buf) {
+		for (unsigned int i = 0; i < count; i++) {
+			int retval = dap_queue_ap_write(ap, reg, data[i]);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		return ERROR_OK;
+	}
+	if (ap->refcount == 0) {
+		ap->refcount = 1;
+		LOG_ERROR("BUG: refcount AP#0x%" PRIx64 " used without get", ap->ap_num);
+	}
+	return ap->dap->ops->queue_ap_write_buf(ap, reg, data, count);
+}
+
 /**
  * Queue an AP abort operation.  The current AP transaction is aborted,
  * including any update of the transaction counter.  The AP is left in
@@ -635,6 +728,9 @@ static inline int dap_queue_ap_abort(struct adiv5_dap *dap, uint8_t *ack)
 	return dap->ops->queue_ap_abort(dap, ack);
 }
 
+/* Report the failure of a run that included deferred atomic writes */
+int dap_run_deferred_report(struct adiv5_dap *dap, int retval);
+
 /**
  * Perform all queued DAP operations, and clear any errors posted in the
  * CTRL_STAT register when they are done.  Note that if more than one AP
@@ -648,7 +744,12 @@ static inline int dap_queue_ap_abort(struct adiv5_dap *dap, uint8_t *ack)
 static inline int dap_run(struct adiv5_dap *dap)
 {
 	assert(dap->ops);
-	return dap->ops->run(dap);
+	event_log_begin(EVENT_LOG_DAP_RUN, (uint32_t)dap->select);
+	int retval = dap->ops->run(dap);
+	if (dap->deferred_write_pending)
+		retval = dap_run_deferred_report(dap, retval);
+	event_log_end(EVENT_LOG_DAP_RUN, retval);
+	return retval;
 }
 
 static inline int dap_sync(struct adiv5_dap *dap)
@@ -712,6 +813,18 @@ int mem_ap_read_atomic_u32(struct adiv5_ap *ap,
 int mem_ap_write_atomic_u32(struct adiv5_ap *ap,
 		target_addr_t address, uint32_t value);
 
+/* Single word transfer of a batch, see mem_ap_batch_run(). */
+struct mem_ap_batch_access {
+	struct adiv5_ap *ap;
+	target_addr_t address;
+	bool write;
+	/* word to write, or read back */
+	uint32_t value;
+};
+
+/* Synchronous single word transfers on several MEM-APs, one run per DAP. */
+int mem_ap_batch_run(struct mem_ap_batch_access *accesses, unsigned int count);
+
 /* Synchronous MEM-AP memory mapped bus block transfers. */
 int mem_ap_read_buf(struct adiv5_ap *ap,
 		uint8_t *buffer, uint32_t size, uint32_t count, target_addr_t address);
@@ -724,6 +837,13 @@ int mem_ap_read_buf_noincr(struct adiv5_ap *ap,
 int mem_ap_write_buf_noincr(struct adiv5_ap *ap,
 		const uint8_t *buffer, uint32_t size, uint32_t count, target_addr_t address);
 
+/* Synchronous block transfers of several memory ranges in a single run. */
+struct target_memory_sg;
+int mem_ap_read_buf_sg(struct adiv5_ap *ap, struct target_memory_sg *ranges,
+		unsigned int num_ranges);
+int mem_ap_write_buf_sg(struct adiv5_ap *ap, const struct target_memory_sg *ranges,
+		unsigned int num_ranges);
+
 /* Initialisation of the debug system, power domains and registers */
 int dap_dp_init(struct adiv5_dap *dap);
 int dap_dp_init_or_reconnect(struct adiv5_dap *dap);
@@ -762,6 +882,30 @@ static inline bool dap_is_multidrop(struct adiv5_dap *dap)
 int dap_lookup_cs_component(struct adiv5_ap *ap,
 			uint8_t type, target_addr_t *addr, int32_t idx);
 
+/*
+ * Open a section where mem_ap_write_atomic_u32() only queues the write.
+ * Queued writes are run, and their errors checked, by the next read that
+ * needs a value, by any other dap_run() or by dap_defer_atomic_end().
+ * Sections can be nested.
+ */
+void dap_defer_atomic_begin(struct adiv5_dap *dap);
+
+/* Close a section opened by dap_defer_atomic_begin(), running the queue if needed */
+int dap_defer_atomic_end(struct adiv5_dap *dap);
+
+/*
+ * Open a section where, in addition to the atomic writes, the buffer writes
+ * to memory are only queued, see dap_defer_atomic_begin(). Sections can be
+ * nested.
+ */
+void dap_batch_begin(struct adiv5_dap *dap);
+
+/* Close a section opened by dap_batch_begin(), running the queue if needed */
+int dap_batch_end(struct adiv5_dap *dap);
+
+/* Drop the results cached by dap_find_get_ap() and dap_lookup_cs_component() */
+void dap_topology_cache_free(struct adiv5_dap *dap);
+
 struct target;
 
 /* Put debug link into SWD mode */
@@ -49,6 +49,8 @@ static void dap_instance_init(struct adiv5_dap *dap)
 	}
 	INIT_LIST_HEAD(&dap->cmd_journal);
 	INIT_LIST_HEAD(&dap->cmd_pool);
+	INIT_LIST_HEAD(&dap->find_ap_cache);
+	INIT_LIST_HEAD(&dap->cs_lookup_cache);
 }
 
 const char *adiv5_dap_name(struct adiv5_dap *self)
@@ -171,6 +173,7 @@ int dap_cleanup_all(void)
 		if (dap->ops && dap->ops->quit)
 			dap->ops->quit(dap);
 
+		dap_topology_cache_free(dap);
 		free(obj->name);
 		free(obj);
 	}
@@ -492,6 +495,34 @@ COMMAND_HANDLER(handle_dap_info_command)
 	return retval;
 }
 
+static int jim_dap_batch(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
+{
+	if (argc != 2) {
+		Jim_WrongNumArgs(interp, 1, argv, "script");
+		return JIM_ERR;
+	}
+
+	struct arm_dap_object *obj;
+	list_for_each_entry(obj, &all_dap, lh)
+		dap_batch_begin(&obj->dap);
+
+	int e = Jim_EvalObj(interp, argv[1]);
+
+	int retval = ERROR_OK;
+	list_for_each_entry(obj, &all_dap, lh) {
+		int retval2 = dap_batch_end(&obj->dap);
+		if (retval == ERROR_OK)
+			retval = retval2;
+	}
+
+	if (e == JIM_OK && retval != ERROR_OK) {
+		Jim_SetResultString(interp, "dap batch: queued writes failed", -1);
+		return JIM_ERR;
+	}
+
+	return e;
+}
+
 static const struct command_registration dap_subcommand_handlers[] = {
 	{
 		.name = "create",
@@ -522,6 +553,14 @@ static const struct command_registration dap_subcommand_handlers[] = {
 			"or the ADIv6 root ROM table of current target's DAP",
 		.usage = "[ap_num | 'root']",
 	},
+	{
+		.name = "batch",
+		.mode = COMMAND_EXEC,
+		.jim_handler = jim_dap_batch,
+		.usage = "script",
+		.help = "Run script with the memory writes of all DAPs queued, "
+			"until a read needs a value or the script ends",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
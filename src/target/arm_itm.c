@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/**
+ * @file
+ * Decoder of the packets output by the Instrumentation Trace Macrocell
+ * (ITM) and Data Watchpoint and Trace unit (DWT) of Cortex-M cores.
+ *
+ * Relevant specifications from ARM include:
+ *
+ * ARMv7-M Architecture Reference Manual, appendix D4      ARM DDI 0403E
+ * ARMv8-M Architecture Reference Manual, appendix D2      ARM DDI 0553B
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/binarybuffer.h>
+#include "arm_itm.h"
+
+#define ITM_HEADER_SYNC				0x00
+#define ITM_HEADER_OVERFLOW			0x70
+#define ITM_HEADER_GTS1				0x94
+#define ITM_HEADER_GTS2				0xb4
+#define ITM_HEADER_CONTINUATION		0x80
+#define ITM_HEADER_SIZE_MASK		0x03
+#define ITM_HEADER_HARDWARE			0x04
+
+/* A synchronization packet is at least 47 zero bits followed by a one */
+#define ITM_SYNC_ZEROS				5
+#define ITM_SYNC_END				0x80
+
+/* Discriminator IDs of the DWT hardware source packets */
+#define DWT_ID_EVENT_COUNTER		0
+#define DWT_ID_EXCEPTION			1
+#define DWT_ID_PC_SAMPLE			2
+#define DWT_ID_DATA_TRACE_FIRST		8
+#define DWT_ID_DATA_TRACE_LAST		23
+
+void arm_itm_decoder_init(struct arm_itm_decoder *decoder,
+		arm_itm_stimulus_fn stimulus, void *priv)
+{
+	memset(decoder, 0, sizeof(*decoder));
+	decoder->state = ARM_ITM_HEADER;
+	decoder->stimulus = stimulus;
+	decoder->priv = priv;
+}
+
+static void arm_itm_hardware_packet(struct arm_itm_decoder *decoder, unsigned int id)
+{
+	struct arm_itm_stats *stats = &decoder->stats;
+	const uint8_t *payload = decoder->payload;
+
+	switch (id) {
+	case DWT_ID_EVENT_COUNTER:
+		stats->event_counter++;
+		break;
+	case DWT_ID_EXCEPTION:
+		if (decoder->payload_size == 2) {
+			unsigned int number = payload[0] | ((payload[1] & 1) << 8);
+			unsigned int function = (payload[1] >> 4) & 3;
+
+			if (function) {
+				stats->exceptions[number][function - 1]++;
+				break;
+			}
+		}
+		stats->errors++;
+		break;
+	case DWT_ID_PC_SAMPLE:
+		if (decoder->payload_size == 4) {
+			stats->pc_samples++;
+			stats->last_pc = le_to_h_u32(payload);
+		} else if (decoder->payload_size == 1) {
+			stats->pc_samples++;
+			stats->pc_sleep++;
+		} else {
+			stats->errors++;
+		}
+		break;
+	default:
+		if (id >= DWT_ID_DATA_TRACE_FIRST && id <= DWT_ID_DATA_TRACE_LAST)
+			stats->data_trace++;
+		else
+			stats->errors++;
+	}
+}
+
+static void arm_itm_packet(struct arm_itm_decoder *decoder)
+{
+	unsigned int id = decoder->header >> 3;
+
+	if (decoder->header & ITM_HEADER_HARDWARE) {
+		arm_itm_hardware_packet(decoder, id);
+		return;
+	}
+
+	decoder->stats.stimulus[id]++;
+	if (decoder->stimulus)
+		decoder->stimulus(decoder->priv, id, decoder->payload, decoder->payload_size);
+}
+
+static void arm_itm_header(struct arm_itm_decoder *decoder, uint8_t header)
+{
+	if (header == ITM_HEADER_SYNC) {
+		decoder->zeros = 1;
+		decoder->state = ARM_ITM_SYNC;
+	} else if (header == ITM_HEADER_OVERFLOW) {
+		decoder->stats.overflow++;
+	} else if (header & ITM_HEADER_SIZE_MASK) {
+		/* source packet with 1, 2 or 4 bytes of payload */
+		unsigned int size_code = header & ITM_HEADER_SIZE_MASK;
+
+		decoder->header = header;
+		decoder->payload_size = (size_code == 3) ? 4 : size_code;
+		decoder->payload_count = 0;
+		decoder->state = ARM_ITM_PAYLOAD;
+	} else if ((header & 0x0f) == 0 || header == ITM_HEADER_GTS1 ||
+			header == ITM_HEADER_GTS2) {
+		/* local or global timestamp */
+		decoder->stats.timestamps++;
+		if (header & ITM_HEADER_CONTINUATION)
+			decoder->state = ARM_ITM_CONTINUATION;
+	} else if ((header & 0x0b) == 0x08) {
+		/* extension, e.g. the page of the stimulus ports */
+		if (header & ITM_HEADER_CONTINUATION)
+			decoder->state = ARM_ITM_CONTINUATION;
+	} else {
+		decoder->stats.errors++;
+	}
+}
+
+/**
+ * Decode @a size bytes of the ITM/DWT trace stream. Counters are updated
+ * in @a decoder and the stimulus callback is called for each stimulus
+ * port packet, without any allocation.
+ */
+void arm_itm_decode(struct arm_itm_decoder *decoder, const uint8_t *buf, size_t size)
+{
+	for (size_t i = 0; i < size; i++) {
+		uint8_t byte = buf[i];
+
+		switch (decoder->state) {
+		case ARM_ITM_HEADER:
+			arm_itm_header(decoder, byte);
+			break;
+		case ARM_ITM_PAYLOAD:
+			decoder->payload[decoder->payload_count++] = byte;
+			if (decoder->payload_count == decoder->payload_size) {
+				decoder->state = ARM_ITM_HEADER;
+				arm_itm_packet(decoder);
+			}
+			break;
+		case ARM_ITM_CONTINUATION:
+			if (!(byte & ITM_HEADER_CONTINUATION))
+				decoder->state = ARM_ITM_HEADER;
+			break;
+		case ARM_ITM_SYNC:
+			if (byte == ITM_HEADER_SYNC) {
+				decoder->zeros++;
+			} else if (byte == ITM_SYNC_END && decoder->zeros >= ITM_SYNC_ZEROS) {
+				decoder->stats.sync++;
+				decoder->state = ARM_ITM_HEADER;
+			} else {
+				decoder->stats.errors++;
+				decoder->state = ARM_ITM_HEADER;
+				arm_itm_header(decoder, byte);
+			}
+			break;
+		}
+	}
+}
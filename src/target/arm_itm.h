@@ -0,0 +1,74 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_TARGET_ARM_ITM_H
+#define OPENOCD_TARGET_ARM_ITM_H
+
+#include <helper/types.h>
+
+#define ARM_ITM_STIMULUS_PORTS		32
+#define ARM_ITM_EXCEPTIONS			512
+
+/* Function field of an exception trace packet */
+enum arm_itm_exception_event {
+	ARM_ITM_EXCEPTION_ENTER = 0,
+	ARM_ITM_EXCEPTION_EXIT = 1,
+	ARM_ITM_EXCEPTION_RETURN = 2,
+	ARM_ITM_EXCEPTION_EVENTS = 3,
+};
+
+/** Counters of the packets seen by the decoder */
+struct arm_itm_stats {
+	uint64_t sync;
+	uint64_t overflow;
+	uint64_t timestamps;
+	/** reserved headers and packets not matching their header */
+	uint64_t errors;
+	uint64_t stimulus[ARM_ITM_STIMULUS_PORTS];
+	/** DWT event counter packets, one per counter wrap */
+	uint64_t event_counter;
+	uint64_t pc_samples;
+	/** periodic PC samples taken while the core was sleeping */
+	uint64_t pc_sleep;
+	uint32_t last_pc;
+	uint64_t data_trace;
+	uint64_t exceptions[ARM_ITM_EXCEPTIONS][ARM_ITM_EXCEPTION_EVENTS];
+};
+
+/**
+ * Called for the payload of each stimulus port packet, 1, 2 or 4 bytes
+ * in the byte order of the trace stream.
+ */
+typedef void (*arm_itm_stimulus_fn)(void *priv, unsigned int port,
+		const uint8_t *data, unsigned int size);
+
+enum arm_itm_state {
+	ARM_ITM_HEADER,
+	ARM_ITM_PAYLOAD,
+	ARM_ITM_CONTINUATION,
+	ARM_ITM_SYNC,
+};
+
+/**
+ * Streaming decoder of the ITM/DWT protocol of the ARMv7-M and ARMv8-M
+ * architecture. Packets may span calls to arm_itm_decode().
+ */
+struct arm_itm_decoder {
+	enum arm_itm_state state;
+	uint8_t header;
+	uint8_t payload[4];
+	unsigned int payload_size;
+	unsigned int payload_count;
+	/** number of zero bytes of the current synchronization packet */
+	unsigned int zeros;
+
+	arm_itm_stimulus_fn stimulus;
+	void *priv;
+
+	struct arm_itm_stats stats;
+};
+
+void arm_itm_decoder_init(struct arm_itm_decoder *decoder,
+		arm_itm_stimulus_fn stimulus, void *priv);
+void arm_itm_decode(struct arm_itm_decoder *decoder, const uint8_t *buf, size_t size);
+
+#endif /* OPENOCD_TARGET_ARM_ITM_H */
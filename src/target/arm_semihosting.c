@@ -151,7 +151,12 @@ int arm_semihosting_init(struct target *target)
 {
 	struct arm *arm = target_to_arm(target);
 	assert(arm->setup_semihosting);
-	semihosting_common_init(target, arm->setup_semihosting, post_result);
+	int retval = semihosting_common_init(target, arm->setup_semihosting, post_result);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* arm_semihosting() leaves a target waiting for input halted silently */
+	target->semihosting->can_park = true;
 
 	return ERROR_OK;
 }
@@ -371,6 +376,10 @@ int arm_semihosting(struct target *target, int *retval)
 		}
 	}
 
+	/* Stay halted without reporting it until the input arrives */
+	if (semihosting->read_parked)
+		return 1;
+
 	/* Resume if target it is resumable and we are not waiting on a fileio
 	 * operation to complete:
 	 */
@@ -36,6 +36,7 @@
 #include <target/arm_adi_v5.h>
 #include <target/target.h>
 #include <transport/transport.h>
+#include "arm_itm.h"
 #include "arm_tpiu_swo.h"
 
 /* START_DEPRECATED_TPIU */
@@ -86,6 +87,21 @@ struct arm_tpiu_swo_event_action {
 	struct arm_tpiu_swo_event_action *next;
 };
 
+#define ARM_TPIU_SWO_TRACE_BUF_SIZE	4096
+
+/** Output of the data of an ITM stimulus port */
+struct arm_tpiu_swo_itm_port {
+	/** file name, or ':' followed by a TCP port */
+	char *out_filename;
+	FILE *file;
+	bool service;
+	/** track TCP connections */
+	struct list_head connections;
+	/** data collected while decoding the trace buffer */
+	uint8_t buf[ARM_TPIU_SWO_TRACE_BUF_SIZE];
+	size_t len;
+};
+
 struct arm_tpiu_swo_object {
 	struct list_head lh;
 	struct adiv5_mem_ap_spot spot;
@@ -112,6 +128,10 @@ struct arm_tpiu_swo_object {
 	char *out_filename;
 	/** track TCP connections */
 	struct list_head connections;
+	/** decoder of the ITM/DWT packets, when the formatter is disabled */
+	struct arm_itm_decoder itm;
+	/** outputs of the demultiplexed ITM stimulus ports */
+	struct arm_tpiu_swo_itm_port *itm_ports[ARM_ITM_STIMULUS_PORTS];
 	/* START_DEPRECATED_TPIU */
 	bool recheck_ap_cur_target;
 	/* END_DEPRECATED_TPIU */
@@ -123,19 +143,60 @@ struct arm_tpiu_swo_connection {
 };
 
 struct arm_tpiu_swo_priv_connection {
-	struct arm_tpiu_swo_object *obj;
+	struct list_head *connections;
 };
 
 static LIST_HEAD(all_tpiu_swo);
 
-#define ARM_TPIU_SWO_TRACE_BUF_SIZE	4096
+static void arm_tpiu_swo_write_connections(struct list_head *connections,
+		const uint8_t *buf, size_t size)
+{
+	struct arm_tpiu_swo_connection *c;
+
+	list_for_each_entry(c, connections, lh)
+		if (connection_write(c->connection, buf, size) != (int)size)
+			LOG_ERROR("Error writing to connection"); /* FIXME: which connection? */
+}
+
+static void arm_tpiu_swo_itm_flush(struct arm_tpiu_swo_itm_port *port)
+{
+	if (!port->len)
+		return;
+
+	if (port->file) {
+		if (fwrite(port->buf, 1, port->len, port->file) == port->len)
+			fflush(port->file);
+		else
+			LOG_ERROR("Error writing to the ITM stimulus port destination file");
+	}
+
+	if (port->service)
+		arm_tpiu_swo_write_connections(&port->connections, port->buf, port->len);
+
+	port->len = 0;
+}
+
+static void arm_tpiu_swo_itm_stimulus(void *priv, unsigned int port_num,
+		const uint8_t *data, unsigned int size)
+{
+	struct arm_tpiu_swo_object *obj = priv;
+	struct arm_tpiu_swo_itm_port *port = obj->itm_ports[port_num];
+
+	if (!port || (!port->file && !port->service))
+		return;
+
+	if (port->len + size > sizeof(port->buf))
+		arm_tpiu_swo_itm_flush(port);
+
+	memcpy(port->buf + port->len, data, size);
+	port->len += size;
+}
 
 static int arm_tpiu_swo_poll_trace(void *priv)
 {
 	struct arm_tpiu_swo_object *obj = priv;
 	uint8_t buf[ARM_TPIU_SWO_TRACE_BUF_SIZE];
 	size_t size = sizeof(buf);
-	struct arm_tpiu_swo_connection *c;
 
 	int retval = adapter_poll_trace(buf, &size);
 	if (retval != ERROR_OK || !size)
@@ -153,9 +214,16 @@ static int arm_tpiu_swo_poll_trace(void *priv)
 	}
 
 	if (obj->out_filename[0] == ':')
-		list_for_each_entry(c, &obj->connections, lh)
-			if (connection_write(c->connection, buf, size) != (int)size)
-				LOG_ERROR("Error writing to connection"); /* FIXME: which connection? */
+		arm_tpiu_swo_write_connections(&obj->connections, buf, size);
+
+	/* without formatter, the trace is the plain ITM/DWT packet stream */
+	if (!obj->en_formatter) {
+		arm_itm_decode(&obj->itm, buf, size);
+
+		for (unsigned int i = 0; i < ARM_ITM_STIMULUS_PORTS; i++)
+			if (obj->itm_ports[i])
+				arm_tpiu_swo_itm_flush(obj->itm_ports[i]);
+	}
 
 	return ERROR_OK;
 }
@@ -196,6 +264,18 @@ static int arm_tpiu_swo_handle_event(struct arm_tpiu_swo_object *obj, enum arm_t
 	return ERROR_OK;
 }
 
+static void arm_tpiu_swo_close_itm_port(struct arm_tpiu_swo_itm_port *port)
+{
+	if (port->file) {
+		fclose(port->file);
+		port->file = NULL;
+	}
+	if (port->service) {
+		remove_service(TCP_SERVICE_NAME, &port->out_filename[1]);
+		port->service = false;
+	}
+}
+
 static void arm_tpiu_swo_close_output(struct arm_tpiu_swo_object *obj)
 {
 	if (obj->file) {
@@ -204,6 +284,10 @@ static void arm_tpiu_swo_close_output(struct arm_tpiu_swo_object *obj)
 	}
 	if (obj->out_filename[0] == ':')
 		remove_service(TCP_SERVICE_NAME, &obj->out_filename[1]);
+
+	for (unsigned int i = 0; i < ARM_ITM_STIMULUS_PORTS; i++)
+		if (obj->itm_ports[i])
+			arm_tpiu_swo_close_itm_port(obj->itm_ports[i]);
 }
 
 int arm_tpiu_swo_cleanup_all(void)
@@ -238,6 +322,13 @@ int arm_tpiu_swo_cleanup_all(void)
 		if (obj->ap)
 			dap_put_ap(obj->ap);
 
+		for (unsigned int i = 0; i < ARM_ITM_STIMULUS_PORTS; i++) {
+			if (obj->itm_ports[i]) {
+				free(obj->itm_ports[i]->out_filename);
+				free(obj->itm_ports[i]);
+			}
+		}
+
 		free(obj->name);
 		free(obj->out_filename);
 		free(obj);
@@ -249,14 +340,13 @@ int arm_tpiu_swo_cleanup_all(void)
 static int arm_tpiu_swo_service_new_connection(struct connection *connection)
 {
 	struct arm_tpiu_swo_priv_connection *priv = connection->service->priv;
-	struct arm_tpiu_swo_object *obj = priv->obj;
 	struct arm_tpiu_swo_connection *c = malloc(sizeof(*c));
 	if (!c) {
 		LOG_ERROR("Out of memory");
 		return ERROR_FAIL;
 	}
 	c->connection = connection;
-	list_add(&c->lh, &obj->connections);
+	list_add(&c->lh, priv->connections);
 	return ERROR_OK;
 }
 
@@ -279,10 +369,9 @@ static int arm_tpiu_swo_service_input(struct connection *connection)
 static int arm_tpiu_swo_service_connection_closed(struct connection *connection)
 {
 	struct arm_tpiu_swo_priv_connection *priv = connection->service->priv;
-	struct arm_tpiu_swo_object *obj = priv->obj;
 	struct arm_tpiu_swo_connection *c, *tmp;
 
-	list_for_each_entry_safe(c, tmp, &obj->connections, lh)
+	list_for_each_entry_safe(c, tmp, priv->connections, lh)
 		if (c->connection == connection) {
 			list_del(&c->lh);
 			free(c);
@@ -595,8 +684,44 @@ static const struct service_driver arm_tpiu_swo_service_driver = {
 	.input_handler = arm_tpiu_swo_service_input,
 	.connection_closed_handler = arm_tpiu_swo_service_connection_closed,
 	.keep_client_alive_handler = NULL,
+	.flush_output_handler = NULL,
 };
 
+static int arm_tpiu_swo_open_itm_port(struct arm_tpiu_swo_object *obj, unsigned int port_num)
+{
+	struct arm_tpiu_swo_itm_port *port = obj->itm_ports[port_num];
+
+	port->len = 0;
+
+	if (port->out_filename[0] == ':') {
+		struct arm_tpiu_swo_priv_connection *priv = malloc(sizeof(*priv));
+		if (!priv) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		priv->connections = &port->connections;
+		LOG_INFO("starting ITM stimulus port %u server for %s on %s", port_num, obj->name,
+			&port->out_filename[1]);
+		int retval = add_service(&arm_tpiu_swo_service_driver, &port->out_filename[1],
+			CONNECTION_LIMIT_UNLIMITED, priv);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("Can't configure ITM stimulus port %u TCP port %s", port_num,
+				&port->out_filename[1]);
+			return retval;
+		}
+		port->service = true;
+	} else {
+		port->file = fopen(port->out_filename, "ab");
+		if (!port->file) {
+			LOG_ERROR("Can't open ITM stimulus port %u destination file \"%s\"", port_num,
+				port->out_filename);
+			return ERROR_FAIL;
+		}
+	}
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_arm_tpiu_swo_enable)
 {
 	struct arm_tpiu_swo_object *obj = CMD_DATA;
@@ -725,7 +850,7 @@ COMMAND_HANDLER(handle_arm_tpiu_swo_enable)
 				LOG_ERROR("Out of memory");
 				return ERROR_FAIL;
 			}
-			priv->obj = obj;
+			priv->connections = &obj->connections;
 			LOG_INFO("starting trace server for %s on %s", obj->name, &obj->out_filename[1]);
 			retval = add_service(&arm_tpiu_swo_service_driver, &obj->out_filename[1],
 				CONNECTION_LIMIT_UNLIMITED, priv);
@@ -765,6 +890,19 @@ COMMAND_HANDLER(handle_arm_tpiu_swo_enable)
 			LOG_INFO("SWO pin data rate adjusted by adapter to %d Hz", swo_pin_freq);
 		obj->swo_pin_freq = swo_pin_freq;
 
+		arm_itm_decoder_init(&obj->itm, arm_tpiu_swo_itm_stimulus, obj);
+		for (unsigned int i = 0; i < ARM_ITM_STIMULUS_PORTS; i++) {
+			if (!obj->itm_ports[i])
+				continue;
+			retval = arm_tpiu_swo_open_itm_port(obj, i);
+			if (retval != ERROR_OK) {
+				command_print(CMD, "Can't open output of ITM stimulus port %u", i);
+				arm_tpiu_swo_close_output(obj);
+				adapter_config_trace(false, 0, 0, NULL, 0, NULL);
+				return retval;
+			}
+		}
+
 		target_register_timer_callback(arm_tpiu_swo_poll_trace, 1,
 			TARGET_TIMER_TYPE_PERIODIC, obj);
 
@@ -868,6 +1006,106 @@ COMMAND_HANDLER(handle_arm_tpiu_swo_disable)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_arm_tpiu_swo_itm_port)
+{
+	struct arm_tpiu_swo_object *obj = CMD_DATA;
+	unsigned int port_num;
+
+	if (CMD_ARGC < 1 || CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], port_num);
+	if (port_num >= ARM_ITM_STIMULUS_PORTS) {
+		command_print(CMD, "ITM stimulus port must be below %u", ARM_ITM_STIMULUS_PORTS);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	struct arm_tpiu_swo_itm_port *port = obj->itm_ports[port_num];
+
+	if (CMD_ARGC == 1) {
+		command_print(CMD, "%s", port ? port->out_filename : "none");
+		return ERROR_OK;
+	}
+
+	if (port) {
+		arm_tpiu_swo_close_itm_port(port);
+		free(port->out_filename);
+		free(port);
+		obj->itm_ports[port_num] = NULL;
+	}
+
+	if (!strcmp(CMD_ARGV[1], "none"))
+		return ERROR_OK;
+
+	port = calloc(1, sizeof(*port));
+	if (!port) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	INIT_LIST_HEAD(&port->connections);
+	port->out_filename = strdup(CMD_ARGV[1]);
+	if (!port->out_filename) {
+		LOG_ERROR("Out of memory");
+		free(port);
+		return ERROR_FAIL;
+	}
+	obj->itm_ports[port_num] = port;
+
+	if (obj->en_capture)
+		return arm_tpiu_swo_open_itm_port(obj, port_num);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_arm_tpiu_swo_itm_stats)
+{
+	struct arm_tpiu_swo_object *obj = CMD_DATA;
+	const struct arm_itm_stats *stats = &obj->itm.stats;
+	static const char * const events[ARM_ITM_EXCEPTION_EVENTS] = {
+		"entered", "exited", "returned to",
+	};
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	command_print(CMD, "sync packets:      %" PRIu64, stats->sync);
+	command_print(CMD, "overflows:         %" PRIu64, stats->overflow);
+	command_print(CMD, "timestamps:        %" PRIu64, stats->timestamps);
+	command_print(CMD, "invalid packets:   %" PRIu64, stats->errors);
+	for (unsigned int i = 0; i < ARM_ITM_STIMULUS_PORTS; i++)
+		if (stats->stimulus[i])
+			command_print(CMD, "stimulus port %-4u %" PRIu64, i, stats->stimulus[i]);
+	command_print(CMD, "event counter:     %" PRIu64, stats->event_counter);
+	command_print(CMD, "PC samples:        %" PRIu64 " (%" PRIu64 " sleeping, last PC 0x%08" PRIx32 ")",
+		stats->pc_samples, stats->pc_sleep, stats->last_pc);
+	command_print(CMD, "data trace:        %" PRIu64, stats->data_trace);
+	for (unsigned int i = 0; i < ARM_ITM_EXCEPTIONS; i++)
+		for (unsigned int j = 0; j < ARM_ITM_EXCEPTION_EVENTS; j++)
+			if (stats->exceptions[i][j])
+				command_print(CMD, "exception %-3u %-11s %" PRIu64, i, events[j],
+					stats->exceptions[i][j]);
+
+	return ERROR_OK;
+}
+
+static const struct command_registration arm_tpiu_swo_itm_command_handlers[] = {
+	{
+		.name = "port",
+		.mode = COMMAND_ANY,
+		.handler = handle_arm_tpiu_swo_itm_port,
+		.usage = "port_num [filename|:port|none]",
+		.help = "Shows or sets the output of the data of an ITM stimulus port",
+	},
+	{
+		.name = "stats",
+		.mode = COMMAND_EXEC,
+		.handler = handle_arm_tpiu_swo_itm_stats,
+		.usage = "",
+		.help = "Shows the counters of the decoded ITM/DWT packets",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
 static const struct command_registration arm_tpiu_swo_instance_command_handlers[] = {
 	{
 		.name = "configure",
@@ -904,6 +1142,13 @@ static const struct command_registration arm_tpiu_swo_instance_command_handlers[
 		.usage = "",
 		.help = "Disables the TPIU/SWO output",
 	},
+	{
+		.name = "itm",
+		.mode = COMMAND_ANY,
+		.help = "ITM/DWT packet decoder command group",
+		.usage = "",
+		.chain = arm_tpiu_swo_itm_command_handlers,
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -959,6 +1204,7 @@ static int jim_arm_tpiu_swo_create(Jim_Interp *interp, int argc, Jim_Obj *const
 		return JIM_ERR;
 	}
 	INIT_LIST_HEAD(&obj->connections);
+	arm_itm_decoder_init(&obj->itm, arm_tpiu_swo_itm_stimulus, obj);
 	adiv5_mem_ap_spot_init(&obj->spot);
 	obj->spot.base = TPIU_SWO_DEFAULT_BASE;
 	obj->port_width = 1;
@@ -20,6 +20,7 @@
 
 #include "arm.h"
 #include "armv4_5.h"
+#include "arm_adi_v5.h"
 #include "arm_jtag.h"
 #include "breakpoints.h"
 #include "arm_disassembler.h"
@@ -805,6 +806,47 @@ int arm_arch_state(struct target *target)
 	return ERROR_OK;
 }
 
+static struct arm_mmu_tlb_entry *arm_mmu_tlb_slot(struct arm *arm, target_addr_t va)
+{
+	return &arm->mmu_tlb[(va >> 12) % ARM_MMU_TLB_SIZE];
+}
+
+/**
+ * Look up the PAR value for the 4 KiB page of @a va, as translated by the
+ * core in its current mode since the last debug entry.
+ */
+bool arm_mmu_tlb_lookup(struct arm *arm, target_addr_t va, uint64_t *par)
+{
+	struct arm_mmu_tlb_entry *e = arm_mmu_tlb_slot(arm, va);
+
+	if (!e->valid || e->mode != arm->core_mode || e->va_page != (va & ~(target_addr_t)0xfff))
+		return false;
+
+	*par = e->par;
+	return true;
+}
+
+void arm_mmu_tlb_insert(struct arm *arm, target_addr_t va, uint64_t par)
+{
+	struct arm_mmu_tlb_entry *e = arm_mmu_tlb_slot(arm, va);
+
+	e->valid = true;
+	e->mode = arm->core_mode;
+	e->va_page = va & ~(target_addr_t)0xfff;
+	e->par = par;
+}
+
+/**
+ * Forget all cached translations. Called on debug entry, the target may
+ * have changed its page tables or context while running, and whenever
+ * the debugger writes a system control register.
+ */
+void arm_mmu_tlb_invalidate(struct arm *arm)
+{
+	for (unsigned int i = 0; i < ARM_MMU_TLB_SIZE; i++)
+		arm->mmu_tlb[i].valid = false;
+}
+
 COMMAND_HANDLER(handle_armv4_5_reg_command)
 {
 	struct target *target = get_current_target(CMD_CTX);
@@ -1077,6 +1119,7 @@ COMMAND_HANDLER(handle_armv4_5_mcrmrc)
 		/* NOTE: parameters reordered! */
 		/* ARMV4_5_MCR(cpnum, op1, 0, crn, crm, op2) */
 		int retval = arm->mcr(target, cpnum, op1, op2, crn, crm, value);
+		arm_mmu_tlb_invalidate(arm);
 		if (retval != ERROR_OK)
 			return retval;
 	} else {
@@ -1165,6 +1208,7 @@ COMMAND_HANDLER(handle_armv4_5_mcrrmrrc)
 		/* NOTE: parameters reordered! */
 		/* ARMV5_T_MCRR(cpnum, op1, crm) */
 		int retval = arm->mcrr(target, cpnum, op1, crm, value);
+		arm_mmu_tlb_invalidate(arm);
 		if (retval != ERROR_OK)
 			return retval;
 	} else {
@@ -1244,6 +1288,116 @@ const struct command_registration arm_all_profiles_command_handlers[] = {
 	COMMAND_REGISTRATION_DONE
 };
 
+/* Physical memory transfers at least this large go through the bulk AP,
+ * smaller ones are not worth the cache maintenance */
+#define ARM_BULK_AP_MIN_SIZE	1024
+
+void arm_bulk_ap_free(struct arm *arm)
+{
+	if (arm->bulk_ap) {
+		dap_put_ap(arm->bulk_ap);
+		arm->bulk_ap = NULL;
+	}
+}
+
+/**
+ * Select the bulk AP of an examined target: none, the one configured, or
+ * the first AXI-AP found on the DAP. Large physical memory transfers use
+ * it, SoCs have a much faster path through a system bus AXI-AP than through
+ * the core debug logic. An AP which cannot be initialized is not used.
+ */
+int arm_bulk_ap_setup(struct target *target)
+{
+	struct arm *arm = target_to_arm(target);
+	struct adiv5_ap *ap = NULL;
+
+	arm_bulk_ap_free(arm);
+
+	switch (arm->bulk_ap_mode) {
+	case ARM_BULK_AP_OFF:
+		return ERROR_OK;
+	case ARM_BULK_AP_AUTO:
+		if (dap_find_get_ap(arm->dap, AP_TYPE_AXI_AP, &ap) != ERROR_OK) {
+			LOG_TARGET_DEBUG(target, "no AXI-AP for bulk transfers");
+			return ERROR_OK;
+		}
+		break;
+	case ARM_BULK_AP_NUM:
+		ap = dap_get_ap(arm->dap, arm->bulk_ap_num);
+		if (!ap) {
+			LOG_TARGET_ERROR(target, "cannot get AP %" PRIu64 " for bulk transfers",
+				arm->bulk_ap_num);
+			return ERROR_FAIL;
+		}
+		break;
+	}
+
+	if (mem_ap_init(ap) != ERROR_OK) {
+		LOG_TARGET_WARNING(target, "AP %" PRIu64 " unusable for bulk transfers", ap->ap_num);
+		dap_put_ap(ap);
+		return ERROR_OK;
+	}
+
+	arm->bulk_ap = ap;
+	LOG_TARGET_INFO(target, "large physical memory transfers through AP %" PRIu64, ap->ap_num);
+
+	return ERROR_OK;
+}
+
+bool arm_bulk_ap_use(struct arm *arm, uint32_t size, uint32_t count)
+{
+	return arm->bulk_ap && (uint64_t)size * count >= ARM_BULK_AP_MIN_SIZE;
+}
+
+COMMAND_HANDLER(handle_arm_bulk_ap_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct arm *arm = target_to_arm(target);
+
+	if (!is_arm(arm) || !arm->dap) {
+		command_print(CMD, "target %s has no DAP", target_name(target));
+		return ERROR_TARGET_INVALID;
+	}
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		if (!strcmp(CMD_ARGV[0], "off")) {
+			arm->bulk_ap_mode = ARM_BULK_AP_OFF;
+		} else if (!strcmp(CMD_ARGV[0], "auto")) {
+			arm->bulk_ap_mode = ARM_BULK_AP_AUTO;
+		} else {
+			COMMAND_PARSE_NUMBER(u64, CMD_ARGV[0], arm->bulk_ap_num);
+			arm->bulk_ap_mode = ARM_BULK_AP_NUM;
+		}
+
+		if (target_was_examined(target)) {
+			int retval = arm_bulk_ap_setup(target);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+	}
+
+	if (arm->bulk_ap)
+		command_print(CMD, "AP %" PRIu64, arm->bulk_ap->ap_num);
+	else
+		command_print(CMD, "none");
+
+	return ERROR_OK;
+}
+
+const struct command_registration arm_bulk_ap_command_handlers[] = {
+	{
+		.name = "bulk_ap",
+		.handler = handle_arm_bulk_ap_command,
+		.mode = COMMAND_ANY,
+		.help = "select the MEM-AP taking large physical memory transfers",
+		.usage = "['off'|'auto'|ap_num]",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
 const struct command_registration arm_command_handlers[] = {
 	{
 		.name = "arm",
@@ -1614,19 +1768,17 @@ int arm_checksum_memory(struct target *target,
 
 	assert(sizeof(arm_crc_code_le) % 4 == 0);
 
-	retval = target_alloc_working_area(target,
-			sizeof(arm_crc_code_le), &crc_algorithm);
-	if (retval != ERROR_OK)
-		return retval;
-
 	/* convert code into a buffer in target endianness */
-	for (i = 0; i < ARRAY_SIZE(arm_crc_code_le) / 4; i++) {
-		retval = target_write_u32(target,
-				crc_algorithm->address + i * sizeof(uint32_t),
+	uint8_t arm_crc_code[sizeof(arm_crc_code_le)];
+	for (i = 0; i < ARRAY_SIZE(arm_crc_code_le) / 4; i++)
+		target_buffer_set_u32(target, &arm_crc_code[i * 4],
 				le_to_h_u32(&arm_crc_code_le[i * 4]));
-		if (retval != ERROR_OK)
-			goto cleanup;
-	}
+
+	/* stays resident, a GDB compare-sections checksums every section */
+	retval = target_alloc_working_area_code(target, arm_crc_code,
+			sizeof(arm_crc_code), &crc_algorithm);
+	if (retval != ERROR_OK)
+		return retval;
 
 	arm_algo.common_magic = ARM_COMMON_MAGIC;
 	arm_algo.core_mode = ARM_MODE_SVC;
@@ -1658,7 +1810,6 @@ int arm_checksum_memory(struct target *target,
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
 
-cleanup:
 	target_free_working_area(target, crc_algorithm);
 
 	return retval;
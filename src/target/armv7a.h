@@ -34,6 +34,8 @@ enum {
 struct armv7a_l2x_cache {
 	uint32_t base;
 	uint32_t way;
+	/* size in bytes, 0 until read from the controller */
+	uint32_t size;
 };
 
 struct armv7a_cachesize {
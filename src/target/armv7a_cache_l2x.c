@@ -36,129 +36,180 @@ static int arm7a_l2x_sanity_check(struct target *target)
 
 	return ERROR_OK;
 }
+static int arm7a_l2x_read_reg(struct target *target, uint32_t address, uint32_t *value)
+{
+	uint8_t buf[4];
+
+	int retval = target_read_phys_memory(target, address, 4, 1, buf);
+	if (retval == ERROR_OK)
+		*value = target_buffer_get_u32(target, buf);
+
+	return retval;
+}
+
 /*
- * clean and invalidate complete l2x cache
+ * start a maintenance operation on all the ways and wait for its end,
+ * the way register reads back 0 once the operation is complete
  */
-int arm7a_l2x_flush_all_data(struct target *target)
+static int arm7a_l2x_way_op(struct target *target, uint32_t way_reg)
 {
 	struct armv7a_common *armv7a = target_to_armv7a(target);
 	struct armv7a_l2x_cache *l2x_cache = (struct armv7a_l2x_cache *)
 		(armv7a->armv7a_mmu.armv7a_cache.outer_cache);
-	uint32_t l2_way_val;
+	uint32_t l2_way_val = (1 << l2x_cache->way) - 1;
 	int retval;
 
-	retval = arm7a_l2x_sanity_check(target);
-	if (retval)
+	retval = target_write_phys_u32(target, l2x_cache->base + way_reg, l2_way_val);
+	if (retval != ERROR_OK)
 		return retval;
 
-	l2_way_val = (1 << l2x_cache->way) - 1;
+	int64_t then = timeval_ms();
+	while (1) {
+		retval = arm7a_l2x_read_reg(target, l2x_cache->base + way_reg, &l2_way_val);
+		if (retval != ERROR_OK)
+			return retval;
+		if (!(l2_way_val & ((1 << l2x_cache->way) - 1)))
+			break;
+		if (timeval_ms() > then + 1000) {
+			LOG_ERROR("timeout waiting for l2x way operation");
+			return ERROR_TARGET_TIMEOUT;
+		}
+	}
 
-	return target_write_phys_u32(target,
-			l2x_cache->base + L2X0_CLEAN_INV_WAY,
-			l2_way_val);
+	return target_write_phys_u32(target, l2x_cache->base + L2X0_CACHE_SYNC, 0);
 }
 
-int armv7a_l2x_cache_flush_virt(struct target *target, target_addr_t virt,
-					uint32_t size)
+/*
+ * size of the cache, the way size is in the auxiliary control register
+ */
+static int arm7a_l2x_cache_size(struct target *target, uint32_t *size)
 {
 	struct armv7a_common *armv7a = target_to_armv7a(target);
 	struct armv7a_l2x_cache *l2x_cache = (struct armv7a_l2x_cache *)
 		(armv7a->armv7a_mmu.armv7a_cache.outer_cache);
-	/* FIXME: different controllers have different linelen? */
-	uint32_t i, linelen = 32;
+	uint32_t aux_ctrl;
 	int retval;
 
-	retval = arm7a_l2x_sanity_check(target);
-	if (retval)
-		return retval;
-
-	for (i = 0; i < size; i += linelen) {
-		target_addr_t pa, offs = virt + i;
-
-		/* FIXME: use less verbose virt2phys? */
-		retval = target->type->virt2phys(target, offs, &pa);
+	if (!l2x_cache->size) {
+		retval = arm7a_l2x_read_reg(target, l2x_cache->base + L2X0_AUX_CTRL, &aux_ctrl);
 		if (retval != ERROR_OK)
-			goto done;
+			return retval;
 
-		retval = target_write_phys_u32(target,
-				l2x_cache->base + L2X0_CLEAN_INV_LINE_PA, pa);
-		if (retval != ERROR_OK)
-			goto done;
+		/* 16KB (1) to 512KB (6 and 7) per way, 0 is reserved as 16KB */
+		uint32_t way_size = (aux_ctrl & L2X0_AUX_CTRL_WAY_SIZE_MASK) >> L2X0_AUX_CTRL_WAY_SIZE_SHIFT;
+		way_size = MIN(MAX(way_size, 1), 6);
+		l2x_cache->size = (8 * 1024 << way_size) * l2x_cache->way;
 	}
-	return retval;
 
-done:
-	LOG_ERROR("d-cache invalidate failed");
-
-	return retval;
+	*size = l2x_cache->size;
+	return ERROR_OK;
 }
 
-static int armv7a_l2x_cache_inval_virt(struct target *target, target_addr_t virt,
-					uint32_t size)
+/*
+ * Operate on each line of the range, by physical address. The writes to the
+ * controller are queued on the system bus MEM-AP when there is one, else they
+ * go through the core. Ranges larger than the cache are cleaned and/or
+ * invalidated by way instead, an invalidation then also cleans not to lose
+ * the dirty lines outside the range.
+ */
+static int armv7a_l2x_cache_op_virt(struct target *target, target_addr_t virt,
+					uint32_t size, uint32_t line_reg, uint32_t way_reg)
 {
 	struct armv7a_common *armv7a = target_to_armv7a(target);
 	struct armv7a_l2x_cache *l2x_cache = (struct armv7a_l2x_cache *)
 		(armv7a->armv7a_mmu.armv7a_cache.outer_cache);
-	/* FIXME: different controllers have different linelen */
-	uint32_t i, linelen = 32;
+	struct adiv5_ap *ap = armv7a->arm.bulk_ap;
+	/* FIXME: different controllers have different linelen? */
+	uint32_t linelen = L2X0_CACHE_LINE_SIZE;
+	uint32_t cache_size;
 	int retval;
 
 	retval = arm7a_l2x_sanity_check(target);
 	if (retval)
 		return retval;
 
-	for (i = 0; i < size; i += linelen) {
-		target_addr_t pa, offs = virt + i;
+	retval = arm7a_l2x_cache_size(target, &cache_size);
+	if (retval != ERROR_OK)
+		return retval;
 
-		/* FIXME: use less verbose virt2phys? */
-		retval = target->type->virt2phys(target, offs, &pa);
-		if (retval != ERROR_OK)
-			goto done;
+	if (size >= cache_size)
+		return arm7a_l2x_way_op(target, way_reg);
 
-		retval = target_write_phys_u32(target,
-				l2x_cache->base + L2X0_INV_LINE_PA, pa);
+	target_addr_t va = virt & ~(target_addr_t)(linelen - 1);
+	target_addr_t va_end = virt + size;
+	target_addr_t page = 1, pa_page = 0;
+
+	for (; va < va_end; va += linelen) {
+		if ((va & ~(target_addr_t)(L2X0_PAGE_SIZE - 1)) != page) {
+			page = va & ~(target_addr_t)(L2X0_PAGE_SIZE - 1);
+			/* FIXME: use less verbose virt2phys? */
+			retval = target->type->virt2phys(target, page, &pa_page);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+
+		uint32_t pa = pa_page + (va - page);
+		if (ap)
+			retval = mem_ap_write_u32(ap, l2x_cache->base + line_reg, pa);
+		else
+			retval = target_write_phys_u32(target, l2x_cache->base + line_reg, pa);
 		if (retval != ERROR_OK)
-			goto done;
+			return retval;
 	}
-	return retval;
 
-done:
-	LOG_ERROR("d-cache invalidate failed");
+	if (ap) {
+		retval = mem_ap_write_u32(ap, l2x_cache->base + L2X0_CACHE_SYNC, 0);
+		if (retval == ERROR_OK)
+			retval = dap_run(ap->dap);
+		return retval;
+	}
 
-	return retval;
+	return target_write_phys_u32(target, l2x_cache->base + L2X0_CACHE_SYNC, 0);
 }
 
-static int armv7a_l2x_cache_clean_virt(struct target *target, target_addr_t virt,
-					unsigned int size)
+/*
+ * clean and invalidate complete l2x cache
+ */
+int arm7a_l2x_flush_all_data(struct target *target)
 {
-	struct armv7a_common *armv7a = target_to_armv7a(target);
-	struct armv7a_l2x_cache *l2x_cache = (struct armv7a_l2x_cache *)
-		(armv7a->armv7a_mmu.armv7a_cache.outer_cache);
-	/* FIXME: different controllers have different linelen */
-	uint32_t i, linelen = 32;
 	int retval;
 
 	retval = arm7a_l2x_sanity_check(target);
 	if (retval)
 		return retval;
 
-	for (i = 0; i < size; i += linelen) {
-		target_addr_t pa, offs = virt + i;
+	return arm7a_l2x_way_op(target, L2X0_CLEAN_INV_WAY);
+}
+
+int armv7a_l2x_cache_flush_virt(struct target *target, target_addr_t virt,
+					uint32_t size)
+{
+	int retval = armv7a_l2x_cache_op_virt(target, virt, size,
+			L2X0_CLEAN_INV_LINE_PA, L2X0_CLEAN_INV_WAY);
+	if (retval != ERROR_OK)
+		LOG_ERROR("d-cache invalidate failed");
 
-		/* FIXME: use less verbose virt2phys? */
-		retval = target->type->virt2phys(target, offs, &pa);
-		if (retval != ERROR_OK)
-			goto done;
+	return retval;
+}
+
+static int armv7a_l2x_cache_inval_virt(struct target *target, target_addr_t virt,
+					uint32_t size)
+{
+	int retval = armv7a_l2x_cache_op_virt(target, virt, size,
+			L2X0_INV_LINE_PA, L2X0_CLEAN_INV_WAY);
+	if (retval != ERROR_OK)
+		LOG_ERROR("d-cache invalidate failed");
 
-		retval = target_write_phys_u32(target,
-				l2x_cache->base + L2X0_CLEAN_LINE_PA, pa);
-		if (retval != ERROR_OK)
-			goto done;
-	}
 	return retval;
+}
 
-done:
-	LOG_ERROR("d-cache invalidate failed");
+static int armv7a_l2x_cache_clean_virt(struct target *target, target_addr_t virt,
+					unsigned int size)
+{
+	int retval = armv7a_l2x_cache_op_virt(target, virt, size,
+			L2X0_CLEAN_LINE_PA, L2X0_CLEAN_WAY);
+	if (retval != ERROR_OK)
+		LOG_ERROR("d-cache clean failed");
 
 	return retval;
 }
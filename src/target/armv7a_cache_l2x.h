@@ -9,6 +9,8 @@
 #define OPENOCD_TARGET_ARM7A_CACHE_L2X_H
 
 #define L2X0_CACHE_LINE_SIZE		32
+/* smallest translation granule, one virt2phys per page */
+#define L2X0_PAGE_SIZE			4096
 
 /* source: linux/arch/arm/include/asm/hardware/cache-l2x0.h */
 #define L2X0_CACHE_ID			0x000
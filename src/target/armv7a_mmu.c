@@ -33,6 +33,13 @@ int armv7a_mmu_translate_va_pa(struct target *target, uint32_t va,
 	uint32_t virt = va & ~0xfff, value;
 	uint32_t NOS, NS, INNER, OUTER, SS;
 	*val = 0xdeadbeef;
+
+	uint64_t par;
+	if (arm_mmu_tlb_lookup(&armv7a->arm, virt, &par)) {
+		value = par;
+		goto decode;
+	}
+
 	retval = dpm->prepare(dpm);
 	if (retval != ERROR_OK)
 		goto done;
@@ -48,7 +55,13 @@ int armv7a_mmu_translate_va_pa(struct target *target, uint32_t va,
 			&value);
 	if (retval != ERROR_OK)
 		goto done;
+	dpm->finish(dpm);
 
+	/* faults are not cached, the tables may be fixed up by the user */
+	if (!(value & 1))
+		arm_mmu_tlb_insert(&armv7a->arm, virt, value);
+
+decode:
 	/* decode memory attribute */
 	SS = (value >> 1) & 1;
 	NOS = (value >> 10) & 1;	/*  Not Outer shareable */
@@ -110,6 +123,8 @@ int armv7a_mmu_translate_va_pa(struct target *target, uint32_t va,
 		}
 	}
 
+	return ERROR_OK;
+
 done:
 	dpm->finish(dpm);
 
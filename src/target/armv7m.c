@@ -35,6 +35,7 @@
 #include "semihosting_common.h"
 #include <helper/log.h>
 #include <helper/binarybuffer.h>
+#include <helper/lz4.h>
 
 #if 0
 #define _DEBUG_INSTRUCTION_EXECUTION_
@@ -529,6 +530,9 @@ int armv7m_start_algorithm(struct target *target,
 		return ERROR_TARGET_NOT_HALTED;
 	}
 
+	/* Fetch the registers which are read on demand in one batch */
+	target_read_all_core_regs(target, REG_CLASS_ALL);
+
 	/* Store all non-debug execution registers to armv7m_algorithm_info context */
 	for (unsigned i = 0; i < armv7m->arm.core_cache->num_regs; i++) {
 		struct reg *reg = &armv7m->arm.core_cache->reg_list[i];
@@ -891,15 +895,12 @@ int armv7m_checksum_memory(struct target *target,
 #include "../../contrib/loaders/checksum/armv7m_crc.inc"
 	};
 
-	retval = target_alloc_working_area(target, sizeof(cortex_m_crc_code), &crc_algorithm);
+	/* stays resident, a GDB compare-sections checksums every section */
+	retval = target_alloc_working_area_code(target, cortex_m_crc_code,
+			sizeof(cortex_m_crc_code), &crc_algorithm);
 	if (retval != ERROR_OK)
 		return retval;
 
-	retval = target_write_buffer(target, crc_algorithm->address,
-			sizeof(cortex_m_crc_code), (uint8_t *)cortex_m_crc_code);
-	if (retval != ERROR_OK)
-		goto cleanup;
-
 	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
 	armv7m_info.core_mode = ARM_MODE_THREAD;
 
@@ -923,12 +924,284 @@ int armv7m_checksum_memory(struct target *target,
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
 
-cleanup:
 	target_free_working_area(target, crc_algorithm);
 
 	return retval;
 }
 
+/** Finds the first occurrence of a byte pattern in memory. */
+int armv7m_search_memory(struct target *target, target_addr_t address,
+	uint32_t size, const uint8_t *pattern, uint32_t length,
+	target_addr_t *match, bool *found)
+{
+	struct working_area *search_algorithm;
+	struct working_area *pattern_area;
+	struct armv7m_algorithm armv7m_info;
+	struct reg_param reg_params[4];
+	int retval;
+
+	static const uint8_t search_code[] = {
+#include "../../contrib/loaders/search/armv7m_search.inc"
+	};
+
+	retval = target_alloc_working_area_code(target, search_code, sizeof(search_code),
+			&search_algorithm);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = target_alloc_working_area(target, length, &pattern_area);
+	if (retval != ERROR_OK)
+		goto cleanup1;
+
+	retval = target_write_buffer(target, pattern_area->address, length, pattern);
+	if (retval != ERROR_OK)
+		goto cleanup2;
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_IN_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, address);
+	buf_set_u32(reg_params[1].value, 0, 32, size);
+	buf_set_u32(reg_params[2].value, 0, 32, pattern_area->address);
+	buf_set_u32(reg_params[3].value, 0, 32, length);
+
+	/* assume CPU clk at least 1 MHz, about 10 cycles per byte */
+	unsigned int timeout = 2000 + size / 100;
+
+	retval = target_run_algorithm(target, 0, NULL, ARRAY_SIZE(reg_params), reg_params,
+			search_algorithm->address,
+			search_algorithm->address + (sizeof(search_code) - 2),
+			timeout, &armv7m_info);
+
+	if (retval == ERROR_OK) {
+		*found = buf_get_u32(reg_params[1].value, 0, 32) != 0;
+		if (*found)
+			*match = buf_get_u32(reg_params[0].value, 0, 32);
+	} else {
+		LOG_ERROR("error executing cortex_m search algorithm");
+	}
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(reg_params); i++)
+		destroy_reg_param(&reg_params[i]);
+
+cleanup2:
+	target_free_working_area(target, pattern_area);
+cleanup1:
+	target_free_working_area(target, search_algorithm);
+
+	return retval;
+}
+
+/* assume CPU clk at least 1 MHz, a few cycles per word */
+static unsigned int armv7m_memory_algorithm_timeout(uint32_t count)
+{
+	return 2000 + count / 100;
+}
+
+/** Fills @a count words of memory with @a pattern by running code on target. */
+int armv7m_fill_memory(struct target *target, target_addr_t address,
+	uint32_t pattern, uint32_t count)
+{
+	struct working_area *fill_algorithm;
+	struct armv7m_algorithm armv7m_info;
+	struct reg_param reg_params[3];
+	int retval;
+
+	static const uint8_t fill_code[] = {
+#include "../../contrib/loaders/memory/armv7m_fill.inc"
+	};
+
+	retval = target_alloc_working_area_code(target, fill_code, sizeof(fill_code),
+			&fill_algorithm);
+	if (retval != ERROR_OK)
+		return retval;
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, address);
+	buf_set_u32(reg_params[1].value, 0, 32, count);
+	buf_set_u32(reg_params[2].value, 0, 32, pattern);
+
+	retval = target_run_algorithm(target, 0, NULL, ARRAY_SIZE(reg_params), reg_params,
+			fill_algorithm->address,
+			fill_algorithm->address + (sizeof(fill_code) - 2),
+			armv7m_memory_algorithm_timeout(count), &armv7m_info);
+	if (retval != ERROR_OK)
+		LOG_ERROR("error executing cortex_m fill algorithm");
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(reg_params); i++)
+		destroy_reg_param(&reg_params[i]);
+
+	target_free_working_area(target, fill_algorithm);
+
+	return retval;
+}
+
+/** Copies @a count words of memory from @a src to @a dst by running code on
+ * target. The copy runs upwards, overlapping is only fine with dst below src. */
+int armv7m_copy_memory(struct target *target, target_addr_t dst,
+	target_addr_t src, uint32_t count)
+{
+	struct working_area *copy_algorithm;
+	struct armv7m_algorithm armv7m_info;
+	struct reg_param reg_params[3];
+	int retval;
+
+	static const uint8_t copy_code[] = {
+#include "../../contrib/loaders/memory/armv7m_copy.inc"
+	};
+
+	retval = target_alloc_working_area_code(target, copy_code, sizeof(copy_code),
+			&copy_algorithm);
+	if (retval != ERROR_OK)
+		return retval;
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, dst);
+	buf_set_u32(reg_params[1].value, 0, 32, src);
+	buf_set_u32(reg_params[2].value, 0, 32, count);
+
+	retval = target_run_algorithm(target, 0, NULL, ARRAY_SIZE(reg_params), reg_params,
+			copy_algorithm->address,
+			copy_algorithm->address + (sizeof(copy_code) - 2),
+			armv7m_memory_algorithm_timeout(count), &armv7m_info);
+	if (retval != ERROR_OK)
+		LOG_ERROR("error executing cortex_m copy algorithm");
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(reg_params); i++)
+		destroy_reg_param(&reg_params[i]);
+
+	target_free_working_area(target, copy_algorithm);
+
+	return retval;
+}
+
+/** Writes a buffer sent LZ4 compressed and expanded by a loader on target. */
+int armv7m_write_buffer_compressed(struct target *target,
+	target_addr_t address, uint32_t size, const uint8_t *buffer)
+{
+	struct working_area *lz4_algorithm;
+	struct working_area *source;
+	struct armv7m_algorithm armv7m_info;
+	struct reg_param reg_params[3];
+	int retval;
+
+	static const uint8_t lz4_code[] = {
+#include "../../contrib/loaders/compress/armv7m_lz4.inc"
+	};
+
+	retval = target_alloc_working_area_code(target, lz4_code, sizeof(lz4_code), &lz4_algorithm);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* probably won't benefit from more than 32k ... */
+	uint32_t source_size = MIN(target_get_working_area_avail(target), 32768);
+	if (source_size < 256) {
+		target_free_working_area(target, lz4_algorithm);
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	retval = target_alloc_working_area(target, source_size, &source);
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, lz4_algorithm);
+		return retval;
+	}
+
+	/* the loader and the compressed data must stay out of the destination */
+	if ((address < source->address + source->size && source->address < address + size) ||
+			(address < lz4_algorithm->address + lz4_algorithm->size &&
+			lz4_algorithm->address < address + size)) {
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		goto cleanup;
+	}
+
+	uint8_t *packed = malloc(source_size);
+	if (!packed) {
+		retval = ERROR_FAIL;
+		goto cleanup;
+	}
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_IN_OUT);
+
+	/* largest input whose compressed block always fits the source area */
+	uint32_t chunk_max = (source_size - 16) * 255 / 256;
+	uint32_t sent = 0;
+
+	for (uint32_t done = 0; done < size; done += chunk_max) {
+		uint32_t this_size = MIN(size - done, chunk_max);
+		size_t packed_size = lz4_compress_block(buffer + done, this_size,
+				packed, source_size);
+
+		if (!packed_size || packed_size >= this_size) {
+			/* does not compress, write it as is */
+			retval = target_write_buffer(target, address + done, this_size, buffer + done);
+			if (retval != ERROR_OK)
+				break;
+			sent += this_size;
+			continue;
+		}
+
+		retval = target_write_buffer(target, source->address, packed_size, packed);
+		if (retval != ERROR_OK)
+			break;
+		sent += packed_size;
+
+		buf_set_u32(reg_params[0].value, 0, 32, source->address);
+		buf_set_u32(reg_params[1].value, 0, 32, source->address + packed_size);
+		buf_set_u32(reg_params[2].value, 0, 32, address + done);
+
+		retval = target_run_algorithm(target, 0, NULL, 3, reg_params, lz4_algorithm->address,
+				lz4_algorithm->address + (sizeof(lz4_code) - 2),
+				10000, &armv7m_info);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("error executing cortex_m lz4 algorithm");
+			break;
+		}
+
+		if (buf_get_u32(reg_params[2].value, 0, 32) != address + done + this_size) {
+			LOG_ERROR("lz4 algorithm expanded data to the wrong size");
+			retval = ERROR_FAIL;
+			break;
+		}
+
+		keep_alive();
+	}
+
+	LOG_DEBUG("wrote %" PRIu32 " bytes sending %" PRIu32, size, sent);
+
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+	destroy_reg_param(&reg_params[2]);
+	free(packed);
+
+cleanup:
+	target_free_working_area(target, source);
+	target_free_working_area(target, lz4_algorithm);
+
+	return retval;
+}
+
 /** Checks an array of memory regions whether they are erased. */
 int armv7m_blank_check_memory(struct target *target,
 	struct target_memory_check_block *blocks, int num_blocks, uint8_t erased_value)
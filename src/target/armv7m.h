@@ -343,6 +343,15 @@ int armv7m_checksum_memory(struct target *target,
 		target_addr_t address, uint32_t count, uint32_t *checksum);
 int armv7m_blank_check_memory(struct target *target,
 		struct target_memory_check_block *blocks, int num_blocks, uint8_t erased_value);
+int armv7m_search_memory(struct target *target, target_addr_t address,
+		uint32_t size, const uint8_t *pattern, uint32_t length,
+		target_addr_t *match, bool *found);
+int armv7m_fill_memory(struct target *target, target_addr_t address,
+		uint32_t pattern, uint32_t count);
+int armv7m_copy_memory(struct target *target, target_addr_t dst,
+		target_addr_t src, uint32_t count);
+int armv7m_write_buffer_compressed(struct target *target,
+		target_addr_t address, uint32_t size, const uint8_t *buffer);
 
 int armv7m_maybe_skip_bkpt_inst(struct target *target, bool *inst_found);
 
@@ -1127,6 +1127,11 @@ int armv8_mmu_translate_va_pa(struct target *target, target_addr_t va,
 		return ERROR_TARGET_NOT_HALTED;
 	}
 
+	if (arm_mmu_tlb_lookup(arm, va, &par)) {
+		retval = ERROR_OK;
+		goto decode;
+	}
+
 	retval = dpm->prepare(dpm);
 	if (retval != ERROR_OK)
 		return retval;
@@ -1171,6 +1176,11 @@ int armv8_mmu_translate_va_pa(struct target *target, target_addr_t va,
 	if (retval != ERROR_OK)
 		return retval;
 
+	/* faults are not cached, the tables may be fixed up by the user */
+	if (!(par & 1))
+		arm_mmu_tlb_insert(arm, va, par);
+
+decode:
 	if (par & 1) {
 		LOG_ERROR("Address translation failed at stage %i, FST=%x, PTW=%i",
 				((int)(par >> 9) & 1)+1, (int)(par >> 1) & 0x3f, (int)(par >> 8) & 1);
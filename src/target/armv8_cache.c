@@ -19,6 +19,9 @@
 #define CACHE_LEVEL_HAS_D_CACHE		0x2
 #define CACHE_LEVEL_HAS_I_CACHE		0x1
 
+/* cache maintenance operations queued per DAP transaction */
+#define ARMV8_CACHE_BATCH		64
+
 static int armv8_d_cache_sanity_check(struct armv8_common *armv8)
 {
 	struct armv8_cache_common *armv8_cache = &armv8->armv8_mmu.armv8_cache;
@@ -44,22 +47,27 @@ static int armv8_cache_d_inner_flush_level(struct armv8_common *armv8, struct ar
 	struct arm_dpm *dpm = armv8->arm.dpm;
 	int retval = ERROR_OK;
 	int32_t c_way, c_index = size->index;
+	uint64_t values[ARMV8_CACHE_BATCH];
+	unsigned int n = 0;
 
 	LOG_DEBUG("cl %" PRId32, cl);
 	do {
 		c_way = size->way;
 		do {
-			uint32_t value = (c_index << size->index_shift)
+			values[n++] = (c_index << size->index_shift)
 				| (c_way << size->way_shift) | (cl << 1);
+			c_way -= 1;
+			if (n < ARMV8_CACHE_BATCH && (c_way >= 0 || c_index > 0))
+				continue;
 			/*
 			 * DC CISW - Clean and invalidate data cache
 			 * line by Set/Way.
 			 */
-			retval = dpm->instr_write_data_r0(dpm,
-					armv8_opcode(armv8, ARMV8_OPC_DCCISW), value);
+			retval = armv8_dpm_instr_write_data_r0_batch(dpm,
+					armv8_opcode(armv8, ARMV8_OPC_DCCISW), values, n);
 			if (retval != ERROR_OK)
 				goto done;
-			c_way -= 1;
+			n = 0;
 		} while (c_way >= 0);
 		c_index -= 1;
 	} while (c_index >= 0);
@@ -121,13 +129,18 @@ int armv8_cache_d_inner_flush_virt(struct armv8_common *armv8, target_addr_t va,
 	va_end = va + size;
 
 	while (va_line < va_end) {
+		uint64_t lines[ARMV8_CACHE_BATCH];
+		unsigned int n;
+
+		for (n = 0; n < ARMV8_CACHE_BATCH && va_line < va_end; n++, va_line += linelen)
+			lines[n] = va_line;
+
 		/* DC CIVAC */
 		/* Aarch32: DCCIMVAC: ARMV4_5_MCR(15, 0, 0, 7, 14, 1) */
-		retval = dpm->instr_write_data_r0_64(dpm,
-				armv8_opcode(armv8, ARMV8_OPC_DCCIVAC), va_line);
+		retval = armv8_dpm_instr_write_data_r0_batch(dpm,
+				armv8_opcode(armv8, ARMV8_OPC_DCCIVAC), lines, n);
 		if (retval != ERROR_OK)
 			goto done;
-		va_line += linelen;
 	}
 
 	dpm->finish(dpm);
@@ -160,12 +173,17 @@ int armv8_cache_i_inner_inval_virt(struct armv8_common *armv8, target_addr_t va,
 	va_end = va + size;
 
 	while (va_line < va_end) {
+		uint64_t lines[ARMV8_CACHE_BATCH];
+		unsigned int n;
+
+		for (n = 0; n < ARMV8_CACHE_BATCH && va_line < va_end; n++, va_line += linelen)
+			lines[n] = va_line;
+
 		/* IC IVAU - Invalidate instruction cache by VA to PoU. */
-		retval = dpm->instr_write_data_r0_64(dpm,
-				armv8_opcode(armv8, ARMV8_OPC_ICIVAU), va_line);
+		retval = armv8_dpm_instr_write_data_r0_batch(dpm,
+				armv8_opcode(armv8, ARMV8_OPC_ICIVAU), lines, n);
 		if (retval != ERROR_OK)
 			goto done;
-		va_line += linelen;
 	}
 
 	dpm->finish(dpm);
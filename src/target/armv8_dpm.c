@@ -330,6 +330,74 @@ static int dpmv8_instr_write_data_r0_64(struct arm_dpm *dpm,
 	return retval;
 }
 
+/**
+ * Execute @a opcode once for each of the @a count values in @a data, with
+ * the value loaded into X0/R0 through the DCC first. This is the same
+ * sequence as dpmv8_instr_write_data_r0_64(), but all DTR and ITR writes
+ * are queued and EDSCR is only read once at the end: the core finishes
+ * each instruction long before the next APB access reaches it. Should the
+ * sticky overrun flags show otherwise, the whole batch is replayed one
+ * instruction at a time, so @a opcode must be safe to repeat (cache and
+ * TLB maintenance are).
+ */
+int armv8_dpm_instr_write_data_r0_batch(struct arm_dpm *dpm,
+	uint32_t opcode, const uint64_t *data, unsigned int count)
+{
+	struct armv8_common *armv8 = dpm->arm->arch_info;
+	bool aarch64 = dpm->arm->core_state == ARM_STATE_AARCH64;
+	uint32_t load = aarch64 ? ARMV8_MRS(SYSTEM_DBG_DBGDTR_EL0, 0)
+		: T32_FMTITR(armv8_opcode(armv8, READ_REG_DTRRX));
+	uint32_t itr_opcode = aarch64 ? opcode : T32_FMTITR(opcode);
+	uint32_t dscr;
+	int retval = ERROR_OK;
+
+	if (count == 0)
+		return ERROR_OK;
+
+	for (unsigned int i = 0; i < count && retval == ERROR_OK; i++) {
+		if (aarch64)
+			retval = dpmv8_write_dcc_64(armv8, data[i]);
+		else
+			retval = dpmv8_write_dcc(armv8, data[i]);
+		if (retval == ERROR_OK)
+			retval = mem_ap_write_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_ITR, load);
+		if (retval == ERROR_OK)
+			retval = mem_ap_write_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_ITR, itr_opcode);
+	}
+	if (retval == ERROR_OK)
+		retval = mem_ap_read_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_DSCR, &dscr);
+	if (retval == ERROR_OK)
+		retval = dap_run(armv8->debug_ap->dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	dpm->dscr = dscr;
+
+	if (dscr & (DSCR_ITO | DSCR_RTO)) {
+		LOG_DEBUG("ITR/DTR overrun, dscr = 0x%08" PRIx32 ", replaying %u instructions",
+				dscr, count);
+
+		retval = mem_ap_write_atomic_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_DRCR, DRCR_CSE);
+		if (retval == ERROR_OK)
+			retval = dpm->prepare(dpm);
+		for (unsigned int i = 0; i < count && retval == ERROR_OK; i++)
+			retval = dpmv8_instr_write_data_r0_64(dpm, opcode, data[i]);
+		return retval;
+	}
+
+	if (dscr & DSCR_ERR) {
+		LOG_ERROR("Opcode 0x%08" PRIx32 ", DSCR.ERR=1, DSCR.EL=%i", opcode, (int)((dscr >> 8) & 3));
+		armv8_dpm_handle_exception(dpm, true);
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
 static int dpmv8_instr_cpsr_sync(struct arm_dpm *dpm)
 {
 	int retval;
@@ -26,6 +26,8 @@ int armv8_dpm_initialize(struct arm_dpm *dpm);
 
 int armv8_dpm_read_current_registers(struct arm_dpm *dpm);
 int armv8_dpm_modeswitch(struct arm_dpm *dpm, enum arm_mode mode);
+int armv8_dpm_instr_write_data_r0_batch(struct arm_dpm *dpm,
+	uint32_t opcode, const uint64_t *data, unsigned int count);
 
 
 int armv8_dpm_write_dirty_registers(struct arm_dpm *dpm, bool bpwp);
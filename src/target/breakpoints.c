@@ -36,30 +36,109 @@ static const char * const watchpoint_rw_strings[] = {
 /* monotonic counter/id-number for breakpoints and watch points */
 static int bpwp_unique_id;
 
+/* Scripted sessions can install thousands of breakpoints, and the resume
+ * and step paths look up the PC on every call. Keep an address hash next
+ * to the list; the list still defines the order. */
+#define BREAKPOINT_INDEX_SIZE 1024
+
+static unsigned int breakpoint_index_hash(target_addr_t address)
+{
+	return ((address >> 1) ^ (address >> 11)) & (BREAKPOINT_INDEX_SIZE - 1);
+}
+
+static void breakpoint_index_append(struct breakpoint **bucket, struct breakpoint *breakpoint)
+{
+	while (*bucket)
+		bucket = &(*bucket)->index_next;
+	breakpoint->index_next = NULL;
+	*bucket = breakpoint;
+}
+
+/* returns NULL if out of memory, callers then walk the list */
+static struct breakpoint **breakpoint_index_get(struct target *target)
+{
+	if (target->breakpoint_index)
+		return target->breakpoint_index;
+
+	struct breakpoint **index = calloc(BREAKPOINT_INDEX_SIZE, sizeof(*index));
+	if (!index)
+		return NULL;
+
+	for (struct breakpoint *bp = target->breakpoints; bp; bp = bp->next)
+		breakpoint_index_append(&index[breakpoint_index_hash(bp->address)], bp);
+
+	target->breakpoint_index = index;
+	return index;
+}
+
+static void breakpoint_index_remove(struct target *target, struct breakpoint *breakpoint)
+{
+	if (!target->breakpoint_index)
+		return;
+
+	struct breakpoint **bp_p = &target->breakpoint_index[breakpoint_index_hash(breakpoint->address)];
+	while (*bp_p) {
+		if (*bp_p == breakpoint) {
+			*bp_p = breakpoint->index_next;
+			return;
+		}
+		bp_p = &(*bp_p)->index_next;
+	}
+}
+
+/**
+ * Drop the address index and the cached list tail. Must be called by
+ * code that frees target->breakpoints without going through this file.
+ */
+void breakpoint_index_reset(struct target *target)
+{
+	free(target->breakpoint_index);
+	target->breakpoint_index = NULL;
+	target->breakpoints_tail = NULL;
+}
+
+static struct breakpoint **breakpoint_tail(struct target *target)
+{
+	if (!target->breakpoints_tail) {
+		struct breakpoint **breakpoint_p = &target->breakpoints;
+		while (*breakpoint_p)
+			breakpoint_p = &(*breakpoint_p)->next;
+		target->breakpoints_tail = breakpoint_p;
+	}
+	return target->breakpoints_tail;
+}
+
+/* called once a breakpoint appended to the list was accepted by the target */
+static void breakpoint_link(struct target *target, struct breakpoint *breakpoint)
+{
+	target->breakpoints_tail = &breakpoint->next;
+	if (target->breakpoint_index)
+		breakpoint_index_append(&target->breakpoint_index[breakpoint_index_hash(breakpoint->address)],
+			breakpoint);
+}
+
 static int breakpoint_add_internal(struct target *target,
 	target_addr_t address,
 	unsigned int length,
 	enum breakpoint_type type)
 {
-	struct breakpoint *breakpoint = target->breakpoints;
-	struct breakpoint **breakpoint_p = &target->breakpoints;
+	struct breakpoint *breakpoint = breakpoint_find(target, address);
+	struct breakpoint **breakpoint_p;
 	const char *reason;
 	int retval;
 
-	while (breakpoint) {
-		if (breakpoint->address == address) {
-			/* FIXME don't assume "same address" means "same
-			 * breakpoint" ... check all the parameters before
-			 * succeeding.
-			 */
-			LOG_TARGET_ERROR(target, "Duplicate Breakpoint address: " TARGET_ADDR_FMT " (BP %" PRIu32 ")",
-				address, breakpoint->unique_id);
-			return ERROR_TARGET_DUPLICATE_BREAKPOINT;
-		}
-		breakpoint_p = &breakpoint->next;
-		breakpoint = breakpoint->next;
+	if (breakpoint) {
+		/* FIXME don't assume "same address" means "same
+		 * breakpoint" ... check all the parameters before
+		 * succeeding.
+		 */
+		LOG_TARGET_ERROR(target, "Duplicate Breakpoint address: " TARGET_ADDR_FMT " (BP %" PRIu32 ")",
+			address, breakpoint->unique_id);
+		return ERROR_TARGET_DUPLICATE_BREAKPOINT;
 	}
 
+	breakpoint_p = breakpoint_tail(target);
+
 	(*breakpoint_p) = malloc(sizeof(struct breakpoint));
 	(*breakpoint_p)->address = address;
 	(*breakpoint_p)->asid = 0;
@@ -90,6 +169,8 @@ fail:
 			return retval;
 	}
 
+	breakpoint_link(target, *breakpoint_p);
+
 	LOG_TARGET_DEBUG(target, "added %s breakpoint at " TARGET_ADDR_FMT
 			" of length 0x%8.8x, (BPID: %" PRIu32 ")",
 		breakpoint_type_strings[(*breakpoint_p)->type],
@@ -140,6 +221,8 @@ static int context_breakpoint_add_internal(struct target *target,
 		return retval;
 	}
 
+	breakpoint_link(target, *breakpoint_p);
+
 	LOG_TARGET_DEBUG(target, "added %s Context breakpoint at 0x%8.8" PRIx32 " of length 0x%8.8x, (BPID: %" PRIu32 ")",
 		breakpoint_type_strings[(*breakpoint_p)->type],
 		(*breakpoint_p)->asid, (*breakpoint_p)->length,
@@ -195,6 +278,7 @@ static int hybrid_breakpoint_add_internal(struct target *target,
 		*breakpoint_p = NULL;
 		return retval;
 	}
+	breakpoint_link(target, *breakpoint_p);
 	LOG_TARGET_DEBUG(target,
 		"added %s Hybrid breakpoint at address " TARGET_ADDR_FMT " of length 0x%8.8x, (BPID: %" PRIu32 ")",
 		breakpoint_type_strings[(*breakpoint_p)->type],
@@ -298,6 +382,9 @@ static int breakpoint_free(struct target *target, struct breakpoint *breakpoint_
 	}
 
 	LOG_TARGET_DEBUG(target, "free BPID: %" PRIu32 " --> %d", breakpoint->unique_id, retval);
+	breakpoint_index_remove(target, breakpoint);
+	if (!breakpoint->next)
+		target->breakpoints_tail = breakpoint_p;
 	(*breakpoint_p) = breakpoint->next;
 	free(breakpoint->orig_instr);
 	free(breakpoint);
@@ -307,13 +394,23 @@ static int breakpoint_free(struct target *target, struct breakpoint *breakpoint_
 
 static int breakpoint_remove_internal(struct target *target, target_addr_t address)
 {
-	struct breakpoint *breakpoint = target->breakpoints;
-
-	while (breakpoint) {
-		if ((breakpoint->address == address) ||
-		    (breakpoint->address == 0 && breakpoint->asid == address))
-			break;
-		breakpoint = breakpoint->next;
+	struct breakpoint **index = breakpoint_index_get(target);
+	struct breakpoint *breakpoint;
+
+	if (index) {
+		breakpoint = breakpoint_find(target, address);
+		/* context breakpoints are indexed at address 0 */
+		for (struct breakpoint *bp = index[breakpoint_index_hash(0)]; !breakpoint && bp; bp = bp->index_next)
+			if (bp->address == 0 && bp->asid == address)
+				breakpoint = bp;
+	} else {
+		breakpoint = target->breakpoints;
+		while (breakpoint) {
+			if ((breakpoint->address == address) ||
+			    (breakpoint->address == 0 && breakpoint->asid == address))
+				break;
+			breakpoint = breakpoint->next;
+		}
 	}
 
 	if (breakpoint) {
@@ -323,6 +420,13 @@ static int breakpoint_remove_internal(struct target *target, target_addr_t addre
 	}
 }
 
+/*
+ * The software breakpoints are not restored with a single
+ * target_write_memory_sg() here: the instruction swap belongs to the
+ * remove_breakpoint handler of each target, which also picks the
+ * instruction encoding and size, maintains the caches and clears the
+ * state of the breakpoint unit.
+ */
 static int breakpoint_remove_all_internal(struct target *target)
 {
 	LOG_TARGET_DEBUG(target, "Delete all breakpoints");
@@ -488,8 +592,17 @@ int breakpoint_clear_target(struct target *target)
 
 struct breakpoint *breakpoint_find(struct target *target, target_addr_t address)
 {
-	struct breakpoint *breakpoint = target->breakpoints;
+	struct breakpoint **index = breakpoint_index_get(target);
+	struct breakpoint *breakpoint;
+
+	if (index) {
+		for (breakpoint = index[breakpoint_index_hash(address)]; breakpoint; breakpoint = breakpoint->index_next)
+			if (breakpoint->address == address)
+				return breakpoint;
+		return NULL;
+	}
 
+	breakpoint = target->breakpoints;
 	while (breakpoint) {
 		if (breakpoint->address == address)
 			return breakpoint;
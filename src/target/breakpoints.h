@@ -32,6 +32,7 @@ struct breakpoint {
 	unsigned int number;
 	uint8_t *orig_instr;
 	struct breakpoint *next;
+	struct breakpoint *index_next;	/* next in the same address hash bucket */
 	uint32_t unique_id;
 	int linked_brp;
 };
@@ -51,6 +52,7 @@ struct watchpoint {
 };
 
 int breakpoint_clear_target(struct target *target);
+void breakpoint_index_reset(struct target *target);
 int breakpoint_add(struct target *target,
 		target_addr_t address, unsigned int length, enum breakpoint_type type);
 int context_breakpoint_add(struct target *target,
@@ -1105,6 +1105,8 @@ static int cortex_a_post_debug_entry(struct target *target)
 	struct armv7a_common *armv7a = &cortex_a->armv7a_common;
 	int retval;
 
+	arm_mmu_tlb_invalidate(&armv7a->arm);
+
 	/* MRC p15,0,<Rt>,c1,c0,0 ; Read CP15 System Control Register */
 	retval = armv7a->arm.mrc(target, 15,
 			0, 0,	/* op1, op2 */
@@ -2709,10 +2711,23 @@ static int cortex_a_read_cpu_memory(struct target *target,
  * ap number for every access.
  */
 
+/* Write the dirty data cache lines back and invalidate them before a
+ * bulk AP transfer, the bus does not see the core caches */
+static int cortex_a_bulk_ap_prepare(struct target *target)
+{
+	struct armv7a_common *armv7a = target_to_armv7a(target);
+
+	if (!armv7a->armv7a_mmu.armv7a_cache.d_u_cache_enabled)
+		return ERROR_OK;
+
+	return armv7a_cache_flush_all_data(target);
+}
+
 static int cortex_a_read_phys_memory(struct target *target,
 	target_addr_t address, uint32_t size,
 	uint32_t count, uint8_t *buffer)
 {
+	struct arm *arm = target_to_arm(target);
 	int retval;
 
 	if (!count || !buffer)
@@ -2721,6 +2736,13 @@ static int cortex_a_read_phys_memory(struct target *target,
 	LOG_DEBUG("Reading memory at real address " TARGET_ADDR_FMT "; size %" PRIu32 "; count %" PRIu32,
 		address, size, count);
 
+	if (arm_bulk_ap_use(arm, size, count)) {
+		retval = cortex_a_bulk_ap_prepare(target);
+		if (retval != ERROR_OK)
+			return retval;
+		return mem_ap_read_buf(arm->bulk_ap, buffer, size, count, address);
+	}
+
 	/* read memory through the CPU */
 	cortex_a_prep_memaccess(target, 1);
 	retval = cortex_a_read_cpu_memory(target, address, size, count, buffer);
@@ -2749,6 +2771,8 @@ static int cortex_a_write_phys_memory(struct target *target,
 	target_addr_t address, uint32_t size,
 	uint32_t count, const uint8_t *buffer)
 {
+	struct armv7a_common *armv7a = target_to_armv7a(target);
+	struct arm *arm = &armv7a->arm;
 	int retval;
 
 	if (!count || !buffer)
@@ -2757,6 +2781,19 @@ static int cortex_a_write_phys_memory(struct target *target,
 	LOG_DEBUG("Writing memory to real address " TARGET_ADDR_FMT "; size %" PRIu32 "; count %" PRIu32,
 		address, size, count);
 
+	if (arm_bulk_ap_use(arm, size, count)) {
+		retval = cortex_a_bulk_ap_prepare(target);
+		if (retval != ERROR_OK)
+			return retval;
+		retval = mem_ap_write_buf(arm->bulk_ap, buffer, size, count, address);
+		if (retval != ERROR_OK)
+			return retval;
+		/* the data written may be code */
+		if (armv7a->armv7a_mmu.armv7a_cache.i_cache_enabled)
+			retval = armv7a_l1_i_cache_inval_all(target);
+		return retval;
+	}
+
 	/* write memory through the CPU */
 	cortex_a_prep_memaccess(target, 1);
 	retval = cortex_a_write_cpu_memory(target, address, size, count, buffer);
@@ -3071,6 +3108,10 @@ static int cortex_a_examine_first(struct target *target)
 	/* select debug_ap as default */
 	swjdp->apsel = armv7a->debug_ap->ap_num;
 
+	retval = arm_bulk_ap_setup(target);
+	if (retval != ERROR_OK)
+		return retval;
+
 	target_set_examined(target);
 	return ERROR_OK;
 }
@@ -3192,6 +3233,7 @@ static void cortex_a_deinit_target(struct target *target)
 
 	if (armv7a->debug_ap)
 		dap_put_ap(armv7a->debug_ap);
+	arm_bulk_ap_free(&armv7a->arm);
 
 	free(cortex_a->wrp_list);
 	free(cortex_a->brp_list);
@@ -3356,6 +3398,9 @@ static const struct command_registration cortex_a_exec_command_handlers[] = {
 	{
 		.chain = smp_command_handlers,
 	},
+	{
+		.chain = arm_bulk_ap_command_handlers,
+	},
 
 	COMMAND_REGISTRATION_DONE
 };
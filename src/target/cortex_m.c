@@ -173,6 +173,73 @@ static int cortex_m_read_dhcsr_atomic_sticky(struct target *target)
 	return ERROR_OK;
 }
 
+/* Another examined Cortex-M target on the DAP of target, or NULL */
+static struct cortex_m_common *cortex_m_on_same_dap(struct target *target, struct target *curr)
+{
+	if (curr == target || curr->type != target->type
+			|| !target_was_examined(curr) || !curr->tap->enabled)
+		return NULL;
+
+	struct cortex_m_common *cm = target_to_cm(curr);
+	if (!cm->armv7m.debug_ap || cm->armv7m.debug_ap->dap != target_to_cm(target)->armv7m.debug_ap->dap)
+		return NULL;
+
+	return cm;
+}
+
+/** Read DHCSR for a poll. During the periodic poll of all targets, read
+ * it for all the Cortex-M targets on the same DAP in a single run, so that
+ * the following polls of the others in the round take the value read.
+ */
+static int cortex_m_read_dhcsr_poll(struct target *target)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct adiv5_ap *debug_ap = cortex_m->armv7m.debug_ap;
+	unsigned int round = target_poll_round();
+
+	if (!round)
+		return cortex_m_read_dhcsr_atomic_sticky(target);
+
+	if (cortex_m->dcb_dhcsr_prefetch_round == round) {
+		cortex_m->dcb_dhcsr_prefetch_round = 0;
+		cortex_m->dcb_dhcsr = cortex_m->dcb_dhcsr_prefetch;
+		return ERROR_OK;
+	}
+
+	int retval = mem_ap_read_u32(debug_ap, DCB_DHCSR, &cortex_m->dcb_dhcsr);
+	if (retval != ERROR_OK)
+		return retval;
+
+	for (struct target *curr = all_targets; curr; curr = curr->next) {
+		struct cortex_m_common *cm = cortex_m_on_same_dap(target, curr);
+		if (!cm)
+			continue;
+
+		retval = mem_ap_read_u32(cm->armv7m.debug_ap, DCB_DHCSR, &cm->dcb_dhcsr_prefetch);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	retval = dap_run(debug_ap->dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	cortex_m_cumulate_dhcsr_sticky(cortex_m, cortex_m->dcb_dhcsr);
+
+	/* The sticky bits are cleared by the read, keep them now in case a
+	 * target is not polled in this round */
+	for (struct target *curr = all_targets; curr; curr = curr->next) {
+		struct cortex_m_common *cm = cortex_m_on_same_dap(target, curr);
+		if (!cm)
+			continue;
+
+		cortex_m_cumulate_dhcsr_sticky(cm, cm->dcb_dhcsr_prefetch);
+		cm->dcb_dhcsr_prefetch_round = round;
+	}
+
+	return ERROR_OK;
+}
+
 static int cortex_m_load_core_reg_u32(struct target *target,
 		uint32_t regsel, uint32_t *value)
 {
@@ -228,7 +295,21 @@ static int cortex_m_load_core_reg_u32(struct target *target,
 	return retval;
 }
 
-static int cortex_m_slow_read_all_regs(struct target *target)
+/* Registers to leave out of a batch read: FP registers are only fetched on
+ * demand, and when filling the cache on demand (refresh false) registers
+ * already valid, possibly dirty, are kept */
+static bool cortex_m_skip_reg_read(const struct reg *r, unsigned int reg_id,
+		bool include_fp, bool refresh)
+{
+	if (!r->exist)
+		return true;
+	if (!include_fp && reg_id >= ARMV7M_FPU_FIRST_REG && reg_id <= ARMV7M_FPU_LAST_REG)
+		return true;
+	return !refresh && r->valid;
+}
+
+static int cortex_m_slow_read_all_regs(struct target *target, bool include_fp,
+		bool refresh)
 {
 	struct cortex_m_common *cortex_m = target_to_cm(target);
 	struct armv7m_common *armv7m = target_to_armv7m(target);
@@ -240,7 +321,7 @@ static int cortex_m_slow_read_all_regs(struct target *target)
 
 	for (unsigned int reg_id = 0; reg_id < num_regs; reg_id++) {
 		struct reg *r = &armv7m->arm.core_cache->reg_list[reg_id];
-		if (r->exist) {
+		if (!cortex_m_skip_reg_read(r, reg_id, include_fp, refresh)) {
 			int retval = armv7m->arm.read_core_reg(target, r, reg_id, ARM_MODE_ANY);
 			if (retval != ERROR_OK)
 				return retval;
@@ -270,7 +351,8 @@ static int cortex_m_queue_reg_read(struct target *target, uint32_t regsel,
 	return mem_ap_read_u32(armv7m->debug_ap, DCB_DCRDR, reg_value);
 }
 
-static int cortex_m_fast_read_all_regs(struct target *target)
+static int cortex_m_fast_read_all_regs(struct target *target, bool include_fp,
+		bool refresh)
 {
 	struct cortex_m_common *cortex_m = target_to_cm(target);
 	struct armv7m_common *armv7m = target_to_armv7m(target);
@@ -298,8 +380,8 @@ static int cortex_m_fast_read_all_regs(struct target *target)
 	unsigned int reg_id; /* register index in the reg_list, ARMV7M_R0... */
 	for (reg_id = 0; reg_id < num_regs; reg_id++) {
 		struct reg *r = &armv7m->arm.core_cache->reg_list[reg_id];
-		if (!r->exist)
-			continue;	/* skip non existent registers */
+		if (cortex_m_skip_reg_read(r, reg_id, include_fp, refresh))
+			continue;	/* skip non existent or not requested registers */
 
 		if (r->size <= 8) {
 			/* Any 8-bit or shorter register is unpacked from a 32-bit
@@ -361,8 +443,8 @@ static int cortex_m_fast_read_all_regs(struct target *target)
 	unsigned int ri = 0; /* read index from r_vals array */
 	for (reg_id = 0; reg_id < num_regs; reg_id++) {
 		struct reg *r = &armv7m->arm.core_cache->reg_list[reg_id];
-		if (!r->exist)
-			continue;	/* skip non existent registers */
+		if (cortex_m_skip_reg_read(r, reg_id, include_fp, refresh))
+			continue;	/* skip non existent or not requested registers */
 
 		r->dirty = false;
 
@@ -395,6 +477,32 @@ static int cortex_m_fast_read_all_regs(struct target *target)
 	return retval;
 }
 
+static int cortex_m_read_regs(struct target *target, bool include_fp,
+		bool refresh)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	int retval = ERROR_OK;
+
+	if (!cortex_m->slow_register_read) {
+		retval = cortex_m_fast_read_all_regs(target, include_fp, refresh);
+		if (retval == ERROR_TIMEOUT_REACHED) {
+			cortex_m->slow_register_read = true;
+			LOG_TARGET_DEBUG(target, "Switched to slow register read");
+		}
+	}
+
+	if (cortex_m->slow_register_read)
+		retval = cortex_m_slow_read_all_regs(target, include_fp, refresh);
+
+	return retval;
+}
+
+static int cortex_m_read_all_core_regs(struct target *target,
+		enum target_register_class reg_class)
+{
+	return cortex_m_read_regs(target, reg_class == REG_CLASS_ALL, false);
+}
+
 static int cortex_m_store_core_reg_u32(struct target *target,
 		uint32_t regsel, uint32_t value)
 {
@@ -445,16 +553,22 @@ static int cortex_m_store_core_reg_u32(struct target *target,
 	return retval;
 }
 
-static int cortex_m_write_debug_halt_mask(struct target *target,
+static void cortex_m_update_debug_halt_mask(struct cortex_m_common *cortex_m,
 	uint32_t mask_on, uint32_t mask_off)
 {
-	struct cortex_m_common *cortex_m = target_to_cm(target);
-	struct armv7m_common *armv7m = &cortex_m->armv7m;
-
 	/* mask off status bits */
 	cortex_m->dcb_dhcsr &= ~((0xFFFFul << 16) | mask_off);
 	/* create new register mask */
 	cortex_m->dcb_dhcsr |= DBGKEY | C_DEBUGEN | mask_on;
+}
+
+static int cortex_m_write_debug_halt_mask(struct target *target,
+	uint32_t mask_on, uint32_t mask_off)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct armv7m_common *armv7m = &cortex_m->armv7m;
+
+	cortex_m_update_debug_halt_mask(cortex_m, mask_on, mask_off);
 
 	return mem_ap_write_atomic_u32(armv7m->debug_ap, DCB_DHCSR, cortex_m->dcb_dhcsr);
 }
@@ -851,40 +965,48 @@ static int cortex_m_debug_entry(struct target *target)
 
 	LOG_TARGET_DEBUG(target, " ");
 
+	/* Everything needed after halt is queued here and run together with
+	 * the core register reads, see cortex_m_clear_halt() for the DHCSR
+	 * and DFSR part. The DFSR clear is deferred to the end. */
+	struct adiv5_ap *ap = armv7m->debug_ap;
+	dap_defer_atomic_begin(ap->dap);
+
 	/* Do this really early to minimize the window where the MASKINTS erratum
 	 * can pile up pending interrupts. */
 	cortex_m_set_maskints_for_halt(target);
 
-	cortex_m_clear_halt(target);
-
-	retval = cortex_m_read_dhcsr_atomic_sticky(target);
-	if (retval != ERROR_OK)
-		return retval;
+	/* clear step if any */
+	cortex_m_write_debug_halt_mask(target, C_HALT, C_STEP);
 
-	retval = armv7m->examine_debug_reason(target);
-	if (retval != ERROR_OK)
-		return retval;
+	retval = mem_ap_read_u32(ap, NVIC_DFSR, &cortex_m->nvic_dfsr);
+	if (retval == ERROR_OK)
+		retval = mem_ap_read_u32(ap, DCB_DHCSR, &cortex_m->dcb_dhcsr);
 
 	/* examine PE security state */
 	uint32_t dscsr = 0;
-	if (armv7m->arm.arch == ARM_ARCH_V8M) {
-		retval = mem_ap_read_u32(armv7m->debug_ap, DCB_DSCSR, &dscsr);
-		if (retval != ERROR_OK)
-			return retval;
-	}
+	if (retval == ERROR_OK && armv7m->arm.arch == ARM_ARCH_V8M)
+		retval = mem_ap_read_u32(ap, DCB_DSCSR, &dscsr);
 
-	/* Load all registers to arm.core_cache */
-	if (!cortex_m->slow_register_read) {
-		retval = cortex_m_fast_read_all_regs(target);
-		if (retval == ERROR_TIMEOUT_REACHED) {
-			cortex_m->slow_register_read = true;
-			LOG_TARGET_DEBUG(target, "Switched to slow register read");
-		}
+	/* Load all registers but the FP ones to arm.core_cache, the FP
+	 * registers are read on demand. This runs the queue. */
+	if (retval == ERROR_OK)
+		retval = cortex_m_read_regs(target, false, true);
+
+	if (retval == ERROR_OK) {
+		cortex_m_cumulate_dhcsr_sticky(cortex_m, cortex_m->dcb_dhcsr);
+		LOG_TARGET_DEBUG(target, "NVIC_DFSR 0x%" PRIx32 "", cortex_m->nvic_dfsr);
+
+		/* Clear Debug Fault Status */
+		retval = mem_ap_write_atomic_u32(ap, NVIC_DFSR, cortex_m->nvic_dfsr);
 	}
 
-	if (cortex_m->slow_register_read)
-		retval = cortex_m_slow_read_all_regs(target);
+	int retval2 = dap_defer_atomic_end(ap->dap);
+	if (retval == ERROR_OK)
+		retval = retval2;
+	if (retval != ERROR_OK)
+		return retval;
 
+	retval = armv7m->examine_debug_reason(target);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -915,7 +1037,9 @@ static int cortex_m_debug_entry(struct target *target)
 		armv7m->exception_number = 0;
 	}
 
-	if (armv7m->exception_number)
+	/* the fault status registers are only logged, don't spend a queue
+	 * run on them otherwise */
+	if (armv7m->exception_number && LOG_LEVEL_IS(LOG_LVL_DEBUG))
 		cortex_m_examine_exception_reason(target);
 
 	bool secure_state = (dscsr & DSCSR_CDS) == DSCSR_CDS;
@@ -946,6 +1070,128 @@ static int cortex_m_debug_entry(struct target *target)
 	return ERROR_OK;
 }
 
+/* Background polls of a target in a low power mode are spread out up to
+ * this number of polls apart */
+#define CORTEX_M_LOW_POWER_MAX_INTERVAL	16
+
+static void cortex_m_low_power_enter(struct target *target, enum cortex_m_low_power state)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+
+	if (cortex_m->low_power != state) {
+		LOG_TARGET_INFO(target, "%s, polling less often",
+			state == CORTEX_M_LOW_POWER_SLEEP ? "deep sleep" : "debug power lost");
+		cortex_m->low_power_interval = 1;
+	} else if (cortex_m->low_power_interval < CORTEX_M_LOW_POWER_MAX_INTERVAL) {
+		cortex_m->low_power_interval *= 2;
+	}
+
+	cortex_m->low_power = state;
+	cortex_m->low_power_count = 0;
+}
+
+static void cortex_m_low_power_exit(struct target *target)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+
+	if (cortex_m->low_power == CORTEX_M_LOW_POWER_NONE)
+		return;
+
+	LOG_TARGET_INFO(target, "woken up, polling at the normal rate");
+	cortex_m->low_power = CORTEX_M_LOW_POWER_NONE;
+}
+
+/* Only background polls are skipped, the explicit ones always check */
+static bool cortex_m_low_power_skip(struct target *target)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+
+	if (cortex_m->low_power == CORTEX_M_LOW_POWER_NONE || !target_poll_round())
+		return false;
+
+	return ++cortex_m->low_power_count < cortex_m->low_power_interval;
+}
+
+static bool cortex_m_power_acked(struct adiv5_dap *dap, uint32_t ctrl_stat)
+{
+	uint32_t ack = CDBGPWRUPACK;
+
+	if (!dap->ignore_syspwrupack)
+		ack |= CSYSPWRUPACK;
+
+	return (ctrl_stat & ack) == ack;
+}
+
+/* After a failed DHCSR read, check if the device has removed the debug
+ * or system power, as in nRF System OFF. The target is not lost then and
+ * reexamining it would fail the same way. */
+static bool cortex_m_power_lost(struct target *target)
+{
+	struct adiv5_dap *dap = target_to_cm(target)->armv7m.debug_ap->dap;
+	uint32_t ctrl_stat;
+
+	if (dap_dp_read_atomic(dap, DP_CTRL_STAT, &ctrl_stat) != ERROR_OK)
+		return false;
+
+	return !cortex_m_power_acked(dap, ctrl_stat);
+}
+
+/* Wait with a single DP read for the power acks to come back, then
+ * reconnect the DAP. A DP that does not answer any more gets the SWD
+ * wake up sequence of the reconnect. */
+static int cortex_m_poll_power_down(struct target *target)
+{
+	struct adiv5_dap *dap = target_to_cm(target)->armv7m.debug_ap->dap;
+	uint32_t ctrl_stat;
+
+	int retval = dap_dp_read_atomic(dap, DP_CTRL_STAT, &ctrl_stat);
+	if (retval == ERROR_OK && !cortex_m_power_acked(dap, ctrl_stat)) {
+		cortex_m_low_power_enter(target, CORTEX_M_LOW_POWER_DOWN);
+		return ERROR_OK;
+	}
+
+	retval = dap_dp_init_or_reconnect(dap);
+	if (retval != ERROR_OK) {
+		LOG_TARGET_DEBUG(target, "DAP reconnect failed, still powered down");
+		cortex_m_low_power_enter(target, CORTEX_M_LOW_POWER_DOWN);
+		return ERROR_OK;
+	}
+
+	cortex_m_low_power_exit(target);
+	return ERROR_OK;
+}
+
+/* Spread out the polls of a core in deep sleep, SCR is read once per sleep */
+static int cortex_m_check_deep_sleep(struct target *target)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	uint32_t scr;
+
+	if (target->state != TARGET_RUNNING || !(cortex_m->dcb_dhcsr & S_SLEEP)) {
+		cortex_m->sleep_checked = false;
+		cortex_m_low_power_exit(target);
+		return ERROR_OK;
+	}
+
+	if (cortex_m->low_power == CORTEX_M_LOW_POWER_SLEEP) {
+		cortex_m_low_power_enter(target, CORTEX_M_LOW_POWER_SLEEP);
+		return ERROR_OK;
+	}
+
+	if (cortex_m->sleep_checked)
+		return ERROR_OK;
+
+	int retval = mem_ap_read_atomic_u32(cortex_m->armv7m.debug_ap, NVIC_SCR, &scr);
+	if (retval != ERROR_OK)
+		return retval;
+
+	cortex_m->sleep_checked = true;
+	if (scr & SCR_SLEEPDEEP)
+		cortex_m_low_power_enter(target, CORTEX_M_LOW_POWER_SLEEP);
+
+	return ERROR_OK;
+}
+
 static int cortex_m_poll_one(struct target *target)
 {
 	int detected_failure = ERROR_OK;
@@ -955,8 +1201,13 @@ static int cortex_m_poll_one(struct target *target)
 	struct armv7m_common *armv7m = &cortex_m->armv7m;
 
 	/* Read from Debug Halting Control and Status Register */
-	retval = cortex_m_read_dhcsr_atomic_sticky(target);
+	retval = cortex_m_read_dhcsr_poll(target);
 	if (retval != ERROR_OK) {
+		if (cortex_m->low_power_poll && prev_target_state == TARGET_RUNNING
+				&& cortex_m_power_lost(target)) {
+			cortex_m_low_power_enter(target, CORTEX_M_LOW_POWER_DOWN);
+			return ERROR_OK;
+		}
 		target->state = TARGET_UNKNOWN;
 		return retval;
 	}
@@ -966,6 +1217,8 @@ static int cortex_m_poll_one(struct target *target)
 	 */
 	if (cortex_m->dcb_dhcsr & S_LOCKUP) {
 		LOG_TARGET_ERROR(target, "clearing lockup after double fault");
+		/* Run the halt request together with the DHCSR refresh below */
+		dap_defer_atomic_begin(armv7m->debug_ap->dap);
 		cortex_m_write_debug_halt_mask(target, C_HALT, 0);
 		target->debug_reason = DBG_REASON_DBGRQ;
 
@@ -976,6 +1229,7 @@ static int cortex_m_poll_one(struct target *target)
 
 		/* refresh status bits */
 		retval = cortex_m_read_dhcsr_atomic_sticky(target);
+		dap_defer_atomic_end(armv7m->debug_ap->dap);
 		if (retval != ERROR_OK)
 			return retval;
 	}
@@ -1081,6 +1335,9 @@ static int cortex_m_poll_one(struct target *target)
 		retval = ERROR_OK;
 	}
 
+	if (cortex_m->low_power_poll && retval == ERROR_OK)
+		retval = cortex_m_check_deep_sleep(target);
+
 	/* Did we detect a failure condition that we cleared? */
 	if (detected_failure != ERROR_OK)
 		retval = detected_failure;
@@ -1089,21 +1346,66 @@ static int cortex_m_poll_one(struct target *target)
 
 static int cortex_m_halt_one(struct target *target);
 
+static bool cortex_m_smp_halt_needed(struct target *target)
+{
+	return target_was_examined(target) && target->state != TARGET_HALTED;
+}
+
 static int cortex_m_smp_halt_all(struct list_head *smp_targets)
 {
 	int retval = ERROR_OK;
 	struct target_list *head;
+	unsigned int count = 0;
+
+	foreach_smp_target(head, smp_targets)
+		count++;
+
+	/* Request the halt of all the cores with one run per DAP */
+	struct mem_ap_batch_access *accesses = calloc(count, sizeof(*accesses));
+	if (!accesses) {
+		foreach_smp_target(head, smp_targets) {
+			struct target *curr = head->target;
+			if (!cortex_m_smp_halt_needed(curr))
+				continue;
 
+			int ret2 = cortex_m_halt_one(curr);
+			if (retval == ERROR_OK)
+				retval = ret2;	/* store the first error code ignore others */
+		}
+		return retval;
+	}
+
+	count = 0;
 	foreach_smp_target(head, smp_targets) {
 		struct target *curr = head->target;
-		if (!target_was_examined(curr))
+		if (!cortex_m_smp_halt_needed(curr))
 			continue;
-		if (curr->state == TARGET_HALTED)
+
+		LOG_TARGET_DEBUG(curr, "target->state: %s", target_state_name(curr));
+		if (curr->state == TARGET_UNKNOWN)
+			LOG_TARGET_WARNING(curr, "target was in unknown state when halt was requested");
+
+		struct cortex_m_common *cortex_m = target_to_cm(curr);
+		cortex_m_update_debug_halt_mask(cortex_m, C_HALT, 0);
+
+		accesses[count].ap = cortex_m->armv7m.debug_ap;
+		accesses[count].address = DCB_DHCSR;
+		accesses[count].write = true;
+		accesses[count].value = cortex_m->dcb_dhcsr;
+		count++;
+	}
+
+	retval = mem_ap_batch_run(accesses, count);
+	free(accesses);
+
+	foreach_smp_target(head, smp_targets) {
+		struct target *curr = head->target;
+		if (!cortex_m_smp_halt_needed(curr))
 			continue;
 
-		int ret2 = cortex_m_halt_one(curr);
-		if (retval == ERROR_OK)
-			retval = ret2;	/* store the first error code ignore others */
+		/* see cortex_m_halt_one() */
+		cortex_m_set_maskints_for_halt(curr);
+		curr->debug_reason = DBG_REASON_DBGRQ;
 	}
 	return retval;
 }
@@ -1170,7 +1472,15 @@ static int cortex_m_poll_smp(struct list_head *smp_targets)
 
 static int cortex_m_poll(struct target *target)
 {
-	int retval = cortex_m_poll_one(target);
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	int retval = ERROR_OK;
+
+	if (!cortex_m_low_power_skip(target)) {
+		if (cortex_m->low_power == CORTEX_M_LOW_POWER_DOWN)
+			retval = cortex_m_poll_power_down(target);
+		if (retval == ERROR_OK && cortex_m->low_power != CORTEX_M_LOW_POWER_DOWN)
+			retval = cortex_m_poll_one(target);
+	}
 
 	if (target->smp) {
 		struct target_list *last;
@@ -1299,6 +1609,63 @@ void cortex_m_enable_breakpoints(struct target *target)
 	}
 }
 
+/*
+ * Single step the core over the breakpoint it is halted on.
+ * The FPB comparator keeps its slot and the original instruction is not
+ * read back as cortex_m_unset/set_breakpoint() would do. The Cortex-M FPB
+ * has no way to ignore a match on the first instruction, so the breakpoint
+ * still goes away for the step; for a hardware breakpoint the comparator
+ * and step writes are deferred and run in two queue flushes in total.
+ */
+static int cortex_m_step_over_breakpoint(struct target *target, struct breakpoint *breakpoint)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct adiv5_ap *ap = cortex_m->armv7m.debug_ap;
+	struct cortex_m_fp_comparator *comparator = NULL;
+	target_addr_t address = breakpoint->address & 0xFFFFFFFE;
+	uint8_t code[4];
+	int retval;
+
+	if (!breakpoint->is_set)
+		return cortex_m_single_step_core(target);
+
+	if (breakpoint->type == BKPT_HARD) {
+		if (breakpoint->number < cortex_m->fp_num_code)
+			comparator = &cortex_m->fp_comparator_list[breakpoint->number];
+	} else {
+		retval = target_write_memory(target, address, breakpoint->length, 1,
+				breakpoint->orig_instr);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	dap_defer_atomic_begin(ap->dap);
+	retval = ERROR_OK;
+	if (comparator)
+		retval = mem_ap_write_atomic_u32(ap, comparator->fpcr_address, 0);
+	if (retval == ERROR_OK)
+		retval = cortex_m_single_step_core(target);
+	if (comparator) {
+		int retval2 = mem_ap_write_atomic_u32(ap, comparator->fpcr_address,
+				comparator->fpcr_value);
+		if (retval == ERROR_OK)
+			retval = retval2;
+	}
+	int retval2 = dap_defer_atomic_end(ap->dap);
+	if (retval == ERROR_OK)
+		retval = retval2;
+
+	if (breakpoint->type == BKPT_SOFT) {
+		/* see cortex_m_set_breakpoint() */
+		buf_set_u32(code, 0, 32, ARMV5_T_BKPT(0x11));
+		retval2 = target_write_memory(target, address, breakpoint->length, 1, code);
+		if (retval == ERROR_OK)
+			retval = retval2;
+	}
+
+	return retval;
+}
+
 static int cortex_m_restore_one(struct target *target, bool current,
 	target_addr_t *address, bool handle_breakpoints, bool debug_execution)
 {
@@ -1379,14 +1746,9 @@ static int cortex_m_restore_one(struct target *target, bool current,
 			LOG_TARGET_DEBUG(target, "unset breakpoint at " TARGET_ADDR_FMT " (ID: %" PRIu32 ")",
 				breakpoint->address,
 				breakpoint->unique_id);
-			retval = cortex_m_unset_breakpoint(target, breakpoint);
-			if (retval == ERROR_OK)
-				retval = cortex_m_single_step_core(target);
-			int ret2 = cortex_m_set_breakpoint(target, breakpoint);
+			retval = cortex_m_step_over_breakpoint(target, breakpoint);
 			if (retval != ERROR_OK)
 				return retval;
-			if (ret2 != ERROR_OK)
-				return ret2;
 		}
 	}
 
@@ -1518,6 +1880,11 @@ static int cortex_m_step(struct target *target, int current,
 
 	target_call_event_callbacks(target, TARGET_EVENT_RESUMED);
 
+	/* The DHCSR writes of the step sequence need no result of their own,
+	 * they are run together with the next DHCSR read */
+	struct adiv5_dap *dap = armv7m->debug_ap->dap;
+	dap_defer_atomic_begin(dap);
+
 	/* if no bkpt instruction is found at pc then we can perform
 	 * a normal step, otherwise we have to manually step over the bkpt
 	 * instruction - as such simulate a step */
@@ -1603,6 +1970,7 @@ static int cortex_m_step(struct target *target, int current,
 					do {
 						retval = cortex_m_read_dhcsr_atomic_sticky(target);
 						if (retval != ERROR_OK) {
+							dap_defer_atomic_end(dap);
 							target->state = TARGET_UNKNOWN;
 							return retval;
 						}
@@ -1637,6 +2005,9 @@ static int cortex_m_step(struct target *target, int current,
 	}
 
 	retval = cortex_m_read_dhcsr_atomic_sticky(target);
+	int retval2 = dap_defer_atomic_end(dap);
+	if (retval == ERROR_OK)
+		retval = retval2;
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -2253,6 +2624,46 @@ static int cortex_m_write_memory(struct target *target, target_addr_t address,
 	return mem_ap_write_buf(armv7m->debug_ap, buffer, size, count, address);
 }
 
+static int cortex_m_check_sg_alignment(struct target *target,
+	const struct target_memory_sg *ranges, unsigned int num_ranges)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+
+	if (armv7m->arm.arch != ARM_ARCH_V6M)
+		return ERROR_OK;
+
+	/* armv6m does not handle unaligned memory access */
+	for (unsigned int i = 0; i < num_ranges; i++) {
+		if (ranges[i].size > 1 && (ranges[i].address & (ranges[i].size - 1)))
+			return ERROR_TARGET_UNALIGNED_ACCESS;
+	}
+	return ERROR_OK;
+}
+
+static int cortex_m_read_memory_sg(struct target *target,
+	struct target_memory_sg *ranges, unsigned int num_ranges)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+
+	int retval = cortex_m_check_sg_alignment(target, ranges, num_ranges);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return mem_ap_read_buf_sg(armv7m->debug_ap, ranges, num_ranges);
+}
+
+static int cortex_m_write_memory_sg(struct target *target,
+	const struct target_memory_sg *ranges, unsigned int num_ranges)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+
+	int retval = cortex_m_check_sg_alignment(target, ranges, num_ranges);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return mem_ap_write_buf_sg(armv7m->debug_ap, ranges, num_ranges);
+}
+
 static int cortex_m_init_target(struct command_context *cmd_ctx,
 	struct target *target)
 {
@@ -2293,7 +2704,7 @@ int cortex_m_profiling(struct target *target, uint32_t *samples,
 	}
 	if (reg_value == 0) {
 		LOG_TARGET_INFO(target, "PCSR sampling not supported on this processor.");
-		return target_profiling_default(target, samples, max_num_samples, num_samples, seconds);
+		return ERROR_NOT_IMPLEMENTED;
 	}
 
 	gettimeofday(&timeout, NULL);
@@ -2312,19 +2723,23 @@ int cortex_m_profiling(struct target *target, uint32_t *samples,
 	}
 
 	uint32_t sample_count = 0;
+	uint32_t skipped = 0;
 
 	for (;;) {
+		uint32_t read_count;
+		uint32_t kept = 0;
+
 		if (armv7m && armv7m->debug_ap) {
-			uint32_t read_count = max_num_samples - sample_count;
+			read_count = max_num_samples - sample_count;
 			if (read_count > 1024)
 				read_count = 1024;
 
 			retval = mem_ap_read_buf_noincr(armv7m->debug_ap,
 						(void *)&samples[sample_count],
 						4, read_count, DWT_PCSR);
-			sample_count += read_count;
 		} else {
-			target_read_u32(target, DWT_PCSR, &samples[sample_count++]);
+			read_count = 1;
+			retval = target_read_u32(target, DWT_PCSR, &samples[sample_count]);
 		}
 
 		if (retval != ERROR_OK) {
@@ -2332,10 +2747,23 @@ int cortex_m_profiling(struct target *target, uint32_t *samples,
 			return retval;
 		}
 
+		/* PCSR reads as 0xffffffff while the core is halted or cannot be
+		 * sampled, drop those so they don't stretch the histogram range */
+		for (uint32_t i = 0; i < read_count; i++) {
+			if (samples[sample_count + i] == UINT32_MAX) {
+				skipped++;
+				continue;
+			}
+			samples[sample_count + kept++] = samples[sample_count + i];
+		}
+		sample_count += kept;
+
 
 		gettimeofday(&now, NULL);
 		if (sample_count >= max_num_samples || timeval_compare(&now, &timeout) > 0) {
 			LOG_TARGET_INFO(target, "Profiling completed. %" PRIu32 " samples.", sample_count);
+			if (skipped)
+				LOG_TARGET_INFO(target, "%" PRIu32 " samples dropped, core not sampled", skipped);
 			break;
 		}
 	}
@@ -2578,6 +3006,8 @@ int cortex_m_examine(struct target *target)
 	struct adiv5_dap *swjdp = cortex_m->armv7m.arm.dap;
 	struct armv7m_common *armv7m = target_to_armv7m(target);
 
+	cortex_m->low_power = CORTEX_M_LOW_POWER_NONE;
+
 	/* hla_target shares the examine handler but does not support
 	 * all its calls */
 	if (!armv7m->is_hla_target) {
@@ -2839,7 +3269,8 @@ static int cortex_m_handle_target_request(void *priv)
 	if (!target_was_examined(target))
 		return ERROR_OK;
 
-	if (!target->dbg_msg_enabled)
+	/* messages come through the memory ring instead */
+	if (!target->dbg_msg_enabled || target->dbg_msg_ring)
 		return ERROR_OK;
 
 	if (target->state == TARGET_RUNNING) {
@@ -2881,6 +3312,8 @@ static int cortex_m_init_arch_info(struct target *target,
 	 * if not it will use CORTEX_M_RESET_VECTRESET */
 	cortex_m->soft_reset_config = CORTEX_M_RESET_VECTRESET;
 
+	cortex_m->low_power_poll = true;
+
 	armv7m->arm.dap = dap;
 
 	/* register arch-specific functions */
@@ -3111,6 +3544,31 @@ COMMAND_HANDLER(handle_cortex_m_reset_config_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_cortex_m_low_power_poll_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	int retval;
+
+	retval = cortex_m_verify_pointer(CMD, cortex_m);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		COMMAND_PARSE_ON_OFF(CMD_ARGV[0], cortex_m->low_power_poll);
+		if (!cortex_m->low_power_poll)
+			cortex_m->low_power = CORTEX_M_LOW_POWER_NONE;
+	}
+
+	command_print(CMD, "cortex_m low_power_poll %s",
+		cortex_m->low_power_poll ? "on" : "off");
+
+	return ERROR_OK;
+}
+
 static const struct command_registration cortex_m_exec_command_handlers[] = {
 	{
 		.name = "maskisr",
@@ -3133,6 +3591,13 @@ static const struct command_registration cortex_m_exec_command_handlers[] = {
 		.help = "configure software reset handling",
 		.usage = "['sysresetreq'|'vectreset']",
 	},
+	{
+		.name = "low_power_poll",
+		.handler = handle_cortex_m_low_power_poll_command,
+		.mode = COMMAND_ANY,
+		.help = "poll targets in deep sleep or powered down less often",
+		.usage = "['on'|'off']",
+	},
 	{
 		.chain = smp_command_handlers,
 	},
@@ -3181,11 +3646,18 @@ struct target_type cortexm_target = {
 
 	.get_gdb_arch = arm_get_gdb_arch,
 	.get_gdb_reg_list = armv7m_get_gdb_reg_list,
+	.read_all_core_regs = cortex_m_read_all_core_regs,
 
 	.read_memory = cortex_m_read_memory,
 	.write_memory = cortex_m_write_memory,
+	.read_memory_sg = cortex_m_read_memory_sg,
+	.write_memory_sg = cortex_m_write_memory_sg,
 	.checksum_memory = armv7m_checksum_memory,
+	.write_buffer_compressed = armv7m_write_buffer_compressed,
 	.blank_check_memory = armv7m_blank_check_memory,
+	.search_memory = armv7m_search_memory,
+	.fill_memory = armv7m_fill_memory,
+	.copy_memory = armv7m_copy_memory,
 
 	.run_algorithm = armv7m_run_algorithm,
 	.start_algorithm = armv7m_start_algorithm,
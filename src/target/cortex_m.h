@@ -158,6 +158,7 @@ struct cortex_m_part_info {
 #define NVIC_ISE0		0xE000E100
 #define NVIC_ICSR		0xE000ED04
 #define NVIC_AIRCR		0xE000ED0C
+#define NVIC_SCR		0xE000ED10
 #define NVIC_SHCSR		0xE000ED24
 #define NVIC_CFSR		0xE000ED28
 #define NVIC_MMFSRB		0xE000ED28
@@ -175,6 +176,8 @@ struct cortex_m_part_info {
 #define AIRCR_SYSRESETREQ	BIT(2)
 #define AIRCR_VECTCLRACTIVE	BIT(1)
 #define AIRCR_VECTRESET		BIT(0)
+/* NVIC_SCR bits */
+#define SCR_SLEEPDEEP		BIT(2)
 /* NVIC_SHCSR bits */
 #define SHCSR_BUSFAULTENA	BIT(17)
 /* NVIC_DFSR bits */
@@ -218,6 +221,12 @@ enum cortex_m_isrmasking_mode {
 	CORTEX_M_ISRMASK_STEPONLY,
 };
 
+enum cortex_m_low_power {
+	CORTEX_M_LOW_POWER_NONE,
+	CORTEX_M_LOW_POWER_SLEEP,		/* S_SLEEP with SCR.SLEEPDEEP */
+	CORTEX_M_LOW_POWER_DOWN,		/* debug or system power ack lost */
+};
+
 struct cortex_m_common {
 	unsigned int common_magic;
 
@@ -226,6 +235,9 @@ struct cortex_m_common {
 	/* Context information */
 	uint32_t dcb_dhcsr;
 	uint32_t dcb_dhcsr_cumulated_sticky;
+	/* DHCSR read along with the other cores on the DAP, valid in poll round */
+	uint32_t dcb_dhcsr_prefetch;
+	unsigned int dcb_dhcsr_prefetch_round;
 	/* DCB DHCSR has been at least once read, so the sticky bits have been reset */
 	bool dcb_dhcsr_sticky_is_recent;
 	uint32_t nvic_dfsr;  /* Debug Fault Status Register - shows reason for debug halt */
@@ -253,6 +265,13 @@ struct cortex_m_common {
 
 	bool slow_register_read;	/* A register has not been ready, poll S_REGRDY */
 
+	/* Background polling of a target in a low power mode is spread out */
+	bool low_power_poll;
+	enum cortex_m_low_power low_power;
+	unsigned int low_power_interval;	/* background polls between two checks */
+	unsigned int low_power_count;
+	bool sleep_checked;		/* SCR read since S_SLEEP has been seen */
+
 	uint64_t apsel;
 
 	/* Whether this target has the erratum that makes C_MASKINTS not apply to
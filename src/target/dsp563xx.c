@@ -1528,16 +1528,20 @@ static int dsp563xx_read_memory_core(struct target *target,
 		return ERROR_TARGET_NOT_HALTED;
 	}
 
+	/*
+	 * A single movep moves each word from memory to the OnCE GDB
+	 * register, no core register is used as intermediate.
+	 */
 	switch (mem_type) {
 		case MEM_X:
 			/* TODO: mark effected queued registers */
-			move_cmd = 0x61d800;
+			move_cmd = 0x08D8BC;	/* movep x:(r0)+,x:OGDB */
 			break;
 		case MEM_Y:
-			move_cmd = 0x69d800;
+			move_cmd = 0x08D8FC;	/* movep y:(r0)+,x:OGDB */
 			break;
 		case MEM_P:
-			move_cmd = 0x07d891;
+			move_cmd = 0x08D87C;	/* movep p:(r0)+,x:OGDB */
 			break;
 		default:
 			return ERROR_COMMAND_SYNTAX_ERROR;
@@ -1546,27 +1550,20 @@ static int dsp563xx_read_memory_core(struct target *target,
 	/* we use r0 to store temporary data */
 	if (!dsp563xx->core_cache->reg_list[DSP563XX_REG_IDX_R0].valid)
 		dsp563xx->read_core_reg(target, DSP563XX_REG_IDX_R0);
-	/* we use r1 to store temporary data */
-	if (!dsp563xx->core_cache->reg_list[DSP563XX_REG_IDX_R1].valid)
-		dsp563xx->read_core_reg(target, DSP563XX_REG_IDX_R1);
 
 	/* r0 is no longer valid on target */
 	dsp563xx->core_cache->reg_list[DSP563XX_REG_IDX_R0].dirty = true;
-	/* r1 is no longer valid on target */
-	dsp563xx->core_cache->reg_list[DSP563XX_REG_IDX_R1].dirty = true;
 
 	x = count;
 	b = buffer;
 
-	err = dsp563xx_once_execute_dw_ir(target->tap, 1, 0x60F400, address);
+	/* the address load, the moves and the reads go in a single jtag flush */
+	err = dsp563xx_once_execute_dw_ir(target->tap, 0, 0x60F400, address);
 	if (err != ERROR_OK)
 		return err;
 
 	for (i = 0; i < x; i++) {
 		err = dsp563xx_once_execute_sw_ir(target->tap, 0, move_cmd);
-		if (err != ERROR_OK)
-			return err;
-		err = dsp563xx_once_execute_sw_ir(target->tap, 0, 0x08D13C);
 		if (err != ERROR_OK)
 			return err;
 		err = dsp563xx_once_reg_read(target->tap, 0,
@@ -1740,7 +1737,8 @@ static int dsp563xx_write_memory_core(struct target *target,
 	x = count;
 	b = buffer;
 
-	err = dsp563xx_once_execute_dw_ir(target->tap, 1, 0x60F400, address);
+	/* the address load and the moves go in a single jtag flush */
+	err = dsp563xx_once_execute_dw_ir(target->tap, 0, 0x60F400, address);
 	if (err != ERROR_OK)
 		return err;
 
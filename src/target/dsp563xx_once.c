@@ -189,7 +189,7 @@ int dsp563xx_once_reg_read_ex(struct jtag_tap *tap, int flush, uint8_t reg, uint
 {
 	int err;
 
-	err = dsp563xx_once_ir_exec(tap, 1, reg, 1, 0, 0);
+	err = dsp563xx_once_ir_exec(tap, flush, reg, 1, 0, 0);
 	if (err != ERROR_OK)
 		return err;
 	err = dsp563xx_write_dr_u32(tap, data, 0x00, len, 0);
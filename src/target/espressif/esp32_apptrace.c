@@ -47,6 +47,10 @@
 
 #define ESP32_APPTRACE_TGT_STATE_TMO            5000
 #define ESP_APPTRACE_BLOCKS_POOL_SZ             10
+/* The pool grows up to this size when the destination is slower than the target */
+#define ESP_APPTRACE_BLOCKS_POOL_MAX_SZ         64
+/* Maximal time to spend writing ready blocks per timer callback */
+#define ESP_APPTRACE_DATA_PROC_MAX_MS           50
 
 struct esp32_apptrace_dest_file_data {
 	int fout;
@@ -335,6 +339,25 @@ static void esp32_apptrace_blocks_pool_cleanup(struct esp32_apptrace_cmd_ctx *ct
 	}
 }
 
+static struct esp32_apptrace_block *esp32_apptrace_block_alloc(struct esp32_apptrace_cmd_ctx *ctx)
+{
+	struct esp32_apptrace_block *block = calloc(1, sizeof(struct esp32_apptrace_block));
+	if (!block) {
+		LOG_ERROR("Failed to alloc trace buffer entry!");
+		return NULL;
+	}
+	block->data = malloc(ctx->max_trace_block_sz);
+	if (!block->data) {
+		free(block);
+		LOG_ERROR("Failed to alloc trace buffer %" PRIu32 " bytes!", ctx->max_trace_block_sz);
+		return NULL;
+	}
+	INIT_LIST_HEAD(&block->node);
+	ctx->trace_blocks_num++;
+
+	return block;
+}
+
 struct esp32_apptrace_block *esp32_apptrace_free_block_get(struct esp32_apptrace_cmd_ctx *ctx)
 {
 	struct esp32_apptrace_block *block = NULL;
@@ -343,6 +366,11 @@ struct esp32_apptrace_block *esp32_apptrace_free_block_get(struct esp32_apptrace
 		/*get first */
 		block = list_first_entry(&ctx->free_trace_blocks, struct esp32_apptrace_block, node);
 		list_del(&block->node);
+	} else if (ctx->trace_blocks_num < ESP_APPTRACE_BLOCKS_POOL_MAX_SZ) {
+		/* the destination is slow, keep more blocks in host memory */
+		block = esp32_apptrace_block_alloc(ctx);
+		if (block)
+			LOG_DEBUG("Trace blocks pool grown to %u", ctx->trace_blocks_num);
 	}
 
 	return block;
@@ -453,21 +481,14 @@ int esp32_apptrace_cmd_ctx_init(struct esp32_apptrace_cmd_ctx *cmd_ctx, struct c
 
 	INIT_LIST_HEAD(&cmd_ctx->ready_trace_blocks);
 	INIT_LIST_HEAD(&cmd_ctx->free_trace_blocks);
+	cmd_ctx->trace_blocks_num = 0;
 	for (unsigned int i = 0; i < ESP_APPTRACE_BLOCKS_POOL_SZ; i++) {
-		struct esp32_apptrace_block *block = calloc(1, sizeof(struct esp32_apptrace_block));
+		struct esp32_apptrace_block *block = esp32_apptrace_block_alloc(cmd_ctx);
 		if (!block) {
-			command_print(cmd, "Failed to alloc trace buffer entry!");
+			command_print(cmd, "Failed to alloc trace buffer!");
 			esp32_apptrace_blocks_pool_cleanup(cmd_ctx);
 			return ERROR_FAIL;
 		}
-		block->data = malloc(cmd_ctx->max_trace_block_sz);
-		if (!block->data) {
-			free(block);
-			command_print(cmd, "Failed to alloc trace buffer %" PRIu32 " bytes!", cmd_ctx->max_trace_block_sz);
-			esp32_apptrace_blocks_pool_cleanup(cmd_ctx);
-			return ERROR_FAIL;
-		}
-		INIT_LIST_HEAD(&block->node);
 		list_add(&block->node, &cmd_ctx->free_trace_blocks);
 	}
 
@@ -937,17 +958,10 @@ static int esp32_apptrace_handle_trace_block(struct esp32_apptrace_cmd_ctx *ctx,
 	return ERROR_OK;
 }
 
-static int esp32_apptrace_data_processor(void *priv)
+/* Write the oldest ready block to the destination and give it back to the pool */
+static int esp32_apptrace_ready_block_process(struct esp32_apptrace_cmd_ctx *ctx,
+	struct esp32_apptrace_block *block)
 {
-	struct esp32_apptrace_cmd_ctx *ctx = (struct esp32_apptrace_cmd_ctx *)priv;
-
-	if (!ctx->running)
-		return ERROR_OK;
-
-	struct esp32_apptrace_block *block = esp32_apptrace_ready_block_get(ctx);
-	if (!block)
-		return ERROR_OK;
-
 	int res = esp32_apptrace_handle_trace_block(ctx, block);
 	if (res != ERROR_OK) {
 		ctx->running = 0;
@@ -964,6 +978,26 @@ static int esp32_apptrace_data_processor(void *priv)
 	return ERROR_OK;
 }
 
+static int esp32_apptrace_data_processor(void *priv)
+{
+	struct esp32_apptrace_cmd_ctx *ctx = (struct esp32_apptrace_cmd_ctx *)priv;
+	int64_t timeout = timeval_ms() + ESP_APPTRACE_DATA_PROC_MAX_MS;
+
+	/* catch up with all blocks read since the last call, but leave time
+	 * for polling the target */
+	while (ctx->running && timeval_ms() < timeout) {
+		struct esp32_apptrace_block *block = esp32_apptrace_ready_block_get(ctx);
+		if (!block)
+			break;
+
+		int res = esp32_apptrace_ready_block_process(ctx, block);
+		if (res != ERROR_OK)
+			return res;
+	}
+
+	return ERROR_OK;
+}
+
 static int esp32_apptrace_check_connection(struct esp32_apptrace_cmd_ctx *ctx)
 {
 	if (!ctx)
@@ -1109,6 +1143,16 @@ static int esp32_apptrace_poll(void *priv)
 		}
 	}
 	struct esp32_apptrace_block *block = esp32_apptrace_free_block_get(ctx);
+	if (!block) {
+		/* pool at its maximum, write the oldest block to make room */
+		block = esp32_apptrace_ready_block_get(ctx);
+		if (block) {
+			res = esp32_apptrace_ready_block_process(ctx, block);
+			if (res != ERROR_OK)
+				return res;
+			block = esp32_apptrace_free_block_get(ctx);
+		}
+	}
 	if (!block) {
 		ctx->running = 0;
 		LOG_TARGET_ERROR(ctx->cpus[fired_target_num], "Failed to get free block for data!");
@@ -85,6 +85,8 @@ struct esp32_apptrace_cmd_ctx {
 	uint32_t last_blk_id;
 	struct list_head free_trace_blocks;
 	struct list_head ready_trace_blocks;
+	/* number of blocks in both lists */
+	unsigned int trace_blocks_num;
 	uint32_t max_trace_block_sz;
 	struct esp32_apptrace_format trace_format;
 	int (*process_data)(struct esp32_apptrace_cmd_ctx *ctx, unsigned int core_id, uint8_t *data, uint32_t data_len);
@@ -145,17 +145,13 @@ struct reg_cache *etb_build_reg_cache(struct etb *etb)
 	return reg_cache;
 }
 
-static void etb_getbuf(jtag_callback_data_t arg)
-{
-	uint8_t *in = (uint8_t *)arg;
-
-	*((uint32_t *)arg) = buf_get_u32(in, 0, 32);
-}
+/* Frames read per JTAG queue flush while downloading the trace */
+#define ETB_READ_CHUNK_FRAMES	1024
 
-static int etb_read_ram(struct etb *etb, uint32_t *data, int num_frames)
+/* Queue the scan selecting the RAM data register for etb_read_ram() */
+static void etb_read_ram_start(struct etb *etb)
 {
 	struct scan_field fields[3];
-	int i;
 
 	etb_scann(etb, 0x0);
 	etb_set_instr(etb, 0xc);
@@ -177,24 +173,49 @@ static int etb_read_ram(struct etb *etb, uint32_t *data, int num_frames)
 	fields[2].in_value = NULL;
 
 	jtag_add_dr_scan(etb->tap, 3, fields, TAP_IDLE);
+}
 
-	for (i = 0; i < num_frames; i++) {
-		/* ensure nR/W remains set to read */
-		buf_set_u32(&temp2, 0, 1, 0);
+/* Read the next num_frames frames of the ETB RAM in a single queue flush.
+ * The scans are chained, each one returning the frame requested by the
+ * previous one. @a last moves the address away from the RAM data register
+ * on the final frame.
+ */
+static int etb_read_ram(struct etb *etb, uint32_t *data, int num_frames, bool last)
+{
+	struct scan_field fields[3];
+	int i;
+
+	fields[0].num_bits = 32;
+	fields[0].out_value = NULL;
+
+	fields[1].num_bits = 7;
+	uint8_t temp1 = 0;
+	fields[1].out_value = &temp1;
+	buf_set_u32(&temp1, 0, 7, 4);
+	fields[1].in_value = NULL;
+
+	/* nR/W remains set to read */
+	fields[2].num_bits = 1;
+	uint8_t temp2 = 0;
+	fields[2].out_value = &temp2;
+	fields[2].in_value = NULL;
 
+	for (i = 0; i < num_frames; i++) {
 		/* address remains set to 0x4 (RAM data) until we read the last frame */
-		if (i < num_frames - 1)
-			buf_set_u32(&temp1, 0, 7, 4);
-		else
+		if (last && i == num_frames - 1)
 			buf_set_u32(&temp1, 0, 7, 0);
 
 		fields[0].in_value = (uint8_t *)(data + i);
 		jtag_add_dr_scan(etb->tap, 3, fields, TAP_IDLE);
-
-		jtag_add_callback(etb_getbuf, (jtag_callback_data_t)(data + i));
 	}
 
-	jtag_execute_queue();
+	int retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* convert in place once, instead of a callback per frame */
+	for (i = 0; i < num_frames; i++)
+		data[i] = buf_get_u32((uint8_t *)(data + i), 0, 32);
 
 	return ERROR_OK;
 }
@@ -506,6 +527,39 @@ static trace_status_t etb_status(struct etm_context *etm_ctx)
 	return retval;
 }
 
+static void etb_set_trace_data(struct etmv1_trace_data *trace,
+	uint8_t pipestat, uint16_t packet, bool tracesync)
+{
+	trace->pipestat = pipestat;
+	trace->packet = packet;
+	trace->flags = 0;
+	if (tracesync)
+		trace->flags |= ETMV1_TRACESYNC_CYCLE;
+	if (trace->pipestat == STAT_TR) {
+		trace->pipestat = trace->packet & 0x7;
+		trace->flags |= ETMV1_TRIGGER_CYCLE;
+	}
+}
+
+/* Unpack one ETB frame to trace words, return the number of words */
+static int etb_unpack_frame(struct etm_context *etm_ctx, uint32_t frame,
+	struct etmv1_trace_data *trace)
+{
+	if ((etm_ctx->control & ETM_PORT_WIDTH_MASK) == ETM_PORT_4BIT) {
+		etb_set_trace_data(&trace[0], frame & 0x7, (frame & 0x78) >> 3, frame & 0x80);
+		etb_set_trace_data(&trace[1], (frame & 0x100) >> 8, (frame & 0x7800) >> 11, frame & 0x8000);
+		etb_set_trace_data(&trace[2], (frame & 0x10000) >> 16, (frame & 0x780000) >> 19, frame & 0x800000);
+		return 3;
+	} else if ((etm_ctx->control & ETM_PORT_WIDTH_MASK) == ETM_PORT_8BIT) {
+		etb_set_trace_data(&trace[0], frame & 0x7, (frame & 0x7f8) >> 3, frame & 0x800);
+		etb_set_trace_data(&trace[1], (frame & 0x7000) >> 12, (frame & 0x7f8000) >> 15, frame & 0x800000);
+		return 2;
+	}
+
+	etb_set_trace_data(&trace[0], frame & 0x7, (frame & 0x7fff8) >> 3, frame & 0x80000);
+	return 1;
+}
+
 static int etb_read_trace(struct etm_context *etm_ctx)
 {
 	struct etb *etb = etm_ctx->capture_driver_priv;
@@ -533,10 +587,6 @@ static int etb_read_trace(struct etm_context *etm_ctx)
 
 	etb_write_reg(&etb->reg_cache->reg_list[ETB_RAM_READ_POINTER], first_frame);
 
-	/* read data into temporary array for unpacking */
-	trace_data = malloc(sizeof(uint32_t) * num_frames);
-	etb_read_ram(etb, trace_data, num_frames);
-
 	if (etm_ctx->trace_depth > 0)
 		free(etm_ctx->trace_data);
 
@@ -548,87 +598,32 @@ static int etb_read_trace(struct etm_context *etm_ctx)
 		etm_ctx->trace_depth = num_frames;
 
 	etm_ctx->trace_data = malloc(sizeof(struct etmv1_trace_data) * etm_ctx->trace_depth);
+	trace_data = malloc(sizeof(uint32_t) * ETB_READ_CHUNK_FRAMES);
+	if ((etm_ctx->trace_depth && !etm_ctx->trace_data) || !trace_data) {
+		LOG_ERROR("Out of memory");
+		free(trace_data);
+		free(etm_ctx->trace_data);
+		etm_ctx->trace_data = NULL;
+		etm_ctx->trace_depth = 0;
+		return ERROR_FAIL;
+	}
+
+	/* read the RAM in chunks, unpacking each chunk as it arrives */
+	if (num_frames)
+		etb_read_ram_start(etb);
 
-	for (i = 0, j = 0; i < num_frames; i++) {
-		if ((etm_ctx->control & ETM_PORT_WIDTH_MASK) == ETM_PORT_4BIT) {
-			/* trace word j */
-			etm_ctx->trace_data[j].pipestat = trace_data[i] & 0x7;
-			etm_ctx->trace_data[j].packet = (trace_data[i] & 0x78) >> 3;
-			etm_ctx->trace_data[j].flags = 0;
-			if ((trace_data[i] & 0x80) >> 7)
-				etm_ctx->trace_data[j].flags |= ETMV1_TRACESYNC_CYCLE;
-			if (etm_ctx->trace_data[j].pipestat == STAT_TR) {
-				etm_ctx->trace_data[j].pipestat = etm_ctx->trace_data[j].packet &
-					0x7;
-				etm_ctx->trace_data[j].flags |= ETMV1_TRIGGER_CYCLE;
-			}
-
-			/* trace word j + 1 */
-			etm_ctx->trace_data[j + 1].pipestat = (trace_data[i] & 0x100) >> 8;
-			etm_ctx->trace_data[j + 1].packet = (trace_data[i] & 0x7800) >> 11;
-			etm_ctx->trace_data[j + 1].flags = 0;
-			if ((trace_data[i] & 0x8000) >> 15)
-				etm_ctx->trace_data[j + 1].flags |= ETMV1_TRACESYNC_CYCLE;
-			if (etm_ctx->trace_data[j + 1].pipestat == STAT_TR) {
-				etm_ctx->trace_data[j +
-				1].pipestat = etm_ctx->trace_data[j + 1].packet & 0x7;
-				etm_ctx->trace_data[j + 1].flags |= ETMV1_TRIGGER_CYCLE;
-			}
-
-			/* trace word j + 2 */
-			etm_ctx->trace_data[j + 2].pipestat = (trace_data[i] & 0x10000) >> 16;
-			etm_ctx->trace_data[j + 2].packet = (trace_data[i] & 0x780000) >> 19;
-			etm_ctx->trace_data[j + 2].flags = 0;
-			if ((trace_data[i] & 0x800000) >> 23)
-				etm_ctx->trace_data[j + 2].flags |= ETMV1_TRACESYNC_CYCLE;
-			if (etm_ctx->trace_data[j + 2].pipestat == STAT_TR) {
-				etm_ctx->trace_data[j +
-				2].pipestat = etm_ctx->trace_data[j + 2].packet & 0x7;
-				etm_ctx->trace_data[j + 2].flags |= ETMV1_TRIGGER_CYCLE;
-			}
-
-			j += 3;
-		} else if ((etm_ctx->control & ETM_PORT_WIDTH_MASK) == ETM_PORT_8BIT) {
-			/* trace word j */
-			etm_ctx->trace_data[j].pipestat = trace_data[i] & 0x7;
-			etm_ctx->trace_data[j].packet = (trace_data[i] & 0x7f8) >> 3;
-			etm_ctx->trace_data[j].flags = 0;
-			if ((trace_data[i] & 0x800) >> 11)
-				etm_ctx->trace_data[j].flags |= ETMV1_TRACESYNC_CYCLE;
-			if (etm_ctx->trace_data[j].pipestat == STAT_TR) {
-				etm_ctx->trace_data[j].pipestat = etm_ctx->trace_data[j].packet &
-					0x7;
-				etm_ctx->trace_data[j].flags |= ETMV1_TRIGGER_CYCLE;
-			}
-
-			/* trace word j + 1 */
-			etm_ctx->trace_data[j + 1].pipestat = (trace_data[i] & 0x7000) >> 12;
-			etm_ctx->trace_data[j + 1].packet = (trace_data[i] & 0x7f8000) >> 15;
-			etm_ctx->trace_data[j + 1].flags = 0;
-			if ((trace_data[i] & 0x800000) >> 23)
-				etm_ctx->trace_data[j + 1].flags |= ETMV1_TRACESYNC_CYCLE;
-			if (etm_ctx->trace_data[j + 1].pipestat == STAT_TR) {
-				etm_ctx->trace_data[j +
-				1].pipestat = etm_ctx->trace_data[j + 1].packet & 0x7;
-				etm_ctx->trace_data[j + 1].flags |= ETMV1_TRIGGER_CYCLE;
-			}
-
-			j += 2;
-		} else {
-			/* trace word j */
-			etm_ctx->trace_data[j].pipestat = trace_data[i] & 0x7;
-			etm_ctx->trace_data[j].packet = (trace_data[i] & 0x7fff8) >> 3;
-			etm_ctx->trace_data[j].flags = 0;
-			if ((trace_data[i] & 0x80000) >> 19)
-				etm_ctx->trace_data[j].flags |= ETMV1_TRACESYNC_CYCLE;
-			if (etm_ctx->trace_data[j].pipestat == STAT_TR) {
-				etm_ctx->trace_data[j].pipestat = etm_ctx->trace_data[j].packet &
-					0x7;
-				etm_ctx->trace_data[j].flags |= ETMV1_TRIGGER_CYCLE;
-			}
-
-			j += 1;
+	for (i = 0, j = 0; i < num_frames; ) {
+		int chunk = MIN(num_frames - i, ETB_READ_CHUNK_FRAMES);
+
+		int retval = etb_read_ram(etb, trace_data, chunk, i + chunk == num_frames);
+		if (retval != ERROR_OK) {
+			free(trace_data);
+			return retval;
 		}
+
+		for (int k = 0; k < chunk; k++)
+			j += etb_unpack_frame(etm_ctx, trace_data[k], &etm_ctx->trace_data[j]);
+		i += chunk;
 	}
 
 	free(trace_data);
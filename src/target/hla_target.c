@@ -210,19 +210,55 @@ static int adapter_target_create(struct target *target,
 	return ERROR_OK;
 }
 
-static int adapter_load_context(struct target *target)
+/* Queue the reads of the registers not cached yet; the values are stored
+ * in @a values by adapter_load_context_done() after the queue is flushed.
+ * Registers packed in a 32 bit container are left to armv7m_read_core_reg(). */
+static int adapter_load_context_queue(struct target *target, uint32_t *values)
+{
+	struct hl_interface *adapter = target_to_adapter(target);
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	int num_regs = armv7m->arm.core_cache->num_regs;
+
+	for (int i = 0; i < num_regs; i++) {
+		struct reg *r = &armv7m->arm.core_cache->reg_list[i];
+		if (!r->exist || r->valid || r->size <= 8)
+			continue;
+
+		struct arm_reg *armv7m_core_reg = r->arch_info;
+		uint32_t regsel = armv7m_map_id_to_regsel(armv7m_core_reg->num);
+
+		int retval = hl_queue_read_reg(adapter, regsel, &values[2 * i]);
+		if (retval == ERROR_OK && r->size == 64)
+			retval = hl_queue_read_reg(adapter, regsel + 1, &values[2 * i + 1]);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return ERROR_OK;
+}
+
+static void adapter_load_context_done(struct target *target, const uint32_t *values)
 {
 	struct armv7m_common *armv7m = target_to_armv7m(target);
 	int num_regs = armv7m->arm.core_cache->num_regs;
 
 	for (int i = 0; i < num_regs; i++) {
+		struct reg *r = &armv7m->arm.core_cache->reg_list[i];
+		if (!r->exist || r->valid || r->size <= 8)
+			continue;
+
+		buf_set_u32(r->value, 0, 32, values[2 * i]);
+		if (r->size == 64)
+			buf_set_u32(r->value + 4, 0, 32, values[2 * i + 1]);
+		r->valid = true;
+	}
 
+	/* the packed registers, from their cached container */
+	for (int i = 0; i < num_regs; i++) {
 		struct reg *r = &armv7m->arm.core_cache->reg_list[i];
 		if (r->exist && !r->valid)
 			armv7m->arm.read_core_reg(target, r, i, ARM_MODE_ANY);
 	}
-
-	return ERROR_OK;
 }
 
 static int adapter_debug_entry(struct target *target)
@@ -234,19 +270,35 @@ static int adapter_debug_entry(struct target *target)
 	uint32_t xpsr;
 	int retval;
 
-	/* preserve the DCRDR across halts */
-	retval = target_read_u32(target, DCB_DCRDR, &target->SAVED_DCRDR);
-	if (retval != ERROR_OK)
-		return retval;
-
 	retval = armv7m->examine_debug_reason(target);
 	if (retval != ERROR_OK)
 		return retval;
 
-	adapter_load_context(target);
+	uint32_t *values = calloc(2 * arm->core_cache->num_regs, sizeof(*values));
+	if (!values) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	/* All the accesses of the debug entry are queued, so that the adapter
+	 * can group them in a few USB transfers */
 
+	/* preserve the DCRDR across halts */
+	retval = hl_queue_read_u32(adapter, DCB_DCRDR, &target->SAVED_DCRDR);
+	if (retval == ERROR_OK)
+		retval = adapter_load_context_queue(target, values);
 	/* make sure we clear the vector catch bit */
-	adapter->layout->api->write_debug_reg(adapter->handle, DCB_DEMCR, TRCENA);
+	if (retval == ERROR_OK)
+		retval = hl_queue_write_debug_reg(adapter, DCB_DEMCR, TRCENA);
+
+	int flush_retval = hl_queue_flush(adapter);
+	if (retval == ERROR_OK)
+		retval = flush_retval;
+	if (retval == ERROR_OK)
+		adapter_load_context_done(target, values);
+	free(values);
+	if (retval != ERROR_OK)
+		return retval;
 
 	r = arm->cpsr;
 	xpsr = buf_get_u32(r->value, 0, 32);
@@ -664,7 +716,11 @@ struct target_type hla_target = {
 	.read_memory = adapter_read_memory,
 	.write_memory = adapter_write_memory,
 	.checksum_memory = armv7m_checksum_memory,
+	.write_buffer_compressed = armv7m_write_buffer_compressed,
 	.blank_check_memory = armv7m_blank_check_memory,
+	.search_memory = armv7m_search_memory,
+	.fill_memory = armv7m_fill_memory,
+	.copy_memory = armv7m_copy_memory,
 
 	.run_algorithm = armv7m_run_algorithm,
 	.start_algorithm = armv7m_start_algorithm,
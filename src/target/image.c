@@ -47,7 +47,7 @@ static int autodetect_image_type(struct image *image, const char *url)
 	uint8_t buffer[9];
 
 	/* read the first 9 bytes of image */
-	retval = fileio_open(&fileio, url, FILEIO_READ, FILEIO_BINARY);
+	retval = fileio_open_uncompressed(&fileio, url, FILEIO_BINARY);
 	if (retval != ERROR_OK)
 		return retval;
 	retval = fileio_read(fileio, 9, buffer, &read_bytes);
@@ -119,6 +119,41 @@ static int identify_image_type(struct image *image, const char *type_string, con
 	return ERROR_OK;
 }
 
+/* value + 1 of each ASCII hex digit, 0 for any other character */
+static const uint8_t image_hex_nibble[256] = {
+	['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+	['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+	['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+	['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+};
+
+/**
+ * Decode count hex encoded bytes of a record and add them to the record
+ * checksum, in a single pass over the line.
+ *
+ * @returns false on a character that is not a hex digit, e.g. at the end of
+ * a truncated line.
+ */
+static bool image_hex_decode(const char *str, uint8_t *data, uint32_t count, uint8_t *checksum)
+{
+	const uint8_t *p = (const uint8_t *)str;
+	uint8_t sum = *checksum;
+
+	for (uint32_t i = 0; i < count; i++, p += 2) {
+		uint8_t hi = image_hex_nibble[p[0]];
+		if (!hi)
+			return false;
+		uint8_t lo = image_hex_nibble[p[1]];
+		if (!lo)
+			return false;
+		data[i] = ((hi - 1) << 4) | (lo - 1);
+		sum += data[i];
+	}
+
+	*checksum = sum;
+	return true;
+}
+
 static int image_ihex_buffer_complete_inner(struct image *image,
 	char *lpsz_line,
 	struct imagesection *section)
@@ -153,24 +188,22 @@ static int image_ihex_buffer_complete_inner(struct image *image,
 			uint32_t count;
 			uint32_t address;
 			uint32_t record_type;
-			uint32_t checksum;
+			uint8_t checksum;
 			uint8_t cal_checksum = 0;
+			uint8_t field[255];
 			size_t bytes_read = 0;
 
 			/* skip comments and blank lines */
 			if ((lpsz_line[0] == '#') || (strlen(lpsz_line + strspn(lpsz_line, "\n\t\r ")) == 0))
 				continue;
 
-			if (sscanf(&lpsz_line[bytes_read], ":%2" SCNx32 "%4" SCNx32 "%2" SCNx32, &count,
-				&address, &record_type) != 3)
+			if (lpsz_line[0] != ':' || !image_hex_decode(&lpsz_line[1], field, 4, &cal_checksum))
 				return ERROR_IMAGE_FORMAT_ERROR;
+			count = field[0];
+			address = (field[1] << 8) | field[2];
+			record_type = field[3];
 			bytes_read += 9;
 
-			cal_checksum += (uint8_t)count;
-			cal_checksum += (uint8_t)(address >> 8);
-			cal_checksum += (uint8_t)address;
-			cal_checksum += (uint8_t)record_type;
-
 			if (record_type == 0) {	/* Data Record */
 				if ((full_address & 0xffff) != address) {
 					/* we encountered a nonconsecutive location, create a new section,
@@ -194,16 +227,14 @@ static int image_ihex_buffer_complete_inner(struct image *image,
 					full_address = (full_address & 0xffff0000) | address;
 				}
 
-				while (count-- > 0) {
-					unsigned value;
-					sscanf(&lpsz_line[bytes_read], "%2x", &value);
-					ihex->buffer[cooked_bytes] = (uint8_t)value;
-					cal_checksum += (uint8_t)ihex->buffer[cooked_bytes];
-					bytes_read += 2;
-					cooked_bytes += 1;
-					section[image->num_sections].size += 1;
-					full_address++;
-				}
+				/* decode straight into the section, contiguous records extend it */
+				if (!image_hex_decode(&lpsz_line[bytes_read], &ihex->buffer[cooked_bytes],
+						count, &cal_checksum))
+					return ERROR_IMAGE_FORMAT_ERROR;
+				bytes_read += 2 * count;
+				cooked_bytes += count;
+				section[image->num_sections].size += count;
+				full_address += count;
 			} else if (record_type == 1) {	/* End of File Record */
 				/* finish the current section */
 				image->num_sections++;
@@ -222,9 +253,9 @@ static int image_ihex_buffer_complete_inner(struct image *image,
 			} else if (record_type == 2) {	/* Linear Address Record */
 				uint16_t upper_address;
 
-				sscanf(&lpsz_line[bytes_read], "%4hx", &upper_address);
-				cal_checksum += (uint8_t)(upper_address >> 8);
-				cal_checksum += (uint8_t)upper_address;
+				if (!image_hex_decode(&lpsz_line[bytes_read], field, 2, &cal_checksum))
+					return ERROR_IMAGE_FORMAT_ERROR;
+				upper_address = (field[0] << 8) | field[1];
 				bytes_read += 4;
 
 				if ((full_address >> 4) != upper_address) {
@@ -249,21 +280,17 @@ static int image_ihex_buffer_complete_inner(struct image *image,
 					full_address = (full_address & 0xffff) | (upper_address << 4);
 				}
 			} else if (record_type == 3) {	/* Start Segment Address Record */
-				uint32_t dummy;
-
 				/* "Start Segment Address Record" will not be supported
 				 * but we must consume it, and do not create an error.  */
-				while (count-- > 0) {
-					sscanf(&lpsz_line[bytes_read], "%2" SCNx32, &dummy);
-					cal_checksum += (uint8_t)dummy;
-					bytes_read += 2;
-				}
+				if (!image_hex_decode(&lpsz_line[bytes_read], field, count, &cal_checksum))
+					return ERROR_IMAGE_FORMAT_ERROR;
+				bytes_read += 2 * count;
 			} else if (record_type == 4) {	/* Extended Linear Address Record */
 				uint16_t upper_address;
 
-				sscanf(&lpsz_line[bytes_read], "%4hx", &upper_address);
-				cal_checksum += (uint8_t)(upper_address >> 8);
-				cal_checksum += (uint8_t)upper_address;
+				if (!image_hex_decode(&lpsz_line[bytes_read], field, 2, &cal_checksum))
+					return ERROR_IMAGE_FORMAT_ERROR;
+				upper_address = (field[0] << 8) | field[1];
 				bytes_read += 4;
 
 				if ((full_address >> 16) != upper_address) {
@@ -290,11 +317,9 @@ static int image_ihex_buffer_complete_inner(struct image *image,
 			} else if (record_type == 5) {	/* Start Linear Address Record */
 				uint32_t start_address;
 
-				sscanf(&lpsz_line[bytes_read], "%8" SCNx32, &start_address);
-				cal_checksum += (uint8_t)(start_address >> 24);
-				cal_checksum += (uint8_t)(start_address >> 16);
-				cal_checksum += (uint8_t)(start_address >> 8);
-				cal_checksum += (uint8_t)start_address;
+				if (!image_hex_decode(&lpsz_line[bytes_read], field, 4, &cal_checksum))
+					return ERROR_IMAGE_FORMAT_ERROR;
+				start_address = be_to_h_u32(field);
 				bytes_read += 8;
 
 				image->start_address_set = true;
@@ -304,9 +329,11 @@ static int image_ihex_buffer_complete_inner(struct image *image,
 				return ERROR_IMAGE_FORMAT_ERROR;
 			}
 
-			sscanf(&lpsz_line[bytes_read], "%2" SCNx32, &checksum);
+			uint8_t unused = 0;
+			if (!image_hex_decode(&lpsz_line[bytes_read], &checksum, 1, &unused))
+				return ERROR_IMAGE_FORMAT_ERROR;
 
-			if ((uint8_t)checksum != (uint8_t)(~cal_checksum + 1)) {
+			if (checksum != (uint8_t)(~cal_checksum + 1)) {
 				/* checksum failed */
 				LOG_ERROR("incorrect record checksum found in IHEX file");
 				return ERROR_IMAGE_CHECKSUM;
@@ -650,6 +677,28 @@ static int image_elf_read_headers(struct image *image)
 	}
 }
 
+/* get the file content of a segment from the mapped ELF file */
+static int image_elf_map_segment(struct image *image, uint64_t file_offset,
+	uint64_t file_size, const uint8_t **data)
+{
+	struct image_elf *elf = image->type_private;
+	const uint8_t *map;
+	size_t size;
+
+	int retval = fileio_map(elf->fileio, &map);
+	if (retval != ERROR_OK)
+		return retval;
+
+	fileio_size(elf->fileio, &size);
+	if (file_offset > size || file_size > size - file_offset) {
+		LOG_ERROR("ELF segment content is beyond the end of the file");
+		return ERROR_IMAGE_FORMAT_ERROR;
+	}
+
+	*data = map + file_offset;
+	return ERROR_OK;
+}
+
 static int image_elf32_read_section(struct image *image,
 	int section,
 	target_addr_t offset,
@@ -672,6 +721,14 @@ static int image_elf32_read_section(struct image *image,
 		read_size = MIN(size, field32(elf, segment->p_filesz) - offset);
 		LOG_DEBUG("read elf: size = 0x%zx at 0x%" TARGET_PRIxADDR "", read_size,
 			field32(elf, segment->p_offset) + offset);
+		/* copy straight from the mapped file if possible */
+		const uint8_t *data;
+		if (image_elf_map_segment(image, field32(elf, segment->p_offset),
+					field32(elf, segment->p_filesz), &data) == ERROR_OK) {
+			memcpy(buffer, data + offset, read_size);
+			*size_read = read_size;
+			return ERROR_OK;
+		}
 		/* read initialized area of the segment */
 		retval = fileio_seek(elf->fileio, field32(elf, segment->p_offset) + offset);
 		if (retval != ERROR_OK) {
@@ -715,6 +772,14 @@ static int image_elf64_read_section(struct image *image,
 		read_size = MIN(size, field64(elf, segment->p_filesz) - offset);
 		LOG_DEBUG("read elf: size = 0x%zx at 0x%" TARGET_PRIxADDR "", read_size,
 			field64(elf, segment->p_offset) + offset);
+		/* copy straight from the mapped file if possible */
+		const uint8_t *data;
+		if (image_elf_map_segment(image, field64(elf, segment->p_offset),
+					field64(elf, segment->p_filesz), &data) == ERROR_OK) {
+			memcpy(buffer, data + offset, read_size);
+			*size_read = read_size;
+			return ERROR_OK;
+		}
 		/* read initialized area of the segment */
 		retval = fileio_seek(elf->fileio, field64(elf, segment->p_offset) + offset);
 		if (retval != ERROR_OK) {
@@ -785,8 +850,8 @@ static int image_mot_buffer_complete_inner(struct image *image,
 			uint32_t count;
 			uint32_t address;
 			uint32_t record_type;
-			uint32_t checksum;
 			uint8_t cal_checksum = 0;
+			uint8_t field[255];
 			uint32_t bytes_read = 0;
 
 			/* skip comments and blank lines */
@@ -794,58 +859,36 @@ static int image_mot_buffer_complete_inner(struct image *image,
 				continue;
 
 			/* get record type and record length */
-			if (sscanf(&lpsz_line[bytes_read], "S%1" SCNx32 "%2" SCNx32, &record_type,
-				&count) != 2)
+			if (lpsz_line[0] != 'S' || !image_hex_nibble[(uint8_t)lpsz_line[1]]
+					|| !image_hex_decode(&lpsz_line[2], field, 1, &cal_checksum))
+				return ERROR_IMAGE_FORMAT_ERROR;
+			record_type = image_hex_nibble[(uint8_t)lpsz_line[1]] - 1;
+			count = field[0];
+			if (count == 0)
 				return ERROR_IMAGE_FORMAT_ERROR;
 
 			bytes_read += 4;
-			cal_checksum += (uint8_t)count;
 
 			/* skip checksum byte */
 			count -= 1;
 
 			if (record_type == 0) {
 				/* S0 - starting record (optional) */
-				int value;
-
-				while (count-- > 0) {
-					sscanf(&lpsz_line[bytes_read], "%2x", &value);
-					cal_checksum += (uint8_t)value;
-					bytes_read += 2;
-				}
+				if (!image_hex_decode(&lpsz_line[bytes_read], field, count, &cal_checksum))
+					return ERROR_IMAGE_FORMAT_ERROR;
+				bytes_read += 2 * count;
 			} else if (record_type >= 1 && record_type <= 3) {
-				switch (record_type) {
-					case 1:
-						/* S1 - 16 bit address data record */
-						sscanf(&lpsz_line[bytes_read], "%4" SCNx32, &address);
-						cal_checksum += (uint8_t)(address >> 8);
-						cal_checksum += (uint8_t)address;
-						bytes_read += 4;
-						count -= 2;
-						break;
-
-					case 2:
-						/* S2 - 24 bit address data record */
-						sscanf(&lpsz_line[bytes_read], "%6" SCNx32, &address);
-						cal_checksum += (uint8_t)(address >> 16);
-						cal_checksum += (uint8_t)(address >> 8);
-						cal_checksum += (uint8_t)address;
-						bytes_read += 6;
-						count -= 3;
-						break;
-
-					case 3:
-						/* S3 - 32 bit address data record */
-						sscanf(&lpsz_line[bytes_read], "%8" SCNx32, &address);
-						cal_checksum += (uint8_t)(address >> 24);
-						cal_checksum += (uint8_t)(address >> 16);
-						cal_checksum += (uint8_t)(address >> 8);
-						cal_checksum += (uint8_t)address;
-						bytes_read += 8;
-						count -= 4;
-						break;
-
-				}
+				/* S1, S2, S3 - 16, 24 and 32 bit address data records */
+				uint32_t address_size = record_type + 1;
+
+				if (count < address_size
+						|| !image_hex_decode(&lpsz_line[bytes_read], field, address_size, &cal_checksum))
+					return ERROR_IMAGE_FORMAT_ERROR;
+				address = 0;
+				for (uint32_t i = 0; i < address_size; i++)
+					address = (address << 8) | field[i];
+				bytes_read += 2 * address_size;
+				count -= address_size;
 
 				if (full_address != address) {
 					/* we encountered a nonconsecutive location, create a new section,
@@ -863,25 +906,19 @@ static int image_mot_buffer_complete_inner(struct image *image,
 					full_address = address;
 				}
 
-				while (count-- > 0) {
-					unsigned value;
-					sscanf(&lpsz_line[bytes_read], "%2x", &value);
-					mot->buffer[cooked_bytes] = (uint8_t)value;
-					cal_checksum += (uint8_t)mot->buffer[cooked_bytes];
-					bytes_read += 2;
-					cooked_bytes += 1;
-					section[image->num_sections].size += 1;
-					full_address++;
-				}
+				/* decode straight into the section, contiguous records extend it */
+				if (!image_hex_decode(&lpsz_line[bytes_read], &mot->buffer[cooked_bytes],
+						count, &cal_checksum))
+					return ERROR_IMAGE_FORMAT_ERROR;
+				bytes_read += 2 * count;
+				cooked_bytes += count;
+				section[image->num_sections].size += count;
+				full_address += count;
 			} else if (record_type == 5 || record_type == 6) {
 				/* S5 and S6 are the data count records, we ignore them */
-				uint32_t dummy;
-
-				while (count-- > 0) {
-					sscanf(&lpsz_line[bytes_read], "%2" SCNx32, &dummy);
-					cal_checksum += (uint8_t)dummy;
-					bytes_read += 2;
-				}
+				if (!image_hex_decode(&lpsz_line[bytes_read], field, count, &cal_checksum))
+					return ERROR_IMAGE_FORMAT_ERROR;
+				bytes_read += 2 * count;
 			} else if (record_type >= 7 && record_type <= 9) {
 				/* S7, S8, S9 - ending records for 32, 24 and 16bit */
 				image->num_sections++;
@@ -903,8 +940,8 @@ static int image_mot_buffer_complete_inner(struct image *image,
 			}
 
 			/* account for checksum, will always be 0xFF */
-			sscanf(&lpsz_line[bytes_read], "%2" SCNx32, &checksum);
-			cal_checksum += (uint8_t)checksum;
+			if (!image_hex_decode(&lpsz_line[bytes_read], field, 1, &cal_checksum))
+				return ERROR_IMAGE_FORMAT_ERROR;
 
 			if (cal_checksum != 0xFF) {
 				/* checksum failed */
@@ -954,10 +991,192 @@ static int image_mot_buffer_complete(struct image *image)
 	return retval;
 }
 
+/* Number of files whose parsed content and checksums are kept around */
+#define IMAGE_CACHE_MAX 4
+
+/**
+ * Sections and checksums of a file image, kept across image_open() calls so
+ * that e.g. "flash write_image", "verify_image" and "load_image" of the same
+ * file in a session parse it and checksum its sections once. Entries are
+ * keyed by path, type, size and modification time. Only the text formats
+ * keep their decoded content; binary and ELF files are mapped anyway.
+ */
+struct image_cache {
+	char *url;
+	enum image_type type;
+	size_t size;
+	time_t mtime;
+	uint8_t *buffer;		/* decoded content of text formats, or NULL */
+	unsigned int num_sections;
+	struct imagesection *sections;	/* unrelocated, only with buffer */
+	bool start_address_set;
+	uint32_t start_address;
+	struct image_section_crc {
+		bool valid;
+		uint32_t size;
+		uint32_t crc;
+	} *crcs;
+	unsigned int users;		/* open images using the entry */
+	bool stale;			/* removed from the list, freed by the last user */
+	struct image_cache *next;
+};
+
+static struct image_cache *image_cache_list;
+
+static void image_cache_free(struct image_cache *cache)
+{
+	free(cache->url);
+	free(cache->buffer);
+	free(cache->sections);
+	free(cache->crcs);
+	free(cache);
+}
+
+/* drop an entry from the list, it lives until its last user closes */
+static void image_cache_drop(struct image_cache **p)
+{
+	struct image_cache *cache = *p;
+
+	*p = cache->next;
+	cache->stale = true;
+	if (!cache->users)
+		image_cache_free(cache);
+}
+
+/* find the cache entry matching an opened file, stale entries are dropped */
+static struct image_cache *image_cache_find(struct image *image, const char *url,
+		struct fileio *fileio)
+{
+	size_t size;
+	time_t mtime;
+
+	if (fileio_size(fileio, &size) != ERROR_OK || fileio_mtime(fileio, &mtime) != ERROR_OK)
+		return NULL;
+
+	for (struct image_cache **p = &image_cache_list; *p; p = &(*p)->next) {
+		struct image_cache *cache = *p;
+
+		if (strcmp(cache->url, url) != 0 || cache->type != image->type)
+			continue;
+
+		if (cache->size == size && cache->mtime == mtime)
+			return cache;
+
+		LOG_DEBUG("image '%s' changed, dropping its cached content", url);
+		image_cache_drop(p);
+		break;
+	}
+
+	return NULL;
+}
+
+/* use the content of a cache entry for a text format image */
+static void image_cache_use(struct image *image, struct image_cache *cache)
+{
+	image->num_sections = cache->num_sections;
+	image->sections = malloc(sizeof(struct imagesection) * cache->num_sections);
+	memcpy(image->sections, cache->sections, sizeof(struct imagesection) * cache->num_sections);
+	image->start_address_set = cache->start_address_set;
+	image->start_address = cache->start_address;
+
+	cache->users++;
+	image->cache = cache;
+}
+
+/**
+ * Add a freshly parsed image to the cache. For text formats the cache
+ * takes over @a buffer, which holds the content of all sections.
+ */
+static void image_cache_add(struct image *image, const char *url,
+		struct fileio *fileio, uint8_t **buffer)
+{
+	struct image_cache *cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		return;
+
+	cache->url = strdup(url);
+	cache->crcs = calloc(image->num_sections, sizeof(*cache->crcs));
+	if (buffer)
+		cache->sections = malloc(sizeof(struct imagesection) * image->num_sections);
+	if (!cache->url || (image->num_sections && !cache->crcs)
+			|| (buffer && image->num_sections && !cache->sections)
+			|| fileio_size(fileio, &cache->size) != ERROR_OK
+			|| fileio_mtime(fileio, &cache->mtime) != ERROR_OK) {
+		image_cache_free(cache);
+		return;
+	}
+
+	cache->type = image->type;
+	cache->num_sections = image->num_sections;
+	cache->start_address_set = image->start_address_set;
+	cache->start_address = image->start_address;
+	if (buffer) {
+		memcpy(cache->sections, image->sections, sizeof(struct imagesection) * image->num_sections);
+		cache->buffer = *buffer;
+		*buffer = NULL;
+	}
+
+	/* keep the most recent entries only */
+	unsigned int count = 0;
+	for (struct image_cache **p = &image_cache_list; *p; ) {
+		if (++count >= IMAGE_CACHE_MAX)
+			image_cache_drop(p);
+		else
+			p = &(*p)->next;
+	}
+
+	cache->next = image_cache_list;
+	image_cache_list = cache;
+
+	cache->users++;
+	image->cache = cache;
+}
+
+/* drop the reference of an image to its cache entry */
+static void image_cache_release(struct image *image)
+{
+	if (image->cache) {
+		image->cache->users--;
+		if (image->cache->stale && !image->cache->users)
+			image_cache_free(image->cache);
+		image->cache = NULL;
+	}
+}
+
+/**
+ * Compute the checksum of a section read or mapped from the image. For
+ * file images the result is cached, so that checksumming the same
+ * section again, even after reopening the image, costs nothing.
+ */
+int image_section_checksum(struct image *image, int section,
+	const uint8_t *data, uint32_t size, uint32_t *checksum)
+{
+	struct image_section_crc *crc = NULL;
+
+	if (image->cache && (unsigned int)section < image->cache->num_sections) {
+		crc = &image->cache->crcs[section];
+		if (crc->valid && crc->size == size) {
+			*checksum = crc->crc;
+			return ERROR_OK;
+		}
+	}
+
+	int retval = image_calculate_checksum(data, size, checksum);
+	if (retval == ERROR_OK && crc) {
+		crc->valid = true;
+		crc->size = size;
+		crc->crc = *checksum;
+	}
+
+	return retval;
+}
+
 int image_open(struct image *image, const char *url, const char *type_string)
 {
 	int retval = ERROR_OK;
 
+	image->cache = NULL;
+
 	retval = identify_image_type(image, type_string, url);
 	if (retval != ERROR_OK)
 		return retval;
@@ -966,8 +1185,9 @@ int image_open(struct image *image, const char *url, const char *type_string)
 		struct image_binary *image_binary;
 
 		image_binary = image->type_private = malloc(sizeof(struct image_binary));
+		image_binary->offsets = NULL;
 
-		retval = fileio_open(&image_binary->fileio, url, FILEIO_READ, FILEIO_BINARY);
+		retval = fileio_open_uncompressed(&image_binary->fileio, url, FILEIO_BINARY);
 		if (retval != ERROR_OK)
 			goto free_mem_on_error;
 
@@ -983,28 +1203,43 @@ int image_open(struct image *image, const char *url, const char *type_string)
 		image->sections[0].base_address = 0x0;
 		image->sections[0].size = filesize;
 		image->sections[0].flags = 0;
+
+		struct image_cache *cache = image_cache_find(image, url, image_binary->fileio);
+		if (cache) {
+			cache->users++;
+			image->cache = cache;
+		} else {
+			image_cache_add(image, url, image_binary->fileio, NULL);
+		}
 	} else if (image->type == IMAGE_IHEX) {
 		struct image_ihex *image_ihex;
 
 		image_ihex = image->type_private = malloc(sizeof(struct image_ihex));
 
-		retval = fileio_open(&image_ihex->fileio, url, FILEIO_READ, FILEIO_TEXT);
+		retval = fileio_open_uncompressed(&image_ihex->fileio, url, FILEIO_TEXT);
 		if (retval != ERROR_OK)
 			goto free_mem_on_error;
 
-		retval = image_ihex_buffer_complete(image);
-		if (retval != ERROR_OK) {
-			LOG_ERROR(
-				"failed buffering IHEX image, check server output for additional information");
-			fileio_close(image_ihex->fileio);
-			goto free_mem_on_error;
+		image_ihex->buffer = NULL;
+		struct image_cache *cache = image_cache_find(image, url, image_ihex->fileio);
+		if (cache) {
+			image_cache_use(image, cache);
+		} else {
+			retval = image_ihex_buffer_complete(image);
+			if (retval != ERROR_OK) {
+				LOG_ERROR(
+					"failed buffering IHEX image, check server output for additional information");
+				fileio_close(image_ihex->fileio);
+				goto free_mem_on_error;
+			}
+			image_cache_add(image, url, image_ihex->fileio, &image_ihex->buffer);
 		}
 	} else if (image->type == IMAGE_ELF) {
 		struct image_elf *image_elf;
 
 		image_elf = image->type_private = malloc(sizeof(struct image_elf));
 
-		retval = fileio_open(&image_elf->fileio, url, FILEIO_READ, FILEIO_BINARY);
+		retval = fileio_open_uncompressed(&image_elf->fileio, url, FILEIO_BINARY);
 		if (retval != ERROR_OK)
 			goto free_mem_on_error;
 
@@ -1013,6 +1248,14 @@ int image_open(struct image *image, const char *url, const char *type_string)
 			fileio_close(image_elf->fileio);
 			goto free_mem_on_error;
 		}
+
+		struct image_cache *cache = image_cache_find(image, url, image_elf->fileio);
+		if (cache && cache->num_sections == image->num_sections) {
+			cache->users++;
+			image->cache = cache;
+		} else {
+			image_cache_add(image, url, image_elf->fileio, NULL);
+		}
 	} else if (image->type == IMAGE_MEMORY) {
 		struct target *target = get_target(url);
 
@@ -1039,16 +1282,23 @@ int image_open(struct image *image, const char *url, const char *type_string)
 
 		image_mot = image->type_private = malloc(sizeof(struct image_mot));
 
-		retval = fileio_open(&image_mot->fileio, url, FILEIO_READ, FILEIO_TEXT);
+		retval = fileio_open_uncompressed(&image_mot->fileio, url, FILEIO_TEXT);
 		if (retval != ERROR_OK)
 			goto free_mem_on_error;
 
-		retval = image_mot_buffer_complete(image);
-		if (retval != ERROR_OK) {
-			LOG_ERROR(
-				"failed buffering S19 image, check server output for additional information");
-			fileio_close(image_mot->fileio);
-			goto free_mem_on_error;
+		image_mot->buffer = NULL;
+		struct image_cache *cache = image_cache_find(image, url, image_mot->fileio);
+		if (cache) {
+			image_cache_use(image, cache);
+		} else {
+			retval = image_mot_buffer_complete(image);
+			if (retval != ERROR_OK) {
+				LOG_ERROR(
+					"failed buffering S19 image, check server output for additional information");
+				fileio_close(image_mot->fileio);
+				goto free_mem_on_error;
+			}
+			image_cache_add(image, url, image_mot->fileio, &image_mot->buffer);
 		}
 	} else if (image->type == IMAGE_BUILDER) {
 		image->num_sections = 0;
@@ -1098,9 +1348,11 @@ int image_read_section(struct image *image,
 	if (image->type == IMAGE_BINARY) {
 		struct image_binary *image_binary = image->type_private;
 
-		/* only one section in a plain binary */
-		if (section != 0)
+		/* a plain binary has one section, unless it has been split */
+		if (section != 0 && !image_binary->offsets)
 			return ERROR_COMMAND_SYNTAX_ERROR;
+		if (image_binary->offsets)
+			offset += image_binary->offsets[section];
 
 		/* seek to offset */
 		retval = fileio_seek(image_binary->fileio, offset);
@@ -1171,6 +1423,63 @@ int image_read_section(struct image *image,
 	return ERROR_OK;
 }
 
+/**
+ * Get the content of a whole section without copying it, when the image
+ * already holds it in memory (hex, S-record and builder images) or its
+ * file can be mapped (binary and ELF images).
+ *
+ * @param size Returns the number of bytes available, which like for
+ * image_read_section() can be less than the section size for ELF segments
+ * not fully present in the file.
+ * @returns ERROR_OK, or an error if the section has to be read with
+ * image_read_section().
+ */
+int image_map_section(struct image *image, int section,
+	const uint8_t **data, size_t *size)
+{
+	int retval;
+
+	if (image->type == IMAGE_BINARY) {
+		struct image_binary *image_binary = image->type_private;
+
+		if (section != 0 && !image_binary->offsets)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+
+		retval = fileio_map(image_binary->fileio, data);
+		if (retval != ERROR_OK)
+			return retval;
+		if (image_binary->offsets)
+			*data += image_binary->offsets[section];
+		*size = image->sections[section].size;
+	} else if (image->type == IMAGE_ELF) {
+		struct image_elf *elf = image->type_private;
+		uint64_t file_offset, file_size;
+
+		if (elf->is_64_bit) {
+			Elf64_Phdr *segment = (Elf64_Phdr *)image->sections[section].private;
+			file_offset = field64(elf, segment->p_offset);
+			file_size = field64(elf, segment->p_filesz);
+		} else {
+			Elf32_Phdr *segment = (Elf32_Phdr *)image->sections[section].private;
+			file_offset = field32(elf, segment->p_offset);
+			file_size = field32(elf, segment->p_filesz);
+		}
+
+		retval = image_elf_map_segment(image, file_offset, file_size, data);
+		if (retval != ERROR_OK)
+			return retval;
+		*size = MIN(image->sections[section].size, file_size);
+	} else if (image->type == IMAGE_IHEX || image->type == IMAGE_SRECORD
+			|| image->type == IMAGE_BUILDER) {
+		*data = image->sections[section].private;
+		*size = image->sections[section].size;
+	} else {
+		return ERROR_IMAGE_TEMPORARILY_UNAVAILABLE;
+	}
+
+	return ERROR_OK;
+}
+
 int image_add_section(struct image *image, target_addr_t base, uint32_t size, uint64_t flags, uint8_t const *data)
 {
 	struct imagesection *section;
@@ -1214,6 +1523,9 @@ void image_close(struct image *image)
 		struct image_binary *image_binary = image->type_private;
 
 		fileio_close(image_binary->fileio);
+
+		free(image_binary->offsets);
+		image_binary->offsets = NULL;
 	} else if (image->type == IMAGE_IHEX) {
 		struct image_ihex *image_ihex = image->type_private;
 
@@ -1263,14 +1575,149 @@ void image_close(struct image *image)
 
 	free(image->sections);
 	image->sections = NULL;
+
+	image_cache_release(image);
 }
 
-int image_calculate_checksum(const uint8_t *buffer, uint32_t nbytes, uint32_t *checksum)
+/* add a section [start, end) of a plain binary being split */
+static int image_binary_add_split(struct imagesection **sections, size_t **offsets,
+		unsigned int *count, target_addr_t base, size_t start, size_t end)
 {
-	uint32_t crc = 0xffffffff;
-	LOG_DEBUG("Calculating checksum");
+	struct imagesection *s = realloc(*sections, (*count + 1) * sizeof(*s));
+	if (!s)
+		return ERROR_FAIL;
+	*sections = s;
+	size_t *o = realloc(*offsets, (*count + 1) * sizeof(*o));
+	if (!o)
+		return ERROR_FAIL;
+	*offsets = o;
+
+	s[*count].base_address = base + start;
+	s[*count].size = end - start;
+	s[*count].flags = IMAGE_SECTION_SPARSE;
+	s[*count].private = NULL;
+	o[*count] = start;
+	(*count)++;
+
+	return ERROR_OK;
+}
+
+/**
+ * Split a plain binary image at every run of at least @a min_gap bytes
+ * of @a value, e.g. the erased value of a flash, so that images padded
+ * to the size of a flash bank only describe the data actually used.
+ * Leading and trailing runs are dropped. Other image types are left as
+ * they are.
+ */
+int image_binary_split(struct image *image, uint8_t value, uint32_t min_gap)
+{
+	if (image->type != IMAGE_BINARY || image->num_sections != 1 || min_gap == 0)
+		return ERROR_OK;
+
+	struct image_binary *image_binary = image->type_private;
+	if (image_binary->offsets)
+		return ERROR_OK;
+
+	target_addr_t base = image->sections[0].base_address;
+	size_t size = image->sections[0].size;
+	const uint8_t *map = NULL;
+	uint8_t *chunk = NULL;
+	size_t chunk_size = 0;
+
+	if (image_map_section(image, 0, &map, &size) != ERROR_OK) {
+		chunk_size = MIN(size, 64 * 1024);
+		chunk = malloc(chunk_size);
+		if (!chunk)
+			return ERROR_FAIL;
+	}
+
+	struct imagesection *sections = NULL;
+	size_t *offsets = NULL;
+	unsigned int count = 0;
+	bool open = false;
+	size_t seg_start = 0, run = 0;
+	int retval = ERROR_OK;
+
+	for (size_t pos = 0; pos < size && retval == ERROR_OK; ) {
+		const uint8_t *data = map ? map + pos : chunk;
+		size_t len = map ? size - pos : MIN(chunk_size, size - pos);
+
+		if (!map) {
+			size_t size_read;
+			retval = image_read_section(image, 0, pos, len, chunk, &size_read);
+			if (retval == ERROR_OK && size_read != len)
+				retval = ERROR_FILEIO_OPERATION_FAILED;
+			if (retval != ERROR_OK)
+				break;
+		}
+
+		for (size_t i = 0; i < len; i++) {
+			if (data[i] == value) {
+				run++;
+				continue;
+			}
+			if (!open) {
+				seg_start = pos + i;
+				open = true;
+			} else if (run >= min_gap) {
+				if (count + 1 >= IMAGE_MAX_SECTIONS) {
+					/* keep the rest in one section */
+					run = 0;
+					continue;
+				}
+				retval = image_binary_add_split(&sections, &offsets, &count, base,
+						seg_start, pos + i - run);
+				if (retval != ERROR_OK)
+					break;
+				seg_start = pos + i;
+			}
+			run = 0;
+		}
+		pos += len;
+	}
+
+	if (retval == ERROR_OK && open)
+		retval = image_binary_add_split(&sections, &offsets, &count, base,
+				seg_start, size - run);
+
+	free(chunk);
 
-	static uint32_t crc32_table[256];
+	if (retval != ERROR_OK) {
+		free(sections);
+		free(offsets);
+		return retval;
+	}
+
+	size_t used = 0;
+	for (unsigned int i = 0; i < count; i++)
+		used += sections[i].size;
+	LOG_DEBUG("binary image split in %u sections, %zu of %zu bytes skipped",
+		count, size - used, size);
+
+	free(image->sections);
+	image->sections = sections;
+	image->num_sections = count;
+	image_binary->offsets = offsets;
+
+	/* the cached checksums are indexed by the sections of the whole file */
+	image_cache_release(image);
+
+	return ERROR_OK;
+}
+
+/**
+ * Continue a CRC computation with a further block of data.
+ *
+ * @param checksum Running CRC, 0xffffffff before the first block.
+ *	Updated on success.
+ */
+int image_calculate_checksum_update(const uint8_t *buffer, uint32_t nbytes,
+		uint32_t *checksum)
+{
+	uint32_t crc = *checksum;
+
+	/* Slice-by-8 tables, crc32_table[0] being the plain byte table */
+	static uint32_t crc32_table[8][256];
 
 	static bool first_init;
 	if (!first_init) {
@@ -1280,26 +1727,52 @@ int image_calculate_checksum(const uint8_t *buffer, uint32_t nbytes, uint32_t *c
 			/* as per gdb */
 			for (c = i << 24, j = 8; j > 0; --j)
 				c = c & 0x80000000 ? (c << 1) ^ 0x04c11db7 : (c << 1);
-			crc32_table[i] = c;
+			crc32_table[0][i] = c;
+		}
+		for (i = 0; i < 256; i++) {
+			c = crc32_table[0][i];
+			for (j = 1; j < 8; j++) {
+				c = (c << 8) ^ crc32_table[0][c >> 24];
+				crc32_table[j][i] = c;
+			}
 		}
 
 		first_init = true;
 	}
 
+	const uint32_t (*t)[256] = crc32_table;
 	while (nbytes > 0) {
-		int run = nbytes;
-		if (run > 32768)
-			run = 32768;
+		uint32_t run = MIN(nbytes, 32768);
 		nbytes -= run;
+		for (; run >= 8; run -= 8, buffer += 8) {
+			crc ^= ((uint32_t)buffer[0] << 24) | (buffer[1] << 16) |
+				(buffer[2] << 8) | buffer[3];
+			crc = t[7][crc >> 24] ^ t[6][(crc >> 16) & 255] ^
+				t[5][(crc >> 8) & 255] ^ t[4][crc & 255] ^
+				t[3][buffer[4]] ^ t[2][buffer[5]] ^ t[1][buffer[6]] ^ t[0][buffer[7]];
+		}
 		while (run--) {
 			/* as per gdb */
-			crc = (crc << 8) ^ crc32_table[((crc >> 24) ^ *buffer++) & 255];
+			crc = (crc << 8) ^ t[0][((crc >> 24) ^ *buffer++) & 255];
 		}
 		keep_alive();
 		if (openocd_is_shutdown_pending())
 			return ERROR_SERVER_INTERRUPTED;
 	}
 
+	*checksum = crc;
+	return ERROR_OK;
+}
+
+int image_calculate_checksum(const uint8_t *buffer, uint32_t nbytes, uint32_t *checksum)
+{
+	uint32_t crc = 0xffffffff;
+	LOG_DEBUG("Calculating checksum");
+
+	int retval = image_calculate_checksum_update(buffer, nbytes, &crc);
+	if (retval != ERROR_OK)
+		return retval;
+
 	LOG_DEBUG("Calculating checksum done; checksum=0x%" PRIx32, crc);
 
 	*checksum = crc;
@@ -45,9 +45,17 @@ struct imagesection {
 	void *private;		/* private data */
 };
 
+/* section flag, the section was split from a plain binary by
+ * image_binary_split() and the gap to the next such section only
+ * contained the split value */
+#define IMAGE_SECTION_SPARSE		(1ULL << 32)
+
+struct image_cache;
+
 struct image {
 	enum image_type type;		/* image type (plain, ihex, ...) */
 	void *type_private;		/* type private data */
+	struct image_cache *cache;	/* parsed content and checksums shared across opens */
 	unsigned int num_sections;		/* number of sections contained in the image */
 	struct imagesection *sections;	/* array of sections */
 	bool base_address_set;	/* whether the image has a base address set (for relocation purposes) */
@@ -58,6 +66,7 @@ struct image {
 
 struct image_binary {
 	struct fileio *fileio;
+	size_t *offsets;	/* file offset of each section, NULL for one section at 0 */
 };
 
 struct image_ihex {
@@ -94,13 +103,20 @@ struct image_mot {
 int image_open(struct image *image, const char *url, const char *type_string);
 int image_read_section(struct image *image, int section, target_addr_t offset,
 		uint32_t size, uint8_t *buffer, size_t *size_read);
+int image_map_section(struct image *image, int section,
+		const uint8_t **data, size_t *size);
 void image_close(struct image *image);
+int image_binary_split(struct image *image, uint8_t value, uint32_t min_gap);
+int image_section_checksum(struct image *image, int section,
+		const uint8_t *data, uint32_t size, uint32_t *checksum);
 
 int image_add_section(struct image *image, target_addr_t base, uint32_t size,
 		uint64_t flags, uint8_t const *data);
 
 int image_calculate_checksum(const uint8_t *buffer, uint32_t nbytes,
 		uint32_t *checksum);
+int image_calculate_checksum_update(const uint8_t *buffer, uint32_t nbytes,
+		uint32_t *checksum);
 
 #define ERROR_IMAGE_FORMAT_ERROR	(-1400)
 #define ERROR_IMAGE_TYPE_UNKNOWN	(-1401)
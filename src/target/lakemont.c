@@ -54,6 +54,7 @@ static struct reg_cache *lakemont_build_reg_cache
 static int submit_reg_pir(struct target *t, int num);
 static int submit_instruction_pir(struct target *t, int num);
 static int submit_pir(struct target *t, uint64_t op);
+static int transaction_status(struct target *t);
 static int lakemont_get_core_reg(struct reg *reg);
 static int lakemont_set_core_reg(struct reg *reg, uint8_t *buf);
 
@@ -593,26 +594,118 @@ static int do_resume(struct target *t)
 	return target_call_event_callbacks(t, TARGET_EVENT_RESUMED);
 }
 
+/* queue the scans reading reg from lakemont core shadow ram, the value is captured in pdr */
+static int queue_read_hw_reg(struct target *t, int reg, uint8_t *pdr)
+{
+	struct x86_32_common *x86_32 = target_to_x86_32(t);
+	int flush = x86_32->flush;
+	int retval = ERROR_FAIL;
+
+	x86_32->flush = 0; /* don't flush scans till we have a batch */
+	if (submit_reg_pir(t, reg) != ERROR_OK)
+		goto out;
+	if (submit_instruction_pir(t, SRAMACCESS) != ERROR_OK)
+		goto out;
+	if (submit_instruction_pir(t, SRAM2PDR) != ERROR_OK)
+		goto out;
+	scan.out[0] = RDWRPDR;
+	if (irscan(t, scan.out, NULL, LMT_IRLEN) != ERROR_OK)
+		goto out;
+	if (drscan(t, NULL, pdr, PDR_SIZE) != ERROR_OK)
+		goto out;
+	jtag_add_sleep(DELAY_SUBMITPIR);
+	retval = ERROR_OK;
+out:
+	x86_32->flush = flush;
+	return retval;
+}
+
+/* queue the scans writing regval to reg in lakemont core shadow ram */
+static int queue_write_hw_reg(struct target *t, int reg, uint32_t regval)
+{
+	struct x86_32_common *x86_32 = target_to_x86_32(t);
+	int flush = x86_32->flush;
+	int retval = ERROR_FAIL;
+	uint8_t reg_buf[4];
+
+	buf_set_u32(reg_buf, 0, 32, regval);
+
+	x86_32->flush = 0; /* don't flush scans till we have a batch */
+	if (submit_reg_pir(t, reg) != ERROR_OK)
+		goto out;
+	if (submit_instruction_pir(t, SRAMACCESS) != ERROR_OK)
+		goto out;
+	scan.out[0] = RDWRPDR;
+	if (irscan(t, scan.out, NULL, LMT_IRLEN) != ERROR_OK)
+		goto out;
+	/* reg_buf is copied by the queue, the captured value is not used */
+	if (drscan(t, reg_buf, scan.in, PDR_SIZE) != ERROR_OK)
+		goto out;
+	if (submit_instruction_pir(t, PDR2SRAM) != ERROR_OK)
+		goto out;
+	retval = ERROR_OK;
+out:
+	x86_32->flush = flush;
+	return retval;
+}
+
+/* update the reg cache with the value read by queue_read_hw_reg() */
+static uint32_t read_hw_reg_done(struct target *t, int reg, const uint8_t *pdr, uint8_t cache)
+{
+	struct x86_32_common *x86_32 = target_to_x86_32(t);
+	struct lakemont_core_reg *arch_info = x86_32->cache->reg_list[reg].arch_info;
+	uint32_t regval = buf_get_u32(pdr, 0, 32);
+
+	if (cache) {
+		buf_set_u32(x86_32->cache->reg_list[reg].value, 0, 32, regval);
+		x86_32->cache->reg_list[reg].valid = true;
+		x86_32->cache->reg_list[reg].dirty = false;
+	}
+	LOG_DEBUG("reg=%s, op=0x%016" PRIx64 ", val=0x%08" PRIx32,
+			x86_32->cache->reg_list[reg].name,
+			arch_info->op,
+			regval);
+	return regval;
+}
+
+/* all the registers are read in a single flush of the jtag queue */
 static int read_all_core_hw_regs(struct target *t)
 {
 	int err;
-	uint32_t regval;
 	unsigned i;
 	struct x86_32_common *x86_32 = target_to_x86_32(t);
-	for (i = 0; i < (x86_32->cache->num_regs); i++) {
+	unsigned int num_regs = x86_32->cache->num_regs;
+	uint8_t *pdr = calloc(num_regs, PDR_SIZE / 8);
+	if (!pdr) {
+		LOG_ERROR("%s out of memory", __func__);
+		return ERROR_FAIL;
+	}
+	for (i = 0; i < num_regs; i++) {
 		if (regs[i].pm_idx == NOT_AVAIL_REG)
 			continue;
-		err = read_hw_reg(t, regs[i].id, &regval, 1);
+		err = queue_read_hw_reg(t, regs[i].id, pdr + i * (PDR_SIZE / 8));
 		if (err != ERROR_OK) {
 			LOG_ERROR("%s error saving reg %s",
 					__func__, x86_32->cache->reg_list[i].name);
-			return err;
+			goto out;
 		}
 	}
+	err = jtag_execute_queue();
+	if (err != ERROR_OK) {
+		LOG_ERROR("%s failed to execute queue", __func__);
+		goto out;
+	}
+	for (i = 0; i < num_regs; i++) {
+		if (regs[i].pm_idx != NOT_AVAIL_REG)
+			read_hw_reg_done(t, regs[i].id, pdr + i * (PDR_SIZE / 8), 1);
+	}
 	LOG_DEBUG("read_all_core_hw_regs read %u registers ok", i);
-	return ERROR_OK;
+out:
+	free(pdr);
+	return err;
 }
 
+/* all the registers are written in a single flush of the jtag queue */
 static int write_all_core_hw_regs(struct target *t)
 {
 	int err;
@@ -621,13 +714,28 @@ static int write_all_core_hw_regs(struct target *t)
 	for (i = 0; i < (x86_32->cache->num_regs); i++) {
 		if (regs[i].pm_idx == NOT_AVAIL_REG)
 			continue;
-		err = write_hw_reg(t, i, 0, 1);
+		uint32_t regval = buf_get_u32(x86_32->cache->reg_list[i].value, 0, 32);
+		LOG_DEBUG("reg=%s, op=0x%016" PRIx64 ", val=0x%08" PRIx32,
+				x86_32->cache->reg_list[i].name, regs[i].op, regval);
+		err = queue_write_hw_reg(t, i, regval);
 		if (err != ERROR_OK) {
 			LOG_ERROR("%s error restoring reg %s",
 					__func__, x86_32->cache->reg_list[i].name);
 			return err;
 		}
 	}
+	err = jtag_execute_queue();
+	if (err != ERROR_OK) {
+		LOG_ERROR("%s failed to execute queue", __func__);
+		return err;
+	}
+	/* we are writing from the cache so ensure we reset flags */
+	for (i = 0; i < (x86_32->cache->num_regs); i++) {
+		if (regs[i].pm_idx == NOT_AVAIL_REG)
+			continue;
+		x86_32->cache->reg_list[i].dirty = false;
+		x86_32->cache->reg_list[i].valid = false;
+	}
 	LOG_DEBUG("write_all_core_hw_regs wrote %u registers ok", i);
 	return ERROR_OK;
 }
@@ -635,34 +743,15 @@ static int write_all_core_hw_regs(struct target *t)
 /* read reg from lakemont core shadow ram, update reg cache if needed */
 static int read_hw_reg(struct target *t, int reg, uint32_t *regval, uint8_t cache)
 {
-	struct x86_32_common *x86_32 = target_to_x86_32(t);
-	struct lakemont_core_reg *arch_info;
-	arch_info = x86_32->cache->reg_list[reg].arch_info;
-	x86_32->flush = 0; /* don't flush scans till we have a batch */
-	if (submit_reg_pir(t, reg) != ERROR_OK)
-		return ERROR_FAIL;
-	if (submit_instruction_pir(t, SRAMACCESS) != ERROR_OK)
-		return ERROR_FAIL;
-	if (submit_instruction_pir(t, SRAM2PDR) != ERROR_OK)
-		return ERROR_FAIL;
-	x86_32->flush = 1;
-	scan.out[0] = RDWRPDR;
-	if (irscan(t, scan.out, NULL, LMT_IRLEN) != ERROR_OK)
+	uint8_t pdr[PDR_SIZE / 8];
+
+	if (queue_read_hw_reg(t, reg, pdr) != ERROR_OK)
 		return ERROR_FAIL;
-	if (drscan(t, NULL, scan.out, PDR_SIZE) != ERROR_OK)
+	if (jtag_execute_queue() != ERROR_OK) {
+		LOG_ERROR("%s failed to execute queue", __func__);
 		return ERROR_FAIL;
-
-	jtag_add_sleep(DELAY_SUBMITPIR);
-	*regval = buf_get_u32(scan.out, 0, 32);
-	if (cache) {
-		buf_set_u32(x86_32->cache->reg_list[reg].value, 0, 32, *regval);
-		x86_32->cache->reg_list[reg].valid = true;
-		x86_32->cache->reg_list[reg].dirty = false;
 	}
-	LOG_DEBUG("reg=%s, op=0x%016" PRIx64 ", val=0x%08" PRIx32,
-			x86_32->cache->reg_list[reg].name,
-			arch_info->op,
-			*regval);
+	*regval = read_hw_reg_done(t, reg, pdr, cache);
 	return ERROR_OK;
 }
 
@@ -673,28 +762,19 @@ static int write_hw_reg(struct target *t, int reg, uint32_t regval, uint8_t cach
 	struct lakemont_core_reg *arch_info;
 	arch_info = x86_32->cache->reg_list[reg].arch_info;
 
-	uint8_t reg_buf[4];
 	if (cache)
 		regval = buf_get_u32(x86_32->cache->reg_list[reg].value, 0, 32);
-	buf_set_u32(reg_buf, 0, 32, regval);
 	LOG_DEBUG("reg=%s, op=0x%016" PRIx64 ", val=0x%08" PRIx32,
 			x86_32->cache->reg_list[reg].name,
 			arch_info->op,
 			regval);
 
-	x86_32->flush = 0; /* don't flush scans till we have a batch */
-	if (submit_reg_pir(t, reg) != ERROR_OK)
+	if (queue_write_hw_reg(t, reg, regval) != ERROR_OK)
 		return ERROR_FAIL;
-	if (submit_instruction_pir(t, SRAMACCESS) != ERROR_OK)
-		return ERROR_FAIL;
-	scan.out[0] = RDWRPDR;
-	if (irscan(t, scan.out, NULL, LMT_IRLEN) != ERROR_OK)
-		return ERROR_FAIL;
-	if (drscan(t, reg_buf, scan.out, PDR_SIZE) != ERROR_OK)
-		return ERROR_FAIL;
-	x86_32->flush = 1;
-	if (submit_instruction_pir(t, PDR2SRAM) != ERROR_OK)
+	if (jtag_execute_queue() != ERROR_OK) {
+		LOG_ERROR("%s failed to execute queue", __func__);
 		return ERROR_FAIL;
+	}
 
 	/* we are writing from the cache so ensure we reset flags */
 	if (cache) {
@@ -704,6 +784,76 @@ static int write_hw_reg(struct target *t, int reg, uint32_t regval, uint8_t cach
 	return ERROR_OK;
 }
 
+/*
+ * Read count units of size bytes from addr, the probe mode instructions of
+ * up to LMT_MEM_BATCH units are queued for a single flush of the jtag queue.
+ * The transaction status is checked once per batch.
+ */
+static int read_mem_block(struct target *t, uint32_t size, uint32_t addr,
+		uint32_t count, uint8_t *buf)
+{
+	struct x86_32_common *x86_32 = target_to_x86_32(t);
+	uint8_t pdr[LMT_MEM_BATCH][PDR_SIZE / 8];
+	int instr;
+
+	/* if CS.D bit=1 then its a 32 bit code segment, else 16 */
+	bool use32 = (buf_get_u32(x86_32->cache->reg_list[CSAR].value, 0, 32)) & CSAR_D;
+	switch (size) {
+		case BYTE:
+			instr = use32 ? MEMRDB32 : MEMRDB16;
+			break;
+		case WORD:
+			instr = use32 ? MEMRDH32 : MEMRDH16;
+			break;
+		case DWORD:
+			instr = use32 ? MEMRDW32 : MEMRDW16;
+			break;
+		default:
+			LOG_ERROR("%s invalid read mem size", __func__);
+			return ERROR_FAIL;
+	}
+
+	while (count) {
+		uint32_t n = MIN(count, LMT_MEM_BATCH);
+		int flush = x86_32->flush;
+		int retval = ERROR_OK;
+
+		x86_32->flush = 0;
+		for (uint32_t i = 0; i < n && retval == ERROR_OK; i++) {
+			retval = queue_write_hw_reg(t, EAX, addr + i * size);
+			if (retval == ERROR_OK)
+				retval = submit_instruction_pir(t, instr);
+			if (retval == ERROR_OK)
+				retval = queue_read_hw_reg(t, EDX, pdr[i]);
+		}
+		x86_32->flush = flush;
+		if (retval != ERROR_OK)
+			return retval;
+
+		retval = jtag_execute_queue();
+		if (retval != ERROR_OK) {
+			LOG_ERROR("%s failed to execute queue", __func__);
+			return retval;
+		}
+
+		retval = transaction_status(t);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("%s error on mem read", __func__);
+			return retval;
+		}
+
+		/* EDX holds the unit in its low bytes */
+		for (uint32_t i = 0; i < n; i++)
+			memcpy(buf + i * size, pdr[i], size);
+
+		addr += n * size;
+		buf += n * size;
+		count -= n;
+	}
+
+	return ERROR_OK;
+}
+
 static bool is_paging_enabled(struct target *t)
 {
 	struct x86_32_common *x86_32 = target_to_x86_32(t);
@@ -836,6 +986,7 @@ int lakemont_init_arch_info(struct target *t, struct x86_32_common *x86_32)
 	x86_32->transaction_status = transaction_status;
 	x86_32->read_hw_reg = read_hw_reg;
 	x86_32->write_hw_reg = write_hw_reg;
+	x86_32->read_mem_block = read_mem_block;
 	x86_32->sw_bpts_supported = sw_bpts_supported;
 	x86_32->get_num_user_regs = get_num_user_regs;
 	x86_32->is_paging_enabled = is_paging_enabled;
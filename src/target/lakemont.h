@@ -46,6 +46,8 @@
 #define TS_SIZE			32
 #define BP_SIZE			1
 #define MAX_SCAN_SIZE	PIR_SIZE
+/* memory units read per jtag queue flush */
+#define LMT_MEM_BATCH	64
 
 /* needed during lakemont probemode */
 #define NOT_PMREG		0xfe
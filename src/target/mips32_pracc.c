@@ -474,9 +474,14 @@ int mips32_pracc_read_mem(struct mips_ejtag *ejtag_info, uint32_t addr, int size
 	struct pracc_queue_info ctx = {.ejtag_info = ejtag_info};
 	pracc_queue_init(&ctx);
 
+	/* as many loads as fit in the pracc text, each takes a load, an optional
+	 * sync and a store; keep some room for the LUIs and the epilogue */
+	int max_round_count = (PRACC_MAX_INSTRUCTIONS - 16) /
+		(mips32_cpu_support_sync(ejtag_info) ? 3 : 2);
+
 	uint32_t *data = NULL;
 	if (size != 4) {
-		data = malloc(256 * sizeof(uint32_t));
+		data = malloc(max_round_count * sizeof(uint32_t));
 		if (!data) {
 			LOG_ERROR("Out of memory");
 			goto exit;
@@ -491,7 +496,7 @@ int mips32_pracc_read_mem(struct mips_ejtag *ejtag_info, uint32_t addr, int size
 		ctx.code_count = 0;
 		ctx.store_count = 0;
 
-		int this_round_count = (count > 256) ? 256 : count;
+		int this_round_count = MIN(count, max_round_count);
 		uint32_t last_upper_base_addr = UPPER16((addr + 0x8000));
 
 		pracc_add(&ctx, 0, MIPS32_LUI(ctx.isa, 15, PRACC_UPPER_BASE_ADDR)); /* $15 = MIPS32_PRACC_BASE_ADDR */
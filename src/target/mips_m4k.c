@@ -1004,6 +1004,32 @@ static void mips_m4k_enable_watchpoints(struct target *target)
 	}
 }
 
+/* Word transfers above this size go through the fastdata handler */
+#define MIPS_M4K_BULK_MIN_WORDS		32
+
+/*
+ * Byte and halfword transfers spanning many words are split into a head up
+ * to the first word boundary, a word body for the fastdata bulk transfer,
+ * and the remaining tail. Returns false if the transfer is not worth it.
+ */
+static bool mips_m4k_split_bulk(target_addr_t address, uint32_t size, uint32_t count,
+		uint32_t *head, uint32_t *words, uint32_t *tail)
+{
+	if (size == 4)
+		return false;
+
+	*head = ((4 - (address & 0x3u)) & 0x3u) / size;
+	if (*head > count)
+		return false;
+
+	*words = (count - *head) * size / 4;
+	if (*words <= MIPS_M4K_BULK_MIN_WORDS)
+		return false;
+
+	*tail = count - *head - *words * 4 / size;
+	return true;
+}
+
 static int mips_m4k_read_memory(struct target *target, target_addr_t address,
 		uint32_t size, uint32_t count, uint8_t *buffer)
 {
@@ -1025,7 +1051,21 @@ static int mips_m4k_read_memory(struct target *target, target_addr_t address,
 	if (((size == 4) && (address & 0x3u)) || ((size == 2) && (address & 0x1u)))
 		return ERROR_TARGET_UNALIGNED_ACCESS;
 
-	if (size == 4 && count > 32) {
+	uint32_t head, words, tail;
+	if (mips_m4k_split_bulk(address, size, count, &head, &words, &tail)) {
+		int retval = ERROR_OK;
+		if (head)
+			retval = mips_m4k_read_memory(target, address, size, head, buffer);
+		if (retval == ERROR_OK)
+			retval = mips_m4k_read_memory(target, address + head * size, 4, words,
+					buffer + head * size);
+		if (retval == ERROR_OK && tail)
+			retval = mips_m4k_read_memory(target, address + head * size + words * 4, size, tail,
+					buffer + head * size + words * 4);
+		return retval;
+	}
+
+	if (size == 4 && count > MIPS_M4K_BULK_MIN_WORDS) {
 		int retval = mips_m4k_bulk_read_memory(target, address, count, buffer);
 		if (retval == ERROR_OK)
 			return ERROR_OK;
@@ -1083,7 +1123,7 @@ static int mips_m4k_write_memory(struct target *target, target_addr_t address,
 		return ERROR_TARGET_NOT_HALTED;
 	}
 
-	if (size == 4 && count > 32) {
+	if (size == 4 && count > MIPS_M4K_BULK_MIN_WORDS) {
 		int retval = mips_m4k_bulk_write_memory(target, address, count, buffer);
 		if (retval == ERROR_OK)
 			return ERROR_OK;
@@ -1097,6 +1137,20 @@ static int mips_m4k_write_memory(struct target *target, target_addr_t address,
 	if (((size == 4) && (address & 0x3u)) || ((size == 2) && (address & 0x1u)))
 		return ERROR_TARGET_UNALIGNED_ACCESS;
 
+	uint32_t head, words, tail;
+	if (mips_m4k_split_bulk(address, size, count, &head, &words, &tail)) {
+		int retval = ERROR_OK;
+		if (head)
+			retval = mips_m4k_write_memory(target, address, size, head, buffer);
+		if (retval == ERROR_OK)
+			retval = mips_m4k_write_memory(target, address + head * size, 4, words,
+					buffer + head * size);
+		if (retval == ERROR_OK && tail)
+			retval = mips_m4k_write_memory(target, address + head * size + words * 4, size, tail,
+					buffer + head * size + words * 4);
+		return retval;
+	}
+
 	/** correct endianness if we have word or hword access */
 	void *t = NULL;
 	if (size > 1) {
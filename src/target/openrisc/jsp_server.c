@@ -191,6 +191,7 @@ static const struct service_driver jsp_service_driver = {
 	.input_handler = jsp_input,
 	.connection_closed_handler = jsp_connection_closed,
 	.keep_client_alive_handler = NULL,
+	.flush_output_handler = NULL,
 };
 
 int jsp_init(struct or1k_jtag *jtag_info, char *banner)
@@ -52,6 +52,14 @@
  */
 #define ENABLE_JSP_MULTI		4
 
+/* Host side option, independent of the RTL configuration.
+ * If this is defined, memory accesses are split in larger bursts,
+ * several of them being sent in a single JTAG queue flush. The CRC of
+ * each burst is checked once the queue is flushed and only the failing
+ * bursts are sent again.
+ */
+#define ADBG_PIPELINED_BURSTS		8
+
 /* Definitions for the top-level debug unit.  This really just consists
  * of a single register, used to select the active debug module ("chain").
  */
@@ -120,6 +128,10 @@
 
 #define MAX_BURST_SIZE			(4 * 1024)
 
+/* The burst length field is 16 bits wide */
+#define MAX_PIPELINED_BURST_SIZE	(32 * 1024)
+#define MAX_PIPELINED_BURSTS		4
+
 #define STATUS_BYTES			1
 #define CRC_LEN				4
 
@@ -389,12 +401,10 @@ static int adbg_ctrl_read(struct or1k_jtag *jtag_info, uint32_t regidx,
  * 32-bit address
  * 16-bit length (of the burst, in words)
  */
-static int adbg_burst_command(struct or1k_jtag *jtag_info, uint32_t opcode,
-			      uint32_t address, uint16_t length_words)
+static void adbg_queue_burst_command(struct or1k_jtag *jtag_info, uint32_t opcode,
+			      uint32_t address, uint16_t length_words, uint32_t data[2])
 {
-	uint32_t data[2];
-
-	/* Set up the data */
+	/* Set up the data, it must stay valid until the queue is flushed */
 	data[0] = length_words | (address << 16);
 	/* MSB must be 0 to access modules */
 	data[1] = ((address >> 16) | ((opcode & 0xf) << 16)) & ~(0x1 << 20);
@@ -406,6 +416,14 @@ static int adbg_burst_command(struct or1k_jtag *jtag_info, uint32_t opcode,
 	field.in_value = NULL;
 
 	jtag_add_dr_scan(jtag_info->tap, 1, &field, TAP_IDLE);
+}
+
+static int adbg_burst_command(struct or1k_jtag *jtag_info, uint32_t opcode,
+			      uint32_t address, uint16_t length_words)
+{
+	uint32_t data[2];
+
+	adbg_queue_burst_command(jtag_info, opcode, address, length_words, data);
 
 	return jtag_execute_queue();
 }
@@ -704,6 +722,221 @@ retry_full_write:
 	return ERROR_OK;
 }
 
+/* Check the Wishbone error register once after pipelined bursts. On a bus
+ * error, the register is cleared and *bus_error is set, the bursts must
+ * then be sent again one by one.
+ */
+static int adbg_wb_pipelined_check_error(struct or1k_jtag *jtag_info, bool *bus_error)
+{
+	uint32_t err_data[2] = {0, 0};
+
+	*bus_error = false;
+	if (or1k_du_adv.options & ADBG_USE_HISPEED)
+		return ERROR_OK;
+
+	int retval = adbg_ctrl_read(jtag_info, DBG_WB_REG_ERROR, err_data, 1);
+	if (retval != ERROR_OK || !(err_data[0] & 0x1))
+		return retval;
+
+	retval = adbg_ctrl_read(jtag_info, DBG_WB_REG_ERROR, err_data, 33);
+	if (retval != ERROR_OK)
+		return retval;
+
+	uint32_t addr = (err_data[0] >> 1) | (err_data[1] << 31);
+	LOG_WARNING("WB bus error during pipelined bursts, address 0x%08" PRIx32 ", retrying!", addr);
+
+	err_data[0] = 1;
+	retval = adbg_ctrl_write(jtag_info, DBG_WB_REG_ERROR, err_data, 1);
+	if (retval != ERROR_OK)
+		return retval;
+
+	*bus_error = true;
+	return ERROR_OK;
+}
+
+/* Read from the Wishbone module with up to MAX_PIPELINED_BURSTS bursts per
+ * JTAG queue flush. A burst with a timeout or a CRC error is read again
+ * with adbg_wb_burst_read(), which does the retries.
+ */
+static int adbg_wb_burst_read_pipelined(struct or1k_jtag *jtag_info, int size,
+			      int count, uint32_t start_address, uint8_t *data)
+{
+	uint8_t opcode;
+	if (size == 1)
+		opcode = DBG_WB_CMD_BREAD8;
+	else if (size == 2)
+		opcode = DBG_WB_CMD_BREAD16;
+	else
+		opcode = DBG_WB_CMD_BREAD32;
+
+	LOG_DEBUG("Doing pipelined burst read, word size %d, word count %d, start address 0x%08" PRIx32,
+		  size, count, start_address);
+
+	int slot_bytes = MAX_PIPELINED_BURST_SIZE * size + CRC_LEN + STATUS_BYTES;
+	uint8_t *in_buffer = malloc(MAX_PIPELINED_BURSTS * slot_bytes);
+	if (!in_buffer) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	uint32_t commands[MAX_PIPELINED_BURSTS][2];
+	uint32_t address = start_address;
+	int left = count;
+	int retval = ERROR_OK;
+
+	while (left) {
+		uint32_t burst_address[MAX_PIPELINED_BURSTS];
+		int words[MAX_PIPELINED_BURSTS];
+		int bursts;
+
+		for (bursts = 0; bursts < MAX_PIPELINED_BURSTS && left; bursts++) {
+			burst_address[bursts] = address;
+			words[bursts] = MIN(left, MAX_PIPELINED_BURST_SIZE);
+
+			adbg_queue_burst_command(jtag_info, opcode, address, words[bursts],
+					commands[bursts]);
+
+			struct scan_field field;
+			field.num_bits = (words[bursts] * size + CRC_LEN + STATUS_BYTES) * 8;
+			field.out_value = NULL;
+			field.in_value = in_buffer + bursts * slot_bytes;
+			jtag_add_dr_scan(jtag_info->tap, 1, &field, TAP_IDLE);
+
+			left -= words[bursts];
+			address += words[bursts] * size;
+		}
+
+		retval = jtag_execute_queue();
+		if (retval != ERROR_OK)
+			goto out;
+
+		/* A bus error is not tied to a burst, read them all again */
+		bool bus_error;
+		retval = adbg_wb_pipelined_check_error(jtag_info, &bus_error);
+		if (retval != ERROR_OK)
+			goto out;
+
+		for (int i = 0; i < bursts; i++) {
+			uint8_t *slot = in_buffer + i * slot_bytes;
+			int burst_bytes = words[i] * size;
+			uint8_t *dest = data + (burst_address[i] - start_address);
+
+			/* Look for the start bit in the first (STATUS_BYTES * 8) bits */
+			int shift = find_status_bit(slot, STATUS_BYTES);
+			if (!bus_error && shift >= 0) {
+				buffer_shr(slot, burst_bytes + CRC_LEN + STATUS_BYTES, shift);
+
+				uint32_t crc_read;
+				memcpy(&crc_read, &slot[burst_bytes], 4);
+				if (crc32_le(CRC32_POLY_LE, 0xffffffff, slot, burst_bytes) == crc_read) {
+					memcpy(dest, slot, burst_bytes);
+					continue;
+				}
+			}
+
+			LOG_DEBUG("Pipelined burst read at 0x%08" PRIx32 " failed, reading it again",
+				  burst_address[i]);
+			retval = adbg_wb_burst_read(jtag_info, size, words[i], burst_address[i], dest);
+			if (retval != ERROR_OK)
+				goto out;
+		}
+	}
+
+out:
+	free(in_buffer);
+
+	return retval;
+}
+
+/* Write to the Wishbone module with up to MAX_PIPELINED_BURSTS bursts per
+ * JTAG queue flush. A burst whose 'CRC match' bit is not set is written
+ * again with adbg_wb_burst_write(), which does the retries.
+ */
+static int adbg_wb_burst_write_pipelined(struct or1k_jtag *jtag_info, const uint8_t *data,
+			int size, int count, uint32_t start_address)
+{
+	uint8_t opcode;
+	if (size == 1)
+		opcode = DBG_WB_CMD_BWRITE8;
+	else if (size == 2)
+		opcode = DBG_WB_CMD_BWRITE16;
+	else
+		opcode = DBG_WB_CMD_BWRITE32;
+
+	LOG_DEBUG("Doing pipelined burst write, word size %d, word count %d, start address 0x%08" PRIx32,
+		  size, count, start_address);
+
+	uint32_t commands[MAX_PIPELINED_BURSTS][2];
+	uint32_t crc[MAX_PIPELINED_BURSTS];
+	uint8_t match[MAX_PIPELINED_BURSTS];
+	uint8_t start_bit = 1;
+	uint32_t address = start_address;
+	int left = count;
+
+	while (left) {
+		uint32_t burst_address[MAX_PIPELINED_BURSTS];
+		int words[MAX_PIPELINED_BURSTS];
+		int bursts;
+
+		for (bursts = 0; bursts < MAX_PIPELINED_BURSTS && left; bursts++) {
+			const uint8_t *src = data + (address - start_address);
+
+			burst_address[bursts] = address;
+			words[bursts] = MIN(left, MAX_PIPELINED_BURST_SIZE);
+			crc[bursts] = crc32_le(CRC32_POLY_LE, 0xffffffff, src, words[bursts] * size);
+
+			adbg_queue_burst_command(jtag_info, opcode, address, words[bursts],
+					commands[bursts]);
+
+			/* Start bit, data and CRC, then read the 'CRC match' bit */
+			struct scan_field field[3];
+			field[0].num_bits = 1;
+			field[0].out_value = &start_bit;
+			field[0].in_value = NULL;
+			field[1].num_bits = words[bursts] * size * 8;
+			field[1].out_value = src;
+			field[1].in_value = NULL;
+			field[2].num_bits = 32;
+			field[2].out_value = (uint8_t *)&crc[bursts];
+			field[2].in_value = NULL;
+			jtag_add_dr_scan(jtag_info->tap, 3, field, TAP_DRSHIFT);
+
+			match[bursts] = 0;
+			field[0].num_bits = 1;
+			field[0].out_value = NULL;
+			field[0].in_value = &match[bursts];
+			jtag_add_dr_scan(jtag_info->tap, 1, field, TAP_IDLE);
+
+			left -= words[bursts];
+			address += words[bursts] * size;
+		}
+
+		int retval = jtag_execute_queue();
+		if (retval != ERROR_OK)
+			return retval;
+
+		/* A bus error is not tied to a burst, write them all again */
+		bool bus_error;
+		retval = adbg_wb_pipelined_check_error(jtag_info, &bus_error);
+		if (retval != ERROR_OK)
+			return retval;
+
+		for (int i = 0; i < bursts; i++) {
+			if (!bus_error && (match[i] & 1))
+				continue;
+
+			LOG_DEBUG("Pipelined burst write at 0x%08" PRIx32 " failed, writing it again",
+				  burst_address[i]);
+			retval = adbg_wb_burst_write(jtag_info, data + (burst_address[i] - start_address),
+					size, words[i], burst_address[i]);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+	}
+
+	return ERROR_OK;
+}
+
 /* Currently hard set in functions to 32-bits */
 static int or1k_adv_jtag_read_cpu(struct or1k_jtag *jtag_info,
 		uint32_t addr, int count, uint32_t *value)
@@ -853,6 +1086,13 @@ static int or1k_adv_jtag_read_memory(struct or1k_jtag *jtag_info,
 	uint32_t block_count_address = addr;
 	uint8_t *block_count_buffer = buffer;
 
+	if (or1k_du_adv.options & ADBG_PIPELINED_BURSTS) {
+		retval = adbg_wb_burst_read_pipelined(jtag_info, size, count, addr, buffer);
+		if (retval != ERROR_OK)
+			return retval;
+		block_count_left = 0;
+	}
+
 	while (block_count_left) {
 
 		int blocks_this_round = (block_count_left > MAX_BURST_SIZE) ?
@@ -936,6 +1176,15 @@ static int or1k_adv_jtag_write_memory(struct or1k_jtag *jtag_info,
 	uint32_t block_count_address = addr;
 	uint8_t *block_count_buffer = (uint8_t *)buffer;
 
+	if (or1k_du_adv.options & ADBG_PIPELINED_BURSTS) {
+		retval = adbg_wb_burst_write_pipelined(jtag_info, buffer, size, count, addr);
+		if (retval != ERROR_OK) {
+			free(t);
+			return retval;
+		}
+		block_count_left = 0;
+	}
+
 	while (block_count_left) {
 
 		int blocks_this_round = (block_count_left > MAX_BURST_SIZE) ?
@@ -13,6 +13,8 @@
 #endif
 
 #include "register.h"
+#include "target.h"
+#include <helper/bits.h>
 #include <helper/log.h>
 
 /**
@@ -102,6 +104,24 @@ void register_cache_invalidate(struct reg_cache *cache)
 	}
 }
 
+/**
+ * Make sure @a reg holds a value read while @a target is in its current
+ * halt. Unlike the plain @c valid test, a value that survived from before
+ * the target last ran, or that a target left marked valid without reading
+ * it, is fetched again; a value already fetched in this halt is not.
+ */
+int register_cache_fetch(struct target *target, struct reg *reg)
+{
+	if (reg->dirty || (reg->valid && reg->generation == target->halt_generation))
+		return ERROR_OK;
+
+	int retval = reg->type->get(reg);
+	if (retval == ERROR_OK)
+		reg->generation = target->halt_generation;
+
+	return retval;
+}
+
 static int register_get_dummy_core_reg(struct reg *reg)
 {
 	return ERROR_OK;
@@ -124,6 +124,8 @@ struct reg {
 	bool dirty;
 	/* When true, value is valid. */
 	bool valid;
+	/* target->halt_generation when value was last read from the target */
+	unsigned int generation;
 	/* When false, the register doesn't actually exist in the target. */
 	bool exist;
 	/* Hide the register from gdb and omit it in 'reg' cmd output */
@@ -160,6 +162,7 @@ struct reg *register_get_by_name(struct reg_cache *first,
 struct reg_cache **register_get_last_cache_p(struct reg_cache **first);
 void register_unlink_cache(struct reg_cache **cache_p, const struct reg_cache *cache);
 void register_cache_invalidate(struct reg_cache *cache);
+int register_cache_fetch(struct target *target, struct reg *reg);
 
 void register_init_dummy(struct reg *reg);
 
@@ -7,6 +7,7 @@
 #include "batch.h"
 #include "debug_defines.h"
 #include "riscv.h"
+#include <jtag/adapter.h>
 
 #define get_field(reg, mask) (((reg) & (mask)) / ((mask) & ~((mask) << 1)))
 #define set_field(reg, mask, val) (((reg) & ~(mask)) | (((val) * ((mask) & ~((mask) << 1))) & (mask)))
@@ -15,6 +16,11 @@
 #define DMI_SCAN_MAX_BIT_LENGTH (DTM_DMI_MAX_ADDRESS_LENGTH + DTM_DMI_DATA_LENGTH + DTM_DMI_OP_LENGTH)
 #define DMI_SCAN_BUF_SIZE (DIV_ROUND_UP(DMI_SCAN_MAX_BIT_LENGTH, 8))
 
+/* Scans per block copy batch when the adapter has no recommendation */
+#define BLOCK_SCANS_DEFAULT 32
+/* A busy response retries the whole batch, so don't let it grow too long */
+#define BLOCK_SCANS_MAX 1024
+
 static void dump_field(int idle, const struct scan_field *field);
 
 struct riscv_batch *riscv_batch_alloc(struct target *target, size_t scans, size_t idle)
@@ -70,6 +76,20 @@ error0:
 	return NULL;
 }
 
+size_t riscv_batch_block_scans(void)
+{
+	unsigned int scans = adapter_get_batch_size();
+
+	if (!scans)
+		return BLOCK_SCANS_DEFAULT;
+
+	/* The batch size counts JTAG commands, a scan of a block copy is
+	 * usually followed by an idle run */
+	scans = MAX(scans / 2, 1u);
+
+	return MIN(scans, BLOCK_SCANS_MAX);
+}
+
 void riscv_batch_free(struct riscv_batch *batch)
 {
 	free(batch->data_in);
@@ -92,11 +112,19 @@ int riscv_batch_run(struct riscv_batch *batch)
 		return ERROR_OK;
 	}
 
-	riscv_batch_add_nop(batch);
+	/* A batch may be run again as it is, it only needs the trailing NOP
+	 * once. */
+	if (batch->last_scan != RISCV_SCAN_TYPE_NOP)
+		riscv_batch_add_nop(batch);
+
+	/* Every scan of the batch goes through the tunnel, so select it once. */
+	if (bscan_tunnel_ir_width != 0)
+		riscv_add_bscan_tunneled_ir_scan(batch->target);
 
 	for (size_t i = 0; i < batch->used_scans; ++i) {
 		if (bscan_tunnel_ir_width != 0)
-			riscv_add_bscan_tunneled_scan(batch->target, batch->fields+i, batch->bscan_ctxt+i);
+			riscv_add_bscan_tunneled_dr_scan(batch->target, batch->fields + i,
+					batch->bscan_ctxt + i);
 		else
 			jtag_add_dr_scan(batch->target->tap, 1, batch->fields + i, TAP_IDLE);
 
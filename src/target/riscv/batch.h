@@ -52,10 +52,15 @@ struct riscv_batch {
 struct riscv_batch *riscv_batch_alloc(struct target *target, size_t scans, size_t idle);
 void riscv_batch_free(struct riscv_batch *batch);
 
+/* Returns the number of scans worth batching for block copies with the
+ * current adapter. */
+size_t riscv_batch_block_scans(void);
+
 /* Checks to see if this batch is full. */
 bool riscv_batch_full(struct riscv_batch *batch);
 
-/* Executes this scan batch. */
+/* Executes this scan batch. The same batch can be executed again, and then
+ * performs the same scans and returns fresh read results. */
 int riscv_batch_run(struct riscv_batch *batch);
 
 /* Adds a DMI write to this batch. */
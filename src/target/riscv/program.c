@@ -122,6 +122,66 @@ int riscv_program_lbr(struct riscv_program *p, enum gdb_regno d, enum gdb_regno
 	return riscv_program_insert(p, lb(d, b, offset));
 }
 
+static int riscv_program_load(struct riscv_program *p, enum gdb_regno d,
+		enum gdb_regno b, int offset, unsigned int size)
+{
+	switch (size) {
+		case 1:
+			return riscv_program_lbr(p, d, b, offset);
+		case 2:
+			return riscv_program_lhr(p, d, b, offset);
+		case 4:
+			return riscv_program_lwr(p, d, b, offset);
+		case 8:
+			return riscv_program_ldr(p, d, b, offset);
+		default:
+			LOG_ERROR("Unsupported size: %d", size);
+			return ERROR_FAIL;
+	}
+}
+
+static int riscv_program_store(struct riscv_program *p, enum gdb_regno s,
+		enum gdb_regno b, int offset, unsigned int size)
+{
+	switch (size) {
+		case 1:
+			return riscv_program_sbr(p, s, b, offset);
+		case 2:
+			return riscv_program_shr(p, s, b, offset);
+		case 4:
+			return riscv_program_swr(p, s, b, offset);
+		case 8:
+			return riscv_program_sdr(p, s, b, offset);
+		default:
+			LOG_ERROR("Unsupported size: %d", size);
+			return ERROR_FAIL;
+	}
+}
+
+int riscv_program_copy_mem_to_data(struct riscv_program *p, enum gdb_regno a,
+		enum gdb_regno t, int data_address, unsigned int size, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++) {
+		if (riscv_program_load(p, t, a, i * size, size) != ERROR_OK)
+			return ERROR_FAIL;
+		if (riscv_program_swr(p, t, GDB_REGNO_ZERO, data_address + 4 * i) != ERROR_OK)
+			return ERROR_FAIL;
+	}
+	return riscv_program_addi(p, a, a, count * size);
+}
+
+int riscv_program_copy_data_to_mem(struct riscv_program *p, enum gdb_regno a,
+		enum gdb_regno t, int data_address, unsigned int size, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++) {
+		if (riscv_program_lwr(p, t, GDB_REGNO_ZERO, data_address + 4 * i) != ERROR_OK)
+			return ERROR_FAIL;
+		if (riscv_program_store(p, t, a, i * size, size) != ERROR_OK)
+			return ERROR_FAIL;
+	}
+	return riscv_program_addi(p, a, a, count * size);
+}
+
 int riscv_program_csrrsi(struct riscv_program *p, enum gdb_regno d, unsigned int z, enum gdb_regno csr)
 {
 	assert(csr >= GDB_REGNO_CSR0 && csr <= GDB_REGNO_CSR4095);
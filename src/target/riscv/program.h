@@ -57,6 +57,15 @@ int riscv_program_swr(struct riscv_program *p, enum gdb_regno s, enum gdb_regno
 int riscv_program_shr(struct riscv_program *p, enum gdb_regno s, enum gdb_regno a, int o);
 int riscv_program_sbr(struct riscv_program *p, enum gdb_regno s, enum gdb_regno a, int o);
 
+/* Unrolled copies of @a count elements of @a size bytes (at most 4) between
+ * memory at the address in register @a a and the DM data registers, which
+ * the hart sees at @a data_address. One data register is used per element,
+ * @a t is clobbered and @a a is advanced past the copied elements. */
+int riscv_program_copy_mem_to_data(struct riscv_program *p, enum gdb_regno a,
+		enum gdb_regno t, int data_address, unsigned int size, unsigned int count);
+int riscv_program_copy_data_to_mem(struct riscv_program *p, enum gdb_regno a,
+		enum gdb_regno t, int data_address, unsigned int size, unsigned int count);
+
 int riscv_program_csrrsi(struct riscv_program *p, enum gdb_regno d, unsigned int z, enum gdb_regno csr);
 int riscv_program_csrrci(struct riscv_program *p, enum gdb_regno d, unsigned int z, enum gdb_regno csr);
 int riscv_program_csrr(struct riscv_program *p, enum gdb_regno d, enum gdb_regno csr);
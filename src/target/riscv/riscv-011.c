@@ -1217,7 +1217,9 @@ static uint64_t reg_cache_get(struct target *target, unsigned int number)
 static void reg_cache_set(struct target *target, unsigned int number,
 		uint64_t value)
 {
-	struct reg *r = &target->reg_cache->reg_list[number];
+	struct reg *r = riscv_reg_cache_entry(target, number);
+	if (!r)
+		return;
 	LOG_DEBUG("%s <= 0x%" PRIx64, r->name, value);
 	r->valid = true;
 	buf_set_u64(r->value, 0, r->size, value);
@@ -39,6 +39,8 @@ static int riscv013_get_register(struct target *target,
 		riscv_reg_t *value, int rid);
 static int riscv013_set_register(struct target *target, int regid, uint64_t value);
 static int riscv013_select_current_hart(struct target *target);
+static int riscv013_halt_summary(struct target *target, unsigned int generation,
+		bool *halted);
 static int riscv013_halt_prep(struct target *target);
 static int riscv013_halt_go(struct target *target);
 static int riscv013_resume_go(struct target *target);
@@ -61,6 +63,9 @@ static int register_read(struct target *target, uint64_t *value, uint32_t number
 static int register_read_direct(struct target *target, uint64_t *value, uint32_t number);
 static int register_write_direct(struct target *target, unsigned number,
 		uint64_t value);
+static int batch_run(const struct target *target, struct riscv_batch *batch);
+static COMMAND_HELPER(riscv013_benchmark, struct target *target, bool memory,
+		target_addr_t address);
 static int read_memory(struct target *target, target_addr_t address,
 		uint32_t size, uint32_t count, uint8_t *buffer, uint32_t increment);
 static int write_memory(struct target *target, target_addr_t address,
@@ -143,12 +148,51 @@ typedef struct {
 	/* The currently selected hartid on this DM. */
 	int current_hartid;
 	bool hasel_supported;
+	/* Last value written to hawindow, when all harts fit in one window. */
+	uint32_t hawindow;
+	bool hawindow_valid;
+
+	/* haltsum0 for the harts in window haltsum0_window, as read during the
+	 * poll with number haltsum0_generation (0 is never used). */
+	uint32_t haltsum0;
+	unsigned int haltsum0_window;
+	unsigned int haltsum0_generation;
 
 	/* The program buffer stores executable code. 0 is an illegal instruction,
 	 * so we use 0 to mean the cached value is invalid. */
 	uint32_t progbuf_cache[16];
 } dm013_info_t;
 
+/* The kinds of access that learn their own number of run-test/idle cycles. */
+typedef enum {
+	DELAY_DMI,			/* any DMI scan */
+	DELAY_ABSTRACT,		/* after starting an abstract command */
+	DELAY_PROGBUF,		/* between autoexec'd program buffer memory accesses */
+	DELAY_SBA_READ,		/* between system bus reads */
+	DELAY_SBA_WRITE,	/* between system bus writes */
+	DELAY_COUNT
+} riscv013_delay_t;
+
+static const char * const riscv013_delay_name[DELAY_COUNT] = {
+	[DELAY_DMI] = "dmi",
+	[DELAY_ABSTRACT] = "abstract",
+	[DELAY_PROGBUF] = "progbuf",
+	[DELAY_SBA_READ] = "sba_read",
+	[DELAY_SBA_WRITE] = "sba_write",
+};
+
+/* The delay grows by 10% on every busy response, and shrinks by 1/8 after
+ * DELAY_DECAY_SUCCESSES accesses without one, so that a single slow event
+ * (e.g. a cache miss) doesn't slow down the rest of the session. */
+#define DELAY_DECAY_SUCCESSES	1000
+
+struct riscv013_delay {
+	unsigned int value;		/* run-test/idle cycles currently used */
+	unsigned int max;		/* highest value used so far */
+	unsigned int successes;	/* accesses since the last busy or decay */
+	unsigned int busy;		/* busy responses, each one caused a retry */
+};
+
 typedef struct {
 	struct list_head list;
 	struct target *target;
@@ -175,21 +219,12 @@ typedef struct {
 	 * access. */
 	unsigned int dtmcs_idle;
 
-	/* This value is incremented every time a dbus access comes back as "busy".
-	 * It's used to determine how many run-test/idle cycles to feed the target
-	 * in between accesses. */
-	unsigned int dmi_busy_delay;
-
-	/* Number of run-test/idle cycles to add between consecutive bus master
-	 * reads/writes respectively. */
-	unsigned int bus_master_write_delay, bus_master_read_delay;
-
-	/* This value is increased every time we tried to execute two commands
-	 * consecutively, and the second one failed because the previous hadn't
-	 * completed yet.  It's used to add extra run-test/idle cycles after
-	 * starting a command, so we don't have to waste time checking for busy to
-	 * go low. */
-	unsigned int ac_busy_delay;
+	/* Number of run-test/idle cycles to feed the target for each kind of
+	 * access. The DMI delay is increased every time a dbus access comes back
+	 * as "busy", the others every time we tried to execute two commands or
+	 * bus accesses consecutively and the second one failed because the
+	 * previous hadn't completed yet. */
+	struct riscv013_delay delay[DELAY_COUNT];
 
 	bool abstract_read_csr_supported;
 	bool abstract_write_csr_supported;
@@ -447,13 +482,51 @@ static uint32_t dtmcontrol_scan(struct target *target, uint32_t out)
 	return in;
 }
 
+static unsigned int delay(const riscv013_info_t *info, riscv013_delay_t kind)
+{
+	return info->delay[kind].value;
+}
+
+static void increase_delay(riscv013_info_t *info, riscv013_delay_t kind)
+{
+	struct riscv013_delay *d = &info->delay[kind];
+
+	d->value += d->value / 10 + 1;
+	d->max = MAX(d->max, d->value);
+	d->successes = 0;
+	d->busy++;
+	LOG_DEBUG("dtmcs_idle=%d, %s delay=%d", info->dtmcs_idle,
+			riscv013_delay_name[kind], d->value);
+}
+
+/* Record @a count accesses of @a kind that completed without busy. */
+static void delay_success(riscv013_info_t *info, riscv013_delay_t kind,
+		unsigned int count)
+{
+	struct riscv013_delay *d = &info->delay[kind];
+
+	if (!d->value)
+		return;
+
+	d->successes += count;
+	if (d->successes < DELAY_DECAY_SUCCESSES)
+		return;
+
+	d->value -= DIV_ROUND_UP(d->value, 8);
+	d->successes = 0;
+	LOG_DEBUG("%s delay lowered to %d", riscv013_delay_name[kind], d->value);
+}
+
+static void reset_delays(riscv013_info_t *info)
+{
+	info->delay[DELAY_DMI].value = 0;
+	info->delay[DELAY_ABSTRACT].value = 0;
+	info->delay[DELAY_PROGBUF].value = 0;
+}
+
 static void increase_dmi_busy_delay(struct target *target)
 {
-	riscv013_info_t *info = get_info(target);
-	info->dmi_busy_delay += info->dmi_busy_delay / 10 + 1;
-	LOG_DEBUG("dtmcs_idle=%d, dmi_busy_delay=%d, ac_busy_delay=%d",
-			info->dtmcs_idle, info->dmi_busy_delay,
-			info->ac_busy_delay);
+	increase_delay(get_info(target), DELAY_DMI);
 
 	dtmcontrol_scan(target, DTM_DTMCS_DMIRESET);
 }
@@ -481,10 +554,8 @@ static dmi_status_t dmi_scan(struct target *target, uint32_t *address_in,
 
 	if (r->reset_delays_wait >= 0) {
 		r->reset_delays_wait--;
-		if (r->reset_delays_wait < 0) {
-			info->dmi_busy_delay = 0;
-			info->ac_busy_delay = 0;
-		}
+		if (r->reset_delays_wait < 0)
+			reset_delays(info);
 	}
 
 	memset(in, 0, num_bytes);
@@ -509,9 +580,9 @@ static dmi_status_t dmi_scan(struct target *target, uint32_t *address_in,
 		jtag_add_dr_scan(target->tap, 1, &field, TAP_IDLE);
 	}
 
-	int idle_count = info->dmi_busy_delay;
+	int idle_count = delay(info, DELAY_DMI);
 	if (exec)
-		idle_count += info->ac_busy_delay;
+		idle_count += delay(info, DELAY_ABSTRACT);
 
 	if (idle_count)
 		jtag_add_runtest(idle_count, TAP_IDLE);
@@ -622,6 +693,7 @@ static int dmi_op_timeout(struct target *target, uint32_t *data_in,
 				if (dmi_busy_encountered)
 					*dmi_busy_encountered = true;
 			} else if (status == DMI_STATUS_SUCCESS) {
+				delay_success(get_info(target), DELAY_DMI, 1);
 				break;
 			} else {
 				if (data_in) {
@@ -708,15 +780,6 @@ static int dmstatus_read(struct target *target, uint32_t *dmstatus,
 			riscv_command_timeout_sec);
 }
 
-static void increase_ac_busy_delay(struct target *target)
-{
-	riscv013_info_t *info = get_info(target);
-	info->ac_busy_delay += info->ac_busy_delay / 10 + 1;
-	LOG_DEBUG("dtmcs_idle=%d, dmi_busy_delay=%d, ac_busy_delay=%d",
-			info->dtmcs_idle, info->dmi_busy_delay,
-			info->ac_busy_delay);
-}
-
 static uint32_t __attribute__((unused)) abstract_register_size(unsigned width)
 {
 	switch (width) {
@@ -799,11 +862,14 @@ static int execute_abstract_command(struct target *target, uint32_t command)
 	info->cmderr = get_field(abstractcs, DM_ABSTRACTCS_CMDERR);
 	if (info->cmderr != 0 || result != ERROR_OK) {
 		LOG_DEBUG("command 0x%x failed; abstractcs=0x%x", command, abstractcs);
+		if (info->cmderr == CMDERR_BUSY)
+			increase_delay(info, DELAY_ABSTRACT);
 		/* Clear the error. */
 		dmi_write(target, DM_ABSTRACTCS, DM_ABSTRACTCS_CMDERR);
 		return ERROR_FAIL;
 	}
 
+	delay_success(info, DELAY_ABSTRACT, 1);
 	return ERROR_OK;
 }
 
@@ -964,6 +1030,57 @@ static int register_write_abstract(struct target *target, uint32_t number,
 	return ERROR_OK;
 }
 
+/*
+ * Write several GPRs with back-to-back abstract commands in a single batch.
+ * Any failure is left to the caller, which writes the registers one by one.
+ */
+static int riscv013_write_registers(struct target *target, unsigned int count,
+		const enum gdb_regno *regids, const riscv_reg_t *values)
+{
+	RISCV013_INFO(info);
+
+	if (riscv013_select_current_hart(target) != ERROR_OK)
+		return ERROR_FAIL;
+
+	unsigned int xlen = riscv_xlen(target);
+	struct riscv_batch *batch = riscv_batch_alloc(target,
+			count * (xlen > 32 ? 3 : 2),
+			delay(info, DELAY_DMI) + delay(info, DELAY_ABSTRACT));
+	if (!batch)
+		return ERROR_FAIL;
+
+	for (unsigned int i = 0; i < count; i++) {
+		if (xlen > 32)
+			riscv_batch_add_dmi_write(batch, DM_DATA1, values[i] >> 32);
+		riscv_batch_add_dmi_write(batch, DM_DATA0, values[i]);
+		riscv_batch_add_dmi_write(batch, DM_COMMAND,
+				access_register_command(target, regids[i], xlen,
+					AC_ACCESS_REGISTER_TRANSFER | AC_ACCESS_REGISTER_WRITE));
+	}
+
+	int result = batch_run(target, batch);
+	riscv_batch_free(batch);
+	if (result != ERROR_OK)
+		return result;
+
+	/* The DMI status of the scans above is not checked, but a command that
+	 * was dropped or rejected leaves an error in cmderr. */
+	uint32_t abstractcs = 0;
+	result = wait_for_idle(target, &abstractcs);
+	info->cmderr = get_field(abstractcs, DM_ABSTRACTCS_CMDERR);
+	if (info->cmderr != CMDERR_NONE || result != ERROR_OK) {
+		LOG_DEBUG("writing %u registers failed; abstractcs=0x%x", count,
+				abstractcs);
+		if (info->cmderr == CMDERR_BUSY)
+			increase_delay(info, DELAY_ABSTRACT);
+		dmi_write(target, DM_ABSTRACTCS, DM_ABSTRACTCS_CMDERR);
+		return ERROR_FAIL;
+	}
+
+	delay_success(info, DELAY_ABSTRACT, count);
+	return ERROR_OK;
+}
+
 /*
  * Sets the AAMSIZE field of a memory access abstract command based on
  * the width (bits).
@@ -1374,7 +1491,9 @@ static int register_write_direct(struct target *target, unsigned number,
 	/* Don't message on error. Probably the register doesn't exist. */
 	if (exec_out == ERROR_OK && target->reg_cache) {
 		struct reg *reg = &target->reg_cache->reg_list[number];
-		buf_set_u64(reg->value, 0, reg->size, value);
+		/* CSR entries that were never used have no value buffer yet. */
+		if (reg->value)
+			buf_set_u64(reg->value, 0, reg->size, value);
 	}
 
 	if (use_scratch)
@@ -1402,7 +1521,8 @@ static int register_read(struct target *target, uint64_t *value, uint32_t number
 		return ERROR_FAIL;
 	if (target->reg_cache) {
 		struct reg *reg = &target->reg_cache->reg_list[number];
-		buf_set_u64(reg->value, 0, reg->size, *value);
+		if (reg->value)
+			buf_set_u64(reg->value, 0, reg->size, *value);
 	}
 	return ERROR_OK;
 }
@@ -1410,6 +1530,10 @@ static int register_read(struct target *target, uint64_t *value, uint32_t number
 /** Actually read registers from the target right now. */
 static int register_read_direct(struct target *target, uint64_t *value, uint32_t number)
 {
+	/* The hart must see any GPR values that are still only cached. */
+	if (number <= GDB_REGNO_XPR31 && riscv_flush_registers(target) != ERROR_OK)
+		return ERROR_FAIL;
+
 	int result = register_read_abstract(target, value, number,
 			register_size(target, number));
 
@@ -1594,6 +1718,7 @@ static int examine(struct target *target)
 		dmi_write(target, DM_DMCONTROL, 0);
 		dmi_write(target, DM_DMCONTROL, DM_DMCONTROL_DMACTIVE);
 		dm->was_reset = true;
+		dm->hawindow_valid = false;
 	}
 
 	dmi_write(target, DM_DMCONTROL, DM_DMCONTROL_HARTSELLO |
@@ -1903,6 +2028,18 @@ static COMMAND_HELPER(riscv013_print_info, struct target *target)
 	return 0;
 }
 
+static COMMAND_HELPER(riscv013_print_delays, struct target *target)
+{
+	RISCV013_INFO(info);
+
+	command_print(CMD, "%-9s %8s %8s %8s", "access", "delay", "max", "busy");
+	for (unsigned int i = 0; i < DELAY_COUNT; i++)
+		command_print(CMD, "%-9s %8u %8u %8u", riscv013_delay_name[i],
+				info->delay[i].value, info->delay[i].max, info->delay[i].busy);
+
+	return 0;
+}
+
 static int prep_for_vector_access(struct target *target, uint64_t *vtype,
 		uint64_t *vl, unsigned *debug_vl)
 {
@@ -2097,8 +2234,7 @@ static int batch_run(const struct target *target, struct riscv_batch *batch)
 		r->reset_delays_wait -= batch->used_scans;
 		if (r->reset_delays_wait <= 0) {
 			batch->idle_count = 0;
-			info->dmi_busy_delay = 0;
-			info->ac_busy_delay = 0;
+			reset_delays(info);
 		}
 	}
 	return riscv_batch_run(batch);
@@ -2157,84 +2293,92 @@ static int sample_memory_bus_v1(struct target *target,
 			enabled_count++;
 	}
 
-	while (timeval_ms() < until_ms) {
-		/*
-		 * batch_run() adds to the batch, so we can't simply reuse the same
-		 * batch over and over. So we create a new one every time through the
-		 * loop.
-		 */
-		struct riscv_batch *batch = riscv_batch_alloc(
-			target, 1 + enabled_count * 5 * repeat,
-			info->dmi_busy_delay + info->bus_master_read_delay);
-		if (!batch)
-			return ERROR_FAIL;
-
-		unsigned int result_bytes = 0;
-		for (unsigned int n = 0; n < repeat; n++) {
-			for (unsigned int i = 0; i < ARRAY_SIZE(config->bucket); i++) {
-				if (config->bucket[i].enabled) {
-					if (!sba_supports_access(target, config->bucket[i].size_bytes)) {
-						LOG_ERROR("Hardware does not support SBA access for %d-byte memory sampling.",
-								config->bucket[i].size_bytes);
-						return ERROR_NOT_IMPLEMENTED;
-					}
+	/*
+	 * The batch is built once and then run over and over. Only the first
+	 * batch, built before sbcs and sbaddress are known, has to set them up;
+	 * every later round starts from the state the previous one left behind.
+	 */
+	struct riscv_batch *batch = NULL;
+	bool replay = false;
+	unsigned int result_bytes = 0;
+	size_t sbcs_key = 0;
+	int result = ERROR_OK;
 
-					uint32_t sbcs_write = DM_SBCS_SBREADONADDR;
-					if (enabled_count == 1)
-						sbcs_write |= DM_SBCS_SBREADONDATA;
-					sbcs_write |= sb_sbaccess(config->bucket[i].size_bytes);
-					if (!sbcs_valid || sbcs_write != sbcs) {
-						riscv_batch_add_dmi_write(batch, DM_SBCS, sbcs_write);
-						sbcs = sbcs_write;
-						sbcs_valid = true;
-					}
+	while (timeval_ms() < until_ms) {
+		if (!batch) {
+			replay = sbcs_valid;
+			batch = riscv_batch_alloc(target, 1 + enabled_count * 5 * repeat,
+					delay(info, DELAY_DMI) + delay(info, DELAY_SBA_READ));
+			if (!batch)
+				return ERROR_FAIL;
 
-					if (sbasize > 32 &&
-							(!sbaddress1_valid ||
-							sbaddress1 != config->bucket[i].address >> 32)) {
-						sbaddress1 = config->bucket[i].address >> 32;
-						riscv_batch_add_dmi_write(batch, DM_SBADDRESS1, sbaddress1);
-						sbaddress1_valid = true;
+			result_bytes = 0;
+			for (unsigned int n = 0; n < repeat; n++) {
+				for (unsigned int i = 0; i < ARRAY_SIZE(config->bucket); i++) {
+					if (config->bucket[i].enabled) {
+						if (!sba_supports_access(target, config->bucket[i].size_bytes)) {
+							LOG_ERROR("Hardware does not support SBA access for %d-byte memory sampling.",
+									config->bucket[i].size_bytes);
+							riscv_batch_free(batch);
+							return ERROR_NOT_IMPLEMENTED;
+						}
+
+						uint32_t sbcs_write = DM_SBCS_SBREADONADDR;
+						if (enabled_count == 1)
+							sbcs_write |= DM_SBCS_SBREADONDATA;
+						sbcs_write |= sb_sbaccess(config->bucket[i].size_bytes);
+						if (!sbcs_valid || sbcs_write != sbcs) {
+							riscv_batch_add_dmi_write(batch, DM_SBCS, sbcs_write);
+							sbcs = sbcs_write;
+							sbcs_valid = true;
+						}
+
+						if (sbasize > 32 &&
+								(!sbaddress1_valid ||
+								sbaddress1 != config->bucket[i].address >> 32)) {
+							sbaddress1 = config->bucket[i].address >> 32;
+							riscv_batch_add_dmi_write(batch, DM_SBADDRESS1, sbaddress1);
+							sbaddress1_valid = true;
+						}
+						if (!sbaddress0_valid ||
+								sbaddress0 != (config->bucket[i].address & 0xffffffff)) {
+							sbaddress0 = config->bucket[i].address;
+							riscv_batch_add_dmi_write(batch, DM_SBADDRESS0, sbaddress0);
+							sbaddress0_valid = true;
+						}
+						if (config->bucket[i].size_bytes > 4)
+							riscv_batch_add_dmi_read(batch, DM_SBDATA1);
+						riscv_batch_add_dmi_read(batch, DM_SBDATA0);
+						result_bytes += 1 + config->bucket[i].size_bytes;
 					}
-					if (!sbaddress0_valid ||
-							sbaddress0 != (config->bucket[i].address & 0xffffffff)) {
-						sbaddress0 = config->bucket[i].address;
-						riscv_batch_add_dmi_write(batch, DM_SBADDRESS0, sbaddress0);
-						sbaddress0_valid = true;
-					}
-					if (config->bucket[i].size_bytes > 4)
-						riscv_batch_add_dmi_read(batch, DM_SBDATA1);
-					riscv_batch_add_dmi_read(batch, DM_SBDATA0);
-					result_bytes += 1 + config->bucket[i].size_bytes;
 				}
 			}
-		}
 
-		if (buf->used + result_bytes >= buf->size) {
-			riscv_batch_free(batch);
-			break;
+			sbcs_key = riscv_batch_add_dmi_read(batch, DM_SBCS);
 		}
 
-		size_t sbcs_key = riscv_batch_add_dmi_read(batch, DM_SBCS);
+		if (buf->used + result_bytes >= buf->size)
+			break;
 
-		int result = batch_run(target, batch);
+		result = batch_run(target, batch);
 		if (result != ERROR_OK)
-			return result;
+			break;
 
 		uint32_t sbcs_read = riscv_batch_get_dmi_read_data(batch, sbcs_key);
 		if (get_field(sbcs_read, DM_SBCS_SBBUSYERROR)) {
 			/* Discard this batch (too much hassle to try to recover partial
 			 * data) and try again with a larger delay. */
-			info->bus_master_read_delay += info->bus_master_read_delay / 10 + 1;
+			increase_delay(info, DELAY_SBA_READ);
 			dmi_write(target, DM_SBCS, sbcs_read | DM_SBCS_SBBUSYERROR | DM_SBCS_SBERROR);
 			riscv_batch_free(batch);
+			batch = NULL;
 			continue;
 		}
 		if (get_field(sbcs_read, DM_SBCS_SBERROR)) {
 			/* The memory we're sampling was unreadable, somehow. Give up. */
 			dmi_write(target, DM_SBCS, DM_SBCS_SBBUSYERROR | DM_SBCS_SBERROR);
-			riscv_batch_free(batch);
-			return ERROR_FAIL;
+			result = ERROR_FAIL;
+			break;
 		}
 
 		unsigned int read = 0;
@@ -2254,10 +2398,15 @@ static int sample_memory_bus_v1(struct target *target,
 			}
 		}
 
-		riscv_batch_free(batch);
+		if (!replay) {
+			riscv_batch_free(batch);
+			batch = NULL;
+		}
 	}
 
-	return ERROR_OK;
+	if (batch)
+		riscv_batch_free(batch);
+	return result;
 }
 
 static int sample_memory(struct target *target,
@@ -2279,10 +2428,12 @@ static int init_target(struct command_context *cmd_ctx,
 
 	generic_info->get_register = &riscv013_get_register;
 	generic_info->set_register = &riscv013_set_register;
+	generic_info->write_registers = &riscv013_write_registers;
 	generic_info->get_register_buf = &riscv013_get_register_buf;
 	generic_info->set_register_buf = &riscv013_set_register_buf;
 	generic_info->select_current_hart = &riscv013_select_current_hart;
 	generic_info->is_halted = &riscv013_is_halted;
+	generic_info->halt_summary = &riscv013_halt_summary;
 	generic_info->resume_go = &riscv013_resume_go;
 	generic_info->step_current_hart = &riscv013_step_current_hart;
 	generic_info->on_halt = &riscv013_on_halt;
@@ -2306,6 +2457,8 @@ static int init_target(struct command_context *cmd_ctx,
 	generic_info->hart_count = &riscv013_hart_count;
 	generic_info->data_bits = &riscv013_data_bits;
 	generic_info->print_info = &riscv013_print_info;
+	generic_info->print_delays = &riscv013_print_delays;
+	generic_info->benchmark = &riscv013_benchmark;
 	if (!generic_info->version_specific) {
 		generic_info->version_specific = calloc(1, sizeof(riscv013_info_t));
 		if (!generic_info->version_specific)
@@ -2316,10 +2469,7 @@ static int init_target(struct command_context *cmd_ctx,
 
 	info->progbufsize = -1;
 
-	info->dmi_busy_delay = 0;
-	info->bus_master_read_delay = 0;
-	info->bus_master_write_delay = 0;
-	info->ac_busy_delay = 0;
+	memset(info->delay, 0, sizeof(info->delay));
 
 	/* Assume all these abstract commands are supported until we learn
 	 * otherwise.
@@ -2400,7 +2550,7 @@ static int deassert_reset(struct target *target)
 			set_hartsel(control_haltreq, r->current_hartid));
 
 	uint32_t dmstatus;
-	int dmi_busy_delay = info->dmi_busy_delay;
+	unsigned int dmi_busy_delay = delay(info, DELAY_DMI);
 	time_t start = time(NULL);
 
 	for (int i = 0; i < riscv_count_harts(target); ++i) {
@@ -2454,7 +2604,7 @@ static int deassert_reset(struct target *target)
 		if (!target->rtos)
 			break;
 	}
-	info->dmi_busy_delay = dmi_busy_delay;
+	info->delay[DELAY_DMI].value = dmi_busy_delay;
 	return ERROR_OK;
 }
 
@@ -2683,126 +2833,142 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 	}
 
 	RISCV013_INFO(info);
-	target_addr_t next_address = address;
-	target_addr_t end_address = address + count * size;
+	static const unsigned int sbdata[4] = {DM_SBDATA0, DM_SBDATA1, DM_SBDATA2, DM_SBDATA3};
+	assert(size <= 16);
+	const unsigned int words = DIV_ROUND_UP(size, 4);
+	/* Index of the next element to read. */
+	uint32_t next = 0;
 
-	while (next_address < end_address) {
+	while (next < count) {
+		const uint32_t first = next;
 		uint32_t sbcs_write = set_field(0, DM_SBCS_SBREADONADDR, 1);
 		sbcs_write |= sb_sbaccess(size);
 		if (increment == size)
 			sbcs_write = set_field(sbcs_write, DM_SBCS_SBAUTOINCREMENT, 1);
-		if (count > 1)
-			sbcs_write = set_field(sbcs_write, DM_SBCS_SBREADONDATA, count > 1);
+		if (count - next > 1)
+			sbcs_write = set_field(sbcs_write, DM_SBCS_SBREADONDATA, 1);
 		if (dmi_write(target, DM_SBCS, sbcs_write) != ERROR_OK)
 			return ERROR_FAIL;
 
 		/* This address write will trigger the first read. */
-		if (sb_write_address(target, next_address, true) != ERROR_OK)
+		if (sb_write_address(target, address + next * increment, true) != ERROR_OK)
 			return ERROR_FAIL;
 
-		if (info->bus_master_read_delay) {
-			jtag_add_runtest(info->bus_master_read_delay, TAP_IDLE);
+		if (delay(info, DELAY_SBA_READ)) {
+			jtag_add_runtest(delay(info, DELAY_SBA_READ), TAP_IDLE);
 			if (jtag_execute_queue() != ERROR_OK) {
 				LOG_ERROR("Failed to scan idle sequence");
 				return ERROR_FAIL;
 			}
 		}
 
-		/* First value has been read, and is waiting for us to issue a DMI read
-		 * to get it. */
-
-		static int sbdata[4] = {DM_SBDATA0, DM_SBDATA1, DM_SBDATA2, DM_SBDATA3};
-		assert(size <= 16);
-		target_addr_t next_read = address - 1;
-		for (uint32_t i = (next_address - address) / size; i < count - 1; i++) {
-			for (int j = (size - 1) / 4; j >= 0; j--) {
-				uint32_t value;
-				unsigned attempt = 0;
-				while (1) {
-					if (attempt++ > 100) {
-						LOG_ERROR("DMI keeps being busy in while reading memory just past " TARGET_ADDR_FMT,
-								  next_read);
-						return ERROR_FAIL;
-					}
-					keep_alive();
-					dmi_status_t status = dmi_scan(target, NULL, &value,
-												   DMI_OP_READ, sbdata[j], 0, false);
-					if (status == DMI_STATUS_BUSY)
-						increase_dmi_busy_delay(target);
-					else if (status == DMI_STATUS_SUCCESS)
+		/* Stream all but the last element in full batches: reading sbdata0
+		 * returns one element and starts the bus read of the next one. sbcs
+		 * is only checked once the whole stream is done, and a failure rolls
+		 * back to the last element known to be good. */
+		bool dmi_busy = false;
+		while (next < count - 1 && !dmi_busy) {
+			struct riscv_batch *batch = riscv_batch_alloc(target, riscv_batch_block_scans(),
+					delay(info, DELAY_DMI) + delay(info, DELAY_SBA_READ));
+			if (!batch)
+				return ERROR_FAIL;
+
+			uint32_t batch_count = 0;
+			while (next + batch_count < count - 1 &&
+					riscv_batch_available_scans(batch) >= words) {
+				for (int j = words - 1; j >= 0; j--)
+					riscv_batch_add_dmi_read(batch, sbdata[j]);
+				batch_count++;
+			}
+
+			int result = batch_run(target, batch);
+			if (result != ERROR_OK) {
+				riscv_batch_free(batch);
+				return result;
+			}
+
+			/* Once DMI reports busy, the following reads were all ignored. */
+			uint32_t done;
+			for (done = 0; done < batch_count && !dmi_busy; done++) {
+				target_addr_t element = address + (next + done) * increment;
+				uint8_t *p = buffer + (next + done) * size;
+				for (int j = words - 1; j >= 0; j--) {
+					size_t key = done * words + words - 1 - j;
+					dmi_status_t status = riscv_batch_get_dmi_read_op(batch, key);
+					if (status == DMI_STATUS_BUSY) {
+						dmi_busy = true;
 						break;
-					else
+					}
+					if (status != DMI_STATUS_SUCCESS) {
+						LOG_ERROR("failed read of sbdata%d at 0x%" TARGET_PRIxADDR ", status=%d",
+								j, element, status);
+						riscv_batch_free(batch);
+						dtmcontrol_scan(target, DTM_DTMCS_DMIRESET);
 						return ERROR_FAIL;
+					}
+					uint32_t value = riscv_batch_get_dmi_read_data(batch, key);
+					buf_set_u32(p + 4 * j, 0, 8 * MIN(size, 4), value);
+					log_memory_access(element + 4 * j, value, MIN(size, 4), true);
 				}
-				if (next_read != address - 1) {
-					buf_set_u32(buffer + next_read - address, 0, 8 * MIN(size, 4), value);
-					log_memory_access(next_read, value, MIN(size, 4), true);
-				}
-				next_read = address + i * size + j * 4;
 			}
-		}
+			if (dmi_busy)
+				done--;
+			riscv_batch_free(batch);
 
-		uint32_t sbcs_read = 0;
-		if (count > 1) {
-			uint32_t value;
-			unsigned attempt = 0;
-			while (1) {
-				if (attempt++ > 100) {
-					LOG_ERROR("DMI keeps being busy in while reading memory just past " TARGET_ADDR_FMT,
-								next_read);
-					return ERROR_FAIL;
-				}
-				dmi_status_t status = dmi_scan(target, NULL, &value, DMI_OP_NOP, 0, 0, false);
-				if (status == DMI_STATUS_BUSY)
-					increase_dmi_busy_delay(target);
-				else if (status == DMI_STATUS_SUCCESS)
-					break;
-				else
-					return ERROR_FAIL;
-			}
-			buf_set_u32(buffer + next_read - address, 0, 8 * MIN(size, 4), value);
-			log_memory_access(next_read, value, MIN(size, 4), true);
+			next += done;
+			if (dmi_busy)
+				increase_dmi_busy_delay(target);
+			else
+				delay_success(info, DELAY_DMI, done * words);
+		}
 
-			/* "Writes to sbcs while sbbusy is high result in undefined behavior.
-			 * A debugger must not write to sbcs until it reads sbbusy as 0." */
-			if (read_sbcs_nonbusy(target, &sbcs_read) != ERROR_OK)
-				return ERROR_FAIL;
+		/* "Writes to sbcs while sbbusy is high result in undefined behavior.
+		 * A debugger must not write to sbcs until it reads sbbusy as 0." */
+		uint32_t sbcs_read;
+		if (read_sbcs_nonbusy(target, &sbcs_read) != ERROR_OK)
+			return ERROR_FAIL;
 
+		if (get_field(sbcs_write, DM_SBCS_SBREADONDATA)) {
 			sbcs_write = set_field(sbcs_write, DM_SBCS_SBREADONDATA, 0);
 			if (dmi_write(target, DM_SBCS, sbcs_write) != ERROR_OK)
 				return ERROR_FAIL;
 		}
 
-		/* Read the last word, after we disabled sbreadondata if necessary. */
-		if (!get_field(sbcs_read, DM_SBCS_SBERROR) &&
-				!get_field(sbcs_read, DM_SBCS_SBBUSYERROR)) {
-			if (read_memory_bus_word(target, address + (count - 1) * size, size,
-						buffer + (count - 1) * size) != ERROR_OK)
-				return ERROR_FAIL;
-
-			if (read_sbcs_nonbusy(target, &sbcs_read) != ERROR_OK)
-				return ERROR_FAIL;
-		}
-
 		if (get_field(sbcs_read, DM_SBCS_SBBUSYERROR)) {
-			/* We read while the target was busy. Slow down and try again. */
+			/* We read while the target was busy. Slow down, and resume from
+			 * the first read that was dropped. */
 			if (dmi_write(target, DM_SBCS, sbcs_read | DM_SBCS_SBBUSYERROR) != ERROR_OK)
 				return ERROR_FAIL;
-			next_address = sb_read_address(target);
-			info->bus_master_read_delay += info->bus_master_read_delay / 10 + 1;
+			uint32_t dropped = first;
+			if (increment) {
+				target_addr_t sbaddress = sb_read_address(target);
+				if (sbaddress > address)
+					dropped = MAX((sbaddress - address) / size, first);
+			}
+			next = MIN(next, dropped);
+			increase_delay(info, DELAY_SBA_READ);
 			continue;
 		}
 
-		unsigned error = get_field(sbcs_read, DM_SBCS_SBERROR);
-		if (error == 0) {
-			next_address = end_address;
-		} else {
+		if (get_field(sbcs_read, DM_SBCS_SBERROR)) {
 			/* Some error indicating the bus access failed, but not because of
 			 * something we did wrong. */
-			if (dmi_write(target, DM_SBCS, DM_SBCS_SBERROR) != ERROR_OK)
-				return ERROR_FAIL;
+			dmi_write(target, DM_SBCS, DM_SBCS_SBERROR);
 			return ERROR_FAIL;
 		}
+
+		delay_success(info, DELAY_SBA_READ, next - first);
+
+		/* Restart the stream where DMI got busy. */
+		if (dmi_busy)
+			continue;
+
+		/* The last element was already read from the bus, fetch it now that
+		 * sbreadondata is disabled so that no read past the end is done. */
+		if (read_memory_bus_word(target, address + next * increment, size,
+					buffer + next * size) != ERROR_OK)
+			return ERROR_FAIL;
+		next++;
 	}
 
 	return ERROR_OK;
@@ -3157,8 +3323,8 @@ static int read_memory_progbuf_inner(struct target *target, target_addr_t addres
 		 * dm_data0 contains[read_addr-size*2]
 		 */
 
-		struct riscv_batch *batch = riscv_batch_alloc(target, 32,
-				info->dmi_busy_delay + info->ac_busy_delay);
+		struct riscv_batch *batch = riscv_batch_alloc(target, riscv_batch_block_scans(),
+				delay(info, DELAY_DMI) + delay(info, DELAY_PROGBUF));
 		if (!batch)
 			return ERROR_FAIL;
 
@@ -3191,12 +3357,13 @@ static int read_memory_progbuf_inner(struct target *target, target_addr_t addres
 		switch (info->cmderr) {
 			case CMDERR_NONE:
 				LOG_DEBUG("successful (partial?) memory read");
+				delay_success(info, DELAY_PROGBUF, reads);
 				next_index = index + reads;
 				break;
 			case CMDERR_BUSY:
 				LOG_DEBUG("memory read resulted in busy response");
 
-				increase_ac_busy_delay(target);
+				increase_delay(info, DELAY_PROGBUF);
 				riscv013_clear_abstract_error(target);
 
 				dmi_write(target, DM_ABSTRACTAUTO, 0);
@@ -3336,6 +3503,180 @@ error:
 	return result;
 }
 
+/* Most elements moved by one execution of an unrolled program. */
+#define PROGBUF_UNROLL_MAX		8
+
+/* Number of elements the unrolled programs can move per program buffer
+ * execution, or 0 if the hart can't access the data registers or the
+ * program buffer is too small for it to be worth it. */
+static unsigned int progbuf_unroll_count(struct target *target, uint32_t size,
+		bool mprv, int *data_address)
+{
+	RISCV013_INFO(info);
+	RISCV_INFO(r);
+
+	if (info->dataaccess != 1 || size > 4)
+		return 0;
+
+	/* Sign extend dataaddr, the data registers are addressed relative to
+	 * x0. */
+	*data_address = info->dataaddr;
+	if (info->dataaddr & (1 << 11))
+		*data_address -= 1 << 12;
+
+	/* Two instructions per element, plus the addi and the ebreak, and two
+	 * more to toggle MPRVEN. */
+	unsigned int overhead = 2 + (mprv ? 2 : 0);
+	if (info->progbufsize + r->impebreak < overhead + 4)
+		return 0;
+	unsigned int count = (info->progbufsize + r->impebreak - overhead) / 2;
+	count = MIN(count, MIN(info->datacount, info->datasize));
+	count = MIN(count, PROGBUF_UNROLL_MAX);
+	/* The last data register must be reachable with a 12-bit offset. */
+	while (count && *data_address + 4 * (int)(count - 1) > 2047)
+		count--;
+
+	return count >= 2 ? count : 0;
+}
+
+/* Read @a blocks blocks of @a unroll consecutive elements. Each program
+ * buffer execution copies a block into data0..N-1, and reading data0 starts
+ * the next one. */
+static int read_memory_progbuf_unrolled(struct target *target, target_addr_t address,
+		uint32_t size, uint32_t blocks, unsigned int unroll, bool mprv,
+		int data_address, uint8_t *buffer)
+{
+	RISCV013_INFO(info);
+
+	struct riscv_program program;
+	riscv_program_init(&program, target);
+	if (mprv)
+		riscv_program_csrrsi(&program, GDB_REGNO_ZERO, CSR_DCSR_MPRVEN, GDB_REGNO_DCSR);
+	if (riscv_program_copy_mem_to_data(&program, GDB_REGNO_S0, GDB_REGNO_S1,
+				data_address, size, unroll) != ERROR_OK)
+		return ERROR_FAIL;
+	if (mprv)
+		riscv_program_csrrci(&program, GDB_REGNO_ZERO, CSR_DCSR_MPRVEN, GDB_REGNO_DCSR);
+	if (riscv_program_ebreak(&program) != ERROR_OK)
+		return ERROR_FAIL;
+	if (riscv_program_write(&program) != ERROR_OK)
+		return ERROR_FAIL;
+
+	uint32_t command = access_register_command(target, GDB_REGNO_S0,
+			riscv_xlen(target), AC_ACCESS_REGISTER_POSTEXEC);
+	int result = ERROR_OK;
+	uint32_t block = 0;
+	while (block < blocks) {
+		/* (Re)start the pipeline at this block. */
+		result = register_write_direct(target, GDB_REGNO_S0,
+				address + block * unroll * size);
+		if (result != ERROR_OK)
+			goto error;
+		result = execute_abstract_command(target, command);
+		if (result != ERROR_OK)
+			goto error;
+		if (blocks - block > 1) {
+			result = dmi_write(target, DM_ABSTRACTAUTO,
+					1 << DM_ABSTRACTAUTO_AUTOEXECDATA_OFFSET);
+			if (result != ERROR_OK)
+				goto error;
+		}
+
+		bool restart = false;
+		while (block < blocks && !restart) {
+			struct riscv_batch *batch = riscv_batch_alloc(target, riscv_batch_block_scans(),
+					delay(info, DELAY_DMI) + delay(info, DELAY_PROGBUF));
+			if (!batch) {
+				result = ERROR_FAIL;
+				goto error;
+			}
+
+			uint32_t batch_blocks = 0;
+			while (block + batch_blocks < blocks &&
+					riscv_batch_available_scans(batch) > unroll) {
+				/* Don't run the program past the end. */
+				if (block + batch_blocks == blocks - 1)
+					riscv_batch_add_dmi_write(batch, DM_ABSTRACTAUTO, 0);
+				/* data0 last, as reading it runs the next block. */
+				for (unsigned int j = 1; j < unroll; j++)
+					riscv_batch_add_dmi_read(batch, DM_DATA0 + j);
+				riscv_batch_add_dmi_read(batch, DM_DATA0);
+				batch_blocks++;
+			}
+
+			result = batch_run(target, batch);
+			if (result != ERROR_OK) {
+				riscv_batch_free(batch);
+				goto error;
+			}
+
+			uint32_t abstractcs;
+			result = dmi_read(target, &abstractcs, DM_ABSTRACTCS);
+			while (result == ERROR_OK && get_field(abstractcs, DM_ABSTRACTCS_BUSY))
+				result = dmi_read(target, &abstractcs, DM_ABSTRACTCS);
+			if (result != ERROR_OK) {
+				riscv_batch_free(batch);
+				goto error;
+			}
+			info->cmderr = get_field(abstractcs, DM_ABSTRACTCS_CMDERR);
+
+			bool dmi_busy = false;
+			for (size_t key = 0; key < batch_blocks * unroll; key++) {
+				dmi_status_t status = riscv_batch_get_dmi_read_op(batch, key);
+				if (status == DMI_STATUS_BUSY) {
+					dmi_busy = true;
+				} else if (status != DMI_STATUS_SUCCESS) {
+					LOG_WARNING("Batch memory read encountered DMI error %d.", status);
+					riscv_batch_free(batch);
+					result = ERROR_FAIL;
+					goto error;
+				}
+			}
+
+			if (info->cmderr == CMDERR_BUSY || dmi_busy) {
+				/* Too fast, slow down and redo this batch. */
+				LOG_DEBUG("unrolled memory read resulted in busy response");
+				if (dmi_busy)
+					increase_dmi_busy_delay(target);
+				else
+					increase_delay(info, DELAY_PROGBUF);
+				riscv013_clear_abstract_error(target);
+				dmi_write(target, DM_ABSTRACTAUTO, 0);
+				riscv_batch_free(batch);
+				restart = true;
+				break;
+			}
+			if (info->cmderr != CMDERR_NONE) {
+				LOG_DEBUG("error when reading memory, abstractcs=0x%08lx", (long)abstractcs);
+				riscv013_clear_abstract_error(target);
+				riscv_batch_free(batch);
+				result = ERROR_FAIL;
+				goto error;
+			}
+
+			for (uint32_t b = 0; b < batch_blocks; b++) {
+				for (unsigned int j = 0; j < unroll; j++) {
+					size_t key = b * unroll + (j ? j - 1 : unroll - 1);
+					uint32_t value = riscv_batch_get_dmi_read_data(batch, key);
+					uint32_t element = (block + b) * unroll + j;
+					buf_set_u32(buffer + element * size, 0, 8 * size, value);
+					log_memory_access(address + element * size, value, size, true);
+				}
+			}
+			riscv_batch_free(batch);
+
+			delay_success(info, DELAY_PROGBUF, batch_blocks);
+			block += batch_blocks;
+		}
+	}
+
+	return ERROR_OK;
+
+error:
+	dmi_write(target, DM_ABSTRACTAUTO, 0);
+	return result;
+}
+
 /* Only need to save/restore one GPR to read a single word, and the progbuf
  * program doesn't need to increment. */
 static int read_memory_progbuf_one(struct target *target, target_addr_t address,
@@ -3454,6 +3795,24 @@ static int read_memory_progbuf(struct target *target, target_addr_t address,
 	if (increment == 0 && register_read(target, &s2, GDB_REGNO_S2) != ERROR_OK)
 		return ERROR_FAIL;
 
+	/* Move whole blocks with an unrolled program if the hart can access the
+	 * data registers, the rest one element at a time. */
+	bool mprv = riscv_enable_virtual && has_sufficient_progbuf(target, 5) &&
+		get_field(mstatus, MSTATUS_MPRV);
+	int data_address;
+	unsigned int unroll = progbuf_unroll_count(target, size, mprv, &data_address);
+	if (unroll && increment == size && count >= 2 * unroll) {
+		uint32_t blocks = count / unroll;
+		if (read_memory_progbuf_unrolled(target, address, size, blocks, unroll,
+					mprv, data_address, buffer) == ERROR_OK) {
+			address += blocks * unroll * size;
+			buffer += blocks * unroll * size;
+			count -= blocks * unroll;
+		}
+	}
+	if (count == 0)
+		goto restore;
+
 	/* Write the program (load, increment) */
 	struct riscv_program program;
 	riscv_program_init(&program, target);
@@ -3516,6 +3875,7 @@ static int read_memory_progbuf(struct target *target, target_addr_t address,
 		result = ERROR_OK;
 	}
 
+restore:
 	riscv_set_register(target, GDB_REGNO_S0, s0);
 	riscv_set_register(target, GDB_REGNO_S1, s1);
 	if (increment == 0)
@@ -3593,6 +3953,164 @@ static int read_memory(struct target *target, target_addr_t address,
 	return ret;
 }
 
+#define BENCHMARK_ROUNDS		32
+#define BENCHMARK_DMI_SCANS		64
+#define BENCHMARK_REGISTERS		16
+#define BENCHMARK_MAX_BLOCK		(1024 * 1024)
+
+static int benchmark_cmp_us(const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *)a;
+	int64_t y = *(const int64_t *)b;
+	return (x > y) - (x < y);
+}
+
+/* Print one result of "riscv benchmark" as a line of key=value pairs, so it
+ * is easy to parse from a script. */
+static void benchmark_report(struct command_invocation *cmd, const char *test,
+		unsigned int bytes, unsigned int ops_per_round, int64_t *round_us,
+		unsigned int rounds)
+{
+	qsort(round_us, rounds, sizeof(*round_us), benchmark_cmp_us);
+
+	int64_t total_us = 0;
+	for (unsigned int i = 0; i < rounds; i++)
+		total_us += round_us[i];
+	uint64_t ops = (uint64_t)ops_per_round * rounds;
+	uint64_t ops_per_s = total_us ? ops * 1000000 / total_us : 0;
+
+	command_print(cmd, "test=%s bytes=%u ops=%" PRIu64 " us=%" PRId64
+			" ops_per_s=%" PRIu64 " bytes_per_s=%" PRIu64
+			" p50_us=%" PRId64 " p90_us=%" PRId64 " p99_us=%" PRId64,
+			test, bytes, ops, total_us, ops_per_s, ops_per_s * bytes,
+			round_us[(rounds - 1) * 50 / 100],
+			round_us[(rounds - 1) * 90 / 100],
+			round_us[(rounds - 1) * 99 / 100]);
+}
+
+static int benchmark_dmi(struct command_invocation *cmd, struct target *target,
+		bool write)
+{
+	RISCV013_INFO(info);
+	int64_t round_us[BENCHMARK_ROUNDS];
+
+	for (unsigned int i = 0; i < BENCHMARK_ROUNDS; i++) {
+		struct riscv_batch *batch = riscv_batch_alloc(target,
+				BENCHMARK_DMI_SCANS, delay(info, DELAY_DMI));
+		if (!batch)
+			return ERROR_FAIL;
+		/* data0 is only used by abstract commands, and dmstatus has no
+		 * side effects when read. */
+		for (unsigned int j = 0; j < BENCHMARK_DMI_SCANS; j++) {
+			if (write)
+				riscv_batch_add_dmi_write(batch, DM_DATA0, j);
+			else
+				riscv_batch_add_dmi_read(batch, DM_DMSTATUS);
+		}
+		int64_t start = timeval_us();
+		int result = batch_run(target, batch);
+		round_us[i] = timeval_us() - start;
+		riscv_batch_free(batch);
+		if (result != ERROR_OK)
+			return result;
+	}
+
+	benchmark_report(cmd, write ? "dmi_write" : "dmi_read", 4,
+			BENCHMARK_DMI_SCANS, round_us, BENCHMARK_ROUNDS);
+	return ERROR_OK;
+}
+
+static int benchmark_abstract_register(struct command_invocation *cmd,
+		struct target *target)
+{
+	int64_t round_us[BENCHMARK_ROUNDS];
+	unsigned int xlen = riscv_xlen(target);
+
+	for (unsigned int i = 0; i < BENCHMARK_ROUNDS; i++) {
+		int64_t start = timeval_us();
+		for (unsigned int j = 0; j < BENCHMARK_REGISTERS; j++) {
+			uint64_t value;
+			if (register_read_abstract(target, &value, GDB_REGNO_S0, xlen) != ERROR_OK)
+				return ERROR_FAIL;
+		}
+		round_us[i] = timeval_us() - start;
+	}
+
+	benchmark_report(cmd, "abstract_reg", xlen / 8, BENCHMARK_REGISTERS,
+			round_us, BENCHMARK_ROUNDS);
+	return ERROR_OK;
+}
+
+static int benchmark_memory(struct command_invocation *cmd, struct target *target,
+		target_addr_t address, int method, uint8_t *buffer)
+{
+	RISCV013_INFO(info);
+	int64_t round_us[BENCHMARK_ROUNDS];
+	const char *test = method == RISCV_MEM_ACCESS_SYSBUS ? "sba_read" : "progbuf_read";
+	char *skip_reason = "";
+
+	bool skip = method == RISCV_MEM_ACCESS_SYSBUS ?
+		mem_should_skip_sysbus(target, address, 4, 4, true, &skip_reason) :
+		mem_should_skip_progbuf(target, address, 4, true, &skip_reason);
+	if (skip) {
+		command_print(cmd, "test=%s skipped=\"%s\"", test, skip_reason);
+		return ERROR_OK;
+	}
+
+	for (unsigned int bytes = 4; bytes <= BENCHMARK_MAX_BLOCK; bytes *= 4) {
+		unsigned int rounds = bytes >= 64 * 1024 ? 4 : BENCHMARK_ROUNDS;
+		for (unsigned int i = 0; i < rounds; i++) {
+			int64_t start = timeval_us();
+			int result;
+			if (method == RISCV_MEM_ACCESS_PROGBUF)
+				result = read_memory_progbuf(target, address, 4, bytes / 4, buffer, 4);
+			else if (get_field(info->sbcs, DM_SBCS_SBVERSION) == 0)
+				result = read_memory_bus_v0(target, address, 4, bytes / 4, buffer, 4);
+			else
+				result = read_memory_bus_v1(target, address, 4, bytes / 4, buffer, 4);
+			round_us[i] = timeval_us() - start;
+			if (result != ERROR_OK)
+				return result;
+		}
+		benchmark_report(cmd, test, bytes, 1, round_us, rounds);
+	}
+	return ERROR_OK;
+}
+
+/* Measure how fast the debug module can be accessed through this adapter.
+ * Memory is only read, starting at @a address, and only if @a memory. */
+static COMMAND_HELPER(riscv013_benchmark, struct target *target, bool memory,
+		target_addr_t address)
+{
+	if (benchmark_dmi(CMD, target, false) != ERROR_OK ||
+			benchmark_dmi(CMD, target, true) != ERROR_OK)
+		return ERROR_FAIL;
+
+	if (riscv013_select_current_hart(target) != ERROR_OK)
+		return ERROR_FAIL;
+	if (!riscv_is_halted(target)) {
+		command_print(CMD, "Hart is not halted, skipping register and memory tests.");
+		return ERROR_OK;
+	}
+
+	if (benchmark_abstract_register(CMD, target) != ERROR_OK)
+		return ERROR_FAIL;
+
+	if (!memory)
+		return ERROR_OK;
+
+	uint8_t *buffer = malloc(BENCHMARK_MAX_BLOCK);
+	if (!buffer) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	int result = benchmark_memory(CMD, target, address, RISCV_MEM_ACCESS_SYSBUS, buffer);
+	if (result == ERROR_OK)
+		result = benchmark_memory(CMD, target, address, RISCV_MEM_ACCESS_PROGBUF, buffer);
+	free(buffer);
+	return result;
+}
+
 static int write_memory_bus_v0(struct target *target, target_addr_t address,
 		uint32_t size, uint32_t count, const uint8_t *buffer)
 {
@@ -3663,11 +4181,12 @@ static int write_memory_bus_v1(struct target *target, target_addr_t address,
 	while (next_address < end_address) {
 		LOG_DEBUG("transferring burst starting at address 0x%" TARGET_PRIxADDR,
 				next_address);
+		target_addr_t batch_start = next_address;
 
 		struct riscv_batch *batch = riscv_batch_alloc(
 				target,
-				32,
-				info->dmi_busy_delay + info->bus_master_write_delay);
+				riscv_batch_block_scans(),
+				delay(info, DELAY_DMI) + delay(info, DELAY_SBA_WRITE));
 		if (!batch)
 			return ERROR_FAIL;
 
@@ -3743,7 +4262,10 @@ static int write_memory_bus_v1(struct target *target, target_addr_t address,
 			/* Clear the sticky error flag. */
 			dmi_write(target, DM_SBCS, sbcs | DM_SBCS_SBBUSYERROR);
 			/* Slow down before trying again. */
-			info->bus_master_write_delay += info->bus_master_write_delay / 10 + 1;
+			increase_delay(info, DELAY_SBA_WRITE);
+		} else if (!dmi_busy_encountered) {
+			delay_success(info, DELAY_SBA_WRITE, (next_address - batch_start) / size);
+			delay_success(info, DELAY_DMI, (next_address - batch_start) / size);
 		}
 
 		if (get_field(sbcs, DM_SBCS_SBBUSYERROR) || dmi_busy_encountered) {
@@ -3786,6 +4308,121 @@ static int write_memory_bus_v1(struct target *target, target_addr_t address,
 	return ERROR_OK;
 }
 
+/* Write @a blocks blocks of @a unroll consecutive elements. Writing
+ * data0..N-1 and then data0 runs the program that stores them. */
+static int write_memory_progbuf_unrolled(struct target *target, target_addr_t address,
+		uint32_t size, uint32_t blocks, unsigned int unroll, bool mprv,
+		int data_address, const uint8_t *buffer)
+{
+	RISCV013_INFO(info);
+
+	struct riscv_program program;
+	riscv_program_init(&program, target);
+	if (mprv)
+		riscv_program_csrrsi(&program, GDB_REGNO_ZERO, CSR_DCSR_MPRVEN, GDB_REGNO_DCSR);
+	if (riscv_program_copy_data_to_mem(&program, GDB_REGNO_S0, GDB_REGNO_S1,
+				data_address, size, unroll) != ERROR_OK)
+		return ERROR_FAIL;
+	if (mprv)
+		riscv_program_csrrci(&program, GDB_REGNO_ZERO, CSR_DCSR_MPRVEN, GDB_REGNO_DCSR);
+	if (riscv_program_ebreak(&program) != ERROR_OK)
+		return ERROR_FAIL;
+	if (riscv_program_write(&program) != ERROR_OK)
+		return ERROR_FAIL;
+
+	uint32_t command = access_register_command(target, GDB_REGNO_S0,
+			riscv_xlen(target), AC_ACCESS_REGISTER_POSTEXEC);
+	int result = ERROR_OK;
+	uint32_t block = 0;
+	while (block < blocks) {
+		/* (Re)start at this block: store it with an explicit command, the
+		 * following ones with autoexec. */
+		result = register_write_direct(target, GDB_REGNO_S0,
+				address + block * unroll * size);
+		if (result != ERROR_OK)
+			goto error;
+		for (unsigned int j = 0; j < unroll; j++) {
+			uint32_t element = block * unroll + j;
+			uint32_t value = buf_get_u32(buffer + element * size, 0, 8 * size);
+			log_memory_access(address + element * size, value, size, false);
+			result = dmi_write(target, DM_DATA0 + j, value);
+			if (result != ERROR_OK)
+				goto error;
+		}
+		result = execute_abstract_command(target, command);
+		if (result != ERROR_OK)
+			goto error;
+		block++;
+		if (block == blocks)
+			break;
+		result = dmi_write(target, DM_ABSTRACTAUTO,
+				1 << DM_ABSTRACTAUTO_AUTOEXECDATA_OFFSET);
+		if (result != ERROR_OK)
+			goto error;
+
+		bool restart = false;
+		while (block < blocks && !restart) {
+			struct riscv_batch *batch = riscv_batch_alloc(target, riscv_batch_block_scans(),
+					delay(info, DELAY_DMI) + delay(info, DELAY_PROGBUF));
+			if (!batch) {
+				result = ERROR_FAIL;
+				goto error;
+			}
+
+			uint32_t batch_blocks = 0;
+			while (block + batch_blocks < blocks &&
+					riscv_batch_available_scans(batch) >= unroll) {
+				/* data0 last, as writing it runs the program. */
+				for (unsigned int j = unroll; j-- > 0;) {
+					uint32_t element = (block + batch_blocks) * unroll + j;
+					uint32_t value = buf_get_u32(buffer + element * size, 0, 8 * size);
+					log_memory_access(address + element * size, value, size, false);
+					riscv_batch_add_dmi_write(batch, DM_DATA0 + j, value);
+				}
+				batch_blocks++;
+			}
+
+			result = batch_run(target, batch);
+			riscv_batch_free(batch);
+			if (result != ERROR_OK)
+				goto error;
+
+			/* If the scans resulted in a busy DMI response, it is this read
+			 * that notices it. */
+			uint32_t abstractcs;
+			bool dmi_busy_encountered;
+			result = dmi_op(target, &abstractcs, &dmi_busy_encountered,
+					DMI_OP_READ, DM_ABSTRACTCS, 0, false, true);
+			while (result == ERROR_OK && get_field(abstractcs, DM_ABSTRACTCS_BUSY))
+				result = dmi_read(target, &abstractcs, DM_ABSTRACTCS);
+			if (result != ERROR_OK)
+				goto error;
+			info->cmderr = get_field(abstractcs, DM_ABSTRACTCS_CMDERR);
+
+			if (info->cmderr == CMDERR_BUSY || dmi_busy_encountered) {
+				/* Too fast, slow down and redo this batch. */
+				LOG_DEBUG("unrolled memory write resulted in busy response");
+				riscv013_clear_abstract_error(target);
+				increase_delay(info, DELAY_PROGBUF);
+				dmi_write(target, DM_ABSTRACTAUTO, 0);
+				restart = true;
+			} else if (info->cmderr != CMDERR_NONE) {
+				LOG_ERROR("error when writing memory, abstractcs=0x%08lx", (long)abstractcs);
+				riscv013_clear_abstract_error(target);
+				result = ERROR_FAIL;
+				goto error;
+			} else {
+				delay_success(info, DELAY_PROGBUF, batch_blocks);
+				block += batch_blocks;
+			}
+		}
+	}
+
+error:
+	dmi_write(target, DM_ABSTRACTAUTO, 0);
+	return result;
+}
+
 static int write_memory_progbuf(struct target *target, target_addr_t address,
 		uint32_t size, uint32_t count, const uint8_t *buffer)
 {
@@ -3817,6 +4454,24 @@ static int write_memory_progbuf(struct target *target, target_addr_t address,
 	if (register_read(target, &s1, GDB_REGNO_S1) != ERROR_OK)
 		return ERROR_FAIL;
 
+	/* Move whole blocks with an unrolled program if the hart can access the
+	 * data registers, the rest one element at a time. */
+	bool mprv = riscv_enable_virtual && has_sufficient_progbuf(target, 5) &&
+		get_field(mstatus, MSTATUS_MPRV);
+	int data_address;
+	unsigned int unroll = progbuf_unroll_count(target, size, mprv, &data_address);
+	if (unroll && count >= 2 * unroll) {
+		uint32_t blocks = count / unroll;
+		if (write_memory_progbuf_unrolled(target, address, size, blocks, unroll,
+					mprv, data_address, buffer) == ERROR_OK) {
+			address += blocks * unroll * size;
+			buffer += blocks * unroll * size;
+			count -= blocks * unroll;
+		}
+	}
+	if (count == 0)
+		goto error;
+
 	/* Write the program (store, increment) */
 	struct riscv_program program;
 	riscv_program_init(&program, target);
@@ -3858,11 +4513,12 @@ static int write_memory_progbuf(struct target *target, target_addr_t address,
 	while (cur_addr < fin_addr) {
 		LOG_DEBUG("transferring burst starting at address 0x%016" PRIx64,
 				cur_addr);
+		riscv_addr_t batch_start = cur_addr;
 
 		struct riscv_batch *batch = riscv_batch_alloc(
 				target,
-				32,
-				info->dmi_busy_delay + info->ac_busy_delay);
+				riscv_batch_block_scans(),
+				delay(info, DELAY_DMI) + delay(info, DELAY_PROGBUF));
 		if (!batch)
 			goto error;
 
@@ -3938,13 +4594,15 @@ static int write_memory_progbuf(struct target *target, target_addr_t address,
 		info->cmderr = get_field(abstractcs, DM_ABSTRACTCS_CMDERR);
 		if (info->cmderr == CMDERR_NONE && !dmi_busy_encountered) {
 			LOG_DEBUG("successful (partial?) memory write");
+			delay_success(info, DELAY_PROGBUF, (cur_addr - batch_start) / size);
+			delay_success(info, DELAY_DMI, (cur_addr - batch_start) / size);
 		} else if (info->cmderr == CMDERR_BUSY || dmi_busy_encountered) {
 			if (info->cmderr == CMDERR_BUSY)
 				LOG_DEBUG("Memory write resulted in abstract command busy response.");
 			else if (dmi_busy_encountered)
 				LOG_DEBUG("Memory write resulted in DMI busy response.");
 			riscv013_clear_abstract_error(target);
-			increase_ac_busy_delay(target);
+			increase_delay(info, DELAY_PROGBUF);
 
 			dmi_write(target, DM_ABSTRACTAUTO, 0);
 			result = register_read_direct(target, &cur_addr, GDB_REGNO_S0);
@@ -4188,17 +4846,58 @@ static int select_prepped_harts(struct target *target, bool *use_hasel)
 		return ERROR_OK;
 	}
 
+	/* Halting or resuming the same harts again only costs the dmcontrol
+	 * write. */
+	if (hawindow_count == 1 && dm->hawindow_valid && dm->hawindow == hawindow[0]) {
+		*use_hasel = true;
+		return ERROR_OK;
+	}
+
+	dm->hawindow_valid = false;
 	for (unsigned i = 0; i < hawindow_count; i++) {
 		if (dmi_write(target, DM_HAWINDOWSEL, i) != ERROR_OK)
 			return ERROR_FAIL;
 		if (dmi_write(target, DM_HAWINDOW, hawindow[i]) != ERROR_OK)
 			return ERROR_FAIL;
 	}
+	if (hawindow_count == 1) {
+		dm->hawindow = hawindow[0];
+		dm->hawindow_valid = true;
+	}
 
 	*use_hasel = true;
 	return ERROR_OK;
 }
 
+/* Tell whether the hart is halted from haltsum0, which is read once per
+ * poll for all the harts of a DM. */
+static int riscv013_halt_summary(struct target *target, unsigned int generation,
+		bool *halted)
+{
+	RISCV013_INFO(info);
+	dm013_info_t *dm = get_dm(target);
+	if (!dm)
+		return ERROR_FAIL;
+
+	/* haltsum0 may not exist with a single hart. */
+	if (dm->hart_count <= 1)
+		return ERROR_FAIL;
+
+	unsigned int window = info->index / 32;
+	if (dm->haltsum0_generation != generation || dm->haltsum0_window != window) {
+		/* haltsum0 covers the window of the selected hart. */
+		if (riscv013_select_current_hart(target) != ERROR_OK)
+			return ERROR_FAIL;
+		if (dmi_read(target, &dm->haltsum0, DM_HALTSUM0) != ERROR_OK)
+			return ERROR_FAIL;
+		dm->haltsum0_window = window;
+		dm->haltsum0_generation = generation;
+	}
+
+	*halted = dm->haltsum0 & (1u << (info->index % 32));
+	return ERROR_OK;
+}
+
 static int riscv013_halt_prep(struct target *target)
 {
 	return ERROR_OK;
@@ -469,6 +469,11 @@ static int riscv_init_target(struct command_context *cmd_ctx,
 	return ERROR_OK;
 }
 
+struct riscv_csr_block {
+	uint8_t values[RISCV_CSR_BLOCK_SIZE][8];
+	char names[RISCV_CSR_BLOCK_SIZE][sizeof("csr4095")];
+};
+
 static void riscv_free_registers(struct target *target)
 {
 	/* Free the shared structure use for most registers. */
@@ -479,10 +484,20 @@ static void riscv_free_registers(struct target *target)
 			for (unsigned i = GDB_REGNO_COUNT; i < target->reg_cache->num_regs; i++)
 				free(target->reg_cache->reg_list[i].arch_info);
 			for (unsigned int i = 0; i < target->reg_cache->num_regs; i++)
-				free(target->reg_cache->reg_list[i].value);
+				if (i < GDB_REGNO_CSR0 || i > GDB_REGNO_CSR4095)
+					free(target->reg_cache->reg_list[i].value);
 			free(target->reg_cache->reg_list);
 		}
 		free(target->reg_cache);
+		target->reg_cache = NULL;
+	}
+
+	struct riscv_info *info = target->arch_info;
+	if (info) {
+		for (unsigned int i = 0; i < ARRAY_SIZE(info->csr_blocks); i++) {
+			free(info->csr_blocks[i]);
+			info->csr_blocks[i] = NULL;
+		}
 	}
 }
 
@@ -512,6 +527,9 @@ static void riscv_deinit_target(struct target *target)
 		free(entry);
 	}
 
+	if (info->sample_file)
+		fclose(info->sample_file);
+	free(info->sample_buf.buf);
 	free(info->reg_names);
 	free(target->arch_info);
 
@@ -1196,6 +1214,8 @@ static int riscv_halt_go_all_harts(struct target *target)
 			return ERROR_FAIL;
 	}
 
+	if (riscv_flush_registers(target) != ERROR_OK)
+		return ERROR_FAIL;
 	riscv_invalidate_register_cache(target);
 
 	return ERROR_OK;
@@ -1293,6 +1313,8 @@ static int riscv_resume_prep_all_harts(struct target *target)
 	if (riscv_select_current_hart(target) != ERROR_OK)
 		return ERROR_FAIL;
 	if (riscv_is_halted(target)) {
+		if (riscv_flush_registers(target) != ERROR_OK)
+			return ERROR_FAIL;
 		if (r->resume_prep(target) != ERROR_OK)
 			return ERROR_FAIL;
 	} else {
@@ -2177,6 +2199,17 @@ exit:
 		LOG_INFO("Turning off memory sampling because it failed.");
 		r->sample_config.enabled = false;
 	}
+
+	if (r->sample_file && r->sample_buf.used) {
+		if (fwrite(r->sample_buf.buf, 1, r->sample_buf.used, r->sample_file) !=
+				r->sample_buf.used || fflush(r->sample_file) != 0) {
+			LOG_ERROR("Failed to write memory samples, closing the sample file.");
+			fclose(r->sample_file);
+			r->sample_file = NULL;
+		} else {
+			r->sample_buf.used = 0;
+		}
+	}
 	return result;
 }
 
@@ -2187,12 +2220,27 @@ int riscv_openocd_poll(struct target *target)
 	int halted_hart = -1;
 
 	if (target->smp) {
+		static unsigned int poll_generation;
 		unsigned should_remain_halted = 0;
 		unsigned should_resume = 0;
 		struct target_list *list;
+
+		/* Never 0, which means no halt summary has been read yet. */
+		if (++poll_generation == 0)
+			poll_generation = 1;
+
 		foreach_smp_target(list, target->smp_targets) {
 			struct target *t = list->target;
 			struct riscv_info *r = riscv_info(t);
+
+			/* Only look at the harts the halt summary says changed. */
+			bool halted;
+			if (r->halt_summary &&
+					(t->state == TARGET_HALTED || t->state == TARGET_RUNNING) &&
+					r->halt_summary(t, poll_generation, &halted) == ERROR_OK &&
+					halted == (t->state == TARGET_HALTED))
+				continue;
+
 			enum riscv_poll_hart out = riscv_poll_hart(t, r->current_hartid);
 			switch (out) {
 			case RPH_NO_CHANGE:
@@ -2861,6 +2909,193 @@ COMMAND_HANDLER(handle_info)
 	return 0;
 }
 
+COMMAND_HANDLER(handle_delay_stats)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	RISCV_INFO(r);
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!r->print_delays) {
+		command_print(CMD, "Not supported by this debug spec version.");
+		return ERROR_FAIL;
+	}
+
+	return CALL_COMMAND_HANDLER(r->print_delays, target);
+}
+
+COMMAND_HANDLER(handle_benchmark)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	RISCV_INFO(r);
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	target_addr_t address = 0;
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_ADDRESS(CMD_ARGV[0], address);
+
+	if (!r->benchmark) {
+		command_print(CMD, "Not supported by this debug spec version.");
+		return ERROR_FAIL;
+	}
+
+	if (!target_was_examined(target)) {
+		command_print(CMD, "Target %s has not been examined.", target_name(target));
+		return ERROR_TARGET_NOT_EXAMINED;
+	}
+
+	return CALL_COMMAND_HANDLER(r->benchmark, target, CMD_ARGC == 1, address);
+}
+
+COMMAND_HANDLER(handle_memory_sampling_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	RISCV_INFO(r);
+
+	if (CMD_ARGC == 0) {
+		command_print(CMD, "Memory sample configuration for %s:", target_name(target));
+		for (unsigned int i = 0; i < ARRAY_SIZE(r->sample_config.bucket); i++) {
+			if (r->sample_config.bucket[i].enabled) {
+				command_print(CMD, "bucket %d; address=0x%" TARGET_PRIxADDR "; size=%d", i,
+						r->sample_config.bucket[i].address,
+						r->sample_config.bucket[i].size_bytes);
+			} else {
+				command_print(CMD, "bucket %d; unused", i);
+			}
+		}
+		return ERROR_OK;
+	}
+
+	if (CMD_ARGC < 2 || CMD_ARGC > 3)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (r->sample_file) {
+		command_print(CMD, "Close the sample file before changing the configuration.");
+		return ERROR_FAIL;
+	}
+
+	uint32_t bucket;
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], bucket);
+	if (bucket >= ARRAY_SIZE(r->sample_config.bucket)) {
+		command_print(CMD, "Max bucket number is %zu.", ARRAY_SIZE(r->sample_config.bucket) - 1);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	if (!strcmp(CMD_ARGV[1], "clear")) {
+		r->sample_config.bucket[bucket].enabled = false;
+	} else {
+		COMMAND_PARSE_ADDRESS(CMD_ARGV[1], r->sample_config.bucket[bucket].address);
+
+		uint32_t size_bytes = 4;
+		if (CMD_ARGC > 2)
+			COMMAND_PARSE_NUMBER(u32, CMD_ARGV[2], size_bytes);
+		if (size_bytes != 4 && size_bytes != 8) {
+			command_print(CMD, "Only 4-byte and 8-byte sizes are supported.");
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		r->sample_config.bucket[bucket].size_bytes = size_bytes;
+		r->sample_config.bucket[bucket].enabled = true;
+	}
+
+	if (!r->sample_buf.buf) {
+		r->sample_buf.size = 1024 * 1024;
+		r->sample_buf.buf = malloc(r->sample_buf.size);
+		if (!r->sample_buf.buf) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+	}
+
+	/* Clear the buffer when the configuration is changed. */
+	r->sample_buf.used = 0;
+
+	r->sample_config.enabled = false;
+	for (unsigned int i = 0; i < ARRAY_SIZE(r->sample_config.bucket); i++)
+		r->sample_config.enabled |= r->sample_config.bucket[i].enabled;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_memory_sampling_file_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	RISCV_INFO(r);
+
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (r->sample_file) {
+		fclose(r->sample_file);
+		r->sample_file = NULL;
+	}
+	if (!strcmp(CMD_ARGV[0], "off"))
+		return ERROR_OK;
+
+	FILE *f = fopen(CMD_ARGV[0], "wb");
+	if (!f) {
+		command_print(CMD, "Can't open %s for writing.", CMD_ARGV[0]);
+		return ERROR_FAIL;
+	}
+
+	/* The header describes the buckets, so the records that follow can be
+	 * decoded without this configuration. */
+	uint8_t header[8 + 16 * ARRAY_SIZE(r->sample_config.bucket)] = "RVSMPL1";
+	for (unsigned int i = 0; i < ARRAY_SIZE(r->sample_config.bucket); i++) {
+		uint8_t *entry = header + 8 + 16 * i;
+		if (!r->sample_config.bucket[i].enabled)
+			continue;
+		h_u64_to_le(entry, r->sample_config.bucket[i].address);
+		h_u32_to_le(entry + 8, r->sample_config.bucket[i].size_bytes);
+	}
+	if (fwrite(header, 1, sizeof(header), f) != sizeof(header)) {
+		command_print(CMD, "Failed to write %s.", CMD_ARGV[0]);
+		fclose(f);
+		return ERROR_FAIL;
+	}
+
+	/* Anything sampled so far goes to the file with the next round. */
+	r->sample_file = f;
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_dump_sample_buf_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	RISCV_INFO(r);
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	unsigned int i = 0;
+	while (i < r->sample_buf.used) {
+		uint8_t command = r->sample_buf.buf[i++];
+		if (command == RISCV_SAMPLE_BUF_TIMESTAMP_BEFORE ||
+				command == RISCV_SAMPLE_BUF_TIMESTAMP_AFTER) {
+			uint32_t timestamp = le_to_h_u32(r->sample_buf.buf + i);
+			i += 4;
+			command_print(CMD, "timestamp %s: %u",
+					command == RISCV_SAMPLE_BUF_TIMESTAMP_BEFORE ? "before" : "after",
+					timestamp);
+		} else if (command < ARRAY_SIZE(r->sample_config.bucket)) {
+			unsigned int size_bytes = r->sample_config.bucket[command].size_bytes;
+			uint64_t value = buf_get_u64(r->sample_buf.buf + i, 0, 8 * size_bytes);
+			i += size_bytes;
+			command_print(CMD, "0x%" TARGET_PRIxADDR ": 0x%" PRIx64,
+					r->sample_config.bucket[command].address, value);
+		} else {
+			LOG_ERROR("Found invalid byte 0x%x in sample buffer at offset %u.",
+					command, i - 1);
+			return ERROR_FAIL;
+		}
+	}
+
+	r->sample_buf.used = 0;
+	return ERROR_OK;
+}
+
 static const struct command_registration riscv_exec_command_handlers[] = {
 	{
 		.name = "info",
@@ -2869,6 +3104,44 @@ static const struct command_registration riscv_exec_command_handlers[] = {
 		.usage = "",
 		.help = "Displays some information OpenOCD detected about the target."
 	},
+	{
+		.name = "delay_stats",
+		.handler = handle_delay_stats,
+		.mode = COMMAND_EXEC,
+		.usage = "",
+		.help = "Displays the learned run-test/idle delays and busy retry counts."
+	},
+	{
+		.name = "benchmark",
+		.handler = handle_benchmark,
+		.mode = COMMAND_EXEC,
+		.usage = "[address]",
+		.help = "Measures DMI, abstract register and, when an address is "
+				"given, memory read throughput."
+	},
+	{
+		.name = "memory_sampling",
+		.handler = handle_memory_sampling_command,
+		.mode = COMMAND_ANY,
+		.usage = "bucket address|clear [size=4]",
+		.help = "Configure a memory location to be sampled while the target "
+				"is running."
+	},
+	{
+		.name = "memory_sampling_file",
+		.handler = handle_memory_sampling_file_command,
+		.mode = COMMAND_ANY,
+		.usage = "filename|off",
+		.help = "Stream memory samples into a binary file instead of keeping "
+				"them in the sample buffer."
+	},
+	{
+		.name = "dump_sample_buf",
+		.handler = handle_dump_sample_buf_command,
+		.mode = COMMAND_ANY,
+		.usage = "",
+		.help = "Print the contents of the sample buffer and clear it."
+	},
 	{
 		.name = "set_command_timeout_sec",
 		.handler = riscv_set_command_timeout_sec,
@@ -3178,6 +3451,8 @@ static int riscv_step_rtos_hart(struct target *target)
 		LOG_ERROR("Hart isn't halted before single step!");
 		return ERROR_FAIL;
 	}
+	if (riscv_flush_registers(target) != ERROR_OK)
+		return ERROR_FAIL;
 	riscv_invalidate_register_cache(target);
 	r->on_step(target);
 	if (r->step_current_hart(target) != ERROR_OK)
@@ -3301,6 +3576,36 @@ static bool gdb_regno_cacheable(enum gdb_regno regno, bool write)
 	}
 }
 
+struct reg *riscv_reg_cache_entry(struct target *target, enum gdb_regno regno)
+{
+	RISCV_INFO(info);
+
+	struct reg *reg = &target->reg_cache->reg_list[regno];
+	if (reg->value)
+		return reg;
+
+	/* Only CSRs are allocated lazily. */
+	assert(regno >= GDB_REGNO_CSR0 && regno <= GDB_REGNO_CSR4095);
+	unsigned int block = (regno - GDB_REGNO_CSR0) / RISCV_CSR_BLOCK_SIZE;
+	struct riscv_csr_block *csr_block = calloc(1, sizeof(*csr_block));
+	if (!csr_block) {
+		LOG_ERROR("Out of memory");
+		return NULL;
+	}
+	info->csr_blocks[block] = csr_block;
+
+	for (unsigned int i = 0; i < RISCV_CSR_BLOCK_SIZE; i++) {
+		unsigned int csr_number = block * RISCV_CSR_BLOCK_SIZE + i;
+		struct reg *r = &target->reg_cache->reg_list[GDB_REGNO_CSR0 + csr_number];
+		r->value = csr_block->values[i];
+		if (!r->name) {
+			sprintf(csr_block->names[i], "csr%u", csr_number);
+			r->name = csr_block->names[i];
+		}
+	}
+	return reg;
+}
+
 /**
  * This function is called when the debug user wants to change the value of a
  * register. The new value may be cached, and may not be written until the hart
@@ -3318,9 +3623,20 @@ int riscv_set_register(struct target *target, enum gdb_regno regid, riscv_reg_t
 			riscv_supports_extension(target, 'E'))
 		return ERROR_OK;
 
-	struct reg *reg = &target->reg_cache->reg_list[regid];
+	struct reg *reg = riscv_reg_cache_entry(target, regid);
+	if (!reg)
+		return ERROR_FAIL;
 	buf_set_u64(reg->value, 0, reg->size, value);
 
+	/* GPRs have no side effects, so writing them can wait until the hart
+	 * runs again, and then happen all at once. */
+	if (r->write_registers && target->state == TARGET_HALTED &&
+			regid > GDB_REGNO_ZERO && regid <= GDB_REGNO_XPR31) {
+		reg->valid = true;
+		reg->dirty = true;
+		return ERROR_OK;
+	}
+
 	int result = r->set_register(target, regid, value);
 	if (result == ERROR_OK)
 		reg->valid = gdb_regno_cacheable(regid, true);
@@ -3331,6 +3647,43 @@ int riscv_set_register(struct target *target, enum gdb_regno regid, riscv_reg_t
 	return result;
 }
 
+int riscv_flush_registers(struct target *target)
+{
+	RISCV_INFO(r);
+
+	if (!target->reg_cache)
+		return ERROR_OK;
+
+	enum gdb_regno regids[GDB_REGNO_XPR31];
+	riscv_reg_t values[GDB_REGNO_XPR31];
+	unsigned int count = 0;
+	for (enum gdb_regno i = GDB_REGNO_ZERO + 1; i <= GDB_REGNO_XPR31; i++) {
+		struct reg *reg = &target->reg_cache->reg_list[i];
+		if (!reg->dirty)
+			continue;
+		/* Clean before writing, the write itself may use other registers. */
+		reg->dirty = false;
+		regids[count] = i;
+		values[count] = buf_get_u64(reg->value, 0, reg->size);
+		count++;
+	}
+	if (count == 0)
+		return ERROR_OK;
+
+	LOG_DEBUG("[%s] writing back %u registers", target_name(target), count);
+	if (count > 1 && r->write_registers(target, count, regids, values) == ERROR_OK)
+		return ERROR_OK;
+
+	int result = ERROR_OK;
+	for (unsigned int i = 0; i < count; i++) {
+		if (r->set_register(target, regids[i], values[i]) != ERROR_OK) {
+			target->reg_cache->reg_list[regids[i]].valid = false;
+			result = ERROR_FAIL;
+		}
+	}
+	return result;
+}
+
 int riscv_get_register(struct target *target, riscv_reg_t *value,
 		enum gdb_regno regid)
 {
@@ -3359,6 +3712,9 @@ int riscv_get_register(struct target *target, riscv_reg_t *value,
 		return ERROR_OK;
 	}
 
+	/* The value is cached by r->get_register(). */
+	if (!riscv_reg_cache_entry(target, regid))
+		return ERROR_FAIL;
 	int result = r->get_register(target, value, regid);
 
 	if (result == ERROR_OK)
@@ -3700,6 +4056,9 @@ static int register_get(struct reg *reg)
 	struct target *target = reg_info->target;
 	RISCV_INFO(r);
 
+	if (!riscv_reg_cache_entry(target, reg->number))
+		return ERROR_FAIL;
+
 	if (reg->number >= GDB_REGNO_V0 && reg->number <= GDB_REGNO_V31) {
 		if (!r->get_register_buf) {
 			LOG_ERROR("Reading register %s not supported on this RISC-V target.",
@@ -3740,6 +4099,8 @@ static int register_set(struct reg *reg, uint8_t *buf)
 	if (reg->number == GDB_REGNO_ZERO)
 		return ERROR_OK;
 
+	if (!riscv_reg_cache_entry(target, reg->number))
+		return ERROR_FAIL;
 	memcpy(reg->value, buf, DIV_ROUND_UP(reg->size, 8));
 	reg->valid = gdb_regno_cacheable(reg->number, true);
 
@@ -4222,12 +4583,12 @@ int riscv_init_registers(struct target *target)
 			if (csr_info[csr_info_index].number == csr_number) {
 				r->name = csr_info[csr_info_index].name;
 			} else {
-				sprintf(reg_name, "csr%d", csr_number);
 				/* Assume unnamed registers don't exist, unless we have some
 				 * configuration that tells us otherwise. That's important
 				 * because eg. Eclipse crashes if a target has too many
 				 * registers, and apparently has no way of only showing a
-				 * subset of registers in any case. */
+				 * subset of registers in any case. The name is only made
+				 * up when the register is exposed or first used. */
 				r->exist = false;
 			}
 
@@ -4342,10 +4703,10 @@ int riscv_init_registers(struct target *target)
 				range_list_t *entry;
 				list_for_each_entry(entry, &info->expose_csr, list)
 					if ((entry->low <= csr_number) && (csr_number <= entry->high)) {
-						if (entry->name) {
-							*reg_name = 0;
+						if (entry->name)
 							r->name = entry->name;
-						}
+						else
+							sprintf(reg_name, "csr%d", csr_number);
 
 						LOG_DEBUG("Exposing additional CSR %d (name=%s)",
 								csr_number, entry->name ? entry->name : reg_name);
@@ -4408,7 +4769,9 @@ int riscv_init_registers(struct target *target)
 			assert(reg_name < info->reg_names + target->reg_cache->num_regs *
 					max_reg_name_len);
 		}
-		r->value = calloc(1, DIV_ROUND_UP(r->size, 8));
+		/* CSR values are allocated by riscv_reg_cache_entry(). */
+		if (number < GDB_REGNO_CSR0 || number > GDB_REGNO_CSR4095)
+			r->value = calloc(1, DIV_ROUND_UP(r->size, 8));
 	}
 
 	return ERROR_OK;
@@ -4417,9 +4780,19 @@ int riscv_init_registers(struct target *target)
 
 void riscv_add_bscan_tunneled_scan(struct target *target, struct scan_field *field,
 					riscv_bscan_tunneled_scan_context_t *ctxt)
+{
+	riscv_add_bscan_tunneled_ir_scan(target);
+	riscv_add_bscan_tunneled_dr_scan(target, field, ctxt);
+}
+
+void riscv_add_bscan_tunneled_ir_scan(struct target *target)
 {
 	jtag_add_ir_scan(target->tap, &select_user4, TAP_IDLE);
+}
 
+void riscv_add_bscan_tunneled_dr_scan(struct target *target, struct scan_field *field,
+					riscv_bscan_tunneled_scan_context_t *ctxt)
+{
 	memset(ctxt->tunneled_dr, 0, sizeof(ctxt->tunneled_dr));
 	if (bscan_tunnel_type == BSCAN_TUNNEL_DATA_REGISTER) {
 		ctxt->tunneled_dr[3].num_bits = 1;
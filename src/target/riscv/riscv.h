@@ -4,8 +4,10 @@
 #define RISCV_H
 
 struct riscv_program;
+struct riscv_csr_block;
 
 #include <stdint.h>
+#include <stdio.h>
 #include "opcodes.h"
 #include "gdb_regs.h"
 #include "jtag/jtag.h"
@@ -20,6 +22,7 @@ struct riscv_program;
 #define RISCV_MAX_REGISTERS 5000
 #define RISCV_MAX_TRIGGERS 32
 #define RISCV_MAX_HWBPS 16
+#define RISCV_CSR_BLOCK_SIZE 64
 
 #define DEFAULT_COMMAND_TIMEOUT_SEC		2
 #define DEFAULT_RESET_TIMEOUT_SEC		30
@@ -104,6 +107,9 @@ struct riscv_info {
 	/* Single buffer that contains all register names, instead of calling
 	 * malloc for each register. Needs to be freed when reg_list is freed. */
 	char *reg_names;
+	/* Value buffers (and names of unnamed CSRs) for the CSR cache entries,
+	 * allocated a block at a time when one of its CSRs is first used. */
+	struct riscv_csr_block *csr_blocks[4096 / RISCV_CSR_BLOCK_SIZE];
 
 	/* It's possible that each core has a different supported ISA set. */
 	int xlen;
@@ -141,11 +147,18 @@ struct riscv_info {
 	 * implementations. */
 	int (*get_register)(struct target *target, riscv_reg_t *value, int regid);
 	int (*set_register)(struct target *target, int regid, uint64_t value);
+	/* Optional: write several GPRs in one go. When present, GPR writes on a
+	 * halted hart are only cached until the hart is stepped or resumed. */
+	int (*write_registers)(struct target *target, unsigned int count,
+			const enum gdb_regno *regids, const riscv_reg_t *values);
 	int (*get_register_buf)(struct target *target, uint8_t *buf, int regno);
 	int (*set_register_buf)(struct target *target, int regno,
 			const uint8_t *buf);
 	int (*select_current_hart)(struct target *target);
 	bool (*is_halted)(struct target *target);
+	/* Optional: whether the hart is halted, from a summary shared by all the
+	 * harts of the debug module that is read once per poll @a generation. */
+	int (*halt_summary)(struct target *target, unsigned int generation, bool *halted);
 	/* Resume this target, as well as every other prepped target that can be
 	 * resumed near-simultaneously. Clear the prepped flag on any target that
 	 * was resumed. */
@@ -187,6 +200,10 @@ struct riscv_info {
 	unsigned (*data_bits)(struct target *target);
 
 	COMMAND_HELPER((*print_info), struct target *target);
+	COMMAND_HELPER((*print_delays), struct target *target);
+	/* Optional: measure DMI, register and memory access throughput. */
+	COMMAND_HELPER((*benchmark), struct target *target, bool memory,
+			target_addr_t address);
 
 	/* Storage for vector register types. */
 	struct reg_data_type_vector vector_uint8;
@@ -226,6 +243,9 @@ struct riscv_info {
 
 	riscv_sample_config_t sample_config;
 	struct riscv_sample_buf sample_buf;
+	/* When set, the sample buffer is emptied into this file after every
+	 * sampling round. */
+	FILE *sample_file;
 };
 
 COMMAND_HELPER(riscv_print_info_line, const char *section, const char *key,
@@ -325,6 +345,11 @@ int riscv_count_harts(struct target *target);
 
 /** Set register, updating the cache. */
 int riscv_set_register(struct target *target, enum gdb_regno i, riscv_reg_t v);
+/** Get the cache entry of register @a regno, making sure it has a value
+ * buffer. Returns NULL if that can't be allocated. */
+struct reg *riscv_reg_cache_entry(struct target *target, enum gdb_regno regno);
+/** Write back the register values that riscv_set_register() only cached. */
+int riscv_flush_registers(struct target *target);
 /** Get register, from the cache if it's in there. */
 int riscv_get_register(struct target *target, riscv_reg_t *value,
 		enum gdb_regno r);
@@ -360,6 +385,11 @@ enum semihosting_result riscv_semihosting(struct target *target, int *retval);
 
 void riscv_add_bscan_tunneled_scan(struct target *target, struct scan_field *field,
 		riscv_bscan_tunneled_scan_context_t *ctxt);
+/* The two halves of riscv_add_bscan_tunneled_scan(). The IR keeps selecting
+ * the tunnel, so several DR scans can follow a single IR scan. */
+void riscv_add_bscan_tunneled_ir_scan(struct target *target);
+void riscv_add_bscan_tunneled_dr_scan(struct target *target, struct scan_field *field,
+		riscv_bscan_tunneled_scan_context_t *ctxt);
 
 int riscv_read_by_any_size(struct target *target, target_addr_t address, uint32_t size, uint8_t *buffer);
 int riscv_write_by_any_size(struct target *target, target_addr_t address, uint32_t size, uint8_t *buffer);
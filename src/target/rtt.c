@@ -238,45 +238,58 @@ int target_rtt_read_control_block(struct target *target,
 	return ERROR_OK;
 }
 
+/* Location of the control block found last, tried first by the next search */
+static struct {
+	struct target *target;
+	target_addr_t address;
+	char id[RTT_CB_MAX_ID_LENGTH];
+	bool valid;
+} last_found;
+
 int target_rtt_find_control_block(struct target *target,
 		target_addr_t *address, size_t size, const char *id, bool *found,
 		void *user_data)
 {
-	target_addr_t address_end = *address + size;
-	uint8_t buf[1024];
+	const target_addr_t address_end = *address + size;
+	const size_t id_length = strlen(id);
+	target_addr_t match;
+	int ret;
 
 	*found = false;
 
-	size_t id_matched_length = 0;
-	const size_t id_length = strlen(id);
+	/* The control block usually stays where it was as long as the
+	 * application is not rebuilt, so check there first */
+	if (last_found.valid && last_found.target == target &&
+			!strcmp(last_found.id, id) && last_found.address >= *address &&
+			last_found.address + id_length <= address_end) {
+		uint8_t buf[RTT_CB_MAX_ID_LENGTH];
+
+		ret = target_read_buffer(target, last_found.address, id_length, buf);
+
+		if (ret == ERROR_OK && !memcmp(buf, id, id_length)) {
+			LOG_DEBUG("rtt: Control block still at 0x%" TARGET_PRIxADDR,
+				last_found.address);
+			*address = last_found.address;
+			*found = true;
+			return ERROR_OK;
+		}
+	}
 
 	LOG_INFO("rtt: Searching for control block '%s'", id);
 
-	for (target_addr_t addr = *address; addr < address_end; addr += sizeof(buf)) {
-		int ret;
+	ret = target_search_memory(target, *address, size, (const uint8_t *)id,
+		id_length, &match, found);
 
-		const size_t buf_size = MIN(sizeof(buf), address_end - addr);
-		ret = target_read_buffer(target, addr, buf_size, buf);
+	if (ret != ERROR_OK)
+		return ret;
 
-		if (ret != ERROR_OK)
-			return ret;
+	last_found.valid = *found;
 
-		for (size_t buf_off = 0; buf_off < buf_size; buf_off++) {
-			if (id_matched_length > 0 &&
-			    buf[buf_off] != id[id_matched_length]) {
-				/* Start from beginning */
-				id_matched_length = 0;
-			}
-
-			if (buf[buf_off] == id[id_matched_length])
-				id_matched_length++;
-
-			if (id_matched_length == id_length) {
-				*address = addr + buf_off + 1 - id_length;
-				*found = true;
-				return ERROR_OK;
-			}
-		}
+	if (*found) {
+		*address = match;
+		last_found.target = target;
+		last_found.address = match;
+		strncpy(last_found.id, id, sizeof(last_found.id) - 1);
 	}
 
 	return ERROR_OK;
@@ -310,103 +323,168 @@ int target_rtt_read_channel_info(struct target *target,
 	return ERROR_OK;
 }
 
-static int read_from_channel(struct target *target,
-		const struct rtt_channel *channel, uint8_t *buffer,
-		size_t *length)
+/* Fill @a ranges with the reads of the pending data of an up-channel, at
+ * most @a length bytes. Returns the number of ranges used. */
+static unsigned int read_from_channel_ranges(const struct rtt_channel *channel,
+		uint8_t *buffer, size_t *length, struct target_memory_sg *ranges)
 {
-	int ret;
 	uint32_t len;
 
-	if (!*length)
-		return ERROR_OK;
-
 	if (channel->read_pos == channel->write_pos) {
-		len = 0;
+		*length = 0;
+		return 0;
 	} else if (channel->read_pos < channel->write_pos) {
 		len = MIN(*length, channel->write_pos - channel->read_pos);
+		*length = len;
 
-		ret = target_read_buffer(target,
+		target_memory_sg_range(&ranges[0],
 			channel->buffer_addr + channel->read_pos, len, buffer);
+		return 1;
+	}
 
-		if (ret != ERROR_OK)
-			return ret;
-	} else {
-		uint32_t first_length;
+	uint32_t first_length;
 
-		len = MIN(*length,
-			channel->size - channel->read_pos + channel->write_pos);
-		first_length = MIN(len, channel->size - channel->read_pos);
+	len = MIN(*length,
+		channel->size - channel->read_pos + channel->write_pos);
+	first_length = MIN(len, channel->size - channel->read_pos);
+	*length = len;
 
-		ret = target_read_buffer(target,
-			channel->buffer_addr + channel->read_pos, first_length, buffer);
+	target_memory_sg_range(&ranges[0],
+		channel->buffer_addr + channel->read_pos, first_length, buffer);
+	if (len == first_length)
+		return 1;
 
-		if (ret != ERROR_OK)
-			return ret;
+	target_memory_sg_range(&ranges[1], channel->buffer_addr,
+		len - first_length, buffer + first_length);
+	return 2;
+}
 
-		ret = target_read_buffer(target, channel->buffer_addr,
-			len - first_length, buffer + first_length);
+/* Up-channel data read per channel and poll */
+#define RTT_READ_BUFFER_SIZE	1024
 
-		if (ret != ERROR_OK)
-			return ret;
-	}
+/*
+ * Read all up-channels with sinks in three batches: the descriptor array,
+ * the pending data of all channels as one scatter-gather read, and the
+ * RdOff updates as one scatter-gather write.
+ */
+int target_rtt_read_callback(struct target *target,
+		const struct rtt_control *ctrl, struct rtt_sink_list **sinks,
+		size_t num_channels, struct rtt_channel_fill *fill, void *user_data)
+{
+	int ret;
 
-	if (len > 0) {
-		ret = target_write_u32(target, channel->address + 16,
-			(channel->read_pos + len) % channel->size);
+	memset(fill, 0, num_channels * sizeof(*fill));
+	num_channels = MIN(num_channels, ctrl->num_up_channels);
 
-		if (ret != ERROR_OK)
-			return ret;
+	if (!num_channels)
+		return ERROR_OK;
+
+	uint8_t *descs = malloc(num_channels * RTT_CHANNEL_SIZE);
+	struct rtt_channel *channels = calloc(num_channels, sizeof(*channels));
+	size_t *lengths = calloc(num_channels, sizeof(*lengths));
+	uint8_t *buffers = malloc(num_channels * RTT_READ_BUFFER_SIZE);
+	uint8_t *read_pos = malloc(num_channels * 4);
+	struct target_memory_sg *ranges = malloc(2 * num_channels * sizeof(*ranges));
+
+	if (!descs || !channels || !lengths || !buffers || !read_pos || !ranges) {
+		LOG_ERROR("Out of memory");
+		ret = ERROR_FAIL;
+		goto out;
 	}
 
-	*length = len;
+	target_addr_t address = ctrl->address + RTT_CB_SIZE;
+	ret = target_read_buffer(target, address, num_channels * RTT_CHANNEL_SIZE,
+		descs);
 
-	return ERROR_OK;
-}
+	if (ret != ERROR_OK) {
+		LOG_ERROR("rtt: Failed to read up-channel descriptions");
+		goto out;
+	}
 
-int target_rtt_read_callback(struct target *target,
-		const struct rtt_control *ctrl, struct rtt_sink_list **sinks,
-		size_t num_channels, void *user_data)
-{
-	num_channels = MIN(num_channels, ctrl->num_up_channels);
+	unsigned int num_ranges = 0;
 
 	for (size_t i = 0; i < num_channels; i++) {
-		int ret;
-		struct rtt_channel channel;
-		uint8_t buffer[1024];
-		size_t length;
+		struct rtt_channel *channel = &channels[i];
+		const uint8_t *buf = descs + i * RTT_CHANNEL_SIZE;
 
 		if (!sinks[i])
 			continue;
 
-		ret = read_rtt_channel(target, ctrl, i, RTT_CHANNEL_TYPE_UP,
-			&channel);
-
-		if (ret != ERROR_OK) {
-			LOG_ERROR("rtt: Failed to read up-channel %zu description", i);
-			return ret;
-		}
+		channel->address = address + i * RTT_CHANNEL_SIZE;
+		channel->name_addr = buf_get_u32(buf + 0, 0, 32);
+		channel->buffer_addr = buf_get_u32(buf + 4, 0, 32);
+		channel->size = buf_get_u32(buf + 8, 0, 32);
+		channel->write_pos = buf_get_u32(buf + 12, 0, 32);
+		channel->read_pos = buf_get_u32(buf + 16, 0, 32);
+		channel->flags = buf_get_u32(buf + 20, 0, 32);
 
-		if (!channel_is_active(&channel)) {
+		if (!channel_is_active(channel)) {
 			LOG_WARNING("rtt: Up-channel %zu is not active", i);
 			continue;
 		}
 
-		if (channel.size < RTT_CHANNEL_BUFFER_MIN_SIZE) {
+		if (channel->size < RTT_CHANNEL_BUFFER_MIN_SIZE) {
 			LOG_WARNING("rtt: Up-channel %zu is not large enough", i);
 			continue;
 		}
 
-		length = sizeof(buffer);
-		ret = read_from_channel(target, &channel, buffer, &length);
+		lengths[i] = RTT_READ_BUFFER_SIZE;
+		num_ranges += read_from_channel_ranges(channel,
+			buffers + i * RTT_READ_BUFFER_SIZE, &lengths[i],
+			ranges + num_ranges);
 
-		if (ret != ERROR_OK) {
-			LOG_ERROR("rtt: Failed to read from up-channel %zu", i);
-			return ret;
-		}
+		fill[i].size = channel->size;
+		fill[i].pending = (channel->write_pos + channel->size - channel->read_pos) % channel->size;
+		fill[i].read = lengths[i];
+	}
+
+	if (!num_ranges)
+		goto out;
+
+	ret = target_read_memory_sg(target, ranges, num_ranges);
+
+	if (ret != ERROR_OK) {
+		LOG_ERROR("rtt: Failed to read from up-channels");
+		goto out;
+	}
+
+	num_ranges = 0;
+
+	for (size_t i = 0; i < num_channels; i++) {
+		const struct rtt_channel *channel = &channels[i];
+
+		if (!lengths[i])
+			continue;
+
+		target_buffer_set_u32(target, read_pos + 4 * num_ranges,
+			(channel->read_pos + lengths[i]) % channel->size);
+		target_memory_sg_range(&ranges[num_ranges], channel->address + 16, 4,
+			read_pos + 4 * num_ranges);
+		num_ranges++;
+	}
+
+	ret = target_write_memory_sg(target, ranges, num_ranges);
+
+	if (ret != ERROR_OK) {
+		LOG_ERROR("rtt: Failed to update up-channel read positions");
+		goto out;
+	}
+
+	for (size_t i = 0; i < num_channels; i++) {
+		if (!lengths[i])
+			continue;
 
 		for (struct rtt_sink_list *sink = sinks[i]; sink; sink = sink->next)
-			sink->read(i, buffer, length, sink->user_data);
+			sink->read(i, buffers + i * RTT_READ_BUFFER_SIZE, lengths[i],
+				sink->user_data);
 	}
 
-	return ERROR_OK;
+out:
+	free(ranges);
+	free(read_pos);
+	free(buffers);
+	free(lengths);
+	free(channels);
+	free(descs);
+	return ret;
 }
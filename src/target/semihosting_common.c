@@ -128,6 +128,8 @@ int semihosting_common_init(struct target *target, void *setup,
 	semihosting->stderr_fd = -1;
 	semihosting->is_fileio = false;
 	semihosting->hit_fileio = false;
+	semihosting->can_park = false;
+	semihosting->read_parked = false;
 	semihosting->is_resumable = false;
 	semihosting->has_resumable_exit = false;
 	semihosting->word_size_bytes = 0;
@@ -137,6 +139,8 @@ int semihosting_common_init(struct target *target, void *setup,
 	semihosting->sys_errno = -1;
 	semihosting->cmdline = NULL;
 	semihosting->basedir = NULL;
+	semihosting->console_length = 0;
+	semihosting->console_flush_pending = false;
 
 	/* If possible, update it in setup(). */
 	semihosting->setup_time = clock();
@@ -155,6 +159,7 @@ int semihosting_common_init(struct target *target, void *setup,
 
 struct semihosting_tcp_service {
 	struct semihosting *semihosting;
+	struct target *target;
 	char *name;
 	int error;
 };
@@ -217,11 +222,83 @@ static ssize_t semihosting_redirect_write(struct semihosting *semihosting, void
 	return retval;
 }
 
+static int semihosting_console_flush_callback(void *priv);
+
+/**
+ * Write the buffered console output of the target.
+ */
+void semihosting_console_flush(struct semihosting *semihosting)
+{
+	if (semihosting->console_flush_pending) {
+		target_unregister_timer_callback(semihosting_console_flush_callback, semihosting);
+		semihosting->console_flush_pending = false;
+	}
+
+	size_t written = 0;
+	while (written < semihosting->console_length) {
+		ssize_t result = write(semihosting->console_fd, semihosting->console_buffer + written,
+			semihosting->console_length - written);
+		if (result <= 0) {
+			LOG_ERROR("semihosting: failed to write console output: %s", strerror(errno));
+			break;
+		}
+		written += result;
+	}
+
+	semihosting->console_length = 0;
+}
+
+static int semihosting_console_flush_callback(void *priv)
+{
+	struct semihosting *semihosting = priv;
+
+	/* a one shot callback is unregistered by the caller */
+	semihosting->console_flush_pending = false;
+	semihosting_console_flush(semihosting);
+
+	return ERROR_OK;
+}
+
+/**
+ * Buffer console output, so that the target is resumed without waiting
+ * for the host. Returns false when @a fd is not a console.
+ */
+static bool semihosting_console_write(struct semihosting *semihosting, int fd,
+	const void *buf, size_t size)
+{
+	if (fd != semihosting->stdout_fd && fd != semihosting->stderr_fd)
+		return false;
+
+	if (size > SEMIHOSTING_CONSOLE_BUFFER_SIZE)
+		return false;
+
+	if (semihosting->console_length && (semihosting->console_fd != fd ||
+			semihosting->console_length + size > SEMIHOSTING_CONSOLE_BUFFER_SIZE))
+		semihosting_console_flush(semihosting);
+
+	memcpy(semihosting->console_buffer + semihosting->console_length, buf, size);
+	semihosting->console_length += size;
+	semihosting->console_fd = fd;
+
+	if (!semihosting->console_flush_pending) {
+		target_register_timer_callback(semihosting_console_flush_callback, 0,
+			TARGET_TIMER_TYPE_ONESHOT, semihosting);
+		semihosting->console_flush_pending = true;
+	}
+
+	return true;
+}
+
 static ssize_t semihosting_write(struct semihosting *semihosting, int fd, void *buf, int size)
 {
 	if (semihosting_is_redirected(semihosting, fd))
 		return semihosting_redirect_write(semihosting, buf, size);
 
+	if (semihosting_console_write(semihosting, fd, buf, size))
+		return size;
+
+	semihosting_console_flush(semihosting);
+
 	/* default write */
 	int result = write(fd, buf, size);
 	if (result == -1)
@@ -255,11 +332,98 @@ static ssize_t semihosting_redirect_read(struct semihosting *semihosting, void *
 	return retval;
 }
 
+/**
+ * Whether a read from @a fd would wait for input from the TCP redirection.
+ * The target is then parked instead, see semihosting_park_read().
+ */
+static bool semihosting_read_would_block(struct semihosting *semihosting, int fd)
+{
+	if (!semihosting->can_park || !semihosting->tcp_connection ||
+			!semihosting_is_redirected(semihosting, fd))
+		return false;
+
+	struct timeval tv = { .tv_sec = 0, .tv_usec = 0 };
+	fd_set read_fds;
+	int fd_in = semihosting->tcp_connection->fd;
+
+	FD_ZERO(&read_fds);
+	FD_SET(fd_in, &read_fds);
+
+	return socket_select(fd_in + 1, &read_fds, NULL, NULL, &tv) == 0;
+}
+
+static void semihosting_park_read(struct semihosting *semihosting, int fd,
+	uint64_t addr, size_t len)
+{
+	LOG_DEBUG("no input for semihosting read, waiting for the TCP client");
+	semihosting->read_parked = true;
+	semihosting->parked_fd = fd;
+	semihosting->parked_addr = addr;
+	semihosting->parked_len = len;
+}
+
+static int semihosting_read_to_target(struct target *target, int fd,
+	uint64_t addr, size_t len);
+static inline int semihosting_getchar(struct semihosting *semihosting, int fd);
+
+/**
+ * Finish a read parked by semihosting_park_read() and resume the target.
+ * With @a eof set, nothing is read, e.g. because the client disconnected.
+ */
+static int semihosting_resume_parked_read(struct target *target, bool eof)
+{
+	struct semihosting *semihosting = target->semihosting;
+	int retval;
+
+	semihosting->read_parked = false;
+
+	if (semihosting->op == SEMIHOSTING_SYS_READC) {
+		semihosting->result = eof ? EOF : semihosting_getchar(semihosting, semihosting->parked_fd);
+	} else if (eof) {
+		semihosting->result = semihosting->parked_len;
+	} else {
+		retval = semihosting_read_to_target(target, semihosting->parked_fd,
+			semihosting->parked_addr, semihosting->parked_len);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	retval = semihosting->post_result(target);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return target_resume(target, 1, 0, 0, 0);
+}
+
+/**
+ * Called when the target is halted while a read is parked: the read returns
+ * without data and the halt is reported.
+ */
+int semihosting_cancel_parked_read(struct target *target)
+{
+	struct semihosting *semihosting = target->semihosting;
+
+	semihosting->read_parked = false;
+	semihosting->result = (semihosting->op == SEMIHOSTING_SYS_READC) ? EOF :
+		(int64_t)semihosting->parked_len;
+
+	int retval = semihosting->post_result(target);
+	if (retval != ERROR_OK)
+		return retval;
+
+	target->debug_reason = DBG_REASON_DBGRQ;
+	return target_call_event_callbacks(target, TARGET_EVENT_HALTED);
+}
+
 static inline int semihosting_putchar(struct semihosting *semihosting, int fd, int c)
 {
 	if (semihosting_is_redirected(semihosting, fd))
 		return semihosting_redirect_write(semihosting, &c, 1);
 
+	unsigned char byte = c;
+	if (semihosting_console_write(semihosting, fd, &byte, 1))
+		return c;
+
 	/* default putchar */
 	return putchar(c);
 }
@@ -277,6 +441,21 @@ static inline ssize_t semihosting_read(struct semihosting *semihosting, int fd,
 	return result;
 }
 
+/* Strings are read in aligned chunks, which don't cross a page boundary */
+#define SEMIHOSTING_STRING_CHUNK 64
+
+/**
+ * Read the bytes of a string from @a addr up to the next chunk boundary,
+ * instead of one memory access per character.
+ */
+static int semihosting_read_string_chunk(struct target *target, uint64_t addr,
+	uint8_t *chunk, size_t *chunk_len)
+{
+	*chunk_len = SEMIHOSTING_STRING_CHUNK - (addr % SEMIHOSTING_STRING_CHUNK);
+
+	return target_read_buffer(target, addr, *chunk_len, chunk);
+}
+
 static inline int semihosting_getchar(struct semihosting *semihosting, int fd)
 {
 	if (semihosting_is_redirected(semihosting, fd)) {
@@ -391,6 +570,12 @@ int semihosting_common(struct target *target)
 			  semihosting_opcode_to_str(semihosting->op),
 			  semihosting->param);
 
+	/* keep the console output in order with the effects of other calls,
+	 * e.g. a prompt before reading the input or the output before exit */
+	if (semihosting->op != SEMIHOSTING_SYS_WRITEC && semihosting->op != SEMIHOSTING_SYS_WRITE0 &&
+			semihosting->op != SEMIHOSTING_SYS_WRITE)
+		semihosting_console_flush(semihosting);
+
 	switch (semihosting->op) {
 
 		case SEMIHOSTING_SYS_CLOCK:	/* 0x10 */
@@ -1041,32 +1226,12 @@ int semihosting_common(struct target *target)
 					fileio_info->param_1 = fd;
 					fileio_info->param_2 = addr;
 					fileio_info->param_3 = len;
+				} else if (semihosting_read_would_block(semihosting, fd)) {
+					semihosting_park_read(semihosting, fd, addr, len);
 				} else {
-					uint8_t *buf = malloc(len);
-					if (!buf) {
-						semihosting->result = -1;
-						semihosting->sys_errno = ENOMEM;
-					} else {
-						semihosting->result = semihosting_read(semihosting, fd, buf, len);
-						LOG_DEBUG("read(%d, 0x%" PRIx64 ", %zu)=%" PRId64,
-							fd,
-							addr,
-							len,
-							semihosting->result);
-						if (semihosting->result >= 0) {
-							retval = target_write_buffer(target, addr,
-									semihosting->result,
-									buf);
-							if (retval != ERROR_OK) {
-								free(buf);
-								return retval;
-							}
-							/* the number of bytes NOT filled in */
-							semihosting->result = len -
-								semihosting->result;
-						}
-						free(buf);
-					}
+					retval = semihosting_read_to_target(target, fd, addr, len);
+					if (retval != ERROR_OK)
+						return retval;
 				}
 			}
 			break;
@@ -1087,6 +1252,10 @@ int semihosting_common(struct target *target)
 				LOG_ERROR("SYS_READC not supported by semihosting fileio");
 				return ERROR_FAIL;
 			}
+			if (semihosting_read_would_block(semihosting, semihosting->stdin_fd)) {
+				semihosting_park_read(semihosting, semihosting->stdin_fd, 0, 1);
+				break;
+			}
 			semihosting->result = semihosting_getchar(semihosting, semihosting->stdin_fd);
 			LOG_DEBUG("getchar()=%" PRId64, semihosting->result);
 			break;
@@ -1453,14 +1622,17 @@ int semihosting_common(struct target *target)
 			if (semihosting->is_fileio) {
 				size_t count = 0;
 				uint64_t addr = semihosting->param;
-				for (;; addr++) {
-					unsigned char c;
-					retval = target_read_memory(target, addr, 1, 1, &c);
+				for (;;) {
+					uint8_t chunk[SEMIHOSTING_STRING_CHUNK];
+					size_t chunk_len;
+					retval = semihosting_read_string_chunk(target, addr, chunk, &chunk_len);
 					if (retval != ERROR_OK)
 						return retval;
-					if (c == '\0')
+					size_t len = strnlen((char *)chunk, chunk_len);
+					count += len;
+					if (len < chunk_len)
 						break;
-					count++;
+					addr += chunk_len;
 				}
 				semihosting->hit_fileio = true;
 				fileio_info->identifier = "write";
@@ -1469,15 +1641,22 @@ int semihosting_common(struct target *target)
 				fileio_info->param_3 = count;
 			} else {
 				uint64_t addr = semihosting->param;
-				do {
-					unsigned char c;
-					retval = target_read_memory(target, addr++, 1, 1, &c);
+				for (;;) {
+					uint8_t chunk[SEMIHOSTING_STRING_CHUNK];
+					size_t chunk_len;
+					retval = semihosting_read_string_chunk(target, addr, chunk, &chunk_len);
 					if (retval != ERROR_OK)
 						return retval;
-					if (!c)
+					size_t len = strnlen((char *)chunk, chunk_len);
+					if (semihosting_is_redirected(semihosting, semihosting->stdout_fd))
+						semihosting_redirect_write(semihosting, chunk, len);
+					else if (!semihosting_console_write(semihosting, semihosting->stdout_fd,
+							chunk, len))
+						fwrite(chunk, 1, len, stdout);
+					if (len < chunk_len)
 						break;
-					semihosting_putchar(semihosting, semihosting->stdout_fd, c);
-				} while (1);
+					addr += chunk_len;
+				}
 				semihosting->result = 0;
 			}
 			break;
@@ -1646,6 +1825,42 @@ int semihosting_common(struct target *target)
 /* -------------------------------------------------------------------------
  * Local functions. */
 
+/**
+ * Read up to @a len bytes from @a fd to the target memory at @a addr and
+ * set the result of SYS_READ.
+ */
+static int semihosting_read_to_target(struct target *target, int fd,
+	uint64_t addr, size_t len)
+{
+	struct semihosting *semihosting = target->semihosting;
+	uint8_t *buf = malloc(len);
+
+	if (!buf) {
+		semihosting->result = -1;
+		semihosting->sys_errno = ENOMEM;
+		return ERROR_OK;
+	}
+
+	semihosting->result = semihosting_read(semihosting, fd, buf, len);
+	LOG_DEBUG("read(%d, 0x%" PRIx64 ", %zu)=%" PRId64,
+		fd,
+		addr,
+		len,
+		semihosting->result);
+	if (semihosting->result >= 0) {
+		int retval = target_write_buffer(target, addr, semihosting->result, buf);
+		if (retval != ERROR_OK) {
+			free(buf);
+			return retval;
+		}
+		/* the number of bytes NOT filled in */
+		semihosting->result = len - semihosting->result;
+	}
+	free(buf);
+
+	return ERROR_OK;
+}
+
 static int semihosting_common_fileio_info(struct target *target,
 	struct gdb_fileio_info *fileio_info)
 {
@@ -1780,6 +1995,14 @@ static int semihosting_service_input_handler(struct connection *connection)
 {
 	struct semihosting_tcp_service *service = connection->service->priv;
 
+	/* the input the target waits for has arrived */
+	if (service->semihosting->read_parked) {
+		int retval = semihosting_resume_parked_read(service->target, false);
+		if (service->error != ERROR_OK)
+			return ERROR_SERVER_REMOTE_CLOSED;
+		return retval;
+	}
+
 	if (!connection->input_pending) {
 		/* consume received data, not for semihosting IO */
 		const int buf_len = 100;
@@ -1802,8 +2025,11 @@ static int semihosting_service_input_handler(struct connection *connection)
 static int semihosting_service_connection_closed_handler(struct connection *connection)
 {
 	struct semihosting_tcp_service *service = connection->service->priv;
-	if (service)
+	if (service) {
+		if (service->semihosting->read_parked)
+			semihosting_resume_parked_read(service->target, true);
 		free(service->name);
+	}
 
 	return ERROR_OK;
 }
@@ -1826,6 +2052,7 @@ static const struct service_driver semihosting_service_driver = {
 	.input_handler = semihosting_service_input_handler,
 	.connection_closed_handler = semihosting_service_connection_closed_handler,
 	.keep_client_alive_handler = NULL,
+	.flush_output_handler = NULL,
 };
 
 /* -------------------------------------------------------------------------
@@ -1933,6 +2160,7 @@ COMMAND_HANDLER(handle_common_semihosting_redirect_command)
 		}
 
 		service->semihosting = semihosting;
+		service->target = target;
 
 		service->name = alloc_printf("%s semihosting service", target_name(target));
 		if (!service->name) {
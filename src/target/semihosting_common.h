@@ -75,6 +75,9 @@ enum semihosting_operation_numbers {
 /** Maximum allowed Tcl command segment length in bytes*/
 #define SEMIHOSTING_MAX_TCL_COMMAND_FIELD_LENGTH (1024 * 1024)
 
+/* Size of the host buffer of the console output of the target */
+#define SEMIHOSTING_CONSOLE_BUFFER_SIZE 4096
+
 /*
  * Codes used by SEMIHOSTING_SYS_EXIT (formerly
  * SEMIHOSTING_REPORT_EXCEPTION).
@@ -126,6 +129,18 @@ struct semihosting {
 	/** A flag reporting whether semihosting fileio operation is active. */
 	bool hit_fileio;
 
+	/**
+	 * Whether the architecture leaves the target halted without reporting
+	 * it while a read waits for input, see semihosting_is_parked().
+	 */
+	bool can_park;
+
+	/** A SYS_READ or SYS_READC waits for input from the TCP redirection */
+	bool read_parked;
+	int parked_fd;
+	uint64_t parked_addr;
+	size_t parked_len;
+
 	/** Most are resumable, except the two exit calls. */
 	bool is_resumable;
 
@@ -186,6 +201,17 @@ struct semihosting {
 
 	int (*setup)(struct target *target, int enable);
 	int (*post_result)(struct target *target);
+
+	/**
+	 * Console output of the target not written yet. It is written after
+	 * the target resumed, or before any other semihosting operation.
+	 */
+	uint8_t console_buffer[SEMIHOSTING_CONSOLE_BUFFER_SIZE];
+	size_t console_length;
+	/** File descriptor of the buffered console output */
+	int console_fd;
+	/** Whether a timer callback is registered to write the console output */
+	bool console_flush_pending;
 };
 
 /**
@@ -197,6 +223,8 @@ const char *semihosting_opcode_to_str(uint64_t opcode);
 
 int semihosting_common_init(struct target *target, void *setup,
 	void *post_result);
+void semihosting_console_flush(struct semihosting *semihosting);
+int semihosting_cancel_parked_read(struct target *target);
 int semihosting_common(struct target *target);
 
 /* utility functions which may also be used by semihosting extensions (custom vendor-defined syscalls) */
@@ -11,6 +11,7 @@
 #endif
 
 #include <helper/log.h>
+#include <helper/time_support.h>
 #include "target.h"
 #include "target_type.h"
 #include "hello.h"
@@ -106,6 +107,10 @@ static const struct {
 #define FLASH_DUKR_STM8L 0x5053
 #define FLASH_IAPSR_STM8L 0x5054
 
+/* typical and worst case programming time of a block, word or byte */
+#define STM8_PROG_TIME_US		3000
+#define STM8_PROG_TIMEOUT_MS	100
+
 /* FLASH_IAPSR */
 #define HVOFF 0x40
 #define DUL 0x08
@@ -644,6 +649,50 @@ static int stm8_unlock_eeprom(struct target *target)
 	return ERROR_OK;
 }
 
+/* select the programming mode in FLASH_CR2 and its complement FLASH_NCR2 */
+static int stm8_set_prog_mode(struct target *target, uint8_t mode)
+{
+	struct stm8_common *stm8 = target_to_stm8(target);
+	int res = ERROR_OK;
+
+	/* adjacent on STM8S, one WOTF sets both */
+	if (stm8->flash_cr2 && stm8->flash_ncr2 == stm8->flash_cr2 + 1) {
+		uint8_t buf[2] = { mode, ~mode };
+		return stm8_adapter_write_memory(target, stm8->flash_cr2, 1, 2, buf);
+	}
+
+	if (stm8->flash_cr2)
+		res = stm8_write_u8(target, stm8->flash_cr2, mode);
+	if (res == ERROR_OK && stm8->flash_ncr2)
+		res = stm8_write_u8(target, stm8->flash_ncr2, ~mode);
+
+	return res;
+}
+
+/* lets hang here until end of program (EOP) */
+static int stm8_wait_eop(struct target *target)
+{
+	struct stm8_common *stm8 = target_to_stm8(target);
+	uint8_t iapsr;
+
+	/* no EOP can be seen before the shortest programming time */
+	usleep(STM8_PROG_TIME_US);
+
+	int64_t then = timeval_ms();
+	while (1) {
+		int res = stm8_read_u8(target, stm8->flash_iapsr, &iapsr);
+		if (res != ERROR_OK)
+			return res;
+		if (iapsr & EOP)
+			return ERROR_OK;
+		if (timeval_ms() - then > STM8_PROG_TIMEOUT_MS) {
+			LOG_ERROR("timeout waiting for the end of programming");
+			return ERROR_FAIL;
+		}
+		usleep(1000);
+	}
+}
+
 static int stm8_write_flash(struct target *target, enum mem_type type,
 		uint32_t address,
 		uint32_t size, uint32_t count, uint32_t blocksize_param,
@@ -651,12 +700,11 @@ static int stm8_write_flash(struct target *target, enum mem_type type,
 {
 	struct stm8_common *stm8 = target_to_stm8(target);
 
-	uint8_t iapsr;
 	uint8_t opt = 0;
-	unsigned int i;
-	uint32_t blocksize = 0;
+	uint8_t *block = NULL;
+	bool byte_mode = false;
 	uint32_t bytecnt;
-	int res;
+	int res = ERROR_OK;
 
 	switch (type) {
 		case (FLASH):
@@ -683,47 +731,64 @@ static int stm8_write_flash(struct target *target, enum mem_type type,
 	bytecnt = count * size;
 
 	while (bytecnt) {
-		if ((bytecnt >= blocksize_param) && ((address & (blocksize_param-1)) == 0)) {
-			if (stm8->flash_cr2)
-				stm8_write_u8(target, stm8->flash_cr2, PRG + opt);
-			if (stm8->flash_ncr2)
-				stm8_write_u8(target, stm8->flash_ncr2, ~(PRG + opt));
+		uint32_t offset = blocksize_param ? (address & (blocksize_param - 1)) : 0;
+		uint32_t len = blocksize_param ? MIN(blocksize_param - offset, bytecnt) : 0;
+		uint32_t prog_address = address;
+		const uint8_t *data = buffer;
+		uint32_t blocksize;
+
+		if (len == blocksize_param && len) {
+			res = stm8_set_prog_mode(target, PRG + opt);
+			blocksize = len;
+		} else if (len > 4) {
+			/*
+			 * A partial block would take several word or byte
+			 * programming cycles, program the whole block instead
+			 * with the rest of its current content.
+			 */
+			if (!block) {
+				block = malloc(blocksize_param);
+				if (!block) {
+					LOG_ERROR("Out of memory");
+					return ERROR_FAIL;
+				}
+			}
+			prog_address = address - offset;
+			res = stm8_adapter_read_memory(target, prog_address, 1,
+					blocksize_param, block);
+			if (res == ERROR_OK)
+				res = stm8_set_prog_mode(target, PRG + opt);
+			memcpy(block + offset, buffer, len);
+			data = block;
 			blocksize = blocksize_param;
-		} else
-		if ((bytecnt >= 4) && ((address & 0x3) == 0)) {
-			if (stm8->flash_cr2)
-				stm8_write_u8(target, stm8->flash_cr2, WPRG + opt);
-			if (stm8->flash_ncr2)
-				stm8_write_u8(target, stm8->flash_ncr2, ~(WPRG + opt));
+		} else if ((bytecnt >= 4) && ((address & 0x3) == 0)) {
+			res = stm8_set_prog_mode(target, WPRG + opt);
+			len = 4;
 			blocksize = 4;
-		} else
-		if (blocksize != 1) {
-			if (stm8->flash_cr2)
-				stm8_write_u8(target, stm8->flash_cr2, opt);
-			if (stm8->flash_ncr2)
-				stm8_write_u8(target, stm8->flash_ncr2, ~opt);
+		} else {
+			if (!byte_mode)
+				res = stm8_set_prog_mode(target, opt);
+			len = 1;
 			blocksize = 1;
 		}
+		byte_mode = (blocksize == 1);
 
-		res = stm8_adapter_write_memory(target, address, 1, blocksize, buffer);
+		if (res == ERROR_OK)
+			res = stm8_adapter_write_memory(target, prog_address, 1, blocksize, data);
+		if (res == ERROR_OK)
+			res = stm8_wait_eop(target);
 		if (res != ERROR_OK)
-			return res;
-		address += blocksize;
-		buffer += blocksize;
-		bytecnt -= blocksize;
-
-		/* lets hang here until end of program (EOP) */
-		for (i = 0; i < 16; i++) {
-			stm8_read_u8(target, stm8->flash_iapsr, &iapsr);
-			if (iapsr & EOP)
-				break;
-			else
-				usleep(1000);
-		}
-		if (i == 16)
-			return ERROR_FAIL;
+			break;
+
+		address += len;
+		buffer += len;
+		bytecnt -= len;
 	}
 
+	free(block);
+	if (res != ERROR_OK)
+		return res;
+
 	/* disable write access */
 	res = stm8_write_u8(target, stm8->flash_iapsr, 0x0);
 
@@ -31,6 +31,8 @@
 #endif
 
 #include <helper/align.h>
+#include <helper/crc32.h>
+#include <helper/event_log.h>
 #include <helper/nvp.h>
 #include <helper/time_support.h>
 #include <jtag/jtag.h>
@@ -48,6 +50,7 @@
 #include "arm_cti.h"
 #include "smp.h"
 #include "semihosting_common.h"
+#include <server/gdb_server.h>
 
 /* default halt wait timeout (ms) */
 #define DEFAULT_HALT_TIMEOUT 5000
@@ -61,6 +64,10 @@ static int target_get_gdb_fileio_info_default(struct target *target,
 		struct gdb_fileio_info *fileio_info);
 static int target_gdb_fileio_end_default(struct target *target, int retcode,
 		int fileio_errno, bool ctrl_c);
+static void target_forget_resident_areas(struct target *target,
+		target_addr_t address, uint32_t size);
+static void target_memory_changed(struct target *target,
+		target_addr_t address, uint32_t size);
 
 static struct target_type *target_types[] = {
 	&arm7tdmi_target,
@@ -111,6 +118,8 @@ static int64_t target_timer_next_event_value;
 static LIST_HEAD(target_reset_callback_list);
 static LIST_HEAD(target_trace_callback_list);
 static const int polling_interval = TARGET_DEFAULT_POLLING_INTERVAL;
+/* background polling interval of running targets while no GDB is connected, 0 to disable */
+static unsigned int poll_idle_interval;
 static LIST_HEAD(empty_smp_targets);
 
 enum nvp_assert {
@@ -513,6 +522,10 @@ int target_halt(struct target *target)
 		return ERROR_FAIL;
 	}
 
+	/* halted already, waiting for semihosting input */
+	if (target->semihosting && target->semihosting->read_parked)
+		return semihosting_cancel_parked_read(target);
+
 	retval = target->type->halt(target);
 	if (retval != ERROR_OK)
 		return retval;
@@ -789,10 +802,12 @@ int target_run_algorithm(struct target *target,
 	}
 
 	target->running_alg = true;
+	event_log_begin(EVENT_LOG_ALGORITHM, entry_point);
 	retval = target->type->run_algorithm(target,
 			num_mem_params, mem_params,
 			num_reg_params, reg_param,
 			entry_point, exit_point, timeout_ms, arch_info);
+	event_log_end(EVENT_LOG_ALGORITHM, retval);
 	target->running_alg = false;
 
 done:
@@ -885,13 +900,15 @@ done:
 }
 
 /**
- * Streams data to a circular buffer on target intended for consumption by code
- * running asynchronously on target.
+ * Streams data through a circular buffer on target shared with code running
+ * asynchronously on target, in the direction given by @a dir.
  *
- * This is intended for applications where target-specific native code runs
- * on the target, receives data from the circular buffer, does something with
- * it (most likely writing it to a flash memory), and advances the circular
- * buffer pointer.
+ * The target code either consumes the data placed in the buffer by the host
+ * (e.g. to write it to a flash memory) and advances the read pointer, or
+ * produces data in the buffer (e.g. read from a flash memory) and advances
+ * the write pointer. Each time a contiguous part of the buffer can be used,
+ * @a xfer is called to fill or drain it, so the data may be generated or
+ * processed on the host while the target code runs.
  *
  * This assumes that the helper algorithm has already been loaded to the target,
  * but has not been started yet. Given memory and register parameters are passed
@@ -901,19 +918,22 @@ done:
  * following format:
  *
  *     [buffer_start + 0, buffer_start + 4):
- *         Write Pointer address (aka head). Written and updated by this
- *         routine when new data is written to the circular buffer.
+ *         Write Pointer address (aka head). Updated by the producer after
+ *         it writes new data to the circular buffer.
  *     [buffer_start + 4, buffer_start + 8):
- *         Read Pointer address (aka tail). Updated by code running on the
- *         target after it consumes data.
+ *         Read Pointer address (aka tail). Updated by the consumer after
+ *         it consumes data.
  *     [buffer_start + 8, buffer_start + buffer_size):
  *         Circular buffer contents.
  *
+ * Either side aborts the transfer by setting its own pointer to 0.
  * See contrib/loaders/flash/stm32f1x.S for an example.
  *
  * @param target used to run the algorithm
- * @param buffer address on the host where data to be sent is located
- * @param count number of blocks to send
+ * @param dir whether the host is the producer or the consumer of the data
+ * @param xfer called to move data between the host and the circular buffer
+ * @param priv passed to @a xfer
+ * @param count number of blocks to transfer
  * @param block_size size in bytes of each block
  * @param num_mem_params count of memory-based params to pass to algorithm
  * @param mem_params memory-based params to pass to algorithm
@@ -926,9 +946,9 @@ done:
  *     end of the algorithm; can be 0 if target triggers a breakpoint itself
  * @param arch_info
  */
-
-int target_run_flash_async_algorithm(struct target *target,
-		const uint8_t *buffer, uint32_t count, int block_size,
+int target_run_async_algorithm(struct target *target,
+		enum target_async_dir dir, target_async_xfer_fn xfer, void *priv,
+		uint32_t count, int block_size,
 		int num_mem_params, struct mem_param *mem_params,
 		int num_reg_params, struct reg_param *reg_params,
 		uint32_t buffer_start, uint32_t buffer_size,
@@ -936,8 +956,10 @@ int target_run_flash_async_algorithm(struct target *target,
 {
 	int retval;
 	int timeout = 0;
+	uint32_t offset = 0;
 
-	const uint8_t *buffer_orig = buffer;
+	const bool to_target = dir == TARGET_ASYNC_TO_TARGET;
+	const char *op = to_target ? "write" : "read";
 
 	/* Set up working area. First word is write pointer, second word is read pointer,
 	 * rest is fifo data area. */
@@ -949,6 +971,12 @@ int target_run_flash_async_algorithm(struct target *target,
 	uint32_t wp = fifo_start_addr;
 	uint32_t rp = fifo_start_addr;
 
+	/* The host updates one pointer, the target code the other one */
+	uint32_t host_ptr_addr = to_target ? wp_addr : rp_addr;
+	uint32_t target_ptr_addr = to_target ? rp_addr : wp_addr;
+	uint32_t *host_ptr = to_target ? &wp : &rp;
+	uint32_t *target_ptr = to_target ? &rp : &wp;
+
 	/* validate block_size is 2^n */
 	assert(IS_PWR_OF_2(block_size));
 
@@ -967,46 +995,55 @@ int target_run_flash_async_algorithm(struct target *target,
 			arch_info);
 
 	if (retval != ERROR_OK) {
-		LOG_ERROR("error starting target flash write algorithm");
+		LOG_ERROR("error starting target flash %s algorithm", op);
 		return retval;
 	}
 
 	while (count > 0) {
-
-		retval = target_read_u32(target, rp_addr, &rp);
+		retval = target_read_u32(target, target_ptr_addr, target_ptr);
 		if (retval != ERROR_OK) {
-			LOG_ERROR("failed to get read pointer");
+			LOG_ERROR("failed to get %s pointer", to_target ? "read" : "write");
 			break;
 		}
 
-		LOG_DEBUG("offs 0x%zx count 0x%" PRIx32 " wp 0x%" PRIx32 " rp 0x%" PRIx32,
-			(size_t) (buffer - buffer_orig), count, wp, rp);
+		LOG_DEBUG("offs 0x%" PRIx32 " count 0x%" PRIx32 " wp 0x%" PRIx32 " rp 0x%" PRIx32,
+			offset, count, wp, rp);
 
-		if (rp == 0) {
-			LOG_ERROR("flash write algorithm aborted by target");
+		if (*target_ptr == 0) {
+			LOG_ERROR("flash %s algorithm aborted by target", op);
 			retval = ERROR_FLASH_OPERATION_FAILED;
 			break;
 		}
 
-		if (!IS_ALIGNED(rp - fifo_start_addr, block_size) || rp < fifo_start_addr || rp >= fifo_end_addr) {
-			LOG_ERROR("corrupted fifo read pointer 0x%" PRIx32, rp);
+		if (!IS_ALIGNED(*target_ptr - fifo_start_addr, block_size) ||
+				*target_ptr < fifo_start_addr || *target_ptr >= fifo_end_addr) {
+			LOG_ERROR("corrupted fifo %s pointer 0x%" PRIx32,
+				to_target ? "read" : "write", *target_ptr);
 			break;
 		}
 
 		/* Count the number of bytes available in the fifo without
-		 * crossing the wrap around. Make sure to not fill it completely,
-		 * because that would make wp == rp and that's the empty condition. */
+		 * crossing the wrap around. When writing, make sure to not fill it
+		 * completely, because that would make wp == rp and that's the empty
+		 * condition. */
 		uint32_t thisrun_bytes;
-		if (rp > wp)
-			thisrun_bytes = rp - wp - block_size;
-		else if (rp > fifo_start_addr)
-			thisrun_bytes = fifo_end_addr - wp;
-		else
-			thisrun_bytes = fifo_end_addr - wp - block_size;
+		if (to_target) {
+			if (rp > wp)
+				thisrun_bytes = rp - wp - block_size;
+			else if (rp > fifo_start_addr)
+				thisrun_bytes = fifo_end_addr - wp;
+			else
+				thisrun_bytes = fifo_end_addr - wp - block_size;
+		} else {
+			if (wp >= rp)
+				thisrun_bytes = wp - rp;
+			else
+				thisrun_bytes = fifo_end_addr - rp;
+		}
 
 		if (thisrun_bytes == 0) {
-			/* Throttle polling a bit if transfer is (much) faster than flash
-			 * programming. The exact delay shouldn't matter as long as it's
+			/* Throttle polling a bit if transfer is (much) faster than the
+			 * target code. The exact delay shouldn't matter as long as it's
 			 * less than buffer size / flash speed. This is very unlikely to
 			 * run when using high latency connections such as USB. */
 			alive_sleep(2);
@@ -1023,7 +1060,7 @@ int target_run_flash_async_algorithm(struct target *target,
 		/* reset our timeout */
 		timeout = 0;
 
-		/* Limit to the amount of data we actually want to write */
+		/* Limit to the amount of data we actually want to transfer */
 		if (thisrun_bytes > count * block_size)
 			thisrun_bytes = count * block_size;
 
@@ -1031,30 +1068,35 @@ int target_run_flash_async_algorithm(struct target *target,
 		if (thisrun_bytes >= 16)
 			thisrun_bytes -= (rp + thisrun_bytes) & 0x03;
 
-		/* Write data to fifo */
-		retval = target_write_buffer(target, wp, thisrun_bytes, buffer);
+		/* Move data through the fifo */
+		retval = xfer(target, *host_ptr, thisrun_bytes, priv);
 		if (retval != ERROR_OK)
 			break;
 
-		/* Update counters and wrap write pointer */
-		buffer += thisrun_bytes;
+		/* Update counters and wrap our pointer */
+		offset += thisrun_bytes;
 		count -= thisrun_bytes / block_size;
-		wp += thisrun_bytes;
-		if (wp >= fifo_end_addr)
-			wp = fifo_start_addr;
+		*host_ptr += thisrun_bytes;
+		if (*host_ptr >= fifo_end_addr)
+			*host_ptr = fifo_start_addr;
 
-		/* Store updated write pointer to target */
-		retval = target_write_u32(target, wp_addr, wp);
+		/* Store updated pointer to target */
+		retval = target_write_u32(target, host_ptr_addr, *host_ptr);
 		if (retval != ERROR_OK)
 			break;
 
 		/* Avoid GDB timeouts */
 		keep_alive();
+
+		if (!to_target && openocd_is_shutdown_pending()) {
+			retval = ERROR_SERVER_INTERRUPTED;
+			break;
+		}
 	}
 
 	if (retval != ERROR_OK) {
-		/* abort flash write algorithm on target */
-		target_write_u32(target, wp_addr, 0);
+		/* abort algorithm on target */
+		target_write_u32(target, host_ptr_addr, 0);
 	}
 
 	int retval2 = target_wait_algorithm(target, num_mem_params, mem_params,
@@ -1064,15 +1106,15 @@ int target_run_flash_async_algorithm(struct target *target,
 			arch_info);
 
 	if (retval2 != ERROR_OK) {
-		LOG_ERROR("error waiting for target flash write algorithm");
+		LOG_ERROR("error waiting for target flash %s algorithm", op);
 		retval = retval2;
 	}
 
 	if (retval == ERROR_OK) {
-		/* check if algorithm set rp = 0 after fifo writer loop finished */
-		retval = target_read_u32(target, rp_addr, &rp);
-		if (retval == ERROR_OK && rp == 0) {
-			LOG_ERROR("flash write algorithm aborted by target");
+		/* check if algorithm cleared its pointer after fifo loop finished */
+		retval = target_read_u32(target, target_ptr_addr, target_ptr);
+		if (retval == ERROR_OK && *target_ptr == 0) {
+			LOG_ERROR("flash %s algorithm aborted by target", op);
 			retval = ERROR_FLASH_OPERATION_FAILED;
 		}
 	}
@@ -1080,6 +1122,50 @@ int target_run_flash_async_algorithm(struct target *target,
 	return retval;
 }
 
+static int target_async_write_from_buffer(struct target *target,
+		target_addr_t address, uint32_t size, void *priv)
+{
+	const uint8_t **buffer = priv;
+
+	int retval = target_write_buffer(target, address, size, *buffer);
+	*buffer += size;
+	return retval;
+}
+
+static int target_async_read_to_buffer(struct target *target,
+		target_addr_t address, uint32_t size, void *priv)
+{
+	uint8_t **buffer = priv;
+
+	int retval = target_read_buffer(target, address, size, *buffer);
+	*buffer += size;
+	return retval;
+}
+
+/**
+ * Streams @a count blocks of @a buffer to code running on target,
+ * see target_run_async_algorithm().
+ */
+int target_run_flash_async_algorithm(struct target *target,
+		const uint8_t *buffer, uint32_t count, int block_size,
+		int num_mem_params, struct mem_param *mem_params,
+		int num_reg_params, struct reg_param *reg_params,
+		uint32_t buffer_start, uint32_t buffer_size,
+		uint32_t entry_point, uint32_t exit_point, void *arch_info)
+{
+	event_log_begin(EVENT_LOG_ALGORITHM, entry_point);
+	int retval = target_run_async_algorithm(target, TARGET_ASYNC_TO_TARGET,
+			target_async_write_from_buffer, &buffer, count, block_size,
+			num_mem_params, mem_params, num_reg_params, reg_params,
+			buffer_start, buffer_size, entry_point, exit_point, arch_info);
+	event_log_end(EVENT_LOG_ALGORITHM, retval);
+	return retval;
+}
+
+/**
+ * Streams @a count blocks produced by code running on target to @a buffer,
+ * see target_run_async_algorithm().
+ */
 int target_run_read_async_algorithm(struct target *target,
 		uint8_t *buffer, uint32_t count, int block_size,
 		int num_mem_params, struct mem_param *mem_params,
@@ -1087,150 +1173,12 @@ int target_run_read_async_algorithm(struct target *target,
 		uint32_t buffer_start, uint32_t buffer_size,
 		uint32_t entry_point, uint32_t exit_point, void *arch_info)
 {
-	int retval;
-	int timeout = 0;
-
-	const uint8_t *buffer_orig = buffer;
-
-	/* Set up working area. First word is write pointer, second word is read pointer,
-	 * rest is fifo data area. */
-	uint32_t wp_addr = buffer_start;
-	uint32_t rp_addr = buffer_start + 4;
-	uint32_t fifo_start_addr = buffer_start + 8;
-	uint32_t fifo_end_addr = buffer_start + buffer_size;
-
-	uint32_t wp = fifo_start_addr;
-	uint32_t rp = fifo_start_addr;
-
-	/* validate block_size is 2^n */
-	assert(IS_PWR_OF_2(block_size));
-
-	retval = target_write_u32(target, wp_addr, wp);
-	if (retval != ERROR_OK)
-		return retval;
-	retval = target_write_u32(target, rp_addr, rp);
-	if (retval != ERROR_OK)
-		return retval;
-
-	/* Start up algorithm on target */
-	retval = target_start_algorithm(target, num_mem_params, mem_params,
-			num_reg_params, reg_params,
-			entry_point,
-			exit_point,
-			arch_info);
-
-	if (retval != ERROR_OK) {
-		LOG_ERROR("error starting target flash read algorithm");
-		return retval;
-	}
-
-	while (count > 0) {
-		retval = target_read_u32(target, wp_addr, &wp);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("failed to get write pointer");
-			break;
-		}
-
-		LOG_DEBUG("offs 0x%zx count 0x%" PRIx32 " wp 0x%" PRIx32 " rp 0x%" PRIx32,
-			(size_t)(buffer - buffer_orig), count, wp, rp);
-
-		if (wp == 0) {
-			LOG_ERROR("flash read algorithm aborted by target");
-			retval = ERROR_FLASH_OPERATION_FAILED;
-			break;
-		}
-
-		if (!IS_ALIGNED(wp - fifo_start_addr, block_size) || wp < fifo_start_addr || wp >= fifo_end_addr) {
-			LOG_ERROR("corrupted fifo write pointer 0x%" PRIx32, wp);
-			break;
-		}
-
-		/* Count the number of bytes available in the fifo without
-		 * crossing the wrap around. */
-		uint32_t thisrun_bytes;
-		if (wp >= rp)
-			thisrun_bytes = wp - rp;
-		else
-			thisrun_bytes = fifo_end_addr - rp;
-
-		if (thisrun_bytes == 0) {
-			/* Throttle polling a bit if transfer is (much) faster than flash
-			 * reading. The exact delay shouldn't matter as long as it's
-			 * less than buffer size / flash speed. This is very unlikely to
-			 * run when using high latency connections such as USB. */
-			alive_sleep(2);
-
-			/* to stop an infinite loop on some targets check and increment a timeout
-			 * this issue was observed on a stellaris using the new ICDI interface */
-			if (timeout++ >= 2500) {
-				LOG_ERROR("timeout waiting for algorithm, a target reset is recommended");
-				return ERROR_FLASH_OPERATION_FAILED;
-			}
-			continue;
-		}
-
-		/* Reset our timeout */
-		timeout = 0;
-
-		/* Limit to the amount of data we actually want to read */
-		if (thisrun_bytes > count * block_size)
-			thisrun_bytes = count * block_size;
-
-		/* Force end of large blocks to be word aligned */
-		if (thisrun_bytes >= 16)
-			thisrun_bytes -= (rp + thisrun_bytes) & 0x03;
-
-		/* Read data from fifo */
-		retval = target_read_buffer(target, rp, thisrun_bytes, buffer);
-		if (retval != ERROR_OK)
-			break;
-
-		/* Update counters and wrap write pointer */
-		buffer += thisrun_bytes;
-		count -= thisrun_bytes / block_size;
-		rp += thisrun_bytes;
-		if (rp >= fifo_end_addr)
-			rp = fifo_start_addr;
-
-		/* Store updated write pointer to target */
-		retval = target_write_u32(target, rp_addr, rp);
-		if (retval != ERROR_OK)
-			break;
-
-		/* Avoid GDB timeouts */
-		keep_alive();
-
-		if (openocd_is_shutdown_pending()) {
-			retval = ERROR_SERVER_INTERRUPTED;
-			break;
-		}
-	}
-
-	if (retval != ERROR_OK) {
-		/* abort flash write algorithm on target */
-		target_write_u32(target, rp_addr, 0);
-	}
-
-	int retval2 = target_wait_algorithm(target, num_mem_params, mem_params,
-			num_reg_params, reg_params,
-			exit_point,
-			10000,
-			arch_info);
-
-	if (retval2 != ERROR_OK) {
-		LOG_ERROR("error waiting for target flash write algorithm");
-		retval = retval2;
-	}
-
-	if (retval == ERROR_OK) {
-		/* check if algorithm set wp = 0 after fifo writer loop finished */
-		retval = target_read_u32(target, wp_addr, &wp);
-		if (retval == ERROR_OK && wp == 0) {
-			LOG_ERROR("flash read algorithm aborted by target");
-			retval = ERROR_FLASH_OPERATION_FAILED;
-		}
-	}
-
+	event_log_begin(EVENT_LOG_ALGORITHM, entry_point);
+	int retval = target_run_async_algorithm(target, TARGET_ASYNC_FROM_TARGET,
+			target_async_read_to_buffer, &buffer, count, block_size,
+			num_mem_params, mem_params, num_reg_params, reg_params,
+			buffer_start, buffer_size, entry_point, exit_point, arch_info);
+	event_log_end(EVENT_LOG_ALGORITHM, retval);
 	return retval;
 }
 
@@ -1273,6 +1221,7 @@ int target_write_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support write_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	target_memory_changed(target, address, size * count);
 	return target->type->write_memory(target, address, size, count, buffer);
 }
 
@@ -1287,9 +1236,71 @@ int target_write_phys_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support write_phys_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	/* the resident code is tracked by virtual address */
+	target_memory_changed(target, 0, 0);
 	return target->type->write_phys_memory(target, address, size, count, buffer);
 }
 
+int target_read_memory_sg(struct target *target,
+		struct target_memory_sg *ranges, unsigned int num_ranges)
+{
+	if (!target_was_examined(target)) {
+		LOG_ERROR("Target not examined yet");
+		return ERROR_FAIL;
+	}
+	if (target->type->read_memory_sg)
+		return target->type->read_memory_sg(target, ranges, num_ranges);
+
+	for (unsigned int i = 0; i < num_ranges; i++) {
+		int retval = target_read_memory(target, ranges[i].address,
+				ranges[i].size, ranges[i].count, ranges[i].buffer);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+	return ERROR_OK;
+}
+
+int target_write_memory_sg(struct target *target,
+		const struct target_memory_sg *ranges, unsigned int num_ranges)
+{
+	if (!target_was_examined(target)) {
+		LOG_ERROR("Target not examined yet");
+		return ERROR_FAIL;
+	}
+	if (target->type->write_memory_sg) {
+		for (unsigned int i = 0; i < num_ranges; i++)
+			target_memory_changed(target, ranges[i].address,
+					ranges[i].size * ranges[i].count);
+		return target->type->write_memory_sg(target, ranges, num_ranges);
+	}
+
+	for (unsigned int i = 0; i < num_ranges; i++) {
+		int retval = target_write_memory(target, ranges[i].address,
+				ranges[i].size, ranges[i].count, ranges[i].buffer);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+	return ERROR_OK;
+}
+
+/**
+ * Fill @a range to access @a size bytes at @a address from or to @a buffer,
+ * with the widest access the alignment allows.
+ */
+void target_memory_sg_range(struct target_memory_sg *range,
+		target_addr_t address, uint32_t size, uint8_t *buffer)
+{
+	uint32_t width = 4;
+
+	while ((address | size) & (width - 1))
+		width >>= 1;
+
+	range->address = address;
+	range->size = width;
+	range->count = size / width;
+	range->buffer = buffer;
+}
+
 int target_add_breakpoint(struct target *target,
 		struct breakpoint *breakpoint)
 {
@@ -1398,6 +1409,16 @@ int target_get_gdb_reg_list_noread(struct target *target,
 	return target_get_gdb_reg_list(target, reg_list, reg_list_size, reg_class);
 }
 
+int target_read_all_core_regs(struct target *target,
+		enum target_register_class reg_class)
+{
+	if (!target->type->read_all_core_regs)
+		return ERROR_NOT_IMPLEMENTED;
+	if (target->state != TARGET_HALTED)
+		return ERROR_TARGET_NOT_HALTED;
+	return target->type->read_all_core_regs(target, reg_class);
+}
+
 bool target_supports_gdb_connection(const struct target *target)
 {
 	/*
@@ -1464,10 +1485,24 @@ unsigned int target_data_bits(struct target *target)
 	return 32;
 }
 
+/* Sample the PC using the target's method, which may decline with
+ * ERROR_NOT_IMPLEMENTED. Unless nonintrusive is set, fall back to halting
+ * and resuming the target in that case. */
 static int target_profiling(struct target *target, uint32_t *samples,
-			uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds)
+			uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds,
+			bool nonintrusive)
 {
-	return target->type->profiling(target, samples, max_num_samples,
+	if (target->type->profiling != target_profiling_default) {
+		int retval = target->type->profiling(target, samples, max_num_samples,
+				num_samples, seconds);
+		if (retval != ERROR_NOT_IMPLEMENTED || nonintrusive)
+			return retval;
+	} else if (nonintrusive) {
+		LOG_TARGET_ERROR(target, "no non-intrusive profiling method");
+		return ERROR_NOT_IMPLEMENTED;
+	}
+
+	return target_profiling_default(target, samples, max_num_samples,
 			num_samples, seconds);
 }
 
@@ -1752,7 +1787,8 @@ int target_unregister_timer_callback(int (*callback)(void *priv), void *priv)
 
 	for (struct target_timer_callback *c = target_timer_callbacks;
 	     c; c = c->next) {
-		if ((c->callback == callback) && (c->priv == priv)) {
+		/* skip entries already cancelled but not yet freed */
+		if (!c->removed && (c->callback == callback) && (c->priv == priv)) {
 			c->removed = true;
 			return ERROR_OK;
 		}
@@ -1774,6 +1810,18 @@ int target_call_event_callbacks(struct target *target, enum target_event event)
 	LOG_DEBUG("target event %i (%s) for core %s", event,
 			target_event_name(event),
 			target_name(target));
+	event_log_instant(EVENT_LOG_TARGET_EVENT, event);
+
+	/* The target code may have overwritten any loader left in its RAM */
+	if (event == TARGET_EVENT_HALTED || event == TARGET_EVENT_RESUMED ||
+			event == TARGET_EVENT_EXAMINE_START)
+		target_forget_resident_areas(target, 0, 0);
+
+	/* Register values fetched before this point may be stale */
+	if (event == TARGET_EVENT_HALTED || event == TARGET_EVENT_DEBUG_HALTED ||
+			event == TARGET_EVENT_RESUMED || event == TARGET_EVENT_DEBUG_RESUMED ||
+			event == TARGET_EVENT_RESET_ASSERT)
+		target->halt_generation++;
 
 	target_handle_event(target, event);
 
@@ -1793,6 +1841,9 @@ int target_call_reset_callbacks(struct target *target, enum target_reset_mode re
 	LOG_DEBUG("target reset %i (%s)", reset_mode,
 			nvp_value2name(nvp_reset_modes, reset_mode)->name);
 
+	for (struct target *t = all_targets; t; t = t->next)
+		target_forget_resident_areas(t, 0, 0);
+
 	list_for_each_entry(callback, &target_reset_callback_list, list)
 		callback->callback(target, reset_mode, callback->priv);
 
@@ -1841,6 +1892,14 @@ static int target_call_timer_callbacks_check_time(int checktime)
 
 	int64_t now = timeval_ms();
 
+	/* Nothing is due before the earliest expiry found by the last walk
+	 * or set by a later registration, avoid walking the list then.
+	 * Cancelled entries are freed by the next walk. */
+	if (checktime && now < target_timer_next_event_value) {
+		callback_processing = false;
+		return ERROR_OK;
+	}
+
 	/* Initialize to a default value that's a ways into the future.
 	 * The loop below will make it closer to now if there are
 	 * callbacks that want to be called sooner. */
@@ -1963,6 +2022,118 @@ static void target_merge_working_areas(struct target *target)
 	}
 }
 
+/* Called before target memory is written through the target API: drops the
+ * resident code overlapping the range (all of it if size is 0) and lets
+ * host side caches notice the write through target->memory_generation */
+static void target_memory_changed(struct target *target,
+		target_addr_t address, uint32_t size)
+{
+	target->memory_generation++;
+	target_forget_resident_areas(target, address, size);
+	flash_shadow_invalidate_range(target, address, size);
+}
+
+/* Save the bytes of the range not saved yet in this hold */
+static int target_hold_backup(struct target *target, target_addr_t address, uint32_t size)
+{
+	if (!size)
+		return ERROR_OK;
+
+	for (struct working_area_backup *b = target->held_backups; b; b = b->next) {
+		if (b->address >= address + size || address >= b->address + b->size)
+			continue;
+
+		/* Only the parts around the saved range are left */
+		int retval = ERROR_OK;
+		if (address < b->address)
+			retval = target_hold_backup(target, address, b->address - address);
+		if (retval == ERROR_OK && b->address + b->size < address + size)
+			retval = target_hold_backup(target, b->address + b->size,
+					address + size - (b->address + b->size));
+		return retval;
+	}
+
+	struct working_area_backup *b = malloc(sizeof(*b));
+	uint8_t *data = malloc(size);
+	if (!b || !data) {
+		free(b);
+		free(data);
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	int retval = target_read_memory(target, address, 4, size / 4, data);
+	if (retval != ERROR_OK) {
+		free(b);
+		free(data);
+		return retval;
+	}
+
+	b->address = address;
+	b->size = size;
+	b->data = data;
+	b->next = target->held_backups;
+	target->held_backups = b;
+
+	return ERROR_OK;
+}
+
+/* Write back and drop the memory saved during the hold */
+static int target_restore_held_backups(struct target *target)
+{
+	int retval = ERROR_OK;
+
+	while (target->held_backups) {
+		struct working_area_backup *b = target->held_backups;
+		target->held_backups = b->next;
+
+		int retval2 = target_write_memory(target, b->address, 4, b->size / 4, b->data);
+		if (retval2 != ERROR_OK) {
+			LOG_ERROR("failed to restore %" PRIu32 " bytes of working area at address " TARGET_ADDR_FMT,
+					b->size, b->address);
+			if (retval == ERROR_OK)
+				retval = retval2;
+		}
+
+		free(b->data);
+		free(b);
+	}
+
+	return retval;
+}
+
+void target_working_area_hold(struct target *target)
+{
+	target->working_area_hold++;
+}
+
+int target_working_area_release(struct target *target)
+{
+	assert(target->working_area_hold);
+
+	if (--target->working_area_hold)
+		return ERROR_OK;
+
+	return target_restore_held_backups(target);
+}
+
+/* Forget the resident code overlapping the given range, all of it if size is 0 */
+static void target_forget_resident_areas(struct target *target,
+		target_addr_t address, uint32_t size)
+{
+	struct working_area_resident **p = &target->resident_areas;
+
+	while (*p) {
+		struct working_area_resident *r = *p;
+		if (!size || (address < r->address + r->size && r->address < address + size)) {
+			*p = r->next;
+			free(r);
+		} else {
+			p = &r->next;
+		}
+	}
+}
+
 int target_alloc_working_area_try(struct target *target, uint32_t size, struct working_area **area)
 {
 	/* Reevaluate working area address based on MMU state*/
@@ -2015,13 +2186,12 @@ int target_alloc_working_area_try(struct target *target, uint32_t size, struct w
 	/* only allocate multiples of 4 byte */
 	size = ALIGN_UP(size, 4);
 
-	struct working_area *c = target->working_areas;
-
-	/* Find the first large enough working area */
-	while (c) {
-		if (c->free && c->size >= size)
-			break;
-		c = c->next;
+	/* Find the smallest large enough working area, leaving the larger
+	 * ones to later allocations such as FIFO buffers */
+	struct working_area *c = NULL;
+	for (struct working_area *i = target->working_areas; i; i = i->next) {
+		if (i->free && i->size >= size && (!c || i->size < c->size))
+			c = i;
 	}
 
 	if (!c)
@@ -2030,10 +2200,21 @@ int target_alloc_working_area_try(struct target *target, uint32_t size, struct w
 	/* Split the working area into the requested size */
 	target_split_working_area(c, size);
 
+	/* The new user may overwrite any code left there */
+	target_forget_resident_areas(target, c->address, c->size);
+
 	LOG_DEBUG("allocated new working area of %" PRIu32 " bytes at address " TARGET_ADDR_FMT,
 			  size, c->address);
 
-	if (target->backup_working_area) {
+	if (target->backup_working_area && target->working_area_hold) {
+		/* Restored when the hold ends, not when this area is freed */
+		free(c->backup);
+		c->backup = NULL;
+
+		int retval = target_hold_backup(target, c->address, c->size);
+		if (retval != ERROR_OK)
+			return retval;
+	} else if (target->backup_working_area) {
 		if (!c->backup) {
 			c->backup = malloc(c->size);
 			if (!c->backup)
@@ -2068,6 +2249,87 @@ int target_alloc_working_area(struct target *target, uint32_t size, struct worki
 
 }
 
+/* Allocate the free working area range starting at address, if any */
+static struct working_area *target_alloc_working_area_at(struct target *target,
+		target_addr_t address, uint32_t size, struct working_area **area)
+{
+	struct working_area *c = target->working_areas;
+
+	while (c && !(c->free && c->address <= address &&
+			address + size <= c->address + c->size))
+		c = c->next;
+
+	if (!c)
+		return NULL;
+
+	if (c->address < address) {
+		target_split_working_area(c, address - c->address);
+		c = c->next;
+		if (!c || c->address != address)
+			return NULL;
+	}
+	target_split_working_area(c, size);
+	if (c->size != size)
+		return NULL;
+
+	c->free = false;
+	*area = c;
+	c->user = area;
+
+	print_wa_layout(target);
+
+	return c;
+}
+
+int target_alloc_working_area_code(struct target *target,
+		const uint8_t *code, uint32_t size, struct working_area **area)
+{
+	/* A backed up area gets restored when freed, the code can't stay */
+	if (target->backup_working_area) {
+		int retval = target_alloc_working_area(target, size, area);
+		if (retval != ERROR_OK)
+			return retval;
+		retval = target_write_buffer(target, (*area)->address, size, code);
+		if (retval != ERROR_OK)
+			target_free_working_area(target, *area);
+		return retval;
+	}
+
+	uint32_t aligned_size = ALIGN_UP(size, 4);
+	uint32_t crc = crc32_le(CRC32_POLY_LE, 0xffffffff, code, size);
+
+	for (struct working_area_resident *r = target->resident_areas; r; r = r->next) {
+		if (r->size != size || r->crc != crc || !target->working_areas)
+			continue;
+		if (target_alloc_working_area_at(target, r->address, aligned_size, area)) {
+			LOG_DEBUG("reusing %" PRIu32 " bytes of code resident at address " TARGET_ADDR_FMT,
+					size, r->address);
+			return ERROR_OK;
+		}
+	}
+
+	int retval = target_alloc_working_area(target, size, area);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = target_write_buffer(target, (*area)->address, size, code);
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, *area);
+		return retval;
+	}
+
+	struct working_area_resident *r = malloc(sizeof(*r));
+	if (r) {
+		r->address = (*area)->address;
+		r->size = size;
+		r->crc = crc;
+		r->next = target->resident_areas;
+		target->resident_areas = r;
+	}
+
+	return ERROR_OK;
+}
+
 static int target_restore_working_area(struct target *target, struct working_area *area)
 {
 	int retval = ERROR_OK;
@@ -2149,8 +2411,13 @@ static void target_free_all_working_areas_restore(struct target *target, int res
 
 void target_free_all_working_areas(struct target *target)
 {
+	/* The target is about to run, it must find its memory back */
+	target_restore_held_backups(target);
 	target_free_all_working_areas_restore(target, 1);
 
+	/* Called when the target resumes or the working area is reconfigured */
+	target_forget_resident_areas(target, 0, 0);
+
 	/* Now we have none or only one working area marked as free */
 	if (target->working_areas) {
 		/* Free the last one to allow on-the-fly moving and resizing */
@@ -2183,12 +2450,15 @@ static void target_destroy(struct target *target)
 {
 	breakpoint_remove_all(target);
 	watchpoint_remove_all(target);
+	breakpoint_index_reset(target);
 
 	if (target->type->deinit_target)
 		target->type->deinit_target(target);
 
-	if (target->semihosting)
+	if (target->semihosting) {
+		semihosting_console_flush(target->semihosting);
 		free(target->semihosting->basedir);
+	}
 	free(target->semihosting);
 
 	jtag_unregister_event_callback(jtag_enable_callback, target);
@@ -2201,6 +2471,7 @@ static void target_destroy(struct target *target)
 		teap = next;
 	}
 
+	target_request_ring_free(target);
 	target_free_all_working_areas(target);
 
 	/* release the targets SMP list */
@@ -2220,6 +2491,7 @@ static void target_destroy(struct target *target)
 	rtos_destroy(target);
 
 	free(target->gdb_port_override);
+	free(target->rtos_elf);
 	free(target->type);
 	free(target->trace_info);
 	free(target->fileio_info);
@@ -2360,9 +2632,29 @@ int target_write_buffer(struct target *target, target_addr_t address, uint32_t s
 		return ERROR_FAIL;
 	}
 
+	target_memory_changed(target, address, size);
 	return target->type->write_buffer(target, address, size, buffer);
 }
 
+int target_write_buffer_compressed(struct target *target,
+		target_addr_t address, uint32_t size, const uint8_t *buffer)
+{
+	if (!target_was_examined(target)) {
+		LOG_ERROR("Target not examined yet");
+		return ERROR_FAIL;
+	}
+
+	if (target->type->write_buffer_compressed && target->state == TARGET_HALTED) {
+		target_memory_changed(target, address, size);
+		int retval = target->type->write_buffer_compressed(target, address, size, buffer);
+		if (retval != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+			return retval;
+		LOG_DEBUG("no working area for compressed write, writing as is");
+	}
+
+	return target_write_buffer(target, address, size, buffer);
+}
+
 static int target_write_buffer_default(struct target *target,
 	target_addr_t address, uint32_t count, const uint8_t *buffer)
 {
@@ -2464,11 +2756,12 @@ static int target_read_buffer_default(struct target *target, target_addr_t addre
 	return ERROR_OK;
 }
 
+/* Size of the blocks read for the host side checksum fallback */
+#define CHECKSUM_READ_CHUNK_SIZE	(64 * 1024)
+
 int target_checksum_memory(struct target *target, target_addr_t address, uint32_t size, uint32_t *crc)
 {
-	uint8_t *buffer;
 	int retval;
-	uint32_t i;
 	uint32_t checksum = 0;
 	if (!target_was_examined(target)) {
 		LOG_ERROR("Target not examined yet");
@@ -2481,26 +2774,25 @@ int target_checksum_memory(struct target *target, target_addr_t address, uint32_
 
 	retval = target->type->checksum_memory(target, address, size, &checksum);
 	if (retval != ERROR_OK) {
-		buffer = malloc(size);
+		/* Read the memory and checksum it block by block, so that
+		 * large ranges do not need a buffer of their whole size */
+		uint32_t chunk_size = MIN(size, CHECKSUM_READ_CHUNK_SIZE);
+		uint8_t *buffer = malloc(chunk_size);
 		if (!buffer) {
-			LOG_ERROR("error allocating buffer for section (%" PRIu32 " bytes)", size);
+			LOG_ERROR("error allocating buffer for section (%" PRIu32 " bytes)", chunk_size);
 			return ERROR_COMMAND_SYNTAX_ERROR;
 		}
-		retval = target_read_buffer(target, address, size, buffer);
-		if (retval != ERROR_OK) {
-			free(buffer);
-			return retval;
-		}
 
-		/* convert to target endianness */
-		for (i = 0; i < (size/sizeof(uint32_t)); i++) {
-			uint32_t target_data;
-			target_data = target_buffer_get_u32(target, &buffer[i*sizeof(uint32_t)]);
-			target_buffer_set_u32(target, &buffer[i*sizeof(uint32_t)], target_data);
+		checksum = 0xffffffff;
+		retval = ERROR_OK;
+		for (uint32_t done = 0; done < size && retval == ERROR_OK; done += chunk_size) {
+			uint32_t this_size = MIN(size - done, chunk_size);
+			retval = target_read_buffer(target, address + done, this_size, buffer);
+			if (retval == ERROR_OK)
+				retval = image_calculate_checksum_update(buffer, this_size, &checksum);
 		}
-
-		retval = image_calculate_checksum(buffer, size, &checksum);
 		free(buffer);
+		LOG_DEBUG("Host side checksum 0x%" PRIx32, checksum);
 	}
 
 	*crc = checksum;
@@ -2523,6 +2815,61 @@ int target_blank_check_memory(struct target *target,
 	return target->type->blank_check_memory(target, blocks, num_blocks, erased_value);
 }
 
+int target_search_memory(struct target *target, target_addr_t address,
+		uint32_t size, const uint8_t *pattern, uint32_t length,
+		target_addr_t *match, bool *found)
+{
+	uint8_t buf[1024];
+
+	if (!target_was_examined(target)) {
+		LOG_ERROR("Target not examined yet");
+		return ERROR_FAIL;
+	}
+
+	*found = false;
+
+	if (!length || length > size)
+		return ERROR_OK;
+
+	if (length > sizeof(buf) / 2) {
+		LOG_ERROR("search pattern too long");
+		return ERROR_FAIL;
+	}
+
+	if (target->type->search_memory && target->state == TARGET_HALTED) {
+		int retval = target->type->search_memory(target, address, size,
+			pattern, length, match, found);
+		if (retval == ERROR_OK)
+			return retval;
+		LOG_DEBUG("search on target failed, searching on host");
+	}
+
+	/* Keep the last length - 1 bytes of each block, a match may start there */
+	uint32_t kept = 0;
+	for (uint32_t offset = 0; offset < size; ) {
+		uint32_t chunk = MIN(sizeof(buf) - kept, size - offset);
+		int retval = target_read_buffer(target, address + offset, chunk, buf + kept);
+		if (retval != ERROR_OK)
+			return retval;
+
+		offset += chunk;
+		chunk += kept;
+
+		for (uint32_t i = 0; i + length <= chunk; i++) {
+			if (buf[i] == pattern[0] && !memcmp(buf + i, pattern, length)) {
+				*match = address + offset - chunk + i;
+				*found = true;
+				return ERROR_OK;
+			}
+		}
+
+		kept = MIN(chunk, length - 1);
+		memmove(buf, buf + chunk - kept, kept);
+	}
+
+	return ERROR_OK;
+}
+
 int target_read_u64(struct target *target, target_addr_t address, uint64_t *value)
 {
 	uint8_t value_buf[8];
@@ -2905,6 +3252,35 @@ static int sense_handler(void)
 	return ERROR_OK;
 }
 
+/*
+ * While no GDB is connected, nobody waits for a running target to halt
+ * but background polling still costs a round trip to the adapter on
+ * every tick. Skip polls up to poll_idle_interval.
+ */
+/* Nonzero while handle_target() polls all the targets */
+static unsigned int poll_round;
+static unsigned int poll_round_count;
+
+unsigned int target_poll_round(void)
+{
+	return poll_round;
+}
+
+static bool target_poll_idle_skip(struct target *target)
+{
+	if (!poll_idle_interval || target->state != TARGET_RUNNING
+			|| gdb_get_actual_connections() > 0) {
+		target->idle_poll_count = 0;
+		return false;
+	}
+
+	if (++target->idle_poll_count * polling_interval < poll_idle_interval)
+		return true;
+
+	target->idle_poll_count = 0;
+	return false;
+}
+
 /* process target state changes */
 static int handle_target(void *priv)
 {
@@ -2960,6 +3336,11 @@ static int handle_target(void *priv)
 		recursive = 0;
 	}
 
+	/* never 0, that means no round in progress */
+	if (!++poll_round_count)
+		poll_round_count = 1;
+	poll_round = poll_round_count;
+
 	/* Poll targets for state changes unless that's globally disabled.
 	 * Skip targets that are currently disabled.
 	 */
@@ -2980,6 +3361,9 @@ static int handle_target(void *priv)
 		}
 		target->backoff.count = 0;
 
+		if (target_poll_idle_skip(target))
+			continue;
+
 		/* only poll target if we've got power and srst isn't asserted */
 		if (!power_dropout && !srst_asserted) {
 			/* polling may fail silently until the target has been examined */
@@ -3006,6 +3390,7 @@ static int handle_target(void *priv)
 					target_set_examined(target);
 					LOG_TARGET_ERROR(target, "Examination failed, GDB will be halted. Polling again in %dms",
 						 target->backoff.times * polling_interval);
+					poll_round = 0;
 					return retval;
 				}
 			}
@@ -3014,6 +3399,7 @@ static int handle_target(void *priv)
 			target->backoff.times = 0;
 		}
 	}
+	poll_round = 0;
 
 	return retval;
 }
@@ -3189,6 +3575,18 @@ COMMAND_HANDLER(handle_poll_command)
 	return retval;
 }
 
+COMMAND_HANDLER(handle_poll_idle_interval_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], poll_idle_interval);
+
+	command_print(CMD, "idle polling interval: %u ms", poll_idle_interval);
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_wait_halt_command)
 {
 	if (CMD_ARGC > 1)
@@ -3505,30 +3903,118 @@ static int target_fill_mem(struct target *target,
 		}
 	}
 
-	int retval = ERROR_OK;
+	int retval = ERROR_OK;
+
+	for (unsigned x = 0; x < c; x += chunk_size) {
+		unsigned current;
+		current = c - x;
+		if (current > chunk_size)
+			current = chunk_size;
+		retval = fn(target, address + x * data_size, data_size, current, target_buf);
+		if (retval != ERROR_OK)
+			break;
+		/* avoid GDB timeouts */
+		keep_alive();
+
+		if (openocd_is_shutdown_pending()) {
+			retval = ERROR_SERVER_INTERRUPTED;
+			break;
+		}
+	}
+	free(target_buf);
+
+	return retval;
+}
+
+/* Below this size, loading and running the code costs more than it saves */
+#define TARGET_MEMORY_ALGORITHM_MIN_SIZE	1024
+
+int target_fill_memory(struct target *target, target_addr_t address,
+		unsigned int size, uint64_t value, uint32_t count)
+{
+	uint32_t pattern;
+
+	/* The words written on target repeat one 32 bit pattern */
+	switch (size) {
+	case 1:
+		pattern = (value & 0xff) * 0x01010101;
+		break;
+	case 2:
+		pattern = (value & 0xffff) * 0x00010001;
+		break;
+	case 4:
+		pattern = value;
+		break;
+	default:
+		pattern = value;
+		if ((value >> 32) != pattern)
+			return target_fill_mem(target, address, target_write_memory, size, value, count);
+		break;
+	}
+
+	if (!target->type->fill_memory || target->state != TARGET_HALTED || address % size
+			|| (uint64_t)count * size < TARGET_MEMORY_ALGORITHM_MIN_SIZE)
+		return target_fill_mem(target, address, target_write_memory, size, value, count);
+
+	/* The units before the first aligned word and after the last one are
+	 * written from the host */
+	uint32_t head = (ALIGN_UP(address, 4) - address) / size;
+	uint32_t words = (uint64_t)(count - head) * size / 4;
+	uint32_t tail = head + (uint64_t)words * 4 / size;
+
+	int retval = target->type->fill_memory(target, address + head * size, pattern, words);
+	if (retval != ERROR_OK) {
+		LOG_DEBUG("fill on target failed, writing from host");
+		return target_fill_mem(target, address, target_write_memory, size, value, count);
+	}
+
+	retval = target_fill_mem(target, address, target_write_memory, size, value, head);
+	if (retval != ERROR_OK)
+		return retval;
 
-	for (unsigned x = 0; x < c; x += chunk_size) {
-		unsigned current;
-		current = c - x;
-		if (current > chunk_size)
-			current = chunk_size;
-		retval = fn(target, address + x * data_size, data_size, current, target_buf);
+	return target_fill_mem(target, address + tail * size, target_write_memory, size,
+		value, count - tail);
+}
+
+int target_copy_memory(struct target *target, target_addr_t dst,
+		target_addr_t src, uint32_t size)
+{
+	if (!size || dst == src)
+		return ERROR_OK;
+
+	/* The code on target copies upwards, fine unless dst is inside the source */
+	bool backwards = dst > src && dst - src < size;
+	uint32_t done = 0;
+
+	if (target->type->copy_memory && target->state == TARGET_HALTED && !backwards
+			&& !(dst % 4) && !(src % 4) && size >= TARGET_MEMORY_ALGORITHM_MIN_SIZE) {
+		int retval = target->type->copy_memory(target, dst, src, size / 4);
+		if (retval == ERROR_OK)
+			done = ALIGN_DOWN(size, 4);
+		else
+			LOG_DEBUG("copy on target failed, copying through the host");
+	}
+
+	uint8_t buffer[4096];
+	while (done < size) {
+		uint32_t chunk = MIN(sizeof(buffer), size - done);
+		/* Copy the end first if the source would be overwritten before it is read */
+		uint32_t offset = backwards ? size - done - chunk : done;
+
+		int retval = target_read_buffer(target, src + offset, chunk, buffer);
 		if (retval != ERROR_OK)
-			break;
-		/* avoid GDB timeouts */
-		keep_alive();
+			return retval;
+		retval = target_write_buffer(target, dst + offset, chunk, buffer);
+		if (retval != ERROR_OK)
+			return retval;
 
-		if (openocd_is_shutdown_pending()) {
-			retval = ERROR_SERVER_INTERRUPTED;
-			break;
-		}
+		done += chunk;
+		keep_alive();
 	}
-	free(target_buf);
 
-	return retval;
+	return ERROR_OK;
 }
 
-
 COMMAND_HANDLER(handle_mw_command)
 {
 	if (CMD_ARGC < 2)
@@ -3573,9 +4059,32 @@ COMMAND_HANDLER(handle_mw_command)
 			return ERROR_COMMAND_SYNTAX_ERROR;
 	}
 
+	if (fn == target_write_memory)
+		return target_fill_memory(target, address, wordsize, value, count);
+
 	return target_fill_mem(target, address, fn, wordsize, value, count);
 }
 
+COMMAND_HANDLER(handle_mem_copy_command)
+{
+	if (CMD_ARGC != 3)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	target_addr_t dst, src;
+	uint32_t size;
+	COMMAND_PARSE_ADDRESS(CMD_ARGV[0], dst);
+	COMMAND_PARSE_ADDRESS(CMD_ARGV[1], src);
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[2], size);
+
+	struct target *target = get_current_target(CMD_CTX);
+	if (!target_was_examined(target)) {
+		LOG_TARGET_ERROR(target, "Target not examined yet");
+		return ERROR_TARGET_NOT_EXAMINED;
+	}
+
+	return target_copy_memory(target, dst, src, size);
+}
+
 static COMMAND_HELPER(parse_load_image_command, struct image *image,
 		target_addr_t *min_address, target_addr_t *max_address)
 {
@@ -3608,6 +4117,75 @@ static COMMAND_HELPER(parse_load_image_command, struct image *image,
 	return ERROR_OK;
 }
 
+/* Smallest block load_image -delta compares before writing it */
+#define LOAD_IMAGE_DELTA_BLOCK_SIZE	4096
+
+/**
+ * Write only the parts of @a buffer that differ from the target memory.
+ * The on-target checksum of the whole range is compared first, and ranges
+ * that differ are halved down to LOAD_IMAGE_DELTA_BLOCK_SIZE, so that an
+ * unchanged range costs a single checksum.
+ */
+static int target_write_buffer_delta(struct target *target, target_addr_t address,
+		uint32_t size, const uint8_t *buffer, bool compress, uint32_t *written)
+{
+	uint32_t image_crc, target_crc;
+
+	int retval = image_calculate_checksum(buffer, size, &image_crc);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = target_checksum_memory(target, address, size, &target_crc);
+	if (retval == ERROR_OK && image_crc == target_crc)
+		return ERROR_OK;
+
+	if (retval != ERROR_OK || size <= LOAD_IMAGE_DELTA_BLOCK_SIZE) {
+		if (compress)
+			retval = target_write_buffer_compressed(target, address, size, buffer);
+		else
+			retval = target_write_buffer(target, address, size, buffer);
+		if (retval == ERROR_OK)
+			*written += size;
+		return retval;
+	}
+
+	uint32_t half = ALIGN_UP(size / 2, LOAD_IMAGE_DELTA_BLOCK_SIZE);
+	retval = target_write_buffer_delta(target, address, half, buffer, compress, written);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return target_write_buffer_delta(target, address + half, size - half,
+			buffer + half, compress, written);
+}
+
+/* Get the content of an image section, in place when the image holds it in
+ * memory, otherwise read into *buffer which the caller has to free */
+static int target_image_section_data(struct image *image, unsigned int section,
+		const uint8_t **data, uint8_t **buffer, size_t *size)
+{
+	*buffer = NULL;
+	if (image_map_section(image, section, data, size) == ERROR_OK)
+		return ERROR_OK;
+
+	*buffer = malloc(image->sections[section].size);
+	if (!*buffer) {
+		LOG_ERROR("error allocating buffer for section (%" PRIu32 " bytes)",
+				image->sections[section].size);
+		return ERROR_FAIL;
+	}
+
+	int retval = image_read_section(image, section, 0x0, image->sections[section].size,
+			*buffer, size);
+	if (retval != ERROR_OK) {
+		free(*buffer);
+		*buffer = NULL;
+		return retval;
+	}
+
+	*data = *buffer;
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_load_image_command)
 {
 	uint8_t *buffer;
@@ -3616,6 +4194,19 @@ COMMAND_HANDLER(handle_load_image_command)
 	target_addr_t min_address = 0;
 	target_addr_t max_address = -1;
 	struct image image;
+	bool delta = false;
+	bool compress = false;
+
+	while (CMD_ARGC > 0 && CMD_ARGV[0][0] == '-') {
+		if (!strcmp(CMD_ARGV[0], "-delta"))
+			delta = true;
+		else if (!strcmp(CMD_ARGV[0], "-compress"))
+			compress = true;
+		else
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		CMD_ARGC--;
+		CMD_ARGV++;
+	}
 
 	int retval = CALL_COMMAND_HANDLER(parse_load_image_command,
 			&image, &min_address, &max_address);
@@ -3633,20 +4224,10 @@ COMMAND_HANDLER(handle_load_image_command)
 	image_size = 0x0;
 	retval = ERROR_OK;
 	for (unsigned int i = 0; i < image.num_sections; i++) {
-		buffer = malloc(image.sections[i].size);
-		if (!buffer) {
-			command_print(CMD,
-						  "error allocating buffer for section (%d bytes)",
-						  (int)(image.sections[i].size));
-			retval = ERROR_FAIL;
-			break;
-		}
-
-		retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
-		if (retval != ERROR_OK) {
-			free(buffer);
+		const uint8_t *data;
+		retval = target_image_section_data(&image, i, &data, &buffer, &buf_cnt);
+		if (retval != ERROR_OK)
 			break;
-		}
 
 		uint32_t offset = 0;
 		uint32_t length = buf_cnt;
@@ -3665,16 +4246,35 @@ COMMAND_HANDLER(handle_load_image_command)
 			if (image.sections[i].base_address + buf_cnt > max_address)
 				length -= (image.sections[i].base_address + buf_cnt)-max_address;
 
-			retval = target_write_buffer(target,
-					image.sections[i].base_address + offset, length, buffer + offset);
-			if (retval != ERROR_OK) {
-				free(buffer);
-				break;
+			if (delta) {
+				uint32_t written = 0;
+				retval = target_write_buffer_delta(target,
+						image.sections[i].base_address + offset, length, data + offset,
+						compress, &written);
+				if (retval != ERROR_OK) {
+					free(buffer);
+					break;
+				}
+				image_size += written;
+				command_print(CMD, "%u bytes written, %u bytes unchanged at address " TARGET_ADDR_FMT "",
+						(unsigned int)written, (unsigned int)(length - written),
+						image.sections[i].base_address + offset);
+			} else {
+				if (compress)
+					retval = target_write_buffer_compressed(target,
+							image.sections[i].base_address + offset, length, data + offset);
+				else
+					retval = target_write_buffer(target,
+							image.sections[i].base_address + offset, length, data + offset);
+				if (retval != ERROR_OK) {
+					free(buffer);
+					break;
+				}
+				image_size += length;
+				command_print(CMD, "%u bytes written at address " TARGET_ADDR_FMT "",
+						(unsigned int)length,
+						image.sections[i].base_address + offset);
 			}
-			image_size += length;
-			command_print(CMD, "%u bytes written at address " TARGET_ADDR_FMT "",
-					(unsigned int)length,
-					image.sections[i].base_address + offset);
 		}
 
 		free(buffer);
@@ -3692,6 +4292,11 @@ COMMAND_HANDLER(handle_load_image_command)
 
 }
 
+/* Large enough for the adapter queue to stay full between file writes */
+#define DUMP_IMAGE_CHUNK_SIZE	(64 * 1024)
+/* Interval of the progress messages of a long dump */
+#define DUMP_IMAGE_PROGRESS_MS	2000
+
 COMMAND_HANDLER(handle_dump_image_command)
 {
 	struct fileio *fileio;
@@ -3707,7 +4312,7 @@ COMMAND_HANDLER(handle_dump_image_command)
 	COMMAND_PARSE_ADDRESS(CMD_ARGV[1], address);
 	COMMAND_PARSE_ADDRESS(CMD_ARGV[2], size);
 
-	uint32_t buf_size = (size > 4096) ? 4096 : size;
+	uint32_t buf_size = (size > DUMP_IMAGE_CHUNK_SIZE) ? DUMP_IMAGE_CHUNK_SIZE : size;
 	buffer = malloc(buf_size);
 	if (!buffer)
 		return ERROR_FAIL;
@@ -3720,6 +4325,9 @@ COMMAND_HANDLER(handle_dump_image_command)
 
 	duration_start(&bench);
 
+	target_addr_t total = size, done = 0;
+	int64_t progress_ms = timeval_ms();
+
 	while (size > 0) {
 		size_t size_written;
 		uint32_t this_run_size = (size > buf_size) ? buf_size : size;
@@ -3733,6 +4341,14 @@ COMMAND_HANDLER(handle_dump_image_command)
 
 		size -= this_run_size;
 		address += this_run_size;
+		done += this_run_size;
+
+		if (size > 0 && timeval_ms() - progress_ms >= DUMP_IMAGE_PROGRESS_MS) {
+			progress_ms = timeval_ms();
+			if (duration_measure(&bench) == ERROR_OK)
+				LOG_INFO("dumped %" PRIu64 " of %" PRIu64 " bytes (%0.3f KiB/s)",
+					(uint64_t)done, (uint64_t)total, duration_kbps(&bench, done));
+		}
 	}
 
 	free(buffer);
@@ -3740,8 +4356,10 @@ COMMAND_HANDLER(handle_dump_image_command)
 	if ((retval == ERROR_OK) && (duration_measure(&bench) == ERROR_OK)) {
 		size_t filesize;
 		retval = fileio_size(fileio, &filesize);
-		if (retval != ERROR_OK)
+		if (retval != ERROR_OK) {
+			fileio_close(fileio);
 			return retval;
+		}
 		command_print(CMD,
 				"dumped %zu bytes in %fs (%0.3f KiB/s)", filesize,
 				duration_elapsed(&bench), duration_kbps(&bench, filesize));
@@ -3803,23 +4421,18 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 	image_size = 0x0;
 	int diffs = 0;
 	retval = ERROR_OK;
+	/* the checksum algorithm runs once per section */
+	int retval_release;
+	target_working_area_hold(target);
 	for (unsigned int i = 0; i < image.num_sections; i++) {
-		buffer = malloc(image.sections[i].size);
-		if (!buffer) {
-			command_print(CMD,
-					"error allocating buffer for section (%" PRIu32 " bytes)",
-					image.sections[i].size);
-			break;
-		}
-		retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
-		if (retval != ERROR_OK) {
-			free(buffer);
+		const uint8_t *section_data;
+		retval = target_image_section_data(&image, i, &section_data, &buffer, &buf_cnt);
+		if (retval != ERROR_OK)
 			break;
-		}
 
 		if (verify >= IMAGE_VERIFY) {
 			/* calculate checksum of image */
-			retval = image_calculate_checksum(buffer, buf_cnt, &checksum);
+			retval = image_section_checksum(&image, i, section_data, buf_cnt, &checksum);
 			if (retval != ERROR_OK) {
 				free(buffer);
 				break;
@@ -3843,19 +4456,34 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 				if (diffs == 0)
 					LOG_ERROR("checksum mismatch - attempting binary compare");
 
-				data = malloc(buf_cnt);
+				/* read and compare in chunks, only the chunks that differ
+				 * are walked byte by byte */
+				size_t chunk_size = MIN(buf_cnt, CHECKSUM_READ_CHUNK_SIZE);
+				data = malloc(chunk_size);
+				if (!data) {
+					command_print(CMD, "error allocating buffer for compare");
+					free(buffer);
+					retval = ERROR_FAIL;
+					goto done;
+				}
+
+				for (size_t offset = 0; offset < buf_cnt; offset += chunk_size) {
+					size_t this_size = MIN(buf_cnt - offset, chunk_size);
+					retval = target_read_buffer(target, image.sections[i].base_address + offset,
+							this_size, data);
+					if (retval != ERROR_OK)
+						break;
 
-				retval = target_read_buffer(target, image.sections[i].base_address, buf_cnt, data);
-				if (retval == ERROR_OK) {
-					uint32_t t;
-					for (t = 0; t < buf_cnt; t++) {
-						if (data[t] != buffer[t]) {
+					if (memcmp(data, section_data + offset, this_size)) {
+						for (size_t t = 0; t < this_size; t++) {
+							if (data[t] == section_data[offset + t])
+								continue;
 							command_print(CMD,
 										  "diff %d address 0x%08x. Was 0x%02x instead of 0x%02x",
 										  diffs,
-										  (unsigned)(t + image.sections[i].base_address),
+										  (unsigned)(offset + t + image.sections[i].base_address),
 										  data[t],
-										  buffer[t]);
+										  section_data[offset + t]);
 							if (diffs++ >= 127) {
 								command_print(CMD, "More than 128 errors, the rest are not printed.");
 								free(data);
@@ -3863,13 +4491,13 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 								goto done;
 							}
 						}
-						keep_alive();
-						if (openocd_is_shutdown_pending()) {
-							retval = ERROR_SERVER_INTERRUPTED;
-							free(data);
-							free(buffer);
-							goto done;
-						}
+					}
+					keep_alive();
+					if (openocd_is_shutdown_pending()) {
+						retval = ERROR_SERVER_INTERRUPTED;
+						free(data);
+						free(buffer);
+						goto done;
 					}
 				}
 				free(data);
@@ -3886,6 +4514,9 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 	if (diffs > 0)
 		command_print(CMD, "No more differences found.");
 done:
+	retval_release = target_working_area_release(target);
+	if (retval == ERROR_OK)
+		retval = retval_release;
 	if (diffs > 0)
 		retval = ERROR_FAIL;
 	if ((retval == ERROR_OK) && (duration_measure(&bench) == ERROR_OK)) {
@@ -4315,6 +4946,13 @@ static void write_gmon(uint32_t *samples, uint32_t sample_num, const char *filen
 COMMAND_HANDLER(handle_profile_command)
 {
 	struct target *target = get_current_target(CMD_CTX);
+	bool nonintrusive = false;
+
+	if (CMD_ARGC > 0 && !strcmp(CMD_ARGV[0], "-nonintrusive")) {
+		nonintrusive = true;
+		CMD_ARGC--;
+		CMD_ARGV++;
+	}
 
 	if ((CMD_ARGC != 2) && (CMD_ARGC != 4))
 		return ERROR_COMMAND_SYNTAX_ERROR;
@@ -4353,7 +4991,7 @@ COMMAND_HANDLER(handle_profile_command)
 	 * Provide a way to use that more efficient mechanism.
 	 */
 	retval = target_profiling(target, samples, MAX_PROFILE_SAMPLE_NUM,
-				&num_of_samples, offset);
+				&num_of_samples, offset, nonintrusive);
 	if (retval != ERROR_OK) {
 		free(samples);
 		return retval;
@@ -4403,12 +5041,26 @@ COMMAND_HANDLER(handle_profile_command)
 COMMAND_HANDLER(handle_target_read_memory)
 {
 	/*
+	 * optional "-binary" or "-file filename"
 	 * CMD_ARGV[0] = memory address
 	 * CMD_ARGV[1] = desired element width in bits
 	 * CMD_ARGV[2] = number of elements to read
 	 * CMD_ARGV[3] = optional "phys"
 	 */
 
+	bool binary = false;
+	const char *filename = NULL;
+
+	if (CMD_ARGC > 0 && !strcmp(CMD_ARGV[0], "-binary")) {
+		binary = true;
+		CMD_ARGC--;
+		CMD_ARGV++;
+	} else if (CMD_ARGC > 1 && !strcmp(CMD_ARGV[0], "-file")) {
+		filename = CMD_ARGV[1];
+		CMD_ARGC -= 2;
+		CMD_ARGV += 2;
+	}
+
 	if (CMD_ARGC < 3 || CMD_ARGC > 4)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
@@ -4453,14 +5105,15 @@ COMMAND_HANDLER(handle_target_read_memory)
 		return ERROR_COMMAND_ARGUMENT_INVALID;
 	}
 
-	if (count > 65536) {
+	/* raw data has no Tcl list to build, only the list form is limited */
+	if (!binary && !filename && count > 65536) {
 		command_print(CMD, "read_memory: too large read request, exceeds 64K elements");
 		return ERROR_COMMAND_ARGUMENT_INVALID;
 	}
 
 	struct target *target = get_current_target(CMD_CTX);
 
-	const size_t buffersize = 4096;
+	const size_t buffersize = (binary || filename) ? 65536 : 4096;
 	uint8_t *buffer = malloc(buffersize);
 
 	if (!buffer) {
@@ -4468,6 +5121,15 @@ COMMAND_HANDLER(handle_target_read_memory)
 		return ERROR_FAIL;
 	}
 
+	struct fileio *fileio = NULL;
+	if (filename) {
+		int retval = fileio_open(&fileio, filename, FILEIO_WRITE, FILEIO_BINARY);
+		if (retval != ERROR_OK) {
+			free(buffer);
+			return retval;
+		}
+	}
+
 	char *separator = "";
 	while (count > 0) {
 		const unsigned int max_chunk_len = buffersize / width;
@@ -4488,11 +5150,28 @@ COMMAND_HANDLER(handle_target_read_memory)
 			 * Add a way to flush and replace old output, but LOG_DEBUG() it
 			 */
 			command_print(CMD, "read_memory: failed to read memory");
+			if (fileio)
+				fileio_close(fileio);
 			free(buffer);
 			return retval;
 		}
 
-		for (size_t i = 0; i < chunk_len ; i++) {
+		if (fileio) {
+			size_t written;
+			retval = fileio_write(fileio, chunk_len * width, buffer, &written);
+			if (retval == ERROR_OK && written != chunk_len * width)
+				retval = ERROR_FILEIO_OPERATION_FAILED;
+			if (retval != ERROR_OK) {
+				command_print(CMD, "read_memory: failed to write file '%s'", filename);
+				fileio_close(fileio);
+				free(buffer);
+				return retval;
+			}
+		} else if (binary) {
+			command_print_binary(CMD, buffer, chunk_len * width);
+		}
+
+		for (size_t i = 0; i < chunk_len && !binary && !fileio; i++) {
 			uint64_t v = 0;
 
 			switch (width) {
@@ -4518,30 +5197,121 @@ COMMAND_HANDLER(handle_target_read_memory)
 		addr += chunk_len * width;
 	}
 
+	if (fileio)
+		fileio_close(fileio);
 	free(buffer);
 
 	return ERROR_OK;
 }
 
+/* write_memory -file, the file is copied to memory in chunks */
+static int target_write_memory_from_file(Jim_Interp *interp, struct target *target,
+		const char *filename, target_addr_t addr, unsigned int width, bool is_phys)
+{
+	struct fileio *fileio;
+	size_t size;
+
+	if (fileio_open(&fileio, filename, FILEIO_READ, FILEIO_BINARY) != ERROR_OK) {
+		Jim_SetResultFormatted(interp, "write_memory: cannot open '%s'", filename);
+		return JIM_ERR;
+	}
+
+	if (fileio_size(fileio, &size) != ERROR_OK || size % width) {
+		Jim_SetResultFormatted(interp, "write_memory: size of '%s' is not a multiple of the width",
+			filename);
+		fileio_close(fileio);
+		return JIM_ERR;
+	}
+
+	if (addr + size < addr) {
+		Jim_SetResultString(interp, "write_memory: addr + len wraps to zero", -1);
+		fileio_close(fileio);
+		return JIM_ERR;
+	}
+
+	const size_t buffersize = 65536;
+	uint8_t *buffer = malloc(buffersize);
+	if (!buffer) {
+		LOG_ERROR("Failed to allocate memory");
+		fileio_close(fileio);
+		return JIM_ERR;
+	}
+
+	int e = JIM_OK;
+	while (size > 0) {
+		size_t chunk_size = MIN(size, buffersize);
+		size_t read_bytes;
+
+		if (fileio_read(fileio, chunk_size, buffer, &read_bytes) != ERROR_OK ||
+				read_bytes != chunk_size) {
+			Jim_SetResultFormatted(interp, "write_memory: failed to read '%s'", filename);
+			e = JIM_ERR;
+			break;
+		}
+
+		int retval;
+		if (is_phys)
+			retval = target_write_phys_memory(target, addr, width, chunk_size / width, buffer);
+		else
+			retval = target_write_memory(target, addr, width, chunk_size / width, buffer);
+
+		if (retval != ERROR_OK) {
+			LOG_ERROR("write_memory: write at " TARGET_ADDR_FMT " with width=%u and count=%zu failed",
+				addr, width * 8, chunk_size / width);
+			Jim_SetResultString(interp, "write_memory: failed to write memory", -1);
+			e = JIM_ERR;
+			break;
+		}
+
+		size -= chunk_size;
+		addr += chunk_size;
+	}
+
+	free(buffer);
+	fileio_close(fileio);
+
+	return e;
+}
+
 static int target_jim_write_memory(Jim_Interp *interp, int argc,
 		Jim_Obj * const *argv)
 {
 	/*
-	 * argv[1] = memory address
-	 * argv[2] = desired element width in bits
-	 * argv[3] = list of data to write
-	 * argv[4] = optional "phys"
+	 * optional "-binary", or "-file filename" instead of data
+	 * args[0] = memory address
+	 * args[1] = desired element width in bits
+	 * args[2] = list of data to write
+	 * args[3] = optional "phys"
 	 */
 
-	if (argc < 4 || argc > 5) {
-		Jim_WrongNumArgs(interp, 1, argv, "address width data ['phys']");
+	bool binary = false;
+	const char *filename = NULL;
+	Jim_Obj * const *args = argv + 1;
+	int nargs = argc - 1;
+
+	if (nargs > 0 && !strcmp(Jim_String(args[0]), "-binary")) {
+		binary = true;
+		args++;
+		nargs--;
+	} else if (nargs > 1 && !strcmp(Jim_String(args[0]), "-file")) {
+		filename = Jim_String(args[1]);
+		args += 2;
+		nargs -= 2;
+	}
+
+	/* a file replaces the data argument */
+	const int data_args = filename ? 0 : 1;
+
+	if (nargs < 2 + data_args || nargs > 3 + data_args) {
+		Jim_WrongNumArgs(interp, 1, argv,
+			"['-binary'] address width data ['phys']|-file filename address width ['phys']");
 		return JIM_ERR;
 	}
 
 	/* Arg 1: Memory address. */
 	int e;
 	jim_wide wide_addr;
-	e = Jim_GetWide(interp, argv[1], &wide_addr);
+	e = Jim_GetWide(interp, args[0], &wide_addr);
 
 	if (e != JIM_OK)
 		return e;
@@ -4550,19 +5320,18 @@ static int target_jim_write_memory(Jim_Interp *interp, int argc,
 
 	/* Arg 2: Bit width of one element. */
 	long l;
-	e = Jim_GetLong(interp, argv[2], &l);
+	e = Jim_GetLong(interp, args[1], &l);
 
 	if (e != JIM_OK)
 		return e;
 
 	const unsigned int width_bits = l;
-	size_t count = Jim_ListLength(interp, argv[3]);
 
 	/* Arg 4: Optional 'phys'. */
 	bool is_phys = false;
 
-	if (argc > 4) {
-		const char *phys = Jim_GetString(argv[4], NULL);
+	if (nargs > 2 + data_args) {
+		const char *phys = Jim_GetString(args[2 + data_args], NULL);
 
 		if (strcmp(phys, "phys")) {
 			Jim_SetResultFormatted(interp, "invalid argument '%s', must be 'phys'", phys);
@@ -4585,6 +5354,46 @@ static int target_jim_write_memory(Jim_Interp *interp, int argc,
 
 	const unsigned int width = width_bits / 8;
 
+	struct command_context *cmd_ctx = current_command_context(interp);
+	assert(cmd_ctx != NULL);
+	struct target *target = get_current_target(cmd_ctx);
+
+	if (filename)
+		return target_write_memory_from_file(interp, target, filename, addr, width, is_phys);
+
+	if (binary) {
+		/* the byte string is already in target memory layout */
+		int len;
+		const char *data = Jim_GetString(args[2], &len);
+
+		if (len % width) {
+			Jim_SetResultString(interp, "write_memory: data length is not a multiple of the width", -1);
+			return JIM_ERR;
+		}
+
+		if ((addr + len) < addr) {
+			Jim_SetResultString(interp, "write_memory: addr + len wraps to zero", -1);
+			return JIM_ERR;
+		}
+
+		int retval;
+		if (is_phys)
+			retval = target_write_phys_memory(target, addr, width, len / width, (const uint8_t *)data);
+		else
+			retval = target_write_memory(target, addr, width, len / width, (const uint8_t *)data);
+
+		if (retval != ERROR_OK) {
+			LOG_ERROR("write_memory: write at " TARGET_ADDR_FMT " with width=%u and count=%d failed",
+				addr, width_bits, len / (int)width);
+			Jim_SetResultString(interp, "write_memory: failed to write memory", -1);
+			return JIM_ERR;
+		}
+
+		return JIM_OK;
+	}
+
+	size_t count = Jim_ListLength(interp, args[2]);
+
 	if ((addr + (count * width)) < addr) {
 		Jim_SetResultString(interp, "write_memory: addr + len wraps to zero", -1);
 		return JIM_ERR;
@@ -4595,10 +5404,6 @@ static int target_jim_write_memory(Jim_Interp *interp, int argc,
 		return JIM_ERR;
 	}
 
-	struct command_context *cmd_ctx = current_command_context(interp);
-	assert(cmd_ctx != NULL);
-	struct target *target = get_current_target(cmd_ctx);
-
 	const size_t buffersize = 4096;
 	uint8_t *buffer = malloc(buffersize);
 
@@ -4614,7 +5419,7 @@ static int target_jim_write_memory(Jim_Interp *interp, int argc,
 		const size_t chunk_len = MIN(count, max_chunk_len);
 
 		for (size_t i = 0; i < chunk_len; i++, j++) {
-			Jim_Obj *tmp = Jim_ListGetIndex(interp, argv[3], j);
+			Jim_Obj *tmp = Jim_ListGetIndex(interp, args[2], j);
 			jim_wide element_wide;
 			Jim_GetWide(interp, tmp, &element_wide);
 
@@ -4880,6 +5685,7 @@ enum target_cfg_param {
 	TCFG_CHAIN_POSITION,
 	TCFG_DBGBASE,
 	TCFG_RTOS,
+	TCFG_RTOS_ELF,
 	TCFG_DEFER_EXAMINE,
 	TCFG_GDB_PORT,
 	TCFG_GDB_MAX_CONNECTIONS,
@@ -4897,6 +5703,7 @@ static struct jim_nvp nvp_config_opts[] = {
 	{ .name = "-chain-position",   .value = TCFG_CHAIN_POSITION },
 	{ .name = "-dbgbase",          .value = TCFG_DBGBASE },
 	{ .name = "-rtos",             .value = TCFG_RTOS },
+	{ .name = "-rtos-elf",         .value = TCFG_RTOS_ELF },
 	{ .name = "-defer-examine",    .value = TCFG_DEFER_EXAMINE },
 	{ .name = "-gdb-port",         .value = TCFG_GDB_PORT },
 	{ .name = "-gdb-max-connections",   .value = TCFG_GDB_MAX_CONNECTIONS },
@@ -5186,6 +5993,24 @@ no_params:
 			/* loop for more */
 			break;
 
+		case TCFG_RTOS_ELF:
+			if (goi->isconfigure) {
+				const char *s;
+				e = jim_getopt_string(goi, &s, NULL);
+				if (e != JIM_OK)
+					return e;
+				free(target->rtos_elf);
+				target->rtos_elf = NULL;
+				if (s[0])
+					target->rtos_elf = strdup(s);
+			} else {
+				if (goi->argc != 0)
+					goto no_params;
+			}
+			Jim_SetResultString(goi->interp, target->rtos_elf ? target->rtos_elf : "", -1);
+			/* loop for more */
+			break;
+
 		case TCFG_DEFER_EXAMINE:
 			/* DEFER_EXAMINE */
 			target->defer_examine = true;
@@ -5375,6 +6200,7 @@ COMMAND_HANDLER(handle_target_reset)
 	target->reset_halt = (a != 0);
 	/* When this happens - all workareas are invalid. */
 	target_free_all_working_areas_restore(target, 0);
+	target_forget_resident_areas(target, 0, 0);
 
 	/* do the assert */
 	if (n->value == NVP_ASSERT) {
@@ -5553,6 +6379,13 @@ static const struct command_registration target_instance_command_handlers[] = {
 		.help = "Write byte(s) to target memory",
 		.usage = "address data [count]",
 	},
+	{
+		.name = "mem_copy",
+		.handler = handle_mem_copy_command,
+		.mode = COMMAND_EXEC,
+		.help = "Copy target memory, the ranges may overlap",
+		.usage = "dst_address src_address size",
+	},
 	{
 		.name = "mdd",
 		.handler = handle_md_command,
@@ -5599,15 +6432,17 @@ static const struct command_registration target_instance_command_handlers[] = {
 		.name = "read_memory",
 		.mode = COMMAND_EXEC,
 		.handler = handle_target_read_memory,
-		.help = "Read Tcl list of 8/16/32/64 bit numbers from target memory",
-		.usage = "address width count ['phys']",
+		.help = "Read Tcl list of 8/16/32/64 bit numbers from target memory, "
+			"or the raw data as a byte string or into a file",
+		.usage = "['-binary'|'-file' filename] address width count ['phys']",
 	},
 	{
 		.name = "write_memory",
 		.mode = COMMAND_EXEC,
 		.jim_handler = target_jim_write_memory,
-		.help = "Write Tcl list of 8/16/32/64 bit numbers to target memory",
-		.usage = "address width data ['phys']",
+		.help = "Write Tcl list of 8/16/32/64 bit numbers to target memory, "
+			"or the raw data of a byte string or a file",
+		.usage = "['-binary'] address width data ['phys']|'-file' filename address width ['phys']",
 	},
 	{
 		.name = "eventlist",
@@ -5794,6 +6629,8 @@ static int target_create(struct jim_getopt_info *goi)
 	target->debug_reason        = DBG_REASON_UNDEFINED;
 	target->reg_cache           = NULL;
 	target->breakpoints         = NULL;
+	target->breakpoint_index    = NULL;
+	target->breakpoints_tail    = NULL;
 	target->watchpoints         = NULL;
 	target->next                = NULL;
 	target->arch_info           = NULL;
@@ -5818,6 +6655,7 @@ static int target_create(struct jim_getopt_info *goi)
 
 	target->rtos = NULL;
 	target->rtos_auto_detect = false;
+	target->rtos_elf = NULL;
 
 	target->gdb_port_override = NULL;
 	target->gdb_max_connections = 1;
@@ -5846,6 +6684,7 @@ static int target_create(struct jim_getopt_info *goi)
 	if (e != JIM_OK) {
 		rtos_destroy(target);
 		free(target->gdb_port_override);
+		free(target->rtos_elf);
 		free(target->trace_info);
 		free(target->type);
 		free(target);
@@ -5863,6 +6702,7 @@ static int target_create(struct jim_getopt_info *goi)
 		LOG_ERROR("Out of memory");
 		rtos_destroy(target);
 		free(target->gdb_port_override);
+		free(target->rtos_elf);
 		free(target->trace_info);
 		free(target->type);
 		free(target);
@@ -5876,6 +6716,7 @@ static int target_create(struct jim_getopt_info *goi)
 			free(target->cmd_name);
 			rtos_destroy(target);
 			free(target->gdb_port_override);
+			free(target->rtos_elf);
 			free(target->trace_info);
 			free(target->type);
 			free(target);
@@ -5917,6 +6758,7 @@ static int target_create(struct jim_getopt_info *goi)
 		free(target->cmd_name);
 		rtos_destroy(target);
 		free(target->gdb_port_override);
+		free(target->rtos_elf);
 		free(target->trace_info);
 		free(target->type);
 		free(target);
@@ -6161,19 +7003,10 @@ COMMAND_HANDLER(handle_fast_load_image_command)
 	}
 	memset(fastload, 0, sizeof(struct fast_load)*image.num_sections);
 	for (unsigned int i = 0; i < image.num_sections; i++) {
-		buffer = malloc(image.sections[i].size);
-		if (!buffer) {
-			command_print(CMD, "error allocating buffer for section (%d bytes)",
-						  (int)(image.sections[i].size));
-			retval = ERROR_FAIL;
-			break;
-		}
-
-		retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
-		if (retval != ERROR_OK) {
-			free(buffer);
+		const uint8_t *data;
+		retval = target_image_section_data(&image, i, &data, &buffer, &buf_cnt);
+		if (retval != ERROR_OK)
 			break;
-		}
 
 		uint32_t offset = 0;
 		uint32_t length = buf_cnt;
@@ -6200,7 +7033,7 @@ COMMAND_HANDLER(handle_fast_load_image_command)
 				retval = ERROR_FAIL;
 				break;
 			}
-			memcpy(fastload[i].data, buffer + offset, length);
+			memcpy(fastload[i].data, data + offset, length);
 			fastload[i].length = length;
 
 			image_size += length;
@@ -6530,7 +7363,7 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.name = "profile",
 		.handler = handle_profile_command,
 		.mode = COMMAND_EXEC,
-		.usage = "seconds filename [start end]",
+		.usage = "['-nonintrusive'] seconds filename [start end]",
 		.help = "profiling samples the CPU PC",
 	},
 	/** @todo don't register virt2phys() unless target supports it */
@@ -6556,6 +7389,14 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.help = "poll target state; or reconfigure background polling",
 		.usage = "['on'|'off']",
 	},
+	{
+		.name = "poll_idle_interval",
+		.handler = handle_poll_idle_interval_command,
+		.mode = COMMAND_ANY,
+		.help = "set/get the background polling interval of running targets "
+			"while no GDB is connected (0 polls at every tick)",
+		.usage = "[milliseconds]",
+	},
 	{
 		.name = "wait_halt",
 		.handler = handle_wait_halt_command,
@@ -6657,6 +7498,13 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.help = "write memory byte",
 		.usage = "['phys'] address value [count]",
 	},
+	{
+		.name = "mem_copy",
+		.handler = handle_mem_copy_command,
+		.mode = COMMAND_EXEC,
+		.help = "copy memory, the ranges may overlap",
+		.usage = "dst_address src_address size",
+	},
 	{
 		.name = "bp",
 		.handler = handle_bp_command,
@@ -6689,7 +7537,7 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.name = "load_image",
 		.handler = handle_load_image_command,
 		.mode = COMMAND_EXEC,
-		.usage = "filename [address ['bin'|'ihex'|'elf'|'s19' "
+		.usage = "['-delta'] ['-compress'] filename [address ['bin'|'ihex'|'elf'|'s19' "
 			"[min_address [max_length]]]]",
 	},
 	{
@@ -6734,15 +7582,17 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.name = "read_memory",
 		.mode = COMMAND_EXEC,
 		.handler = handle_target_read_memory,
-		.help = "Read Tcl list of 8/16/32/64 bit numbers from target memory",
-		.usage = "address width count ['phys']",
+		.help = "Read Tcl list of 8/16/32/64 bit numbers from target memory, "
+			"or the raw data as a byte string or into a file",
+		.usage = "['-binary'|'-file' filename] address width count ['phys']",
 	},
 	{
 		.name = "write_memory",
 		.mode = COMMAND_EXEC,
 		.jim_handler = target_jim_write_memory,
-		.help = "Write Tcl list of 8/16/32/64 bit numbers to target memory",
-		.usage = "address width data ['phys']",
+		.help = "Write Tcl list of 8/16/32/64 bit numbers to target memory, "
+			"or the raw data of a byte string or a file",
+		.usage = "['-binary'] address width data ['phys']|'-file' filename address width ['phys']",
 	},
 	{
 		.name = "debug_reason",
@@ -36,6 +36,7 @@ struct mem_param;
 struct reg_param;
 struct target_list;
 struct gdb_fileio_info;
+struct target_request_ring;
 
 /*
  * TARGET_UNKNOWN = 0: we don't know anything about the target yet
@@ -91,6 +92,24 @@ struct working_area {
 	struct working_area *next;
 };
 
+/* Code known to be still loaded in the working area, see
+ * target_alloc_working_area_code() */
+struct working_area_resident {
+	target_addr_t address;
+	uint32_t size;
+	uint32_t crc;
+	struct working_area_resident *next;
+};
+
+/* Original content of working area memory, restored when the backup hold
+ * ends, see target_working_area_hold() */
+struct working_area_backup {
+	target_addr_t address;
+	uint32_t size;
+	uint8_t *data;
+	struct working_area_backup *next;
+};
+
 struct gdb_service {
 	struct target *target;
 	/*  field for smp display  */
@@ -151,16 +170,24 @@ struct target {
 	uint32_t working_area_size;			/* size in bytes */
 	bool backup_working_area;			/* whether the content of the working area has to be preserved */
 	struct working_area *working_areas;/* list of allocated working areas */
+	struct working_area_resident *resident_areas;	/* code left loaded in the working area */
+	unsigned int working_area_hold;		/* nesting level of target_working_area_hold() */
+	struct working_area_backup *held_backups;	/* memory to restore when the hold ends */
+	unsigned int memory_generation;		/* bumped on every memory write through the target API */
+	unsigned int halt_generation;		/* bumped whenever the target may have run, see register_cache_fetch() */
 	enum target_debug_reason debug_reason;/* reason why the target entered debug state */
 	enum target_endianness endianness;	/* target endianness */
 	/* also see: target_state_name() */
 	enum target_state state;			/* the current backend-state (running, halted, ...) */
 	struct reg_cache *reg_cache;		/* the first register cache of the target (core regs) */
 	struct breakpoint *breakpoints;		/* list of breakpoints */
+	struct breakpoint **breakpoint_index;	/* address hash of the breakpoints, or NULL */
+	struct breakpoint **breakpoints_tail;	/* next pointer of the last breakpoint, or NULL */
 	struct watchpoint *watchpoints;		/* list of watchpoints */
 	struct trace *trace_info;			/* generic trace information */
 	struct debug_msg_receiver *dbgmsg;	/* list of debug message receivers */
 	bool dbg_msg_enabled;				/* debug message status */
+	struct target_request_ring *dbg_msg_ring;	/* memory ring for debug messages, or NULL */
 	void *arch_info;					/* architecture specific information */
 	void *private_config;				/* pointer to target specific config data (for jim_configure hook) */
 	struct target *next;				/* next target in list */
@@ -183,7 +210,9 @@ struct target {
 	struct rtos *rtos;					/* Instance of Real Time Operating System support */
 	bool rtos_auto_detect;				/* A flag that indicates that the RTOS has been specified as "auto"
 										 * and must be detected when symbols are offered */
+	char *rtos_elf;						/* ELF file to look up RTOS symbols in, instead of asking GDB */
 	struct backoff_timer backoff;
+	unsigned int idle_poll_count;		/* background polls skipped while running unobserved */
 	int smp;							/* Unique non-zero number for each SMP group */
 	struct list_head *smp_targets;		/* list all targets in this smp group/cluster
 										 * The head of the list is shared between the
@@ -343,6 +372,17 @@ struct target_memory_check_block {
 	uint32_t result;
 };
 
+/** One range of a scatter-gather memory access. */
+struct target_memory_sg {
+	target_addr_t address;
+	/** Access size in bytes: 1, 2 or 4. */
+	uint32_t size;
+	/** Number of items of @a size bytes. */
+	uint32_t count;
+	/** Data to write, or receiving the data read. */
+	uint8_t *buffer;
+};
+
 int target_register_commands(struct command_context *cmd_ctx);
 int target_examine(void);
 
@@ -386,6 +426,15 @@ int target_unregister_trace_callback(
  * yet it is possible to detect error conditions.
  */
 int target_poll(struct target *target);
+
+/**
+ * Identify the periodic poll of all the targets in progress, or return 0
+ * outside of it. A target may read the status of the targets sharing its
+ * debug link in one batch, and let them use the result within the same
+ * round.
+ */
+unsigned int target_poll_round(void);
+
 int target_resume(struct target *target, int current, target_addr_t address,
 		int handle_breakpoints, int debug_execution);
 int target_halt(struct target *target);
@@ -523,6 +572,16 @@ int target_get_gdb_reg_list_noread(struct target *target,
 		struct reg **reg_list[], int *reg_list_size,
 		enum target_register_class reg_class);
 
+/**
+ * Fetch all invalid registers of @a reg_class into the register cache at
+ * once. Returns ERROR_NOT_IMPLEMENTED if the target reads registers one by
+ * one only, callers then fall back to the per register get().
+ *
+ * This routine is a wrapper for target->type->read_all_core_regs.
+ */
+int target_read_all_core_regs(struct target *target,
+		enum target_register_class reg_class);
+
 /**
  * Check if @a target allows GDB connections.
  *
@@ -570,6 +629,33 @@ int target_wait_algorithm(struct target *target,
 		target_addr_t exit_point, unsigned int timeout_ms,
 		void *arch_info);
 
+/** Direction of the data streamed by target_run_async_algorithm(). */
+enum target_async_dir {
+	TARGET_ASYNC_TO_TARGET,
+	TARGET_ASYNC_FROM_TARGET,
+};
+
+/**
+ * Moves @a size bytes between the host and the circular buffer of an
+ * asynchronous algorithm at @a address, writing them when streaming to
+ * the target and reading them when streaming from the target.
+ */
+typedef int (*target_async_xfer_fn)(struct target *target,
+		target_addr_t address, uint32_t size, void *priv);
+
+/**
+ * Runs an asynchronous algorithm exchanging data with the host through
+ * a circular buffer on target, calling @a xfer for each part of it.
+ */
+int target_run_async_algorithm(struct target *target,
+		enum target_async_dir dir, target_async_xfer_fn xfer, void *priv,
+		uint32_t count, int block_size,
+		int num_mem_params, struct mem_param *mem_params,
+		int num_reg_params, struct reg_param *reg_params,
+		uint32_t buffer_start, uint32_t buffer_size,
+		uint32_t entry_point, uint32_t exit_point,
+		void *arch_info);
+
 /**
  * This routine is a wrapper for asynchronous algorithms.
  *
@@ -626,6 +712,19 @@ int target_write_memory(struct target *target,
 int target_write_phys_memory(struct target *target,
 		target_addr_t address, uint32_t size, uint32_t count, const uint8_t *buffer);
 
+/**
+ * Read or write several memory ranges of @a target. Targets able to queue
+ * all the ranges at once do so through target->type->read_memory_sg or
+ * write_memory_sg, saving an adapter round trip per range. Otherwise each
+ * range goes through target_read_memory() or target_write_memory() in turn.
+ */
+int target_read_memory_sg(struct target *target,
+		struct target_memory_sg *ranges, unsigned int num_ranges);
+int target_write_memory_sg(struct target *target,
+		const struct target_memory_sg *ranges, unsigned int num_ranges);
+void target_memory_sg_range(struct target_memory_sg *range,
+		target_addr_t address, uint32_t size, uint8_t *buffer);
+
 /*
  * Write to target memory using the virtual address.
  *
@@ -652,6 +751,13 @@ int target_write_phys_memory(struct target *target,
  */
 int target_write_buffer(struct target *target,
 		target_addr_t address, uint32_t size, const uint8_t *buffer);
+/*
+ * Same as target_write_buffer(), but for RAM on targets able to expand
+ * compressed data themselves, in which case less data goes through the
+ * debug adapter. Falls back to target_write_buffer() otherwise.
+ */
+int target_write_buffer_compressed(struct target *target,
+		target_addr_t address, uint32_t size, const uint8_t *buffer);
 int target_read_buffer(struct target *target,
 		target_addr_t address, uint32_t size, uint8_t *buffer);
 int target_checksum_memory(struct target *target,
@@ -659,6 +765,28 @@ int target_checksum_memory(struct target *target,
 int target_blank_check_memory(struct target *target,
 		struct target_memory_check_block *blocks, int num_blocks,
 		uint8_t erased_value);
+/**
+ * Find the first occurrence of @a pattern of @a length bytes within
+ * @a size bytes of memory at @a address. On targets able to, the search
+ * runs on the target and only the result goes through the debug adapter.
+ * Falls back to reading the memory otherwise.
+ */
+int target_search_memory(struct target *target, target_addr_t address,
+		uint32_t size, const uint8_t *pattern, uint32_t length,
+		target_addr_t *match, bool *found);
+/**
+ * Fill @a count units of @a size bytes at @a address with @a value. On
+ * targets able to, the aligned words are written by code running on the
+ * target and only the parameters go through the debug adapter.
+ */
+int target_fill_memory(struct target *target, target_addr_t address,
+		unsigned int size, uint64_t value, uint32_t count);
+/**
+ * Copy @a size bytes of memory from @a src to @a dst, which may overlap.
+ * On targets able to, the copy runs on the target.
+ */
+int target_copy_memory(struct target *target, target_addr_t dst,
+		target_addr_t src, uint32_t size);
 int target_wait_state(struct target *target, enum target_state state, unsigned int ms);
 
 /**
@@ -724,6 +852,14 @@ int target_alloc_working_area(struct target *target,
  */
 int target_alloc_working_area_try(struct target *target,
 		uint32_t size, struct working_area **area);
+/**
+ * Allocate a working area and load @a code in it, typically a flash loader.
+ * If the same code was loaded by a previous call and the target neither ran
+ * nor had that memory written since, the area is allocated at the same
+ * address again and the download is skipped. Free it as any working area.
+ */
+int target_alloc_working_area_code(struct target *target,
+		const uint8_t *code, uint32_t size, struct working_area **area);
 /**
  * Free a working area.
  * Restore target data if area backup is configured.
@@ -735,6 +871,20 @@ int target_free_working_area(struct target *target, struct working_area *area);
 void target_free_all_working_areas(struct target *target);
 uint32_t target_get_working_area_avail(struct target *target);
 
+/**
+ * Defer the restore of the backed up working areas until the matching
+ * target_working_area_release(), so that a command running several
+ * algorithms saves and restores each byte of the working area once.
+ * Calls can be nested. Without -work-area-backup this does nothing.
+ */
+void target_working_area_hold(struct target *target);
+/**
+ * End a section opened by target_working_area_hold(), restoring the
+ * memory used in it when the outermost section ends.
+ * @returns ERROR_OK if successful; error code if restore failed
+ */
+int target_working_area_release(struct target *target);
+
 /**
  * Free all the resources allocated by targets and the target layer
  */
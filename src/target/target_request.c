@@ -34,12 +34,56 @@ bool target_got_message(void)
 
 static int charmsg_mode;
 
-static int target_asciimsg(struct target *target, uint32_t length)
+/* Optional ring in target memory, an alternative to the DCC side-band:
+ *   u32 magic, u32 size, u32 wr_off, u32 rd_off, u8 data[size]
+ * The target appends complete request words (and their payload words)
+ * at wr_off, the debugger consumes them at rd_off. Offsets and size are
+ * in bytes and multiple of 4. */
+#define TARGET_REQ_RING_MAGIC		0x51455254	/* "TREQ" */
+#define TARGET_REQ_RING_HDR_SIZE	16
+#define TARGET_REQ_RING_WR_OFF		8
+#define TARGET_REQ_RING_RD_OFF		12
+#define TARGET_REQ_RING_POLL_MS		10
+
+struct target_request_ring {
+	target_addr_t address;
+	uint32_t size;
+	uint8_t *buffer;		/* host copy of the pending data */
+};
+
+/* Source of the payload that follows a request word: either the target
+ * specific side-band, or what is left of a block already read from the ring */
+struct target_request_stream {
+	const uint8_t *data;
+	uint32_t length;
+	uint32_t pos;
+};
+
+static int target_request_data(struct target *target, struct target_request_stream *stream,
+		uint32_t size, uint8_t *buffer)
+{
+	if (!stream)
+		return target->type->target_request_data(target, size, buffer);
+
+	if (stream->length - stream->pos < size * 4)
+		return ERROR_BUF_TOO_SMALL;
+
+	memcpy(buffer, stream->data + stream->pos, size * 4);
+	stream->pos += size * 4;
+	return ERROR_OK;
+}
+
+static int target_asciimsg(struct target *target, struct target_request_stream *stream,
+		uint32_t length)
 {
 	char *msg = malloc(DIV_ROUND_UP(length + 1, 4) * 4);
 	struct debug_msg_receiver *c = target->dbgmsg;
 
-	target->type->target_request_data(target, DIV_ROUND_UP(length, 4), (uint8_t *)msg);
+	int retval = target_request_data(target, stream, DIV_ROUND_UP(length, 4), (uint8_t *)msg);
+	if (retval != ERROR_OK) {
+		free(msg);
+		return retval;
+	}
 	msg[length] = 0;
 
 	LOG_DEBUG("%s", msg);
@@ -49,6 +93,8 @@ static int target_asciimsg(struct target *target, uint32_t length)
 		c = c->next;
 	}
 
+	free(msg);
+
 	return ERROR_OK;
 }
 
@@ -59,7 +105,8 @@ static int target_charmsg(struct target *target, uint8_t msg)
 	return ERROR_OK;
 }
 
-static int target_hexmsg(struct target *target, int size, uint32_t length)
+static int target_hexmsg(struct target *target, struct target_request_stream *stream,
+		int size, uint32_t length)
 {
 	uint8_t *data = malloc(DIV_ROUND_UP(length * size, 4) * 4);
 	char line[128];
@@ -69,7 +116,11 @@ static int target_hexmsg(struct target *target, int size, uint32_t length)
 
 	LOG_DEBUG("size: %i, length: %i", (int)size, (int)length);
 
-	target->type->target_request_data(target, DIV_ROUND_UP(length * size, 4), (uint8_t *)data);
+	int retval = target_request_data(target, stream, DIV_ROUND_UP(length * size, 4), (uint8_t *)data);
+	if (retval != ERROR_OK) {
+		free(data);
+		return retval;
+	}
 
 	line_len = 0;
 	for (i = 0; i < length; i++) {
@@ -102,22 +153,16 @@ static int target_hexmsg(struct target *target, int size, uint32_t length)
 	return ERROR_OK;
 }
 
-/* handle requests from the target received by a target specific
- * side-band channel (e.g. ARM7/9 DCC)
- */
-int target_request(struct target *target, uint32_t request)
+static int target_request_decode(struct target *target, struct target_request_stream *stream,
+		uint32_t request)
 {
 	target_req_cmd_t target_req_cmd = request & 0xff;
 
-	assert(target->type->target_request_data);
-
 	/* Record that we got a target message for back-off algorithm */
 	got_message = true;
 
-	if (charmsg_mode) {
-		target_charmsg(target, target_req_cmd);
-		return ERROR_OK;
-	}
+	if (charmsg_mode)
+		return target_charmsg(target, target_req_cmd);
 
 	switch (target_req_cmd) {
 		case TARGET_REQ_TRACEMSG:
@@ -125,10 +170,9 @@ int target_request(struct target *target, uint32_t request)
 			break;
 		case TARGET_REQ_DEBUGMSG:
 			if (((request & 0xff00) >> 8) == 0)
-				target_asciimsg(target, (request & 0xffff0000) >> 16);
+				return target_asciimsg(target, stream, (request & 0xffff0000) >> 16);
 			else
-				target_hexmsg(target, (request & 0xff00) >> 8, (request & 0xffff0000) >> 16);
-			break;
+				return target_hexmsg(target, stream, (request & 0xff00) >> 8, (request & 0xffff0000) >> 16);
 		case TARGET_REQ_DEBUGCHAR:
 			target_charmsg(target, (request & 0x00ff0000) >> 16);
 			break;
@@ -143,6 +187,136 @@ int target_request(struct target *target, uint32_t request)
 	return ERROR_OK;
 }
 
+/* handle requests from the target received by a target specific
+ * side-band channel (e.g. ARM7/9 DCC)
+ */
+int target_request(struct target *target, uint32_t request)
+{
+	assert(target->type->target_request_data);
+
+	target_request_decode(target, NULL, request);
+
+	return ERROR_OK;
+}
+
+/* Drain everything the target queued in the ring: one read for the
+ * offsets, one or two (on wrap) for the data, one write for rd_off */
+static int target_request_ring_poll(void *priv)
+{
+	struct target *target = priv;
+	struct target_request_ring *ring = target->dbg_msg_ring;
+	uint8_t offsets[8];
+
+	if (!ring || !target->dbg_msg_enabled || !target_was_examined(target))
+		return ERROR_OK;
+
+	if (target->state != TARGET_RUNNING && target->state != TARGET_HALTED)
+		return ERROR_OK;
+
+	int retval = target_read_buffer(target, ring->address + TARGET_REQ_RING_WR_OFF,
+		sizeof(offsets), offsets);
+	if (retval != ERROR_OK)
+		return retval;
+
+	uint32_t wr_off = target_buffer_get_u32(target, offsets);
+	uint32_t rd_off = target_buffer_get_u32(target, offsets + 4);
+	if (wr_off == rd_off)
+		return ERROR_OK;
+
+	if (wr_off >= ring->size || rd_off >= ring->size || (wr_off | rd_off) & 3) {
+		LOG_TARGET_ERROR(target, "target_request ring corrupted (wr_off 0x%" PRIx32
+			", rd_off 0x%" PRIx32 ")", wr_off, rd_off);
+		return ERROR_FAIL;
+	}
+
+	target_addr_t data = ring->address + TARGET_REQ_RING_HDR_SIZE;
+	uint32_t pending;
+	if (wr_off > rd_off) {
+		pending = wr_off - rd_off;
+		retval = target_read_buffer(target, data + rd_off, pending, ring->buffer);
+	} else {
+		uint32_t first = ring->size - rd_off;
+		pending = first + wr_off;
+		retval = target_read_buffer(target, data + rd_off, first, ring->buffer);
+		if (retval == ERROR_OK && wr_off)
+			retval = target_read_buffer(target, data, wr_off, ring->buffer + first);
+	}
+	if (retval != ERROR_OK)
+		return retval;
+
+	struct target_request_stream stream = {
+		.data = ring->buffer,
+		.length = pending,
+	};
+	while (stream.length - stream.pos >= 4) {
+		uint32_t start = stream.pos;
+		uint32_t request = target_buffer_get_u32(target, stream.data + stream.pos);
+		stream.pos += 4;
+		if (target_request_decode(target, &stream, request) == ERROR_BUF_TOO_SMALL) {
+			/* payload not yet complete, leave the request in the ring */
+			stream.pos = start;
+			break;
+		}
+	}
+
+	if (!stream.pos)
+		return ERROR_OK;
+
+	target_buffer_set_u32(target, offsets, (rd_off + stream.pos) % ring->size);
+	return target_write_buffer(target, ring->address + TARGET_REQ_RING_RD_OFF, 4, offsets);
+}
+
+void target_request_ring_free(struct target *target)
+{
+	struct target_request_ring *ring = target->dbg_msg_ring;
+
+	if (!ring)
+		return;
+
+	target_unregister_timer_callback(target_request_ring_poll, target);
+	free(ring->buffer);
+	free(ring);
+	target->dbg_msg_ring = NULL;
+}
+
+static int target_request_ring_setup(struct target *target, target_addr_t address)
+{
+	uint8_t header[TARGET_REQ_RING_HDR_SIZE];
+
+	int retval = target_read_buffer(target, address, sizeof(header), header);
+	if (retval != ERROR_OK)
+		return retval;
+
+	uint32_t magic = target_buffer_get_u32(target, header);
+	uint32_t size = target_buffer_get_u32(target, header + 4);
+	if (magic != TARGET_REQ_RING_MAGIC) {
+		LOG_TARGET_ERROR(target, "no target_request ring at " TARGET_ADDR_FMT, address);
+		return ERROR_FAIL;
+	}
+	if (!size || size & 3) {
+		LOG_TARGET_ERROR(target, "invalid target_request ring size %" PRIu32, size);
+		return ERROR_FAIL;
+	}
+
+	struct target_request_ring *ring = calloc(1, sizeof(*ring));
+	uint8_t *buffer = malloc(size);
+	if (!ring || !buffer) {
+		free(ring);
+		free(buffer);
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	ring->address = address;
+	ring->size = size;
+	ring->buffer = buffer;
+
+	target_request_ring_free(target);
+	target->dbg_msg_ring = ring;
+
+	return target_register_timer_callback(target_request_ring_poll, TARGET_REQ_RING_POLL_MS,
+		TARGET_TIMER_TYPE_PERIODIC, target);
+}
+
 static int add_debug_msg_receiver(struct command_context *cmd_ctx, struct target *target)
 {
 	struct debug_msg_receiver **p = &target->dbgmsg;
@@ -245,7 +419,7 @@ COMMAND_HANDLER(handle_target_request_debugmsgs_command)
 
 	int receiving = 0;
 
-	if (!target->type->target_request_data) {
+	if (!target->type->target_request_data && !target->dbg_msg_ring) {
 		LOG_ERROR("Target %s does not support target requests", target_name(target));
 		return ERROR_OK;
 	}
@@ -277,6 +451,35 @@ COMMAND_HANDLER(handle_target_request_debugmsgs_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_target_request_ring_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		if (!strcmp(CMD_ARGV[0], "off")) {
+			target_request_ring_free(target);
+		} else {
+			target_addr_t address;
+			COMMAND_PARSE_ADDRESS(CMD_ARGV[0], address);
+			int retval = target_request_ring_setup(target, address);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+	}
+
+	struct target_request_ring *ring = target->dbg_msg_ring;
+	if (ring)
+		command_print(CMD, "target_request ring at " TARGET_ADDR_FMT ", %" PRIu32 " bytes",
+			ring->address, ring->size);
+	else
+		command_print(CMD, "target_request ring off");
+
+	return ERROR_OK;
+}
+
 static const struct command_registration target_req_exec_command_handlers[] = {
 	{
 		.name = "debugmsgs",
@@ -285,6 +488,13 @@ static const struct command_registration target_req_exec_command_handlers[] = {
 		.help = "display and/or modify reception of debug messages from target",
 		.usage = "['enable'|'charmsg'|'disable']",
 	},
+	{
+		.name = "ring",
+		.handler = handle_target_request_ring_command,
+		.mode = COMMAND_EXEC,
+		.help = "receive target requests from a ring in target memory",
+		.usage = "[address|'off']",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 static const struct command_registration target_req_command_handlers[] = {
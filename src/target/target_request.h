@@ -33,6 +33,7 @@ int target_request(struct target *target, uint32_t request);
 int delete_debug_msg_receiver(struct command_context *cmd_ctx,
 		struct target *target);
 int target_request_register_commands(struct command_context *cmd_ctx);
+void target_request_ring_free(struct target *target);
 /**
  * Read and clear the flag as to whether we got a message.
  *
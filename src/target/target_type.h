@@ -106,6 +106,15 @@ struct target_type {
 			struct reg **reg_list[], int *reg_list_size,
 			enum target_register_class reg_class);
 
+	/**
+	 * Optional. Fill all invalid registers of the class in the register
+	 * cache in one batch instead of one round trip per register. Valid
+	 * and dirty registers are left untouched. Do @b not call this function
+	 * directly, use target_read_all_core_regs() instead.
+	 */
+	int (*read_all_core_regs)(struct target *target,
+			enum target_register_class reg_class);
+
 	/* target memory access
 	* size: 1 = byte (8bit), 2 = half-word (16bit), 4 = word (32bit)
 	* count: number of items of <size>
@@ -123,6 +132,15 @@ struct target_type {
 	 */
 	int (*write_memory)(struct target *target, target_addr_t address,
 			uint32_t size, uint32_t count, const uint8_t *buffer);
+	/**
+	 * Optional callbacks reading or writing several memory ranges at once.
+	 * Do @b not call them directly, use target_read_memory_sg() and
+	 * target_write_memory_sg() instead.
+	 */
+	int (*read_memory_sg)(struct target *target,
+			struct target_memory_sg *ranges, unsigned int num_ranges);
+	int (*write_memory_sg)(struct target *target,
+			const struct target_memory_sg *ranges, unsigned int num_ranges);
 
 	/* Default implementation will do some fancy alignment to improve performance, target can override */
 	int (*read_buffer)(struct target *target, target_addr_t address,
@@ -132,11 +150,41 @@ struct target_type {
 	int (*write_buffer)(struct target *target, target_addr_t address,
 			uint32_t size, const uint8_t *buffer);
 
+	/**
+	 * Optional callback writing @a buffer to RAM, sending it compressed
+	 * and letting code on the target expand it. Do @b not call this
+	 * function directly, use target_write_buffer_compressed() instead.
+	 */
+	int (*write_buffer_compressed)(struct target *target, target_addr_t address,
+			uint32_t size, const uint8_t *buffer);
+
 	int (*checksum_memory)(struct target *target, target_addr_t address,
 			uint32_t count, uint32_t *checksum);
 	int (*blank_check_memory)(struct target *target,
 			struct target_memory_check_block *blocks, int num_blocks,
 			uint8_t erased_value);
+	/**
+	 * Optional callback finding the first occurrence of @a pattern in
+	 * memory by running code on the target. Do @b not call this function
+	 * directly, use target_search_memory() instead.
+	 */
+	int (*search_memory)(struct target *target, target_addr_t address,
+			uint32_t size, const uint8_t *pattern, uint32_t length,
+			target_addr_t *match, bool *found);
+	/**
+	 * Optional callback filling @a count words at @a address with
+	 * @a pattern by running code on the target. Do @b not call this
+	 * function directly, use target_fill_memory() instead.
+	 */
+	int (*fill_memory)(struct target *target, target_addr_t address,
+			uint32_t pattern, uint32_t count);
+	/**
+	 * Optional callback copying @a count words from @a src to @a dst, from
+	 * the lowest address up, by running code on the target. Do @b not call
+	 * this function directly, use target_copy_memory() instead.
+	 */
+	int (*copy_memory)(struct target *target, target_addr_t dst,
+			target_addr_t src, uint32_t count);
 
 	/*
 	 * target break-/watchpoint control
@@ -183,23 +183,28 @@ static int read_phys_mem(struct target *t, uint32_t phys_address,
 		pg_disabled = true;
 	}
 
-	for (uint32_t i = 0; i < count; i++) {
-		switch (size) {
-		case BYTE:
-			retval = read_mem(t, size, phys_address + i, buffer + i);
-			break;
-		case WORD:
-			retval = read_mem(t, size, phys_address + i * 2, buffer + i * 2);
-			break;
-		case DWORD:
-			retval = read_mem(t, size, phys_address + i * 4, buffer + i * 4);
-			break;
-		default:
-			LOG_ERROR("%s invalid read size", __func__);
-			break;
+	if (x86_32->read_mem_block && (size == BYTE || size == WORD || size == DWORD)) {
+		/* all the units through the probe mode instructions at once */
+		retval = x86_32->read_mem_block(t, size, phys_address, count, buffer);
+	} else {
+		for (uint32_t i = 0; i < count; i++) {
+			switch (size) {
+			case BYTE:
+				retval = read_mem(t, size, phys_address + i, buffer + i);
+				break;
+			case WORD:
+				retval = read_mem(t, size, phys_address + i * 2, buffer + i * 2);
+				break;
+			case DWORD:
+				retval = read_mem(t, size, phys_address + i * 4, buffer + i * 4);
+				break;
+			default:
+				LOG_ERROR("%s invalid read size", __func__);
+				break;
+			}
+			if (retval != ERROR_OK)
+				break;
 		}
-		if (retval != ERROR_OK)
-			break;
 	}
 	/* restore CR0.PG bit if needed (regardless of retval) */
 	if (pg_disabled) {
@@ -1281,6 +1286,7 @@ void x86_32_common_reset_breakpoints_watchpoints(struct target *t)
 		free(t->breakpoints);
 		t->breakpoints = next_b;
 	}
+	breakpoint_index_reset(t);
 
 	while (t->watchpoints) {
 		next_w = t->watchpoints->next;
@@ -231,6 +231,9 @@ struct x86_32_common {
 	int (*read_hw_reg)(struct target *t, int reg, uint32_t *regval, uint8_t cache);
 	int (*write_hw_reg)(struct target *t, int reg,
 				uint32_t regval, uint8_t cache);
+	/* optional, read count units of size bytes at once */
+	int (*read_mem_block)(struct target *t, uint32_t size, uint32_t addr,
+				uint32_t count, uint8_t *buf);
 
 	/* register cache to processor synchronization */
 	int (*read_hw_reg_to_cache)(struct target *target, int num);
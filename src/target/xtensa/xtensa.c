@@ -548,6 +548,14 @@ static void xtensa_queue_exec_ins_wide(struct xtensa *xtensa, uint8_t *ops, uint
 	}
 }
 
+/* Execute the queue with a DSR read at its end, so that the
+ * xtensa_core_status_check() that follows needs no round trip of its own. */
+static int xtensa_queue_execute_status(struct xtensa *xtensa)
+{
+	xtensa_dm_queue_core_status_read(&xtensa->dbg_mod);
+	return xtensa_dm_queue_execute(&xtensa->dbg_mod);
+}
+
 /* NOTE: Assumes A3 has already been saved and marked dirty; A3 will be clobbered */
 static inline bool xtensa_region_ar_exec(struct target *target, target_addr_t start, target_addr_t end)
 {
@@ -566,7 +574,7 @@ static inline bool xtensa_region_ar_exec(struct target *target, target_addr_t st
 			xtensa_queue_exec_ins(xtensa, XT_INS_PPTLB(xtensa, XT_REG_A3, XT_REG_A3));
 			xtensa_queue_exec_ins(xtensa, XT_INS_WSR(xtensa, XT_SR_DDR, XT_REG_A3));
 			xtensa_queue_dbg_reg_read(xtensa, XDMREG_DDR, at_buf);
-			int res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+			int res = xtensa_queue_execute_status(xtensa);
 			if (res != ERROR_OK)
 				LOG_TARGET_ERROR(target, "Error queuing PPTLB: %d", res);
 			res = xtensa_core_status_check(target);
@@ -605,7 +613,7 @@ static int xtensa_window_state_save(struct target *target, uint32_t *woe)
 		xtensa_queue_exec_ins(xtensa, XT_INS_RSR(xtensa, woe_sr, XT_REG_A3));
 		xtensa_queue_exec_ins(xtensa, XT_INS_WSR(xtensa, XT_SR_DDR, XT_REG_A3));
 		xtensa_queue_dbg_reg_read(xtensa, XDMREG_DDR, woe_buf);
-		int res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+		int res = xtensa_queue_execute_status(xtensa);
 		if (res != ERROR_OK) {
 			LOG_TARGET_ERROR(target, "Failed to read %s (%d)!",
 				(woe_sr == XT_SR_PS) ? "PS" : "WB", res);
@@ -749,7 +757,7 @@ static int xtensa_write_dirty_registers(struct target *target)
 		/* Save (windowed) A3 for scratch use */
 		xtensa_queue_exec_ins(xtensa, XT_INS_WSR(xtensa, XT_SR_DDR, XT_REG_A3));
 		xtensa_queue_dbg_reg_read(xtensa, XDMREG_DDR, a3_buf);
-		res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+		res = xtensa_queue_execute_status(xtensa);
 		if (res != ERROR_OK)
 			return res;
 		xtensa_core_status_check(target);
@@ -871,7 +879,7 @@ static int xtensa_write_dirty_registers(struct target *target)
 		xtensa_queue_exec_ins(xtensa, XT_INS_RSR(xtensa, XT_SR_DDR, XT_REG_A3));
 	}
 
-	res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+	res = xtensa_queue_execute_status(xtensa);
 	xtensa_core_status_check(target);
 
 	return res;
@@ -1293,7 +1301,7 @@ int xtensa_fetch_all_regs(struct target *target)
 		xtensa_queue_exec_ins(xtensa, XT_INS_WSR(xtensa, XT_SR_DDR, XT_REG_A3));
 		xtensa_queue_dbg_reg_read(xtensa, XDMREG_DDR, regvals[XT_REG_IDX_CPENABLE].buf);
 	}
-	res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+	res = xtensa_queue_execute_status(xtensa);
 	if (res != ERROR_OK) {
 		LOG_ERROR("Failed to read ARs (%d)!", res);
 		goto xtensa_fetch_all_regs_done;
@@ -1372,7 +1380,7 @@ int xtensa_fetch_all_regs(struct target *target)
 		}
 	}
 	/* Ok, send the whole mess to the CPU. */
-	res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+	res = xtensa_queue_execute_status(xtensa);
 	if (res != ERROR_OK) {
 		LOG_ERROR("Failed to fetch AR regs!");
 		goto xtensa_fetch_all_regs_done;
@@ -1661,7 +1669,7 @@ int xtensa_do_resume(struct target *target)
 
 	xtensa_cause_reset(target);
 	xtensa_queue_exec_ins(xtensa, XT_INS_RFDO(xtensa));
-	int res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+	int res = xtensa_queue_execute_status(xtensa);
 	if (res != ERROR_OK) {
 		LOG_TARGET_ERROR(target, "Failed to exec RFDO %d!", res);
 		return res;
@@ -2042,14 +2050,18 @@ int xtensa_read_memory(struct target *target, target_addr_t address, uint32_t si
 	} else {
 		xtensa_mark_register_dirty(xtensa, XT_REG_IDX_A4);
 		for (unsigned int i = 0; adr != addrend_al; i += sizeof(uint32_t), adr += sizeof(uint32_t)) {
-			xtensa_queue_exec_ins(xtensa, XT_INS_L32I(xtensa, XT_REG_A3, XT_REG_A4, 0));
+			/* L32I reaches 255 words past A3, so A3 is only moved every 1 KiB */
+			unsigned int offset = (i / sizeof(uint32_t)) % 256;
+			if (offset == 0 && i != 0) {
+				xtensa_queue_dbg_reg_write(xtensa, XDMREG_DDR, adr);
+				xtensa_queue_exec_ins(xtensa, XT_INS_RSR(xtensa, XT_SR_DDR, XT_REG_A3));
+			}
+			xtensa_queue_exec_ins(xtensa, XT_INS_L32I(xtensa, XT_REG_A3, XT_REG_A4, offset));
 			xtensa_queue_exec_ins(xtensa, XT_INS_WSR(xtensa, XT_SR_DDR, XT_REG_A4));
 			xtensa_queue_dbg_reg_read(xtensa, XDMREG_DDR, &albuff[i]);
-			xtensa_queue_dbg_reg_write(xtensa, XDMREG_DDR, adr + sizeof(uint32_t));
-			xtensa_queue_exec_ins(xtensa, XT_INS_RSR(xtensa, XT_SR_DDR, XT_REG_A3));
 		}
 	}
-	int res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+	int res = xtensa_queue_execute_status(xtensa);
 	if (res == ERROR_OK) {
 		bool prev_suppress = xtensa->suppress_dsr_errors;
 		xtensa->suppress_dsr_errors = true;
@@ -2165,7 +2177,7 @@ int xtensa_write_memory(struct target *target,
 				&albuff[addrend_al - addrstart_al - 4]);
 		}
 		/* Grab bytes */
-		res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+		res = xtensa_queue_execute_status(xtensa);
 		if (res != ERROR_OK) {
 			LOG_ERROR("Error issuing unaligned memory write context instruction(s): %d", res);
 			if (albuff != buffer)
@@ -2220,7 +2232,7 @@ int xtensa_write_memory(struct target *target,
 		}
 	}
 
-	res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+	res = xtensa_queue_execute_status(xtensa);
 	if (res == ERROR_OK) {
 		bool prev_suppress = xtensa->suppress_dsr_errors;
 		xtensa->suppress_dsr_errors = true;
@@ -2271,7 +2283,7 @@ int xtensa_write_memory(struct target *target,
 			}
 
 			/* Execute cache WB/INV instructions */
-			res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+			res = xtensa_queue_execute_status(xtensa);
 			if (res != ERROR_OK)
 				LOG_TARGET_ERROR(target,
 					"Error queuing cache writeback/invaldate instruction(s): %d",
@@ -2400,7 +2412,7 @@ int xtensa_poll(struct target *target)
 				xtensa_queue_dbg_reg_write(xtensa, XDMREG_DDR, newps);
 				xtensa_queue_exec_ins(xtensa, XT_INS_RSR(xtensa, XT_SR_DDR, XT_REG_A3));
 				xtensa_queue_exec_ins(xtensa, XT_INS_WSR(xtensa, XT_SR_PS, XT_REG_A3));
-				res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+				res = xtensa_queue_execute_status(xtensa);
 				if (res != ERROR_OK) {
 					LOG_TARGET_ERROR(target, "Failed to write PS.DIEXC (%d)!", res);
 					return res;
@@ -2479,7 +2491,7 @@ static int xtensa_update_instruction(struct target *target, target_addr_t addres
 		}
 
 		/* Execute invalidate instructions */
-		ret = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+		ret = xtensa_queue_execute_status(xtensa);
 		xtensa_core_status_check(target);
 		if (ret != ERROR_OK) {
 			LOG_ERROR("Error issuing cache invaldate instruction(s): %d", ret);
@@ -2506,7 +2518,7 @@ static int xtensa_update_instruction(struct target *target, target_addr_t addres
 		}
 
 		/* Execute invalidate instructions */
-		ret = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+		ret = xtensa_queue_execute_status(xtensa);
 		xtensa_core_status_check(target);
 	}
 
@@ -3211,7 +3223,7 @@ static int xtensa_gdbqc_qxtreg(struct target *target, const char *packet, char *
 	/* Restore a4 but not yet spill memory.  Execute it all... */
 	xtensa_queue_dbg_reg_write(xtensa, XDMREG_DDR, orig_a4);
 	xtensa_queue_exec_ins(xtensa, XT_INS_RSR(xtensa, XT_SR_DDR, XT_REG_A4));
-	status = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+	status = xtensa_queue_execute_status(xtensa);
 	if (status != ERROR_OK) {
 		LOG_TARGET_ERROR(target, "TIE queue execute: %d\n", status);
 		tieop_status = status;
@@ -3569,7 +3581,7 @@ static COMMAND_HELPER(xtensa_cmd_exe_do, struct target *target)
 	/* Queue instruction list and execute everything */
 	LOG_TARGET_DEBUG(target, "execute stub: %s", CMD_ARGV[0]);
 	xtensa_queue_exec_ins_wide(xtensa, ops, oplen);	/* Handles endian-swap */
-	status = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+	status = xtensa_queue_execute_status(xtensa);
 	if (status != ERROR_OK) {
 		command_print(CMD, "exec: queue error %d", status);
 	} else {
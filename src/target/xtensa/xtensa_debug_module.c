@@ -274,10 +274,28 @@ int xtensa_dm_power_status_read(struct xtensa_debug_module *dm, uint32_t clear)
 	return res;
 }
 
+/* Queue a DSR read as the last operation of the pending queue. Once the queue
+ * is executed, the next xtensa_dm_core_status_read() uses its result instead
+ * of another round trip. */
+void xtensa_dm_queue_core_status_read(struct xtensa_debug_module *dm)
+{
+	xtensa_dm_queue_enable(dm);
+	dm->dbg_ops->queue_reg_read(dm, XDMREG_DSR, dm->core_status.dsr_buf);
+	xtensa_dm_queue_tdi_idle(dm);
+	dm->core_status.dsr_queued = true;
+}
+
 int xtensa_dm_core_status_read(struct xtensa_debug_module *dm)
 {
 	uint8_t dsr_buf[sizeof(uint32_t)];
 
+	/* A busy core may have finished since, so read again in that case */
+	if (dm->core_status.dsr_fresh) {
+		dm->core_status.dsr_fresh = false;
+		if (!(dm->core_status.dsr & OCDDSR_EXECBUSY))
+			return ERROR_OK;
+	}
+
 	xtensa_dm_queue_enable(dm);
 	dm->dbg_ops->queue_reg_read(dm, XDMREG_DSR, dsr_buf);
 	xtensa_dm_queue_tdi_idle(dm);
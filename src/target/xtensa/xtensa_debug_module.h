@@ -429,6 +429,11 @@ struct xtensa_power_status {
 
 struct xtensa_core_status {
 	xtensa_dsr_t dsr;
+	/* DSR read queued at the end of the pending queue */
+	uint8_t dsr_buf[4];
+	bool dsr_queued;
+	/* dsr was read by the last queue execution */
+	bool dsr_fresh;
 };
 
 struct xtensa_trace_config {
@@ -518,7 +523,12 @@ int xtensa_dm_queue_pwr_reg_write(struct xtensa_debug_module *dm,
 
 static inline int xtensa_dm_queue_execute(struct xtensa_debug_module *dm)
 {
-	return dm->dap ? dap_run(dm->dap) : jtag_execute_queue();
+	int res = dm->dap ? dap_run(dm->dap) : jtag_execute_queue();
+	dm->core_status.dsr_fresh = res == ERROR_OK && dm->core_status.dsr_queued;
+	if (dm->core_status.dsr_fresh)
+		dm->core_status.dsr = buf_get_u32(dm->core_status.dsr_buf, 0, 32);
+	dm->core_status.dsr_queued = false;
+	return res;
 }
 
 static inline void xtensa_dm_queue_tdi_idle(struct xtensa_debug_module *dm)
@@ -542,6 +552,7 @@ static inline xtensa_pwrstat_t xtensa_dm_power_status_get(struct xtensa_debug_mo
 }
 
 int xtensa_dm_core_status_read(struct xtensa_debug_module *dm);
+void xtensa_dm_queue_core_status_read(struct xtensa_debug_module *dm);
 int xtensa_dm_core_status_clear(struct xtensa_debug_module *dm, xtensa_dsr_t bits);
 int xtensa_dm_core_status_check(struct xtensa_debug_module *dm);
 static inline xtensa_dsr_t xtensa_dm_core_status_get(struct xtensa_debug_module *dm)
@@ -111,6 +111,38 @@ TDO  (1);
 
 static int xsvf_fd;
 
+/* buffered input, the file is read in large chunks instead of byte by byte */
+#define XSVF_READ_BUFFER_SIZE 65536
+static uint8_t xsvf_read_buf[XSVF_READ_BUFFER_SIZE];
+static size_t xsvf_read_pos, xsvf_read_len;
+static long xsvf_offset;	/* file offset of the next byte to be read */
+
+/*
+ * TDO checks of queued scans, verified after the queue is run.
+ * The buffers are owned by the check.
+ */
+struct xsvf_check {
+	long file_offset;
+	const char *op_name;
+	int num_bits;
+	uint8_t *in;
+	uint8_t *expected;
+	uint8_t *mask;
+};
+
+static struct xsvf_check *xsvf_checks;
+static unsigned int xsvf_num_checks, xsvf_checks_size;
+
+/* TDI/TDO of an XSDRB/XSDRC/XSDRE sequence, shifted as one scan */
+struct xsvf_dr_chain {
+	uint8_t *out;
+	uint8_t *expected;
+	uint8_t *mask;
+	int num_bits;
+	bool check;
+	long file_offset;	/* offset of the XSDRB or XSDRTDOB */
+};
+
 /* map xsvf tap state to an openocd "tap_state_t" */
 static tap_state_t xsvf_to_tap(int xsvf_state)
 {
@@ -173,16 +205,173 @@ static tap_state_t xsvf_to_tap(int xsvf_state)
 	return ret;
 }
 
-static int xsvf_read_buffer(int num_bits, int fd, uint8_t *buf)
+static int xsvf_read(void *data, size_t size)
+{
+	uint8_t *p = data;
+
+	while (size) {
+		if (xsvf_read_pos == xsvf_read_len) {
+			ssize_t len = read(xsvf_fd, xsvf_read_buf, sizeof(xsvf_read_buf));
+			if (len <= 0)
+				return ERROR_XSVF_EOF;
+			xsvf_read_pos = 0;
+			xsvf_read_len = len;
+		}
+
+		size_t chunk = MIN(size, xsvf_read_len - xsvf_read_pos);
+		memcpy(p, xsvf_read_buf + xsvf_read_pos, chunk);
+		xsvf_read_pos += chunk;
+		xsvf_offset += chunk;
+		p += chunk;
+		size -= chunk;
+	}
+
+	return ERROR_OK;
+}
+
+static int xsvf_read_buffer(int num_bits, uint8_t *buf)
+{
+	int num_bytes = (num_bits + 7) / 8;
+
+	if (xsvf_read(buf, num_bytes) != ERROR_OK)
+		return ERROR_XSVF_EOF;
+
+	/* reverse the order of bytes as they are read sequentially from file */
+	for (int i = 0; i < num_bytes / 2; i++) {
+		uint8_t tmp = buf[i];
+		buf[i] = buf[num_bytes - 1 - i];
+		buf[num_bytes - 1 - i] = tmp;
+	}
+
+	return ERROR_OK;
+}
+
+static uint8_t *xsvf_memdup(const uint8_t *buf, int num_bits)
+{
+	uint8_t *copy;
+
+	if (!buf)
+		return NULL;
+
+	copy = malloc(DIV_ROUND_UP(num_bits, 8));
+	if (copy)
+		memcpy(copy, buf, DIV_ROUND_UP(num_bits, 8));
+	return copy;
+}
+
+static void xsvf_free_checks(void)
+{
+	for (unsigned int i = 0; i < xsvf_num_checks; i++) {
+		free(xsvf_checks[i].in);
+		free(xsvf_checks[i].expected);
+		free(xsvf_checks[i].mask);
+	}
+	xsvf_num_checks = 0;
+}
+
+/*
+ * Queue a TDO check for xsvf_execute_queue(). The check takes @a in, which
+ * must stay valid until the queue is run, and copies @a expected and @a mask.
+ */
+static int xsvf_add_check(long file_offset, const char *op_name, int num_bits,
+		uint8_t *in, const uint8_t *expected, const uint8_t *mask)
+{
+	if (xsvf_num_checks == xsvf_checks_size) {
+		unsigned int size = xsvf_checks_size ? 2 * xsvf_checks_size : 64;
+		struct xsvf_check *checks = realloc(xsvf_checks, size * sizeof(*checks));
+		if (!checks) {
+			LOG_ERROR("Out of memory");
+			free(in);
+			return ERROR_FAIL;
+		}
+		xsvf_checks = checks;
+		xsvf_checks_size = size;
+	}
+
+	struct xsvf_check *check = &xsvf_checks[xsvf_num_checks++];
+	check->file_offset = file_offset;
+	check->op_name = op_name;
+	check->num_bits = num_bits;
+	check->in = in;
+	check->expected = xsvf_memdup(expected, num_bits);
+	check->mask = xsvf_memdup(mask, num_bits);
+
+	if ((expected && !check->expected) || (mask && !check->mask)) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
+/*
+ * Run the JTAG queue and verify the queued TDO checks. On a mismatch
+ * @a file_offset is set to the offset of the failing instruction.
+ */
+static int xsvf_execute_queue(long *file_offset)
 {
-	int num_bytes;
+	int retval = jtag_execute_queue();
+
+	for (unsigned int i = 0; i < xsvf_num_checks && retval == ERROR_OK; i++) {
+		struct xsvf_check *check = &xsvf_checks[i];
+		bool mismatch;
 
-	for (num_bytes = (num_bits + 7) / 8; num_bytes > 0; num_bytes--) {
-		/* reverse the order of bytes as they are read sequentially from file */
-		if (read(fd, buf + num_bytes - 1, 1) < 0)
-			return ERROR_XSVF_EOF;
+		if (!check->expected || !check->num_bits)
+			continue;
+
+		if (check->mask)
+			mismatch = buf_cmp_mask(check->in, check->expected, check->mask, check->num_bits);
+		else
+			mismatch = buf_cmp(check->in, check->expected, check->num_bits);
+
+		if (mismatch) {
+			LOG_USER("%s mismatch", check->op_name);
+			*file_offset = check->file_offset;
+			retval = ERROR_FAIL;
+		}
 	}
 
+	xsvf_free_checks();
+	return retval;
+}
+
+static void xsvf_dr_chain_free(struct xsvf_dr_chain *chain)
+{
+	free(chain->out);
+	free(chain->expected);
+	free(chain->mask);
+	memset(chain, 0, sizeof(*chain));
+}
+
+/* Append a segment to the chain, @a expected and @a mask are NULL if it is not checked */
+static int xsvf_dr_chain_append(struct xsvf_dr_chain *chain, const uint8_t *out,
+		const uint8_t *expected, const uint8_t *mask, int num_bits)
+{
+	if (num_bits <= 0)
+		return ERROR_OK;
+
+	size_t old_size = DIV_ROUND_UP(chain->num_bits, 8);
+	size_t new_size = DIV_ROUND_UP(chain->num_bits + num_bits, 8);
+	uint8_t **bufs[] = { &chain->out, &chain->expected, &chain->mask };
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(bufs); i++) {
+		uint8_t *buf = realloc(*bufs[i], new_size);
+		if (!buf) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		memset(buf + old_size, 0, new_size - old_size);
+		*bufs[i] = buf;
+	}
+
+	buf_set_buf(out, 0, chain->out, chain->num_bits, num_bits);
+	if (expected) {
+		buf_set_buf(expected, 0, chain->expected, chain->num_bits, num_bits);
+		buf_set_buf(mask, 0, chain->mask, chain->num_bits, num_bits);
+		chain->check = true;
+	}
+	chain->num_bits += num_bits;
+
 	return ERROR_OK;
 }
 
@@ -219,6 +408,8 @@ COMMAND_HANDLER(handle_xsvf_command)
 	tap_state_t path[XSTATE_MAX_PATH];
 	unsigned pathlen = 0;
 
+	struct xsvf_dr_chain dr_chain = { 0 };
+
 	/* a flag telling whether to clock TCK during waits,
 	 * or simply sleep, controlled by virt2
 	 */
@@ -249,6 +440,10 @@ COMMAND_HANDLER(handle_xsvf_command)
 		command_print(CMD, "file \"%s\" not found", filename);
 		return ERROR_FAIL;
 	}
+	xsvf_read_pos = 0;
+	xsvf_read_len = 0;
+	xsvf_offset = 0;
+	xsvf_free_checks();
 
 	/* if this argument is present, then interpret xruntest counts as TCK cycles rather than as
 	 *usecs */
@@ -264,9 +459,9 @@ COMMAND_HANDLER(handle_xsvf_command)
 	LOG_WARNING("XSVF support in OpenOCD is limited. Consider using SVF instead");
 	LOG_USER("xsvf processing file: \"%s\"", filename);
 
-	while (read(xsvf_fd, &opcode, 1) > 0) {
+	while (xsvf_read(&opcode, 1) == ERROR_OK) {
 		/* record the position of this opcode within the file */
-		file_offset = lseek(xsvf_fd, 0, SEEK_CUR) - 1;
+		file_offset = xsvf_offset - 1;
 
 		/* maybe collect another state for a pathmove();
 		 * or terminate a path.
@@ -286,7 +481,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 						break;
 					}
 
-					if (read(xsvf_fd, &uc, 1) < 0) {
+					if (xsvf_read(&uc, 1) != ERROR_OK) {
 						do_abort = 1;
 						break;
 					}
@@ -334,7 +529,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 					else
 						jtag_add_pathmove(pathlen, path);
 
-					result = jtag_execute_queue();
+					result = xsvf_execute_queue(&file_offset);
 					if (result != ERROR_OK) {
 						LOG_ERROR("XSVF: pathmove error %d", result);
 						do_abort = 1;
@@ -348,7 +543,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 			case XCOMPLETE:
 				LOG_DEBUG("XCOMPLETE");
 
-				result = jtag_execute_queue();
+				result = xsvf_execute_queue(&file_offset);
 				if (result != ERROR_OK) {
 					tdo_mismatch = 1;
 					break;
@@ -358,7 +553,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 			case XTDOMASK:
 				LOG_DEBUG("XTDOMASK");
 				if (dr_in_mask &&
-						(xsvf_read_buffer(xsdrsize, xsvf_fd, dr_in_mask) != ERROR_OK))
+						(xsvf_read_buffer(xsdrsize, dr_in_mask) != ERROR_OK))
 					do_abort = 1;
 				break;
 
@@ -366,7 +561,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 			{
 				uint8_t xruntest_buf[4];
 
-				if (read(xsvf_fd, xruntest_buf, 4) < 0) {
+				if (xsvf_read(xruntest_buf, 4) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
@@ -380,7 +575,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 			{
 				uint8_t myrepeat;
 
-				if (read(xsvf_fd, &myrepeat, 1) < 0)
+				if (xsvf_read(&myrepeat, 1) != ERROR_OK)
 					do_abort = 1;
 				else {
 					xrepeat = myrepeat;
@@ -393,7 +588,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 			{
 				uint8_t xsdrsize_buf[4];
 
-				if (read(xsvf_fd, xsdrsize_buf, 4) < 0) {
+				if (xsvf_read(xsdrsize_buf, 4) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
@@ -420,14 +615,13 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 				const char *op_name = (opcode == XSDR ? "XSDR" : "XSDRTDO");
 
-				if (xsvf_read_buffer(xsdrsize, xsvf_fd, dr_out_buf) != ERROR_OK) {
+				if (xsvf_read_buffer(xsdrsize, dr_out_buf) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
 
 				if (opcode == XSDRTDO) {
-					if (xsvf_read_buffer(xsdrsize, xsvf_fd,
-						dr_in_buf)  != ERROR_OK) {
+					if (xsvf_read_buffer(xsdrsize, dr_in_buf)  != ERROR_OK) {
 						do_abort = 1;
 						break;
 					}
@@ -438,7 +632,44 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 				LOG_DEBUG("%s %d", op_name, xsdrsize);
 
-				for (attempt = 0; attempt < limit; ++attempt) {
+				if (limit == 1) {
+					/* no retry, the TDO check can wait for the next flush */
+					struct scan_field field = {
+						.num_bits = xsdrsize,
+						.out_value = dr_out_buf,
+						.in_value = calloc(DIV_ROUND_UP(xsdrsize, 8), 1),
+					};
+
+					if (!field.in_value) {
+						LOG_ERROR("Out of memory");
+						do_abort = 1;
+						break;
+					}
+
+					if (!tap)
+						jtag_add_plain_dr_scan(field.num_bits,
+								field.out_value,
+								field.in_value,
+								TAP_DRPAUSE);
+					else
+						jtag_add_dr_scan(tap, 1, &field, TAP_DRPAUSE);
+
+					if (xsvf_add_check(file_offset, op_name, xsdrsize, field.in_value,
+							dr_in_buf, dr_in_mask) != ERROR_OK) {
+						do_abort = 1;
+						break;
+					}
+					matched = 1;
+				} else {
+					/* the retry sequence depends on the outcome of this scan */
+					result = xsvf_execute_queue(&file_offset);
+					if (result != ERROR_OK) {
+						tdo_mismatch = 1;
+						break;
+					}
+				}
+
+				for (attempt = 0; attempt < limit && !matched; ++attempt) {
 					struct scan_field field;
 
 					if (attempt > 0) {
@@ -532,40 +763,81 @@ COMMAND_HANDLER(handle_xsvf_command)
 				break;
 
 			case XSDRB:
-				LOG_ERROR("unsupported XSDRB");
-				unsupported = 1;
-				break;
-
 			case XSDRC:
-				LOG_ERROR("unsupported XSDRC");
-				unsupported = 1;
-				break;
-
 			case XSDRE:
-				LOG_ERROR("unsupported XSDRE");
-				unsupported = 1;
-				break;
-
 			case XSDRTDOB:
-				LOG_ERROR("unsupported XSDRTDOB");
-				unsupported = 1;
-				break;
-
 			case XSDRTDOC:
-				LOG_ERROR("unsupported XSDRTDOC");
-				unsupported = 1;
-				break;
-
 			case XSDRTDOE:
-				LOG_ERROR("unsupported XSDRTDOE");
-				unsupported = 1;
-				break;
+			{
+				/* The segments stay in Shift-DR until the E variant, so they
+				 * are collected and shifted as a single scan. */
+				bool tdo = (opcode >= XSDRTDOB);
+				uint8_t segment = tdo ? opcode - XSDRTDOB : opcode - XSDRB;
+				static const char * const op_names[] = {
+					"XSDRB", "XSDRC", "XSDRE", "XSDRTDOB", "XSDRTDOC", "XSDRTDOE",
+				};
+				const char *op_name = op_names[opcode - XSDRB];
+
+				if (xsvf_read_buffer(xsdrsize, dr_out_buf) != ERROR_OK ||
+						(tdo && xsvf_read_buffer(xsdrsize, dr_in_buf) != ERROR_OK)) {
+					do_abort = 1;
+					break;
+				}
+
+				LOG_DEBUG("%s %d", op_name, xsdrsize);
+
+				if (segment == 0) {
+					xsvf_dr_chain_free(&dr_chain);
+					dr_chain.file_offset = file_offset;
+				}
+
+				if (xsvf_dr_chain_append(&dr_chain, dr_out_buf,
+						tdo ? dr_in_buf : NULL, tdo ? dr_in_mask : NULL,
+						xsdrsize) != ERROR_OK) {
+					do_abort = 1;
+					break;
+				}
+
+				if (segment < 2)
+					break;
+
+				struct scan_field field = {
+					.num_bits = dr_chain.num_bits,
+					.out_value = dr_chain.out,
+				};
+
+				if (dr_chain.check) {
+					field.in_value = calloc(DIV_ROUND_UP(field.num_bits, 8), 1);
+					if (!field.in_value) {
+						LOG_ERROR("Out of memory");
+						do_abort = 1;
+						break;
+					}
+				}
+
+				if (!tap)
+					jtag_add_plain_dr_scan(field.num_bits,
+							field.out_value,
+							field.in_value,
+							xenddr);
+				else
+					jtag_add_dr_scan(tap, 1, &field, xenddr);
+
+				if (dr_chain.check && xsvf_add_check(dr_chain.file_offset, op_name,
+						field.num_bits, field.in_value,
+						dr_chain.expected, dr_chain.mask) != ERROR_OK)
+					do_abort = 1;
+
+				/* the queue keeps its own copy of the TDI bits */
+				xsvf_dr_chain_free(&dr_chain);
+			}
+			break;
 
 			case XSTATE:
 			{
 				tap_state_t mystate;
 
-				if (read(xsvf_fd, &uc, 1) < 0) {
+				if (xsvf_read(&uc, 1) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
@@ -608,7 +880,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 			case XENDIR:
 
-				if (read(xsvf_fd, &uc, 1) < 0) {
+				if (xsvf_read(&uc, 1) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
@@ -629,7 +901,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 			case XENDDR:
 
-				if (read(xsvf_fd, &uc, 1) < 0) {
+				if (xsvf_read(&uc, 1) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
@@ -658,14 +930,14 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 				if (opcode == XSIR) {
 					/* one byte bitcount */
-					if (read(xsvf_fd, short_buf, 1) < 0) {
+					if (xsvf_read(short_buf, 1) != ERROR_OK) {
 						do_abort = 1;
 						break;
 					}
 					bitcount = short_buf[0];
 					LOG_DEBUG("XSIR %d", bitcount);
 				} else {
-					if (read(xsvf_fd, short_buf, 2) < 0) {
+					if (xsvf_read(short_buf, 2) != ERROR_OK) {
 						do_abort = 1;
 						break;
 					}
@@ -675,7 +947,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 				ir_buf = malloc((bitcount + 7) / 8);
 
-				if (xsvf_read_buffer(bitcount, xsvf_fd, ir_buf) != ERROR_OK)
+				if (xsvf_read_buffer(bitcount, ir_buf) != ERROR_OK)
 					do_abort = 1;
 				else {
 					struct scan_field field;
@@ -704,7 +976,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 					 */
 
 					/* LOG_DEBUG("FLUSHING QUEUE"); */
-					result = jtag_execute_queue();
+					result = xsvf_execute_queue(&file_offset);
 					if (result != ERROR_OK)
 						tdo_mismatch = 1;
 				}
@@ -718,7 +990,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 				char comment[128];
 
 				do {
-					if (read(xsvf_fd, &uc, 1) < 0) {
+					if (xsvf_read(&uc, 1) != ERROR_OK) {
 						do_abort = 1;
 						break;
 					}
@@ -748,9 +1020,9 @@ COMMAND_HANDLER(handle_xsvf_command)
 				tap_state_t end_state;
 				int delay;
 
-				if (read(xsvf_fd, &wait_local, 1) < 0
-					|| read(xsvf_fd, &end, 1) < 0
-					|| read(xsvf_fd, delay_buf, 4) < 0) {
+				if (xsvf_read(&wait_local, 1) != ERROR_OK
+					|| xsvf_read(&end, 1) != ERROR_OK
+					|| xsvf_read(delay_buf, 4) != ERROR_OK) {
 						do_abort = 1;
 						break;
 				}
@@ -793,10 +1065,10 @@ COMMAND_HANDLER(handle_xsvf_command)
 				int clock_count;
 				int usecs;
 
-				if (read(xsvf_fd, &wait_local, 1) < 0
-						||  read(xsvf_fd, &end, 1) < 0
-						||  read(xsvf_fd, clock_buf, 4) < 0
-						||  read(xsvf_fd, usecs_buf, 4) < 0) {
+				if (xsvf_read(&wait_local, 1) != ERROR_OK
+						||  xsvf_read(&end, 1) != ERROR_OK
+						||  xsvf_read(clock_buf, 4) != ERROR_OK
+						||  xsvf_read(usecs_buf, 4) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
@@ -845,7 +1117,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 				*/
 				uint8_t count_buf[4];
 
-				if (read(xsvf_fd, count_buf, 4) < 0) {
+				if (xsvf_read(count_buf, 4) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
@@ -864,9 +1136,9 @@ COMMAND_HANDLER(handle_xsvf_command)
 				uint8_t clock_buf[4];
 				uint8_t usecs_buf[4];
 
-				if (read(xsvf_fd, &state, 1) < 0
-						|| read(xsvf_fd, clock_buf, 4) < 0
-						|| read(xsvf_fd, usecs_buf, 4) < 0) {
+				if (xsvf_read(&state, 1) != ERROR_OK
+						|| xsvf_read(clock_buf, 4) != ERROR_OK
+						|| xsvf_read(usecs_buf, 4) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
@@ -892,8 +1164,8 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 				LOG_DEBUG("LSDR");
 
-				if (xsvf_read_buffer(xsdrsize, xsvf_fd, dr_out_buf) != ERROR_OK
-						|| xsvf_read_buffer(xsdrsize, xsvf_fd, dr_in_buf) != ERROR_OK) {
+				if (xsvf_read_buffer(xsdrsize, dr_out_buf) != ERROR_OK
+						|| xsvf_read_buffer(xsdrsize, dr_in_buf) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
@@ -952,7 +1224,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 			{
 				uint8_t trst_mode;
 
-				if (read(xsvf_fd, &trst_mode, 1) < 0) {
+				if (xsvf_read(&trst_mode, 1) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
@@ -986,13 +1258,19 @@ COMMAND_HANDLER(handle_xsvf_command)
 			result = svf_add_statemove(TAP_IDLE);
 			if (result != ERROR_OK)
 				return result;
-			result = jtag_execute_queue();
-			if (result != ERROR_OK)
-				return result;
+			if (xsvf_execute_queue(&file_offset) != ERROR_OK)
+				tdo_mismatch = 1;
 			break;
 		}
 	}
 
+	xsvf_dr_chain_free(&dr_chain);
+
+	/* verify the scans still pending at the end of the file */
+	if (!do_abort && !unsupported && !tdo_mismatch &&
+			xsvf_execute_queue(&file_offset) != ERROR_OK)
+		tdo_mismatch = 1;
+
 	if (tdo_mismatch) {
 		command_print(CMD,
 			"TDO mismatch, somewhere near offset %lu in xsvf file, aborting",
@@ -1002,10 +1280,10 @@ COMMAND_HANDLER(handle_xsvf_command)
 	}
 
 	if (unsupported) {
-		off_t offset = lseek(xsvf_fd, 0, SEEK_CUR) - 1;
+		long offset = xsvf_offset - 1;
 		command_print(CMD,
-			"unsupported xsvf command (0x%02X) at offset %jd, aborting",
-			uc, (intmax_t)offset);
+			"unsupported xsvf command (0x%02X) at offset %ld, aborting",
+			uc, offset);
 		return ERROR_FAIL;
 	}
 
@@ -0,0 +1,125 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+# Description:
+#  Find the highest adapter speed at which the target is accessed
+#  reliably. A binary search between a known good and an upper speed
+#  checks at each candidate speed:
+#   - repeated reads of the DP identification register (DPIDR), when
+#     the current target has a DAP,
+#   - a write and read back of word patterns in target RAM, whose
+#     content is restored afterwards.
+#  A safety margin is then applied to the highest passing speed and the
+#  result is set with "adapter speed".
+#
+#  The reliable speed often differs between reset, when the target runs
+#  from a slow clock, and normal operation. Run the calibration in both
+#  states and set each result from the matching event handlers, e.g.:
+#
+#   source [find tools/adapter_speed.tcl]
+#   reset init
+#   set init_khz [adapter_speed_calibrate 0x20000000]
+#   resume
+#   set run_khz [adapter_speed_calibrate 0x20000000]
+#   $_TARGETNAME configure -event reset-start "adapter speed $init_khz"
+#   $_TARGETNAME configure -event reset-init "adapter speed $run_khz"
+#
+# Note:
+#  The adapter may round the requested speed down, the speeds reported
+#  are the ones actually set by the adapter driver.
+
+# Set the adapter speed, or only query it without argument, and return
+# the speed actually used, in kHz
+proc adapter_speed_set_khz { args } {
+	if {![regexp {([0-9]+) kHz} [adapter speed {*}$args] -> actual]} {
+		error "adapter_speed_calibrate: adaptive clocking is in use"
+	}
+	return $actual
+}
+
+# Return 1 if the target is accessed without errors at the current speed
+proc adapter_speed_check { address words repeat } {
+	set dap ""
+	catch {set dap [[target current] cget -dap]}
+
+	if {[catch {
+		if {$dap ne ""} {
+			set dpidr [$dap dpreg 0]
+			for {set i 1} {$i < $repeat} {incr i} {
+				if {[$dap dpreg 0] != $dpidr} {
+					return 0
+				}
+			}
+		}
+
+		set patterns [list 0x00000000 0xffffffff 0x55555555 0xaaaaaaaa]
+		for {set i 0} {$i < $repeat} {incr i} {
+			# Walking and pseudo-random words, different on each pass
+			set data {}
+			set seed [expr {0x12345678 + $i}]
+			for {set j 0} {$j < $words} {incr j} {
+				switch [expr {$j % 3}] {
+					0 { set word [lindex $patterns [expr {($i + $j) % 4}]] }
+					1 { set word [expr {1 << (($i + $j) % 32)}] }
+					2 {
+						set seed [expr {($seed * 1103515245 + 12345) & 0xffffffff}]
+						set word $seed
+					}
+				}
+				lappend data $word
+			}
+
+			write_memory $address 32 $data
+			set readback [read_memory $address 32 $words]
+			for {set j 0} {$j < $words} {incr j} {
+				if {[lindex $readback $j] != [lindex $data $j]} {
+					return 0
+				}
+			}
+		}
+	}]} {
+		return 0
+	}
+	return 1
+}
+
+add_help_text adapter_speed_calibrate "Find and set the highest reliable adapter speed, the RAM content is restored"
+add_usage_text adapter_speed_calibrate {address [max_khz [min_khz [margin_percent [words [repeat]]]]]}
+proc adapter_speed_calibrate { address { max_khz 50000 } { min_khz 100 } { margin_percent 25 } { words 256 } { repeat 4 } } {
+	set initial_khz [adapter_speed_set_khz]
+
+	# Save the RAM used by the pattern check at the initial speed
+	set saved [read_memory $address 32 $words]
+
+	set low [adapter_speed_set_khz $min_khz]
+	if {![adapter_speed_check $address $words $repeat]} {
+		adapter_speed_set_khz $initial_khz
+		error "adapter_speed_calibrate: target access fails at $low kHz"
+	}
+
+	set high [expr {$max_khz + 1}]
+	while {$high - $low > 1} {
+		set mid [expr {($low + $high) / 2}]
+		set actual [adapter_speed_set_khz $mid]
+		if {$actual <= $low} {
+			# The adapter can not run between low and mid
+			set low $mid
+			continue
+		}
+		if {[adapter_speed_check $address $words $repeat]} {
+			echo "adapter_speed_calibrate: $actual kHz passed"
+			set low $mid
+		} else {
+			echo "adapter_speed_calibrate: $actual kHz failed"
+			set high $mid
+		}
+	}
+
+	set khz [expr {$low * (100 - $margin_percent) / 100}]
+	if {$khz < $min_khz} {
+		set khz $min_khz
+	}
+	set khz [adapter_speed_set_khz $khz]
+
+	write_memory $address 32 $saved
+	return $khz
+}
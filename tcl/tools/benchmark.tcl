@@ -0,0 +1,126 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+# Description:
+#  Measure the performance of the debug adapter and target access paths:
+#  memory bandwidth by block size, register access latency and flash
+#  erase/program throughput.
+#
+#  Each benchmark returns a list of records, one per measurement, each
+#  record being a flat dict. benchmark_json converts such a list to JSON
+#  to track results over time, e.g.:
+#
+#   source [find tools/benchmark.tcl]
+#   set r [benchmark_memory 0x20000000 {256 1024 4096 16384}]
+#   echo [benchmark_json $r]
+#
+# Note:
+#  Times have a resolution of 1 ms, use enough repetitions.
+
+# Time in ms spent running script, at least 1 ms
+proc benchmark_time_ms { script } {
+	set start [ms]
+	uplevel 1 $script
+	set elapsed [expr {[ms] - $start}]
+	return [expr {$elapsed > 0 ? $elapsed : 1}]
+}
+
+add_help_text benchmark_memory "Measure memory read and write bandwidth for each block size, the memory content is restored"
+add_usage_text benchmark_memory {address block_sizes [repeat [file]]}
+proc benchmark_memory { address block_sizes { repeat 10 } { file "benchmark.bin" } } {
+	set results {}
+
+	foreach size $block_sizes {
+		# Read the block to a file, then write the same data back
+		set read_ms [benchmark_time_ms {
+			for {set i 0} {$i < $repeat} {incr i} {
+				dump_image $file $address $size
+			}
+		}]
+		set write_ms [benchmark_time_ms {
+			for {set i 0} {$i < $repeat} {incr i} {
+				load_image $file $address bin
+			}
+		}]
+
+		lappend results [dict create \
+			benchmark memory \
+			block_size $size \
+			repeat $repeat \
+			read_kib_s [expr {$size * $repeat * 1000.0 / 1024 / $read_ms}] \
+			write_kib_s [expr {$size * $repeat * 1000.0 / 1024 / $write_ms}]]
+	}
+
+	file delete $file
+	return $results
+}
+
+add_help_text benchmark_registers "Measure the latency of register reads from the halted target"
+add_usage_text benchmark_registers {[registers [repeat]]}
+proc benchmark_registers { { registers {pc} } { repeat 100 } } {
+	if {[[target current] curstate] ne "halted"} {
+		error "benchmark_registers: target must be halted"
+	}
+
+	set results {}
+
+	foreach reg $registers {
+		# -force reads the target, not the register cache
+		set elapsed_ms [benchmark_time_ms {
+			for {set i 0} {$i < $repeat} {incr i} {
+				get_reg -force $reg
+			}
+		}]
+
+		lappend results [dict create \
+			benchmark register \
+			register $reg \
+			repeat $repeat \
+			latency_us [expr {$elapsed_ms * 1000.0 / $repeat}]]
+	}
+
+	return $results
+}
+
+add_help_text benchmark_flash "Measure flash erase and program throughput, the flash content is destroyed"
+add_usage_text benchmark_flash {address length [pattern]}
+proc benchmark_flash { address length { pattern 0x5a5aa5a5 } } {
+	set erase_ms [benchmark_time_ms {
+		flash erase_address $address $length
+	}]
+
+	# flash fillw reads the data back and compares it
+	set program_ms [benchmark_time_ms {
+		flash fillw $address $pattern [expr {$length / 4}]
+	}]
+
+	set verify_ms [benchmark_time_ms {
+		dump_image benchmark.bin $address $length
+	}]
+	file delete benchmark.bin
+
+	return [list [dict create \
+		benchmark flash \
+		length $length \
+		erase_kib_s [expr {$length * 1000.0 / 1024 / $erase_ms}] \
+		program_kib_s [expr {$length * 1000.0 / 1024 / $program_ms}] \
+		read_kib_s [expr {$length * 1000.0 / 1024 / $verify_ms}]]]
+}
+
+add_help_text benchmark_json "Convert a list of benchmark records to JSON"
+add_usage_text benchmark_json {records}
+proc benchmark_json { records } {
+	set objects {}
+
+	foreach record $records {
+		set members {}
+		dict for {key value} $record {
+			if {![string is double -strict $value]} {
+				set value "\"[string map {\\ \\\\ \" \\\"} $value]\""
+			}
+			lappend members "\"$key\": $value"
+		}
+		lappend objects "\{[join $members {, }]\}"
+	}
+
+	return "\[[join $objects {, }]\]"
+}